@@ -0,0 +1,18 @@
+# - Find SQLite3
+#
+# SQLITE3_INCLUDE_DIR - Where to find sqlite3.h
+# SQLITE3_LIBS - List of libraries when using SQLite3.
+# SQLITE3_FOUND - True if SQLite3 found.
+
+find_path(SQLITE3_INCLUDE_DIR
+  sqlite3.h
+  HINTS $ENV{SQLITE3_ROOT}/include)
+
+find_library(SQLITE3_LIBS
+  sqlite3
+  HINTS $ENV{SQLITE3_ROOT}/lib)
+
+include(FindPackageHandleStandardArgs)
+find_package_handle_standard_args(sqlite3 DEFAULT_MSG SQLITE3_LIBS SQLITE3_INCLUDE_DIR)
+
+mark_as_advanced(SQLITE3_INCLUDE_DIR SQLITE3_LIBS)
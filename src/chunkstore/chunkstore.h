@@ -168,6 +168,20 @@ public:
      */
     virtual int write_async(void* buff, uint64_t off, uint64_t len, chunk_opt_cb_t cb, void* cb_arg) = 0;
 
+    /**
+     * write_zeros_async()
+     * 异步清零：释放[off, off+len)的存储空间，之后读到的都是0，不需要传输数据。
+     * 默认实现为同步写入零缓冲，后端应当以打洞/unmap等方式覆盖
+     */
+    virtual int write_zeros_async(uint64_t off, uint64_t len, chunk_opt_cb_t cb, void* cb_arg);
+
+    /**
+     * is_zero()
+     * [off, off+len)是否都未分配（读到的必然是0），用于读时跳过设备IO。
+     * 无法判断时返回false
+     */
+    virtual bool is_zero(uint64_t off, uint64_t len) { return false; }
+
     Chunk(const Chunk&) = delete;
     Chunk(Chunk&&) = delete;
     Chunk& operator = (const Chunk&) = delete;
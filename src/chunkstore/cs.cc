@@ -4,12 +4,31 @@
 #include "chunkstore/filestore/filestore.h"
 #include "chunkstore/nvmestore/nvmestore.h"
 
+#include "include/retcode.h"
+
+#include <cstdlib>
+#include <cstring>
+
 #include "chunkstore/log_cs.h"
 
 using namespace std;
 
 namespace flame {
 
+int Chunk::write_zeros_async(uint64_t off, uint64_t len, chunk_opt_cb_t cb, void* cb_arg) {
+    void* buff = nullptr;
+    if (posix_memalign(&buff, 4096, len) != 0)
+        return RC_FAILD;
+    memset(buff, 0, len);
+    int r = write_sync(buff, off, len);
+    free(buff);
+    if (r != RC_SUCCESS)
+        return r;
+    if (cb != nullptr)
+        cb(cb_arg);
+    return RC_SUCCESS;
+}
+
 shared_ptr<ChunkStore> create_chunkstore(FlameContext* fct, const string& url) {
     size_t pos = url.find("://");
     if (pos == string::npos) {
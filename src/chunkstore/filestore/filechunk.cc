@@ -5,6 +5,7 @@
 #include <mutex>
 #include <atomic>
 #include <cstdint>
+#include <algorithm>
 
 #include <time.h>
 #include <unistd.h>
@@ -18,6 +19,7 @@
 #include <dirent.h>
 #include <libaio.h>
 #include <inttypes.h>
+#include <linux/falloc.h>
 
 #include "chunkstore/chunkstore.h"
 #include "chunkstore/chunkmap.h"
@@ -942,6 +944,129 @@ int FileChunk::write_async(void *payload, uint64_t length, off_t offset, void *e
     return CHUNK_OP_SUCCESS;
 }
 
+#define ZERO_BLOCK_SIZE     4096
+#define ZERO_BUFFER_SIZE    (256 * 1024)
+
+/*
+ * 只读的全零缓冲，按块对齐以满足O_DIRECT，进程内共享不释放
+ */
+static const char* zero_buffer() {
+    static char* zeros = []() -> char* {
+        char* buf = nullptr;
+        if(posix_memalign((void **)&buf, ZERO_BLOCK_SIZE, ZERO_BUFFER_SIZE) != 0)
+            return nullptr;
+        memset(buf, 0, ZERO_BUFFER_SIZE);
+        return buf;
+    }();
+    return zeros;
+}
+
+/*
+ * 写零。O_DIRECT要求偏移和长度也按块对齐，首尾不对齐的部分读出所在的块清零后写回
+ */
+static int write_zeros_by_pwrite(int fd, uint64_t off, uint64_t len) {
+    const char* zeros = zero_buffer();
+    if(zeros == nullptr)
+        return -1;
+
+    while(len > 0) {
+        uint64_t blk_off = off % ZERO_BLOCK_SIZE;
+        if(blk_off != 0 || len < ZERO_BLOCK_SIZE) {
+            uint64_t op_length = std::min(len, (uint64_t)ZERO_BLOCK_SIZE - blk_off);
+            char* block = nullptr;
+            if(posix_memalign((void **)&block, ZERO_BLOCK_SIZE, ZERO_BLOCK_SIZE) != 0)
+                return -1;
+            ssize_t rd = pread(fd, block, ZERO_BLOCK_SIZE, off - blk_off);
+            if(rd < 0) {
+                free(block);
+                return -1;
+            }
+            // 文件末尾之后的部分读不出数据，按零处理
+            if(rd < ZERO_BLOCK_SIZE)
+                memset(block + rd, 0, ZERO_BLOCK_SIZE - rd);
+            memset(block + blk_off, 0, op_length);
+            ssize_t wr = pwrite(fd, block, ZERO_BLOCK_SIZE, off - blk_off);
+            free(block);
+            if(wr < ZERO_BLOCK_SIZE)
+                return -1;
+            off += op_length;
+            len -= op_length;
+            continue;
+        }
+
+        uint64_t op_length = std::min(len, (uint64_t)ZERO_BUFFER_SIZE);
+        op_length -= op_length % ZERO_BLOCK_SIZE;
+        if(pwrite(fd, zeros, op_length, off) < (ssize_t)op_length)
+            return -1;
+        off += op_length;
+        len -= op_length;
+    }
+    return 0;
+}
+
+/*
+ * 非预分配的Chunk直接打洞释放空间，预分配的Chunk用ZERO_RANGE保留已分配的空间；
+ * 文件系统不支持时退化为写零
+ */
+int FileChunk::write_zeros_async(uint64_t off, uint64_t len, chunk_opt_cb_t cb, void *cb_arg) {
+    uint64_t object_size = get_object_size();
+    int mode = is_preallocated() ? FALLOC_FL_ZERO_RANGE : (FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE);
+
+    while(len > 0) {
+        uint64_t obj_off = off % object_size;
+        uint64_t op_length = std::min(len, object_size - obj_off);
+        Object *obj = open_object(off / object_size);
+        if(obj == nullptr) {
+            fct_->log()->lerror("open object faild.");
+            return CHUNK_OP_WRITE_ERR;
+        }
+        obj->write_counter_add(1);
+        obj->update_access_time();
+
+        if(fallocate(obj->get_fd(), mode, obj_off, op_length) != 0) {
+            if(errno != EOPNOTSUPP) {
+                fct_->log()->lerror("fallocate faild: %s", strerror(errno));
+                return CHUNK_OP_WRITE_ERR;
+            }
+            if(write_zeros_by_pwrite(obj->get_fd(), obj_off, op_length) != 0) {
+                fct_->log()->lerror("write zeros faild: %s", strerror(errno));
+                return CHUNK_OP_WRITE_ERR;
+            }
+        }
+
+        off += op_length;
+        len -= op_length;
+    }
+
+    if(cb != nullptr)
+        cb(cb_arg);
+    return CHUNK_OP_SUCCESS;
+}
+
+bool FileChunk::is_zero(uint64_t off, uint64_t len) {
+    uint64_t object_size = get_object_size();
+    while(len > 0) {
+        uint64_t obj_off = off % object_size;
+        uint64_t op_length = std::min(len, object_size - obj_off);
+        Object *obj = open_object(off / object_size);
+        if(obj == nullptr)
+            return false;
+
+        // 区间内没有数据：SEEK_DATA失败(ENXIO, 已到文件尾)或者下一段数据在区间之后
+        off_t data = lseek(obj->get_fd(), obj_off, SEEK_DATA);
+        if(data < 0) {
+            if(errno != ENXIO)
+                return false;
+        } else if((uint64_t)data < obj_off + op_length) {
+            return false;
+        }
+
+        off += op_length;
+        len -= op_length;
+    }
+    return true;
+}
+
 int FileChunk::write_chunk(void *buff, uint64_t off, uint64_t len, void *extra_arg) {
     int ret;
     switch(filestore->get_io_mode()) {
@@ -457,6 +457,9 @@ public:
     int read_async(void* buff, uint64_t off, uint64_t len, chunk_opt_cb_t cb, void* cb_arg);    //异步读操作
     int write_async(void* buff, uint64_t off, uint64_t len, chunk_opt_cb_t cb, void* cb_arg);   //异步写操作
 
+    int write_zeros_async(uint64_t off, uint64_t len, chunk_opt_cb_t cb, void* cb_arg);       //打洞清零，同步完成后回调
+    bool is_zero(uint64_t off, uint64_t len);                                                  //通过SEEK_DATA判断是否全为空洞
+
     //这两个函数作为接口函数，而异步和同步应该由filestore的io_mode来决定
     int read_chunk(void *buff, uint64_t off, uint64_t len, void *extra_arg);
     int write_chunk(void *buff, uint64_t off, uint64_t len, void *extra_arg);
@@ -363,6 +363,7 @@ void NvmeChunk::chunk_io_cb(void *cb_arg, int bserrno) {
         }
         break;
         case CHUNK_WRITE: 
+        case CHUNK_UNMAP:
         {
             nv_channel = nvmestore->get_write_channels()->get_nv_channel(curr_core);
 
@@ -436,6 +437,23 @@ void NvmeChunk::chunk_io_start(void *arg1, void *arg2) {
             spdk_blob_io_write(chunk->get_blob(), io_channel, cwarg->buff, io_offset, io_length, chunk_io_cb, cwarg);
         }
         break;
+        case CHUNK_UNMAP:
+        {
+            nv_channel = nvmestore->get_write_channels()->get_nv_channel(curr_core);
+            io_channel = nv_channel->get_channel();
+            nv_channel->curr_io_ops_add(1);
+
+            struct chunk_write_arg *cwarg = dynamic_cast<chunk_write_arg *>(oparg);
+            io_length = chunk->length_to_unit(cwarg->length);
+            io_offset = chunk->offset_to_unit(cwarg->offset);
+
+            //预分配的chunk保留已分配的cluster，否则直接unmap释放空间
+            if(chunk->is_preallocated())
+                spdk_blob_io_write_zeroes(chunk->get_blob(), io_channel, io_offset, io_length, chunk_io_cb, cwarg);
+            else
+                spdk_blob_io_unmap(chunk->get_blob(), io_channel, io_offset, io_length, chunk_io_cb, cwarg);
+        }
+        break;
     }
 }
 
@@ -483,6 +501,27 @@ int NvmeChunk::write_async(void *buff, uint64_t off, uint64_t len, chunk_opt_cb_
     return ret;
 }
 
+/*
+ * write_zeros_async: write_zeros_async函数用于异步清零chunk数据，不需要数据缓冲区
+ * len: 清零长度， 以字节为单位
+ * off: 偏移地址， 以字节为单位
+ * cb: callback回调函数
+ * cb_arg: cb_arg表示回调函数参数
+*/
+int NvmeChunk::write_zeros_async(uint64_t off, uint64_t len, chunk_opt_cb_t cb, void *cb_arg) {
+    int ret = NVMECHUNK_OP_SUCCESS;
+
+    struct chunk_write_arg *cwarg = new chunk_write_arg(this, &ret, false, nullptr, 
+                                                        off, len, nullptr, cb, cb_arg);
+    cwarg->opcode = CHUNK_UNMAP;
+
+    uint32_t target_core = this->get_target_core(WRITE_CHANNEL);
+    struct spdk_event *event = spdk_event_allocate(target_core, chunk_io_start, cwarg, nullptr);
+    spdk_event_call(event);
+
+    return ret;
+}
+
 void NvmeChunk::delete_blob_cb(void *cb_arg, int bserrno) {
     NvmeChunkOpArg *oparg = (NvmeChunkOpArg *)cb_arg;
     NvmeChunk *chunk = oparg->chunk;
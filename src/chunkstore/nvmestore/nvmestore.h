@@ -101,7 +101,8 @@ enum NvmeChunkOpType {
     CHUNK_CLOSE,
     CHUNK_PERSIST_MD,
     CHUNK_READ,
-    CHUNK_WRITE
+    CHUNK_WRITE,
+    CHUNK_UNMAP
 };
 
 enum NvmeIOChannelOpType {
@@ -805,6 +806,7 @@ public:
 
     int read_async( void* buff,  uint64_t off, uint64_t len, chunk_opt_cb_t cb, void* cb_arg);
     int write_async(void* buff, uint64_t off, uint64_t len, chunk_opt_cb_t cb, void* cb_arg);
+    int write_zeros_async(uint64_t off, uint64_t len, chunk_opt_cb_t cb, void* cb_arg);
     
 };
 
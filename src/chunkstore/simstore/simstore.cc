@@ -724,17 +724,44 @@ int SimChunk::write_async(void* buff, uint64_t off, uint64_t len, chunk_opt_cb_t
     return RC_SUCCESS;
 }
 
-void SimChunk::blk_range__(uint32_t& begin, uint32_t& end, uint64_t off, uint64_t len) {
-    int chk_size = chk_->info.size;
-    uint64_t sz;
-    end = begin = off / SIMSTORE_BLOCK_SIZE;
-    sz = off % SIMSTORE_BLOCK_SIZE;
-    if (!sz) sz = SIMSTORE_BLOCK_SIZE;
-    len -= sz;
-    while (len > 0) {
-        end++;
-        len -= SIMSTORE_BLOCK_SIZE;
+int SimChunk::write_zeros_async(uint64_t off, uint64_t len, chunk_opt_cb_t cb, void* cb_arg) {
+    uint32_t begin, end;
+    blk_range__(begin, end, off, len);
+    // 只释放被完整覆盖的块，首尾的部分块仍然有数据
+    if (off % SIMSTORE_BLOCK_SIZE)
+        begin++;
+    if ((off + len) % SIMSTORE_BLOCK_SIZE && (off + len) < chk_->info.size && end > 0)
+        end--;
+    for (uint32_t idx = begin; idx < end; idx++) {
+        chk_->blocks[idx].ctime = 0;
     }
+    fct_->log()->linfo("simstore: write zeros chk_id(%llu), off(%llu), len(%llu)",
+        chk_->info.chk_id, off, len);
+    if (cb != nullptr)
+        cb(cb_arg);
+    return RC_SUCCESS;
+}
+
+bool SimChunk::is_zero(uint64_t off, uint64_t len) {
+    uint32_t begin, end;
+    blk_range__(begin, end, off, len);
+    for (uint32_t idx = begin; idx < end; idx++) {
+        if (chk_->blocks[idx].ctime)
+            return false;
+    }
+    return true;
+}
+
+/**
+ * [begin, end)为[off, off + len)涉及的块
+ */
+void SimChunk::blk_range__(uint32_t& begin, uint32_t& end, uint64_t off, uint64_t len) {
+    begin = off / SIMSTORE_BLOCK_SIZE;
+    end = len ? (off + len - 1) / SIMSTORE_BLOCK_SIZE + 1 : begin;
+    if (end > chk_->blocks.size())
+        end = chk_->blocks.size();
+    if (begin > end)
+        begin = end;
 }
 
 void SimChunk::rd_count__(uint64_t off, uint64_t len) {
@@ -747,9 +774,13 @@ void SimChunk::rd_count__(uint64_t off, uint64_t len) {
 
 void SimChunk::wr_count__(uint64_t off, uint64_t len) {
     uint32_t begin, end;
+    uint64_t now = utime_t::now().to_usec();
     blk_range__(begin, end, off, len);
     for (int idx = begin; idx < end; idx++) {
         chk_->blocks[idx].cnt.wr++;
+        // ctime非0表示块已分配
+        if (!chk_->blocks[idx].ctime)
+            chk_->blocks[idx].ctime = now;
     }
 }
 
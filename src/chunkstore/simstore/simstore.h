@@ -125,6 +125,8 @@ public:
     virtual int set_xattr(const std::string& name, const std::string& value) override;
     virtual int read_async(void* buff, uint64_t off, uint64_t len, chunk_opt_cb_t cb, void* cb_arg) override;
     virtual int write_async(void* buff, uint64_t off, uint64_t len, chunk_opt_cb_t cb, void* cb_arg) override;
+    virtual int write_zeros_async(uint64_t off, uint64_t len, chunk_opt_cb_t cb, void* cb_arg) override;
+    virtual bool is_zero(uint64_t off, uint64_t len) override;
 
     friend class SimStore;
 private:
@@ -6,6 +6,9 @@
 #include "work/timer_work.h"
 #include "cluster/clt_agent.h"
 #include "csd/csd_context.h"
+#include "csd/chunk_health.h"
+#include "csd/chunk_io_sched.h"
+#include "common/hlt_codec.h"
 #include "include/retcode.h"
 
 #include "include/internal.h"
@@ -14,28 +17,82 @@
 
 namespace flame {
 
-class PushStatWork : public WorkEntry {
+/**
+ * @brief CSD周期汇报
+ * 心跳与状态每个周期汇报一次，健康信息每health_cycles个周期随汇报一起发送，
+ * 其中的Chunk健康信息只包含相对上一次被MGR接受的汇报有变化的部分
+ */
+class ReportWork : public WorkEntry {
 public:
-    PushStatWork(CsdContext* cct)
-    : cct_(cct), stub_(cct->mgr_stub()) {}
+    ReportWork(CsdContext* cct, uint32_t health_cycles)
+    : cct_(cct), stub_(cct->mgr_stub()), health_cycles_(health_cycles) {}
 
     virtual void entry() override {
-        stub_->push_status(cct_->csd_id(), cct_->csd_stat());
+        csd_report_attr_t attr;
+        attr.csd_id = cct_->csd_id();
+        attr.stat = cct_->csd_stat();
+        attr.seq = ++seq_;
+
+        if (cct_->hlt() && health_cycles_ > 0 && ++cycles_ >= health_cycles_) {
+            cycles_ = 0;
+            csd_hlt_attr_t hlt;
+            cct_->hlt()->collect(hlt, utime_t::now().to_usec());
+            attr.has_health = true;
+            attr.csd_hlt_sub = hlt.csd_hlt_sub;
+            attr.base_seq = base_seq_;
+            attr.chk_num = encoder_.encode(attr.chk_delta, hlt.chk_hlt_list, base_seq_ == 0);
+
+            if (cct_->sched()) {
+                chunk_sched_stat_t st;
+                cct_->sched()->collect(st);
+                cct_->log()->linfo("io sched: io(%llu) issued(%llu) merge_rate(%.3lf) wait_avg(%llu us) wait_max(%llu us) zero_rd(%llu)",
+                    st.io_cnt, st.issue_cnt, st.merge_rate(), st.wait_avg(), st.wait_max, st.zero_rd);
+
+                std::list<chunk_qos_stat_t> qos;
+                cct_->sched()->qos_collect(qos);
+                for (auto it = qos.begin(); it != qos.end(); it++) {
+                    if (it->throttled == 0 && it->deferred == 0)
+                        continue;
+                    cct_->log()->linfo("io qos %s(%llu): passed(%llu) throttled(%llu) delay_avg(%llu us) delay_max(%llu us) deferred(%u)",
+                        it->type == QOS_TYPE_VOL ? "vol" : "client", it->id, it->passed, it->throttled,
+                        it->delay_avg(), it->delay_max, it->deferred);
+                }
+            }
+        }
+
+        bool need_full = false;
+        int r = stub_->push_report(attr, need_full);
+        if (!attr.has_health)
+            return;
+
+        if (need_full) {
+            encoder_.reset();
+            base_seq_ = 0;
+        } else if (r == RC_SUCCESS) {
+            // 发送失败时保持原基线，MGR若已接受则会在下一次汇报时要求全量
+            encoder_.commit();
+            base_seq_ = attr.seq;
+        }
     }
 
 private:
     CsdContext* cct_;
     std::shared_ptr<InternalClient> stub_;
-}; // class PushStatWork
+    uint32_t health_cycles_;
+    uint32_t cycles_ {0};
+    uint64_t seq_ {0};
+    uint64_t base_seq_ {0};
+    ChunkHealthEncoder encoder_;
+}; // class ReportWork
 
 class MyClusterAgent : public ClusterAgent {
 public:
-    MyClusterAgent(CsdContext* cct, utime_t cycle) 
-    : ClusterAgent(cct), cycle_(cycle) {}
+    MyClusterAgent(CsdContext* cct, utime_t cycle, uint32_t health_cycles) 
+    : ClusterAgent(cct), cycle_(cycle), health_cycles_(health_cycles) {}
 
     virtual int init() override {
         cct_->timer()->push_cycle(
-            std::shared_ptr<WorkEntry>(new PushStatWork(cct_)), 
+            std::shared_ptr<WorkEntry>(new ReportWork(cct_, health_cycles_)), 
             cycle_
         );
         return RC_SUCCESS;
@@ -43,6 +100,7 @@ public:
 
 private:
     utime_t cycle_;
+    uint32_t health_cycles_;
 }; // class MyClusterAgent
 
 } // namespace flame
@@ -0,0 +1,200 @@
+#include "common/hlt_codec.h"
+#include "include/retcode.h"
+
+#include <vector>
+
+using namespace std;
+
+namespace flame {
+
+static uint64_t hlt_field_get(const chk_hlt_attr_t& a, int f) {
+    switch (f) {
+    case CHK_HLT_SIZE:      return a.size;
+    case CHK_HLT_STAT:      return a.stat;
+    case CHK_HLT_USED:      return a.used;
+    case CHK_HLT_CSD_USED:  return a.csd_used;
+    case CHK_HLT_DST_USED:  return a.dst_used;
+    case CHK_HLT_WR_CNT:    return a.period.wr_cnt;
+    case CHK_HLT_RD_CNT:    return a.period.rd_cnt;
+    case CHK_HLT_LAT:       return a.period.lat;
+    case CHK_HLT_ALLOC:     return a.period.alloc;
+    }
+    return 0;
+}
+
+static void hlt_field_set(chk_hlt_attr_t& a, int f, uint64_t v) {
+    switch (f) {
+    case CHK_HLT_SIZE:      a.size = v; break;
+    case CHK_HLT_STAT:      a.stat = (uint32_t)v; break;
+    case CHK_HLT_USED:      a.used = v; break;
+    case CHK_HLT_CSD_USED:  a.csd_used = v; break;
+    case CHK_HLT_DST_USED:  a.dst_used = v; break;
+    case CHK_HLT_WR_CNT:    a.period.wr_cnt = v; break;
+    case CHK_HLT_RD_CNT:    a.period.rd_cnt = v; break;
+    case CHK_HLT_LAT:       a.period.lat = v; break;
+    case CHK_HLT_ALLOC:     a.period.alloc = v; break;
+    }
+}
+
+// 周期计数（wr_cnt/rd_cnt/lat/alloc）只描述本周期，MGR按周期累加，
+// 因此不与基线做差，非0时每个周期都要输出
+static inline bool hlt_field_periodic(int f) {
+    return f >= CHK_HLT_WR_CNT;
+}
+
+static bool hlt_period_zero(const chk_hlt_attr_t& a) {
+    return a.period.wr_cnt == 0 && a.period.rd_cnt == 0 && a.period.lat == 0 && a.period.alloc == 0;
+}
+
+static void hlt_put_entry(string& out, uint64_t& prev_id, uint64_t chk_id, uint32_t mask,
+const chk_hlt_attr_t* cur, const chk_hlt_attr_t* base) {
+    varint_put(out, chk_id - prev_id);
+    varint_put(out, mask);
+    prev_id = chk_id;
+    if (mask & CHK_HLT_REMOVED)
+        return;
+    for (int f = 0; f < CHK_HLT_FIELD_NUM; f++) {
+        if (!(mask & (1U << f)))
+            continue;
+        uint64_t b = (base && !hlt_field_periodic(f)) ? hlt_field_get(*base, f) : 0;
+        varint_put(out, zigzag_encode((int64_t)(hlt_field_get(*cur, f) - b)));
+    }
+}
+
+uint32_t ChunkHealthEncoder::encode(string& out, const list<chk_hlt_attr_t>& cur, bool full) {
+    pending_.clear();
+    for (auto it = cur.begin(); it != cur.end(); it++)
+        pending_[it->chk_id] = *it;
+
+    out.clear();
+    uint32_t num = 0;
+    uint64_t prev_id = 0;
+    static const chk_hlt_attr_t zero;
+
+    // 两个有序表归并，保证chk_id升序
+    auto bit = base_.begin();
+    auto pit = pending_.begin();
+    while (pit != pending_.end() || (!full && bit != base_.end())) {
+        if (full) {
+            uint32_t mask = 0;
+            for (int f = 0; f < CHK_HLT_FIELD_NUM; f++) {
+                if (hlt_field_get(pit->second, f) != 0)
+                    mask |= 1U << f;
+            }
+            hlt_put_entry(out, prev_id, pit->first, mask, &pit->second, &zero);
+            num++;
+            pit++;
+            continue;
+        }
+
+        if (pit == pending_.end() || (bit != base_.end() && bit->first < pit->first)) {
+            hlt_put_entry(out, prev_id, bit->first, CHK_HLT_REMOVED, nullptr, nullptr);
+            num++;
+            bit++;
+            continue;
+        }
+
+        const chk_hlt_attr_t* base = &zero;
+        bool added = true;
+        if (bit != base_.end() && bit->first == pit->first) {
+            base = &bit->second;
+            added = false;
+            bit++;
+        }
+
+        uint32_t mask = 0;
+        for (int f = 0; f < CHK_HLT_FIELD_NUM; f++) {
+            uint64_t b = hlt_field_periodic(f) ? 0 : hlt_field_get(*base, f);
+            if (hlt_field_get(pit->second, f) != b)
+                mask |= 1U << f;
+        }
+        // 新增的Chunk即使全部为0也需要输出，以便MGR建立基线；
+        // 周期计数由非0变为0时也需要输出，以便MGR清除上一周期的值
+        if (mask || added || !hlt_period_zero(*base)) {
+            hlt_put_entry(out, prev_id, pit->first, mask, &pit->second, base);
+            num++;
+        }
+        pit++;
+    }
+
+    return num;
+}
+
+void ChunkHealthEncoder::commit() {
+    base_.swap(pending_);
+    pending_.clear();
+}
+
+void ChunkHealthEncoder::reset() {
+    base_.clear();
+    pending_.clear();
+}
+
+int ChunkHealthDecoder::decode(list<chk_hlt_attr_t>& out, const string& in, uint32_t num, bool full, uint64_t ctime) {
+    struct entry_t {
+        uint64_t chk_id;
+        bool removed;
+        chk_hlt_attr_t attr;
+    };
+    vector<entry_t> entries;
+    entries.reserve(num);
+
+    static const chk_hlt_attr_t zero;
+    const char* p = in.data();
+    const char* end = p + in.size();
+    uint64_t chk_id = 0;
+    for (uint32_t i = 0; i < num; i++) {
+        uint64_t delta, mask;
+        if (!varint_get(p, end, delta) || !varint_get(p, end, mask))
+            return RC_WRONG_PARAMETER;
+        if (i > 0 && delta == 0)
+            return RC_WRONG_PARAMETER;
+        chk_id += delta;
+
+        entry_t e;
+        e.chk_id = chk_id;
+        e.removed = mask & CHK_HLT_REMOVED;
+        if (e.removed) {
+            entries.push_back(e);
+            continue;
+        }
+
+        const chk_hlt_attr_t* base = &zero;
+        if (!full) {
+            auto it = base_.find(chk_id);
+            if (it != base_.end())
+                base = &it->second;
+        }
+        e.attr = *base;
+        e.attr.chk_id = chk_id;
+        e.attr.period = health_period_t();
+        e.attr.period.ctime = ctime;
+        for (int f = 0; f < CHK_HLT_FIELD_NUM; f++) {
+            if (!(mask & (1U << f)))
+                continue;
+            uint64_t v;
+            if (!varint_get(p, end, v))
+                return RC_WRONG_PARAMETER;
+            uint64_t b = hlt_field_periodic(f) ? 0 : hlt_field_get(*base, f);
+            hlt_field_set(e.attr, f, b + (uint64_t)zigzag_decode(v));
+        }
+        entries.push_back(e);
+    }
+    if (p != end)
+        return RC_WRONG_PARAMETER;
+
+    // 解码全部成功后才修改基线
+    if (full)
+        base_.clear();
+    for (auto it = entries.begin(); it != entries.end(); it++) {
+        if (it->removed) {
+            base_.erase(it->chk_id);
+            continue;
+        }
+        base_[it->chk_id] = it->attr;
+        out.push_back(it->attr);
+    }
+    return RC_SUCCESS;
+}
+
+} // namespace flame
@@ -0,0 +1,121 @@
+/**
+ * hlt_codec.h
+ * Chunk健康信息的增量编码，用于CSD周期汇报：
+ * 只编码相对基线有变化的Chunk与字段，数值为varint编码的差值；
+ * 周期计数（period中除ctime外的字段）按原值编码，非0时每个周期都会输出，
+ * 汇报中没有出现的Chunk本周期计数为0
+ */
+#ifndef FLAME_COMMON_HLT_CODEC_H
+#define FLAME_COMMON_HLT_CODEC_H
+
+#include "include/meta.h"
+
+#include <cstdint>
+#include <string>
+#include <list>
+#include <map>
+
+namespace flame {
+
+inline void varint_put(std::string& dst, uint64_t v) {
+    while (v >= 0x80) {
+        dst.push_back((char)(v | 0x80));
+        v >>= 7;
+    }
+    dst.push_back((char)v);
+}
+
+inline bool varint_get(const char*& p, const char* end, uint64_t& v) {
+    v = 0;
+    for (int shift = 0; shift < 64 && p < end; shift += 7) {
+        uint8_t b = (uint8_t)*p++;
+        v |= (uint64_t)(b & 0x7f) << shift;
+        if (!(b & 0x80))
+            return true;
+    }
+    return false;
+}
+
+inline uint64_t zigzag_encode(int64_t v) { return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63); }
+inline int64_t zigzag_decode(uint64_t v) { return (int64_t)(v >> 1) ^ -(int64_t)(v & 1); }
+
+/**
+ * @brief 参与增量编码的字段，对应字段掩码中的位
+ * period.ctime 不逐Chunk编码，由汇报中的last_time统一给出
+ */
+enum ChunkHealthField {
+    CHK_HLT_SIZE = 0,
+    CHK_HLT_STAT,
+    CHK_HLT_USED,
+    CHK_HLT_CSD_USED,
+    CHK_HLT_DST_USED,
+    CHK_HLT_WR_CNT,
+    CHK_HLT_RD_CNT,
+    CHK_HLT_LAT,
+    CHK_HLT_ALLOC,
+    CHK_HLT_FIELD_NUM
+};
+
+// Chunk已被删除，从基线中移除
+#define CHK_HLT_REMOVED (1U << 15)
+
+/**
+ * @brief 编码端（CSD），基线为上一次被MGR接受的汇报
+ */
+class ChunkHealthEncoder {
+public:
+    ChunkHealthEncoder() {}
+
+    /**
+     * @brief 生成相对基线的增量
+     *
+     * @param out 编码结果
+     * @param cur 当前所有Chunk的健康信息
+     * @param full 为true时忽略基线，输出全部Chunk
+     * @return uint32_t 编码的Chunk数量
+     */
+    uint32_t encode(std::string& out, const std::list<chk_hlt_attr_t>& cur, bool full);
+
+    /**
+     * @brief 上一次encode的结果已被接受，将其作为新的基线
+     */
+    void commit();
+
+    /**
+     * @brief 丢弃基线，之后只能做全量编码
+     */
+    void reset();
+
+private:
+    std::map<uint64_t, chk_hlt_attr_t> base_;
+    std::map<uint64_t, chk_hlt_attr_t> pending_;
+}; // class ChunkHealthEncoder
+
+/**
+ * @brief 解码端（MGR），每个CSD一个
+ */
+class ChunkHealthDecoder {
+public:
+    ChunkHealthDecoder() {}
+
+    /**
+     * @brief 解码增量并更新基线，解码失败时基线保持不变
+     *
+     * @param out 有变化的Chunk的完整健康信息
+     * @param in 编码数据
+     * @param num 编码的Chunk数量
+     * @param full 是否为全量编码
+     * @param ctime 本次汇报的监控记录时间
+     * @return int RC_SUCCESS | RC_WRONG_PARAMETER
+     */
+    int decode(std::list<chk_hlt_attr_t>& out, const std::string& in, uint32_t num, bool full, uint64_t ctime);
+
+    size_t size() const { return base_.size(); }
+
+private:
+    std::map<uint64_t, chk_hlt_attr_t> base_;
+}; // class ChunkHealthDecoder
+
+} // namespace flame
+
+#endif // FLAME_COMMON_HLT_CODEC_H
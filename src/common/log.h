@@ -94,6 +94,9 @@ public:
             char buff[MAX_LOG_LEN];
             int r = snprintf(buff, MAX_LOG_LEN, "[%s][%s] %s(%d) %s(): ", module, LogDict[level], file, line, func);
             r += snprintf(buff + r, MAX_LOG_LEN - r, fmt, args...);
+            // truncated
+            if (r > MAX_LOG_LEN - 2)
+                r = MAX_LOG_LEN - 2;
             snprintf(buff + r, MAX_LOG_LEN - r, "\n");
             fprintf(fp_, "%s", buff);
             if (imm_flush_) fflush(fp_);
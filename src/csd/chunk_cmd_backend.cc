@@ -0,0 +1,61 @@
+#include "csd/chunk_cmd_backend.h"
+#include "csd/chunk_io_sched.h"
+#include "include/retcode.h"
+
+namespace flame {
+
+struct cmd_io_t {
+    chunk_io_t                  io;
+    ChunkCmdBackend::done_fn_t  cb;
+    void*                       arg;
+};
+
+static void cmd_io_cb(chunk_io_t* io, int rc) {
+    cmd_io_t* cio = (cmd_io_t*)io->cb_arg;
+    ChunkCmdBackend::done_fn_t cb = cio->cb;
+    void* arg = cio->arg;
+    delete cio;
+    cb(arg, rc);
+}
+
+int SchedCmdBackend::submit__(chk_id_t chk_id, uint64_t off, uint32_t len, void* buff, bool write, bool zero,
+uint64_t client_id, done_fn_t cb, void* arg) {
+    std::shared_ptr<ChunkIoScheduler> sched = cct_->sched();
+    if (!sched)
+        return RC_FAILD;
+    cmd_io_t* cio = new cmd_io_t();
+    cio->io.chk_id = chk_id;
+    cio->io.off = off;
+    cio->io.len = len;
+    cio->io.buff = buff;
+    cio->io.write = write;
+    cio->io.zero = zero;
+    cio->io.cb = cmd_io_cb;
+    cio->io.cb_arg = cio;
+    cio->io.client_id = client_id;
+    cio->cb = cb;
+    cio->arg = arg;
+    int r = sched->submit(&cio->io);
+    if (r != RC_SUCCESS)
+        delete cio;
+    return r;
+}
+
+int SchedCmdBackend::read(chk_id_t chk_id, uint64_t off, uint32_t len, void* buff, uint64_t client_id, done_fn_t cb, void* arg) {
+    return submit__(chk_id, off, len, buff, false, false, client_id, cb, arg);
+}
+
+int SchedCmdBackend::write(chk_id_t chk_id, uint64_t off, uint32_t len, void* buff, uint64_t client_id, done_fn_t cb, void* arg) {
+    return submit__(chk_id, off, len, buff, true, false, client_id, cb, arg);
+}
+
+int SchedCmdBackend::write_zeros(chk_id_t chk_id, uint64_t off, uint32_t len, uint64_t client_id, done_fn_t cb, void* arg) {
+    return submit__(chk_id, off, len, nullptr, true, true, client_id, cb, arg);
+}
+
+bool SchedCmdBackend::is_zero(chk_id_t chk_id, uint64_t off, uint32_t len) {
+    std::shared_ptr<ChunkIoScheduler> sched = cct_->sched();
+    return sched && sched->is_zero(chk_id, off, len);
+}
+
+} // namespace flame
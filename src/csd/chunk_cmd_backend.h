@@ -0,0 +1,37 @@
+#ifndef FLAME_CSD_CHUNK_CMD_BACKEND_H
+#define FLAME_CSD_CHUNK_CMD_BACKEND_H
+
+#include "csd/csd_context.h"
+#include "libflame/libchunk/chunk_cmd_service.h"
+
+namespace flame {
+
+/**
+ * @brief libchunk命令服务的后端（运行在CSD）
+ * 读、写、清零命令都经过ChunkIoScheduler下发到ChunkStore，
+ * 因此也经过QoS、迁移的写跟踪与健康信息统计
+ */
+class SchedCmdBackend final : public ChunkCmdBackend {
+public:
+    SchedCmdBackend(CsdContext* cct) : cct_(cct) {}
+
+    ~SchedCmdBackend() {}
+
+    virtual int read(chk_id_t chk_id, uint64_t off, uint32_t len, void* buff, uint64_t client_id, done_fn_t cb, void* arg) override;
+
+    virtual int write(chk_id_t chk_id, uint64_t off, uint32_t len, void* buff, uint64_t client_id, done_fn_t cb, void* arg) override;
+
+    virtual int write_zeros(chk_id_t chk_id, uint64_t off, uint32_t len, uint64_t client_id, done_fn_t cb, void* arg) override;
+
+    virtual bool is_zero(chk_id_t chk_id, uint64_t off, uint32_t len) override;
+
+private:
+    CsdContext* cct_;
+
+    int submit__(chk_id_t chk_id, uint64_t off, uint32_t len, void* buff, bool write, bool zero,
+        uint64_t client_id, done_fn_t cb, void* arg);
+}; // class SchedCmdBackend
+
+} // namespace flame
+
+#endif // FLAME_CSD_CHUNK_CMD_BACKEND_H
@@ -0,0 +1,97 @@
+#include "csd/chunk_health.h"
+#include "chunkstore/chunkstore.h"
+#include "include/retcode.h"
+
+#include "csd/log_csd.h"
+
+using namespace std;
+
+namespace flame {
+
+void ChunkHealthTracker::chunk_add(uint64_t chk_id, uint64_t size) {
+    WriteLocker locker(lock_);
+    unique_ptr<chk_counter_t>& cnt = chks_[chk_id];
+    if (!cnt) {
+        cnt.reset(new chk_counter_t());
+        alloc_ += size;
+    }
+    cnt->size = size;
+}
+
+void ChunkHealthTracker::chunk_remove(uint64_t chk_id) {
+    WriteLocker locker(lock_);
+    chks_.erase(chk_id);
+}
+
+void ChunkHealthTracker::io_done(uint64_t chk_id, bool write, uint64_t len, uint64_t lat) {
+    {
+        ReadLocker locker(lock_);
+        auto it = chks_.find(chk_id);
+        if (it != chks_.end()) {
+            chk_counter_t* cnt = it->second.get();
+            (write ? cnt->wr_cnt : cnt->rd_cnt) += (len + 4095) >> 12;
+            cnt->io_cnt++;
+            cnt->lat_sum += lat;
+            return;
+        }
+    }
+
+    // 首次出现的Chunk，打开一次以获取大小
+    uint64_t size = 0;
+    shared_ptr<Chunk> chk = cct_->cs()->chunk_open(chk_id);
+    if (chk)
+        size = chk->size();
+
+    WriteLocker locker(lock_);
+    unique_ptr<chk_counter_t>& cnt = chks_[chk_id];
+    if (!cnt) {
+        cnt.reset(new chk_counter_t());
+        cnt->size = size;
+    }
+    (write ? cnt->wr_cnt : cnt->rd_cnt) += (len + 4095) >> 12;
+    cnt->io_cnt++;
+    cnt->lat_sum += lat;
+}
+
+void ChunkHealthTracker::collect(csd_hlt_attr_t& hlt, uint64_t now) {
+    csd_hlt_sub_t& sub = hlt.csd_hlt_sub;
+    sub.csd_id = cct_->csd_id();
+    sub.size = 0;
+    sub.used = 0;
+    sub.alloced = 0;
+    sub.period = health_period_t();
+    sub.period.ctime = now;
+
+    cs_info_t info;
+    if (cct_->cs()->get_info(info) == RC_SUCCESS) {
+        sub.size = info.size;
+        sub.used = info.used;
+    }
+
+    uint64_t io_cnt = 0, lat_sum = 0;
+    ReadLocker locker(lock_);
+    for (auto it = chks_.begin(); it != chks_.end(); it++) {
+        chk_counter_t* cnt = it->second.get();
+        chk_hlt_attr_t chk;
+        chk.chk_id = it->first;
+        chk.size = cnt->size;
+        chk.stat = CHK_STAT_CREATED;
+        chk.period.ctime = now;
+        chk.period.wr_cnt = cnt->wr_cnt.exchange(0);
+        chk.period.rd_cnt = cnt->rd_cnt.exchange(0);
+        uint64_t n = cnt->io_cnt.exchange(0);
+        uint64_t l = cnt->lat_sum.exchange(0);
+        chk.period.lat = n ? l / n : 0;
+        hlt.chk_hlt_list.push_back(chk);
+
+        sub.alloced += cnt->size;
+        sub.period.wr_cnt += chk.period.wr_cnt;
+        sub.period.rd_cnt += chk.period.rd_cnt;
+        io_cnt += n;
+        lat_sum += l;
+    }
+    sub.period.lat = io_cnt ? lat_sum / io_cnt : 0;
+    sub.period.alloc = alloc_.exchange(0);
+}
+
+} // namespace flame
@@ -0,0 +1,77 @@
+#ifndef FLAME_CSD_CHUNK_HEALTH_H
+#define FLAME_CSD_CHUNK_HEALTH_H
+
+#include "csd/csd_context.h"
+#include "include/internal.h"
+#include "common/thread/rw_lock.h"
+
+#include <cstdint>
+#include <atomic>
+#include <memory>
+#include <map>
+
+namespace flame {
+
+/**
+ * @brief Chunk健康信息统计（运行在CSD）
+ * IO路径只在读锁下做原子累加；周期汇报时取出本周期的计数并清零
+ */
+class ChunkHealthTracker final {
+public:
+    ChunkHealthTracker(CsdContext* cct) : cct_(cct) {}
+
+    ~ChunkHealthTracker() {}
+
+    /**
+     * @brief Chunk创建（或迁入）后调用
+     *
+     * @param chk_id
+     * @param size
+     */
+    void chunk_add(uint64_t chk_id, uint64_t size);
+
+    /**
+     * @brief Chunk删除（或迁出）后调用
+     *
+     * @param chk_id
+     */
+    void chunk_remove(uint64_t chk_id);
+
+    /**
+     * @brief IO完成后调用（IO路径）
+     * 首次出现的Chunk（如CSD重启前创建的）会被自动加入统计
+     *
+     * @param chk_id
+     * @param write 是否为写
+     * @param len (B)
+     * @param lat (ns)
+     */
+    void io_done(uint64_t chk_id, bool write, uint64_t len, uint64_t lat);
+
+    /**
+     * @brief 取出本周期的健康信息，并开始新的统计周期
+     *
+     * @param hlt
+     * @param now 本周期的监控记录时间 (us)
+     */
+    void collect(csd_hlt_attr_t& hlt, uint64_t now);
+
+private:
+    struct chk_counter_t {
+        uint64_t                size    {0};
+        std::atomic<uint64_t>   wr_cnt  {0};    // unit: 4KB page
+        std::atomic<uint64_t>   rd_cnt  {0};    // unit: 4KB page
+        std::atomic<uint64_t>   io_cnt  {0};
+        std::atomic<uint64_t>   lat_sum {0};    // (ns)
+    };
+
+    CsdContext* cct_;
+
+    RWLock lock_;
+    std::map<uint64_t, std::unique_ptr<chk_counter_t>> chks_;
+    std::atomic<uint64_t> alloc_ {0};   // 本周期新分配的空间（B）
+}; // class ChunkHealthTracker
+
+} // namespace flame
+
+#endif // FLAME_CSD_CHUNK_HEALTH_H
@@ -0,0 +1,512 @@
+#include "csd/chunk_io_sched.h"
+#include "csd/chunk_migrator.h"
+#include "csd/chunk_health.h"
+#include "include/retcode.h"
+#include "include/meta.h"
+#include "util/utime.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+#include "csd/log_csd.h"
+
+// 一批最多包含的IO数
+#define CHK_SCHED_MAX_BATCH     64
+// 合并缓冲区对齐（满足O_DIRECT要求）
+#define CHK_SCHED_BUFF_ALIGN    4096
+
+using namespace std;
+
+namespace flame {
+
+ChunkIoScheduler::ChunkIoScheduler(CsdContext* cct, uint64_t window, uint64_t max_merge, uint32_t depth)
+: WorkerBase("chunk_io_sched"), cct_(cct), window_ns_(window * 1000), max_merge_(max_merge),
+  depth_(depth ? depth : 1), quantum_(max_merge ? max_merge : 1), cond_(mutex_) {
+}
+
+void ChunkIoScheduler::entry() {
+    while (can_run_.load()) {
+        {
+            MutexLocker locker(mutex_);
+            uint64_t now = utime_t::now().to_nsec();
+            uint64_t next = now + 100000000ULL;    // 没有合并窗口时100ms检查一次退出
+            for (auto it = window_.begin(); it != window_.end(); it++)
+                next = min(next, (*it)->ready_ns);
+            next = min(next, qos_.next_ns());
+            if (next > now)
+                cond_.wait_interval(utime_t::get_by_nsec(next - now));
+        }
+        kick__();
+    }
+}
+
+void ChunkIoScheduler::stop() {
+    can_run_.store(false);
+    {
+        MutexLocker locker(mutex_);
+        cond_.broadcast();
+    }
+    join();
+
+    // 在QoS中排队的IO不会再被放行，以失败完成
+    vector<chunk_io_t*> ios;
+    {
+        MutexLocker locker(mutex_);
+        qos_.drain(ios);
+        for (auto it = ios.begin(); it != ios.end(); it++) {
+            auto cit = chunks_.find((*it)->chk_id);
+            if (cit == chunks_.end())
+                continue;
+            cit->second->deferred--;
+            try_release__(cit->second.get());
+        }
+    }
+    if (!ios.empty())
+        cct_->log()->lwarn("chunk io scheduler stopped with %zu throttled io", ios.size());
+    for (auto it = ios.begin(); it != ios.end(); it++)
+        (*it)->cb(*it, RC_FAILD);
+}
+
+int ChunkIoScheduler::submit(chunk_io_t* io) {
+    uint64_t now = utime_t::now().to_nsec();
+    io->enqueue_ns = now;
+    if (!io->write)
+        io->zero = false;
+
+    shared_ptr<Chunk> chk;
+    {
+        MutexLocker locker(mutex_);
+        auto it = chunks_.find(io->chk_id);
+        if (it != chunks_.end() && !it->second->removed)
+            chk = it->second->chk;
+    }
+    if (!chk) {
+        // 打开Chunk可能较慢，不持锁
+        chk = cct_->cs()->chunk_open(io->chk_id);
+        if (!chk)
+            return RC_OBJ_NOT_FOUND;
+    }
+
+    {
+        MutexLocker locker(mutex_);
+        // 停止后不再接受IO，否则可能进入QoS队列而不会完成
+        if (!can_run_.load())
+            return RC_FAILD;
+        auto it = chunks_.find(io->chk_id);
+        ChunkQueue* cq;
+        if (it == chunks_.end()) {
+            cq = new ChunkQueue();
+            cq->chk_id = io->chk_id;
+            cq->vol_id = chunk_id_t(io->chk_id).get_vol_id();
+            cq->chk = chk;
+            chunks_[io->chk_id].reset(cq);
+        } else {
+            cq = it->second.get();
+            if (cq->removed) {
+                // 删除后又以相同的ID创建（如迁回），使用新打开的句柄
+                cq->chk = chk;
+                cq->removed = false;
+            }
+        }
+
+        if (!qos_.admit(io, now)) {
+            // 超过QoS上限，令牌恢复后由pick__()入队
+            cq->deferred++;
+            cond_.signal();
+            return RC_SUCCESS;
+        }
+        enqueue__(cq, io, now);
+    }
+
+    kick__();
+    return RC_SUCCESS;
+}
+
+void ChunkIoScheduler::enqueue__(ChunkQueue* cq, chunk_io_t* io, uint64_t now) {
+    io->seq = seq_++;
+    cq->queue.push_back(io);
+    if (cq->stat == CQ_IDLE) {
+        if (window_ns_ == 0) {
+            make_ready__(cq);
+        } else {
+            cq->stat = CQ_WINDOW;
+            cq->ready_ns = now + window_ns_;
+            window_.push_back(cq);
+            cond_.signal();
+        }
+    } else if (cq->stat == CQ_WINDOW && cq->queue.size() >= CHK_SCHED_MAX_BATCH) {
+        // 已经攒够一批，不必等窗口结束
+        cq->ready_ns = 0;
+    }
+}
+
+void ChunkIoScheduler::chunk_remove(uint64_t chk_id) {
+    MutexLocker locker(mutex_);
+    auto it = chunks_.find(chk_id);
+    if (it == chunks_.end())
+        return;
+    it->second->removed = true;
+    try_release__(it->second.get());
+}
+
+void ChunkIoScheduler::try_release__(ChunkQueue* cq) {
+    if (cq->removed && cq->stat == CQ_IDLE && cq->deferred == 0)
+        chunks_.erase(cq->chk_id);
+}
+
+bool ChunkIoScheduler::removed__(ChunkQueue* cq) {
+    MutexLocker locker(mutex_);
+    return cq->removed;
+}
+
+bool ChunkIoScheduler::is_zero(uint64_t chk_id, uint64_t off, uint64_t len) {
+    shared_ptr<Chunk> chk;
+    {
+        MutexLocker locker(mutex_);
+        auto it = chunks_.find(chk_id);
+        if (it != chunks_.end() && !it->second->removed)
+            chk = it->second->chk;
+    }
+    if (!chk)
+        chk = cct_->cs()->chunk_open(chk_id);
+    return chk && chk->is_zero(off, len);
+}
+
+void ChunkIoScheduler::collect(chunk_sched_stat_t& stat) {
+    MutexLocker locker(mutex_);
+    stat = stat_;
+    stat.zero_rd = zero_rd_.exchange(0);
+    stat_ = chunk_sched_stat_t();
+}
+
+void ChunkIoScheduler::qos_set(const list<qos_attr_t>& attr_list) {
+    {
+        MutexLocker locker(mutex_);
+        uint64_t now = utime_t::now().to_nsec();
+        for (auto it = attr_list.begin(); it != attr_list.end(); it++)
+            qos_.set(*it, now);
+        cond_.signal();
+    }
+    kick__();
+}
+
+void ChunkIoScheduler::qos_collect(list<chunk_qos_stat_t>& res) {
+    MutexLocker locker(mutex_);
+    qos_.collect(res);
+}
+
+void ChunkIoScheduler::make_ready__(ChunkQueue* cq) {
+    cq->stat = CQ_READY;
+    VolQueue& vol = vols_[cq->vol_id];
+    vol.ready.push_back(cq);
+    if (!vol.active) {
+        vol.active = true;
+        active_vols_.push_back(cq->vol_id);
+    }
+}
+
+void ChunkIoScheduler::pick__(uint64_t now, vector<IoBatch*>& batches) {
+    for (auto it = window_.begin(); it != window_.end(); ) {
+        if ((*it)->ready_ns <= now) {
+            make_ready__(*it);
+            it = window_.erase(it);
+        } else {
+            it++;
+        }
+    }
+
+    vector<chunk_io_t*> released;
+    qos_.release(now, released);
+    for (auto it = released.begin(); it != released.end(); it++) {
+        ChunkQueue* cq = chunks_[(*it)->chk_id].get();
+        cq->deferred--;
+        // 队列等待时间不含被限流的时间
+        (*it)->enqueue_ns = now;
+        enqueue__(cq, *it, now);
+    }
+
+    // 未达到预留IOPS的卷优先下发，不消耗差额
+    if (qos_.has_reservation()) {
+        for (auto it = active_vols_.begin(); it != active_vols_.end() && inflight_ < depth_; ) {
+            uint64_t vol_id = *it;
+            if (!qos_.reserve_ready(vol_id, now)) {
+                it++;
+                continue;
+            }
+            VolQueue& vol = vols_[vol_id];
+            IoBatch* batch = dispatch__(vol_id, vol);
+            qos_.reserve_take(vol_id, batch->io_cnt);
+            batches.push_back(batch);
+            if (vol.ready.empty()) {
+                vol.active = false;
+                it = active_vols_.erase(it);
+            } else {
+                it++;
+            }
+        }
+    }
+
+    // 卷之间按字节做差额轮询，卷内的Chunk按就绪顺序轮转
+    while (inflight_ < depth_ && !active_vols_.empty()) {
+        uint64_t vol_id = active_vols_.front();
+        active_vols_.pop_front();
+        VolQueue& vol = vols_[vol_id];
+        if (vol.deficit <= 0) {
+            vol.deficit += quantum_ * qos_.weight(vol_id);
+            active_vols_.push_back(vol_id);
+            continue;
+        }
+
+        IoBatch* batch = dispatch__(vol_id, vol);
+        vol.deficit -= batch->bytes;
+        batches.push_back(batch);
+
+        if (!vol.ready.empty()) {
+            active_vols_.push_back(vol_id);
+        } else {
+            vol.active = false;
+            if (vol.deficit > 0)
+                vol.deficit = 0;
+        }
+    }
+}
+
+ChunkIoScheduler::IoBatch* ChunkIoScheduler::dispatch__(uint64_t vol_id, VolQueue& vol) {
+    ChunkQueue* cq = vol.ready.front();
+    vol.ready.pop_front();
+    IoBatch* batch = build_batch__(cq);
+    cq->stat = CQ_BUSY;
+    inflight_++;
+    return batch;
+}
+
+ChunkIoScheduler::IoBatch* ChunkIoScheduler::build_batch__(ChunkQueue* cq) {
+    IoBatch* batch = new IoBatch();
+    batch->sched = this;
+    batch->cq = cq;
+    batch->write = cq->queue.front()->write;
+    batch->zero = batch->write && cq->queue.front()->zero;
+
+    uint64_t now = utime_t::now().to_nsec();
+    vector<chunk_io_t*> ios;
+    while (!cq->queue.empty() && ios.size() < CHK_SCHED_MAX_BATCH) {
+        chunk_io_t* io = cq->queue.front();
+        if (io->write != batch->write || (batch->write && io->zero != batch->zero))
+            break;
+        cq->queue.pop_front();
+        batch->bytes += io->len;
+        batch->io_cnt++;
+        record__(now, io);
+        ios.push_back(io);
+    }
+    build_extents__(batch, ios);
+    stat_.issue_cnt += batch->extents.size();
+    return batch;
+}
+
+static bool io_off_less(const chunk_io_t* a, const chunk_io_t* b) {
+    return a->off < b->off || (a->off == b->off && a->seq < b->seq);
+}
+
+static bool io_seq_less(const chunk_io_t* a, const chunk_io_t* b) {
+    return a->seq < b->seq;
+}
+
+void ChunkIoScheduler::build_extents__(IoBatch* batch, vector<chunk_io_t*>& ios) {
+    sort(ios.begin(), ios.end(), io_off_less);
+    for (auto it = ios.begin(); it != ios.end(); it++) {
+        chunk_io_t* io = *it;
+        if (!batch->extents.empty()) {
+            IoExtent& last = batch->extents.back();
+            uint64_t end = last.off + last.len;
+            // 重叠的IO必须合并，否则同一批内的写会乱序；相邻的IO受合并长度限制（清零不传数据，不受限）
+            if (io->off < end || (io->off == end && (batch->zero || last.len + io->len <= max_merge_))) {
+                if (io->off + io->len > end)
+                    last.len = io->off + io->len - last.off;
+                last.ios.push_back(io);
+                continue;
+            }
+        }
+        IoExtent ext;
+        ext.batch = batch;
+        ext.off = io->off;
+        ext.len = io->len;
+        ext.buff = batch->zero ? nullptr : (char*)io->buff;
+        ext.own = false;
+        ext.ios.push_back(io);
+        batch->extents.push_back(ext);
+    }
+
+    for (auto it = batch->extents.begin(); it != batch->extents.end(); it++) {
+        IoExtent& ext = *it;
+        if (ext.ios.size() == 1 || batch->zero)
+            continue;
+        void* buff = nullptr;
+        if (posix_memalign(&buff, CHK_SCHED_BUFF_ALIGN, ext.len) != 0) {
+            ext.buff = nullptr;
+            ext.rc = RC_FAILD;
+            continue;
+        }
+        ext.buff = (char*)buff;
+        ext.own = true;
+        if (!batch->write)
+            continue;
+        // 重叠部分以后到达的写为准
+        sort(ext.ios.begin(), ext.ios.end(), io_seq_less);
+        for (auto io = ext.ios.begin(); io != ext.ios.end(); io++)
+            memcpy(ext.buff + ((*io)->off - ext.off), (*io)->buff, (*io)->len);
+    }
+}
+
+void ChunkIoScheduler::kick__() {
+    // 同步完成的ChunkStore会在下发过程中再次进入，此时只做标记，由最外层循环处理
+    static thread_local bool kicking = false;
+    static thread_local bool again = false;
+    if (kicking) {
+        again = true;
+        return;
+    }
+    kicking = true;
+    do {
+        again = false;
+        vector<IoBatch*> batches;
+        {
+            MutexLocker locker(mutex_);
+            pick__(utime_t::now().to_nsec(), batches);
+        }
+        for (auto it = batches.begin(); it != batches.end(); it++)
+            issue__(*it);
+    } while (again);
+    kicking = false;
+}
+
+void ChunkIoScheduler::issue__(IoBatch* batch) {
+    // 多计一次，保证下发过程中batch不会被释放
+    batch->pending.store(batch->extents.size() + 1);
+    for (auto it = batch->extents.begin(); it != batch->extents.end(); it++)
+        issue_ext__(&(*it));
+    if (batch->pending.fetch_sub(1) == 1)
+        batch_done__(batch);
+}
+
+void ChunkIoScheduler::issue_ext__(IoExtent* ext) {
+    IoBatch* batch = ext->batch;
+    ChunkQueue* cq = batch->cq;
+    if (ext->rc != RC_SUCCESS) {
+        complete__(ext);
+        return;
+    }
+    int r;
+    if (batch->write) {
+        if (cct_->migrator()) {
+            int mr = cct_->migrator()->write_begin(cq->chk_id, ext->off, ext->len, resume_cb__, ext);
+            if (mr == MIG_WRITE_DEFERRED)
+                return;
+            if (mr == MIG_WRITE_MOVED) {
+                ext->rc = RC_OBJ_NOT_FOUND;
+                complete__(ext);
+                return;
+            }
+            ext->begun = true;
+        }
+        // write_begin()之后检查：迁移任务释放前本地Chunk已标记删除
+        if (removed__(cq)) {
+            ext->rc = RC_OBJ_NOT_FOUND;
+            complete__(ext);
+            return;
+        }
+        if (batch->zero)
+            r = cq->chk->write_zeros_async(ext->off, ext->len, extent_cb__, ext);
+        else
+            r = cq->chk->write_async(ext->buff, ext->off, ext->len, extent_cb__, ext);
+    } else if (cq->chk->is_zero(ext->off, ext->len)) {
+        ext->zero = true;
+        zero_rd_++;
+        complete__(ext);
+        return;
+    } else {
+        r = cq->chk->read_async(ext->buff, ext->off, ext->len, extent_cb__, ext);
+    }
+    if (r != RC_SUCCESS) {
+        cct_->log()->lerror("chunk (%llu) %s async faild: %d", cq->chk_id,
+            batch->zero ? "write zeros" : (batch->write ? "write" : "read"), r);
+        ext->rc = RC_FAILD;
+        complete__(ext);
+    }
+}
+
+void ChunkIoScheduler::extent_cb__(void* arg) {
+    IoExtent* ext = (IoExtent*)arg;
+    ext->batch->sched->complete__(ext);
+}
+
+void ChunkIoScheduler::resume_cb__(void* arg) {
+    IoExtent* ext = (IoExtent*)arg;
+    ext->batch->sched->issue_ext__(ext);
+}
+
+void ChunkIoScheduler::complete__(IoExtent* ext) {
+    IoBatch* batch = ext->batch;
+    ChunkQueue* cq = batch->cq;
+    if (ext->begun)
+        cct_->migrator()->write_end(cq->chk_id, ext->off, ext->len);
+    if (ext->zero) {
+        for (auto it = ext->ios.begin(); it != ext->ios.end(); it++) {
+            memset((*it)->buff, 0, (*it)->len);
+            (*it)->zero = true;
+        }
+    } else if (ext->own && !batch->write && ext->rc == RC_SUCCESS) {
+        for (auto it = ext->ios.begin(); it != ext->ios.end(); it++)
+            memcpy((*it)->buff, ext->buff + ((*it)->off - ext->off), (*it)->len);
+    }
+    if (ext->own) {
+        free(ext->buff);
+        ext->buff = nullptr;
+    }
+
+    uint64_t now = utime_t::now().to_nsec();
+    shared_ptr<ChunkHealthTracker> hlt = cct_->hlt();
+    for (auto it = ext->ios.begin(); it != ext->ios.end(); it++) {
+        chunk_io_t* io = *it;
+        if (hlt && ext->rc == RC_SUCCESS)
+            hlt->io_done(io->chk_id, io->write, io->len, now - io->enqueue_ns);
+        io->cb(io, ext->rc);
+    }
+
+    if (batch->pending.fetch_sub(1) == 1)
+        batch_done__(batch);
+}
+
+void ChunkIoScheduler::batch_done__(IoBatch* batch) {
+    {
+        MutexLocker locker(mutex_);
+        ChunkQueue* cq = batch->cq;
+        inflight_--;
+        // 在途期间到达的IO直接组成下一批，不再等合并窗口
+        if (cq->queue.empty()) {
+            cq->stat = CQ_IDLE;
+            try_release__(cq);
+        } else {
+            make_ready__(cq);
+        }
+    }
+    delete batch;
+    kick__();
+}
+
+void ChunkIoScheduler::record__(uint64_t now, const chunk_io_t* io) {
+    uint64_t wait = now > io->enqueue_ns ? (now - io->enqueue_ns) / 1000 : 0;
+    stat_.io_cnt++;
+    stat_.wait_sum += wait;
+    if (wait > stat_.wait_max)
+        stat_.wait_max = wait;
+    int i = 0;
+    while (wait >>= 1)
+        i++;
+    if (i >= CHK_SCHED_WAIT_BUCKETS)
+        i = CHK_SCHED_WAIT_BUCKETS - 1;
+    stat_.wait_hist[i]++;
+}
+
+} // namespace flame
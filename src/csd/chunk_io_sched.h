@@ -0,0 +1,266 @@
+#ifndef FLAME_CSD_CHUNK_IO_SCHED_H
+#define FLAME_CSD_CHUNK_IO_SCHED_H
+
+#include "csd/csd_context.h"
+#include "csd/chunk_qos.h"
+#include "chunkstore/chunkstore.h"
+#include "work/work_base.h"
+#include "common/thread/mutex.h"
+#include "common/thread/cond.h"
+
+#include <cstdint>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <deque>
+#include <list>
+#include <map>
+
+// 队列等待时间直方图，第i个桶: [2^i, 2^(i+1)) us
+#define CHK_SCHED_WAIT_BUCKETS  24
+
+namespace flame {
+
+struct chunk_io_t;
+
+/**
+ * @brief IO完成回调
+ * @param io
+ * @param rc RC_SUCCESS | RC_FAILD | RC_OBJ_NOT_FOUND(Chunk不存在或已迁出)
+ */
+typedef void (*chunk_io_cb_t)(chunk_io_t* io, int rc);
+
+/**
+ * @brief 提交给调度器的一个IO，由调用者分配，回调之前不能释放
+ */
+struct chunk_io_t {
+    uint64_t        chk_id;
+    uint64_t        off;
+    uint64_t        len;
+    void*           buff;
+    bool            write;
+    bool            zero;           // 写：清零(buff被忽略)；读：完成时置位，表示区间未分配，buff已填0
+    chunk_io_cb_t   cb;
+    void*           cb_arg;
+    uint64_t        client_id;      // 发起IO的客户端(gw_id)，0表示未知
+
+    uint64_t        enqueue_ns;     // 调度器内部使用
+    uint64_t        seq;
+};
+
+struct chunk_sched_stat_t {
+    uint64_t io_cnt         {0};    // 下发的IO请求数
+    uint64_t issue_cnt      {0};    // 实际下发到ChunkStore的IO数
+    uint64_t wait_sum       {0};    // 队列等待时间之和 (us)
+    uint64_t wait_max       {0};    // (us)
+    uint64_t wait_hist[CHK_SCHED_WAIT_BUCKETS] {};
+    uint64_t zero_rd        {0};    // 区间未分配、跳过设备IO的读
+
+    /**
+     * @brief 合并率：被合并掉的IO占比
+     */
+    double merge_rate() const { return io_cnt ? 1.0 - (double)issue_cnt / io_cnt : 0; }
+    uint64_t wait_avg() const { return io_cnt ? wait_sum / io_cnt : 0; }
+}; // struct chunk_sched_stat_t
+
+/**
+ * @brief Chunk IO调度器（运行在CSD，位于命令服务与ChunkStore之间）
+ *  1. 每个Chunk一个队列，同一时刻每个Chunk只有一批IO在途。
+ *     在途期间到达的IO，以及空闲Chunk上合并窗口内到达的IO，组成下一批；
+ *  2. 一批只包含连续到达的同方向IO（读写之间不重排），批内按偏移排序，
+ *     相邻或重叠的IO合并为一个IO下发；重叠的写按到达顺序覆盖；
+ *  3. 可下发的Chunk按卷轮转，卷内按字节做差额轮询(DRR)，
+ *     总的在途批数受depth限制，单个热点Chunk不会占满设备；
+ *  4. 入队前经过ChunkQos：超过卷/客户端上限的IO排队等待令牌，
+ *     未达到预留IOPS的卷优先下发，DRR的份额按卷的权重放大；
+ *  5. 清零写不携带数据，相邻的清零写不受合并长度限制，通过write_zeros_async()下发；
+ *     读未分配的区间时不下发设备IO，直接填0完成。
+ */
+class ChunkIoScheduler final : public WorkerBase {
+public:
+    /**
+     * @param window 合并窗口 (us)，0表示空闲Chunk上的IO立即下发
+     * @param max_merge 合并后单个IO的最大长度 (B)
+     * @param depth 最多在途的批数
+     */
+    ChunkIoScheduler(CsdContext* cct, uint64_t window, uint64_t max_merge, uint32_t depth);
+
+    ~ChunkIoScheduler() {}
+
+    virtual void entry() override;
+
+    /**
+     * @brief 停止调度线程，在QoS中排队的IO以RC_FAILD回调
+     */
+    void stop();
+
+    /**
+     * @brief 提交IO，完成后回调
+     *
+     * @param io
+     * @return int RC_SUCCESS | RC_OBJ_NOT_FOUND(Chunk不存在，不会回调) | RC_FAILD(调度器已停止，不会回调)
+     */
+    int submit(chunk_io_t* io);
+
+    /**
+     * @brief Chunk删除（或迁出）后调用，释放队列持有的Chunk句柄
+     * 队列中还有IO时，等这些IO完成后再释放
+     *
+     * @param chk_id
+     */
+    void chunk_remove(uint64_t chk_id);
+
+    /**
+     * @brief 区间是否未分配（读到的必然是0）
+     *
+     * @return true 未分配；Chunk不存在时返回false
+     */
+    bool is_zero(uint64_t chk_id, uint64_t off, uint64_t len);
+
+    /**
+     * @brief 取出本周期的统计，并开始新的统计周期
+     *
+     * @param stat
+     */
+    void collect(chunk_sched_stat_t& stat);
+
+    /**
+     * @brief 设置卷/客户端的QoS（由MGR推送）
+     *
+     * @param attr_list
+     */
+    void qos_set(const std::list<qos_attr_t>& attr_list);
+
+    /**
+     * @brief 取出本周期各QoS对象的限流统计
+     *
+     * @param res
+     */
+    void qos_collect(std::list<chunk_qos_stat_t>& res);
+
+private:
+    enum QueueStat {
+        CQ_IDLE     = 0,    // 无排队IO
+        CQ_WINDOW   = 1,    // 等待合并窗口结束
+        CQ_READY    = 2,    // 在卷的就绪队列中
+        CQ_BUSY     = 3     // 有一批IO在途
+    };
+
+    struct ChunkQueue;
+
+    struct IoBatch;
+
+    struct IoExtent {
+        IoBatch*                    batch;
+        uint64_t                    off;
+        uint64_t                    len;
+        char*                       buff;
+        bool                        own;    // buff是否为合并分配的缓冲
+        bool                        begun   {false};    // 已调用migrator的write_begin()
+        bool                        zero    {false};    // 读的区间未分配，没有下发
+        std::vector<chunk_io_t*>    ios;
+        int                         rc      {0};
+    };
+
+    struct IoBatch {
+        ChunkIoScheduler*           sched;
+        ChunkQueue*                 cq;
+        bool                        write;
+        bool                        zero    {false};    // 清零写
+        uint64_t                    bytes   {0};
+        uint32_t                    io_cnt  {0};
+        std::vector<IoExtent>       extents;
+        std::atomic<uint32_t>       pending {0};
+    };
+
+    struct ChunkQueue {
+        uint64_t                    chk_id;
+        uint64_t                    vol_id;
+        std::shared_ptr<Chunk>      chk;
+        std::list<chunk_io_t*>      queue;  // 到达顺序
+        int                         stat    {CQ_IDLE};
+        uint64_t                    ready_ns {0};   // 合并窗口结束的时间
+        uint32_t                    deferred {0};   // 在QoS中排队的IO数
+        bool                        removed {false};    // Chunk已删除，IO完成后释放队列
+    };
+
+    struct VolQueue {
+        std::deque<ChunkQueue*>     ready;
+        int64_t                     deficit {0};
+        bool                        active  {false};
+    };
+
+    CsdContext* cct_;
+    uint64_t window_ns_;
+    uint64_t max_merge_;
+    uint32_t depth_;
+    uint64_t quantum_;
+
+    Mutex mutex_;
+    Cond cond_;
+    std::map<uint64_t, std::unique_ptr<ChunkQueue>> chunks_;
+    std::map<uint64_t, VolQueue> vols_;
+    std::deque<uint64_t> active_vols_;  // 有就绪Chunk的卷，轮转
+    std::list<ChunkQueue*> window_;     // 处于合并窗口的Chunk
+    uint32_t inflight_ {0};
+    uint64_t seq_ {0};
+    std::atomic<bool> can_run_ {true};
+
+    chunk_sched_stat_t stat_;           // 由mutex_保护
+    std::atomic<uint64_t> zero_rd_ {0}; // 在下发路径上累计，collect()时并入stat_
+    ChunkQos qos_;                      // 由mutex_保护
+
+    void enqueue__(ChunkQueue* cq, chunk_io_t* io, uint64_t now);
+
+    void make_ready__(ChunkQueue* cq);
+
+    /**
+     * @brief 已删除的Chunk上没有IO时释放其队列（持有mutex_）
+     */
+    void try_release__(ChunkQueue* cq);
+
+    /**
+     * @brief Chunk是否已删除（不持有mutex_）
+     */
+    bool removed__(ChunkQueue* cq);
+
+    /**
+     * @brief 从卷的就绪队列取出一批（持有mutex_）
+     */
+    IoBatch* dispatch__(uint64_t vol_id, VolQueue& vol);
+
+    /**
+     * @brief 取出可以下发的批（持有mutex_）
+     */
+    void pick__(uint64_t now, std::vector<IoBatch*>& batches);
+
+    IoBatch* build_batch__(ChunkQueue* cq);
+
+    void build_extents__(IoBatch* batch, std::vector<chunk_io_t*>& ios);
+
+    /**
+     * @brief 取出可以下发的批并下发（不持有mutex_）
+     */
+    void kick__();
+
+    void issue__(IoBatch* batch);
+
+    /**
+     * @brief 下发一个区间，迁移最终追赶期间的写入推迟到resume_cb__()再下发
+     */
+    void issue_ext__(IoExtent* ext);
+
+    static void extent_cb__(void* arg);
+
+    static void resume_cb__(void* arg);
+
+    void batch_done__(IoBatch* batch);
+
+    void record__(uint64_t now, const chunk_io_t* io);
+
+    void complete__(IoExtent* ext);
+}; // class ChunkIoScheduler
+
+} // namespace flame
+
+#endif // FLAME_CSD_CHUNK_IO_SCHED_H
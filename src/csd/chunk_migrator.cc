@@ -0,0 +1,366 @@
+#include "csd/chunk_migrator.h"
+#include "csd/chunk_health.h"
+#include "csd/chunk_io_sched.h"
+#include "include/retcode.h"
+#include "util/utime.h"
+
+#include <cstdlib>
+
+#include "csd/log_csd.h"
+
+// 批量拷贝的最大轮数，超过后直接进入最终追赶
+#define MIG_MAX_ROUNDS      8
+// 脏数据段数量不超过该值时进入最终追赶
+#define MIG_CATCHUP_SEGS    4
+// 数据段缓冲区对齐（满足O_DIRECT要求）
+#define MIG_BUFF_ALIGN      4096
+
+using namespace std;
+
+namespace flame {
+
+void ChunkMigrator::entry() {
+    while (can_run_.load()) {
+        shared_ptr<MigrateTask> task;
+        {
+            MutexLocker locker(queue_mutex_);
+            while (queue_.empty() && can_run_.load())
+                queue_cond_.wait_interval(utime_t::get_by_msec(500));
+            if (queue_.empty())
+                continue;
+            task = queue_.front();
+            queue_.pop_front();
+        }
+
+        utime_t start = utime_t::now();
+        int r = run_task__(task);
+        utime_t dur = utime_t::now() - start;
+        if (r == RC_SUCCESS) {
+            cct_->log()->linfo("chunk (%llu) moved from csd (%llu) to csd (%llu) in %llu ms",
+                task->attr.chk_id, task->attr.src_id, task->attr.dst_id, dur.to_msec());
+        } else {
+            cct_->log()->lerror("chunk (%llu) move to csd (%llu) faild: %d",
+                task->attr.chk_id, task->attr.dst_id, r);
+        }
+    }
+}
+
+void ChunkMigrator::stop() {
+    can_run_.store(false);
+    {
+        MutexLocker locker(queue_mutex_);
+        queue_cond_.broadcast();
+    }
+    join();
+}
+
+int ChunkMigrator::submit(const chunk_move_attr_t& attr) {
+    if (attr.src_id != cct_->csd_id() || attr.dst_id == attr.src_id || attr.dst_addr == 0)
+        return RC_WRONG_PARAMETER;
+
+    if (!cct_->cs()->chunk_exist(attr.chk_id))
+        return RC_OBJ_NOT_FOUND;
+
+    shared_ptr<MigrateTask> task(new MigrateTask(attr));
+    {
+        WriteLocker locker(tasks_lock_);
+        if (tasks_.find(attr.chk_id) != tasks_.end())
+            return RC_MULTIPLE_OPERATE;
+        tasks_[attr.chk_id] = task;
+    }
+
+    MutexLocker locker(queue_mutex_);
+    queue_.push_back(task);
+    queue_cond_.signal();
+    return RC_SUCCESS;
+}
+
+int ChunkMigrator::write_begin(uint64_t chk_id, uint64_t off, uint64_t len,
+mig_resume_cb_t resume, void* arg) {
+    shared_ptr<MigrateTask> task = find__(chk_id);
+    if (!task)
+        return MIG_WRITE_OK;
+
+    MutexLocker locker(task->mutex);
+    if (task->stat == MIG_STAT_CATCHUP) {
+        // 不阻塞IO线程，迁移结束后由finish__()回调
+        if (resume)
+            task->deferred.push_back(make_pair(resume, arg));
+        return MIG_WRITE_DEFERRED;
+    }
+
+    if (task->stat == MIG_STAT_DONE)
+        return MIG_WRITE_MOVED;
+
+    task->inflight++;
+    return MIG_WRITE_OK;
+}
+
+void ChunkMigrator::write_end(uint64_t chk_id, uint64_t off, uint64_t len) {
+    shared_ptr<MigrateTask> task = find__(chk_id);
+    if (!task)
+        return;
+
+    bool release = false;
+    {
+        MutexLocker locker(task->mutex);
+        // 写入开始时标记的脏数据段可能被写入完成前的一轮拷贝取走，因此在完成时标记
+        if ((task->stat == MIG_STAT_COPY || task->stat == MIG_STAT_CATCHUP) && len > 0) {
+            uint64_t first = off / seg_size_;
+            uint64_t last = (off + len - 1) / seg_size_;
+            for (uint64_t s = first; s <= last && s < task->dirty.size() * 64; s++) {
+                uint64_t bit = 1ULL << (s % 64);
+                if (!(task->dirty[s / 64] & bit)) {
+                    task->dirty[s / 64] |= bit;
+                    task->dirty_cnt++;
+                }
+            }
+        }
+        if (task->inflight > 0 && --task->inflight == 0) {
+            task->cond.broadcast();
+            release = task->released;
+        }
+    }
+    if (release)
+        erase__(task);
+}
+
+bool ChunkMigrator::is_moving(uint64_t chk_id) {
+    return find__(chk_id).get() != nullptr;
+}
+
+shared_ptr<ChunkMigrator::MigrateTask> ChunkMigrator::find__(uint64_t chk_id) {
+    ReadLocker locker(tasks_lock_);
+    auto it = tasks_.find(chk_id);
+    if (it == tasks_.end())
+        return nullptr;
+    return it->second;
+}
+
+int ChunkMigrator::run_task__(const shared_ptr<MigrateTask>& task) {
+    int r;
+    const chunk_move_attr_t& attr = task->attr;
+
+    task->chk = cct_->cs()->chunk_open(attr.chk_id);
+    if (!task->chk || task->chk->get_info(task->info) != RC_SUCCESS) {
+        finish__(task, MIG_STAT_FAILD);
+        return RC_OBJ_NOT_FOUND;
+    }
+
+    shared_ptr<CsdsClient> stub = csds_foctory_->make_csds_client(attr.dst_addr);
+    if (!stub) {
+        finish__(task, MIG_STAT_FAILD);
+        return RC_FAILD;
+    }
+
+    // 在目标CSD上创建相同属性的Chunk
+    chk_attr_t chk_attr;
+    chk_attr.spolicy = task->info.spolicy;
+    chk_attr.flags = task->info.flags;
+    chk_attr.size = task->info.size;
+    list<chunk_bulk_res_t> res;
+    list<uint64_t> chk_ids {attr.chk_id};
+    r = stub->chunk_create(res, chk_attr, chk_ids);
+    if (r != RC_SUCCESS || res.empty() || (res.front().res != RC_SUCCESS && res.front().res != RC_OBJ_EXISTED)) {
+        cct_->log()->lerror("create chunk (%llu) on dst csd (%llu) faild", attr.chk_id, attr.dst_id);
+        finish__(task, MIG_STAT_FAILD);
+        return RC_FAILD;
+    }
+
+    // 从此刻开始记录脏数据段，第一轮拷贝全部数据段
+    uint64_t seg_num = (task->info.size + seg_size_ - 1) / seg_size_;
+    {
+        MutexLocker locker(task->mutex);
+        task->dirty.assign((seg_num + 63) / 64, 0);
+        for (uint64_t s = 0; s < seg_num; s++)
+            task->dirty[s / 64] |= 1ULL << (s % 64);
+        task->dirty_cnt = seg_num;
+        task->stat = MIG_STAT_COPY;
+    }
+
+    if ((r = push_map__(task, CHK_STAT_MOVING, attr.src_id)) != RC_SUCCESS) {
+        cct_->log()->lwarn("push moving status of chunk (%llu) faild: %d", attr.chk_id, r);
+    }
+
+    bool throttle = attr.signal != CHK_MOVE_FORCE;
+    list<uint64_t> segs;
+    for (int round = 0; round < MIG_MAX_ROUNDS; round++) {
+        {
+            MutexLocker locker(task->mutex);
+            if (round > 0 && task->dirty_cnt <= MIG_CATCHUP_SEGS)
+                break;
+        }
+        segs.clear();
+        take_dirty__(task, segs);
+        cct_->log()->ldebug("chunk (%llu) copy round %d: %llu segments", attr.chk_id, round, segs.size());
+        if ((r = copy_segs__(task, stub, segs, throttle)) != RC_SUCCESS)
+            break;
+    }
+
+    if (r == RC_SUCCESS) {
+        // 最终追赶：推迟新的写入，等待在途写入完成
+        {
+            MutexLocker locker(task->mutex);
+            task->stat = MIG_STAT_CATCHUP;
+            while (task->inflight > 0)
+                task->cond.wait();
+        }
+        segs.clear();
+        take_dirty__(task, segs);
+        cct_->log()->ldebug("chunk (%llu) catch up: %llu segments", attr.chk_id, segs.size());
+        r = copy_segs__(task, stub, segs, false);
+    }
+
+    // 映射切换
+    if (r == RC_SUCCESS && (r = push_map__(task, CHK_STAT_CREATED, attr.dst_id)) != RC_SUCCESS) {
+        cct_->log()->lerror("switch map of chunk (%llu) faild: %d", attr.chk_id, r);
+    }
+
+    if (r != RC_SUCCESS) {
+        // 回滚：映射仍指向源CSD，删除目标CSD上的副本
+        push_map__(task, CHK_STAT_CREATED, attr.src_id);
+        stub->chunk_remove(attr.chk_id);
+        finish__(task, MIG_STAT_FAILD);
+        return r;
+    }
+
+    finish__(task, MIG_STAT_DONE);
+    task->chk.reset();
+    if (cct_->cs()->chunk_remove(attr.chk_id) != RC_SUCCESS) {
+        // 保留任务，继续拒绝写入已迁走的Chunk
+        cct_->log()->lwarn("remove moved chunk (%llu) faild", attr.chk_id);
+    } else {
+        if (cct_->sched())
+            cct_->sched()->chunk_remove(attr.chk_id);
+        if (cct_->hlt())
+            cct_->hlt()->chunk_remove(attr.chk_id);
+        release__(task);
+    }
+    return RC_SUCCESS;
+}
+
+void ChunkMigrator::take_dirty__(const shared_ptr<MigrateTask>& task, list<uint64_t>& segs) {
+    MutexLocker locker(task->mutex);
+    for (uint64_t w = 0; w < task->dirty.size(); w++) {
+        uint64_t word = task->dirty[w];
+        while (word) {
+            int b = __builtin_ctzll(word);
+            segs.push_back(w * 64 + b);
+            word &= word - 1;
+        }
+        task->dirty[w] = 0;
+    }
+    task->dirty_cnt = 0;
+}
+
+int ChunkMigrator::copy_segs__(const shared_ptr<MigrateTask>& task,
+const shared_ptr<CsdsClient>& stub, const list<uint64_t>& segs, bool throttle) {
+    if (segs.empty())
+        return RC_SUCCESS;
+
+    void* buff = nullptr;
+    if (posix_memalign(&buff, MIG_BUFF_ALIGN, seg_size_) != 0)
+        return RC_INTERNAL_ERROR;
+
+    int r = RC_SUCCESS;
+    shared_ptr<CsdsChunkWriter> writer = stub->chunk_write(task->attr.chk_id);
+    for (auto it = segs.begin(); it != segs.end(); it++) {
+        uint64_t off = *it * seg_size_;
+        uint64_t len = off + seg_size_ > task->info.size ? task->info.size - off : seg_size_;
+
+        if (task->chk->read_sync(buff, off, len) != RC_SUCCESS) {
+            cct_->log()->lerror("read chunk (%llu) off(%llu) len(%llu) faild", task->attr.chk_id, off, len);
+            r = RC_FAILD;
+            break;
+        }
+
+        if (throttle)
+            throttle__(len);
+
+        // 数据流中可同时存在多个数据段，只在流控窗口满时阻塞
+        if (writer->write(off, buff, len) != RC_SUCCESS) {
+            r = RC_FAILD;
+            break;
+        }
+        moved_bytes_ += len;
+    }
+
+    int fr = writer->finish();
+    if (r == RC_SUCCESS && fr != RC_SUCCESS) {
+        cct_->log()->lerror("dst csd (%llu) write chunk (%llu) faild: %d", task->attr.dst_id, task->attr.chk_id, fr);
+        r = RC_FAILD;
+    }
+
+    free(buff);
+    return r;
+}
+
+void ChunkMigrator::throttle__(uint64_t len) {
+    if (bandwidth_ == 0)
+        return;
+
+    uint64_t now = utime_t::now().to_nsec();
+    if (next_send_ > now) {
+        utime_t wait;
+        wait.set_from_nsec(next_send_ - now);
+        wait.sleep();
+    } else {
+        next_send_ = now;
+    }
+    next_send_ += len * 1000000000ULL / bandwidth_;
+}
+
+int ChunkMigrator::push_map__(const shared_ptr<MigrateTask>& task, uint32_t stat, uint64_t csd_id) {
+    chk_push_attr_t chk;
+    chk.chk_id = task->attr.chk_id;
+    chk.stat = stat;
+    chk.csd_id = csd_id;
+    chk.dst_id = stat == CHK_STAT_MOVING ? task->attr.dst_id : csd_id;
+    chk.dst_ctime = utime_t::now().to_usec();
+
+    list<chk_push_attr_t> chk_list {chk};
+    return cct_->mgr_stub()->push_chunk_status(chk_list);
+}
+
+void ChunkMigrator::finish__(const shared_ptr<MigrateTask>& task, int stat) {
+    list<pair<mig_resume_cb_t, void*>> deferred;
+    {
+        MutexLocker locker(task->mutex);
+        task->stat = stat;
+        task->cond.broadcast();
+        deferred.swap(task->deferred);
+    }
+
+    if (stat == MIG_STAT_DONE)
+        done_cnt_++;
+    else
+        faild_cnt_++;
+
+    // 已切换的任务保留到本地Chunk删除且在途写入全部返回，期间的写入都被拒绝，
+    // 由客户端重新获取映射
+    if (stat != MIG_STAT_DONE)
+        erase__(task);
+
+    // 推迟的写入重新调用write_begin()：失败时在本地写入，成功时被拒绝
+    for (auto it = deferred.begin(); it != deferred.end(); it++)
+        it->first(it->second);
+}
+
+void ChunkMigrator::release__(const shared_ptr<MigrateTask>& task) {
+    {
+        MutexLocker locker(task->mutex);
+        task->released = true;
+        if (task->inflight > 0)
+            return;
+    }
+    erase__(task);
+}
+
+void ChunkMigrator::erase__(const shared_ptr<MigrateTask>& task) {
+    WriteLocker locker(tasks_lock_);
+    auto it = tasks_.find(task->attr.chk_id);
+    if (it != tasks_.end() && it->second == task)
+        tasks_.erase(it);
+}
+
+} // namespace flame
@@ -0,0 +1,171 @@
+#ifndef FLAME_CSD_CHUNK_MIGRATOR_H
+#define FLAME_CSD_CHUNK_MIGRATOR_H
+
+#include "csd/csd_context.h"
+#include "chunkstore/chunkstore.h"
+#include "include/csds.h"
+#include "work/work_base.h"
+#include "common/thread/mutex.h"
+#include "common/thread/cond.h"
+#include "common/thread/rw_lock.h"
+
+#include <cstdint>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <list>
+#include <map>
+
+namespace flame {
+
+enum MigrateStat {
+    MIG_STAT_WAIT    = 0,   // 等待迁移
+    MIG_STAT_COPY    = 1,   // 批量拷贝，允许并发写入
+    MIG_STAT_CATCHUP = 2,   // 最终追赶，写入被暂停
+    MIG_STAT_DONE    = 3,   // 映射已切换到目标CSD
+    MIG_STAT_FAILD   = 4
+};
+
+enum MigrateWrite {
+    MIG_WRITE_OK       = 0,   // 可以在本地写入
+    MIG_WRITE_MOVED    = 1,   // Chunk已经迁移到其他CSD，需要客户端重新获取映射
+    MIG_WRITE_DEFERRED = 2    // 处于最终追赶阶段，迁移结束后回调resume再重新下发
+};
+
+typedef void (*mig_resume_cb_t)(void* arg);
+
+/**
+ * @brief 在线Chunk迁移引擎（运行在源CSD）
+ * 迁移分为三个阶段：
+ *  1. 批量拷贝：以较大的数据段为单位，通过数据流将Chunk推送到目标CSD，
+ *     期间的并发写入在完成时以数据段为粒度记录为脏区域，并在下一轮重新拷贝；
+ *  2. 最终追赶：脏数据段足够少时推迟新的写入，等待在途写入完成后拷贝剩余脏数据段；
+ *  3. 映射切换：通知MGR通过ChunkManager::update_map原子地切换Chunk映射。
+ * 批量拷贝受带宽限制，避免影响前台IO延迟。
+ */
+class ChunkMigrator final : public WorkerBase {
+public:
+    ChunkMigrator(CsdContext* cct, const std::shared_ptr<CsdsClientFoctory>& csds_foctory,
+        uint64_t seg_size, uint64_t bandwidth)
+    : WorkerBase("chunk_migrator"), cct_(cct), csds_foctory_(csds_foctory),
+      seg_size_(seg_size), bandwidth_(bandwidth), queue_cond_(queue_mutex_) {}
+
+    ~ChunkMigrator() {}
+
+    virtual void entry() override;
+
+    void stop();
+
+    /**
+     * @brief 提交迁移任务，迁移异步执行
+     *
+     * @param attr
+     * @return int 0 iff success
+     */
+    int submit(const chunk_move_attr_t& attr);
+
+    /**
+     * @brief 写入开始前调用（IO路径），不阻塞
+     * 处于最终追赶阶段时记下resume，迁移结束后回调，由调用者重新调用write_begin()
+     * @return MIG_WRITE_OK 可以在本地写入，之后必须调用write_end()
+     * @return MIG_WRITE_MOVED Chunk已经迁移到其他CSD
+     * @return MIG_WRITE_DEFERRED 写入被推迟
+     */
+    int write_begin(uint64_t chk_id, uint64_t off, uint64_t len,
+        mig_resume_cb_t resume = nullptr, void* arg = nullptr);
+
+    /**
+     * @brief 本地写入完成后调用（IO路径），与返回MIG_WRITE_OK的write_begin()成对出现
+     * 数据已落盘后才标记脏区域，之后开始的拷贝一定能读到新数据
+     */
+    void write_end(uint64_t chk_id, uint64_t off, uint64_t len);
+
+    /**
+     * @brief 是否正在迁移（已切换映射、尚未释放的任务也视为正在迁移）
+     *
+     * @param chk_id
+     * @return true
+     * @return false
+     */
+    bool is_moving(uint64_t chk_id);
+
+    uint64_t moved_bytes() const { return moved_bytes_.load(); }
+    uint64_t done_count() const { return done_cnt_.load(); }
+    uint64_t faild_count() const { return faild_cnt_.load(); }
+
+private:
+    struct MigrateTask {
+        MigrateTask(const chunk_move_attr_t& a) : attr(a), cond(mutex) {}
+
+        chunk_move_attr_t       attr;
+        std::shared_ptr<Chunk>  chk;
+        chunk_info_t            info;
+        int                     stat        {MIG_STAT_WAIT};
+        std::vector<uint64_t>   dirty;      // 脏数据段位图
+        uint64_t                dirty_cnt   {0};
+        uint32_t                inflight    {0};    // 在途写入
+        std::list<std::pair<mig_resume_cb_t, void*>> deferred;  // 最终追赶期间推迟的写入
+        bool                    released    {false};    // 本地Chunk已删除，在途写入返回后释放任务
+        Mutex                   mutex;
+        Cond                    cond;
+    }; // struct MigrateTask
+
+    CsdContext* cct_;
+    std::shared_ptr<CsdsClientFoctory> csds_foctory_;
+
+    uint64_t seg_size_;     // 数据段大小 (B)
+    uint64_t bandwidth_;    // 带宽限制 (B/s)，0表示不限制
+    uint64_t next_send_ {0};    // 下一个数据段允许发送的时间 (ns)
+
+    std::map<uint64_t, std::shared_ptr<MigrateTask>> tasks_;
+    RWLock tasks_lock_;
+
+    std::list<std::shared_ptr<MigrateTask>> queue_;
+    Mutex queue_mutex_;
+    Cond queue_cond_;
+    std::atomic<bool> can_run_ {true};
+
+    std::atomic<uint64_t> moved_bytes_ {0};
+    std::atomic<uint64_t> done_cnt_ {0};
+    std::atomic<uint64_t> faild_cnt_ {0};
+
+    std::shared_ptr<MigrateTask> find__(uint64_t chk_id);
+
+    int run_task__(const std::shared_ptr<MigrateTask>& task);
+
+    /**
+     * @brief 取出并清空脏数据段
+     *
+     * @param task
+     * @param segs
+     */
+    void take_dirty__(const std::shared_ptr<MigrateTask>& task, std::list<uint64_t>& segs);
+
+    /**
+     * @brief 将指定的数据段拷贝到目标CSD
+     *
+     * @return int
+     */
+    int copy_segs__(const std::shared_ptr<MigrateTask>& task,
+        const std::shared_ptr<CsdsClient>& stub, const std::list<uint64_t>& segs, bool throttle);
+
+    void throttle__(uint64_t len);
+
+    int push_map__(const std::shared_ptr<MigrateTask>& task, uint32_t stat, uint64_t csd_id);
+
+    void finish__(const std::shared_ptr<MigrateTask>& task, int stat);
+
+    /**
+     * @brief 本地Chunk删除后调用，没有在途写入时立即释放任务，
+     * 否则由最后一个write_end()释放
+     *
+     * @param task
+     */
+    void release__(const std::shared_ptr<MigrateTask>& task);
+
+    void erase__(const std::shared_ptr<MigrateTask>& task);
+}; // class ChunkMigrator
+
+} // namespace flame
+
+#endif // FLAME_CSD_CHUNK_MIGRATOR_H
@@ -0,0 +1,226 @@
+#include "csd/chunk_qos.h"
+#include "csd/chunk_io_sched.h"
+
+#include <algorithm>
+
+using namespace std;
+
+namespace flame {
+
+void QosBucket::set(uint64_t rate, uint64_t burst, uint64_t now) {
+    bool first = rate_ == 0;
+    rate_ = rate;
+    burst_ = burst ? burst : rate;
+    if (burst_ < 1)
+        burst_ = 1;
+    // 新设置的桶是满的，修改设置时保留已有的令牌（透支也保留）
+    if (first || tokens_ > burst_)
+        tokens_ = burst_;
+    last_ns_ = now;
+}
+
+void QosBucket::refill(uint64_t now) {
+    if (rate_ == 0 || now <= last_ns_)
+        return;
+    tokens_ += (double)(now - last_ns_) * rate_ / 1000000000.0;
+    if (tokens_ > burst_)
+        tokens_ = burst_;
+    last_ns_ = now;
+}
+
+uint64_t QosBucket::ready_ns(uint64_t now) const {
+    if (ready())
+        return now;
+    return now + (uint64_t)((1 - tokens_) * 1000000000.0 / rate_) + 1;
+}
+
+static bool qos_cleared(const qos_attr_t& attr) {
+    return attr.rsv_iops == 0 && attr.lim_iops == 0 && attr.lim_bps == 0 && attr.weight <= 1;
+}
+
+void ChunkQos::set(const qos_attr_t& attr, uint64_t now) {
+    qos_key_t key(attr.type, attr.id);
+    auto it = ents_.find(key);
+    if (qos_cleared(attr) && (it == ents_.end() || it->second.deferred.empty())) {
+        if (it != ents_.end()) {
+            if (it->second.attr.rsv_iops)
+                rsv_cnt_--;
+            ents_.erase(it);
+        }
+        return;
+    }
+
+    QosEntity& ent = ents_[key];
+    if (ent.attr.rsv_iops)
+        rsv_cnt_--;
+    if (attr.rsv_iops)
+        rsv_cnt_++;
+    ent.attr = attr;
+    ent.stat.type = attr.type;
+    ent.stat.id = attr.id;
+    ent.iops.set(attr.lim_iops, attr.burst_iops, now);
+    ent.bps.set(attr.lim_bps, attr.burst_bps, now);
+    // 预留不累积，最多攒100ms的量
+    ent.rsv.set(attr.rsv_iops, attr.rsv_iops / 10 + 1, now);
+    // 上限可能放宽了，让排队的IO在下一轮重新检查
+    ent.ready_ns = 0;
+}
+
+ChunkQos::QosEntity* ChunkQos::find__(uint32_t type, uint64_t id) {
+    auto it = ents_.find(qos_key_t(type, id));
+    return it == ents_.end() ? nullptr : &it->second;
+}
+
+ChunkQos::QosEntity* ChunkQos::pass__(QosEntity* vol, QosEntity* cli, chunk_io_t* io, uint64_t now) {
+    QosEntity* ents[2] = {vol, cli};
+    for (int i = 0; i < 2; i++) {
+        if (ents[i] == nullptr)
+            continue;
+        ents[i]->iops.refill(now);
+        ents[i]->bps.refill(now);
+        if (!ents[i]->iops.ready() || !ents[i]->bps.ready())
+            return ents[i];
+    }
+    for (int i = 0; i < 2; i++) {
+        if (ents[i] == nullptr)
+            continue;
+        ents[i]->iops.take(1);
+        ents[i]->bps.take(io->len);
+    }
+    return nullptr;
+}
+
+void ChunkQos::defer__(QosEntity* ent, chunk_io_t* io, uint64_t now) {
+    ent->deferred.push_back(io);
+    if (ent->deferred.size() == 1) {
+        ent->ready_ns = max(ent->iops.ready_ns(now), ent->bps.ready_ns(now));
+        waiting_.insert(ent);
+    }
+}
+
+bool ChunkQos::admit(chunk_io_t* io, uint64_t now) {
+    if (ents_.empty())
+        return true;
+    QosEntity* vol = find__(QOS_TYPE_VOL, chunk_id_t(io->chk_id).get_vol_id());
+    QosEntity* cli = io->client_id ? find__(QOS_TYPE_CLIENT, io->client_id) : nullptr;
+    if (vol == nullptr && cli == nullptr)
+        return true;
+
+    // 已有排队的IO时直接排队，保持到达顺序
+    QosEntity* blk;
+    if (vol && !vol->deferred.empty())
+        blk = vol;
+    else if (cli && !cli->deferred.empty())
+        blk = cli;
+    else
+        blk = pass__(vol, cli, io, now);
+
+    if (blk == nullptr) {
+        if (vol)
+            vol->stat.passed++;
+        if (cli)
+            cli->stat.passed++;
+        return true;
+    }
+    blk->stat.throttled++;
+    defer__(blk, io, now);
+    return false;
+}
+
+void ChunkQos::release(uint64_t now, vector<chunk_io_t*>& ios) {
+    vector<QosEntity*> due;
+    for (auto it = waiting_.begin(); it != waiting_.end(); it++) {
+        if ((*it)->ready_ns <= now)
+            due.push_back(*it);
+    }
+
+    for (auto it = due.begin(); it != due.end(); it++) {
+        QosEntity* ent = *it;
+        while (!ent->deferred.empty()) {
+            chunk_io_t* io = ent->deferred.front();
+            QosEntity* vol = find__(QOS_TYPE_VOL, chunk_id_t(io->chk_id).get_vol_id());
+            QosEntity* cli = io->client_id ? find__(QOS_TYPE_CLIENT, io->client_id) : nullptr;
+            QosEntity* blk = pass__(vol, cli, io, now);
+            if (blk == ent) {
+                ent->ready_ns = max(ent->iops.ready_ns(now), ent->bps.ready_ns(now));
+                break;
+            }
+            ent->deferred.pop_front();
+            if (blk) {
+                // 卷与客户端同时受限，转到另一方的队列继续等待
+                defer__(blk, io, now);
+                continue;
+            }
+            uint64_t delay = now > io->enqueue_ns ? (now - io->enqueue_ns) / 1000 : 0;
+            ent->stat.released++;
+            ent->stat.delay_sum += delay;
+            if (delay > ent->stat.delay_max)
+                ent->stat.delay_max = delay;
+            ios.push_back(io);
+        }
+
+        if (ent->deferred.empty()) {
+            waiting_.erase(ent);
+            if (qos_cleared(ent->attr))
+                ents_.erase(qos_key_t(ent->attr.type, ent->attr.id));
+        }
+    }
+}
+
+void ChunkQos::drain(vector<chunk_io_t*>& ios) {
+    for (auto it = waiting_.begin(); it != waiting_.end(); it++) {
+        QosEntity* ent = *it;
+        ios.insert(ios.end(), ent->deferred.begin(), ent->deferred.end());
+        ent->deferred.clear();
+    }
+    waiting_.clear();
+    for (auto it = ents_.begin(); it != ents_.end(); ) {
+        if (qos_cleared(it->second.attr))
+            it = ents_.erase(it);
+        else
+            it++;
+    }
+}
+
+uint64_t ChunkQos::next_ns() const {
+    uint64_t next = UINT64_MAX;
+    for (auto it = waiting_.begin(); it != waiting_.end(); it++)
+        next = min(next, (*it)->ready_ns);
+    return next;
+}
+
+uint32_t ChunkQos::weight(uint64_t vol_id) const {
+    auto it = ents_.find(qos_key_t(QOS_TYPE_VOL, vol_id));
+    if (it == ents_.end() || it->second.attr.weight == 0)
+        return 1;
+    return it->second.attr.weight;
+}
+
+bool ChunkQos::reserve_ready(uint64_t vol_id, uint64_t now) {
+    QosEntity* ent = find__(QOS_TYPE_VOL, vol_id);
+    if (ent == nullptr || ent->rsv.unlimited())
+        return false;
+    ent->rsv.refill(now);
+    return ent->rsv.ready();
+}
+
+void ChunkQos::reserve_take(uint64_t vol_id, uint64_t n) {
+    QosEntity* ent = find__(QOS_TYPE_VOL, vol_id);
+    if (ent)
+        ent->rsv.take(n);
+}
+
+void ChunkQos::collect(list<chunk_qos_stat_t>& res) {
+    for (auto it = ents_.begin(); it != ents_.end(); it++) {
+        QosEntity& ent = it->second;
+        ent.stat.deferred = ent.deferred.size();
+        res.push_back(ent.stat);
+        ent.stat.passed = 0;
+        ent.stat.throttled = 0;
+        ent.stat.released = 0;
+        ent.stat.delay_sum = 0;
+        ent.stat.delay_max = 0;
+    }
+}
+
+} // namespace flame
@@ -0,0 +1,151 @@
+#ifndef FLAME_CSD_CHUNK_QOS_H
+#define FLAME_CSD_CHUNK_QOS_H
+
+#include "include/meta.h"
+
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <map>
+#include <set>
+#include <vector>
+
+namespace flame {
+
+struct chunk_io_t;
+
+struct chunk_qos_stat_t {
+    uint32_t type           {0};
+    uint64_t id             {0};
+    uint64_t passed         {0};    // 未被限流的IO数
+    uint64_t throttled      {0};    // 被延后下发的IO数
+    uint64_t released       {0};    // 排队后放行的IO数
+    uint64_t delay_sum      {0};    // 放行的IO被延后的时间之和 (us)
+    uint64_t delay_max      {0};    // (us)
+    uint32_t deferred       {0};    // 当前排队的IO数
+
+    uint64_t delay_avg() const { return released ? delay_sum / released : 0; }
+}; // struct chunk_qos_stat_t
+
+/**
+ * @brief 令牌桶
+ * 令牌可以透支：只要桶中有一个完整的令牌就放行，大IO把桶扣成负数后，后续IO等待补齐。
+ * 这样大于突发量的IO也能通过，长期速率仍受rate限制
+ */
+class QosBucket {
+public:
+    /**
+     * @param rate 每秒补充的令牌数，0表示不限
+     * @param burst 桶的容量，0表示等于rate
+     */
+    void set(uint64_t rate, uint64_t burst, uint64_t now);
+
+    bool unlimited() const { return rate_ == 0; }
+
+    void refill(uint64_t now);
+
+    bool ready() const { return rate_ == 0 || tokens_ >= 1; }
+
+    void take(uint64_t n) { if (rate_) tokens_ -= n; }
+
+    /**
+     * @brief 令牌恢复到可以放行的时间 (ns)
+     */
+    uint64_t ready_ns(uint64_t now) const;
+
+private:
+    uint64_t rate_      {0};
+    double   burst_     {0};
+    double   tokens_    {0};
+    uint64_t last_ns_   {0};
+}; // class QosBucket
+
+/**
+ * @brief 卷/客户端的令牌桶限流
+ *  1. limit：IOPS与带宽上限，超过上限的IO排队，令牌恢复后按到达顺序放行；
+ *  2. reservation：卷的预留IOPS，由调度器优先下发未达到预留的卷；
+ *  3. weight：卷在调度器差额轮询中的份额。
+ * 非线程安全，由ChunkIoScheduler在持锁时调用
+ */
+class ChunkQos {
+public:
+    ChunkQos() {}
+    ~ChunkQos() {}
+
+    /**
+     * @brief 设置（或清除）QoS，上限、预留都为0且权重为1时清除
+     */
+    void set(const qos_attr_t& attr, uint64_t now);
+
+    /**
+     * @brief 准入检查
+     *
+     * @param io
+     * @param now
+     * @return true 立即下发
+     * @return false 已进入限流队列，由release()放行
+     */
+    bool admit(chunk_io_t* io, uint64_t now);
+
+    /**
+     * @brief 放行令牌已恢复的排队IO
+     */
+    void release(uint64_t now, std::vector<chunk_io_t*>& ios);
+
+    /**
+     * @brief 取出全部排队的IO（调度器停止时调用）
+     */
+    void drain(std::vector<chunk_io_t*>& ios);
+
+    /**
+     * @brief 下一次可以放行的时间 (ns)，没有排队IO时返回UINT64_MAX
+     */
+    uint64_t next_ns() const;
+
+    uint32_t weight(uint64_t vol_id) const;
+
+    bool has_reservation() const { return rsv_cnt_ > 0; }
+
+    /**
+     * @brief 卷是否还未达到预留IOPS
+     */
+    bool reserve_ready(uint64_t vol_id, uint64_t now);
+
+    void reserve_take(uint64_t vol_id, uint64_t n);
+
+    /**
+     * @brief 取出本周期的统计（只包含有QoS设置的对象）
+     */
+    void collect(std::list<chunk_qos_stat_t>& res);
+
+private:
+    struct QosEntity {
+        qos_attr_t                  attr;
+        QosBucket                   iops;
+        QosBucket                   bps;
+        QosBucket                   rsv;
+        std::deque<chunk_io_t*>     deferred;
+        uint64_t                    ready_ns    {0};
+        chunk_qos_stat_t            stat;
+    };
+
+    typedef std::pair<uint32_t, uint64_t> qos_key_t;
+
+    std::map<qos_key_t, QosEntity> ents_;
+    std::set<QosEntity*> waiting_;      // 有排队IO的对象
+    uint32_t rsv_cnt_ {0};
+
+    QosEntity* find__(uint32_t type, uint64_t id);
+
+    /**
+     * @brief 尝试扣除令牌
+     * @return QosEntity* 令牌不足的对象，nullptr表示已放行
+     */
+    QosEntity* pass__(QosEntity* vol, QosEntity* cli, chunk_io_t* io, uint64_t now);
+
+    void defer__(QosEntity* ent, chunk_io_t* io, uint64_t now);
+}; // class ChunkQos
+
+} // namespace flame
+
+#endif // FLAME_CSD_CHUNK_QOS_H
@@ -9,9 +9,17 @@
 #define CFG_CSD_CHUNKSTORE "chunkstore"
 #define CFG_CSD_MGR_ADDR "mgr_addr"
 #define CFG_CSD_HEART_BEAT_CYCLE "heart_beat_cycle"
+#define CFG_CSD_HEALTH_CYCLE "health_cycle"
 #define CFG_CSD_NAME "csd_name"
 #define CFG_CSD_CONSOLE_LOG "console_log"
 #define CFG_CSD_REACTOR_MASK "0x0f"
 #define CFG_CSD_NVME_CONF  "nvme_conf"
+#define CFG_CSD_MIGRATE_BANDWIDTH "migrate_bandwidth"
+#define CFG_CSD_MIGRATE_SEGMENT "migrate_segment"
+#define CFG_CSD_SCHED_WINDOW "io_sched_window"
+#define CFG_CSD_SCHED_MERGE "io_sched_merge"
+#define CFG_CSD_SCHED_DEPTH "io_sched_depth"
+#define CFG_CSD_TRACE_SLOW "io_trace_slow"
+#define CFG_CSD_TRACE_SAMPLE "io_trace_sample"
 
 #endif // FLAME_CSD_CONFIG_H
\ No newline at end of file
@@ -7,8 +7,16 @@
 #include "csd/csd_context.h"
 #include "csd/csd_admin.h"
 #include "csd/config_csd.h"
+#include "csd/chunk_migrator.h"
+#include "csd/chunk_io_sched.h"
+#include "csd/chunk_health.h"
+#include "csd/chunk_cmd_backend.h"
+#include "libflame/libchunk/cmd_trace.h"
+#include "libflame/libchunk/libchunk.h"
+#include "libflame/libchunk/chunk_cmd_service.h"
 
 #include "service/internal_client.h"
+#include "service/csds_client.h"
 #include "include/retcode.h"
 
 #include "cluster/clt_agent.h"
@@ -42,6 +50,14 @@ public:
     Argument<string>    mgr_addr    {this, 'm', CFG_CSD_MGR_ADDR, "Flame MGR Address", "0.0.0.0:6666"};
     Argument<string>    chunkstore  {this, CFG_CSD_CHUNKSTORE, "ChunkStore url", ""};
     Argument<uint64_t>  heart_beat  {this, CFG_CSD_HEART_BEAT_CYCLE, "heart beat cycle, unit: ms", 3000};
+    Argument<uint32_t>  hlt_cycle   {this, CFG_CSD_HEALTH_CYCLE, "health report cycle, unit: heart beat cycle, 0 means disable", 10};
+    Argument<uint64_t>  mig_bw      {this, CFG_CSD_MIGRATE_BANDWIDTH, "chunk migrate bandwidth, unit: MB/s, 0 means no limit", 64};
+    Argument<uint64_t>  mig_seg     {this, CFG_CSD_MIGRATE_SEGMENT, "chunk migrate segment size, unit: KB", 4096};
+    Argument<uint64_t>  sched_window{this, CFG_CSD_SCHED_WINDOW, "io merge window of idle chunk, unit: us, 0 means no wait", 50};
+    Argument<uint64_t>  sched_merge {this, CFG_CSD_SCHED_MERGE, "max size of merged io, unit: KB", 128};
+    Argument<uint32_t>  sched_depth {this, CFG_CSD_SCHED_DEPTH, "max inflight io batches of all chunks", 32};
+    Argument<uint64_t>  trace_slow  {this, CFG_CSD_TRACE_SLOW, "slow cmd threshold of stage tracing, unit: us, 0 means disable tracing", uint64_t(0)};
+    Argument<uint32_t>  trace_sample{this, CFG_CSD_TRACE_SAMPLE, "record one of every N slow cmds", 1};
     Argument<string>    log_dir     {this, CFG_CSD_LOG_DIR, "log dir", "/var/log/flame"};
     Argument<string>    log_level   {this, CFG_CSD_LOG_LEVEL, 
         "log level. {PRINT, TRACE, DEBUG, INFO, WARN, ERROR, WRONG, CRITICAL, DEAD}", "INFO"};
@@ -115,6 +131,8 @@ private:
     int admin_server_stat_ {0};
     unique_ptr<CsdAdminThread> admin_thread_;
     unique_ptr<ClusterAgent> clt_agent_;
+    unique_ptr<SchedCmdBackend> cmd_backend_;
+    unique_ptr<CmdServerStubImpl> cmd_server_;
 
     /**
      * 配置项
@@ -126,8 +144,16 @@ private:
     node_addr_t cfg_io_addr_;
     string      cfg_chunkstore_url_;
     uint64_t    cfg_heart_beat_cycle_ms_;
+    uint32_t    cfg_health_cycle_;
     string      cfg_log_dir_;
     string      cfg_log_level_;
+    uint64_t    cfg_migrate_bandwidth_mb_;
+    uint64_t    cfg_migrate_segment_kb_;
+    uint64_t    cfg_sched_window_us_;
+    uint64_t    cfg_sched_merge_kb_;
+    uint32_t    cfg_sched_depth_;
+    uint64_t    cfg_trace_slow_us_;
+    uint32_t    cfg_trace_sample_;
 
     int read_config(CsdCli* csd_cli);
 
@@ -135,6 +161,11 @@ private:
     bool init_mgr();
     bool init_chunkstore(bool force_format);
     bool init_server();
+    bool init_migrator();
+    bool init_health();
+    bool init_io_sched();
+    bool init_trace();
+    bool init_cmd_server();
 
     bool csd_register();
     bool csd_run_server();
@@ -192,6 +223,36 @@ int CSD::init(CsdCli* csd_cli) {
         return 5;
     }
 
+    // 初始化Chunk迁移引擎
+    if (!init_migrator()) {
+        cct_->log()->lerror("init migrator faild");
+        return 6;
+    }
+
+    // 初始化Chunk健康信息统计
+    if (!init_health()) {
+        cct_->log()->lerror("init health tracker faild");
+        return 7;
+    }
+
+    // 初始化Chunk IO调度器
+    if (!init_io_sched()) {
+        cct_->log()->lerror("init io scheduler faild");
+        return 8;
+    }
+
+    // 初始化命令的分阶段延迟跟踪
+    if (!init_trace()) {
+        cct_->log()->lerror("init cmd tracer faild");
+        return 9;
+    }
+
+    // 初始化Chunk IO命令服务
+    if (!init_cmd_server()) {
+        cct_->log()->lerror("init cmd server faild");
+        return 10;
+    }
+
     return 0;
 }
 
@@ -217,6 +278,10 @@ int CSD::run() {
 }
 
 void CSD::down() {
+    if (cct_->sched())
+        cct_->sched()->stop();
+    if (cct_->migrator())
+        cct_->migrator()->stop();
     if (cct_->cs())
         cct_->cs()->dev_unmount();
 }
@@ -359,6 +424,104 @@ int CSD::read_config(CsdCli* csd_cli) {
         return 9;
     }
 
+    /**
+     * cfg_migrate_bandwidth_mb_ (可选)
+     */
+    cfg_migrate_bandwidth_mb_ = csd_cli->mig_bw;
+    if (!csd_cli->mig_bw.done() && config->has_key(CFG_CSD_MIGRATE_BANDWIDTH)) {
+        if (!string_parse(cfg_migrate_bandwidth_mb_, config->get(CFG_CSD_MIGRATE_BANDWIDTH, ""))) {
+            cct_->log()->lerror("invalid config[ " CFG_CSD_MIGRATE_BANDWIDTH " ]");
+            return 10;
+        }
+    }
+
+    /**
+     * cfg_migrate_segment_kb_ (可选)
+     */
+    cfg_migrate_segment_kb_ = csd_cli->mig_seg;
+    if (!csd_cli->mig_seg.done() && config->has_key(CFG_CSD_MIGRATE_SEGMENT)) {
+        if (!string_parse(cfg_migrate_segment_kb_, config->get(CFG_CSD_MIGRATE_SEGMENT, ""))) {
+            cct_->log()->lerror("invalid config[ " CFG_CSD_MIGRATE_SEGMENT " ]");
+            return 11;
+        }
+    }
+
+    if (cfg_migrate_segment_kb_ == 0 || cfg_migrate_segment_kb_ % 4 != 0) {
+        cct_->log()->lerror("invalid config[ " CFG_CSD_MIGRATE_SEGMENT " ], must be a multiple of 4KB");
+        return 12;
+    }
+
+    /**
+     * cfg_health_cycle_ (可选)
+     */
+    cfg_health_cycle_ = csd_cli->hlt_cycle;
+    if (!csd_cli->hlt_cycle.done() && config->has_key(CFG_CSD_HEALTH_CYCLE)) {
+        if (!string_parse(cfg_health_cycle_, config->get(CFG_CSD_HEALTH_CYCLE, ""))) {
+            cct_->log()->lerror("invalid config[ " CFG_CSD_HEALTH_CYCLE " ]");
+            return 13;
+        }
+    }
+
+    /**
+     * cfg_sched_window_us_ (可选)
+     */
+    cfg_sched_window_us_ = csd_cli->sched_window;
+    if (!csd_cli->sched_window.done() && config->has_key(CFG_CSD_SCHED_WINDOW)) {
+        if (!string_parse(cfg_sched_window_us_, config->get(CFG_CSD_SCHED_WINDOW, ""))) {
+            cct_->log()->lerror("invalid config[ " CFG_CSD_SCHED_WINDOW " ]");
+            return 14;
+        }
+    }
+
+    /**
+     * cfg_sched_merge_kb_ (可选)
+     */
+    cfg_sched_merge_kb_ = csd_cli->sched_merge;
+    if (!csd_cli->sched_merge.done() && config->has_key(CFG_CSD_SCHED_MERGE)) {
+        if (!string_parse(cfg_sched_merge_kb_, config->get(CFG_CSD_SCHED_MERGE, ""))) {
+            cct_->log()->lerror("invalid config[ " CFG_CSD_SCHED_MERGE " ]");
+            return 15;
+        }
+    }
+
+    /**
+     * cfg_sched_depth_ (可选)
+     */
+    cfg_sched_depth_ = csd_cli->sched_depth;
+    if (!csd_cli->sched_depth.done() && config->has_key(CFG_CSD_SCHED_DEPTH)) {
+        if (!string_parse(cfg_sched_depth_, config->get(CFG_CSD_SCHED_DEPTH, ""))) {
+            cct_->log()->lerror("invalid config[ " CFG_CSD_SCHED_DEPTH " ]");
+            return 16;
+        }
+    }
+
+    if (cfg_sched_merge_kb_ == 0 || cfg_sched_depth_ == 0) {
+        cct_->log()->lerror("invalid config[ " CFG_CSD_SCHED_MERGE " / " CFG_CSD_SCHED_DEPTH " ], must be positive");
+        return 17;
+    }
+
+    /**
+     * cfg_trace_slow_us_ (可选)
+     */
+    cfg_trace_slow_us_ = csd_cli->trace_slow;
+    if (!csd_cli->trace_slow.done() && config->has_key(CFG_CSD_TRACE_SLOW)) {
+        if (!string_parse(cfg_trace_slow_us_, config->get(CFG_CSD_TRACE_SLOW, ""))) {
+            cct_->log()->lerror("invalid config[ " CFG_CSD_TRACE_SLOW " ]");
+            return 18;
+        }
+    }
+
+    /**
+     * cfg_trace_sample_ (可选)
+     */
+    cfg_trace_sample_ = csd_cli->trace_sample;
+    if (!csd_cli->trace_sample.done() && config->has_key(CFG_CSD_TRACE_SAMPLE)) {
+        if (!string_parse(cfg_trace_sample_, config->get(CFG_CSD_TRACE_SAMPLE, ""))) {
+            cct_->log()->lerror("invalid config[ " CFG_CSD_TRACE_SAMPLE " ]");
+            return 19;
+        }
+    }
+
     return 0;
 }
 
@@ -437,6 +600,50 @@ bool CSD::init_server() {
     return true;
 }
 
+bool CSD::init_migrator() {
+    shared_ptr<CsdsClientFoctory> foctory(new CsdsClientFoctoryImpl(cct_->fct()));
+    shared_ptr<ChunkMigrator> migrator(new ChunkMigrator(cct_.get(), foctory,
+        cfg_migrate_segment_kb_ << 10, cfg_migrate_bandwidth_mb_ << 20));
+    migrator->run();
+    cct_->migrator(migrator);
+    return true;
+}
+
+bool CSD::init_health() {
+    cct_->hlt(shared_ptr<ChunkHealthTracker>(new ChunkHealthTracker(cct_.get())));
+    return true;
+}
+
+bool CSD::init_io_sched() {
+    shared_ptr<ChunkIoScheduler> sched(new ChunkIoScheduler(cct_.get(),
+        cfg_sched_window_us_, cfg_sched_merge_kb_ << 10, cfg_sched_depth_));
+    sched->run();
+    cct_->sched(sched);
+    return true;
+}
+
+bool CSD::init_trace() {
+    // 校准需要约10ms，在启动时完成，避免落在第一条慢命令的统计路径上
+    cycles_per_ns();
+    CmdTracer* tracer = CmdTracer::get_tracer();
+    tracer->set_slow(cfg_trace_slow_us_ * 1000, cfg_trace_sample_, CMD_TRACE_SLOW_KEEP);
+    tracer->set_enable(cfg_trace_slow_us_ != 0);
+    return true;
+}
+
+bool CSD::init_cmd_server() {
+    // 读写命令经过IO调度器下发到ChunkStore
+    cmd_backend_.reset(new SchedCmdBackend(cct_.get()));
+    CmdServiceMapper* mapper = CmdServiceMapper::get_cmd_service_mapper();
+    mapper->register_service(CMD_CLS_IO_CHK, CMD_CHK_IO_READ, new ReadCmdService(cmd_backend_.get()));
+    mapper->register_service(CMD_CLS_IO_CHK, CMD_CHK_IO_WRITE, new WriteCmdService(cmd_backend_.get()));
+    mapper->register_service(CMD_CLS_IO_CHK, CMD_CHK_IO_RESET, new WriteZerosCmdService(cmd_backend_.get()));
+
+    // 监听地址等由配置文件中的msg配置项(node_listen_ports等)决定
+    cmd_server_.reset(new CmdServerStubImpl(cct_->fct()));
+    return true;
+}
+
 bool CSD::csd_register() {
     cs_info_t info;
 
@@ -497,7 +704,7 @@ bool CSD::csd_sign_up() {
     }
     
     cct_->log()->linfo("init cluster agent");
-    clt_agent_.reset(new MyClusterAgent(cct_.get(), utime_t::get_by_msec(cfg_heart_beat_cycle_ms_)));
+    clt_agent_.reset(new MyClusterAgent(cct_.get(), utime_t::get_by_msec(cfg_heart_beat_cycle_ms_), cfg_health_cycle_));
     clt_agent_->init();
     return true;
 }
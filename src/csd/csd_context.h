@@ -12,6 +12,10 @@
 
 namespace flame {
 
+class ChunkMigrator;
+class ChunkHealthTracker;
+class ChunkIoScheduler;
+
 class CsdContext {
 public:
     CsdContext(FlameContext* fct) : fct_(fct) {}
@@ -49,6 +53,15 @@ public:
     std::shared_ptr<TimerWorker> timer() const { return timer_; }
     void timer(const std::shared_ptr<TimerWorker>& tw) { timer_ = tw; } 
 
+    std::shared_ptr<ChunkMigrator> migrator() const { return migrator_; }
+    void migrator(const std::shared_ptr<ChunkMigrator>& mig) { migrator_ = mig; }
+
+    std::shared_ptr<ChunkHealthTracker> hlt() const { return hlt_; }
+    void hlt(const std::shared_ptr<ChunkHealthTracker>& h) { hlt_ = h; }
+
+    std::shared_ptr<ChunkIoScheduler> sched() const { return sched_; }
+    void sched(const std::shared_ptr<ChunkIoScheduler>& s) { sched_ = s; }
+
 private:
     FlameContext* fct_;
 
@@ -62,6 +75,9 @@ private:
     std::shared_ptr<ChunkStore> cs_;
     std::shared_ptr<InternalClient> mgr_stub_;
     std::shared_ptr<TimerWorker> timer_;
+    std::shared_ptr<ChunkMigrator> migrator_;
+    std::shared_ptr<ChunkHealthTracker> hlt_;
+    std::shared_ptr<ChunkIoScheduler> sched_;
 }; // class CsdContext
 
 } // namespace flame
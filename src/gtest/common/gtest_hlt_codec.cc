@@ -0,0 +1,144 @@
+#include "gtest/common/gtest_hlt_codec.h"
+#include "include/retcode.h"
+#include <string>
+#include <list>
+#include <cstdint>
+using namespace flame;
+
+static void make_chunks(list<chk_hlt_attr_t>& chks, int num) {
+    for (int i = 0; i < num; i++) {
+        chk_hlt_attr_t chk;
+        chk.chk_id = (1ULL << 32) + i * 7;
+        chk.size = 4ULL << 30;
+        chk.stat = CHK_STAT_CREATED;
+        chk.used = i * 4096;
+        chks.push_back(chk);
+    }
+}
+
+TEST_F(TestHltCodec, Varint)
+{
+    uint64_t vals[] = {0, 1, 127, 128, 300, 1ULL << 35, ~0ULL};
+    string buf;
+    for (int i = 0; i < 7; i++)
+        varint_put(buf, vals[i]);
+    const char* p = buf.data();
+    const char* end = p + buf.size();
+    for (int i = 0; i < 7; i++) {
+        uint64_t v;
+        ASSERT_TRUE(varint_get(p, end, v));
+        ASSERT_EQ(v, vals[i]);
+    }
+    ASSERT_TRUE(p == end);
+
+    int64_t svals[] = {0, -1, 1, -64, 64, INT64_MIN, INT64_MAX};
+    for (int i = 0; i < 7; i++)
+        ASSERT_EQ(zigzag_decode(zigzag_encode(svals[i])), svals[i]);
+}
+
+TEST_F(TestHltCodec, Delta)
+{
+    ChunkHealthEncoder enc;
+    ChunkHealthDecoder dec;
+    list<chk_hlt_attr_t> cur, out;
+    make_chunks(cur, 1000);
+
+    // 全量
+    string buf;
+    uint32_t num = enc.encode(buf, cur, true);
+    ASSERT_EQ(num, (uint32_t)1000);
+    ASSERT_EQ(dec.decode(out, buf, num, true, 100), RC_SUCCESS);
+    ASSERT_EQ(out.size(), (size_t)1000);
+    enc.commit();
+
+    // 没有变化时不产生任何数据
+    num = enc.encode(buf, cur, false);
+    ASSERT_EQ(num, (uint32_t)0);
+    ASSERT_TRUE(buf.empty());
+
+    // 一个Chunk有写入，一个Chunk空间减少，一个Chunk被删除
+    auto it = cur.begin();
+    it->period.wr_cnt = 10;
+    it++;
+    it->used -= 4096;
+    uint64_t removed = cur.back().chk_id;
+    cur.pop_back();
+    num = enc.encode(buf, cur, false);
+    ASSERT_EQ(num, (uint32_t)3);
+
+    out.clear();
+    ASSERT_EQ(dec.decode(out, buf, num, false, 200), RC_SUCCESS);
+    enc.commit();
+    ASSERT_EQ(out.size(), (size_t)2);
+    ASSERT_EQ(out.front().period.wr_cnt, (uint64_t)10);
+    ASSERT_EQ(out.front().period.ctime, (uint64_t)200);
+    ASSERT_EQ(out.back().used, (uint64_t)0);
+    ASSERT_EQ(dec.size(), (size_t)999);
+    ASSERT_TRUE(dec.base_.find(removed) == dec.base_.end());
+}
+
+TEST_F(TestHltCodec, SteadyIo)
+{
+    ChunkHealthEncoder enc;
+    ChunkHealthDecoder dec;
+    list<chk_hlt_attr_t> cur, out;
+    make_chunks(cur, 10);
+
+    string buf;
+    uint32_t num = enc.encode(buf, cur, true);
+    ASSERT_EQ(dec.decode(out, buf, num, true, 100), RC_SUCCESS);
+    enc.commit();
+
+    // 连续两个周期写入量相同，每个周期都要汇报，MGR才能累加
+    cur.front().period.wr_cnt = 10;
+    cur.front().period.lat = 2000;
+    uint64_t grand = 0;
+    for (int i = 0; i < 2; i++) {
+        num = enc.encode(buf, cur, false);
+        ASSERT_EQ(num, (uint32_t)1);
+        out.clear();
+        ASSERT_EQ(dec.decode(out, buf, num, false, 200 + i), RC_SUCCESS);
+        enc.commit();
+        ASSERT_EQ(out.size(), (size_t)1);
+        ASSERT_EQ(out.front().period.wr_cnt, (uint64_t)10);
+        ASSERT_EQ(out.front().period.lat, (uint64_t)2000);
+        grand += out.front().period.wr_cnt;
+    }
+    ASSERT_EQ(grand, (uint64_t)20);
+
+    // 写入停止：汇报一次0，之后不再输出
+    cur.front().period = health_period_t();
+    num = enc.encode(buf, cur, false);
+    ASSERT_EQ(num, (uint32_t)1);
+    out.clear();
+    ASSERT_EQ(dec.decode(out, buf, num, false, 300), RC_SUCCESS);
+    enc.commit();
+    ASSERT_EQ(out.size(), (size_t)1);
+    ASSERT_EQ(out.front().period.wr_cnt, (uint64_t)0);
+    ASSERT_EQ(out.front().period.lat, (uint64_t)0);
+    ASSERT_EQ(out.front().size, cur.front().size);
+
+    num = enc.encode(buf, cur, false);
+    ASSERT_EQ(num, (uint32_t)0);
+}
+
+TEST_F(TestHltCodec, Corrupt)
+{
+    ChunkHealthEncoder enc;
+    ChunkHealthDecoder dec;
+    list<chk_hlt_attr_t> cur, out;
+    make_chunks(cur, 10);
+
+    string buf;
+    uint32_t num = enc.encode(buf, cur, true);
+    buf.resize(buf.size() - 1);
+    ASSERT_EQ(dec.decode(out, buf, num, true, 100), RC_WRONG_PARAMETER);
+    ASSERT_EQ(dec.size(), (size_t)0);
+    ASSERT_TRUE(out.empty());
+}
+
+int main(int argc, char  **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,27 @@
+#include <gtest/gtest.h>
+#include <iostream>
+
+#ifdef GTEST
+#define private public
+#define protected public
+#endif
+#include "common/hlt_codec.h"
+
+using namespace std;
+using namespace flame;
+
+class TestHltCodec:public testing::Test
+{
+public:
+    static void SetUpTestCase(){    
+    }
+ 
+    static void TearDownTestCase(){  
+    }
+    
+    void SetUp(){
+    }
+
+    void TearDown(){
+    }  
+};// class TestHltCodec
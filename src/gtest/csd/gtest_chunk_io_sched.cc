@@ -0,0 +1,390 @@
+#include "gtest/csd/gtest_chunk_io_sched.h"
+#include "include/retcode.h"
+
+#include <cstring>
+#include <vector>
+#include <string>
+#include <set>
+using namespace flame;
+
+/**
+ * 内存中的Chunk，异步IO在release()时才完成，用于观察调度器下发的IO
+ */
+struct fake_io_t {
+    bool write;
+    uint64_t off;
+    uint64_t len;
+    chunk_opt_cb_t cb;
+    void* cb_arg;
+    bool zero;
+};
+
+class FakeChunk : public Chunk {
+public:
+    FakeChunk(FlameContext* fct, std::string* data, std::vector<fake_io_t>* issued, const bool* sparse)
+    : Chunk(fct), data_(data), issued_(issued), sparse_(sparse) {}
+
+    virtual int get_info(chunk_info_t& info) const override { return 0; }
+    virtual uint64_t size() const override { return data_->size(); }
+    virtual uint64_t used() const override { return 0; }
+    virtual uint32_t stat() const override { return 0; }
+    virtual uint64_t vol_id() const override { return 0; }
+    virtual uint32_t vol_index() const override { return 0; }
+    virtual uint32_t spolicy() const override { return 0; }
+    virtual bool is_preallocated() const override { return false; }
+    virtual int read_sync(void* buff, uint64_t off, uint64_t len) override { return 0; }
+    virtual int write_sync(void* buff, uint64_t off, uint64_t len) override { return 0; }
+    virtual int get_xattr(const std::string& name, std::string& value) override { return 0; }
+    virtual int set_xattr(const std::string& name, const std::string& value) override { return 0; }
+
+    virtual int read_async(void* buff, uint64_t off, uint64_t len, chunk_opt_cb_t cb, void* cb_arg) override {
+        memcpy(buff, &(*data_)[off], len);
+        issued_->push_back(fake_io_t{false, off, len, cb, cb_arg, false});
+        return 0;
+    }
+
+    virtual int write_async(void* buff, uint64_t off, uint64_t len, chunk_opt_cb_t cb, void* cb_arg) override {
+        memcpy(&(*data_)[off], buff, len);
+        issued_->push_back(fake_io_t{true, off, len, cb, cb_arg, false});
+        return 0;
+    }
+
+    virtual int write_zeros_async(uint64_t off, uint64_t len, chunk_opt_cb_t cb, void* cb_arg) override {
+        memset(&(*data_)[off], 0, len);
+        issued_->push_back(fake_io_t{true, off, len, cb, cb_arg, true});
+        return 0;
+    }
+
+    /**
+     * 打开sparse时，全0的区间视为未分配
+     */
+    virtual bool is_zero(uint64_t off, uint64_t len) override {
+        if (!*sparse_)
+            return false;
+        for (uint64_t i = off; i < off + len; i++) {
+            if ((*data_)[i] != '\0')
+                return false;
+        }
+        return true;
+    }
+
+private:
+    std::string* data_;
+    std::vector<fake_io_t>* issued_;
+    const bool* sparse_;
+}; // class FakeChunk
+
+class FakeChunkStore : public ChunkStore {
+public:
+    FakeChunkStore(FlameContext* fct) : ChunkStore(fct), data_(1 << 20, '\0') {}
+
+    virtual int set_info(const cs_info_t& info) override { return 0; }
+    virtual int get_info(cs_info_t& info) const override { return 0; }
+    virtual std::string get_driver_name() const override { return "fake"; }
+    virtual std::string get_config_info() const override { return ""; }
+    virtual std::string get_runtime_info() const override { return ""; }
+    virtual int get_io_mode() const override { return ASYNC; }
+    virtual int dev_check() override { return 0; }
+    virtual int dev_format() override { return 0; }
+    virtual int dev_mount() override { return 0; }
+    virtual int dev_unmount() override { return 0; }
+    virtual bool is_mounted() override { return true; }
+    virtual int chunk_create(uint64_t chk_id, const chunk_create_opts_t& opts) override { return 0; }
+    virtual int chunk_remove(uint64_t chk_id) override { removed_.insert(chk_id); return 0; }
+    virtual bool chunk_exist(uint64_t chk_id) override { return chk_id != 0 && !removed_.count(chk_id); }
+    virtual std::shared_ptr<Chunk> chunk_open(uint64_t chk_id) override {
+        if (!chunk_exist(chk_id))
+            return nullptr;
+        opens_++;
+        return std::shared_ptr<Chunk>(new FakeChunk(fct_, &data_, &issued_, &sparse_));
+    }
+
+    /**
+     * @brief 完成所有已下发的IO（完成时可能又下发新的IO）
+     */
+    void release() {
+        std::vector<fake_io_t> ios;
+        ios.swap(issued_);
+        for (auto it = ios.begin(); it != ios.end(); it++)
+            it->cb(it->cb_arg);
+    }
+
+    std::string data_;
+    std::vector<fake_io_t> issued_;
+    bool sparse_ {false};
+    std::set<uint64_t> removed_;
+    int opens_ {0};
+}; // class FakeChunkStore
+
+struct io_result_t {
+    int called {0};
+    int rc {-1};
+};
+
+static void io_cb(chunk_io_t* io, int rc) {
+    io_result_t* r = (io_result_t*)io->cb_arg;
+    r->called++;
+    r->rc = rc;
+}
+
+static void make_io(chunk_io_t& io, uint64_t chk_id, bool write, uint64_t off, uint64_t len, void* buff, io_result_t* r) {
+    memset(&io, 0, sizeof(io));
+    io.chk_id = chk_id;
+    io.write = write;
+    io.off = off;
+    io.len = len;
+    io.buff = buff;
+    io.cb = io_cb;
+    io.cb_arg = r;
+}
+
+TEST_F(TestChunkIoSched, MergeWrites)
+{
+    CsdContext cct(FlameContext::get_context());
+    FakeChunkStore* cs = new FakeChunkStore(cct.fct());
+    cct.cs(std::shared_ptr<ChunkStore>(cs));
+    ChunkIoScheduler sched(&cct, 0, 1 << 20, 1);
+
+    // 第一个写立即下发，Chunk进入在途状态
+    char a[4096], b[4096], c[4096], d[2048];
+    memset(a, 'a', sizeof(a));
+    memset(b, 'b', sizeof(b));
+    memset(c, 'c', sizeof(c));
+    memset(d, 'd', sizeof(d));
+    io_result_t r[4];
+    chunk_io_t ios[4];
+    make_io(ios[0], 1, true, 0, sizeof(a), a, &r[0]);
+    ASSERT_EQ(sched.submit(&ios[0]), RC_SUCCESS);
+    ASSERT_EQ(cs->issued_.size(), 1);
+
+    // 在途期间到达的相邻与重叠的写合并为一个IO，重叠部分以后到达的为准
+    make_io(ios[1], 1, true, 12288, sizeof(c), c, &r[1]);
+    make_io(ios[2], 1, true, 8192, sizeof(b), b, &r[2]);
+    make_io(ios[3], 1, true, 10240, sizeof(d), d, &r[3]);
+    for (int i = 1; i < 4; i++)
+        ASSERT_EQ(sched.submit(&ios[i]), RC_SUCCESS);
+    ASSERT_EQ(cs->issued_.size(), 1);
+
+    cs->release();
+    ASSERT_EQ(r[0].called, 1);
+    ASSERT_EQ(cs->issued_.size(), 1);
+    ASSERT_EQ(cs->issued_[0].off, 8192);
+    ASSERT_EQ(cs->issued_[0].len, 8192);
+    cs->release();
+    for (int i = 0; i < 4; i++) {
+        ASSERT_EQ(r[i].called, 1);
+        ASSERT_EQ(r[i].rc, RC_SUCCESS);
+    }
+    ASSERT_EQ(cs->data_[8192], 'b');
+    ASSERT_EQ(cs->data_[10240], 'd');
+    ASSERT_EQ(cs->data_[12287], 'd');
+    ASSERT_EQ(cs->data_[12288], 'c');
+
+    chunk_sched_stat_t st;
+    sched.collect(st);
+    ASSERT_EQ(st.io_cnt, 4);
+    ASSERT_EQ(st.issue_cnt, 2);
+}
+
+TEST_F(TestChunkIoSched, ReadAfterWrite)
+{
+    CsdContext cct(FlameContext::get_context());
+    FakeChunkStore* cs = new FakeChunkStore(cct.fct());
+    cct.cs(std::shared_ptr<ChunkStore>(cs));
+    ChunkIoScheduler sched(&cct, 0, 1 << 20, 4);
+
+    char w0[4096], w1[4096], rd[8192];
+    memset(w0, 'x', sizeof(w0));
+    memset(w1, 'y', sizeof(w1));
+    io_result_t r[3];
+    chunk_io_t ios[3];
+    make_io(ios[0], 1, true, 0, sizeof(w0), w0, &r[0]);
+    make_io(ios[1], 1, false, 0, sizeof(rd), rd, &r[1]);
+    make_io(ios[2], 1, true, 4096, sizeof(w1), w1, &r[2]);
+    for (int i = 0; i < 3; i++)
+        ASSERT_EQ(sched.submit(&ios[i]), RC_SUCCESS);
+
+    // 读写之间不重排：读看到第一个写，看不到第二个写
+    cs->release();
+    ASSERT_EQ(cs->issued_.size(), 1);
+    ASSERT_FALSE(cs->issued_[0].write);
+    cs->release();
+    cs->release();
+    ASSERT_EQ(rd[0], 'x');
+    ASSERT_EQ(rd[4096], '\0');
+    ASSERT_EQ(cs->data_[4096], 'y');
+    for (int i = 0; i < 3; i++)
+        ASSERT_EQ(r[i].called, 1);
+
+    chunk_io_t io;
+    io_result_t nr;
+    make_io(io, 0, false, 0, sizeof(rd), rd, &nr);
+    ASSERT_EQ(sched.submit(&io), RC_OBJ_NOT_FOUND);
+}
+
+TEST_F(TestChunkIoSched, FairAcrossVolumes)
+{
+    CsdContext cct(FlameContext::get_context());
+    FakeChunkStore* cs = new FakeChunkStore(cct.fct());
+    cct.cs(std::shared_ptr<ChunkStore>(cs));
+    ChunkIoScheduler sched(&cct, 0, 4096, 1);
+
+    // 卷1的三个Chunk先就绪，卷2的一个Chunk后就绪，两个卷交替下发：A B D C
+    char buff[4][4096];
+    io_result_t r[4];
+    chunk_io_t ios[4];
+    uint64_t chks[4] = {
+        chunk_id_t(1, 0, 0), chunk_id_t(1, 1, 0), chunk_id_t(1, 2, 0), chunk_id_t(2, 0, 0)
+    };
+    for (int i = 0; i < 4; i++) {
+        make_io(ios[i], chks[i], false, 0, 4096, buff[i], &r[i]);
+        ASSERT_EQ(sched.submit(&ios[i]), RC_SUCCESS);
+    }
+    ASSERT_EQ(r[0].called, 0);
+    cs->release();
+    ASSERT_EQ(r[0].called, 1);
+    cs->release();
+    ASSERT_EQ(r[1].called, 1);
+    cs->release();
+    ASSERT_EQ(r[3].called, 1);
+    ASSERT_EQ(r[2].called, 0);
+    cs->release();
+    ASSERT_EQ(r[2].called, 1);
+}
+
+TEST_F(TestChunkIoSched, WriteZerosAndHoleRead)
+{
+    CsdContext cct(FlameContext::get_context());
+    FakeChunkStore* cs = new FakeChunkStore(cct.fct());
+    cct.cs(std::shared_ptr<ChunkStore>(cs));
+    ChunkIoScheduler sched(&cct, 0, 4096, 1);
+    cs->sparse_ = true;
+    memset(&cs->data_[0], 'z', 65536);
+
+    // 在途的写之后，相邻的清零写合并为一个IO（不受合并长度限制），与普通写不合并
+    char w[4096], rd[8192], hole[4096];
+    memset(w, 'w', sizeof(w));
+    memset(rd, 'r', sizeof(rd));
+    memset(hole, 'h', sizeof(hole));
+    io_result_t r[5];
+    chunk_io_t ios[5];
+    make_io(ios[0], 1, true, 0, sizeof(w), w, &r[0]);
+    make_io(ios[1], 1, true, 8192, 16384, nullptr, &r[1]);
+    ios[1].zero = true;
+    make_io(ios[2], 1, true, 24576, 8192, nullptr, &r[2]);
+    ios[2].zero = true;
+    make_io(ios[3], 1, false, 8192, sizeof(rd), rd, &r[3]);
+    make_io(ios[4], 1, false, 0, sizeof(hole), hole, &r[4]);
+    for (int i = 0; i < 5; i++)
+        ASSERT_EQ(sched.submit(&ios[i]), RC_SUCCESS);
+
+    cs->release();
+    ASSERT_EQ(cs->issued_.size(), 1);
+    ASSERT_TRUE(cs->issued_[0].zero);
+    ASSERT_EQ(cs->issued_[0].off, 8192);
+    ASSERT_EQ(cs->issued_[0].len, 24576);
+    cs->release();
+
+    // 清零后的区间不下发读，直接填0；有数据的区间正常读
+    ASSERT_EQ(r[3].called, 1);
+    ASSERT_TRUE(ios[3].zero);
+    ASSERT_EQ(rd[0], '\0');
+    ASSERT_EQ(rd[8191], '\0');
+    ASSERT_EQ(r[4].called, 0);
+    ASSERT_EQ(cs->issued_.size(), 1);
+    cs->release();
+    ASSERT_EQ(r[4].called, 1);
+    ASSERT_FALSE(ios[4].zero);
+    ASSERT_EQ(hole[0], 'w');
+
+    chunk_sched_stat_t st;
+    sched.collect(st);
+    ASSERT_EQ(st.zero_rd, 1);
+}
+
+TEST_F(TestChunkIoSched, ChunkRemove)
+{
+    CsdContext cct(FlameContext::get_context());
+    FakeChunkStore* cs = new FakeChunkStore(cct.fct());
+    cct.cs(std::shared_ptr<ChunkStore>(cs));
+    ChunkIoScheduler sched(&cct, 0, 1 << 20, 1);
+
+    char w[4096];
+    memset(w, 'w', sizeof(w));
+    io_result_t r[3];
+    chunk_io_t ios[3];
+    make_io(ios[0], 1, true, 0, sizeof(w), w, &r[0]);
+    ASSERT_EQ(sched.submit(&ios[0]), RC_SUCCESS);
+    ASSERT_EQ(cs->opens_, 1);
+
+    // 删除时仍有在途IO，队列保留到IO完成
+    cs->chunk_remove(1);
+    sched.chunk_remove(1);
+    ASSERT_EQ(sched.chunks_.size(), 1);
+    cs->release();
+    ASSERT_EQ(r[0].called, 1);
+    ASSERT_EQ(r[0].rc, RC_SUCCESS);
+    ASSERT_TRUE(sched.chunks_.empty());
+
+    // 已删除的Chunk不能再提交IO
+    make_io(ios[1], 1, true, 0, sizeof(w), w, &r[1]);
+    ASSERT_EQ(sched.submit(&ios[1]), RC_OBJ_NOT_FOUND);
+
+    // 同一id重新创建后重新打开
+    cs->removed_.erase(1);
+    make_io(ios[2], 1, true, 0, sizeof(w), w, &r[2]);
+    ASSERT_EQ(sched.submit(&ios[2]), RC_SUCCESS);
+    ASSERT_EQ(cs->opens_, 2);
+    cs->release();
+    ASSERT_EQ(r[2].called, 1);
+
+    // 空闲的队列删除时立即释放
+    sched.chunk_remove(1);
+    ASSERT_TRUE(sched.chunks_.empty());
+}
+
+TEST_F(TestChunkIoSched, StopFailsThrottled)
+{
+    CsdContext cct(FlameContext::get_context());
+    FakeChunkStore* cs = new FakeChunkStore(cct.fct());
+    cct.cs(std::shared_ptr<ChunkStore>(cs));
+    ChunkIoScheduler sched(&cct, 0, 1 << 20, 1);
+    sched.run();
+
+    qos_attr_t attr;
+    attr.type = QOS_TYPE_VOL;
+    attr.id = 1;
+    attr.lim_iops = 1;
+    attr.burst_iops = 1;
+    sched.qos_set(std::list<qos_attr_t>(1, attr));
+
+    uint64_t chk_id = chunk_id_t(1, 0, 0);
+    char w[4096];
+    memset(w, 'w', sizeof(w));
+    io_result_t r[3];
+    chunk_io_t ios[3];
+    make_io(ios[0], chk_id, true, 0, sizeof(w), w, &r[0]);
+    make_io(ios[1], chk_id, true, 4096, sizeof(w), w, &r[1]);
+    ASSERT_EQ(sched.submit(&ios[0]), RC_SUCCESS);
+    ASSERT_EQ(sched.submit(&ios[1]), RC_SUCCESS);
+    ASSERT_EQ(cs->issued_.size(), 1);
+
+    // 被限流的IO在停止时以失败完成，已下发的IO正常完成
+    sched.stop();
+    ASSERT_EQ(r[1].called, 1);
+    ASSERT_EQ(r[1].rc, RC_FAILD);
+    ASSERT_EQ(r[0].called, 0);
+    cs->release();
+    ASSERT_EQ(r[0].called, 1);
+    ASSERT_EQ(r[0].rc, RC_SUCCESS);
+
+    // 停止后不再接受IO
+    make_io(ios[2], chk_id, true, 0, sizeof(w), w, &r[2]);
+    ASSERT_EQ(sched.submit(&ios[2]), RC_FAILD);
+    ASSERT_EQ(r[2].called, 0);
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
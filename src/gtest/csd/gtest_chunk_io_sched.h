@@ -0,0 +1,27 @@
+#include <gtest/gtest.h>
+#include <iostream>
+
+#ifdef GTEST
+#define private public
+#define protected public
+#endif
+#include "csd/chunk_io_sched.h"
+
+using namespace std;
+using namespace flame;
+
+class TestChunkIoSched:public testing::Test
+{
+public:
+    static void SetUpTestCase(){    
+    }
+ 
+    static void TearDownTestCase(){  
+    }
+    
+    void SetUp(){
+    }
+
+    void TearDown(){
+    }  
+};// class TestChunkIoSched
@@ -0,0 +1,168 @@
+#include "gtest/csd/gtest_chunk_migrator.h"
+#include "include/retcode.h"
+
+#include <memory>
+using namespace flame;
+
+/**
+ * 直接构造迁移任务，验证IO路径上的write_begin()/write_end()
+ */
+static std::shared_ptr<ChunkMigrator::MigrateTask> add_task(ChunkMigrator& mig, uint64_t chk_id, int stat, uint64_t seg_num) {
+    chunk_move_attr_t attr;
+    attr.chk_id = chk_id;
+    std::shared_ptr<ChunkMigrator::MigrateTask> task(new ChunkMigrator::MigrateTask(attr));
+    task->stat = stat;
+    task->dirty.assign((seg_num + 63) / 64, 0);
+    mig.tasks_[chk_id] = task;
+    return task;
+}
+
+TEST_F(TestChunkMigrator, DirtyTracking)
+{
+    CsdContext cct(FlameContext::get_context());
+    ChunkMigrator mig(&cct, nullptr, 4096, 0);
+    auto task = add_task(mig, 1, MIG_STAT_COPY, 128);
+
+    // 不在迁移中的Chunk不受影响
+    ASSERT_EQ(mig.write_begin(2, 0, 4096), MIG_WRITE_OK);
+    mig.write_end(2, 0, 4096);
+
+    // 写入完成时才标记，跨越数据段边界的写入标记两个数据段，重复标记不重复计数
+    ASSERT_EQ(mig.write_begin(1, 4000, 200), MIG_WRITE_OK);
+    ASSERT_EQ(mig.write_begin(1, 4096, 100), MIG_WRITE_OK);
+    ASSERT_EQ(task->inflight, 2);
+    ASSERT_EQ(task->dirty_cnt, 0);
+    mig.write_end(1, 4000, 200);
+    mig.write_end(1, 4096, 100);
+    ASSERT_EQ(task->dirty_cnt, 2);
+    ASSERT_EQ(task->dirty[0], 3ULL);
+
+    // 第65个数据段在位图的第二个字上
+    ASSERT_EQ(mig.write_begin(1, 64 * 4096, 1), MIG_WRITE_OK);
+    mig.write_end(1, 64 * 4096, 1);
+    ASSERT_EQ(task->dirty[1], 1ULL);
+    ASSERT_EQ(task->dirty_cnt, 3);
+    ASSERT_EQ(task->inflight, 0);
+    ASSERT_TRUE(mig.is_moving(1));
+}
+
+/**
+ * 写入期间一轮拷贝取走了脏数据段，写入完成时重新标记，下一轮再拷贝
+ */
+TEST_F(TestChunkMigrator, DirtyAfterTake)
+{
+    CsdContext cct(FlameContext::get_context());
+    ChunkMigrator mig(&cct, nullptr, 4096, 0);
+    auto task = add_task(mig, 1, MIG_STAT_COPY, 16);
+    task->dirty[0] = 0xffff;
+    task->dirty_cnt = 16;
+
+    ASSERT_EQ(mig.write_begin(1, 8192, 4096), MIG_WRITE_OK);
+    std::list<uint64_t> segs;
+    mig.take_dirty__(task, segs);
+    ASSERT_EQ(segs.size(), 16U);
+    ASSERT_EQ(task->dirty_cnt, 0);
+
+    mig.write_end(1, 8192, 4096);
+    segs.clear();
+    mig.take_dirty__(task, segs);
+    ASSERT_EQ(segs.size(), 1U);
+    ASSERT_EQ(segs.front(), 2U);
+}
+
+static int resumed = 0;
+static void resume(void* arg) {
+    ChunkMigrator* mig = (ChunkMigrator*)arg;
+    resumed++;
+    // 迁移结束后重新调用write_begin()
+    if (mig->write_begin(1, 0, 4096) == MIG_WRITE_OK)
+        mig->write_end(1, 0, 4096);
+}
+
+/**
+ * 最终追赶期间写入不阻塞，推迟到迁移结束后回调
+ */
+TEST_F(TestChunkMigrator, CatchupDefersWrites)
+{
+    CsdContext cct(FlameContext::get_context());
+    ChunkMigrator mig(&cct, nullptr, 4096, 0);
+    auto task = add_task(mig, 1, MIG_STAT_COPY, 16);
+
+    // 追赶开始前的在途写入在追赶期间完成，仍然标记
+    ASSERT_EQ(mig.write_begin(1, 0, 4096), MIG_WRITE_OK);
+    task->stat = MIG_STAT_CATCHUP;
+    mig.write_end(1, 0, 4096);
+    ASSERT_EQ(task->dirty_cnt, 1);
+
+    resumed = 0;
+    ASSERT_EQ(mig.write_begin(1, 0, 4096, resume, &mig), MIG_WRITE_DEFERRED);
+    ASSERT_EQ(mig.write_begin(1, 4096, 4096, resume, &mig), MIG_WRITE_DEFERRED);
+    ASSERT_EQ(task->inflight, 0);
+    ASSERT_EQ(task->deferred.size(), 2U);
+    ASSERT_EQ(resumed, 0);
+
+    // 迁移失败：任务释放后推迟的写入在本地进行
+    mig.finish__(task, MIG_STAT_FAILD);
+    ASSERT_EQ(resumed, 2);
+    ASSERT_TRUE(task->deferred.empty());
+    ASSERT_FALSE(mig.is_moving(1));
+
+    // 迁移成功：推迟的写入被拒绝
+    task = add_task(mig, 1, MIG_STAT_CATCHUP, 16);
+    ASSERT_EQ(mig.write_begin(1, 0, 4096, resume, &mig), MIG_WRITE_DEFERRED);
+    mig.finish__(task, MIG_STAT_DONE);
+    ASSERT_EQ(resumed, 3);
+    ASSERT_EQ(mig.write_begin(1, 0, 4096), MIG_WRITE_MOVED);
+    ASSERT_EQ(task->inflight, 0);
+}
+
+TEST_F(TestChunkMigrator, SwitchedTaskRejectsWrites)
+{
+    CsdContext cct(FlameContext::get_context());
+    ChunkMigrator mig(&cct, nullptr, 4096, 0);
+    auto task = add_task(mig, 1, MIG_STAT_COPY, 16);
+    ASSERT_EQ(mig.write_begin(1, 0, 4096), MIG_WRITE_OK);
+
+    // 映射切换后任务保留，新的写入被拒绝
+    mig.finish__(task, MIG_STAT_DONE);
+    ASSERT_TRUE(mig.is_moving(1));
+    ASSERT_EQ(mig.write_begin(1, 0, 4096), MIG_WRITE_MOVED);
+    ASSERT_EQ(mig.done_count(), 1);
+
+    // 本地Chunk删除后，任务保留到最后一个在途写入返回
+    mig.release__(task);
+    ASSERT_TRUE(mig.is_moving(1));
+    ASSERT_EQ(mig.write_begin(1, 0, 4096), MIG_WRITE_MOVED);
+    mig.write_end(1, 0, 4096);
+    ASSERT_FALSE(mig.is_moving(1));
+    ASSERT_EQ(mig.write_begin(1, 0, 4096), MIG_WRITE_OK);
+    mig.write_end(1, 0, 4096);
+
+    // 没有在途写入时立即释放
+    task = add_task(mig, 2, MIG_STAT_COPY, 16);
+    mig.finish__(task, MIG_STAT_DONE);
+    mig.release__(task);
+    ASSERT_FALSE(mig.is_moving(2));
+}
+
+TEST_F(TestChunkMigrator, FaildTaskReleased)
+{
+    CsdContext cct(FlameContext::get_context());
+    ChunkMigrator mig(&cct, nullptr, 4096, 0);
+    auto task = add_task(mig, 1, MIG_STAT_COPY, 16);
+    ASSERT_EQ(mig.write_begin(1, 0, 4096), MIG_WRITE_OK);
+
+    // 迁移失败时立即释放任务，写入继续在本地进行
+    mig.finish__(task, MIG_STAT_FAILD);
+    ASSERT_FALSE(mig.is_moving(1));
+    ASSERT_EQ(mig.faild_count(), 1);
+    mig.write_end(1, 0, 4096);
+    ASSERT_EQ(task->inflight, 1);
+    ASSERT_EQ(mig.write_begin(1, 0, 4096), MIG_WRITE_OK);
+    mig.write_end(1, 0, 4096);
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,27 @@
+#include <gtest/gtest.h>
+#include <iostream>
+
+#ifdef GTEST
+#define private public
+#define protected public
+#endif
+#include "csd/chunk_migrator.h"
+
+using namespace std;
+using namespace flame;
+
+class TestChunkMigrator:public testing::Test
+{
+public:
+    static void SetUpTestCase(){    
+    }
+ 
+    static void TearDownTestCase(){  
+    }
+    
+    void SetUp(){
+    }
+
+    void TearDown(){
+    }  
+};// class TestChunkMigrator
@@ -0,0 +1,154 @@
+#include "gtest/csd/gtest_chunk_qos.h"
+#include "include/retcode.h"
+
+#include <cstring>
+#include <vector>
+using namespace flame;
+
+#define MS  1000000ULL
+
+static void make_io(chunk_io_t& io, uint64_t vol_id, uint64_t client_id, uint64_t len, uint64_t now) {
+    memset(&io, 0, sizeof(io));
+    io.chk_id = chunk_id_t(vol_id, 0, 0);
+    io.len = len;
+    io.client_id = client_id;
+    io.enqueue_ns = now;
+}
+
+static qos_attr_t make_attr(uint32_t type, uint64_t id) {
+    qos_attr_t attr;
+    attr.type = type;
+    attr.id = id;
+    return attr;
+}
+
+TEST_F(TestChunkQos, IopsLimit)
+{
+    ChunkQos qos;
+    uint64_t now = 1000 * MS;
+    qos_attr_t attr = make_attr(QOS_TYPE_VOL, 1);
+    attr.lim_iops = 10;
+    attr.burst_iops = 2;
+    qos.set(attr, now);
+
+    // 突发量内直接放行，之后每100ms放行一个
+    chunk_io_t ios[4];
+    for (int i = 0; i < 4; i++)
+        make_io(ios[i], 1, 0, 4096, now);
+    ASSERT_TRUE(qos.admit(&ios[0], now));
+    ASSERT_TRUE(qos.admit(&ios[1], now));
+    ASSERT_FALSE(qos.admit(&ios[2], now));
+    ASSERT_FALSE(qos.admit(&ios[3], now));
+    ASSERT_GT(qos.next_ns(), now + 50 * MS);
+    ASSERT_LE(qos.next_ns(), now + 101 * MS);
+
+    std::vector<chunk_io_t*> res;
+    qos.release(now + 50 * MS, res);
+    ASSERT_EQ(res.size(), 0);
+    qos.release(now + 101 * MS, res);
+    ASSERT_EQ(res.size(), 1);
+    ASSERT_EQ(res[0], &ios[2]);
+    qos.release(now + 201 * MS, res);
+    ASSERT_EQ(res.size(), 2);
+    ASSERT_EQ(res[1], &ios[3]);
+    ASSERT_EQ(qos.next_ns(), UINT64_MAX);
+
+    // 其他卷不受影响
+    chunk_io_t other;
+    make_io(other, 2, 0, 4096, now);
+    ASSERT_TRUE(qos.admit(&other, now));
+
+    std::list<chunk_qos_stat_t> stats;
+    qos.collect(stats);
+    ASSERT_EQ(stats.size(), 1);
+    ASSERT_EQ(stats.front().passed, 2);
+    ASSERT_EQ(stats.front().throttled, 2);
+    ASSERT_GE(stats.front().delay_max, 200000);
+}
+
+TEST_F(TestChunkQos, BandwidthAndClient)
+{
+    ChunkQos qos;
+    uint64_t now = 1000 * MS;
+    qos_attr_t attr = make_attr(QOS_TYPE_CLIENT, 7);
+    attr.lim_bps = 4096;
+    qos.set(attr, now);
+
+    // 大于突发量的IO可以透支通过，之后的IO等待透支补齐
+    chunk_io_t ios[2];
+    make_io(ios[0], 1, 7, 8192, now);
+    make_io(ios[1], 2, 7, 4096, now);
+    ASSERT_TRUE(qos.admit(&ios[0], now));
+    ASSERT_FALSE(qos.admit(&ios[1], now));
+
+    std::vector<chunk_io_t*> res;
+    qos.release(now + 900 * MS, res);
+    ASSERT_EQ(res.size(), 0);
+    qos.release(now + 1001 * MS, res);
+    ASSERT_EQ(res.size(), 1);
+
+    // 清除后不再限流
+    qos.set(make_attr(QOS_TYPE_CLIENT, 7), now);
+    ASSERT_TRUE(qos.ents_.empty());
+    chunk_io_t io;
+    make_io(io, 1, 7, 1 << 20, now);
+    ASSERT_TRUE(qos.admit(&io, now));
+}
+
+TEST_F(TestChunkQos, WeightAndReservation)
+{
+    ChunkQos qos;
+    uint64_t now = 1000 * MS;
+    qos_attr_t attr = make_attr(QOS_TYPE_VOL, 1);
+    attr.weight = 4;
+    attr.rsv_iops = 100;
+    qos.set(attr, now);
+    ASSERT_EQ(qos.weight(1), 4);
+    ASSERT_EQ(qos.weight(2), 1);
+    ASSERT_TRUE(qos.has_reservation());
+
+    ASSERT_TRUE(qos.reserve_ready(1, now));
+    ASSERT_FALSE(qos.reserve_ready(2, now));
+    qos.reserve_take(1, 64);
+    ASSERT_FALSE(qos.reserve_ready(1, now));
+    ASSERT_TRUE(qos.reserve_ready(1, now + 1000 * MS));
+
+    qos.set(make_attr(QOS_TYPE_VOL, 1), now);
+    ASSERT_FALSE(qos.has_reservation());
+}
+
+TEST_F(TestChunkQos, Drain)
+{
+    ChunkQos qos;
+    uint64_t now = 1000 * MS;
+    qos_attr_t attr = make_attr(QOS_TYPE_VOL, 1);
+    attr.lim_iops = 1;
+    attr.burst_iops = 1;
+    qos.set(attr, now);
+
+    chunk_io_t ios[3];
+    for (int i = 0; i < 3; i++)
+        make_io(ios[i], 1, 0, 4096, now);
+    ASSERT_TRUE(qos.admit(&ios[0], now));
+    ASSERT_FALSE(qos.admit(&ios[1], now));
+    ASSERT_FALSE(qos.admit(&ios[2], now));
+
+    // 已清除但仍有排队IO的实体在取出后删除
+    qos.set(make_attr(QOS_TYPE_VOL, 1), now);
+    ASSERT_EQ(qos.ents_.size(), 1);
+
+    std::vector<chunk_io_t*> res;
+    qos.drain(res);
+    ASSERT_EQ(res.size(), 2);
+    ASSERT_EQ(res[0], &ios[1]);
+    ASSERT_EQ(res[1], &ios[2]);
+    ASSERT_TRUE(qos.waiting_.empty());
+    ASSERT_TRUE(qos.ents_.empty());
+    ASSERT_EQ(qos.next_ns(), UINT64_MAX);
+}
+
+int main(int argc, char  **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
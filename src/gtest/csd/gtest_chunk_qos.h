@@ -0,0 +1,28 @@
+#include <gtest/gtest.h>
+#include <iostream>
+
+#ifdef GTEST
+#define private public
+#define protected public
+#endif
+#include "csd/chunk_qos.h"
+#include "csd/chunk_io_sched.h"
+
+using namespace std;
+using namespace flame;
+
+class TestChunkQos:public testing::Test
+{
+public:
+    static void SetUpTestCase(){    
+    }
+ 
+    static void TearDownTestCase(){  
+    }
+    
+    void SetUp(){
+    }
+
+    void TearDown(){
+    }  
+};// class TestChunkQos
@@ -0,0 +1,213 @@
+#include "gtest/libchunk/gtest_cmd_cq.h"
+#include "include/csdc.h"
+#include "include/retcode.h"
+#include "msg/msg_context.h"
+
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <cstring>
+#include <chrono>
+using namespace flame;
+
+struct cq_result_t {
+    int called {0};
+    cmd_rc_t rc {0};
+};
+
+static void cq_cb(const Response& res, void* arg) {
+    cq_result_t* r = (cq_result_t*)arg;
+    r->called++;
+    r->rc = res.get_rc();
+}
+
+static void make_write(cmd_t& cmd) {
+    memset(&cmd, 0, sizeof(cmd));
+    cmd.hdr.cn.cls = CMD_CLS_IO_CHK;
+    cmd.hdr.cn.seq = CMD_CHK_IO_WRITE;
+}
+
+static void make_res(cmd_res_t& res, const cmd_t& cmd, cmd_rc_t rc) {
+    memset(&res, 0, sizeof(res));
+    res.hdr.cn = cmd.hdr.cn;
+    res.hdr.cqg = cmd.hdr.cqg;
+    res.hdr.cqn = cmd.hdr.cqn;
+    res.rc = rc;
+}
+
+TEST_F(TestCmdCq, Complete)
+{
+    CmdCompletionTable table(1, 4, 0);
+    cq_result_t r;
+    cmd_t cmd;
+    make_write(cmd);
+    ASSERT_EQ(table.prepare(&cmd, cq_cb, &r), RC_SUCCESS);
+    ASSERT_EQ(table.inflight(), 1);
+
+    cmd_res_t res;
+    make_res(res, cmd, 3);
+    ASSERT_EQ(table.complete(res, nullptr, 0), RC_SUCCESS);
+    ASSERT_EQ(r.called, 1);
+    ASSERT_EQ(r.rc, 3);
+    ASSERT_EQ(table.inflight(), 0);
+
+    // 重复的响应被丢弃
+    ASSERT_EQ(table.complete(res, nullptr, 0), RC_OBJ_NOT_FOUND);
+    ASSERT_EQ(r.called, 1);
+    ASSERT_EQ(table.stale(), 1);
+}
+
+TEST_F(TestCmdCq, Full)
+{
+    CmdCompletionTable table(1, 3, 0);     // 深度取整为4
+    cq_result_t r;
+    cmd_t cmds[5];
+    for (int i = 0; i < 4; i++) {
+        make_write(cmds[i]);
+        ASSERT_EQ(table.prepare(&cmds[i], cq_cb, &r), RC_SUCCESS);
+    }
+    make_write(cmds[4]);
+    ASSERT_EQ(table.prepare(&cmds[4], cq_cb, &r), RC_REFUSED);
+
+    table.cancel(&cmds[0]);
+    ASSERT_EQ(table.prepare(&cmds[4], cq_cb, &r), RC_SUCCESS);
+    // 复用同一个槽，但cqn的代数不同
+    ASSERT_NE(cmds[4].hdr.cqn, cmds[0].hdr.cqn);
+    ASSERT_EQ(cmds[4].hdr.cqn & 3, cmds[0].hdr.cqn & 3);
+
+    cmd_res_t res;
+    make_res(res, cmds[0], 0);
+    ASSERT_EQ(table.complete(res, nullptr, 0), RC_OBJ_NOT_FOUND);
+    make_res(res, cmds[4], 0);
+    ASSERT_EQ(table.complete(res, nullptr, 0), RC_SUCCESS);
+    ASSERT_EQ(r.called, 1);
+}
+
+TEST_F(TestCmdCq, Timeout)
+{
+    CmdCompletionTable table(1, 8, 1000);
+    cq_result_t r;
+    cmd_t cmd;
+    make_write(cmd);
+    ASSERT_EQ(table.prepare(&cmd, cq_cb, &r), RC_SUCCESS);
+
+    uint64_t now = utime_t::now().to_usec();
+    ASSERT_EQ(table.expire(now), 0);
+    ASSERT_EQ(table.expire(now + 1000000), 1);
+    ASSERT_EQ(r.called, 1);
+    ASSERT_EQ(r.rc, RC_TIMEOUT);
+
+    // 超时后才到达的响应
+    cmd_res_t res;
+    make_res(res, cmd, 0);
+    ASSERT_EQ(table.complete(res, nullptr, 0), RC_OBJ_NOT_FOUND);
+    ASSERT_EQ(r.called, 1);
+}
+
+/**
+ * 响应丢失且没有新的提交时，由工作线程的定时任务以RC_TIMEOUT完成命令
+ */
+TEST_F(TestCmdCq, TimerExpire)
+{
+    msg::MsgContext mct(FlameContext::get_context());
+    msg::ThrMsgWorker worker(&mct, 0);
+    worker.start();
+
+    CmdCompletionTable table(1, 8, 20 * 1000);
+    std::atomic<int> called {0};
+    cmd_t cmd;
+    make_write(cmd);
+    ASSERT_EQ(table.prepare(&cmd, [](const Response& res, void* arg) {
+        if (res.get_rc() == RC_TIMEOUT)
+            (*(std::atomic<int>*)arg)++;
+    }, &called), RC_SUCCESS);
+    table.start_expire_timer(&worker);
+
+    for (int i = 0; i < 200 && called.load() == 0; i++)
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    ASSERT_EQ(called.load(), 1);
+    ASSERT_EQ(table.inflight(), 0U);
+
+    table.stop_expire_timer();
+    worker.stop();
+}
+
+TEST_F(TestCmdCq, ReadInline)
+{
+    CmdCompletionTable table(1, 8, 0);
+    char buf[16] = {0};
+    cmd_t cmd;
+    memset(&cmd, 0, sizeof(cmd));
+    ChunkReadCmd read_cmd(&cmd, 1, 0, sizeof(buf));
+    ((cmd_chk_io_rd_t*)read_cmd.get_content())->ma.addr = (uint64_t)buf;
+    cq_result_t r;
+    ASSERT_EQ(table.prepare(&cmd, cq_cb, &r), RC_SUCCESS);
+
+    cmd_res_t res;
+    make_res(res, cmd, 0);
+    char data[] = "abcdefg";
+    ASSERT_EQ(table.complete(res, data, sizeof(data)), RC_SUCCESS);
+    ASSERT_STREQ(buf, "abcdefg");
+}
+
+TEST_F(TestCmdCq, MultiThread)
+{
+    const int thr_num = 4;
+    const int per_thr = 20000;
+    CmdCompletionTable table(2, 64, 0);
+    std::atomic<int> done {0};
+    std::vector<std::thread> thrs;
+    for (int t = 0; t < thr_num; t++) {
+        thrs.emplace_back([&] () {
+            cq_result_t r;
+            std::vector<cmd_t> pending;
+            for (int i = 0; i < per_thr; i++) {
+                cmd_t cmd;
+                make_write(cmd);
+                while (table.prepare(&cmd, cq_cb, &r) != RC_SUCCESS) {
+                    // 队列满时先完成一部分，队列也可能被同组的其他线程占满
+                    if (pending.empty()) {
+                        std::this_thread::yield();
+                        continue;
+                    }
+                    cmd_res_t res;
+                    make_res(res, pending.back(), 0);
+                    ASSERT_EQ(table.complete(res, nullptr, 0), RC_SUCCESS);
+                    pending.pop_back();
+                }
+                pending.push_back(cmd);
+            }
+            for (auto it = pending.begin(); it != pending.end(); it++) {
+                cmd_res_t res;
+                make_res(res, *it, 0);
+                ASSERT_EQ(table.complete(res, nullptr, 0), RC_SUCCESS);
+            }
+            done += r.called;
+        });
+    }
+    for (auto it = thrs.begin(); it != thrs.end(); it++)
+        it->join();
+    ASSERT_EQ(done.load(), thr_num * per_thr);
+    ASSERT_EQ(table.inflight(), 0);
+    ASSERT_EQ(table.stale(), 0);
+}
+
+TEST_F(TestCmdCq, BatchHist)
+{
+    CmdCompletionTable table(1, 8, 0);
+    table.record_batch(0);
+    table.record_batch(1);
+    table.record_batch(3);
+    table.record_batch(16);
+    table.record_batch(1000);
+    ASSERT_EQ(table.get_batch_hist(0), 1);
+    ASSERT_EQ(table.get_batch_hist(1), 1);
+    ASSERT_EQ(table.get_batch_hist(4), 1);
+    ASSERT_EQ(table.get_batch_hist(CMD_CQ_BATCH_HIST_BUCKETS - 1), 1);
+}
+
+int main(int argc, char  **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
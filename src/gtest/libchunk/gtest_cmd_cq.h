@@ -0,0 +1,27 @@
+#include <gtest/gtest.h>
+#include <iostream>
+
+#ifdef GTEST
+#define private public
+#define protected public
+#endif
+#include "libflame/libchunk/cmd_cq.h"
+
+using namespace std;
+using namespace flame;
+
+class TestCmdCq:public testing::Test
+{
+public:
+    static void SetUpTestCase(){    
+    }
+ 
+    static void TearDownTestCase(){  
+    }
+    
+    void SetUp(){
+    }
+
+    void TearDown(){
+    }  
+};// class TestCmdCq
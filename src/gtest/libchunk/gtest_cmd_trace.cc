@@ -0,0 +1,102 @@
+#include "gtest/libchunk/gtest_cmd_trace.h"
+#include "include/csdc.h"
+
+#include <cstring>
+using namespace flame;
+
+TEST_F(TestCmdTrace, HistIndex)
+{
+    // 小于2^SUB_BITS的值精确计数
+    for (uint64_t v = 0; v < 8; v++) {
+        EXPECT_EQ((int)v, CmdLatHist::index(v));
+        EXPECT_EQ(v, CmdLatHist::lower(v));
+    }
+    // 桶的下界单调递增，且值落在[lower(idx), lower(idx + 1))
+    uint64_t vals[] = {8, 9, 15, 16, 17, 100, 1000, 123456, 1ULL << 40, UINT64_MAX};
+    for (uint64_t v : vals) {
+        int idx = CmdLatHist::index(v);
+        ASSERT_LT(idx, CMD_HIST_BUCKETS);
+        EXPECT_LE(CmdLatHist::lower(idx), v);
+        if (idx + 1 < CMD_HIST_BUCKETS)
+            EXPECT_GT(CmdLatHist::lower(idx + 1), v);
+    }
+    EXPECT_EQ(CMD_HIST_BUCKETS - 1, CmdLatHist::index(UINT64_MAX));
+}
+
+TEST_F(TestCmdTrace, HistPercentile)
+{
+    CmdLatHist h;
+    EXPECT_EQ(0U, h.percentile(0.99));
+    for (uint64_t v = 1; v <= 1000; v++)
+        h.record(v * 1000);
+    EXPECT_EQ(1000U, h.count());
+    EXPECT_EQ(1000000U, h.max());
+    EXPECT_EQ(500500000U, h.sum());
+    // 相对误差不超过1/8
+    uint64_t p50 = h.percentile(0.5);
+    EXPECT_GE(p50, 500000U);
+    EXPECT_LE(p50, 500000U + 500000U / 8);
+    uint64_t p99 = h.percentile(0.99);
+    EXPECT_GE(p99, 990000U);
+    EXPECT_LE(p99, 1000000U);
+    EXPECT_EQ(1000000U, h.percentile(1));
+    h.reset();
+    EXPECT_EQ(0U, h.count());
+    EXPECT_EQ(0U, h.max());
+}
+
+TEST_F(TestCmdTrace, SlowRequest)
+{
+    CmdTracer* tracer = CmdTracer::get_tracer();
+    tracer->reset();
+    tracer->set_slow(1, 1, 2);
+
+    cmd_t cmd;
+    memset(&cmd, 0, sizeof(cmd));
+    cmd.hdr.cn.cls = CMD_CLS_IO_CHK;
+    cmd.hdr.cn.seq = CMD_CHK_IO_READ;
+    ((cmd_chk_io_rd_t*)cmd.cont)->chk_id = 7;
+    ((cmd_chk_io_rd_t*)cmd.cont)->off = 4096;
+
+    cmd_trace_t tr;
+    tracer->set_enable(false);
+    tracer->begin(tr, &cmd);
+    EXPECT_FALSE(tr.tracing());
+    tr.mark(CMD_TS_DISPATCH);
+    EXPECT_EQ(0U, tr.ts[CMD_TS_DISPATCH]);
+
+    tracer->set_enable(true);
+    for (int i = 0; i < 3; i++) {
+        tracer->begin(tr, &cmd);
+        ASSERT_TRUE(tr.tracing());
+        tr.mark(CMD_TS_DISPATCH);
+        tr.mark(CMD_TS_EXEC);
+        tr.mark(CMD_TS_XFER);
+        tr.mark(CMD_TS_SEND);
+        tracer->finish(tr);
+        EXPECT_FALSE(tr.tracing());
+    }
+
+    std::list<cmd_trace_stage_stat_t> stats;
+    tracer->get_stage_stat(stats);
+    ASSERT_EQ((size_t)CMD_TS_NUM, stats.size());
+    for (auto& st : stats)
+        EXPECT_EQ(3U, st.count);
+
+    // 只保留最近的2条
+    std::list<cmd_slow_req_t> slow;
+    tracer->get_slow(slow, 10);
+    ASSERT_EQ(2U, slow.size());
+    EXPECT_EQ(7U, slow.front().chk_id);
+    EXPECT_EQ(4096U, slow.front().off);
+    EXPECT_GE(slow.front().total, slow.front().stage[CMD_TS_EXEC]);
+
+    tracer->set_enable(false);
+    tracer->reset();
+}
+
+int main(int argc, char  **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
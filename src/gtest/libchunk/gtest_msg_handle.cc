@@ -0,0 +1,356 @@
+#include "gtest/libchunk/gtest_msg_handle.h"
+
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <random>
+#include <set>
+#include <list>
+
+using namespace flame;
+using msg::ib::RdmaBuffer;
+
+//**不依赖RDMA设备：请求的缓冲指向普通内存
+struct batch_env_t{
+    Msger msger;
+    std::vector<char> mem;
+    std::vector<RdmaBuffer> bufs;
+    std::vector<std::unique_ptr<RdmaWorkRequest>> reqs;
+
+    explicit batch_env_t(int n) : msger(nullptr, nullptr, false), mem(n * (RDMA_REQ_HDR_SIZE + RDMA_REQ_DATA_SIZE)){
+        bufs.reserve(2 * n);
+        for(int i = 0; i < n; i++){
+            char* base = mem.data() + i * (RDMA_REQ_HDR_SIZE + RDMA_REQ_DATA_SIZE);
+            bufs.emplace_back(0, (uint64_t)base, RDMA_REQ_HDR_SIZE);
+            bufs.emplace_back(0, (uint64_t)(base + RDMA_REQ_HDR_SIZE), RDMA_REQ_DATA_SIZE);
+        }
+        RdmaWorkRequest* prev = nullptr;
+        for(int i = 0; i < n; i++){
+            reqs.emplace_back(new RdmaWorkRequest(nullptr, &msger, nullptr, &bufs[2 * i], &bufs[2 * i + 1]));
+        }
+        for(int i = 0; i < n; i++){
+            reqs[i]->join_batch(prev, reqs[n - 1].get());
+            prev = reqs[i].get();
+        }
+    }
+
+    RdmaWorkRequest* leader() { return reqs.back().get(); }
+};
+
+static ibv_wc make_wc(RdmaWorkRequest* req, ibv_wc_status status){
+    ibv_wc wc;
+    memset(&wc, 0, sizeof(wc));
+    wc.wr_id = (uint64_t)req;
+    wc.status = status;
+    wc.opcode = IBV_WC_SEND;
+    return wc;
+}
+
+TEST_F(TestMsgHandle, BatchRetire)
+{
+    batch_env_t env(4);
+    ASSERT_EQ(env.leader()->get_retired_wr_num(), 4U);
+    for(int i = 0; i < 3; i++){
+        ASSERT_TRUE(env.reqs[i]->unsignaled_);
+        ASSERT_FALSE(env.reqs[i]->get_ibv_send_wr()->send_flags & IBV_SEND_SIGNALED);
+        ASSERT_EQ(env.reqs[i]->get_retired_wr_num(), 1U);
+    }
+    ASSERT_TRUE(env.leader()->get_ibv_send_wr()->send_flags & IBV_SEND_SIGNALED);
+
+    ibv_wc wc = make_wc(env.leader(), IBV_WC_SUCCESS);
+    env.leader()->on_send_done(wc);
+    for(int i = 0; i < 4; i++){
+        ASSERT_FALSE(env.reqs[i]->unsignaled_);
+        ASSERT_EQ(env.reqs[i]->get_retired_wr_num(), 1U);
+    }
+}
+
+TEST_F(TestMsgHandle, BatchRetireOnFlush)
+{
+    //**第1个组员已经成功（没有完成事件），QP出错后其余组员和组长各自产生flush完成事件
+    batch_env_t env(4);
+    uint32_t retired = 0;
+    for(int i = 1; i < 3; i++){
+        retired += env.reqs[i]->get_retired_wr_num();
+        ibv_wc wc = make_wc(env.reqs[i].get(), IBV_WC_WR_FLUSH_ERR);
+        env.reqs[i]->on_send_done(wc);
+        ASSERT_TRUE(env.reqs[i]->flushed_);
+    }
+    ASSERT_EQ(retired, 2U);
+
+    //**组长只回收自己和没有单独完成事件的组员
+    ASSERT_EQ(env.leader()->get_retired_wr_num(), 2U);
+    retired += env.leader()->get_retired_wr_num();
+    ASSERT_EQ(retired, 4U);
+
+    ibv_wc wc = make_wc(env.leader(), IBV_WC_WR_FLUSH_ERR);
+    env.leader()->on_send_done(wc);
+    for(int i = 0; i < 4; i++){
+        ASSERT_FALSE(env.reqs[i]->flushed_);
+        ASSERT_FALSE(env.reqs[i]->unsignaled_);
+    }
+    ASSERT_EQ(env.leader()->get_retired_wr_num(), 1U);
+}
+
+//**不依赖RDMA设备：slab切分自普通内存，测试结束时由测试取回释放，不经过RDMA分配器
+struct slab_env_t{
+    Msger msger;
+    RdmaWorkRequestPool &pool;
+    int cache_idx;
+    std::vector<std::unique_ptr<std::vector<char>>> mems;
+    std::vector<std::unique_ptr<RdmaBuffer>> bufs;
+
+    explicit slab_env_t(bool cache = true) : msger(nullptr, nullptr, true), pool(msger.get_req_pool()){
+        cache_idx = pool.cache_idx_;
+        if(!cache){
+            pool.cache_idx_ = -1;
+        }
+    }
+
+    ~slab_env_t(){
+        for(auto slab : pool.slabs_){
+            release(slab);
+        }
+        pool.slabs_.clear();
+        pool.cache_idx_ = cache_idx;
+    }
+
+    RdmaWorkRequestSlab* add_slab(){
+        size_t len = RDMA_REQ_SLAB_REQS * (RDMA_REQ_HDR_SIZE + RDMA_REQ_DATA_SIZE);
+        mems.emplace_back(new std::vector<char>(len));
+        bufs.emplace_back(new RdmaBuffer(0, (uint64_t)mems.back()->data(), len));
+        return pool.add_slab__(bufs.back().get());
+    }
+
+    static void release(RdmaWorkRequestSlab* slab){
+        for(size_t i = 0; i < RDMA_REQ_SLAB_REQS; i++){
+            slab->reqs[i].~RdmaWorkRequest();
+        }
+        ::operator delete(slab->reqs);
+        delete slab;
+    }
+};
+
+TEST_F(TestMsgHandle, MagazineThreadCache)
+{
+    slab_env_t env;
+    RdmaWorkRequestSlab* slab = env.add_slab();
+    ASSERT_EQ(env.pool.shared_free_.load(), (int64_t)RDMA_REQ_SLAB_REQS);
+    ASSERT_EQ(env.pool.total_.load(), (uint64_t)RDMA_REQ_SLAB_REQS);
+
+    //**缓存空时整弹夹取出
+    std::vector<RdmaWorkRequest *> reqs;
+    ASSERT_EQ(env.pool.alloc_reqs(RDMA_REQ_MAG_SIZE + 1, reqs), RDMA_REQ_MAG_SIZE + 1);
+    ASSERT_EQ(env.pool.shared_free_.load(), (int64_t)(RDMA_REQ_SLAB_REQS - 2 * RDMA_REQ_MAG_SIZE));
+    std::set<RdmaWorkRequest *> uniq(reqs.begin(), reqs.end());
+    ASSERT_EQ(uniq.size(), reqs.size());
+    for(auto req : reqs){
+        ASSERT_EQ(req->slab_, slab);
+        ASSERT_EQ(req->pool_next_, nullptr);
+    }
+
+    //**缓存满（2个弹夹）时还回一个弹夹，线程缓存中留下一个弹夹
+    for(auto req : reqs){
+        env.pool.free_req(req);
+    }
+    ASSERT_EQ(env.pool.shared_free_.load(), (int64_t)(RDMA_REQ_SLAB_REQS - RDMA_REQ_MAG_SIZE));
+}
+
+TEST_F(TestMsgHandle, PurgeKeepsBusySlab)
+{
+    slab_env_t env(false);
+    RdmaWorkRequestSlab* a = env.add_slab();
+    RdmaWorkRequestSlab* b = env.add_slab();
+
+    //**不使用线程缓存：取出一个弹夹后其余请求还回共享池
+    RdmaWorkRequest* req = env.pool.alloc_req();
+    ASSERT_NE(req, nullptr);
+    ASSERT_EQ(env.pool.shared_free_.load(), (int64_t)(2 * RDMA_REQ_SLAB_REQS - 1));
+    RdmaWorkRequestSlab* busy = req->slab_;
+    RdmaWorkRequestSlab* other = busy == a ? b : a;
+
+    std::list<RdmaWorkRequestSlab *> idle;
+    ASSERT_EQ(env.pool.take_idle_slabs__(-1, idle), 1);
+    ASSERT_EQ(idle.front(), other);
+    ASSERT_TRUE(other->retired);
+    ASSERT_EQ(env.pool.slabs_.size(), 1U);
+    ASSERT_EQ(env.pool.total_.load(), (uint64_t)RDMA_REQ_SLAB_REQS);
+    ASSERT_EQ(env.pool.shared_free_.load(), (int64_t)(RDMA_REQ_SLAB_REQS - 1));
+
+    //**放回共享池的都是未回收slab的请求
+    std::vector<RdmaWorkRequest *> reqs;
+    ASSERT_EQ(env.pool.alloc_reqs(RDMA_REQ_SLAB_REQS - 1, reqs), RDMA_REQ_SLAB_REQS - 1);
+    for(auto r : reqs){
+        ASSERT_EQ(r->slab_, busy);
+    }
+    ASSERT_EQ(env.pool.pop_mag__(), nullptr);
+    reqs.push_back(req);
+    for(auto r : reqs){
+        env.pool.free_req(r);
+    }
+
+    ASSERT_EQ(env.pool.take_idle_slabs__(-1, idle), 1);
+    ASSERT_EQ(idle.back(), busy);
+    ASSERT_TRUE(env.pool.slabs_.empty());
+    ASSERT_EQ(env.pool.shared_free_.load(), 0);
+    ASSERT_EQ(env.pool.purge_cnt_.load(), 2U);
+    for(auto slab : idle){
+        slab_env_t::release(slab);
+    }
+}
+
+/**
+ * 多个线程并发分配/释放，同时回收slab：请求不会被重复分配，回收的slab中的请求不会再被分配
+ */
+static void pool_stress(bool cache)
+{
+    const int threads = 4;
+    const int loops = 20000;
+    const int max_batch = RDMA_REQ_MAG_SIZE * 2;
+    slab_env_t env(cache);
+    std::vector<RdmaWorkRequestSlab *> slabs;
+    for(int i = 0; i < 3; i++){
+        slabs.push_back(env.add_slab());
+    }
+    std::vector<std::atomic<int>> held(slabs.size() * RDMA_REQ_SLAB_REQS);
+    auto index = [&](RdmaWorkRequest* req){
+        for(size_t i = 0; i < slabs.size(); i++){
+            if(req->slab_ == slabs[i])
+                return i * RDMA_REQ_SLAB_REQS + (req - slabs[i]->reqs);
+        }
+        return held.size();
+    };
+    std::atomic<int> errors {0};
+    std::atomic<bool> stop {false};
+
+    std::vector<std::thread> workers;
+    for(int t = 0; t < threads; t++){
+        workers.emplace_back([&, t](){
+            std::mt19937 rng(t);
+            std::vector<RdmaWorkRequest *> reqs;
+            for(int i = 0; i < loops; i++){
+                int n = rng() % max_batch + 1;
+                if(env.pool.alloc_reqs(n, reqs) != n)
+                    errors++;
+                for(auto req : reqs){
+                    size_t idx = index(req);
+                    if(idx >= held.size() || req->slab_->retired || held[idx].exchange(1) != 0)
+                        errors++;
+                }
+                for(auto req : reqs){
+                    held[index(req)].store(0);
+                    env.pool.free_req(req);
+                }
+                reqs.clear();
+            }
+        });
+    }
+    //**回收至多一个slab，剩余的请求足够所有线程同时持有，不会触发扩容
+    std::list<RdmaWorkRequestSlab *> idle;
+    std::thread purger([&](){
+        while(!stop.load() && idle.empty()){
+            env.pool.take_idle_slabs__(1, idle);
+            std::this_thread::yield();
+        }
+    });
+    for(auto &w : workers){
+        w.join();
+    }
+    stop.store(true);
+    purger.join();
+    ASSERT_EQ(errors.load(), 0);
+
+    //**线程退出时线程缓存已还回，全部请求都在共享池中
+    env.pool.take_idle_slabs__(-1, idle);
+    ASSERT_EQ(idle.size(), slabs.size());
+    ASSERT_TRUE(env.pool.slabs_.empty());
+    ASSERT_EQ(env.pool.shared_free_.load(), 0);
+    ASSERT_EQ(env.pool.total_.load(), 0U);
+    for(auto slab : idle){
+        slab_env_t::release(slab);
+    }
+}
+
+TEST_F(TestMsgHandle, PoolConcurrentShared)
+{
+    pool_stress(false);
+}
+
+TEST_F(TestMsgHandle, PoolConcurrentCached)
+{
+    pool_stress(true);
+}
+
+//**大IO缓冲的分配器替身：普通内存
+static std::atomic<int> stub_bufs {0};
+
+static RdmaBuffer* stub_alloc(size_t len){
+    char* p = new char[len];
+    RdmaBuffer parent(0, (uint64_t)p, len);
+    stub_bufs++;
+    return new RdmaBuffer(parent, 0, len);
+}
+
+static void stub_free(RdmaBuffer* buf){
+    delete [] buf->buffer();
+    delete buf;
+    stub_bufs--;
+}
+
+/**
+ * 不超过4KB的IO使用slab中的数据缓冲；更大的IO按2的幂分级借出缓冲，
+ * 请求回到请求池时归还并恢复slab的数据缓冲，之后的IO复用缓存的缓冲
+ */
+TEST_F(TestMsgHandle, BigBufMagazine)
+{
+    {
+        slab_env_t env;
+        env.pool.big_alloc_fn_ = stub_alloc;
+        env.pool.big_free_fn_ = stub_free;
+        env.add_slab();
+
+        RdmaWorkRequest* req = env.pool.alloc_req();
+        RdmaBuffer* slab_buf = req->data_buf_;
+        ASSERT_EQ(req->get_io_buf__(RDMA_REQ_DATA_SIZE), slab_buf);
+        ASSERT_EQ(slab_buf->data_len, (size_t)RDMA_REQ_DATA_SIZE);
+        ASSERT_EQ(stub_bufs.load(), 0);
+
+        RdmaBuffer* big = req->get_io_buf__(10000);
+        ASSERT_NE(big, slab_buf);
+        ASSERT_EQ(big->size(), 16384U);
+        ASSERT_EQ(big->data_len, 10000U);
+        ASSERT_EQ(req->data_buf_, big);
+        env.pool.free_req(req);
+        ASSERT_EQ(req->data_buf_, slab_buf);
+        ASSERT_EQ(req->sge_[1].addr, slab_buf->addr());
+
+        rdma_req_pool_stat_t stat;
+        env.pool.get_stat(stat);
+        ASSERT_EQ(stat.big_cached, 1U);
+        ASSERT_EQ(stat.big_alloc, 1U);
+
+        //**同级的IO复用缓存的缓冲
+        req = env.pool.alloc_req();
+        ASSERT_EQ(req->get_io_buf__(9000), big);
+        env.pool.free_req(req);
+        env.pool.get_stat(stat);
+        ASSERT_EQ(stat.big_alloc, 1U);
+
+        //**超出最大分级的缓冲不缓存
+        size_t huge = ((size_t)1 << (RDMA_REQ_BIG_BUF_SHIFT_MIN + RDMA_REQ_BIG_BUF_CLASSES)) + 1;
+        req = env.pool.alloc_req();
+        ASSERT_NE(req->get_io_buf__(huge), nullptr);
+        ASSERT_EQ(stub_bufs.load(), 2);
+        env.pool.free_req(req);
+        ASSERT_EQ(stub_bufs.load(), 1);
+    }
+    //**请求池销毁时释放缓存的缓冲
+    ASSERT_EQ(stub_bufs.load(), 0);
+}
+
+int main(int argc, char  **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
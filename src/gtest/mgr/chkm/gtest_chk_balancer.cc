@@ -0,0 +1,184 @@
+#include "gtest/mgr/chkm/gtest_chk_balancer.h"
+#include "include/retcode.h"
+
+#include <vector>
+using namespace flame;
+
+/**
+ * 使用内存中的sqlite作为MetaStore，不连接CSD：发出的迁移都会失败
+ */
+class BalancerEnv {
+public:
+    BalancerEnv() : bct_(FlameContext::get_context()) {
+        bct_.ms(create_metastore(bct_.fct(), "sqlite:///:memory:", 1, 1));
+        csdm_.reset(new CsdManager(&bct_, nullptr, nullptr));
+    }
+
+    ~BalancerEnv() {
+        ChunkMS* chk_ms = bct_.ms()->get_chunk_ms();
+        std::list<chunk_meta_t> chks;
+        chk_ms->list_all(chks);
+        for (auto it = chks.begin(); it != chks.end(); it++)
+            chk_ms->remove(it->chk_id);
+        delete chk_ms;
+    }
+
+    void add_chunk(uint64_t chk_id, uint64_t csd_id, uint64_t wr_cnt, uint64_t vol_id, uint32_t index) {
+        chunk_meta_t chk;
+        chk.chk_id = chk_id;
+        chk.vol_id = vol_id;
+        chk.index = index;
+        chk.stat = CHK_STAT_CREATED;
+        chk.spolicy = 0;
+        chk.primary = chk_id;
+        chk.size = 1 << 20;
+        chk.csd_id = csd_id;
+        chk.dst_id = csd_id;
+        ChunkMS* chk_ms = bct_.ms()->get_chunk_ms();
+        ASSERT_EQ(chk_ms->create(chk), RC_SUCCESS);
+        delete chk_ms;
+
+        chunk_health_meta_t hlt;
+        hlt.chk_id = chk_id;
+        hlt.stat = CHK_STAT_CREATED;
+        hlt.size = chk.size;
+        hlt.grand.wr_cnt = wr_cnt;
+        ChunkHealthMS* hlt_ms = bct_.ms()->get_chunk_health_ms();
+        hlt_ms->remove(chk_id);
+        ASSERT_EQ(hlt_ms->create(hlt), RC_SUCCESS);
+        delete hlt_ms;
+    }
+
+    MgrBaseContext bct_;
+    std::shared_ptr<CsdManager> csdm_;
+};
+
+static ChunkBalancer::csd_load_t make_csd(uint64_t csd_id, double pressure, uint64_t wr_cnt) {
+    ChunkBalancer::csd_load_t cl;
+    cl.csd_id = csd_id;
+    cl.left = 1ULL << 40;
+    cl.wr_cnt = wr_cnt;
+    cl.pressure = pressure;
+    return cl;
+}
+
+TEST_F(TestChunkBalancer, PlanSelectsHotChunks)
+{
+    BalancerEnv env;
+    ASSERT_TRUE(env.bct_.ms() != nullptr);
+    // 源CSD 1上的Chunk：101过热，迁走后源CSD低于平均压力；102、103可以迁移；104在冷却中
+    env.add_chunk(101, 1, 400, 1, 0);
+    env.add_chunk(102, 1, 300, 1, 1);
+    env.add_chunk(103, 1, 10, 1, 2);
+    env.add_chunk(104, 1, 200, 1, 3);
+    // 103的同组Chunk在CSD 3上
+    env.add_chunk(105, 3, 0, 1, 2);
+
+    balance_opts_t opts;
+    ChunkBalancer blc(&env.bct_, env.csdm_, opts);
+    blc.cooldown_[104] = 10;
+
+    std::vector<ChunkBalancer::csd_load_t> csds {
+        make_csd(1, 1.6, 1000), make_csd(2, 0.5, 100), make_csd(3, 0.9, 100)
+    };
+    std::list<balance_move_t> moves;
+    ASSERT_EQ(blc.plan__(moves, csds), 2);
+    ASSERT_EQ(moves.size(), 2);
+
+    // 压力转移按写次数比例估计：0.0016 * 300
+    balance_move_t& m0 = moves.front();
+    ASSERT_EQ(m0.chk_id, 102);
+    ASSERT_EQ(m0.src_id, 1);
+    ASSERT_EQ(m0.dst_id, 2);
+    ASSERT_NEAR(m0.gain, 0.48, 1e-9);
+
+    // CSD 3压力最低，但与103同组，只能选择CSD 2
+    balance_move_t& m1 = moves.back();
+    ASSERT_EQ(m1.chk_id, 103);
+    ASSERT_EQ(m1.dst_id, 2);
+
+    ASSERT_NEAR(csds[0].pressure, 1.6 - 0.48 - 0.016, 1e-9);
+    ASSERT_NEAR(csds[1].pressure, 0.5 + 0.48 + 0.016, 1e-9);
+}
+
+TEST_F(TestChunkBalancer, PlanBudget)
+{
+    BalancerEnv env;
+    env.add_chunk(101, 1, 300, 1, 0);
+    env.add_chunk(102, 1, 200, 1, 1);
+
+    balance_opts_t opts;
+    opts.max_moves = 1;
+    ChunkBalancer blc(&env.bct_, env.csdm_, opts);
+    std::vector<ChunkBalancer::csd_load_t> csds {
+        make_csd(1, 1.6, 1000), make_csd(2, 0.4, 100)
+    };
+    std::list<balance_move_t> moves;
+    ASSERT_EQ(blc.plan__(moves, csds), 1);
+    ASSERT_EQ(moves.front().chk_id, 101);
+
+    // 压力在带宽内的CSD不作为源/目标
+    std::vector<ChunkBalancer::csd_load_t> even {
+        make_csd(1, 1.05, 1000), make_csd(2, 0.95, 100)
+    };
+    moves.clear();
+    ASSERT_EQ(blc.plan__(moves, even), 0);
+}
+
+TEST_F(TestChunkBalancer, RoundStat)
+{
+    BalancerEnv env;
+    env.add_chunk(101, 1, 300, 1, 0);
+
+    balance_opts_t opts;
+    ChunkBalancer blc(&env.bct_, env.csdm_, opts);
+
+    // 不均衡度超过trigger，发起迁移；CSD不可达，迁移被记为拒绝
+    std::vector<ChunkBalancer::csd_load_t> csds {
+        make_csd(1, 1.6, 1000), make_csd(2, 0.4, 100)
+    };
+    ASSERT_EQ(blc.round__(csds), 0);
+    balance_stat_t stat;
+    blc.get_stat(stat);
+    ASSERT_EQ(stat.rounds, 1);
+    ASSERT_TRUE(stat.active);
+    ASSERT_NEAR(stat.imb, 0.6, 1e-9);
+    ASSERT_EQ(stat.active_rounds, 1);
+    ASSERT_EQ(stat.moves_refused, 1);
+    ASSERT_EQ(stat.moves_issued, 0);
+    std::list<balance_move_t> moves;
+    blc.get_moves(moves);
+    ASSERT_EQ(moves.size(), 1);
+    ASSERT_NE(moves.front().res, RC_SUCCESS);
+    // 没有迁移成功，预计值与实际值都不更新
+    ASSERT_EQ(stat.projected_imb, 0);
+    ASSERT_EQ(stat.achieved_imb, 0);
+
+    // 上一轮迁移成功：本轮报告上一轮的预计值与本轮的实际值
+    blc.last_issued_ = true;
+    blc.projected_ = 0.2;
+    std::vector<ChunkBalancer::csd_load_t> after {
+        make_csd(1, 1.15, 1000), make_csd(2, 0.85, 100)
+    };
+    ASSERT_EQ(blc.round__(after), 0);
+    blc.get_stat(stat);
+    ASSERT_EQ(stat.rounds, 2);
+    ASSERT_NEAR(stat.projected_imb, 0.2, 1e-9);
+    ASSERT_NEAR(stat.achieved_imb, 0.15, 1e-9);
+    // 滞回：低于trigger但高于release时保持均衡状态
+    ASSERT_TRUE(stat.active);
+
+    std::vector<ChunkBalancer::csd_load_t> even {
+        make_csd(1, 1.05, 1000), make_csd(2, 0.95, 100)
+    };
+    ASSERT_EQ(blc.round__(even), 0);
+    blc.get_stat(stat);
+    ASSERT_FALSE(stat.active);
+    ASSERT_NEAR(stat.projected_imb, 0.2, 1e-9);
+    ASSERT_NEAR(stat.achieved_imb, 0.15, 1e-9);
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
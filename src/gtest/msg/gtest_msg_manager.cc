@@ -0,0 +1,145 @@
+#include "gtest/msg/gtest_msg_manager.h"
+#include "util/cycles.h"
+
+/**
+ * 只用于负载采样的连接
+ */
+class FakeConn : public Connection{
+public:
+    bool fixed = false;
+
+    explicit FakeConn(MsgContext *c) : Connection(c) {}
+
+    virtual msg_ttype_t get_ttype() override { return msg_ttype_t::TCP; }
+    virtual ssize_t send_msg(Msg *msg, bool more=false) override { return 0; }
+    virtual Msg* recv_msg() override { return nullptr; }
+    virtual int pending_msg() override { return 0; }
+    virtual bool is_connected() override { return true; }
+    virtual void close() override {}
+    virtual bool is_owner_fixed() const override { return fixed; }
+};
+
+/**
+ * 在工作线程i上添加占用cpu个核的连接，由MsgManager持有引用
+ */
+static FakeConn *add_conn(MsgManager *mgr, int i, double cpu){
+    FakeConn *conn = new FakeConn(mgr->mct);
+    conn->set_owner(mgr->get_worker(i));
+    conn->account_cpu((uint64_t)(cpu * 1e9 * cycles_per_ns()));
+    conn->account_rx(1 << 20, 16);
+    mgr->conn_samples[conn] = MsgManager::conn_sample_t();
+    return conn;
+}
+
+static void add_cpu(FakeConn *conn, double cpu){
+    conn->account_cpu((uint64_t)(cpu * 1e9 * cycles_per_ns()));
+}
+
+//* 让下一次rebalance()的统计周期为1s
+static void set_period(MsgManager *mgr){
+    mgr->last_balance_cycles = get_cycles() - (uint64_t)(1e9 * cycles_per_ns());
+}
+
+//* 取出投递到工作线程的迁移任务，返回任务数
+static int drop_migrations(MsgManager *mgr, int i){
+    ThrMsgWorker *worker = dynamic_cast<ThrMsgWorker *>(mgr->get_worker(i));
+    int n = worker->external_num.load();
+    worker->external_queue.clear();
+    worker->external_num = 0;
+    return n;
+}
+
+/**
+ * 选择不超过最重与最轻线程差值一半的最重连接，迁往最轻的线程
+ */
+TEST_F(TestMsgManager, RebalancePicksVictim)
+{
+    FakeConn *a = add_conn(mgr, 0, 0.5);
+    FakeConn *b = add_conn(mgr, 0, 0.2);
+    add_conn(mgr, 0, 0.05);
+    add_conn(mgr, 1, 0.1);
+
+    set_period(mgr);
+    ASSERT_EQ(mgr->rebalance(), 1);
+    msg_balance_stat_t stat;
+    mgr->get_balance_stat(stat);
+    ASSERT_EQ(stat.rounds, 1U);
+    ASSERT_EQ(stat.imbalanced, 1U);
+    ASSERT_EQ(stat.loads.size(), 3U);
+    ASSERT_EQ(stat.loads[0].conns, 3);
+    ASSERT_EQ(stat.loads[1].conns, 1);
+    ASSERT_EQ(stat.loads[2].conns, 0);
+    ASSERT_NEAR(stat.loads[0].cpu, 0.75, 0.05);
+    ASSERT_GT(stat.imbalance, 2.5);
+    //* a超过差值的一半(0.375)，选择b，迁移任务投递到原线程
+    ASSERT_EQ(drop_migrations(mgr, 0), 1);
+    ASSERT_EQ(b->get_nref(), 2U);
+    ASSERT_EQ(a->get_nref(), 1U);
+    b->put();
+}
+
+/**
+ * 只按上一周期的增量计算负载，空闲时不迁移
+ */
+TEST_F(TestMsgManager, RebalanceIdle)
+{
+    FakeConn *a = add_conn(mgr, 0, 0.5);
+    FakeConn *b = add_conn(mgr, 0, 0.2);
+
+    set_period(mgr);
+    ASSERT_EQ(mgr->rebalance(), 1);
+    ASSERT_EQ(drop_migrations(mgr, 0), 1);
+    b->put();
+
+    set_period(mgr);
+    ASSERT_EQ(mgr->rebalance(), 0);
+    msg_balance_stat_t stat;
+    mgr->get_balance_stat(stat);
+    ASSERT_EQ(stat.rounds, 2U);
+    ASSERT_EQ(stat.imbalanced, 1U);
+    ASSERT_NEAR(stat.loads[0].cpu, 0, 0.01);
+
+    //* 负载均匀时不迁移
+    add_cpu(a, 0.3);
+    add_conn(mgr, 1, 0.3);
+    add_conn(mgr, 2, 0.3);
+    set_period(mgr);
+    ASSERT_EQ(mgr->rebalance(), 0);
+    mgr->get_balance_stat(stat);
+    ASSERT_EQ(stat.imbalanced, 1U);
+    ASSERT_LT(stat.imbalance, 1.5);
+    ASSERT_EQ(drop_migrations(mgr, 0), 0);
+}
+
+/**
+ * 不迁移is_owner_fixed()的连接与冷却中的连接
+ */
+TEST_F(TestMsgManager, RebalanceSkipsUnmovable)
+{
+    FakeConn *a = add_conn(mgr, 0, 0.3);
+    FakeConn *b = add_conn(mgr, 0, 0.3);
+    a->fixed = true;
+    mgr->conn_samples[b].movable_round = 5;
+
+    set_period(mgr);
+    ASSERT_EQ(mgr->rebalance(), 0);
+    msg_balance_stat_t stat;
+    mgr->get_balance_stat(stat);
+    ASSERT_EQ(stat.imbalanced, 1U);
+    ASSERT_EQ(drop_migrations(mgr, 0), 0);
+
+    //* 冷却结束后可以迁移
+    mgr->balance_stat.rounds = 4;
+    add_cpu(a, 0.3);
+    add_cpu(b, 0.2);
+    set_period(mgr);
+    ASSERT_EQ(mgr->rebalance(), 1);
+    ASSERT_EQ(drop_migrations(mgr, 0), 1);
+    b->put();
+}
+
+int main(int argc, char  **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,47 @@
+#include <gtest/gtest.h>
+#include <iostream>
+
+#ifdef GTEST
+#define private public
+#define protected public
+#endif
+#include "msg/MsgManager.h"
+#include "msg/Connection.h"
+#include "msg/msg_context.h"
+#include "msg/internal/msg_config.h"
+
+using namespace std;
+using namespace flame;
+using namespace flame::msg;
+
+class TestMsgManager:public testing::Test
+{
+public:
+    static void SetUpTestCase(){    
+    }
+ 
+    static void TearDownTestCase(){  
+    }
+    
+    void SetUp(){
+        mct = new MsgContext(FlameContext::get_context());
+        config = new MsgConfig(mct->fct);
+        config->msg_worker_type = msg_worker_type_t::THREAD;
+        config->msg_worker_poll_mode = msg_worker_poll_mode_t::BLOCK;
+        config->msg_worker_spin_us = 0;
+        config->msg_worker_backoff_max_ms = 1;
+        config->msg_worker_imbalance_ratio = 1.5;
+        mct->config = config;
+        mgr = new MsgManager(mct, 3);
+    }
+
+    void TearDown(){
+        delete mgr;
+        delete config;
+        delete mct;
+    }
+
+    MsgContext *mct;
+    MsgConfig *config;
+    MsgManager *mgr;
+};// class TestMsgManager
@@ -0,0 +1,97 @@
+#include "gtest/msg/gtest_msg_worker.h"
+#include "util/cycles.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+/**
+ * ADAPTIVE模式下空闲不足msg_worker_spin_us时轮询，之后阻塞，
+ * 超时时间从1ms开始加倍直到msg_worker_backoff_max_ms
+ */
+TEST_F(TestThrMsgWorker, AdaptiveBackoff)
+{
+    worker->poll_mode = msg_worker_poll_mode_t::ADAPTIVE;
+    worker->spin_budget = 1000;
+    worker->backoff_max_ms = 8;
+
+    struct timeval tv;
+    int backoff_ms = 0;
+    ASSERT_FALSE(worker->get_block_timeout(0, backoff_ms, tv));
+    ASSERT_FALSE(worker->get_block_timeout(999, backoff_ms, tv));
+    ASSERT_EQ(backoff_ms, 0);
+
+    int expect[] = {1, 2, 4, 8, 8};
+    for(int ms : expect){
+        ASSERT_TRUE(worker->get_block_timeout(1000, backoff_ms, tv));
+        ASSERT_EQ(backoff_ms, ms);
+        uint64_t us = tv.tv_sec * 1000000ULL + tv.tv_usec;
+        ASSERT_LE(us, ms * 1000ULL);
+        ASSERT_GT(us, ms * 1000ULL - 1000);
+    }
+
+    //* 有待执行的工作任务时不阻塞
+    worker->external_num = 1;
+    ASSERT_FALSE(worker->get_block_timeout(1000, backoff_ms, tv));
+    worker->external_num = 0;
+}
+
+/**
+ * BUSY模式从不阻塞，BLOCK模式空闲即阻塞
+ */
+TEST_F(TestThrMsgWorker, BusyAndBlock)
+{
+    struct timeval tv;
+    int backoff_ms = 0;
+    worker->poll_mode = msg_worker_poll_mode_t::BUSY;
+    ASSERT_FALSE(worker->get_block_timeout(UINT64_MAX, backoff_ms, tv));
+
+    worker->poll_mode = msg_worker_poll_mode_t::BLOCK;
+    ASSERT_TRUE(worker->get_block_timeout(0, backoff_ms, tv));
+    ASSERT_EQ(tv.tv_sec, 30);
+    ASSERT_EQ(backoff_ms, 0);
+}
+
+/**
+ * 运行中的ADAPTIVE工作线程空闲后先轮询再阻塞，
+ * 投递的工作任务唤醒线程后重新从轮询开始
+ */
+TEST_F(TestThrMsgWorker, AdaptiveTransition)
+{
+    worker->poll_mode = msg_worker_poll_mode_t::ADAPTIVE;
+    worker->spin_budget = (uint64_t)(200 * 1000 * cycles_per_ns());
+    worker->backoff_max_ms = 4;
+    worker->start();
+
+    msg_worker_stat_t stat;
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    ASSERT_EQ(worker->get_stat(stat), 0);
+    ASSERT_GT(stat.spin_ns, 0U);
+    ASSERT_GT(stat.sleeps, 0U);
+    uint64_t sleeps = stat.sleeps;
+
+    //* 阻塞中的线程需要写管道唤醒
+    std::atomic<int> done {0};
+    for(int i = 0;i < 10; ++i){
+        while(!worker->sleeping.load()){
+            std::this_thread::yield();
+        }
+        worker->post_work([&done](){ ++done; });
+        while(done.load() <= i){
+            std::this_thread::yield();
+        }
+    }
+    ASSERT_EQ(worker->get_stat(stat), 0);
+    ASSERT_GE(stat.wakeups, 1U);
+    ASSERT_GE(stat.handoffs, 10U);
+    ASSERT_GT(stat.sleeps, sleeps);
+    ASSERT_GT(stat.busy_ns, 0U);
+
+    worker->stop();
+}
+
+int main(int argc, char  **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
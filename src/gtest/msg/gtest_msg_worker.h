@@ -0,0 +1,36 @@
+#include <gtest/gtest.h>
+#include <iostream>
+
+#ifdef GTEST
+#define private public
+#define protected public
+#endif
+#include "msg/MsgWorker.h"
+#include "msg/msg_context.h"
+
+using namespace std;
+using namespace flame;
+using namespace flame::msg;
+
+class TestThrMsgWorker:public testing::Test
+{
+public:
+    static void SetUpTestCase(){    
+    }
+ 
+    static void TearDownTestCase(){  
+    }
+    
+    void SetUp(){
+        mct = new MsgContext(FlameContext::get_context());
+        worker = new ThrMsgWorker(mct, 0);
+    }
+
+    void TearDown(){
+        delete worker;
+        delete mct;
+    }
+
+    MsgContext *mct;
+    ThrMsgWorker *worker;
+};// class TestThrMsgWorker
@@ -0,0 +1,206 @@
+#include "gtest/msg/gtest_rdma_mr_cache.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#define PAGE 4096ULL
+
+static std::atomic<int> reg_cnt(0);
+static std::atomic<int> dereg_cnt(0);
+//* 不为0时，注册该地址的线程等待block_reg清零
+static std::atomic<uint64_t> block_reg(0);
+static std::atomic<int> blocked(0);
+
+static ibv_mr *stub_reg_mr(ibv_pd *pd, void *addr, size_t length, int access){
+    if(block_reg.load() == reinterpret_cast<uint64_t>(addr)){
+        ++blocked;
+        while(block_reg.load()){
+            std::this_thread::yield();
+        }
+    }
+    ++reg_cnt;
+    ibv_mr *mr = new ibv_mr();
+    mr->addr = addr;
+    mr->length = length;
+    mr->lkey = mr->rkey = (uint32_t)reg_cnt.load();
+    return mr;
+}
+
+static int stub_dereg_mr(ibv_mr *mr){
+    ++dereg_cnt;
+    delete mr;
+    return 0;
+}
+
+static RdmaMrCache *new_cache(MsgContext *mct, ProtectionDomain *pd,
+                                                            uint64_t max){
+    reg_cnt = 0;
+    dereg_cnt = 0;
+    RdmaMrCache *cache = new RdmaMrCache(mct, pd, max);
+    cache->reg_mr_fn = stub_reg_mr;
+    cache->dereg_mr_fn = stub_dereg_mr;
+    return cache;
+}
+
+static void *page_addr(uint64_t i){
+    return reinterpret_cast<void *>((i + 16) * PAGE);
+}
+
+/**
+ * 第一次使用时注册，之后命中缓存，按页对齐
+ */
+TEST_F(TestRdmaMrCache, HitAndMiss)
+{
+    RdmaMrCache *cache = new_cache(mct, pd, 64 * PAGE);
+    char *p = (char *)page_addr(0) + 100;
+    RdmaMr *m = cache->get(p, 1000);
+    ASSERT_TRUE(m != nullptr);
+    ASSERT_EQ(m->addr(), (uint64_t)page_addr(0));
+    ASSERT_EQ(m->size(), PAGE);
+    RdmaMr *m2 = cache->get(p + 1000, 2000);
+    ASSERT_EQ(m, m2);
+    ASSERT_EQ(reg_cnt.load(), 1);
+    cache->put(m);
+    cache->put(m2);
+
+    rdma_mr_cache_stat_t stat;
+    cache->get_stat(stat);
+    ASSERT_EQ(stat.hit, 1U);
+    ASSERT_EQ(stat.miss, 1U);
+    ASSERT_EQ(stat.region_num, 1U);
+    ASSERT_EQ(stat.reged_bytes, PAGE);
+    delete cache;
+    ASSERT_EQ(dereg_cnt.load(), 1);
+}
+
+/**
+ * 与缓存的区域重叠时合并，旧区域在不再被引用后注销
+ */
+TEST_F(TestRdmaMrCache, Merge)
+{
+    RdmaMrCache *cache = new_cache(mct, pd, 64 * PAGE);
+    RdmaMr *a = cache->get(page_addr(0), PAGE);
+    RdmaMr *b = cache->get(page_addr(2), PAGE);
+    cache->put(b);
+    RdmaMr *m = cache->get((char *)page_addr(0) + 10, 3 * PAGE);
+    ASSERT_EQ(reg_cnt.load(), 3);
+    ASSERT_EQ(m->addr(), (uint64_t)page_addr(0));
+    ASSERT_EQ(m->size(), 4 * PAGE);
+    //* b未被引用，立即注销；a被引用，put之后注销
+    ASSERT_EQ(dereg_cnt.load(), 1);
+    ASSERT_EQ(cache->regions.size(), 1U);
+    cache->put(a);
+    ASSERT_EQ(dereg_cnt.load(), 2);
+    cache->put(m);
+
+    rdma_mr_cache_stat_t stat;
+    cache->get_stat(stat);
+    ASSERT_EQ(stat.reged_bytes, 4 * PAGE);
+    delete cache;
+}
+
+/**
+ * 超过rdma_mr_cache_size时淘汰最久未用的区域，引用中的区域不淘汰
+ */
+TEST_F(TestRdmaMrCache, Evict)
+{
+    RdmaMrCache *cache = new_cache(mct, pd, 2 * PAGE);
+    RdmaMr *a = cache->get(page_addr(0), PAGE);
+    RdmaMr *b = cache->get(page_addr(2), PAGE);
+    cache->put(b);
+    RdmaMr *c = cache->get(page_addr(4), PAGE);
+    ASSERT_TRUE(c != nullptr);
+    ASSERT_EQ(dereg_cnt.load(), 1);
+    ASSERT_TRUE(cache->get(page_addr(6), PAGE) == nullptr);
+
+    rdma_mr_cache_stat_t stat;
+    cache->get_stat(stat);
+    ASSERT_EQ(stat.evict, 1U);
+    ASSERT_EQ(stat.reg_fail, 1U);
+    ASSERT_EQ(stat.reged_bytes, 2 * PAGE);
+    cache->put(a);
+    cache->put(c);
+    delete cache;
+}
+
+/**
+ * 注册时不持有锁，其他线程可以命中缓存或注册其他区域
+ */
+TEST_F(TestRdmaMrCache, RegisterWithoutLock)
+{
+    RdmaMrCache *cache = new_cache(mct, pd, 64 * PAGE);
+    RdmaMr *a = cache->get(page_addr(0), PAGE);
+    cache->put(a);
+
+    blocked = 0;
+    block_reg = (uint64_t)page_addr(4);
+    RdmaMr *slow = nullptr;
+    std::thread t([&](){
+        slow = cache->get(page_addr(4), PAGE);
+    });
+    while(blocked.load() == 0){
+        std::this_thread::yield();
+    }
+
+    RdmaMr *hit = cache->get(page_addr(0), PAGE);
+    ASSERT_EQ(hit, a);
+    RdmaMr *other = cache->get(page_addr(8), PAGE);
+    ASSERT_TRUE(other != nullptr);
+    //* 注册中的字节计入上限
+    ASSERT_EQ(cache->pending_bytes, PAGE);
+
+    block_reg = 0;
+    t.join();
+    ASSERT_TRUE(slow != nullptr);
+    ASSERT_EQ(cache->pending_bytes, 0U);
+    ASSERT_EQ(cache->regions.size(), 3U);
+    cache->put(hit);
+    cache->put(other);
+    cache->put(slow);
+    delete cache;
+}
+
+/**
+ * 两个线程同时注册同一区域，只保留一个，另一个被注销
+ */
+TEST_F(TestRdmaMrCache, ConcurrentMiss)
+{
+    RdmaMrCache *cache = new_cache(mct, pd, 64 * PAGE);
+    blocked = 0;
+    block_reg = (uint64_t)page_addr(0);
+    RdmaMr *m1 = nullptr, *m2 = nullptr;
+    std::thread t1([&](){
+        m1 = cache->get(page_addr(0), PAGE);
+    });
+    std::thread t2([&](){
+        m2 = cache->get(page_addr(0), PAGE);
+    });
+    while(blocked.load() < 2){
+        std::this_thread::yield();
+    }
+    block_reg = 0;
+    t1.join();
+    t2.join();
+
+    ASSERT_TRUE(m1 != nullptr);
+    ASSERT_EQ(m1, m2);
+    ASSERT_EQ(reg_cnt.load(), 2);
+    ASSERT_EQ(dereg_cnt.load(), 1);
+    ASSERT_EQ(cache->regions.size(), 1U);
+    cache->put(m1);
+    cache->put(m2);
+
+    rdma_mr_cache_stat_t stat;
+    cache->get_stat(stat);
+    ASSERT_EQ(stat.miss, 2U);
+    ASSERT_EQ(stat.reged_bytes, PAGE);
+    delete cache;
+    ASSERT_EQ(dereg_cnt.load(), 2);
+}
+
+int main(int argc, char  **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,37 @@
+#include <gtest/gtest.h>
+#include <iostream>
+
+#ifdef GTEST
+#define private public
+#define protected public
+#endif
+#include "msg/rdma/RdmaMrCache.h"
+#include "msg/rdma/Infiniband.h"
+
+using namespace std;
+using namespace flame;
+using namespace flame::msg;
+using namespace flame::msg::ib;
+
+class TestRdmaMrCache:public testing::Test
+{
+public:
+    static void SetUpTestCase(){    
+    }
+ 
+    static void TearDownTestCase(){  
+    }
+    
+    void SetUp(){
+        mct = new MsgContext(FlameContext::get_context());
+        pd = new ProtectionDomain(mct, nullptr);
+    }
+
+    void TearDown(){
+        delete pd;
+        delete mct;
+    }
+
+    MsgContext *mct;
+    ProtectionDomain *pd;
+};// class TestRdmaMrCache
@@ -0,0 +1,269 @@
+#include "gtest/msg/gtest_session.h"
+#include "msg/msg_data.h"
+
+#include <algorithm>
+
+/**
+ * 记录发出的分片，不真正发送
+ */
+class FakeConn : public Connection{
+public:
+    bool fail = false;
+    bool closed = false;
+    std::vector<Msg *> sent;
+
+    explicit FakeConn(MsgContext *c) : Connection(c) {}
+    ~FakeConn(){
+        for(auto msg : sent){
+            msg->put();
+        }
+    }
+
+    virtual msg_ttype_t get_ttype() override { return msg_ttype_t::TCP; }
+    virtual ssize_t send_msg(Msg *msg, bool more=false) override {
+        if(fail) return -1;
+        msg->get();
+        sent.push_back(msg);
+        return msg->total_bytes();
+    }
+    virtual Msg* recv_msg() override { return nullptr; }
+    virtual int pending_msg() override { return 0; }
+    virtual bool is_connected() override { return !closed; }
+    virtual void close() override { closed = true; }
+};
+
+static Msg *make_msg(MsgContext *mct, uint8_t seed, size_t len){
+    Msg *msg = Msg::alloc_msg(mct);
+    std::vector<char> data(len);
+    for(size_t i = 0;i < len; ++i){
+        data[i] = (char)(seed + i);
+    }
+    msg->append_data(data.data(), len);
+    return msg;
+}
+
+static bool check_msg(Msg *msg, uint8_t seed, size_t len){
+    if(msg->get_data_len() != len){
+        return false;
+    }
+    std::vector<char> data(len);
+    auto it = msg->data_iter();
+    it.copy(data.data(), len);
+    for(size_t i = 0;i < len; ++i){
+        if(data[i] != (char)(seed + i)){
+            return false;
+        }
+    }
+    return true;
+}
+
+static int send(Session *s, MsgContext *mct, uint8_t seed, size_t len){
+    Msg *msg = make_msg(mct, seed, len);
+    int r = s->send_msg(msg);
+    msg->put();
+    return r;
+}
+
+static flame_msg_stripe_hdr_t hdr_of(Msg *frag){
+    msg_stripe_d sd;
+    auto it = frag->data_iter();
+    sd.decode(it);
+    return sd.hdr;
+}
+
+/**
+ * 将from发出的分片从to连接交给接收端，按epoch过滤
+ * epoch为0时不过滤
+ */
+static void feed(Session *s, FakeConn *from, Connection *to,
+                    uint64_t epoch=0, bool reverse=false){
+    std::vector<Msg *> frags = from->sent;
+    if(reverse){
+        std::reverse(frags.begin(), frags.end());
+    }
+    for(auto frag : frags){
+        if(epoch && hdr_of(frag).epoch != epoch) continue;
+        ASSERT_EQ(s->recv_stripe(to, frag), 0);
+    }
+}
+
+static FakeConn *add_conn(Session *s, MsgContext *mct, uint8_t sl=0){
+    FakeConn *conn = new FakeConn(mct);
+    s->add_conn(conn, sl);
+    conn->put();
+    return conn;
+}
+
+/**
+ * 分片乱序到达时，按发送顺序交付重组完成的消息
+ */
+TEST_F(TestSession, StripeReorder)
+{
+    FakeConn *a = add_conn(sender, mct);
+    FakeConn *b = add_conn(sender, mct);
+    FakeConn *ra = add_conn(receiver, mct);
+    FakeConn *rb = add_conn(receiver, mct);
+
+    ASSERT_EQ(send(sender, mct, 0, 100), 0);
+    ASSERT_EQ(send(sender, mct, 1, 101), 0);
+    ASSERT_EQ(send(sender, mct, 2, 7), 0);
+    ASSERT_EQ(a->sent.size(), 3U);
+    ASSERT_EQ(b->sent.size(), 3U);
+    //* 首个分片的连接随stripe_id轮转
+    ASSERT_EQ(hdr_of(a->sent[0]).frag_off, 0U);
+    ASSERT_EQ(hdr_of(b->sent[1]).frag_off, 0U);
+
+    feed(receiver, b, rb, 0, true);
+    ASSERT_TRUE(cb.msgs.empty());
+    //* 2、1先完成，等待0
+    feed(receiver, a, ra, 0, true);
+    ASSERT_EQ(cb.msgs.size(), 3U);
+    ASSERT_TRUE(check_msg(cb.msgs[0], 0, 100));
+    ASSERT_TRUE(check_msg(cb.msgs[1], 1, 101));
+    ASSERT_TRUE(check_msg(cb.msgs[2], 2, 7));
+    ASSERT_EQ(cb.msgs[0]->type, FLAME_MSG_TYPE_CTL);
+    ASSERT_TRUE(receiver->stripe_recvs.empty());
+}
+
+/**
+ * 收到过分片的连接断开后，丢弃未完成的消息，从下一条完成的消息重新计序
+ * 无关连接断开时不丢弃
+ */
+TEST_F(TestSession, ResyncOnConnLoss)
+{
+    FakeConn *a = add_conn(sender, mct);
+    FakeConn *b = add_conn(sender, mct);
+    FakeConn *ra = add_conn(receiver, mct);
+    FakeConn *rb = add_conn(receiver, mct);
+    FakeConn *rc = add_conn(receiver, mct, 1);
+
+    ASSERT_EQ(send(sender, mct, 0, 100), 0);
+    ASSERT_EQ(send(sender, mct, 1, 100), 0);
+    ASSERT_EQ(send(sender, mct, 2, 100), 0);
+
+    //* 0只收到a上的分片
+    ASSERT_EQ(receiver->recv_stripe(ra, a->sent[0]), 0);
+    for(int i = 1;i < 3; ++i){
+        ASSERT_EQ(receiver->recv_stripe(ra, a->sent[i]), 0);
+        ASSERT_EQ(receiver->recv_stripe(rb, b->sent[i]), 0);
+    }
+    ASSERT_TRUE(cb.msgs.empty());
+
+    rc->get();
+    ASSERT_EQ(receiver->del_conn(rc), 0);
+    rc->put();
+    ASSERT_TRUE(cb.msgs.empty());
+    ASSERT_EQ(receiver->stripe_recvs.size(), 3U);
+
+    rb->get();
+    ASSERT_EQ(receiver->del_conn(rb), 0);
+    ASSERT_EQ(cb.msgs.size(), 2U);
+    ASSERT_TRUE(check_msg(cb.msgs[0], 1, 100));
+    ASSERT_TRUE(check_msg(cb.msgs[1], 2, 100));
+    ASSERT_TRUE(receiver->stripe_recvs.empty());
+
+    //* 已丢弃的消息的迟到分片
+    ASSERT_EQ(receiver->recv_stripe(rb, b->sent[0]), 0);
+    rb->put();
+    ASSERT_TRUE(receiver->stripe_recvs.empty());
+
+    ASSERT_EQ(send(sender, mct, 3, 100), 0);
+    ASSERT_EQ(receiver->recv_stripe(ra, a->sent[3]), 0);
+    ASSERT_EQ(receiver->recv_stripe(ra, b->sent[3]), 0);
+    ASSERT_EQ(cb.msgs.size(), 3U);
+    ASSERT_TRUE(check_msg(cb.msgs[2], 3, 100));
+}
+
+/**
+ * 只有条带化连接组变化时才换epoch，
+ * 旧epoch的迟到分片仍被重组，交付完旧epoch后再交付新epoch的消息
+ */
+TEST_F(TestSession, EpochChange)
+{
+    FakeConn *a = add_conn(sender, mct);
+    FakeConn *b = add_conn(sender, mct);
+    FakeConn *ra = add_conn(receiver, mct);
+    FakeConn *rb = add_conn(receiver, mct);
+    FakeConn *rc = add_conn(receiver, mct);
+
+    ASSERT_EQ(send(sender, mct, 0, 100), 0);
+    uint64_t e0 = sender->stripe_send_epoch;
+    ASSERT_GT(e0, 0U);
+
+    //* sl不为0的连接不属于连接组
+    add_conn(sender, mct, 1);
+    ASSERT_EQ(send(sender, mct, 1, 100), 0);
+    ASSERT_EQ(sender->stripe_send_epoch, e0);
+
+    FakeConn *c = add_conn(sender, mct);
+    ASSERT_EQ(send(sender, mct, 2, 99), 0);
+    uint64_t e1 = sender->stripe_send_epoch;
+    ASSERT_GT(e1, e0);
+    ASSERT_EQ(c->sent.size(), 1U);
+    ASSERT_EQ(hdr_of(c->sent[0]).prev_epoch, e0);
+    ASSERT_EQ(hdr_of(c->sent[0]).prev_cnt, 2U);
+
+    //* 新epoch的消息先到达
+    feed(receiver, a, ra, e1);
+    feed(receiver, b, rb, e1);
+    feed(receiver, c, rc, e1);
+    ASSERT_TRUE(cb.msgs.empty());
+    ASSERT_EQ(receiver->stripe_epochs.size(), 2U);
+
+    feed(receiver, b, rb, e0);
+    ASSERT_TRUE(cb.msgs.empty());
+    feed(receiver, a, ra, e0);
+    ASSERT_EQ(cb.msgs.size(), 3U);
+    ASSERT_TRUE(check_msg(cb.msgs[0], 0, 100));
+    ASSERT_TRUE(check_msg(cb.msgs[1], 1, 100));
+    ASSERT_TRUE(check_msg(cb.msgs[2], 2, 99));
+    ASSERT_EQ(receiver->stripe_retired_epoch, e0);
+    ASSERT_EQ(receiver->stripe_epochs.size(), 1U);
+    ASSERT_TRUE(receiver->stripe_recvs.empty());
+
+    //* 连接组中的连接断开也换epoch
+    c->get();
+    ASSERT_EQ(sender->del_conn(c), 0);
+    c->put();
+    ASSERT_EQ(send(sender, mct, 3, 100), 0);
+    ASSERT_GT(sender->stripe_send_epoch, e1);
+}
+
+/**
+ * 分片发送失败时通知对端放弃该消息，后续消息照常交付；
+ * 无法通知时关闭连接组
+ */
+TEST_F(TestSession, AbortOnSendFailure)
+{
+    FakeConn *a = add_conn(sender, mct);
+    FakeConn *b = add_conn(sender, mct);
+    FakeConn *ra = add_conn(receiver, mct);
+    FakeConn *rb = add_conn(receiver, mct);
+
+    b->fail = true;
+    ASSERT_EQ(send(sender, mct, 0, 100), -1);
+    ASSERT_EQ(a->sent.size(), 2U);
+    ASSERT_EQ(hdr_of(a->sent[1]).frag_cnt, 0U);
+    ASSERT_FALSE(a->closed);
+
+    b->fail = false;
+    ASSERT_EQ(send(sender, mct, 1, 100), 0);
+
+    feed(receiver, a, ra);
+    feed(receiver, b, rb);
+    ASSERT_EQ(cb.msgs.size(), 1U);
+    ASSERT_TRUE(check_msg(cb.msgs[0], 1, 100));
+    ASSERT_TRUE(receiver->stripe_recvs.empty());
+
+    a->fail = true;
+    b->fail = true;
+    ASSERT_EQ(send(sender, mct, 2, 100), -1);
+    ASSERT_TRUE(a->closed);
+    ASSERT_TRUE(b->closed);
+}
+
+int main(int argc, char  **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
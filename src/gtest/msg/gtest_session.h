@@ -0,0 +1,79 @@
+#include <gtest/gtest.h>
+#include <iostream>
+
+#ifdef GTEST
+#define private public
+#define protected public
+#endif
+#include "msg/Session.h"
+#include "msg/MsgManager.h"
+#include "msg/Msg.h"
+#include "msg/msg_context.h"
+#include "msg/internal/msg_config.h"
+
+#include <vector>
+
+using namespace std;
+using namespace flame;
+using namespace flame::msg;
+
+/**
+ * 记录交付的消息
+ */
+class RecvCb : public MsgerCallback{
+public:
+    std::vector<Msg *> msgs;
+
+    virtual void on_conn_recv(Connection *conn, Msg *msg) override {
+        msg->get();
+        msgs.push_back(msg);
+    }
+
+    void clear(){
+        for(auto msg : msgs){
+            msg->put();
+        }
+        msgs.clear();
+    }
+};
+
+class TestSession:public testing::Test
+{
+public:
+    static void SetUpTestCase(){
+    }
+
+    static void TearDownTestCase(){
+    }
+
+    void SetUp(){
+        mct = new MsgContext(FlameContext::get_context());
+        config = new MsgConfig(mct->fct);
+        config->msg_worker_type = msg_worker_type_t::THREAD;
+        config->msg_worker_poll_mode = msg_worker_poll_mode_t::BLOCK;
+        config->msg_stripe_conn_num = 3;
+        config->msg_stripe_min_size = 0;
+        mct->config = config;
+        mgr = new MsgManager(mct, 1);
+        mgr->set_msger_cb(&cb);
+        mct->manager = mgr;
+        sender = new Session(mct, msger_id_t());
+        receiver = new Session(mct, msger_id_t());
+    }
+
+    void TearDown(){
+        sender->put();
+        receiver->put();
+        cb.clear();
+        delete mgr;
+        delete config;
+        delete mct;
+    }
+
+    MsgContext *mct;
+    MsgConfig *config;
+    MsgManager *mgr;
+    RecvCb cb;
+    Session *sender;
+    Session *receiver;
+};// class TestSession
@@ -0,0 +1,135 @@
+#include "gtest/orm/gtest_pool.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using namespace flame::orm;
+
+/**
+ * 不连接数据库的Stub，只用于测试连接池的借还
+ */
+class FakeStub : public Stub {
+public:
+    FakeStub(FlameContext* fct) : Stub(fct) {}
+
+    std::shared_ptr<Result> execute(const std::string& stmt) override { return nullptr; }
+    std::shared_ptr<Result> execute_query(const std::string& stmt) override { return nullptr; }
+    std::shared_ptr<Result> execute_update(const std::string& stmt) override { return nullptr; }
+    bool ping() override { return true; }
+
+    std::atomic<int> owners {0};
+}; // class FakeStub
+
+class FakeDriver : public Driver {
+public:
+    FakeDriver(FlameContext* fct) : Driver(fct, "fake", "") {}
+
+    std::shared_ptr<Stub> create_stub() const override {
+        created++;
+        return std::shared_ptr<Stub>(new FakeStub(fct_));
+    }
+
+    mutable std::atomic<int> created {0};
+}; // class FakeDriver
+
+/**
+ * 每个slot独占一条缓存行
+ */
+TEST_F(TestStubPool, SlotAlign)
+{
+    FlameContext* fct = FlameContext::get_context();
+    FakeDriver driver(fct);
+    StubPool pool(fct, &driver, 2, 8);
+    ASSERT_EQ(alignof(StubPool::slot_t), 64U);
+    ASSERT_EQ(sizeof(StubPool::slot_t), 64U);
+    ASSERT_EQ((uintptr_t)pool.slots_ % 64, 0U);
+    ASSERT_EQ(pool.init(), 2U);
+    ASSERT_EQ(driver.created.load(), 2);
+}
+
+/**
+ * 多个线程争抢少量stub，同一stub不会同时借给两个线程，
+ * 借用次数与等待次数都被统计，连接数不超过上限
+ */
+TEST_F(TestStubPool, ConcurrentAcquire)
+{
+    const int threads = 16;
+    const int loops = 500;
+    FlameContext* fct = FlameContext::get_context();
+    FakeDriver driver(fct);
+    StubPool pool(fct, &driver, 2, 4);
+    ASSERT_EQ(pool.init(), 2U);
+
+    std::atomic<int> conflict {0};
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&]() {
+            for (int i = 0; i < loops; i++) {
+                int slot = pool.acquire();
+                FakeStub* stub = static_cast<FakeStub*>(pool.stub(slot));
+                if (stub->owners.fetch_add(1) != 0)
+                    conflict++;
+                if (i % 16 == 0)
+                    std::this_thread::sleep_for(std::chrono::microseconds(200));
+                stub->owners.fetch_sub(1);
+                pool.release(slot);
+            }
+        });
+    }
+    for (auto& w : workers)
+        w.join();
+    ASSERT_EQ(conflict.load(), 0);
+
+    pool_stat_t stat;
+    pool.get_stat(stat);
+    ASSERT_EQ(stat.acquire, (uint64_t)threads * loops);
+    ASSERT_GT(stat.wait, 0U);
+    ASSERT_GE(stat.max_wait_us * stat.wait, stat.wait_us);
+    ASSERT_EQ(stat.busy, 0U);
+    ASSERT_GE(stat.size, 2U);
+    ASSERT_LE(stat.size, 4U);
+    ASSERT_EQ(stat.size, pool.count());
+}
+
+/**
+ * 有线程等待时keeper扩容，但不超过上限
+ */
+TEST_F(TestStubPool, GrowWithinMax)
+{
+    FlameContext* fct = FlameContext::get_context();
+    FakeDriver driver(fct);
+    StubPool pool(fct, &driver, 1, 3);
+    ASSERT_EQ(pool.init(), 1U);
+
+    std::vector<int> held;
+    held.push_back(pool.acquire());
+    std::atomic<bool> got {false};
+    std::thread waiter([&]() {
+        int slot = pool.acquire();
+        got = true;
+        pool.release(slot);
+    });
+    for (int i = 0; i < 100 && !got; i++) {
+        pool.maintain();
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    waiter.join();
+    ASSERT_TRUE(got.load());
+    ASSERT_GE(pool.count(), 2U);
+
+    while (held.size() < pool.count())
+        held.push_back(pool.acquire());
+    for (int i = 0; i < 10; i++)
+        pool.maintain();
+    ASSERT_LE(pool.count(), 3U);
+    for (int slot : held)
+        pool.release(slot);
+}
+
+int main(int argc, char  **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
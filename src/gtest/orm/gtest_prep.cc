@@ -0,0 +1,56 @@
+#include "gtest/orm/gtest_prep.h"
+
+using namespace flame::orm;
+
+TEST_F(TestPrepStmt, CountParam)
+{
+    EXPECT_EQ(PrepStmt::count_param_(""), 0U);
+    EXPECT_EQ(PrepStmt::count_param_("SELECT * FROM `t`"), 0U);
+    EXPECT_EQ(PrepStmt::count_param_("SELECT * FROM `t` WHERE `a` = ? AND `b` = ?"), 2U);
+    EXPECT_EQ(PrepStmt::count_param_("INSERT INTO `t` (`a`, `b`, `c`) VALUES (?, ?, ?)"), 3U);
+
+    // 字面量中的'?'不是占位符，字面量中的引号转义为''
+    EXPECT_EQ(PrepStmt::count_param_("SELECT * FROM `t` WHERE `s` = '?' AND `a` = ?"), 1U);
+    EXPECT_EQ(PrepStmt::count_param_("SELECT * FROM `t` WHERE `s` = 'it''s ?' AND `a` = ?"), 1U);
+    EXPECT_EQ(PrepStmt::count_param_("SELECT * FROM `t` WHERE `s` = '''?''' AND `a` = ?"), 1U);
+    EXPECT_EQ(PrepStmt::count_param_("SELECT * FROM `t` WHERE `s` = '' AND `a` = ?"), 1U);
+
+    PrepStmt ps("UPDATE `t` SET `a` = ? WHERE `s` = '?' AND `b` = ?", false);
+    EXPECT_EQ(ps.param_count(), 2U);
+    EXPECT_FALSE(ps.is_query());
+}
+
+TEST_F(TestPrepStmt, Render)
+{
+    PrepStmt ps("SELECT * FROM `t` WHERE `a` = ? AND `b` = ? AND `c` = ? AND `d` = ?", true);
+    ASSERT_EQ(ps.param_count(), 4U);
+    EXPECT_EQ(ps.render({-7, 18446744073709551615ULL, "x", Param()}),
+        "SELECT * FROM `t` WHERE `a` = -7 AND `b` = 18446744073709551615 AND `c` = 'x' AND `d` = NULL");
+    EXPECT_EQ(ps.render({0.5, 1, 2, 3}),
+        "SELECT * FROM `t` WHERE `a` = " + Param(0.5).to_str() + " AND `b` = 1 AND `c` = 2 AND `d` = 3");
+
+    // 缺少的参数按NULL，多余的参数忽略
+    EXPECT_EQ(ps.render({1}),
+        "SELECT * FROM `t` WHERE `a` = 1 AND `b` = NULL AND `c` = NULL AND `d` = NULL");
+    EXPECT_EQ(ps.render({1, 2, 3, 4, 5}),
+        "SELECT * FROM `t` WHERE `a` = 1 AND `b` = 2 AND `c` = 3 AND `d` = 4");
+}
+
+TEST_F(TestPrepStmt, RenderLiteral)
+{
+    // 字面量原样保留，其中的'?'不被替换
+    PrepStmt ps("SELECT * FROM `t` WHERE `s` = 'it''s ?' AND `a` = ?", true);
+    ASSERT_EQ(ps.param_count(), 1U);
+    EXPECT_EQ(ps.render({9}), "SELECT * FROM `t` WHERE `s` = 'it''s ?' AND `a` = 9");
+
+    // 字符串参数中的引号被转义，参数中的'?'不影响后续占位符
+    PrepStmt ps2("INSERT INTO `t` (`s`, `a`) VALUES (?, ?)", false);
+    EXPECT_EQ(ps2.render({"a'?b", 2}), "INSERT INTO `t` (`s`, `a`) VALUES ('a''?b', 2)");
+    EXPECT_EQ(PrepStmt::count_param_(ps2.render({"a'?b", 2})), 0U);
+}
+
+int main(int argc, char  **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
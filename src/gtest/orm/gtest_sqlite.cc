@@ -0,0 +1,69 @@
+#include "gtest/orm/gtest_sqlite.h"
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace flame::orm;
+
+/**
+ * 多个线程并发读写内存库，所有操作都应成功
+ */
+TEST_F(TestSqlite, MemoryConcurrent)
+{
+    const int threads = 8;
+    const int loops = 2000;
+    FlameContext* fct = FlameContext::get_context();
+    std::shared_ptr<DBEngine> engine = DBEngine::create_engine(fct, "sqlite:///:memory:", 4, 8);
+    ASSERT_TRUE(engine != nullptr);
+    // 共享缓存的内存库冲突时返回SQLITE_LOCKED，只保留一个连接
+    ASSERT_EQ(engine->stub_pool_.count(), 1U);
+
+    std::shared_ptr<Result> res = engine->execute(
+        "CREATE TABLE IF NOT EXISTS `kv` (`k` BIGINT PRIMARY KEY, `v` BIGINT)");
+    ASSERT_TRUE(res && res->OK());
+    PrepStmt ins("INSERT INTO `kv` (`k`, `v`) VALUES (?, ?)", false);
+    PrepStmt upd("UPDATE `kv` SET `v` = ? WHERE `k` = ?", false);
+    PrepStmt sel("SELECT `v` FROM `kv` WHERE `k` = ?", true);
+
+    std::atomic<int> faild {0};
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&, t]() {
+            for (int i = 0; i < loops; i++) {
+                uint64_t k = (uint64_t)t * loops + i;
+                std::shared_ptr<Result> r;
+                switch (i % 3) {
+                case 0:
+                    r = engine->execute_prepared(ins, {k, i});
+                    break;
+                case 1:
+                    r = engine->execute_prepared(upd, {i + 1, k - 1});
+                    break;
+                default:
+                    r = engine->execute_prepared(sel, {k - 2});
+                    if (r && r->OK() && r->len() != 1)
+                        faild++;
+                    break;
+                }
+                if (!r || !r->OK())
+                    faild++;
+            }
+        });
+    }
+    for (auto& w : workers)
+        w.join();
+    ASSERT_EQ(faild.load(), 0);
+
+    res = engine->execute_query("SELECT COUNT(*) FROM `kv`");
+    ASSERT_TRUE(res && res->OK());
+    std::shared_ptr<DataSet> ds = res->data_set();
+    ASSERT_EQ(ds->cbegin()->get_int((size_t)0), threads * ((loops + 2) / 3));
+}
+
+int main(int argc, char  **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
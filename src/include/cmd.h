@@ -17,9 +17,12 @@
 #include <stdint.h>
 #include <queue>
 #include <map>
+#include <vector>
+#include <atomic>
 
 #include "msg/msg_core.h"
 #include "libflame/libchunk/log_libchunk.h"
+#include "include/retcode.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -486,24 +489,62 @@ protected:
 
 typedef void(*cmd_cb_fn_t)(const Response& res, void* arg);
 class RdmaWorkRequest;
-
-struct MsgCallBack{
-    cmd_cb_fn_t cb_fn;
-    void* cb_arg;
-};
+class TcpWorkRequest;
 
 class CmdClientStub {
 public:
     // static std::shared_ptr<CmdClientStub> create_stub(std::string ip_addr, int port) = 0;
-    virtual std::map<uint32_t, MsgCallBack>& get_cb_map() = 0;
-
     virtual int submit(RdmaWorkRequest& req, cmd_cb_fn_t cb_fn, void* cb_arg) = 0;
+
+    /**
+     * @brief 提交命令（与传输方式无关）
+     * 命令中的MemoryArea指向本地内存：写命令从中取数据，读命令的数据在回调前放入其中
+     * @param cmd 
+     * @param cb_fn 命令得到回复后的回调函数
+     * @param cb_arg 回调函数的参数
+     * @return int RC_SUCCESS | RC_REFUSED(队列已满) | RC_FAILD
+     */
+    virtual int submit(const cmd_t& cmd, cmd_cb_fn_t cb_fn, void* cb_arg) = 0;
+
+    /**
+     * @brief 批量提交，cmds[i]的回调参数为cb_args[i]
+     * 默认逐条提交；具体传输可以合并为一次doorbell/一次sendmsg
+     * @param cmds 
+     * @param cb_fn 
+     * @param cb_args 与cmds等长
+     * @return int 成功提交的命令数；队列满或出错时停止，其后的命令未提交
+     */
+    virtual int submit_batch(const std::vector<cmd_t>& cmds, cmd_cb_fn_t cb_fn, const std::vector<void*>& cb_args) {
+        size_t i;
+        for (i = 0; i < cmds.size(); i++) {
+            if (submit(cmds[i], cb_fn, cb_args[i]) != RC_SUCCESS)
+                break;
+        }
+        return (int)i;
+    }
+
+    /**
+     * @brief 收到命令响应，按cqg/cqn找到命令并回调
+     * 
+     * @param res 
+     * @param data 响应携带的内联数据
+     * @param len 内联数据长度
+     * @return int RC_SUCCESS | RC_OBJ_NOT_FOUND(过期或未知的响应)
+     */
+    virtual int complete(const cmd_res_t& res, void* data, uint32_t len) = 0;
+
+    /**
+     * @brief 设置本客户端的ID(gw_id)，之后提交的Chunk IO命令都带上该ID，CSD据此执行客户端QoS
+     * @param client_id 0表示未知
+     */
+    void set_client_id(uint64_t client_id) { client_id_ = client_id; }
+
+    uint64_t get_client_id() const { return client_id_; }
 protected:
     CmdClientStub() {}
     ~CmdClientStub() {}
-    // std::queue<MsgCallBack> msg_cb_q_;
-    std::map<uint32_t, MsgCallBack> msg_cb_map_;
- 
+
+    uint64_t client_id_ {0};
 }; // class CommandStub 
 
 
@@ -511,31 +552,125 @@ class CmdService {
 public:
     virtual int call(RdmaWorkRequest *req) = 0;
 
+    virtual int call(TcpWorkRequest *req) = 0;
+
 protected:
     CmdService() {}
     virtual ~CmdService() {}
 }; // class CmdService
 
+#define CMD_SERVICE_TABLE_SIZE  (1U << 16)
+#define CMD_STAT_LAT_BUCKETS    40      // log2(ns)
+
+/**
+ * @brief 每种命令的统计信息
+ */
+struct cmd_stat_t {
+    std::atomic<uint64_t> count {0};
+    std::atomic<uint64_t> bytes {0};
+    std::atomic<uint64_t> lat_sum {0};                      // (ns)
+    std::atomic<uint64_t> lat_hist[CMD_STAT_LAT_BUCKETS];   // 第i个桶: [2^i, 2^(i+1)) ns
+
+    cmd_stat_t() {
+        for (int i = 0; i < CMD_STAT_LAT_BUCKETS; i++)
+            lat_hist[i] = 0;
+    }
+};
+
+/**
+ * @brief 命令分发表
+ * 以 (cls << 8) | seq 直接索引的定长表。启动阶段注册服务，之后调用freeze()，
+ * 冻结后表只读，分发时无需加锁。
+ */
 class CmdServiceMapper {
 public:
-    CmdServiceMapper(){}
+    static CmdServiceMapper* get_cmd_service_mapper(){
+        static CmdServiceMapper mapper;
+        return &mapper;
+    }
 
-    ~CmdServiceMapper(){}
+    /**
+     * @brief 注册服务（只能在freeze()之前调用）
+     * 
+     * @param cmd_cls 
+     * @param cmd_num 
+     * @param svi 
+     * @return int RC_SUCCESS | RC_REFUSED(已冻结)
+     */
+    int register_service(uint8_t cmd_cls, uint8_t cmd_num, CmdService* svi);
+
+    /**
+     * @brief 冻结分发表，之后不再接受注册
+     */
+    void freeze() { frozen_.store(true, std::memory_order_release); }
 
-    static CmdServiceMapper* g_cmd_service_mapper;
+    bool is_frozen() const { return frozen_.load(std::memory_order_acquire); }
 
-    static CmdServiceMapper* get_cmd_service_mapper(){
-        if (g_cmd_service_mapper == nullptr) {
-            g_cmd_service_mapper = new CmdServiceMapper();
-        }
-        return CmdServiceMapper::g_cmd_service_mapper; 
+    /**
+     * @brief 查找服务
+     * 
+     * @return CmdService* 未注册的命令返回nullptr
+     */
+    inline CmdService* get_service(uint8_t cmd_cls, uint8_t cmd_num) const {
+        return services_[(cmd_cls << 8) | cmd_num];
     }
 
-    void register_service(uint8_t cmd_cls, uint8_t cmd_num, CmdService* svi);
+    /**
+     * @brief 开启/关闭统计
+     */
+    void set_stat_enable(bool enable) { stat_enable_.store(enable, std::memory_order_relaxed); }
+
+    bool stat_enable() const { return stat_enable_.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief 记录一次命令的处理（统计关闭或命令未注册时忽略）
+     * 
+     * @param cmd_cls 
+     * @param cmd_num 
+     * @param bytes 数据长度
+     * @param lat 从收到命令到发出响应 (ns)
+     */
+    inline void record(uint8_t cmd_cls, uint8_t cmd_num, uint64_t bytes, uint64_t lat) {
+        if (!stat_enable())
+            return;
+        cmd_stat_t* st = stats_[(cmd_cls << 8) | cmd_num];
+        if (!st)
+            return;
+        int b = 63 - __builtin_clzll(lat | 1);
+        st->count.fetch_add(1, std::memory_order_relaxed);
+        st->bytes.fetch_add(bytes, std::memory_order_relaxed);
+        st->lat_sum.fetch_add(lat, std::memory_order_relaxed);
+        st->lat_hist[b < CMD_STAT_LAT_BUCKETS ? b : CMD_STAT_LAT_BUCKETS - 1].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief 获取统计信息
+     * 
+     * @return const cmd_stat_t* 未注册的命令返回nullptr
+     */
+    const cmd_stat_t* get_stat(uint8_t cmd_cls, uint8_t cmd_num) const {
+        return stats_[(cmd_cls << 8) | cmd_num];
+    }
+
+    /**
+     * @brief 命令访问的数据长度（Chunk读写为ma.len，其他命令为0）
+     */
+    static uint32_t get_io_bytes(const cmd_t* cmd);
 
-    CmdService* get_service(uint8_t cmd_cls, uint8_t cmd_num);
 private:
-    std::map<uint16_t, CmdService*> service_mapper_;
+    CmdServiceMapper() : frozen_(false), stat_enable_(false) {
+        for (uint32_t i = 0; i < CMD_SERVICE_TABLE_SIZE; i++) {
+            services_[i] = nullptr;
+            stats_[i] = nullptr;
+        }
+    }
+
+    ~CmdServiceMapper();
+
+    CmdService* services_[CMD_SERVICE_TABLE_SIZE];
+    cmd_stat_t* stats_[CMD_SERVICE_TABLE_SIZE];
+    std::atomic<bool> frozen_;
+    std::atomic<bool> stat_enable_;
 }; // class CmdServiceMapper
 
 class CmdServerStub {
@@ -44,10 +44,15 @@ struct cmd_chk_io_rd_t {
     chk_id_t    chk_id; // 8 B;
     uint64_t    off;    // 8 B;
     cmd_ma_t    ma;     // 16 B; 访问的数据大小由 dm.len 确定
-} __attribute__ ((packed)); // 32 B;
+    uint64_t    client_id;  // 8 B; 发起IO的客户端(gw_id)，0表示未知，CSD据此执行客户端QoS
+} __attribute__ ((packed)); // 40 B;
+
+// 读的区间未分配：响应不带数据，也没有RDMA WRITE，客户端将目标内存填0
+#define CMD_CHK_IO_RD_ZERO  0x1U
 
 struct res_chk_io_rd_t {
     uint32_t inline_data_len;
+    uint32_t flags;
 } __attribute__ ((packed));
 
 struct cmd_chk_io_wr_t {
@@ -55,7 +60,8 @@ struct cmd_chk_io_wr_t {
     uint64_t    off;    // 8 B;
     cmd_ma_t    ma;     // 16 B; 访问的数据大小由 dm.len 确定
     uint32_t    inline_data_len;   // 4 B;
-} __attribute__ ((packed)); // 36 B;
+    uint64_t    client_id;  // 8 B;
+} __attribute__ ((packed)); // 44 B;
 
 /**
  * chunk io - set & reset
@@ -68,7 +74,8 @@ struct cmd_chk_io_set_t {
     chk_id_t    chk_id; // 8 B;
     uint64_t    off;    // 8 B;
     uint32_t    len;    // 4 B;
-} __attribute__((packed));  // 20 B;
+    uint64_t    client_id;  // 8 B;
+} __attribute__((packed));  // 28 B;
 
 
 #ifdef __cplusplus
@@ -88,7 +95,10 @@ public:
         cmd_->hdr.cqg = CMD_CLS_CSD;
         rd_->chk_id = chk_id;
         rd_->off = off;
+        rd_->ma.addr = 0;   // 未指定内存，数据以内联方式返回
         rd_->ma.len = len;
+        rd_->ma.key = 0;
+        rd_->client_id = 0;
     }
 
     ChunkReadCmd(cmd_t* rd_cmd, uint64_t chk_id, uint64_t off, uint32_t len, const MemoryArea& ma)
@@ -100,6 +110,7 @@ public:
         rd_->ma.addr = ma.get_addr_uint64();
         rd_->ma.len = len < ma.get_len() ? len : ma.get_len();
         rd_->ma.key = ma.get_key();
+        rd_->client_id = 0;
     }
 
     ~ChunkReadCmd() {}
@@ -118,6 +129,10 @@ public:
 
     inline uint32_t get_ma_key() const { return rd_->ma.key; }
 
+    inline uint64_t get_client_id() const { return rd_->client_id; }
+
+    inline void set_client_id(uint64_t client_id) { rd_->client_id = client_id; }
+
 private:
     cmd_chk_io_rd_t* rd_;
 }; // class ChunkReadCmd
@@ -136,7 +151,7 @@ public:
         wr_->ma.addr = ma.get_addr_uint64();
         wr_->ma.len = len < ma.get_len() ? len : ma.get_len();
         wr_->ma.key = ma.get_key();
-        
+        wr_->client_id = 0;
 
         if (force_inline && ma.is_dma() && ma.get_len() <= 4096) { // 内联数据传递，跟随request一起传输
             wr_->inline_data_len = len < ma.get_len() ? len : ma.get_len();
@@ -171,6 +186,10 @@ public:
 
     inline void* get_inline_data_addr() const { return inline_data; }
 
+    inline uint64_t get_client_id() const { return wr_->client_id; }
+
+    inline void set_client_id(uint64_t client_id) { wr_->client_id = client_id; }
+
 private:
     cmd_chk_io_wr_t* wr_;
     void* inline_data;
@@ -189,6 +208,7 @@ public:
         set_->chk_id = chk_id;
         set_->off = off;
         set_->len = len;
+        set_->client_id = 0;
     }
 
     ~ChunkSetCmd() {}
@@ -203,11 +223,13 @@ public:
 
     inline uint32_t get_set_len() const { return set_->len; }
 
+    inline uint64_t get_client_id() const { return set_->client_id; }
+
 private:
     cmd_chk_io_set_t* set_;
 }; // class ChunkSetCmd
 
-class ChunkResetCmd : Command {
+class ChunkResetCmd : public Command {
 public:
     ChunkResetCmd(cmd_t* cmdp) 
     : Command(cmdp), reset_((cmd_chk_io_set_t*)get_content()) {}
@@ -219,13 +241,14 @@ public:
         reset_->chk_id = chk_id;
         reset_->off = off;
         reset_->len = len;
+        reset_->client_id = 0;
     }
 
     ~ChunkResetCmd() {}
 
-    // inline void copy(void* buff) {
-    //     memcpy(buff, (void*)&set_cmd_, sizeof(cmd_t));
-    // }
+    inline void copy(void* buff) {
+        memcpy(buff, (void*)cmd_, sizeof(cmd_t));
+    }
 
     inline uint64_t get_chk_id() const { return reset_->chk_id; }
 
@@ -233,6 +256,8 @@ public:
 
     inline uint32_t get_reset_len() const { return reset_->len; }
 
+    inline uint64_t get_client_id() const { return reset_->client_id; }
+
 private:
     cmd_chk_io_set_t* reset_;
 }; // class ChunkSetCmd
@@ -245,7 +270,6 @@ public:
     CommonRes(cmd_res_t* res, const Command& command, cmd_rc_t rc)
     : Response(res) {
         cpy_hdr(command);
-        res_->hdr.cqg = CMD_CLS_CSD;
         set_len(sizeof(cmd_res_t));
         set_rc(rc);
     }
@@ -265,19 +289,19 @@ public:
     ChunkReadRes(cmd_res_t* res, const Command& command, cmd_rc_t rc)
     : Response(res), inline_data_(nullptr), rd_((res_chk_io_rd_t*)res_->cont) {
         cpy_hdr(command);
-        res_->hdr.cqg = CMD_CLS_CSD;
         set_len(sizeof(cmd_res_t));
         set_rc(rc);
         rd_->inline_data_len = 0;
+        rd_->flags = 0;
     }
 
     ChunkReadRes(cmd_res_t* res, const Command& command, cmd_rc_t rc, void* inline_buff, uint32_t len)
     : Response(res), inline_data_(inline_buff), rd_((res_chk_io_rd_t*)res_->cont) {
         cpy_hdr(command);
-        res_->hdr.cqg = CMD_CLS_CSD;
         set_len(sizeof(cmd_res_t));
         set_rc(rc);
         rd_->inline_data_len = len;
+        rd_->flags = 0;
     }
 
     ~ChunkReadRes() {}
@@ -291,11 +315,35 @@ public:
 
     inline uint32_t get_inline_len() const {return rd_->inline_data_len;}
 
+    inline void set_zero() { rd_->flags |= CMD_CHK_IO_RD_ZERO; }
+
+    inline bool is_zero() const { return rd_->flags & CMD_CHK_IO_RD_ZERO; }
+
 private:
     res_chk_io_rd_t* rd_;
     void* inline_data_;
 }; // class ChunkReadRes
 
+/**
+ * @brief 在Chunk IO命令中填写发起IO的客户端，由客户端句柄在提交时调用
+ */
+inline void chunk_cmd_set_client_id(cmd_t* cmd, uint64_t client_id) {
+    if (cmd->hdr.cn.cls != CMD_CLS_IO_CHK)
+        return;
+    switch (cmd->hdr.cn.seq) {
+    case CMD_CHK_IO_READ:
+        ((cmd_chk_io_rd_t*)cmd->cont)->client_id = client_id;
+        break;
+    case CMD_CHK_IO_WRITE:
+        ((cmd_chk_io_wr_t*)cmd->cont)->client_id = client_id;
+        break;
+    case CMD_CHK_IO_SET:
+    case CMD_CHK_IO_RESET:
+        ((cmd_chk_io_set_t*)cmd->cont)->client_id = client_id;
+        break;
+    }
+}
+
 } // namespace flame
 
 
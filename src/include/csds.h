@@ -22,6 +22,12 @@ struct chunk_move_attr_t {
     uint64_t    src_id; // src csd id
     uint64_t    dst_id; // dst csd id
     uint32_t    signal; // 1: 迁移; 2: 强制迁移
+    uint64_t    dst_addr {0};   // dst csd admin addr
+};
+
+enum ChunkMoveSignal {
+    CHK_MOVE_NOTIFY = 1,    // 在线迁移，受带宽限制
+    CHK_MOVE_FORCE  = 2     // 强制迁移，不限制带宽
 };
 
 struct chunk_signal_t {
@@ -36,6 +42,34 @@ struct chunk_bulk_res_t {
 
 class CsdsAsyncChannel;
 
+/**
+ * @brief Chunk数据写入流
+ * 用于CSD之间迁移Chunk数据，数据段按顺序发送，
+ * 在finish()之前可以连续写入多个数据段（流水线）
+ */
+class CsdsChunkWriter {
+public:
+    virtual ~CsdsChunkWriter() {}
+
+    /**
+     * @brief 发送一个数据段
+     * 只在流控窗口已满时阻塞
+     * @return int 0 iff success
+     */
+    virtual int write(uint64_t off, const void* buff, uint64_t len) = 0;
+
+    /**
+     * @brief 结束数据流，并等待目标CSD确认全部数据段已写入
+     * @return int 0 iff success
+     */
+    virtual int finish() = 0;
+
+protected:
+    explicit CsdsChunkWriter(FlameContext* fct) : fct_(fct) {}
+
+    FlameContext* fct_;
+}; // class CsdsChunkWriter
+
 class CsdsClient {
 public:
     virtual ~CsdsClient() {}
@@ -49,6 +83,9 @@ public:
     // 推送Chunk信号：告知Chunk的行为或状态
     virtual int chunk_signal(const std::list<chunk_signal_t>& chk_sgn_list) = 0;
 
+    // 打开Chunk数据写入流（迁移）
+    virtual std::shared_ptr<CsdsChunkWriter> chunk_write(uint64_t chk_id) = 0;
+
     /**
      * MGR Ctrl
      */
@@ -71,6 +108,9 @@ public:
     // Chunk迁移通告
     virtual int chunk_move(std::list<chunk_bulk_res_t>& res, const std::list<chunk_move_attr_t>& attr_list) = 0;
 
+    // 设置卷/客户端的QoS
+    virtual int qos_set(const std::list<qos_attr_t>& qos_list) = 0;
+
 protected:
     explicit CsdsClient(FlameContext* fct) : fct_(fct) {}
 
@@ -76,6 +76,12 @@ public:
     // 更改Volume大小
     virtual int resize_volume(const std::string& vg_name, const std::string& vol_name, uint64_t new_size) = 0;
     
+    // 设置Volume的QoS（attr.type与attr.id被忽略）
+    virtual int set_volume_qos(const std::string& vg_name, const std::string& vol_name, const qos_attr_t& attr) = 0;
+    
+    // 设置客户端(GW)的QoS（attr.type与attr.id被忽略）
+    virtual int set_client_qos(uint64_t gw_id, const qos_attr_t& attr) = 0;
+    
     // 打开Volume：在MGR登记Volume访问信息（没有加载元数据信息）
     virtual int open_volume(uint64_t gw_id, const std::string& vg_name, const std::string& vol_name) = 0;
     
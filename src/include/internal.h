@@ -27,6 +27,20 @@ struct csd_hlt_attr_t {
     std::list<chk_hlt_attr_t> chk_hlt_list;
 }; //struct csd_hlt_attr_t
 
+/**
+ * @brief CSD周期汇报，chk_delta为ChunkHealthEncoder的编码结果
+ */
+struct csd_report_attr_t {
+    uint64_t        csd_id      {0};
+    uint32_t        stat        {0};
+    uint64_t        seq         {0};
+    uint64_t        base_seq    {0};    // 0表示全量
+    bool            has_health  {false};
+    csd_hlt_sub_t   csd_hlt_sub;
+    uint32_t        chk_num     {0};
+    std::string     chk_delta   {};
+}; // struct csd_report_attr_t
+
 struct related_chk_attr_t {
     uint64_t       org_id      {0};
     uint64_t       chk_id      {0};
@@ -67,6 +81,9 @@ public:
     // CSD健康信息汇报
     virtual int push_health(const csd_hlt_attr_t& csd_hlt_attr) = 0;
 
+    // CSD周期汇报（心跳+状态+健康信息），need_full返回MGR是否要求下一次全量汇报
+    virtual int push_report(const csd_report_attr_t& attr, bool& need_full) = 0;
+
     // 拉取关联Chunk信息
     virtual int pull_related_chunk(std::list<related_chk_attr_t>& res, const std::list<uint64_t>& chk_list) = 0;
 
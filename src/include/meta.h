@@ -251,6 +251,25 @@ struct vol_attr_t {
     uint32_t spolicy;
 };
 
+/**
+ * qos attr
+ */
+enum QosType {
+    QOS_TYPE_VOL    = 1,    // id: vol_id
+    QOS_TYPE_CLIENT = 2     // id: gw_id
+};
+
+struct qos_attr_t {
+    uint32_t type       {QOS_TYPE_VOL};
+    uint64_t id         {0};
+    uint64_t rsv_iops   {0};    // 预留IOPS，0表示不预留
+    uint64_t lim_iops   {0};    // IOPS上限，0表示不限
+    uint64_t lim_bps    {0};    // 带宽上限 (B/s)，0表示不限
+    uint64_t burst_iops {0};    // 允许的突发量，0表示等于1s的上限
+    uint64_t burst_bps  {0};
+    uint32_t weight     {1};    // 争用时按权重分配
+};
+
 /**
  * chunk attr
  */
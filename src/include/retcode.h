@@ -49,8 +49,14 @@ enum RetCode {
     /**
      * 重复操作：指无意义的重复
      */
-    RC_MULTIPLE_OPERATE = 7
+    RC_MULTIPLE_OPERATE = 7,
 #define RC_STR_MULTIPLE_OPERATE "multiple operate"
+
+    /**
+     * 超时：在期限内没有得到响应
+     */
+    RC_TIMEOUT = 8
+#define RC_STR_TIMEOUT "timeout"
 };
 
 } // namespace flame
@@ -12,6 +12,7 @@
 
 #include <iostream>
 #include <cstring>
+#include <memory>
 
 #include "include/csdc.h"
 #include "include/retcode.h"
@@ -28,56 +29,190 @@ inline void io_cb_func(RdmaWorkRequest* req){
     req->run();
     return ;
 }
+
+inline void tcp_io_cb_func(TcpWorkRequest* req){
+    req->status = TcpWorkRequest::Status::EXEC_DONE;
+    req->run();
+    return ;
+}
+
 /**
  * @name: chunk_io_rw_mem
- * @describtions:  模拟io从硬盘到RDMA内存的过程
+ * @describtions:  模拟io从硬盘到内存的过程，RDMA与TCP传输共用
  * @param   chk_id_t    chunk_id            chunk的id
  *          chk_off_t   offset              访问chunk的偏移
  *          uint32_t    len                 读/写长度
- *          uint64_t    laddr               本地的RDMA内存
+ *          uint64_t    laddr               本地内存
  *          bool        rw                  判断 读/写 标志
  * @return: 
  */
-inline int chunk_io_rw_mem(chk_id_t chunk_id, chk_off_t offset, uint32_t len, uint64_t laddr, bool rw, io_cb_fn_t cb_fn, RdmaWorkRequest* cb_arg){
+template<typename Req>
+inline int chunk_io_rw_mem(chk_id_t chunk_id, chk_off_t offset, uint32_t len, uint64_t laddr, bool rw, void(*cb_fn)(Req*), Req* cb_arg){
+    static const char sim_data[] = "abcdefghijklmnopq";
     if(rw){ //**write
-        char *disk = new char[len];
+        std::unique_ptr<char[]> disk(new char[len]);
         FlameContext* fct = FlameContext::get_context();
-        fct->log()->ltrace("%c%c%c",((char *)laddr)[0], ((char *)laddr)[1], ((char *)laddr)[2]); 
-        memcpy(disk, (void *)laddr, len); 
+        if(len >= 3)
+            fct->log()->ltrace("%c%c%c",((char *)laddr)[0], ((char *)laddr)[1], ((char *)laddr)[2]); 
+        memcpy(disk.get(), (void *)laddr, len); 
         fct->log()->ltrace("write simdisk done");
     }
     else{   //**read
-        char *disk = new char[len];
-        strcpy(disk,"abcdefghijklmnopq");
-        memcpy((void *)laddr, disk, len);
+        memset((void *)laddr, 0, len);
+        memcpy((void *)laddr, sim_data, len < sizeof(sim_data) ? len : sizeof(sim_data));
     }
     cb_fn(cb_arg);
     return RC_SUCCESS;
 }
 
 
+/**
+ * @name: chunk_io_zero_mem
+ * @describtions:  模拟清零（打洞）的过程，不需要数据缓冲
+ * @return: 
+ */
+template<typename Req>
+inline int chunk_io_zero_mem(chk_id_t chunk_id, chk_off_t offset, uint32_t len, void(*cb_fn)(Req*), Req* cb_arg){
+    FlameContext* fct = FlameContext::get_context();
+    fct->log()->ltrace("zero simdisk chk(%llu) off(%llu) len(%u)", (unsigned long long)chunk_id, (unsigned long long)offset, len);
+    cb_fn(cb_arg);
+    return RC_SUCCESS;
+}
+
+/**
+ * @brief 命令服务访问Chunk的后端，如CSD上的ChunkIoScheduler
+ * 命令服务没有后端时使用上面的模拟硬盘
+ */
+class ChunkCmdBackend {
+public:
+    /**
+     * @brief IO完成回调
+     * @param rc RC_SUCCESS | RC_FAILD | RC_OBJ_NOT_FOUND
+     */
+    typedef void (*done_fn_t)(void* arg, int rc);
+
+    virtual ~ChunkCmdBackend() {}
+
+    /**
+     * @brief 异步读写，返回RC_SUCCESS时完成后回调，否则不回调
+     * @param client_id 发起IO的客户端，0表示未知
+     */
+    virtual int read(chk_id_t chk_id, uint64_t off, uint32_t len, void* buff, uint64_t client_id, done_fn_t cb, void* arg) = 0;
+
+    virtual int write(chk_id_t chk_id, uint64_t off, uint32_t len, void* buff, uint64_t client_id, done_fn_t cb, void* arg) = 0;
+
+    virtual int write_zeros(chk_id_t chk_id, uint64_t off, uint32_t len, uint64_t client_id, done_fn_t cb, void* arg) = 0;
+
+    /**
+     * @brief 区间是否未分配（读到的必然是0），是则读不需要访问硬盘和传输数据
+     */
+    virtual bool is_zero(chk_id_t chk_id, uint64_t off, uint32_t len) = 0;
+}; // class ChunkCmdBackend
+
+inline void chunk_io_done(RdmaWorkRequest* req, int rc){
+    req->io_rc = rc;
+    io_cb_func(req);
+}
+
+inline void chunk_io_done(TcpWorkRequest* req, int rc){
+    req->io_rc = rc;
+    tcp_io_cb_func(req);
+}
+
+template<typename Req>
+inline void chunk_io_done_fn(void* arg, int rc){
+    chunk_io_done((Req *)arg, rc);
+}
+
+template<typename Req>
+inline void chunk_io_ok(Req* req){
+    chunk_io_done(req, RC_SUCCESS);
+}
+
+/**
+ * @name: chunk_io_rw
+ * @describtions:  经后端读写chunk，没有后端时使用模拟硬盘。
+ *                 完成后以EXEC_DONE状态执行req->run()，结果在req->io_rc
+ */
+template<typename Req>
+inline void chunk_io_rw(ChunkCmdBackend* backend, chk_id_t chunk_id, uint64_t offset, uint32_t len, void* buff, bool rw, uint64_t client_id, Req* req){
+    if(!backend){
+        chunk_io_rw_mem(chunk_id, offset, len, (uint64_t)buff, rw, chunk_io_ok<Req>, req);
+        return;
+    }
+    int r = rw ? backend->write(chunk_id, offset, len, buff, client_id, chunk_io_done_fn<Req>, req)
+                : backend->read(chunk_id, offset, len, buff, client_id, chunk_io_done_fn<Req>, req);
+    if(r != RC_SUCCESS){
+        chunk_io_done(req, r);
+    }
+}
+
+/**
+ * @name: chunk_io_zero
+ * @describtions:  经后端清零，没有后端时模拟
+ */
+template<typename Req>
+inline void chunk_io_zero(ChunkCmdBackend* backend, chk_id_t chunk_id, uint64_t offset, uint32_t len, uint64_t client_id, Req* req){
+    if(!backend){
+        chunk_io_zero_mem(chunk_id, offset, len, chunk_io_ok<Req>, req);
+        return;
+    }
+    int r = backend->write_zeros(chunk_id, offset, len, client_id, chunk_io_done_fn<Req>, req);
+    if(r != RC_SUCCESS){
+        chunk_io_done(req, r);
+    }
+}
+
+/**
+ * @name: chunk_io_is_zero
+ * @describtions:  区间是否未分配。模拟硬盘没有分配信息，总是返回false
+ */
+inline bool chunk_io_is_zero(ChunkCmdBackend* backend, chk_id_t chunk_id, uint64_t offset, uint32_t len){
+    return backend && backend->is_zero(chunk_id, offset, len);
+}
+
+
 class ReadCmdService final : public CmdService {
 public:
     inline int call(RdmaWorkRequest *req) override{
         msg::Connection* conn = req->conn;
         msg::RdmaConnection* rdma_conn = msg::RdmaStack::rdma_conn_cast(conn);
         if(req->status == RdmaWorkRequest::Status::RECV_DONE){                 //**创建rdma内存，并从底层chunkstore异步读取数据到指定的rdma buffer**//      
-            ChunkReadCmd* cmd_chunk_read = new ChunkReadCmd((cmd_t *)req->command);
-            cmd_ma_t& ma = ((cmd_chk_io_rd_t *)cmd_chunk_read->get_content())->ma;    
-            auto allocator = msg::Stack::get_rdma_stack()->get_rdma_allocator();
-            
-            msg::ib::RdmaBuffer* lbuf = allocator->alloc(cmd_chunk_read->get_ma_len()); //获取一片本地的内存，用于存放数据
-            lbuf->data_len = cmd_chunk_read->get_ma_len();
-            req->data_buf_ = lbuf;
-            //read，将数据读到lbuf，io_cb_func的回调在这里实际上是在disk->lbuf后执行req->run()，只是此时req->status = EXEC_DONE
-            chunk_io_rw_mem(cmd_chunk_read->get_chk_id(),cmd_chunk_read->get_off(), cmd_chunk_read->get_ma_len(), (uint64_t)lbuf->buffer(), 0, io_cb_func, req); 
+            ChunkReadCmd cmd_chunk_read((cmd_t *)req->command);
+            if(chunk_io_is_zero(backend_, cmd_chunk_read.get_chk_id(), cmd_chunk_read.get_off(), cmd_chunk_read.get_ma_len())){
+                //**未分配的区间：不读盘、不分配缓冲、不做RDMA WRITE，直接回复带ZERO标志的响应
+                cmd_t cmd = *(cmd_t *)req->command;
+                ChunkReadCmd read_cmd(&cmd);
+                ChunkReadRes res((cmd_res_t *)req->command, read_cmd, 0);
+                res.set_zero();
+                req->sge_[0].addr = req->buf_->addr();
+                req->sge_[0].length = 64;
+                req->sge_[0].lkey = req->buf_->lkey();
+                req->send_wr_.opcode = IBV_WR_SEND;
+                req->send_wr_.num_sge = 1;
+                req->send_wr_.sg_list = req->sge_;
+                rdma_conn->post_send_batched(req);
+                return 0;
+            }
+            //**不超过4KB时使用slab中的数据缓冲，更大的IO从请求池借出缓冲
+            msg::ib::RdmaBuffer* lbuf = req->get_io_buf__(cmd_chunk_read.get_ma_len());
+            if(!lbuf){
+                req->send_error__(RC_INTERNAL_ERROR);
+                return 0;
+            }
+            //read，将数据读到lbuf，完成回调在disk->lbuf后执行req->run()，只是此时req->status = EXEC_DONE
+            chunk_io_rw(backend_, cmd_chunk_read.get_chk_id(),cmd_chunk_read.get_off(), cmd_chunk_read.get_ma_len(), lbuf->buffer(), 0, cmd_chunk_read.get_client_id(), req); 
 
         }else if(req->status == RdmaWorkRequest::Status::EXEC_DONE){           //** 进行RDMA WRITE(server write到client相当于读)**//
-            ChunkReadCmd* cmd_chunk_read = new ChunkReadCmd((cmd_t *)req->command);
-            cmd_ma_t& ma = ((cmd_chk_io_rd_t *)cmd_chunk_read->get_content())->ma; 
-            if(cmd_chunk_read->get_ma_len() > 4096){   //**利用WRITE
+            if(req->io_rc != RC_SUCCESS){
+                req->send_error__(req->io_rc);
+                return 0;
+            }
+            ChunkReadCmd cmd_chunk_read((cmd_t *)req->command);
+            cmd_ma_t& ma = ((cmd_chk_io_rd_t *)cmd_chunk_read.get_content())->ma; 
+            if(cmd_chunk_read.get_ma_len() > 4096){   //**利用WRITE
                 req->sge_[0].addr = req->data_buf_->addr();
-                req->sge_[0].length = req->data_buf_->size();
+                req->sge_[0].length = cmd_chunk_read.get_ma_len();
                 req->sge_[0].lkey = req->data_buf_->lkey();
                 ibv_send_wr &swr = req->send_wr_;
                 memset(&swr, 0, sizeof(swr));
@@ -90,20 +225,20 @@ public:
                 swr.sg_list = req->sge_;
                 swr.next = nullptr;
 
-                rdma_conn->post_send(req);
+                rdma_conn->post_send_batched(req);
             }else{                                      //**inline数据直接连带response send过去
                 cmd_rc_t rc = 0;
                 cmd_t cmd = *(cmd_t *)req->command;
-                ChunkReadCmd* read_cmd = new ChunkReadCmd(&cmd); 
+                ChunkReadCmd read_cmd(&cmd);
                 cmd_res_t* cmd_res = (cmd_res_t *)req->command;
-                ChunkReadRes* res = new ChunkReadRes(cmd_res, *read_cmd, rc, (void *)req->data_buf_->buffer(), cmd_chunk_read->get_ma_len()); 
+                ChunkReadRes res(cmd_res, read_cmd, rc, (void *)req->data_buf_->buffer(), cmd_chunk_read.get_ma_len());
                 
                 req->sge_[0].addr = req->buf_->addr();
                 req->sge_[0].length = 64;
                 req->sge_[0].lkey = req->buf_->lkey();
 
                 req->sge_[1].addr = req->data_buf_->addr();
-                req->sge_[1].length = cmd_chunk_read->get_ma_len();
+                req->sge_[1].length = cmd_chunk_read.get_ma_len();
                 req->sge_[1].lkey = req->data_buf_->lkey();
 
                 ibv_send_wr &swr = req->send_wr_;
@@ -115,23 +250,23 @@ public:
                 swr.sg_list = req->sge_;
                 swr.next = nullptr;
 
-                rdma_conn->post_send(req);
+                rdma_conn->post_send_batched(req);
             }
             
 
         }else if(req->status == RdmaWorkRequest::Status::WRITE_DONE){       
             cmd_rc_t rc = 0;
             cmd_t cmd = *(cmd_t *)req->command;
-            ChunkReadCmd* read_cmd = new ChunkReadCmd(&cmd); 
+            ChunkReadCmd read_cmd(&cmd);
             cmd_res_t* cmd_res = (cmd_res_t *)req->command;
-            ChunkReadRes* res = new ChunkReadRes(cmd_res, *read_cmd, rc); 
+            ChunkReadRes res(cmd_res, read_cmd, rc);
             req->sge_[0].addr = req->buf_->addr();
             req->sge_[0].length = 64;
             req->sge_[0].lkey = req->buf_->lkey();
             req->send_wr_.opcode = IBV_WR_SEND;
             req->send_wr_.num_sge = 1;
             req->send_wr_.sg_list = req->sge_;
-            rdma_conn->post_send(req);
+            rdma_conn->post_send_batched(req);
         }else{                              
             return 0;
         }
@@ -139,9 +274,40 @@ public:
 
     }
 
-    ReadCmdService():CmdService(){}
+    /**
+     * @brief TCP传输：读到自有缓冲后，数据随响应一起发送
+     */
+    inline int call(TcpWorkRequest *req) override{
+        if(req->status == TcpWorkRequest::Status::RECV_DONE){
+            ChunkReadCmd cmd_chunk_read((cmd_t *)req->command);
+            if(chunk_io_is_zero(backend_, cmd_chunk_read.get_chk_id(), cmd_chunk_read.get_off(), cmd_chunk_read.get_ma_len())){
+                cmd_t cmd = *(cmd_t *)req->command;
+                ChunkReadCmd read_cmd(&cmd);
+                ChunkReadRes res((cmd_res_t *)req->command, read_cmd, 0);
+                res.set_zero();
+                req->send_response(false);
+                return 0;
+            }
+            char* lbuf = req->alloc_data(cmd_chunk_read.get_ma_len());
+            chunk_io_rw(backend_, cmd_chunk_read.get_chk_id(), cmd_chunk_read.get_off(), cmd_chunk_read.get_ma_len(), lbuf, 0, cmd_chunk_read.get_client_id(), req);
+        }else if(req->status == TcpWorkRequest::Status::EXEC_DONE){
+            if(req->io_rc != RC_SUCCESS){
+                return req->send_error(req->io_rc);
+            }
+            cmd_t cmd = *(cmd_t *)req->command;
+            ChunkReadCmd read_cmd(&cmd);
+            ChunkReadRes res((cmd_res_t *)req->command, read_cmd, 0, req->data, req->data_len);
+            req->send_response(true);
+        }
+        return 0;
+    }
+
+    explicit ReadCmdService(ChunkCmdBackend* backend = nullptr) : CmdService(), backend_(backend) {}
     
     virtual ~ReadCmdService() {}
+
+private:
+    ChunkCmdBackend* backend_;
 }; // class ReadCmdService
 
 
@@ -151,22 +317,22 @@ public:
         msg::Connection* conn = req->conn;
         msg::RdmaConnection* rdma_conn = msg::RdmaStack::rdma_conn_cast(conn);
         if(req->status == RdmaWorkRequest::Status::RECV_DONE){                 //**创建rdma内存，并从底层chunkstore异步读取数据到指定的rdma buffer**//      
-            ChunkWriteCmd* cmd_chunk_write = new ChunkWriteCmd((cmd_t *)req->command);
-            if(cmd_chunk_write->get_inline_data_len() > 0){ //**inline的Write
-                //write，将数据写到disk，io_cb_func的回调在这里实际上是在disk->lbuf后执行req->run()，只是此时req->status = EXEC_DONE
-                chunk_io_rw_mem(cmd_chunk_write->get_chk_id(),cmd_chunk_write->get_off(), cmd_chunk_write->get_ma_len(), (uint64_t)req->data_buf_->buffer(),\
-                                                                     1, io_cb_func, req); 
+            ChunkWriteCmd cmd_chunk_write((cmd_t *)req->command);
+            if(cmd_chunk_write.get_inline_data_len() > 0){ //**inline的Write
+                //write，将数据写到disk，完成回调在lbuf->disk后执行req->run()，只是此时req->status = EXEC_DONE
+                chunk_io_rw(backend_, cmd_chunk_write.get_chk_id(),cmd_chunk_write.get_off(), cmd_chunk_write.get_ma_len(), req->data_buf_->buffer(),\
+                                                                     1, cmd_chunk_write.get_client_id(), req); 
+                return 0;
+            }
+            cmd_ma_t& ma = ((cmd_chk_io_rd_t *)cmd_chunk_write.get_content())->ma;    
+            msg::ib::RdmaBuffer* lbuf = req->get_io_buf__(cmd_chunk_write.get_ma_len());
+            if(!lbuf){
+                req->send_error__(RC_INTERNAL_ERROR);
                 return 0;
             }
-            cmd_ma_t& ma = ((cmd_chk_io_rd_t *)cmd_chunk_write->get_content())->ma;    
-            auto allocator = msg::Stack::get_rdma_stack()->get_rdma_allocator();
-            
-            msg::ib::RdmaBuffer* lbuf = allocator->alloc(cmd_chunk_write->get_ma_len()); //获取一片本地的内存，用于存放数据
-            lbuf->data_len = cmd_chunk_write->get_ma_len();
-            req->data_buf_ = lbuf;
 
             req->sge_[0].addr = req->data_buf_->addr();
-            req->sge_[0].length = req->data_buf_->size();
+            req->sge_[0].length = cmd_chunk_write.get_ma_len();
             req->sge_[0].lkey = req->data_buf_->lkey();
             ibv_send_wr &swr = req->send_wr_;
             memset(&swr, 0, sizeof(swr));
@@ -179,27 +345,27 @@ public:
             swr.sg_list = req->sge_;
             swr.next = nullptr;
 
-            rdma_conn->post_send(req);
+            rdma_conn->post_send_batched(req);
 
         }else if(req->status == RdmaWorkRequest::Status::READ_DONE){           //** 进行RDMA WRITE(server write到client相当于读)**//
-            ChunkWriteCmd* cmd_chunk_write = new ChunkWriteCmd((cmd_t *)req->command);
-            //write，将数据写到disk，io_cb_func的回调在这里实际上是在disk->lbuf后执行req->run()，只是此时req->status = EXEC_DONE
-            chunk_io_rw_mem(cmd_chunk_write->get_chk_id(),cmd_chunk_write->get_off(), cmd_chunk_write->get_ma_len(), (uint64_t)req->data_buf_->buffer(),\
-                                                                     1, io_cb_func, req); 
+            ChunkWriteCmd cmd_chunk_write((cmd_t *)req->command);
+            //write，将数据写到disk，完成回调在lbuf->disk后执行req->run()，只是此时req->status = EXEC_DONE
+            chunk_io_rw(backend_, cmd_chunk_write.get_chk_id(),cmd_chunk_write.get_off(), cmd_chunk_write.get_ma_len(), req->data_buf_->buffer(),\
+                                                                     1, cmd_chunk_write.get_client_id(), req); 
 
         }else if(req->status == RdmaWorkRequest::Status::EXEC_DONE){      
-            cmd_rc_t rc = 0;
+            cmd_rc_t rc = req->io_rc;
             cmd_t cmd = *(cmd_t *)req->command;
-            ChunkWriteCmd* write_cmd = new ChunkWriteCmd(&cmd); 
+            ChunkWriteCmd write_cmd(&cmd);
             cmd_res_t* cmd_res = (cmd_res_t *)req->command;
-            CommonRes* res = new CommonRes(cmd_res, *write_cmd, rc); 
+            CommonRes res(cmd_res, write_cmd, rc);
             req->sge_[0].addr = req->buf_->addr();
             req->sge_[0].length = 64;
             req->sge_[0].lkey = req->buf_->lkey();
             req->send_wr_.opcode = IBV_WR_SEND;
             req->send_wr_.num_sge = 1;
             req->send_wr_.sg_list = req->sge_;
-            rdma_conn->post_send(req);
+            rdma_conn->post_send_batched(req);
         }else{                              
             return 0;
         }
@@ -207,9 +373,31 @@ public:
 
     }
 
-    WriteCmdService() : CmdService(){}
+    /**
+     * @brief TCP传输：写数据总是内联在请求中
+     */
+    inline int call(TcpWorkRequest *req) override{
+        if(req->status == TcpWorkRequest::Status::RECV_DONE){
+            ChunkWriteCmd cmd_chunk_write((cmd_t *)req->command);
+            if(req->data_len < cmd_chunk_write.get_ma_len()){
+                return req->send_error(RC_WRONG_PARAMETER);
+            }
+            chunk_io_rw(backend_, cmd_chunk_write.get_chk_id(), cmd_chunk_write.get_off(), cmd_chunk_write.get_ma_len(), req->data, 1, cmd_chunk_write.get_client_id(), req);
+        }else if(req->status == TcpWorkRequest::Status::EXEC_DONE){
+            cmd_t cmd = *(cmd_t *)req->command;
+            ChunkWriteCmd write_cmd(&cmd);
+            CommonRes res((cmd_res_t *)req->command, write_cmd, req->io_rc);
+            req->send_response(false);
+        }
+        return 0;
+    }
+
+    explicit WriteCmdService(ChunkCmdBackend* backend = nullptr) : CmdService(), backend_(backend) {}
 
     virtual ~WriteCmdService() {}
+
+private:
+    ChunkCmdBackend* backend_;
 }; // class WriteCmdService
 
 
@@ -219,21 +407,61 @@ public:
         return 0;
     }
 
+    inline virtual int call(TcpWorkRequest *req) override{
+        return req->send_error(RC_REFUSED);
+    }
+
     ReadZerosCmdService() : CmdService(){}
 
     virtual ~ReadZerosCmdService() {}
 }; // class ReadZerosCmdService
 
 
+/**
+ * @brief 清零(CMD_CHK_IO_RESET)：请求只带区间，没有数据传输，由ChunkStore打洞或unmap
+ */
 class WriteZerosCmdService final : public CmdService {
 public:
     inline virtual int call(RdmaWorkRequest *req) override{
+        msg::Connection* conn = req->conn;
+        msg::RdmaConnection* rdma_conn = msg::RdmaStack::rdma_conn_cast(conn);
+        if(req->status == RdmaWorkRequest::Status::RECV_DONE){
+            ChunkResetCmd cmd_chunk_reset((cmd_t *)req->command);
+            chunk_io_zero(backend_, cmd_chunk_reset.get_chk_id(), cmd_chunk_reset.get_off(), cmd_chunk_reset.get_reset_len(), cmd_chunk_reset.get_client_id(), req);
+        }else if(req->status == RdmaWorkRequest::Status::EXEC_DONE){
+            cmd_t cmd = *(cmd_t *)req->command;
+            ChunkResetCmd reset_cmd(&cmd);
+            CommonRes res((cmd_res_t *)req->command, reset_cmd, req->io_rc);
+            req->sge_[0].addr = req->buf_->addr();
+            req->sge_[0].length = 64;
+            req->sge_[0].lkey = req->buf_->lkey();
+            req->send_wr_.opcode = IBV_WR_SEND;
+            req->send_wr_.num_sge = 1;
+            req->send_wr_.sg_list = req->sge_;
+            rdma_conn->post_send_batched(req);
+        }
         return 0;
     }
 
-    WriteZerosCmdService() : CmdService(){}
+    inline virtual int call(TcpWorkRequest *req) override{
+        if(req->status == TcpWorkRequest::Status::RECV_DONE){
+            ChunkResetCmd cmd_chunk_reset((cmd_t *)req->command);
+            chunk_io_zero(backend_, cmd_chunk_reset.get_chk_id(), cmd_chunk_reset.get_off(), cmd_chunk_reset.get_reset_len(), cmd_chunk_reset.get_client_id(), req);
+        }else if(req->status == TcpWorkRequest::Status::EXEC_DONE){
+            cmd_t cmd = *(cmd_t *)req->command;
+            ChunkResetCmd reset_cmd(&cmd);
+            CommonRes res((cmd_res_t *)req->command, reset_cmd, req->io_rc);
+            req->send_response(false);
+        }
+        return 0;
+    }
+
+    explicit WriteZerosCmdService(ChunkCmdBackend* backend = nullptr) : CmdService(), backend_(backend) {}
 
     virtual ~WriteZerosCmdService() {}
+
+private:
+    ChunkCmdBackend* backend_;
 }; // class WriteZerosCmdService
 
 } // namespace flame
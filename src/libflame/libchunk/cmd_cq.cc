@@ -0,0 +1,217 @@
+#include "libflame/libchunk/cmd_cq.h"
+
+#include "include/csdc.h"
+#include "include/retcode.h"
+#include "util/utime.h"
+
+#include <cstring>
+
+namespace flame {
+
+//-------------------------------------CmdCompletionQueue-------------------------------------------------------------//
+CmdCompletionQueue::CmdCompletionQueue(uint32_t depth) {
+    if (depth > CMD_CQ_DEPTH_MAX)
+        depth = CMD_CQ_DEPTH_MAX;
+    depth_ = 1;
+    shift_ = 0;
+    while (depth_ < depth) {
+        depth_ <<= 1;
+        shift_++;
+    }
+    slots_.reset(new slot_t[depth_]);
+}
+
+int CmdCompletionQueue::alloc(uint16_t& cqn, const cmd_cq_entry_t& e) {
+    // 先占用名额，保证下面的扫描一定能找到空闲槽
+    if (inflight_.fetch_add(1, std::memory_order_relaxed) >= depth_) {
+        inflight_.fetch_sub(1, std::memory_order_relaxed);
+        return RC_REFUSED;
+    }
+
+    uint32_t mask = depth_ - 1;
+    uint32_t idx = cursor_.fetch_add(1, std::memory_order_relaxed);
+    for (;; idx++) {
+        slot_t& slot = slots_[idx & mask];
+        uint32_t s = slot.state.load(std::memory_order_relaxed);
+        if ((s & 3) != SLOT_FREE)
+            continue;
+        if (!slot.state.compare_exchange_weak(s, s | SLOT_FILLING, std::memory_order_acquire))
+            continue;
+        slot.entry = e;
+        slot.state.store((s & ~3U) | SLOT_BUSY, std::memory_order_release);
+        cqn = (uint16_t)(((s >> 2) << shift_) | (idx & mask));
+        return RC_SUCCESS;
+    }
+}
+
+bool CmdCompletionQueue::take_slot__(slot_t& slot, uint32_t s, cmd_cq_entry_t& e) {
+    if (!slot.state.compare_exchange_strong(s, (s & ~3U) | SLOT_COMPLETING, std::memory_order_acquire))
+        return false;
+    e = slot.entry;
+    // 代数加1后释放，之前发出的同一cqn的响应将不再匹配
+    slot.state.store(((s >> 2) + 1) << 2 | SLOT_FREE, std::memory_order_release);
+    inflight_.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+}
+
+bool CmdCompletionQueue::take(uint16_t cqn, cmd_cq_entry_t& e) {
+    slot_t& slot = slots_[cqn & (depth_ - 1)];
+    uint32_t s = slot.state.load(std::memory_order_acquire);
+    uint32_t gen_mask = (1U << (16 - shift_)) - 1;
+    if ((s & 3) != SLOT_BUSY || ((s >> 2) & gen_mask) != (uint32_t)(cqn >> shift_))
+        return false;
+    return take_slot__(slot, s, e);
+}
+
+void CmdCompletionQueue::expire(uint64_t now, std::vector<cmd_cq_entry_t>& out) {
+    for (uint32_t i = 0; i < depth_; i++) {
+        slot_t& slot = slots_[i];
+        uint32_t s = slot.state.load(std::memory_order_acquire);
+        if ((s & 3) != SLOT_BUSY)
+            continue;
+        uint64_t deadline = slot.entry.deadline;
+        if (deadline == 0 || deadline > now)
+            continue;
+        cmd_cq_entry_t e;
+        if (take_slot__(slot, s, e))
+            out.push_back(e);
+    }
+}
+
+//-------------------------------------CmdCompletionTable-------------------------------------------------------------//
+CmdCompletionTable::CmdCompletionTable(uint32_t queue_num, uint32_t depth, uint64_t timeout)
+: timeout_(timeout) {
+    if (queue_num == 0)
+        queue_num = 1;
+    if (queue_num > CMD_CQ_QUEUE_MAX)
+        queue_num = CMD_CQ_QUEUE_MAX;
+    for (uint32_t i = 0; i < queue_num; i++)
+        queues_.emplace_back(new CmdCompletionQueue(depth));
+    for (int i = 0; i < CMD_CQ_BATCH_HIST_BUCKETS; i++)
+        batch_hist_[i] = 0;
+}
+
+CmdCompletionQueue* CmdCompletionTable::local_queue__(uint8_t& cqg) {
+    static std::atomic<uint32_t> thread_seq {0};
+    static thread_local uint32_t thread_idx = thread_seq.fetch_add(1, std::memory_order_relaxed);
+    cqg = (uint8_t)(thread_idx % queues_.size());
+    return queues_[cqg].get();
+}
+
+int CmdCompletionTable::prepare(cmd_t* cmd, cmd_cb_fn_t cb_fn, void* cb_arg) {
+    uint64_t now = utime_t::now().to_usec();
+    expire_lazy(now);
+
+    cmd_cq_entry_t e;
+    e.cb_fn = cb_fn;
+    e.cb_arg = cb_arg;
+    e.rd_addr = 0;
+    e.rd_len = 0;
+    e.cn = cmd->hdr.cn;
+    e.deadline = timeout_ ? now + timeout_ : 0;
+    if (cmd->hdr.cn.cls == CMD_CLS_IO_CHK && cmd->hdr.cn.seq == CMD_CHK_IO_READ) {
+        ChunkReadCmd read_cmd(cmd);
+        e.rd_addr = read_cmd.get_ma_addr();
+        e.rd_len = read_cmd.get_ma_len();
+    }
+
+    uint8_t cqg;
+    uint16_t cqn;
+    CmdCompletionQueue* q = local_queue__(cqg);
+    int r = q->alloc(cqn, e);
+    if (r != RC_SUCCESS)
+        return r;
+    cmd->hdr.cqg = cqg;
+    cmd->hdr.cqn = cqn;
+    return RC_SUCCESS;
+}
+
+void CmdCompletionTable::cancel(const cmd_t* cmd) {
+    if (cmd->hdr.cqg >= queues_.size())
+        return;
+    cmd_cq_entry_t e;
+    queues_[cmd->hdr.cqg]->take(cmd->hdr.cqn, e);
+}
+
+static void cmd_cq_callback(const cmd_cq_entry_t& e, cmd_res_t* res, void* data, uint32_t len) {
+    if (!e.cb_fn)
+        return;
+    if (res->hdr.cn.cls == CMD_CLS_IO_CHK && res->hdr.cn.seq == CMD_CHK_IO_READ) {
+        ChunkReadRes read_res(res);
+        void* arg = e.cb_arg;
+        if (read_res.is_zero() && e.rd_addr) {
+            // 服务端没有传输数据
+            memset((void*)e.rd_addr, 0, e.rd_len);
+        } else if (len > 0 && e.rd_addr) {
+            memcpy((void*)e.rd_addr, data, len < e.rd_len ? len : e.rd_len);
+        } else if (len > 0 && arg == nullptr) {
+            // 未指定内存的读，回调参数为内联数据
+            arg = data;
+        }
+        e.cb_fn(*(Response*)&read_res, arg);
+    } else {
+        CommonRes common_res(res);
+        e.cb_fn(*(Response*)&common_res, e.cb_arg);
+    }
+}
+
+int CmdCompletionTable::complete(const cmd_res_t& res, void* data, uint32_t len) {
+    cmd_cq_entry_t e;
+    if (res.hdr.cqg >= queues_.size() || !queues_[res.hdr.cqg]->take(res.hdr.cqn, e)) {
+        stale_.fetch_add(1, std::memory_order_relaxed);
+        return RC_OBJ_NOT_FOUND;
+    }
+    cmd_res_t r = res;
+    cmd_cq_callback(e, &r, data, len);
+    return RC_SUCCESS;
+}
+
+int CmdCompletionTable::expire(uint64_t now) {
+    std::vector<cmd_cq_entry_t> expired;
+    for (auto it = queues_.begin(); it != queues_.end(); it++)
+        (*it)->expire(now, expired);
+
+    for (auto it = expired.begin(); it != expired.end(); it++) {
+        cmd_res_t r;
+        memset(&r, 0, sizeof(r));
+        r.hdr.cn = it->cn;
+        r.rc = RC_TIMEOUT;
+        cmd_cq_callback(*it, &r, nullptr, 0);
+    }
+    return expired.size();
+}
+
+void CmdCompletionTable::expire_lazy(uint64_t now) {
+    if (!timeout_)
+        return;
+    uint64_t next = next_check_.load(std::memory_order_relaxed);
+    if (now < next)
+        return;
+    // 检查周期为超时时间的1/4，只有一个线程执行检查
+    if (next_check_.compare_exchange_strong(next, now + check_cycle__(), std::memory_order_relaxed))
+        expire(now);
+}
+
+void CmdCompletionTable::start_expire_timer(msg::MsgWorker* worker) {
+    if (!timeout_ || !worker || timer_running_.exchange(true))
+        return;
+    schedule_expire__(worker);
+}
+
+void CmdCompletionTable::schedule_expire__(msg::MsgWorker* worker) {
+    worker->post_time_work(check_cycle__(), [this, worker]() {
+        if (!timer_running_.load(std::memory_order_acquire))
+            return;
+        expire_lazy(utime_t::now().to_usec());
+        schedule_expire__(worker);
+    });
+}
+
+uint32_t CmdCompletionTable::inflight() const {
+    uint32_t n = 0;
+    for (auto it = queues_.begin(); it != queues_.end(); it++)
+        n += (*it)->inflight();
+    return n;
+}
+
+} // namespace flame
@@ -0,0 +1,201 @@
+/**
+ * @file cmd_cq.h
+ * @brief 客户端未完成命令的完成表
+ * 每个命令队列组(cqg)一个定长槽数组，以cqn直接索引：
+ * cqn = 代数(高位) | 槽号(低位)。槽每被复用一次代数加1，
+ * 因此超时后才到达的响应会因代数不符被识别并丢弃。
+ * 槽的分配与完成都只对槽状态做CAS，多个提交线程之间没有全局锁。
+ */
+#ifndef FLAME_LIBFLAME_LIBCHUNK_CMD_CQ_H
+#define FLAME_LIBFLAME_LIBCHUNK_CMD_CQ_H
+
+#include "include/cmd.h"
+#include "msg/MsgWorker.h"
+
+#include <cstdint>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+// 每个队列的最大深度，cqn中至少保留4位代数
+#define CMD_CQ_DEPTH_MAX    (1U << 12)
+#define CMD_CQ_QUEUE_MAX    256
+
+// 默认的命令超时时间 (us)
+#define CMD_CQ_DEFAULT_TIMEOUT  (10ULL * 1000 * 1000)
+
+// 批量提交的命令数直方图，第i个桶: [2^i, 2^(i+1))
+#define CMD_CQ_BATCH_HIST_BUCKETS   8
+
+namespace flame {
+
+struct cmd_cq_entry_t {
+    cmd_cb_fn_t cb_fn;
+    void*       cb_arg;
+    uint64_t    rd_addr;    // 读命令的本地内存，响应中的内联数据拷贝到此处
+    uint32_t    rd_len;
+    cmd_num_t   cn;
+    uint64_t    deadline;   // (us)，0表示不超时
+};
+
+class CmdCompletionQueue {
+public:
+    /**
+     * @param depth 向上取整为2的幂，不超过CMD_CQ_DEPTH_MAX
+     */
+    explicit CmdCompletionQueue(uint32_t depth);
+
+    ~CmdCompletionQueue() {}
+
+    /**
+     * @brief 分配一个槽
+     *
+     * @param cqn 分配到的cqn
+     * @param e
+     * @return int RC_SUCCESS | RC_REFUSED(队列已满)
+     */
+    int alloc(uint16_t& cqn, const cmd_cq_entry_t& e);
+
+    /**
+     * @brief 取出cqn对应的命令并释放槽
+     *
+     * @param cqn
+     * @param e
+     * @return true
+     * @return false 槽已被释放或已被复用（过期的响应）
+     */
+    bool take(uint16_t cqn, cmd_cq_entry_t& e);
+
+    /**
+     * @brief 取出所有超过期限的命令
+     *
+     * @param now (us)
+     * @param out
+     */
+    void expire(uint64_t now, std::vector<cmd_cq_entry_t>& out);
+
+    uint32_t depth() const { return depth_; }
+
+    uint32_t inflight() const { return inflight_.load(std::memory_order_relaxed); }
+
+private:
+    enum SlotState {
+        SLOT_FREE = 0,
+        SLOT_FILLING,
+        SLOT_BUSY,
+        SLOT_COMPLETING
+    };
+
+    struct slot_t {
+        std::atomic<uint32_t>   state {0};  // gen << 2 | SlotState
+        cmd_cq_entry_t          entry;
+    };
+
+    bool take_slot__(slot_t& slot, uint32_t s, cmd_cq_entry_t& e);
+
+    uint32_t depth_;
+    uint32_t shift_;
+    std::unique_ptr<slot_t[]> slots_;
+    std::atomic<uint32_t> cursor_ {0};
+    std::atomic<uint32_t> inflight_ {0};
+}; // class CmdCompletionQueue
+
+/**
+ * @brief 一个客户端句柄的完成表，每个提交线程固定使用其中一个队列
+ */
+class CmdCompletionTable {
+public:
+    /**
+     * @param queue_num 队列数量，不超过CMD_CQ_QUEUE_MAX
+     * @param depth 每个队列的深度
+     * @param timeout 命令超时时间 (us)，0表示不超时
+     */
+    CmdCompletionTable(uint32_t queue_num, uint32_t depth, uint64_t timeout = CMD_CQ_DEFAULT_TIMEOUT);
+
+    ~CmdCompletionTable() {}
+
+    /**
+     * @brief 为命令分配槽，并将cqg/cqn写入命令
+     *
+     * @param cmd
+     * @param cb_fn
+     * @param cb_arg
+     * @return int RC_SUCCESS | RC_REFUSED(队列已满)
+     */
+    int prepare(cmd_t* cmd, cmd_cb_fn_t cb_fn, void* cb_arg);
+
+    /**
+     * @brief 命令未能发出，释放其槽（不回调）
+     */
+    void cancel(const cmd_t* cmd);
+
+    /**
+     * @brief 收到响应：读的内联数据拷贝到命令指定的内存，然后回调
+     *
+     * @param res
+     * @param data 内联数据
+     * @param len 内联数据长度
+     * @return int RC_SUCCESS | RC_OBJ_NOT_FOUND(过期或未知的响应)
+     */
+    int complete(const cmd_res_t& res, void* data, uint32_t len);
+
+    /**
+     * @brief 以RC_TIMEOUT完成所有超过期限的命令
+     *
+     * @param now (us)
+     * @return int 超时的命令数
+     */
+    int expire(uint64_t now);
+
+    /**
+     * @brief 距上次检查超过检查周期时才执行expire，供提交路径调用
+     */
+    void expire_lazy(uint64_t now);
+
+    /**
+     * @brief 在worker上每个检查周期执行一次expire_lazy，
+     * 响应丢失且没有新的提交时，命令也能以RC_TIMEOUT完成
+     * 完成表析构前须调用stop_expire_timer()并停止worker
+     */
+    void start_expire_timer(msg::MsgWorker* worker);
+
+    void stop_expire_timer() { timer_running_.store(false, std::memory_order_release); }
+
+    uint32_t inflight() const;
+
+    uint64_t stale() const { return stale_.load(std::memory_order_relaxed); }
+
+    uint64_t timeout() const { return timeout_; }
+
+    /**
+     * @brief 记录一次批量提交的命令数
+     */
+    void record_batch(uint32_t n) {
+        if (n == 0)
+            return;
+        int i = 0;
+        while (n >>= 1)
+            i++;
+        if (i >= CMD_CQ_BATCH_HIST_BUCKETS)
+            i = CMD_CQ_BATCH_HIST_BUCKETS - 1;
+        batch_hist_[i].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    uint64_t get_batch_hist(int i) const { return batch_hist_[i].load(std::memory_order_relaxed); }
+
+private:
+    CmdCompletionQueue* local_queue__(uint8_t& cqg);
+    uint64_t check_cycle__() const { return timeout_ / 4 ? timeout_ / 4 : 1; }
+    void schedule_expire__(msg::MsgWorker* worker);
+
+    std::vector<std::unique_ptr<CmdCompletionQueue>> queues_;
+    uint64_t timeout_;
+    std::atomic<uint64_t> next_check_ {0};
+    std::atomic<bool> timer_running_ {false};
+    std::atomic<uint64_t> stale_ {0};     // 被丢弃的过期响应
+    std::atomic<uint64_t> batch_hist_[CMD_CQ_BATCH_HIST_BUCKETS];
+}; // class CmdCompletionTable
+
+} // namespace flame
+
+#endif // FLAME_LIBFLAME_LIBCHUNK_CMD_CQ_H
@@ -1,19 +1,43 @@
 #include "libflame/libchunk/libchunk.h"
 
+#include "include/csdc.h"
+#include "include/retcode.h"
+
 
 namespace flame {
 
-CmdServiceMapper* CmdServiceMapper::g_cmd_service_mapper = nullptr;
+CmdServiceMapper::~CmdServiceMapper(){
+    for(uint32_t i = 0; i < CMD_SERVICE_TABLE_SIZE; i++){
+        delete stats_[i];
+    }
+}
 
-void CmdServiceMapper::register_service(uint8_t cmd_cls, uint8_t cmd_num, CmdService* svi){
+int CmdServiceMapper::register_service(uint8_t cmd_cls, uint8_t cmd_num, CmdService* svi){
+    if(is_frozen()){
+        return RC_REFUSED;
+    }
     uint16_t cn = ( cmd_cls << 8 ) | cmd_num;
-    service_mapper_[cn] = svi;
-    return ;
+    services_[cn] = svi;
+    if(!stats_[cn]){
+        stats_[cn] = new cmd_stat_t();
+    }
+    return RC_SUCCESS;
 }
 
-CmdService* CmdServiceMapper::get_service(uint8_t cmd_cls, uint8_t cmd_num){
-    uint16_t cn = ( cmd_cls << 8 ) | cmd_num;
-    return service_mapper_[cn];
+uint32_t CmdServiceMapper::get_io_bytes(const cmd_t* cmd){
+    if(cmd->hdr.cn.cls != CMD_CLS_IO_CHK){
+        return 0;
+    }
+    switch(cmd->hdr.cn.seq){
+    case CMD_CHK_IO_READ:
+        return ((const cmd_chk_io_rd_t *)cmd->cont)->ma.len;
+    case CMD_CHK_IO_WRITE:
+        return ((const cmd_chk_io_wr_t *)cmd->cont)->ma.len;
+    case CMD_CHK_IO_SET:
+    case CMD_CHK_IO_RESET:
+        return ((const cmd_chk_io_set_t *)cmd->cont)->len;
+    }
+    return 0;
 }
 
 } //namespace flame
@@ -0,0 +1,182 @@
+#include "libflame/libchunk/cmd_trace.h"
+
+#include "include/csdc.h"
+#include "common/context.h"
+#include "util/utime.h"
+
+#include "libflame/libchunk/log_libchunk.h"
+
+namespace flame {
+
+static const char* cmd_trace_stage_names[CMD_TS_NUM + 1] = {
+    "recv", "dispatch", "xfer", "exec", "send", "total"
+};
+
+const char* cmd_trace_stage_name(int stage) {
+    if (stage < 0 || stage > CMD_TS_NUM)
+        return "unknown";
+    return cmd_trace_stage_names[stage];
+}
+
+//-------------------------------------------CmdLatHist------------------------------------//
+uint64_t CmdLatHist::lower(int idx) {
+    if (idx < (1 << CMD_HIST_SUB_BITS))
+        return idx;
+    int e = (idx >> CMD_HIST_SUB_BITS) + CMD_HIST_SUB_BITS - 1;
+    uint64_t sub = idx & ((1 << CMD_HIST_SUB_BITS) - 1);
+    return ((1ULL << CMD_HIST_SUB_BITS) + sub) << (e - CMD_HIST_SUB_BITS);
+}
+
+uint64_t CmdLatHist::percentile(double p) const {
+    uint64_t total = count();
+    if (total == 0)
+        return 0;
+    uint64_t target = (uint64_t)(p * total);
+    if (target == 0)
+        target = 1;
+    uint64_t acc = 0;
+    for (int i = 0; i < CMD_HIST_BUCKETS; i++) {
+        acc += buckets_[i].load(std::memory_order_relaxed);
+        if (acc >= target) {
+            uint64_t upper = i + 1 < CMD_HIST_BUCKETS ? lower(i + 1) - 1 : UINT64_MAX;
+            // 不超过实际的最大值
+            uint64_t m = max();
+            return upper < m ? upper : m;
+        }
+    }
+    return max();
+}
+
+void CmdLatHist::reset() {
+    for (int i = 0; i < CMD_HIST_BUCKETS; i++)
+        buckets_[i].store(0, std::memory_order_relaxed);
+    count_.store(0, std::memory_order_relaxed);
+    sum_.store(0, std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+}
+
+//-------------------------------------------CmdTracer------------------------------------//
+CmdTracer::CmdTracer()
+: enable_(false), slow_ns_(0), sample_(1), slow_cnt_(0), keep_(CMD_TRACE_SLOW_KEEP) {
+}
+
+void CmdTracer::set_slow(uint64_t slow_ns, uint32_t sample, uint32_t keep) {
+    slow_ns_.store(slow_ns, std::memory_order_relaxed);
+    sample_.store(sample ? sample : 1, std::memory_order_relaxed);
+    MutexLocker locker(mutex_);
+    keep_ = keep;
+    while (slow_.size() > keep_)
+        slow_.pop_back();
+}
+
+void CmdTracer::start__(cmd_trace_t& tr, const cmd_t* cmd) {
+    tr.ts[CMD_TS_RECV] = get_cycles();
+    tr.cls = cmd->hdr.cn.cls;
+    tr.seq = cmd->hdr.cn.seq;
+    tr.bytes = CmdServiceMapper::get_io_bytes(cmd);
+    tr.chk_id = 0;
+    tr.off = 0;
+    if (tr.cls != CMD_CLS_IO_CHK)
+        return;
+    switch (tr.seq) {
+    case CMD_CHK_IO_READ:
+        tr.chk_id = ((const cmd_chk_io_rd_t*)cmd->cont)->chk_id;
+        tr.off = ((const cmd_chk_io_rd_t*)cmd->cont)->off;
+        break;
+    case CMD_CHK_IO_WRITE:
+        tr.chk_id = ((const cmd_chk_io_wr_t*)cmd->cont)->chk_id;
+        tr.off = ((const cmd_chk_io_wr_t*)cmd->cont)->off;
+        break;
+    case CMD_CHK_IO_SET:
+    case CMD_CHK_IO_RESET:
+        tr.chk_id = ((const cmd_chk_io_set_t*)cmd->cont)->chk_id;
+        tr.off = ((const cmd_chk_io_set_t*)cmd->cont)->off;
+        break;
+    }
+}
+
+void CmdTracer::finish(cmd_trace_t& tr) {
+    if (!tr.tracing())
+        return;
+
+    // 打点的顺序因命令而异，每个阶段的起点是时间上的前一个打点
+    uint64_t stage[CMD_TS_NUM] = {0};
+    uint64_t last = tr.ts[CMD_TS_RECV];
+    for (int i = 1; i < CMD_TS_NUM; i++) {
+        if (tr.ts[i] == 0)
+            continue;
+        uint64_t prev = tr.ts[CMD_TS_RECV];
+        for (int j = 1; j < CMD_TS_NUM; j++) {
+            if (j != i && tr.ts[j] && tr.ts[j] <= tr.ts[i] && tr.ts[j] > prev)
+                prev = tr.ts[j];
+        }
+        stage[i] = cycles_to_nsec(tr.ts[i] - prev);
+        hists_[i].record(stage[i]);
+        if (tr.ts[i] > last)
+            last = tr.ts[i];
+    }
+    uint64_t total = cycles_to_nsec(last - tr.ts[CMD_TS_RECV]);
+    hists_[CMD_TS_NUM].record(total);
+    tr.clear();
+
+    uint64_t slow = slow_ns();
+    if (slow == 0 || total < slow)
+        return;
+    if (slow_cnt_.fetch_add(1, std::memory_order_relaxed) % sample_.load(std::memory_order_relaxed) != 0)
+        return;
+
+    cmd_slow_req_t rec;
+    rec.time = utime_t::now().to_usec();
+    rec.cls = tr.cls;
+    rec.seq = tr.seq;
+    rec.chk_id = tr.chk_id;
+    rec.off = tr.off;
+    rec.bytes = tr.bytes;
+    rec.total = total;
+    for (int i = 0; i < CMD_TS_NUM; i++)
+        rec.stage[i] = stage[i];
+
+    FlameContext::get_context()->log()->lwarn("slow cmd %x:%x chk(%llu) off(%llu) len(%u) total(%llu ns) "
+        "dispatch(%llu) xfer(%llu) exec(%llu) send(%llu)",
+        rec.cls, rec.seq, (unsigned long long)rec.chk_id, (unsigned long long)rec.off, rec.bytes,
+        (unsigned long long)total, (unsigned long long)stage[CMD_TS_DISPATCH], (unsigned long long)stage[CMD_TS_XFER],
+        (unsigned long long)stage[CMD_TS_EXEC], (unsigned long long)stage[CMD_TS_SEND]);
+
+    MutexLocker locker(mutex_);
+    if (keep_ == 0)
+        return;
+    slow_.push_front(rec);
+    while (slow_.size() > keep_)
+        slow_.pop_back();
+}
+
+void CmdTracer::get_stage_stat(std::list<cmd_trace_stage_stat_t>& res) const {
+    for (int i = CMD_TS_DISPATCH; i <= CMD_TS_NUM; i++) {
+        const CmdLatHist& h = hists_[i];
+        cmd_trace_stage_stat_t st;
+        st.stage = i;
+        st.count = h.count();
+        st.avg = st.count ? h.sum() / st.count : 0;
+        st.max = h.max();
+        st.p50 = h.percentile(0.5);
+        st.p99 = h.percentile(0.99);
+        st.p999 = h.percentile(0.999);
+        res.push_back(st);
+    }
+}
+
+void CmdTracer::get_slow(std::list<cmd_slow_req_t>& res, uint32_t max_num) const {
+    MutexLocker locker(mutex_);
+    for (auto it = slow_.begin(); it != slow_.end() && res.size() < max_num; it++)
+        res.push_back(*it);
+}
+
+void CmdTracer::reset() {
+    for (int i = 0; i <= CMD_TS_NUM; i++)
+        hists_[i].reset();
+    slow_cnt_.store(0, std::memory_order_relaxed);
+    MutexLocker locker(mutex_);
+    slow_.clear();
+}
+
+} // namespace flame
@@ -0,0 +1,204 @@
+#ifndef FLAME_LIBFLAME_LIBCHUNK_CMD_TRACE_H
+#define FLAME_LIBFLAME_LIBCHUNK_CMD_TRACE_H
+
+#include "include/cmd.h"
+#include "common/thread/mutex.h"
+#include "util/cycles.h"
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <list>
+
+// 对数-线性直方图：每个2的幂区间再分为2^CMD_HIST_SUB_BITS个子桶，相对误差不超过1/8
+#define CMD_HIST_SUB_BITS   3
+#define CMD_HIST_BUCKETS    ((64 - CMD_HIST_SUB_BITS + 1) << CMD_HIST_SUB_BITS)
+// 默认保留的慢请求数
+#define CMD_TRACE_SLOW_KEEP 128
+
+namespace flame {
+
+/**
+ * @brief 服务端命令处理的打点
+ * 每个阶段的耗时为上一个打点到本打点的时间，阶段以结束的打点命名：
+ *  dispatch: 收到命令(RECV)到找到CmdService并开始处理
+ *  xfer:     RDMA READ（写命令拉取数据）/ RDMA WRITE（读命令回写数据）完成
+ *  exec:     ChunkStore IO完成
+ *  send:     响应发送完成
+ * 读命令的顺序为 RECV -> DISPATCH -> EXEC -> XFER -> SEND，
+ * 写命令为 RECV -> DISPATCH -> XFER -> EXEC -> SEND，没有发生的阶段耗时为0。
+ */
+enum CmdTraceStage {
+    CMD_TS_RECV     = 0,
+    CMD_TS_DISPATCH = 1,
+    CMD_TS_XFER     = 2,
+    CMD_TS_EXEC     = 3,
+    CMD_TS_SEND     = 4,
+    CMD_TS_NUM      = 5
+};
+
+const char* cmd_trace_stage_name(int stage);
+
+/**
+ * @brief 单个请求的时间戳 (TSC)，ts[CMD_TS_RECV] == 0 表示不跟踪
+ * 响应会原地覆盖命令，命令的信息在收到时记下
+ */
+struct cmd_trace_t {
+    uint64_t ts[CMD_TS_NUM];
+    uint8_t  cls;
+    uint8_t  seq;
+    uint32_t bytes;
+    uint64_t chk_id;
+    uint64_t off;
+
+    inline void clear() {
+        for (int i = 0; i < CMD_TS_NUM; i++)
+            ts[i] = 0;
+    }
+
+    inline bool tracing() const { return ts[CMD_TS_RECV] != 0; }
+
+    inline void mark(int stage) {
+        if (tracing())
+            ts[stage] = get_cycles();
+    }
+};
+
+/**
+ * @brief 无锁的延迟直方图 (ns)
+ */
+class CmdLatHist {
+public:
+    CmdLatHist() { reset(); }
+
+    static inline int index(uint64_t v) {
+        if (v < (1ULL << CMD_HIST_SUB_BITS))
+            return (int)v;
+        int e = 63 - __builtin_clzll(v);
+        return ((e - CMD_HIST_SUB_BITS + 1) << CMD_HIST_SUB_BITS)
+            + (int)((v >> (e - CMD_HIST_SUB_BITS)) & ((1ULL << CMD_HIST_SUB_BITS) - 1));
+    }
+
+    /**
+     * @brief 桶的下界
+     */
+    static uint64_t lower(int idx);
+
+    inline void record(uint64_t v) {
+        buckets_[index(v)].fetch_add(1, std::memory_order_relaxed);
+        count_.fetch_add(1, std::memory_order_relaxed);
+        sum_.fetch_add(v, std::memory_order_relaxed);
+        uint64_t m = max_.load(std::memory_order_relaxed);
+        while (v > m && !max_.compare_exchange_weak(m, v, std::memory_order_relaxed)) {}
+    }
+
+    uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+    uint64_t sum() const { return sum_.load(std::memory_order_relaxed); }
+    uint64_t max() const { return max_.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief 分位数，返回所在桶的上界
+     * @param p (0, 1]
+     */
+    uint64_t percentile(double p) const;
+
+    void reset();
+
+private:
+    std::atomic<uint64_t> buckets_[CMD_HIST_BUCKETS];
+    std::atomic<uint64_t> count_;
+    std::atomic<uint64_t> sum_;
+    std::atomic<uint64_t> max_;
+}; // class CmdLatHist
+
+struct cmd_trace_stage_stat_t {
+    int      stage  {0};        // CMD_TS_NUM 表示整个请求
+    uint64_t count  {0};
+    uint64_t avg    {0};        // (ns)
+    uint64_t max    {0};
+    uint64_t p50    {0};
+    uint64_t p99    {0};
+    uint64_t p999   {0};
+};
+
+/**
+ * @brief 慢请求记录
+ */
+struct cmd_slow_req_t {
+    uint64_t time   {0};        // 完成时间 (us)
+    uint8_t  cls    {0};
+    uint8_t  seq    {0};
+    uint64_t chk_id {0};        // 仅Chunk IO命令
+    uint64_t off    {0};
+    uint32_t bytes  {0};
+    uint64_t total  {0};        // (ns)
+    uint64_t stage[CMD_TS_NUM] {};  // 各阶段耗时 (ns)，下标同CmdTraceStage
+};
+
+/**
+ * @brief 服务端命令的分阶段延迟跟踪（进程内单例）
+ * 关闭时每个请求只多一次原子读；打开后每个阶段一次rdtsc，
+ * 请求完成时计入各阶段的直方图，超过慢请求阈值的请求按采样率保留最近的若干条并写日志。
+ */
+class CmdTracer {
+public:
+    static CmdTracer* get_tracer() {
+        static CmdTracer tracer;
+        return &tracer;
+    }
+
+    void set_enable(bool enable) { enable_.store(enable, std::memory_order_relaxed); }
+
+    bool enabled() const { return enable_.load(std::memory_order_relaxed); }
+
+    /**
+     * @param slow_ns 慢请求阈值，0表示不记录慢请求
+     * @param sample 每sample个慢请求记录一个
+     * @param keep 最多保留的慢请求数
+     */
+    void set_slow(uint64_t slow_ns, uint32_t sample, uint32_t keep);
+
+    uint64_t slow_ns() const { return slow_ns_.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief 收到命令时调用，跟踪关闭时清空tr
+     */
+    inline void begin(cmd_trace_t& tr, const cmd_t* cmd) {
+        tr.clear();
+        if (enabled())
+            start__(tr, cmd);
+    }
+
+    /**
+     * @brief 响应发送完成时调用
+     */
+    void finish(cmd_trace_t& tr);
+
+    void get_stage_stat(std::list<cmd_trace_stage_stat_t>& res) const;
+
+    /**
+     * @brief 最近的慢请求，最新的在前
+     */
+    void get_slow(std::list<cmd_slow_req_t>& res, uint32_t max_num) const;
+
+    void reset();
+
+private:
+    CmdTracer();
+    ~CmdTracer() {}
+
+    std::atomic<bool> enable_;
+    std::atomic<uint64_t> slow_ns_;
+    std::atomic<uint32_t> sample_;
+    std::atomic<uint64_t> slow_cnt_;
+    uint32_t keep_;
+    CmdLatHist hists_[CMD_TS_NUM + 1];  // hists_[CMD_TS_NUM]为整个请求
+    mutable Mutex mutex_;               // 保护slow_
+    std::deque<cmd_slow_req_t> slow_;
+
+    void start__(cmd_trace_t& tr, const cmd_t* cmd);
+}; // class CmdTracer
+
+} // namespace flame
+
+#endif // FLAME_LIBFLAME_LIBCHUNK_CMD_TRACE_H
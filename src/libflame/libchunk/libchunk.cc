@@ -2,6 +2,7 @@
 
 #include "include/csdc.h"
 #include "log_libchunk.h"
+#include "include/retcode.h"
 
 
 namespace flame {
@@ -33,6 +34,34 @@ cmd_ma_t MemoryAreaImpl::get() const {
     return ma_;
 }   
 
+//-------------------------------------UserMemoryAreaImpl->MemoryAreaImpl-----------------------------------------------//
+static msg::ib::RdmaMrCache* user_mr_cache() {
+    msg::RdmaStack* stack = msg::Stack::get_rdma_stack();
+    return stack ? stack->get_mr_cache() : nullptr;
+}
+
+UserMemoryAreaImpl* UserMemoryAreaImpl::create(void* addr, uint32_t len) {
+    msg::ib::RdmaMrCache* cache = user_mr_cache();
+    if (cache == nullptr)
+        return nullptr;
+    msg::ib::RdmaMr* mr = cache->get(addr, len);
+    if (mr == nullptr)
+        return nullptr;
+    return new UserMemoryAreaImpl(addr, len, cache, mr);
+}
+
+int UserMemoryAreaImpl::invalidate(void* addr, size_t len) {
+    msg::ib::RdmaMrCache* cache = user_mr_cache();
+    return cache ? cache->invalidate(addr, len) : 0;
+}
+
+UserMemoryAreaImpl::UserMemoryAreaImpl(void* addr, uint32_t len, msg::ib::RdmaMrCache* cache, msg::ib::RdmaMr* mr)
+    : MemoryAreaImpl((uint64_t)addr, len, mr->rkey(), true), cache_(cache), mr_(mr) {}
+
+UserMemoryAreaImpl::~UserMemoryAreaImpl() {
+    cache_->put(mr_);
+}
+
 
 
 //-------------------------------------CmdClientStubImpl->CmdClientStub-------------------------------------------------//
@@ -43,9 +72,8 @@ cmd_ma_t MemoryAreaImpl::get() const {
  * @return: \
  */
 
-int CmdClientStubImpl::ring = 0;
-CmdClientStubImpl::CmdClientStubImpl(FlameContext *flame_context)
-    :  CmdClientStub(){
+CmdClientStubImpl::CmdClientStubImpl(FlameContext *flame_context, uint32_t queue_num, uint32_t depth)
+    :  CmdClientStub(), cq_table_(queue_num, depth){
     msg_context_ = new msg::MsgContext(flame_context); //* set msg_context_
     client_msger_ = new Msger(msg_context_, this, false);
     if(msg_context_->load_config()){
@@ -53,6 +81,10 @@ CmdClientStubImpl::CmdClientStubImpl(FlameContext *flame_context)
     }
     msg_context_->config->set_rdma_conn_version("2"); //**这一步很重要，转换成msg_v2
     msg_context_->init(client_msger_);//* set msg_client_recv_func
+    //* 由消息模块的工作线程周期性地检查超时
+    if(msg_context_->manager){
+        cq_table_.start_expire_timer(msg_context_->manager->get_worker(0));
+    }
 }
 
 /**
@@ -85,11 +117,13 @@ int CmdClientStubImpl::_set_session(std::string ip_addr, int port){
  * @describtions: 创建访问CSD的客户端句柄
  * @param   std::string     ip_addr     字符串形式的IP地址       
  *          int             port        端口号
+ *          uint32_t        queue_num   完成队列数
+ *          uint32_t        depth       每个队列最多未完成的命令数
  * @return: std::shared_ptr<CmdClientStubImpl>
  */
-std::shared_ptr<CmdClientStubImpl> CmdClientStubImpl::create_stub(std::string ip_addr, int port){
+std::shared_ptr<CmdClientStubImpl> CmdClientStubImpl::create_stub(std::string ip_addr, int port, uint32_t queue_num, uint32_t depth){
     FlameContext* flame_context = FlameContext::get_context();
-    CmdClientStubImpl* cmd_client_stub = new CmdClientStubImpl(flame_context);
+    CmdClientStubImpl* cmd_client_stub = new CmdClientStubImpl(flame_context, queue_num, depth);
     int rc;
     rc = cmd_client_stub->_set_session(ip_addr, port);
     if(rc) return nullptr;
@@ -117,31 +151,269 @@ RdmaWorkRequest* CmdClientStubImpl::get_request(){
  * @return: 
  */
 int CmdClientStubImpl::submit(RdmaWorkRequest& req, cmd_cb_fn_t cb_fn, void* cb_arg){
-    ((cmd_t *)req.command)->hdr.cqn = ((ring++)%256);
+    if(client_id_){
+        chunk_cmd_set_client_id((cmd_t *)req.command, client_id_);
+    }
+    int r = cq_table_.prepare((cmd_t *)req.command, cb_fn, cb_arg);
+    if(r != RC_SUCCESS){
+        client_msger_->get_req_pool().free_req(&req);
+        return r;
+    }
     msg::Connection* conn = session_->get_conn(msg::msg_ttype_t::RDMA);
+    if(!conn){
+        cq_table_.cancel((cmd_t *)req.command);
+        client_msger_->get_req_pool().free_req(&req);
+        return RC_FAILD;
+    }
     msg::RdmaConnection* rdma_conn = msg::RdmaStack::rdma_conn_cast(conn);
     if(((cmd_t *)req.command)->hdr.cn.seq == CMD_CHK_IO_WRITE){
-        ChunkWriteCmd* write_cmd = new ChunkWriteCmd((cmd_t *)req.command);
-        FlameContext* fct = FlameContext::get_context();
-        if(write_cmd->get_inline_data_len() > 0){
+        ChunkWriteCmd write_cmd((cmd_t *)req.command);
+        if(write_cmd.get_inline_data_len() > 0){
             (req.get_ibv_send_wr())->num_sge = 2;
         }
     }
     rdma_conn->post_send(&req);
-    struct MsgCallBack msg_cb;
-    msg_cb.cb_fn = cb_fn;
-    msg_cb.cb_arg = cb_arg;
-    uint32_t cq = ((cmd_t *)req.command)->hdr.cqg << 16 | ((cmd_t *)req.command)->hdr.cqn;
-    msg_cb_map_.insert(std::map<uint32_t, MsgCallBack>::value_type (cq, msg_cb));
-    
+    return RC_SUCCESS;
+}
+
+/**
+ * @name: submit
+ * @describtions: 与传输方式无关的提交接口，命令拷贝到RDMA内存上的request后提交
+ * @param   const cmd_t&        cmd         准备发送的命令
+ *          cmd_cb_fn_t*        cb_fn       命令得到回复后的回调函数
+ *          void*               cb_arg      回调函数的参数
+ * @return: 
+ */
+int CmdClientStubImpl::submit(const cmd_t& cmd, cmd_cb_fn_t cb_fn, void* cb_arg){
+    RdmaWorkRequest* req = fill_request__(cmd);
+    if(!req) return RC_FAILD;
+    return submit(*req, cb_fn, cb_arg);
+}
+
+/**
+ * @name: fill_request__
+ * @describtions: 命令拷贝到RDMA内存上的request，内联写数据拷贝到request的数据缓冲
+ * @param   const cmd_t&        cmd         准备发送的命令
+ * @return: RdmaWorkRequest*，pool耗尽时返回nullptr
+ */
+RdmaWorkRequest* CmdClientStubImpl::fill_request__(const cmd_t& cmd){
+    RdmaWorkRequest* req = get_request();
+    if(!req) return nullptr;
+    memcpy(req->command, &cmd, sizeof(cmd_t));
+    if(client_id_){
+        chunk_cmd_set_client_id((cmd_t *)req->command, client_id_);
+    }
+    req->get_ibv_send_wr()->num_sge = 1;
+    req->get_ibv_send_wr()->next = nullptr;
+    if(cmd.hdr.cn.cls == CMD_CLS_IO_CHK && cmd.hdr.cn.seq == CMD_CHK_IO_WRITE){
+        ChunkWriteCmd write_cmd((cmd_t *)req->command);
+        if(write_cmd.get_inline_data_len() > 0){
+            memcpy(req->get_data_buf()->buffer(), (void *)write_cmd.get_ma_addr(), write_cmd.get_inline_data_len());
+            req->get_ibv_send_wr()->num_sge = 2;
+        }
+    }
+    return req;
+}
+
+/**
+ * @name: submit_batch
+ * @describtions: 批量提交：所有WR串成一条链，只敲一次doorbell；
+ *                每CMD_BATCH_SIGNAL_INTERVAL个WR为一组，只有组内最后一个带SIGNALED，
+ *                它的完成事件代表同组WR都已发送，由它回收整组request
+ * @param   const std::vector<cmd_t>&   cmds        准备发送的命令
+ *          cmd_cb_fn_t*                cb_fn       命令得到回复后的回调函数
+ *          const std::vector<void*>&   cb_args     各命令回调函数的参数
+ * @return: 成功提交的命令数
+ */
+int CmdClientStubImpl::submit_batch(const std::vector<cmd_t>& cmds, cmd_cb_fn_t cb_fn, const std::vector<void*>& cb_args){
+    msg::Connection* conn = session_->get_conn(msg::msg_ttype_t::RDMA);
+    if(!conn){
+        return 0;
+    }
+    std::vector<RdmaWorkRequest*> reqs;
+    reqs.reserve(cmds.size());
+    for(size_t i = 0; i < cmds.size(); i++){
+        RdmaWorkRequest* req = fill_request__(cmds[i]);
+        if(!req) break;
+        if(cq_table_.prepare((cmd_t *)req->command, cb_fn, cb_args[i]) != RC_SUCCESS){
+            client_msger_->get_req_pool().free_req(req);
+            break;
+        }
+        reqs.push_back(req);
+    }
+    if(reqs.empty()){
+        return 0;
+    }
+    cq_table_.record_batch(reqs.size());
+
+    RdmaWorkRequest* prev = nullptr;
+    for(size_t grp = 0; grp < reqs.size(); grp += CMD_BATCH_SIGNAL_INTERVAL){
+        size_t end = grp + CMD_BATCH_SIGNAL_INTERVAL < reqs.size() ? grp + CMD_BATCH_SIGNAL_INTERVAL : reqs.size();
+        RdmaWorkRequest* leader = reqs[end - 1];
+        for(size_t i = grp; i < end; i++){
+            reqs[i]->join_batch(prev, leader);
+            prev = reqs[i];
+        }
+    }
+    msg::RdmaStack::rdma_conn_cast(conn)->post_send(reqs[0]);
+    return reqs.size();
+}
+
+
+//-------------------------------------CmdClientStubTcpImpl->CmdClientStub----------------------------------------------//
+CmdClientStubTcpImpl::CmdClientStubTcpImpl(FlameContext *flame_context, uint32_t queue_num, uint32_t depth)
+    :  CmdClientStub(), cq_table_(queue_num, depth){
+    msg_context_ = new msg::MsgContext(flame_context); //* set msg_context_
+    client_msger_ = new Msger(msg_context_, this, false);
+    if(msg_context_->load_config()){
+        assert(false);
+    }
+    msg_context_->init(client_msger_);
+    if(msg_context_->manager){
+        cq_table_.start_expire_timer(msg_context_->manager->get_worker(0));
+    }
+}
+
+/**
+ * @name: _set_session
+ * @describtions: CmdClientStubTcpImpl设置session_，通信地址为CSD的TCP监听地址
+ * @param   std::string     ip_addr     字符串形式的IP地址       
+ *          int             port        端口号 
+ * @return: 0表示成功
+ */
+int CmdClientStubTcpImpl::_set_session(std::string ip_addr, int port){
+    msg::NodeAddr* addr = new msg::NodeAddr(msg_context_);
+    addr->ip_from_string(ip_addr);
+    addr->set_port(port);
+    msg::msger_id_t msger_id = msg::msger_id_from_msg_node_addr(addr);
+    addr->put();
+    session_ = msg_context_->manager->get_session(msger_id);
+    msg::NodeAddr* tcp_addr = new msg::NodeAddr(msg_context_);
+    tcp_addr->set_ttype(NODE_ADDR_TTYPE_TCP);
+    tcp_addr->ip_from_string(ip_addr);
+    tcp_addr->set_port(port);
+    session_->set_listen_addr(tcp_addr, msg::msg_ttype_t::TCP);
+    tcp_addr->put();
     return 0;
 }
 
+/**
+ * @name: create_stub
+ * @describtions: 创建通过TCP访问CSD的客户端句柄
+ * @param   std::string     ip_addr     字符串形式的IP地址       
+ *          int             port        CSD的TCP端口号
+ *          uint32_t        queue_num   完成队列数
+ *          uint32_t        depth       每个队列最多未完成的命令数
+ * @return: std::shared_ptr<CmdClientStubTcpImpl>
+ */
+std::shared_ptr<CmdClientStubTcpImpl> CmdClientStubTcpImpl::create_stub(std::string ip_addr, int port, uint32_t queue_num, uint32_t depth){
+    FlameContext* flame_context = FlameContext::get_context();
+    CmdClientStubTcpImpl* cmd_client_stub = new CmdClientStubTcpImpl(flame_context, queue_num, depth);
+    int rc = cmd_client_stub->_set_session(ip_addr, port);
+    if(rc){
+        delete cmd_client_stub;
+        return nullptr;
+    }
+    return std::shared_ptr<CmdClientStubTcpImpl>(cmd_client_stub);
+}
+
+int CmdClientStubTcpImpl::submit(RdmaWorkRequest& req, cmd_cb_fn_t cb_fn, void* cb_arg){
+    return RC_REFUSED;
+}
+
+/**
+ * @name: submit 
+ * @describtions: 在完成表中分配cqg/cqn作为标签后发送，不等待响应；写数据跟随命令发送，
+ *                一个Msg中命令与数据各占一个缓冲，由TcpConnection以sendmsg聚合发送
+ * @param   const cmd_t&        cmd         准备发送的命令
+ *          cmd_cb_fn_t*        cb_fn       命令得到回复后的回调函数
+ *          void*               cb_arg      回调函数的参数
+ * @return: RC_SUCCESS；本线程的完成队列已满时返回RC_REFUSED
+ */
+int CmdClientStubTcpImpl::submit(const cmd_t& cmd, cmd_cb_fn_t cb_fn, void* cb_arg){
+    cmd_t c = cmd;
+    if(client_id_){
+        chunk_cmd_set_client_id(&c, client_id_);
+    }
+    int r = cq_table_.prepare(&c, cb_fn, cb_arg);
+    if(r != RC_SUCCESS){
+        return r;
+    }
+
+    msg::Connection* conn = session_->get_conn(msg::msg_ttype_t::TCP);
+    if(!conn){
+        cq_table_.cancel(&c);
+        return RC_FAILD;
+    }
+    msg::Msg* msg = build_msg__(c);
+    conn->send_msg(msg);
+    msg->put();
+    return RC_SUCCESS;
+}
+
+/**
+ * @name: build_msg__
+ * @describtions: 一条命令一个Msg，写命令的数据作为内联数据跟随命令
+ * @param   cmd_t&      cmd         已分配cqg/cqn的命令
+ * @return: msg::Msg*
+ */
+msg::Msg* CmdClientStubTcpImpl::build_msg__(cmd_t& cmd){
+    msg::Msg* msg = msg::Msg::alloc_msg(msg_context_, msg::msg_ttype_t::TCP);
+    msg->type = FLAME_MSG_TYPE_IO;
+    if(cmd.hdr.cn.cls == CMD_CLS_IO_CHK && cmd.hdr.cn.seq == CMD_CHK_IO_WRITE){
+        ChunkWriteCmd write_cmd(&cmd);
+        ((cmd_chk_io_wr_t *)write_cmd.get_content())->inline_data_len = write_cmd.get_ma_len();
+        msg->append_data(&cmd, sizeof(cmd_t));
+        msg->append_data((void *)write_cmd.get_ma_addr(), write_cmd.get_ma_len());
+    }else{
+        msg->append_data(&cmd, sizeof(cmd_t));
+    }
+    return msg;
+}
+
+/**
+ * @name: submit_batch
+ * @describtions: 批量提交：除最后一个外都以more提交，连接在最后一个Msg入队后一次sendmsg发出；
+ *                非连接所在线程提交时，连接只投递一次发送任务，效果相同
+ * @param   const std::vector<cmd_t>&   cmds        准备发送的命令
+ *          cmd_cb_fn_t*                cb_fn       命令得到回复后的回调函数
+ *          const std::vector<void*>&   cb_args     各命令回调函数的参数
+ * @return: 成功提交的命令数
+ */
+int CmdClientStubTcpImpl::submit_batch(const std::vector<cmd_t>& cmds, cmd_cb_fn_t cb_fn, const std::vector<void*>& cb_args){
+    msg::Connection* conn = session_->get_conn(msg::msg_ttype_t::TCP);
+    if(!conn){
+        return 0;
+    }
+    std::vector<msg::Msg*> msgs;
+    msgs.reserve(cmds.size());
+    for(size_t i = 0; i < cmds.size(); i++){
+        cmd_t c = cmds[i];
+        if(client_id_){
+            chunk_cmd_set_client_id(&c, client_id_);
+        }
+        if(cq_table_.prepare(&c, cb_fn, cb_args[i]) != RC_SUCCESS){
+            break;
+        }
+        msgs.push_back(build_msg__(c));
+    }
+    if(msgs.empty()){
+        return 0;
+    }
+    cq_table_.record_batch(msgs.size());
+    for(size_t i = 0; i < msgs.size(); i++){
+        conn->send_msg(msgs[i], i + 1 < msgs.size());
+        msgs[i]->put();
+    }
+    return msgs.size();
+}
+
 
 //-------------------------------------CmdServerStubImpl->CmdServerStub-------------------------------------------------//
 CmdServerStubImpl::CmdServerStubImpl(FlameContext* flame_context){
     msg_context_ = new msg::MsgContext(flame_context); //* set msg_context_
     server_msger_ = new Msger(msg_context_, nullptr, true);
+    CmdServiceMapper::get_cmd_service_mapper()->freeze();   //**服务须在此之前注册
     assert(!msg_context_->load_config());
     msg_context_->config->set_rdma_conn_version("2"); //**这一步很重要，转换成msg_v2
     msg_context_->init(server_msger_);//* set msg_server_recv_func
@@ -5,7 +5,11 @@
 
 #include "msg/msg_core.h"
 #include "libflame/libchunk/msg_handle.h"
+#include "libflame/libchunk/cmd_cq.h"
+#include "util/utime.h"
 
+// 批量提交时每组WR数，只有每组最后一个WR产生完成事件；须小于发送队列长度
+#define CMD_BATCH_SIGNAL_INTERVAL   16
 
 namespace flame {
 
@@ -28,38 +32,151 @@ private:
     bool is_dma_;
 };
 
+/**
+ * @brief 用户自行分配的内存，由RDMA注册缓存注册后直接用于传输，不需要拷贝到RdmaBuffer
+ * 同一片内存只在第一次使用时注册；命令完成前不能析构
+ * 用户释放(free/munmap)这片内存之前须调用invalidate()
+ */
+class UserMemoryAreaImpl : public MemoryAreaImpl{
+public:
+    /**
+     * @return nullptr 未启用RDMA或注册缓存，或注册失败，此时应使用RdmaBuffer并拷贝数据
+     */
+    static UserMemoryAreaImpl* create(void* addr, uint32_t len);
+
+    /**
+     * @brief 丢弃与[addr, addr + len)重叠的注册区域
+     * @return 丢弃的区域数
+     */
+    static int invalidate(void* addr, size_t len);
+
+    ~UserMemoryAreaImpl();
+
+private:
+    UserMemoryAreaImpl(void* addr, uint32_t len, msg::ib::RdmaMrCache* cache, msg::ib::RdmaMr* mr);
+
+    msg::ib::RdmaMrCache* cache_;
+    msg::ib::RdmaMr* mr_;
+};
+
 
 //-------------------------------------CmdClientStubImpl->CmdClientStub-------------------------------------------------//
 
 class CmdClientStubImpl : public CmdClientStub{
 public:
-    static std::shared_ptr<CmdClientStubImpl> create_stub(std::string ip_addr, int port);
+    /**
+     * @param queue_num 完成队列数，提交线程按线程分散到各队列
+     * @param depth 每个队列最多未完成的命令数
+     */
+    static std::shared_ptr<CmdClientStubImpl> create_stub(std::string ip_addr, int port,
+        uint32_t queue_num = 4, uint32_t depth = 256);
     
     RdmaWorkRequest* get_request();
 
-    static int ring;     //用于填充cqn
+    /**
+     * @brief 失败时req被回收
+     */
+    virtual int submit(RdmaWorkRequest& req, cmd_cb_fn_t cb_fn, void* cb_arg) override;
 
-    inline virtual std::map<uint32_t, MsgCallBack>& get_cb_map() override {return msg_cb_map_;}
+    virtual int submit(const cmd_t& cmd, cmd_cb_fn_t cb_fn, void* cb_arg) override;
 
-    virtual int submit(RdmaWorkRequest& req, cmd_cb_fn_t cb_fn, void* cb_arg) override;
+    /**
+     * @brief 所有命令串成一条WR链，一次post_send；每CMD_BATCH_SIGNAL_INTERVAL个WR只有最后一个带SIGNALED
+     */
+    virtual int submit_batch(const std::vector<cmd_t>& cmds, cmd_cb_fn_t cb_fn, const std::vector<void*>& cb_args) override;
 
-    CmdClientStubImpl(FlameContext* flame_context);
+    inline virtual int complete(const cmd_res_t& res, void* data, uint32_t len) override {
+        return cq_table_.complete(res, data, len);
+    }
+
+    /**
+     * @brief 以RC_TIMEOUT完成超过期限的命令，消息模块的工作线程与提交路径也会周期性地检查
+     * @return 超时的命令数
+     */
+    inline int check_timeout() { return cq_table_.expire(utime_t::now().to_usec()); }
+
+    inline uint32_t inflight() const { return cq_table_.inflight(); }
+
+    /**
+     * @brief submit_batch的命令数直方图，第i个桶: [2^i, 2^(i+1))
+     */
+    inline uint64_t get_batch_hist(int i) const { return cq_table_.get_batch_hist(i); }
+
+    CmdClientStubImpl(FlameContext* flame_context, uint32_t queue_num, uint32_t depth);
 
     ~CmdClientStubImpl() {
+        cq_table_.stop_expire_timer();
         msg_context_->fin();
         delete msg_context_;
     }
 
 private:
     int _set_session(std::string ip_addr, int port);
+    RdmaWorkRequest* fill_request__(const cmd_t& cmd);
 
     msg::MsgContext* msg_context_;
     Msger* client_msger_;
     msg::Session* session_;
+    CmdCompletionTable cq_table_;
 
 }; // class CmdClientStubImpl
 
 
+//-------------------------------------CmdClientStubTcpImpl->CmdClientStub----------------------------------------------//
+/**
+ * @brief 基于TCP传输的客户端句柄，用于没有RDMA网卡的节点
+ * 一条连接上可以同时有多条未完成的命令，以cqg/cqn作为标签匹配响应；
+ * 写数据与读数据都以内联数据的形式随命令/响应传输
+ */
+class CmdClientStubTcpImpl : public CmdClientStub{
+public:
+    static std::shared_ptr<CmdClientStubTcpImpl> create_stub(std::string ip_addr, int port,
+        uint32_t queue_num = 4, uint32_t depth = 256);
+
+    /**
+     * @brief TCP传输不使用RdmaWorkRequest
+     * @return RC_REFUSED
+     */
+    virtual int submit(RdmaWorkRequest& req, cmd_cb_fn_t cb_fn, void* cb_arg) override;
+
+    virtual int submit(const cmd_t& cmd, cmd_cb_fn_t cb_fn, void* cb_arg) override;
+
+    /**
+     * @brief 所有命令的Msg一起交给连接，由一次sendmsg聚合发送
+     */
+    virtual int submit_batch(const std::vector<cmd_t>& cmds, cmd_cb_fn_t cb_fn, const std::vector<void*>& cb_args) override;
+
+    inline virtual int complete(const cmd_res_t& res, void* data, uint32_t len) override {
+        return cq_table_.complete(res, data, len);
+    }
+
+    inline int check_timeout() { return cq_table_.expire(utime_t::now().to_usec()); }
+
+    inline uint32_t inflight() const { return cq_table_.inflight(); }
+
+    inline uint64_t get_batch_hist(int i) const { return cq_table_.get_batch_hist(i); }
+
+    CmdClientStubTcpImpl(FlameContext* flame_context, uint32_t queue_num, uint32_t depth);
+
+    ~CmdClientStubTcpImpl() {
+        cq_table_.stop_expire_timer();
+        msg_context_->fin();
+        delete client_msger_;
+        delete msg_context_;
+    }
+
+private:
+    int _set_session(std::string ip_addr, int port);
+    msg::Msg* build_msg__(cmd_t& cmd);
+
+    msg::MsgContext* msg_context_;
+    Msger* client_msger_;
+    msg::Session* session_;
+    CmdCompletionTable cq_table_;
+
+}; // class CmdClientStubTcpImpl
+
+
 class CmdServerStubImpl : public CmdServerStub{
 public:
 
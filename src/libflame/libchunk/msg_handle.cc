@@ -14,65 +14,71 @@
 #include "libflame/libchunk/log_libchunk.h"
 #include "include/cmd.h"
 #include "libflame/libchunk/chunk_cmd_service.h"
+#include "util/utime.h"
+#include "common/thread/thread.h"
+#include "common/thread/cond.h"
+
+#include <memory>
+#include <new>
+#include <sched.h>
 
 namespace flame {
 
 //--------------------------RdmaWorkRequest------------------------------------------------------
 /**
- * @name: create_request
- * @describtions: 创建send/recv融为一体的RDMA work request
+ * @name: RdmaWorkRequest
+ * @describtions: 由RdmaWorkRequestPool在slab上构造send/recv融为一体的RDMA work request
  * @param   msg::MsgContext*        msg_context         Msg上下文
  *          Msger*                  msger               现在基本功能只是用来post recv_request以及区分服务器/客户端
- * @return: RdmaWorkRequest*
+ *          RdmaWorkRequestSlab*    slab                所属的slab
+ *          RdmaBuffer*             buf                 命令头，slab注册内存中的64B
+ *          RdmaBuffer*             data_buf            数据缓冲，slab注册内存中的4KB
+ * @return: 
  */
-RdmaWorkRequest* RdmaWorkRequest::create_request(msg::MsgContext* msg_context, Msger* msger){
-    RdmaWorkRequest* req = new RdmaWorkRequest(msg_context, msger);
-    if(!req){
-        return nullptr;
-    }
-    RdmaBuffer* buffer = msg::Stack::get_rdma_stack()->get_rdma_allocator()->alloc(4096);//4KB这里的buffer会自己释放吗？
-    if(!buffer){
-        delete req;
-        return nullptr;
-    }
-    RdmaBuffer* data_buffer = msg::Stack::get_rdma_stack()->get_rdma_allocator()->alloc(4096);//4KB这里的buffer会自己释放吗？
-    if(!data_buffer){
-        delete req;
-        return nullptr;
+RdmaWorkRequest::RdmaWorkRequest(msg::MsgContext *c, Msger *m, RdmaWorkRequestSlab *slab, RdmaBuffer *buf, RdmaBuffer *data_buf)
+: msg_context_(c), msger_(m), buf_(buf), data_buf_(data_buf), slab_data_buf_(data_buf), service_(nullptr), start_ns_(0), io_bytes_(0),
+  batch_next_(nullptr), batch_num_(1), unsignaled_(false), flushed_(false), slab_(slab), pool_next_(nullptr), mag_next_(nullptr),
+  mag_cnt_(0), status(FREE), conn(nullptr), command(buf->buffer()), io_rc(0){
+    trace_.clear();
+    reset__();
+}
+
+/**
+ * @name: reset__
+ * @describtions: 恢复为默认的send/recv请求：CmdService会改写sge与send_wr，回到请求池前需要还原，
+ *                如果要write or read，则需要额外设置
+ * @param 
+ * @return: 
+ */
+void RdmaWorkRequest::reset__(){
+    if(data_buf_ != slab_data_buf_){
+        msger_->get_req_pool().free_big_buf(data_buf_);
+        data_buf_ = slab_data_buf_;
     }
-    req->buf_ = buffer;
-    req->sge_[0].addr = buffer->addr();
-    req->sge_[0].length = 64;
-    req->sge_[0].lkey = buffer->lkey();
-    req->data_buf_ = data_buffer;
-    req->sge_[1].addr = data_buffer->addr();
-    req->sge_[1].length = 4096;
-    req->sge_[1].lkey = data_buffer->lkey();
+    sge_[0].addr = buf_->addr();
+    sge_[0].length = RDMA_REQ_HDR_SIZE;
+    sge_[0].lkey = buf_->lkey();
+    sge_[1].addr = data_buf_->addr();
+    sge_[1].length = RDMA_REQ_DATA_SIZE;
+    sge_[1].lkey = data_buf_->lkey();
 
-    ibv_send_wr &swr = req->send_wr_;
+    ibv_send_wr &swr = send_wr_;
     memset(&swr, 0, sizeof(swr));
-    swr.wr_id = reinterpret_cast<uint64_t>((RdmaSendWr *)req);
+    swr.wr_id = reinterpret_cast<uint64_t>((RdmaSendWr *)this);
     swr.opcode = IBV_WR_SEND;
     swr.send_flags |= IBV_SEND_SIGNALED;
     swr.num_sge = 1;
-    swr.sg_list = req->sge_;
+    swr.sg_list = sge_;
 
-    ibv_recv_wr &rwr = req->recv_wr_;
+    ibv_recv_wr &rwr = recv_wr_;
     memset(&rwr, 0, sizeof(rwr));
-    rwr.wr_id = reinterpret_cast<uint64_t>((RdmaRecvWr *)req);
+    rwr.wr_id = reinterpret_cast<uint64_t>((RdmaRecvWr *)this);
     rwr.num_sge = 2;
-    rwr.sg_list = req->sge_;
+    rwr.sg_list = sge_;
 
-    req->command = req->buf_->buffer();
-    return req;
-}
-
-
-RdmaWorkRequest::~RdmaWorkRequest(){
-    if(buf_){
-        msg::Stack::get_rdma_stack()->get_rdma_allocator()->free(buf_);
-        buf_ = nullptr;
-    }
+    service_ = nullptr;
+    conn = nullptr;
+    status = FREE;
 }
 
 //**以下四个函数都是状态机的变化，最终会调用run()来执行实际的操作
@@ -99,6 +105,9 @@ void RdmaWorkRequest::on_recv_cancelled(bool err, int eno){
  * @return: 
  */
 void RdmaWorkRequest::on_send_done(ibv_wc &cqe){
+    if(unsignaled_ && cqe.status != IBV_WC_SUCCESS){
+        flushed_ = true;        //**QP出错后组员也会产生完成事件，已按1个WR回收
+    }
     if(cqe.status == IBV_WC_SUCCESS){
         switch(cqe.opcode){
         case IBV_WC_SEND:
@@ -152,24 +161,49 @@ void RdmaWorkRequest::run(){
             switch(status){
                 case RECV_DONE:{
                     CmdServiceMapper* cmd_service_mapper = CmdServiceMapper::get_cmd_service_mapper(); 
-                    CmdService* service = cmd_service_mapper->get_service(((cmd_t *)command)->hdr.cn.cls, ((cmd_t *)command)->hdr.cn.seq);
-                    this->service_ = service;
+                    cmd_t* cmd = (cmd_t *)command;
+                    CmdTracer::get_tracer()->begin(trace_, cmd);
+                    this->service_ = cmd_service_mapper->get_service(cmd->hdr.cn.cls, cmd->hdr.cn.seq);
+                    start_ns_ = 0;
+                    if(cmd_service_mapper->stat_enable()){
+                        start_ns_ = utime_t::now().to_nsec();
+                        io_bytes_ = CmdServiceMapper::get_io_bytes(cmd);
+                    }
+                    if(!service_){
+                        ML(msg_context_, warn, "unknown command {:x}:{:x}", cmd->hdr.cn.cls, cmd->hdr.cn.seq);
+                        send_error__(RC_OBJ_NOT_FOUND);
+                        break;
+                    }
+                    trace_.mark(CMD_TS_DISPATCH);
                     service_->call(this);                    
                     break;
                 } 
                 case EXEC_DONE:
+                    trace_.mark(CMD_TS_EXEC);
+                    service_->call(this);
+                    break;
                 case READ_DONE:            //**如果是read/write，SEND_DONE是否代表read/write已经成功????????????????????????? **//
                 case WRITE_DONE:
+                    trace_.mark(CMD_TS_XFER);
                     service_->call(this);
                     break;   
                 case SEND_DONE:             //send response done                        
+                    if(trace_.tracing()){
+                        trace_.mark(CMD_TS_SEND);
+                        CmdTracer::get_tracer()->finish(trace_);
+                    }
+                    if(start_ns_){
+                        cmd_res_t* res = (cmd_res_t *)command;
+                        CmdServiceMapper::get_cmd_service_mapper()->record(res->hdr.cn.cls, res->hdr.cn.seq,
+                                                        io_bytes_, utime_t::now().to_nsec() - start_ns_);
+                        start_ns_ = 0;
+                    }
                     next_ready = true;
                     status = DESTROY;
                     break;
                 case DESTROY:
                 case ERROR:
                     msger_->get_req_pool().free_req(this);
-                    status = FREE;
                     break;
             };
         }while(next_ready);
@@ -178,23 +212,17 @@ void RdmaWorkRequest::run(){
             next_ready = false;
             switch(status){
             case RECV_DONE:{
-                std::map<uint32_t, MsgCallBack>& cb_map = msger_->get_client_stub()->get_cb_map();
-                uint32_t key = ((cmd_res_t*)command)->hdr.cqg << 16 | ((cmd_res_t*)command)->hdr.cqn;
-                MsgCallBack cb = cb_map[key];
-                if(((cmd_res_t*)command)->hdr.cn.seq == CMD_CHK_IO_READ){  //读操作
-                    ChunkReadRes* res = new ChunkReadRes((cmd_res_t*)command);
-                    if(res->get_inline_len() > 0 && res->get_inline_len() <= 4096 && cb.cb_arg == nullptr){    //inline read
-                        cb.cb_fn(*(Response *)res, (void *)data_buf_->buffer());
+                cmd_res_t* res = (cmd_res_t*)command;
+                void* data = nullptr;
+                uint32_t len = 0;
+                if(res->hdr.cn.cls == CMD_CLS_IO_CHK && res->hdr.cn.seq == CMD_CHK_IO_READ){  //读操作
+                    ChunkReadRes read_res(res);
+                    if(read_res.get_inline_len() > 0 && read_res.get_inline_len() <= 4096){    //inline read
+                        data = data_buf_->buffer();
+                        len = read_res.get_inline_len();
                     }
-                    else if(cb.cb_fn != nullptr){
-                        cb.cb_fn(*(Response *)res, cb.cb_arg);
-                    } 
-                }
-                else if(cb.cb_fn != nullptr){           //写操作
-                    CommonRes* res = new CommonRes((cmd_res_t*)command);
-                    cb.cb_fn(*(Response *)command, cb.cb_arg);
                 }
-                cb_map.erase(key);
+                msger_->get_client_stub()->complete(*res, data, len);
                 status = DESTROY;
                 next_ready = true;
                 break;
@@ -205,112 +233,772 @@ void RdmaWorkRequest::run(){
                 break;
             case DESTROY:
             case ERROR:
+                if(unsignaled_){        //**组员由组长回收，组长的WR在组员之后，完成/取消也在其后
+                    break;
+                }
+                free_batch__();
                 msger_->get_req_pool().free_req(this);
-                status = FREE;
                 break;
             };
         }while(next_ready);
     }
 }
 
+/**
+ * @name: join_batch
+ * @describtions: 客户端批量提交时组链：WR接在prev之后，去掉SIGNALED，组长的完成事件同时代表本WR完成
+ * @param   RdmaWorkRequest*    prev        链上的前一个请求，nullptr表示链首
+ *          RdmaWorkRequest*    leader      同组最后一个（带SIGNALED的）请求
+ * @return: 
+ */
+void RdmaWorkRequest::join_batch(RdmaWorkRequest* prev, RdmaWorkRequest* leader){
+    if(prev){
+        prev->send_wr_.next = &send_wr_;
+    }
+    if(leader == this){
+        return;
+    }
+    send_wr_.send_flags &= ~IBV_SEND_SIGNALED;
+    unsignaled_ = true;
+    batch_next_ = leader->batch_next_;
+    leader->batch_next_ = this;
+    leader->batch_num_++;
+}
+
+/**
+ * @name: get_retired_wr_num
+ * @describtions: 本请求的完成事件回收的WR数。组长回收同组组员的WR，
+ *                但QP出错后组员会各自产生flush完成事件并已单独回收，不能重复计数
+ * @param 
+ * @return: WR数
+ */
+uint32_t RdmaWorkRequest::get_retired_wr_num(){
+    if(unsignaled_){
+        return 1;
+    }
+    uint32_t num = batch_num_;
+    for(RdmaWorkRequest* req = batch_next_; req; req = req->batch_next_){
+        if(req->flushed_){
+            num--;
+        }
+    }
+    return num;
+}
+
+void RdmaWorkRequest::free_batch__(){
+    RdmaWorkRequest* req = batch_next_;
+    while(req){
+        RdmaWorkRequest* next = req->batch_next_;
+        req->batch_next_ = nullptr;
+        req->unsignaled_ = false;
+        req->flushed_ = false;
+        req->send_wr_.send_flags |= IBV_SEND_SIGNALED;
+        req->send_wr_.next = nullptr;
+        req->status = FREE;
+        msger_->get_req_pool().free_req(req);
+        req = next;
+    }
+    batch_next_ = nullptr;
+    batch_num_ = 1;
+    send_wr_.next = nullptr;
+}
+
+/**
+ * @name: get_io_buf__
+ * @describtions: 取IO缓冲。不超过RDMA_REQ_DATA_SIZE时直接使用slab中的数据缓冲，
+ *                否则从请求池的大缓冲缓存借出，请求回到请求池时由reset__()归还
+ * @param   uint32_t        len         IO长度
+ * @return: 数据缓冲，失败返回nullptr
+ */
+msg::ib::RdmaBuffer* RdmaWorkRequest::get_io_buf__(uint32_t len){
+    if(len > RDMA_REQ_DATA_SIZE){
+        RdmaBuffer* buf = msger_->get_req_pool().alloc_big_buf(len);
+        if(!buf){
+            return nullptr;
+        }
+        if(data_buf_ != slab_data_buf_){
+            msger_->get_req_pool().free_big_buf(data_buf_);
+        }
+        data_buf_ = buf;
+    }
+    data_buf_->data_len = len;
+    return data_buf_;
+}
+
+/**
+ * @name: send_error__
+ * @describtions: 服务端直接以错误码响应（如未知命令），响应原地写在command上
+ * @param   cmd_rc_t        rc          错误码
+ * @return: 
+ */
+void RdmaWorkRequest::send_error__(cmd_rc_t rc){
+    cmd_t cmd = *(cmd_t *)command;
+    ChunkReadCmd hdr_cmd(&cmd);
+    CommonRes res((cmd_res_t *)command, hdr_cmd, rc);
+    sge_[0].addr = buf_->addr();
+    sge_[0].length = 64;
+    sge_[0].lkey = buf_->lkey();
+    ibv_send_wr &swr = send_wr_;
+    memset(&swr, 0, sizeof(swr));
+    swr.wr_id = reinterpret_cast<uint64_t>((RdmaSendWr *)this);
+    swr.opcode = IBV_WR_SEND;
+    swr.send_flags |= IBV_SEND_SIGNALED;
+    swr.num_sge = 1;
+    swr.sg_list = sge_;
+    msg::RdmaStack::rdma_conn_cast(conn)->post_send_batched(this);
+}
+
+//--------------------------TcpWorkRequest------------------------------------------------------
+/**
+ * @name: create_request
+ * @describtions: 由收到的命令消息创建TCP work request，命令拷贝到请求内部；
+ *                内联数据连续时直接引用消息的缓冲，否则拷贝一份
+ * @param   msg::MsgContext*        msg_context         Msg上下文
+ *          msg::Connection*        conn                收到命令的连接
+ *          msg::Msg*               msg                 命令消息
+ * @return: TcpWorkRequest*，消息格式错误时返回nullptr
+ */
+TcpWorkRequest* TcpWorkRequest::create_request(msg::MsgContext* msg_context, msg::Connection* conn, msg::Msg* msg){
+    if(msg->get_data_len() < sizeof(cmd_t)){
+        return nullptr;
+    }
+    TcpWorkRequest* req = new TcpWorkRequest(msg_context, conn, msg);
+    auto it = msg->data_iter();
+    it.copy(&req->cmd_, sizeof(cmd_t));
+    req->data_len = msg->get_data_len() - sizeof(cmd_t);
+    if(req->data_len > 0){
+        int cd_len = 0;
+        char* p = it.cur_data_buffer(cd_len);
+        if(p && cd_len >= req->data_len){
+            req->data = p;
+        }else{
+            req->data = req->alloc_data(req->data_len);
+            it.copy(req->data, req->data_len);
+        }
+    }
+    return req;
+}
+
+TcpWorkRequest::TcpWorkRequest(msg::MsgContext *c, msg::Connection *conn, msg::Msg *msg)
+: msg_context_(c), msg_(msg), buf_(nullptr), service_(nullptr), start_ns_(0), io_bytes_(0), status(RECV_DONE),
+  conn(conn), command(&cmd_), data(nullptr), data_len(0), io_rc(0){
+    trace_.clear();
+    msg_->get();
+    conn->get();
+}
+
+TcpWorkRequest::~TcpWorkRequest(){
+    if(buf_){
+        delete [] buf_;
+        buf_ = nullptr;
+    }
+    msg_->put();
+    conn->put();
+}
+
+char* TcpWorkRequest::alloc_data(uint32_t len){
+    if(buf_){
+        delete [] buf_;
+    }
+    buf_ = new char[len];
+    data = buf_;
+    data_len = len;
+    return buf_;
+}
+
+/**
+ * @name: send_response
+ * @describtions: 响应 = cmd_res_t(64B) + 内联数据，自有缓冲直接交给Msg，由TcpConnection以sendmsg聚合发送
+ * @param   bool        with_data       是否携带data
+ * @return: 0表示成功
+ */
+int TcpWorkRequest::send_response(bool with_data){
+    msg::Msg* msg = msg::Msg::alloc_msg(msg_context_, msg::msg_ttype_t::TCP);
+    msg->type = FLAME_MSG_TYPE_IO;
+    msg->set_flags(FLAME_MSG_FLAG_RESP);
+    msg->append_data(command, sizeof(cmd_res_t));
+    if(with_data && data_len > 0){
+        if(data == buf_){
+            msg::MsgBuffer mb(buf_, data_len);
+            mb.set_offset(data_len);
+            msg->data_buffer_list().append_nocp(std::move(mb));
+            buf_ = nullptr;
+        }else{
+            msg->append_data(data, data_len);
+        }
+    }
+    ssize_t r = conn->send_msg(msg);
+    msg->put();
+    status = r < 0 ? ERROR : SEND_DONE;
+    run();
+    return r < 0 ? RC_FAILD : RC_SUCCESS;
+}
+
+int TcpWorkRequest::send_error(cmd_rc_t rc){
+    cmd_t cmd = cmd_;
+    ChunkReadCmd hdr_cmd(&cmd);
+    CommonRes res((cmd_res_t *)command, hdr_cmd, rc);
+    return send_response(false);
+}
+
+/**
+ * @name: run
+ * @describtions: 状态机，与RdmaWorkRequest::run()一致，由CmdService驱动
+ * @param 
+ * @return: 
+ */
+void TcpWorkRequest::run(){
+    switch(status){
+    case RECV_DONE:{
+        CmdTracer::get_tracer()->begin(trace_, &cmd_);
+        CmdServiceMapper* cmd_service_mapper = CmdServiceMapper::get_cmd_service_mapper();
+        service_ = cmd_service_mapper->get_service(cmd_.hdr.cn.cls, cmd_.hdr.cn.seq);
+        if(cmd_service_mapper->stat_enable()){
+            start_ns_ = utime_t::now().to_nsec();
+            io_bytes_ = CmdServiceMapper::get_io_bytes(&cmd_);
+        }
+        if(!service_){
+            ML(msg_context_, warn, "unknown command {:x}:{:x}", cmd_.hdr.cn.cls, cmd_.hdr.cn.seq);
+            send_error(RC_OBJ_NOT_FOUND);
+            break;
+        }
+        trace_.mark(CMD_TS_DISPATCH);
+        service_->call(this);
+        break;
+    }
+    case EXEC_DONE:
+        trace_.mark(CMD_TS_EXEC);
+        service_->call(this);
+        break;
+    case SEND_DONE:
+        if(trace_.tracing()){
+            trace_.mark(CMD_TS_SEND);
+            CmdTracer::get_tracer()->finish(trace_);
+        }
+        if(start_ns_){
+            cmd_res_t* res = (cmd_res_t *)command;
+            CmdServiceMapper::get_cmd_service_mapper()->record(res->hdr.cn.cls, res->hdr.cn.seq,
+                                                        io_bytes_, utime_t::now().to_nsec() - start_ns_);
+        }
+        delete this;
+        break;
+    case ERROR:
+        delete this;
+        break;
+    };
+}
+
 //-------------------------------------------RdmaWorkRequestPool------------------------------------//
-RdmaWorkRequestPool::RdmaWorkRequestPool(msg::MsgContext *c, Msger *m)
-    :msg_context_(c), msger_(m), mutex_(MUTEX_TYPE_ADAPTIVE_NP){
+// 后台线程检查水位的周期
+#define RDMA_REQ_KEEPER_INTERVAL_MS     10
+//**使用线程缓存的请求池的id，下标即cache_idx_，0表示空闲
+static std::atomic<uint64_t> cache_pool_ids[RDMA_REQ_CACHE_POOLS];
+static std::atomic<uint64_t> next_pool_id {1};
+
+static msg::ib::RdmaBuffer* rdma_alloc_buf(size_t len){
+    return msg::Stack::get_rdma_stack()->get_rdma_allocator()->alloc(len);
+}
+
+static void rdma_free_buf(msg::ib::RdmaBuffer *buf){
+    msg::Stack::get_rdma_stack()->get_rdma_allocator()->free(buf);
+}
+
+//**大IO缓冲的分级：不小于len的最小的2的幂，超出最大分级返回-1
+static int big_buf_class(size_t len){
+    int shift = RDMA_REQ_BIG_BUF_SHIFT_MIN;
+    while(((size_t)1 << shift) < len){
+        shift++;
+    }
+    shift -= RDMA_REQ_BIG_BUF_SHIFT_MIN;
+    return shift < RDMA_REQ_BIG_BUF_CLASSES ? shift : -1;
+}
+
+/**
+ * @brief 线程缓存：每个请求池一个单链表，线程退出时还给仍然存在的请求池
+ */
+struct RdmaWorkRequestPool::ThreadCache{
+    struct Entry{
+        uint64_t pool_id {0};
+        RdmaWorkRequestPool *pool {nullptr};
+        RdmaWorkRequest *head {nullptr};
+        uint32_t cnt {0};
+    };
+    Entry entries[RDMA_REQ_CACHE_POOLS];
+
+    ~ThreadCache(){
+        for(int i = 0; i < RDMA_REQ_CACHE_POOLS; i++){
+            Entry &e = entries[i];
+            if(e.cnt > 0 && e.pool_id == cache_pool_ids[i].load(std::memory_order_acquire)){
+                e.pool->push_mag__(e.head, e.cnt);
+            }
+        }
+    }
+
+    static inline Entry& get(RdmaWorkRequestPool *pool){
+        static thread_local ThreadCache cache;
+        Entry &e = cache.entries[pool->cache_idx_];
+        if(e.pool_id != pool->id_){  //**之前属于已经销毁的请求池，其中的请求已随slab释放
+            e.pool_id = pool->id_;
+            e.pool = pool;
+            e.head = nullptr;
+            e.cnt = 0;
+        }
+        return e;
+    }
+};
 
+class RdmaWorkRequestPoolKeeper : public Thread{
+    RdmaWorkRequestPool *pool_;
+    Mutex mutex_;
+    Cond cond_;
+    bool stop_;
+public:
+    explicit RdmaWorkRequestPoolKeeper(RdmaWorkRequestPool *pool)
+    : pool_(pool), cond_(mutex_), stop_(false) {}
+
+    void stop(){
+        MutexLocker l(mutex_);
+        stop_ = true;
+        cond_.signal();
+    }
+protected:
+    virtual void entry() override{
+        MutexLocker l(mutex_);
+        while(!stop_){
+            cond_.wait_interval(utime_t(0, RDMA_REQ_KEEPER_INTERVAL_MS * 1000000));
+            if(stop_) break;
+            mutex_.unlock();
+            pool_->maintain();
+            mutex_.lock();
+        }
+    }
+};//class RdmaWorkRequestPoolKeeper
+
+RdmaWorkRequestPool::RdmaWorkRequestPool(msg::MsgContext *c, Msger *m)
+    :msg_context_(c), msger_(m), id_(next_pool_id++), cache_idx_(-1), shared_head_(nullptr), shared_free_(0),
+     pop_mutex_(MUTEX_TYPE_ADAPTIVE_NP), low_wm_(RDMA_REQ_SLAB_REQS / 2), high_wm_(RDMA_REQ_SLAB_REQS * 4),
+     slab_mutex_(MUTEX_TYPE_ADAPTIVE_NP), total_(0), expand_cnt_(0), sync_expand_cnt_(0), purge_cnt_(0),
+     keeper_(nullptr), big_mutex_(MUTEX_TYPE_ADAPTIVE_NP), big_alloc_cnt_(0),
+     big_alloc_fn_(rdma_alloc_buf), big_free_fn_(rdma_free_buf){
+    for(int i = 0; i < RDMA_REQ_CACHE_POOLS; i++){
+        uint64_t none = 0;
+        if(cache_pool_ids[i].compare_exchange_strong(none, id_)){
+            cache_idx_ = i;
+            break;
+        }
+    }
 }
 
 RdmaWorkRequestPool::~RdmaWorkRequestPool(){
+    if(keeper_){
+        keeper_->stop();
+        keeper_->join();
+        delete keeper_;
+        keeper_ = nullptr;
+    }
+    if(cache_idx_ >= 0){
+        cache_pool_ids[cache_idx_].store(0, std::memory_order_release);
+    }
+    purge_big_bufs__();
+    MutexLocker l(slab_mutex_);
+    for(auto slab : slabs_){
+        free_slab__(slab);
+    }
+    slabs_.clear();
 }
 
 /**
- * @name: expand_lockfree
- * @describtions: 创建RdmaWOrkRequest到reqs_free_待用
- * @param   int     n       创建的req数量
- * @return: 成功建立的req数量
+ * @name: expand_slab__
+ * @describtions: 分配一块注册内存，切分出RDMA_REQ_SLAB_REQS个请求，按弹夹放入共享池
+ * @param 
+ * @return: 成功返回1，失败返回-1
  */
-int RdmaWorkRequestPool::expand_lockfree(int n){
-    int i;
-    for(i = 0; i < n; i++){
-        RdmaWorkRequest* req = RdmaWorkRequest::create_request(msg_context_, msger_);
-        if(!req) break;
-        reqs_free_.push_back(req);
+int RdmaWorkRequestPool::expand_slab__(){
+    const size_t n = RDMA_REQ_SLAB_REQS;
+    msg::ib::RdmaBuffer* mem = msg::Stack::get_rdma_stack()->get_rdma_allocator()
+                                    ->alloc(n * (RDMA_REQ_DATA_SIZE + RDMA_REQ_HDR_SIZE));
+    if(!mem){
+        ML(msg_context_, error, "alloc rdma memory for work requests failed");
+        return -1;
     }
-    return i;
+    add_slab__(mem);
+    {
+        MutexLocker l(slab_mutex_);
+        if(!keeper_){
+            keeper_ = new RdmaWorkRequestPoolKeeper(this);
+            keeper_->create("rdma_req_pool");
+        }
+    }
+    return 1;
 }
 
 /**
- * @name: purge_lockfree
- * @describtions: 释放申请的req，这些req需要在req_free_上
- * @param   int     n      指定释放的req数量，-1表示全释放
- * @return: 释放的req数量
+ * @name: add_slab__
+ * @describtions: 从注册内存mem中切分出RDMA_REQ_SLAB_REQS个请求，按弹夹放入共享池
+ * @param   RdmaBuffer*     mem         不小于RDMA_REQ_SLAB_REQS * (4KB + 64B)，由slab持有
+ * @return: 新的slab
  */
-int RdmaWorkRequestPool::purge_lockfree(int n){
-    int cnt = 0;
-    while(!reqs_free_.empty() && cnt != n){
-        RdmaWorkRequest* req = reqs_free_.back();
-        delete req;
-        reqs_free_.pop_back();
-        cnt++;
+RdmaWorkRequestSlab* RdmaWorkRequestPool::add_slab__(msg::ib::RdmaBuffer *mem){
+    const size_t n = RDMA_REQ_SLAB_REQS;
+    RdmaWorkRequestSlab* slab = new RdmaWorkRequestSlab();
+    slab->mem = mem;
+    slab->idle = 0;
+    slab->retired = false;
+    slab->bufs.reserve(2 * n);
+    for(size_t i = 0; i < n; i++){
+        slab->bufs.emplace_back(*mem, n * RDMA_REQ_DATA_SIZE + i * RDMA_REQ_HDR_SIZE, RDMA_REQ_HDR_SIZE);
+        slab->bufs.emplace_back(*mem, i * RDMA_REQ_DATA_SIZE, RDMA_REQ_DATA_SIZE);
+    }
+    slab->reqs = static_cast<RdmaWorkRequest *>(::operator new(n * sizeof(RdmaWorkRequest)));
+    for(size_t i = 0; i < n; i++){
+        new (&slab->reqs[i]) RdmaWorkRequest(msg_context_, msger_, slab, &slab->bufs[2 * i], &slab->bufs[2 * i + 1]);
+    }
+
+    {
+        MutexLocker l(slab_mutex_);
+        slabs_.push_back(slab);
+    }
+    total_ += n;
+
+    for(size_t i = 0; i < n; i += RDMA_REQ_MAG_SIZE){
+        for(size_t j = i; j + 1 < i + RDMA_REQ_MAG_SIZE; j++){
+            slab->reqs[j].pool_next_ = &slab->reqs[j + 1];
+        }
+        slab->reqs[i + RDMA_REQ_MAG_SIZE - 1].pool_next_ = nullptr;
+        push_mag__(&slab->reqs[i], RDMA_REQ_MAG_SIZE);
+    }
+    return slab;
+}
+
+void RdmaWorkRequestPool::free_slab__(RdmaWorkRequestSlab *slab){
+    for(size_t i = 0; i < RDMA_REQ_SLAB_REQS; i++){
+        slab->reqs[i].~RdmaWorkRequest();
+    }
+    ::operator delete(slab->reqs);
+    msg::Stack::get_rdma_stack()->get_rdma_allocator()->free(slab->mem);
+    delete slab;
+}
+
+/**
+ * @name: push_mag__
+ * @describtions: 弹夹（以pool_next_串起的cnt个请求）压入共享池，无锁
+ * @param   RdmaWorkRequest*        head        弹夹的第一个请求
+ *          uint32_t                cnt         请求数
+ * @return: 
+ */
+void RdmaWorkRequestPool::push_mag__(RdmaWorkRequest *head, uint32_t cnt){
+    head->mag_cnt_ = cnt;
+    RdmaWorkRequest* old = shared_head_.load(std::memory_order_relaxed);
+    do{
+        head->mag_next_.store(old, std::memory_order_relaxed);
+    }while(!shared_head_.compare_exchange_weak(old, head,
+                                                std::memory_order_release,
+                                                std::memory_order_relaxed));
+    shared_free_.fetch_add(cnt, std::memory_order_relaxed);
+}
+
+/**
+ * @name: pop_mag__
+ * @describtions: 从共享池取出一个弹夹。取出由pop_mutex_串行化：读到的栈顶只可能被压入操作替换，
+ *                不会被取走后再放回（ABA），也不会被回收
+ * @param 
+ * @return: 弹夹的第一个请求，共享池为空时返回nullptr
+ */
+RdmaWorkRequest* RdmaWorkRequestPool::pop_mag__(){
+    MutexLocker l(pop_mutex_);
+    RdmaWorkRequest* head = shared_head_.load(std::memory_order_acquire);
+    do{
+        if(!head){
+            return nullptr;
+        }
+    }while(!shared_head_.compare_exchange_weak(head, head->mag_next_.load(std::memory_order_relaxed),
+                                                std::memory_order_acquire,
+                                                std::memory_order_acquire));
+    shared_free_.fetch_sub(head->mag_cnt_, std::memory_order_relaxed);
+    return head;
+}
+
+/**
+ * @name: get_mag__
+ * @describtions: 取一个弹夹，共享池为空时在当前线程扩容（只在后台扩容跟不上时发生）
+ * @param 
+ * @return: 弹夹的第一个请求，RDMA内存耗尽时返回nullptr
+ */
+RdmaWorkRequest* RdmaWorkRequestPool::get_mag__(){
+    while(true){
+        RdmaWorkRequest* head = pop_mag__();
+        if(head){
+            return head;
+        }
+        if(expand_slab__() < 0){
+            return pop_mag__();
+        }
+        sync_expand_cnt_++;
     }
-    return cnt;
 }
 
 /**
  * @name: alloc_reqs
- * @describtions: 从reqs_free_中取出一批reqs，如果不够则通过expand_lockfree进行创建
+ * @describtions: 取出一批reqs
  * @param   vector<RdmaWorkRequest *>&      reqs        将取出的这批req放入传入的引用reqs中
  * @return: 采集的req数量
  */
 int RdmaWorkRequestPool::alloc_reqs(int n, std::vector<RdmaWorkRequest *> &reqs){
-    MutexLocker l(mutex_);
-    if(n > reqs_free_.size()){
-        expand_lockfree(n - reqs_free_.size());
-    }
-    if(n > reqs_free_.size()){
-        n = reqs_free_.size();
+    int i;
+    reqs.reserve(reqs.size() + n);
+    for(i = 0; i < n; i++){
+        RdmaWorkRequest* req = alloc_req();
+        if(!req) break;
+        reqs.push_back(req);
     }
-    reqs.insert(reqs.begin(), reqs_free_.end() - n, reqs_free_.end());
-    reqs_free_.erase(reqs_free_.end() - n, reqs_free_.end());
-    return n;
+    return i;
 }
 
 /**
  * @name: alloc_req
- * @describtions: 从reqs_free_中采集req，reqs_free_为空则create_request
+ * @describtions: 从线程缓存中取req，线程缓存为空时从共享池取一个弹夹
  * @param 
  * @return: RdmaWorkRequest*    采集的一个RdmaWorkRequest指针 
  */
 RdmaWorkRequest* RdmaWorkRequestPool::alloc_req(){
-    MutexLocker l(mutex_);
-    if(reqs_free_.empty()){
-        if(expand_lockfree(1) <= 0){
-            return nullptr;
+    if(cache_idx_ < 0){
+        RdmaWorkRequest* head = get_mag__();
+        if(!head) return nullptr;
+        if(head->pool_next_){
+            push_mag__(head->pool_next_, head->mag_cnt_ - 1);
+            head->pool_next_ = nullptr;
         }
+        return head;
+    }
+    ThreadCache::Entry &c = ThreadCache::get(this);
+    if(c.cnt == 0){
+        RdmaWorkRequest* head = get_mag__();
+        if(!head) return nullptr;
+        c.head = head;
+        c.cnt = head->mag_cnt_;
     }
-    RdmaWorkRequest* req = reqs_free_.back();
-    reqs_free_.pop_back();
+    RdmaWorkRequest* req = c.head;
+    c.head = req->pool_next_;
+    c.cnt--;
+    req->pool_next_ = nullptr;
     return req;
 }
 
 /**
  * @name: free_req
- * @describtions: 内部的释放是将req放入reqs_free_供循环利用
- * @param   RdmaWorkRequest*        req         放回reqs_free_的req指针
+ * @describtions: req还原后放回线程缓存，线程缓存满时还给共享池一个弹夹
+ * @param   RdmaWorkRequest*        req         放回的req指针
  * @return: 
  */
 void RdmaWorkRequestPool::free_req(RdmaWorkRequest* req){
-    MutexLocker l(mutex_);
-    reqs_free_.push_back(req);
+    req->reset__();
+    if(cache_idx_ < 0){
+        req->pool_next_ = nullptr;
+        push_mag__(req, 1);
+        return;
+    }
+    ThreadCache::Entry &c = ThreadCache::get(this);
+    req->pool_next_ = c.head;
+    c.head = req;
+    c.cnt++;
+    if(c.cnt >= 2 * RDMA_REQ_MAG_SIZE){
+        RdmaWorkRequest* tail = c.head;
+        for(int i = 1; i < RDMA_REQ_MAG_SIZE; i++){
+            tail = tail->pool_next_;
+        }
+        RdmaWorkRequest* head = c.head;
+        c.head = tail->pool_next_;
+        c.cnt -= RDMA_REQ_MAG_SIZE;
+        tail->pool_next_ = nullptr;
+        push_mag__(head, RDMA_REQ_MAG_SIZE);
+    }
 }
+
+/**
+ * @name: alloc_big_buf
+ * @describtions: 从对应分级的缓存借出大IO缓冲，缓存为空时按分级大小分配，同级的缓冲可以互换
+ * @param   size_t          len         IO长度，大于RDMA_REQ_DATA_SIZE
+ * @return: 数据缓冲，失败返回nullptr
+ */
+msg::ib::RdmaBuffer* RdmaWorkRequestPool::alloc_big_buf(size_t len){
+    int cls = big_buf_class(len);
+    if(cls >= 0){
+        MutexLocker l(big_mutex_);
+        if(!big_bufs_[cls].empty()){
+            msg::ib::RdmaBuffer* buf = big_bufs_[cls].back();
+            big_bufs_[cls].pop_back();
+            return buf;
+        }
+        len = (size_t)1 << (cls + RDMA_REQ_BIG_BUF_SHIFT_MIN);
+    }
+    msg::ib::RdmaBuffer* buf = big_alloc_fn_(len);
+    if(!buf){
+        ML(msg_context_, error, "alloc rdma memory for {} bytes io failed", len);
+        return nullptr;
+    }
+    big_alloc_cnt_++;
+    return buf;
+}
+
+/**
+ * @name: free_big_buf
+ * @describtions: 归还大IO缓冲，所在分级已满或超出最大分级时直接释放
+ * @param   RdmaBuffer*     buf         alloc_big_buf()借出的缓冲
+ * @return: 
+ */
+void RdmaWorkRequestPool::free_big_buf(msg::ib::RdmaBuffer *buf){
+    int cls = big_buf_class(buf->size());
+    if(cls >= 0 && buf->size() == ((size_t)1 << (cls + RDMA_REQ_BIG_BUF_SHIFT_MIN))){
+        MutexLocker l(big_mutex_);
+        if(big_bufs_[cls].size() < RDMA_REQ_BIG_BUF_CACHE){
+            big_bufs_[cls].push_back(buf);
+            return;
+        }
+    }
+    big_free_fn_(buf);
+}
+
+void RdmaWorkRequestPool::purge_big_bufs__(){
+    MutexLocker l(big_mutex_);
+    for(int i = 0; i < RDMA_REQ_BIG_BUF_CLASSES; i++){
+        for(auto buf : big_bufs_[i]){
+            big_free_fn_(buf);
+        }
+        big_bufs_[i].clear();
+    }
+}
+
+void RdmaWorkRequestPool::set_watermark(uint64_t low, uint64_t high){
+    low_wm_ = low;
+    high_wm_ = high > low + RDMA_REQ_SLAB_REQS ? high : low + RDMA_REQ_SLAB_REQS;
+}
+
+/**
+ * @name: take_idle_slabs__
+ * @describtions: 取出共享池中的全部弹夹，找出所有请求都空闲的slab，其余请求重新组成弹夹放回。
+ *                整个过程持有pop_mutex_，取出的slab没有其他线程引用
+ * @param   int                 n           取出的slab数，-1表示全部
+ *          list<Slab *>&       idle        取出的slab，由调用者释放
+ * @return: 取出的slab数
+ */
+int RdmaWorkRequestPool::take_idle_slabs__(int n, std::list<RdmaWorkRequestSlab *> &idle){
+    MutexLocker l(slab_mutex_);
+    MutexLocker pl(pop_mutex_);
+    RdmaWorkRequest* old = shared_head_.exchange(nullptr, std::memory_order_acquire);
+    std::vector<RdmaWorkRequest *> reqs;
+    for(RdmaWorkRequest* mag = old; mag; mag = mag->mag_next_.load(std::memory_order_relaxed)){
+        shared_free_.fetch_sub(mag->mag_cnt_, std::memory_order_relaxed);
+        for(RdmaWorkRequest* req = mag; req; req = req->pool_next_){
+            reqs.push_back(req);
+        }
+    }
+
+    for(auto slab : slabs_){
+        slab->idle = 0;
+    }
+    for(auto req : reqs){
+        req->slab_->idle++;
+    }
+    int cnt = 0;
+    for(auto it = slabs_.begin(); it != slabs_.end() && cnt != n;){
+        if((*it)->idle == RDMA_REQ_SLAB_REQS){
+            (*it)->retired = true;
+            idle.push_back(*it);
+            it = slabs_.erase(it);
+            cnt++;
+        }else{
+            it++;
+        }
+    }
+
+    RdmaWorkRequest* head = nullptr;
+    uint32_t head_cnt = 0;
+    for(auto req : reqs){
+        if(req->slab_->retired){
+            continue;
+        }
+        req->pool_next_ = head;
+        head = req;
+        if(++head_cnt == RDMA_REQ_MAG_SIZE){
+            push_mag__(head, head_cnt);
+            head = nullptr;
+            head_cnt = 0;
+        }
+    }
+    if(head){
+        push_mag__(head, head_cnt);
+    }
+
+    total_ -= (uint64_t)cnt * RDMA_REQ_SLAB_REQS;
+    purge_cnt_ += cnt;
+    return cnt;
+}
+
+/**
+ * @name: purge_slabs__
+ * @describtions: 回收所有请求都空闲的slab并立即释放
+ * @param   int         n           回收的slab数，-1表示全部
+ * @return: 
+ */
+void RdmaWorkRequestPool::purge_slabs__(int n){
+    std::list<RdmaWorkRequestSlab *> idle;
+    take_idle_slabs__(n, idle);
+    for(auto slab : idle){
+        free_slab__(slab);
+    }
+}
+
+/**
+ * @name: maintain
+ * @describtions: 按水位扩容或回收
+ * @param 
+ * @return: 
+ */
+void RdmaWorkRequestPool::maintain(){
+    int64_t free = shared_free_.load(std::memory_order_relaxed);
+    if(free < (int64_t)low_wm_){
+        if(expand_slab__() > 0){
+            expand_cnt_++;
+        }
+    }else if(free > (int64_t)high_wm_ && free - RDMA_REQ_SLAB_REQS >= (int64_t)low_wm_){
+        purge_slabs__(1);
+    }
+}
+
 /**
  * @name: purge
  * @describtions: public函数，为用户提供释放req的接口
- * @param   int         n           释放的req个数，注意这里的purge就是真正的delete
- * @return: int 真正delete的req数量
+ * @param   int         n           释放的slab个数，-1表示所有空闲的slab
+ * @return: int 回收的slab数量
  */
 int RdmaWorkRequestPool::purge(int n){
-    MutexLocker l(mutex_);
-    return purge_lockfree(n);
+    uint64_t before = purge_cnt_.load();
+    if(n < 0){
+        purge_big_bufs__();
+    }
+    purge_slabs__(n);
+    return (int)(purge_cnt_.load() - before);
+}
+
+void RdmaWorkRequestPool::get_stat(rdma_req_pool_stat_t &stat){
+    {
+        MutexLocker l(slab_mutex_);
+        stat.slabs = slabs_.size();
+    }
+    stat.total = total_.load();
+    int64_t free = shared_free_.load();
+    stat.shared_free = free > 0 ? free : 0;
+    stat.expand = expand_cnt_.load();
+    stat.sync_expand = sync_expand_cnt_.load();
+    stat.purge = purge_cnt_.load();
+    {
+        MutexLocker l(big_mutex_);
+        stat.big_cached = 0;
+        for(int i = 0; i < RDMA_REQ_BIG_BUF_CLASSES; i++){
+            stat.big_cached += big_bufs_[i].size();
+        }
+    }
+    stat.big_alloc = big_alloc_cnt_.load();
 }
 
 
@@ -350,7 +1038,41 @@ void Msger::on_conn_declared(msg::Connection *conn, msg::Session *s){
  * @return: 
  */
 void Msger::on_conn_recv(msg::Connection *conn, msg::Msg *msg){
-    ML(msg_context_, info, "I recv something.");
+    if(!msg->is_io()){
+        ML(msg_context_, info, "I recv something.");
+        return;
+    }
+    if(is_server_){             //**TCP传输的命令
+        TcpWorkRequest* req = TcpWorkRequest::create_request(msg_context_, conn, msg);
+        if(!req){
+            ML(msg_context_, error, "bad command {}", msg->to_string());
+            return;
+        }
+        req->run();
+        return;
+    }
+
+    //**TCP传输的响应
+    if(!msg->is_resp() || msg->get_data_len() < sizeof(cmd_res_t)){
+        ML(msg_context_, error, "bad response {}", msg->to_string());
+        return;
+    }
+    cmd_res_t res;
+    auto it = msg->data_iter();
+    it.copy(&res, sizeof(cmd_res_t));
+    uint32_t len = msg->get_data_len() - sizeof(cmd_res_t);
+    char* data = nullptr;
+    std::unique_ptr<char[]> hold;
+    if(len > 0){
+        int cd_len = 0;
+        data = it.cur_data_buffer(cd_len);
+        if(!data || cd_len < len){
+            hold.reset(new char[len]);
+            data = hold.get();
+            it.copy(data, len);
+        }
+    }
+    client_stub_->complete(res, data, len);
 };
 
 } //namespace flame
\ No newline at end of file
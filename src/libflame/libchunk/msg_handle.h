@@ -4,14 +4,33 @@
 #include "msg/msg_core.h"
 #include "include/cmd.h"
 #include "common/thread/mutex.h"
+#include "libflame/libchunk/cmd_trace.h"
 
+#include <atomic>
 #include <deque>
+#include <list>
 #include <sys/queue.h>
 
+// 请求的命令头与数据缓冲的大小，recv时分别作为两个sge
+#define RDMA_REQ_HDR_SIZE       64
+#define RDMA_REQ_DATA_SIZE      4096
+// 线程缓存与共享池之间一次转移的请求数
+#define RDMA_REQ_MAG_SIZE       16
+// 每个slab的请求数，slab的注册内存不超过1MB：15 * 16 * (4096 + 64) = 998400
+#define RDMA_REQ_SLAB_REQS      (15 * RDMA_REQ_MAG_SIZE)
+// 可以使用线程缓存的请求池数量（进程内同时存在的Msger），超出的请求池直接访问共享池
+#define RDMA_REQ_CACHE_POOLS    8
+// 超过RDMA_REQ_DATA_SIZE的IO缓冲按2的幂分级缓存：8KB ~ 16MB，每级至多缓存的缓冲数
+#define RDMA_REQ_BIG_BUF_SHIFT_MIN  13
+#define RDMA_REQ_BIG_BUF_CLASSES    12
+#define RDMA_REQ_BIG_BUF_CACHE      32
+
 namespace flame {
 
 class RequestPool;
 class Msger;
+class RdmaWorkRequestPool;
+struct RdmaWorkRequestSlab;
 
 //----------------RdmaWorkRequest----------------------------//
 class RdmaWorkRequest : public msg::RdmaRecvWr, public msg::RdmaSendWr{
@@ -36,20 +55,47 @@ private:
     ibv_send_wr send_wr_;
     ibv_recv_wr recv_wr_;
     RdmaBuffer* buf_;
-    RdmaBuffer* data_buf_;
+    RdmaBuffer* data_buf_;      //**当前的数据缓冲：slab_data_buf_，或大IO从请求池借出的缓冲
+    RdmaBuffer* slab_data_buf_; //**slab中切分的数据缓冲
     CmdService* service_;
-    RdmaWorkRequest(msg::MsgContext *c, Msger *m)
-    : msg_context_(c), msger_(m), status(FREE), conn(nullptr){}
+    uint64_t start_ns_;     //**收到命令的时间，0表示不统计
+    uint32_t io_bytes_;
+    cmd_trace_t trace_;     //**服务端各阶段的打点
+    //**批量提交：只有每组最后一个WR带SIGNALED，由它回收同组中不带SIGNALED的请求
+    RdmaWorkRequest* batch_next_;   //**组长：同组第一个请求；组员：同组下一个请求
+    uint32_t batch_num_;            //**组长的完成事件对应的WR数
+    bool unsignaled_;
+    bool flushed_;                  //**组员：QP出错后收到了自己的完成事件（flush），已单独回收
+    //**RdmaWorkRequestPool使用：请求空闲时以弹夹（一串请求）为单位在线程缓存与共享池之间转移
+    RdmaWorkRequestSlab* slab_;
+    RdmaWorkRequest* pool_next_;                //**弹夹内的下一个请求
+    std::atomic<RdmaWorkRequest*> mag_next_;    //**共享池中的下一个弹夹（只在弹夹的第一个请求上有效）
+    uint32_t mag_cnt_;                          //**弹夹的请求数（只在弹夹的第一个请求上有效）
+    RdmaWorkRequest(msg::MsgContext *c, Msger *m, RdmaWorkRequestSlab *slab, RdmaBuffer *buf, RdmaBuffer *data_buf);
+
+    void send_error__(cmd_rc_t rc);
+    void free_batch__();
+
+    /**
+     * @brief 取len字节的IO缓冲，不超过RDMA_REQ_DATA_SIZE时使用slab中的数据缓冲，
+     *        否则从请求池借出，reset__()时归还
+     * @return 数据缓冲，失败返回nullptr
+     */
+    RdmaBuffer* get_io_buf__(uint32_t len);
+
+    /**
+     * @brief 恢复为默认的send/recv请求并归还借出的数据缓冲，请求回到请求池时调用
+     */
+    void reset__();
 public:
     Status status;
     msg::RdmaConnection *conn;
     void *command;
-
-    static RdmaWorkRequest* create_request(msg::MsgContext *c, Msger *m);//创建默认的send/recv request，如果要write or read，则需要额外设置
+    cmd_rc_t io_rc;         //**Chunk IO的结果，EXEC_DONE时有效
 
     // void transform_rw_request(); //根据command来进行转换
 
-    ~RdmaWorkRequest();
+    ~RdmaWorkRequest() {}
 
     inline virtual ibv_send_wr *get_ibv_send_wr() override{
         return &send_wr_;
@@ -71,22 +117,155 @@ public:
 
     virtual void on_recv_cancelled(bool err, int eno=0) override;
 
+    virtual uint32_t get_retired_wr_num() override;
+
+    /**
+     * @brief 将本请求的WR接在prev之后，并作为不带SIGNALED的组员交给组长leader回收
+     */
+    void join_batch(RdmaWorkRequest* prev, RdmaWorkRequest* leader);
+
     void run();
 
     friend class ReadCmdService;
     friend class WriteCmdService;
+    friend class WriteZerosCmdService;
+    friend class RdmaWorkRequestPool;
 
 };//class RdmaWorkRequest
 
 
+//----------------TcpWorkRequest----------------------------//
+/**
+ * @brief TCP传输的服务端请求
+ * 一个Msg携带一条命令：cmd_t(64B) + 内联数据（写请求的数据 / 读响应的数据），
+ * 响应以FLAME_MSG_FLAG_RESP标记，客户端以cqn匹配请求，因此一条连接上可以有多条未完成的命令
+ */
+class TcpWorkRequest{
+public:
+    enum Status{
+        RECV_DONE = 1,      //**接收到命令
+        EXEC_DONE,          //**处理完成（数据已读到data / 已写入）
+        SEND_DONE,          //**响应已交给连接发送
+        ERROR,              //**出错
+    };
+private:
+    msg::MsgContext *msg_context_;
+    msg::Msg *msg_;         //**请求消息，写数据可能直接引用其中的缓冲
+    cmd_t cmd_;
+    char *buf_;             //**自有缓冲（new[]分配），发送响应时交给Msg
+    CmdService* service_;
+    uint64_t start_ns_;     //**收到命令的时间，0表示不统计
+    uint32_t io_bytes_;
+    cmd_trace_t trace_;     //**服务端各阶段的打点
+    TcpWorkRequest(msg::MsgContext *c, msg::Connection *conn, msg::Msg *msg);
+public:
+    Status status;
+    msg::Connection *conn;
+    void *command;          //**与RdmaWorkRequest::command相同，响应原地写回
+    char *data;             //**写：请求携带的数据；读：读缓冲
+    uint32_t data_len;
+    cmd_rc_t io_rc;         //**Chunk IO的结果，EXEC_DONE时有效
+
+    static TcpWorkRequest* create_request(msg::MsgContext *c, msg::Connection *conn, msg::Msg *msg);
+
+    ~TcpWorkRequest();
+
+    /**
+     * @brief 分配读缓冲，data指向该缓冲
+     */
+    char* alloc_data(uint32_t len);
+
+    /**
+     * @brief 发送command中已填好的响应，之后请求被销毁，调用者不能再访问req
+     * @param with_data 是否携带data作为内联数据
+     */
+    int send_response(bool with_data);
+
+    /**
+     * @brief 直接以错误码响应
+     */
+    int send_error(cmd_rc_t rc);
+
+    void run();
+};//class TcpWorkRequest
+
+
 //--------------------------RdmaWorkRequestPool-------------------------------------------------//
+/**
+ * @brief 一块注册内存及从中切分出的RDMA_REQ_SLAB_REQS个请求
+ * 内存布局：[数据缓冲 4KB * n][命令头 64B * n]，请求对象本身在普通内存上
+ */
+struct RdmaWorkRequestSlab{
+    msg::ib::RdmaBuffer *mem;
+    RdmaWorkRequest *reqs;
+    std::vector<msg::ib::RdmaBuffer> bufs;  //**bufs[2i]为第i个请求的命令头，bufs[2i+1]为数据缓冲
+    uint32_t idle;                          //**purge时统计的空闲请求数
+    bool retired;                           //**purge时选中回收
+};
+
+struct rdma_req_pool_stat_t{
+    uint32_t slabs          {0};
+    uint64_t total          {0};    //**请求总数
+    uint64_t shared_free    {0};    //**共享池中的空闲请求数（不含线程缓存）
+    uint64_t expand         {0};    //**后台扩容的slab数
+    uint64_t sync_expand    {0};    //**共享池为空时在分配路径上扩容的slab数
+    uint64_t purge          {0};    //**回收的slab数
+    uint64_t big_cached     {0};    //**缓存的大IO缓冲数
+    uint64_t big_alloc      {0};    //**缓存未命中时分配的大IO缓冲数
+};
+
+class RdmaWorkRequestPoolKeeper;
+
+/**
+ * @brief RDMA请求池
+ *  1. 请求的命令头、数据缓冲从slab的注册内存中切分，不再逐个分配RDMA内存；
+ *  2. 每个线程缓存至多2 * RDMA_REQ_MAG_SIZE个空闲请求，分配/释放只访问线程缓存，
+ *     缓存空时从共享池取一个弹夹，缓存满时还回一个弹夹；
+ *  3. 共享池是弹夹的栈：压入是无锁的CAS，取出由pop_mutex_串行化（每个弹夹只取一次）。
+ *     只有一个线程在取出，所以没有ABA；回收slab时也持有pop_mutex_，
+ *     没有其他线程正在读共享池中的请求，选中的slab可以立即释放；
+ *  4. 后台线程按水位扩容/回收slab：共享池空闲请求低于低水位时增加slab，
+ *     高于高水位时回收所有请求都空闲的slab。
+ *  5. 超过RDMA_REQ_DATA_SIZE的IO缓冲按2的幂分级缓存，用完还回缓存，不逐个命令分配注册内存。
+ * 分配/释放路径上没有锁和内存分配；只有共享池耗尽时才在分配路径上扩容。
+ * 第一次分配时才创建slab（此时RDMA栈已经初始化），只使用TCP时不占用RDMA内存。
+ */
 class RdmaWorkRequestPool{
+private:
     msg::MsgContext *msg_context_;
     Msger *msger_;
-    std::deque<RdmaWorkRequest *> reqs_free_;
-    Mutex mutex_;
-    int expand_lockfree(int n);
-    int purge_lockfree(int n);
+    uint64_t id_;                               //**进程内唯一，用于识别线程缓存的归属
+    int cache_idx_;                             //**线程缓存的下标，-1表示不使用线程缓存
+    std::atomic<RdmaWorkRequest*> shared_head_; //**栈顶弹夹
+    std::atomic<int64_t> shared_free_;
+    Mutex pop_mutex_;                           //**串行化共享池的取出与整理
+    uint64_t low_wm_;
+    uint64_t high_wm_;
+    Mutex slab_mutex_;                          //**保护slabs_，只在扩容/回收时使用，先于pop_mutex_获取
+    std::list<RdmaWorkRequestSlab *> slabs_;
+    std::atomic<uint64_t> total_;
+    std::atomic<uint64_t> expand_cnt_;
+    std::atomic<uint64_t> sync_expand_cnt_;
+    std::atomic<uint64_t> purge_cnt_;
+    RdmaWorkRequestPoolKeeper *keeper_;
+    Mutex big_mutex_;
+    std::vector<msg::ib::RdmaBuffer *> big_bufs_[RDMA_REQ_BIG_BUF_CLASSES];
+    std::atomic<uint64_t> big_alloc_cnt_;
+    //**分配/释放注册内存，测试时替换
+    msg::ib::RdmaBuffer* (*big_alloc_fn_)(size_t);
+    void (*big_free_fn_)(msg::ib::RdmaBuffer *);
+
+    struct ThreadCache;
+
+    int expand_slab__();
+    RdmaWorkRequestSlab* add_slab__(msg::ib::RdmaBuffer *mem);
+    void free_slab__(RdmaWorkRequestSlab *slab);
+    void push_mag__(RdmaWorkRequest *head, uint32_t cnt);
+    RdmaWorkRequest* pop_mag__();
+    RdmaWorkRequest* get_mag__();
+    int take_idle_slabs__(int n, std::list<RdmaWorkRequestSlab *> &idle);
+    void purge_slabs__(int n);
+    void purge_big_bufs__();
 public:
     explicit RdmaWorkRequestPool(msg::MsgContext *c, Msger *m);
     ~RdmaWorkRequestPool();
@@ -95,8 +274,29 @@ public:
     RdmaWorkRequest* alloc_req();
     void free_req(RdmaWorkRequest *req);
 
-    // int expand(int n);
+    /**
+     * @brief 借出不小于len字节的IO缓冲，超出最大分级时直接分配
+     */
+    msg::ib::RdmaBuffer* alloc_big_buf(size_t len);
+    void free_big_buf(msg::ib::RdmaBuffer *buf);
+
+    /**
+     * @brief 共享池的水位（请求数），默认为半个slab与4个slab
+     */
+    void set_watermark(uint64_t low, uint64_t high);
+
+    /**
+     * @brief 按水位扩容/回收，由后台线程周期调用
+     */
+    void maintain();
+
+    /**
+     * @brief 回收至多n个空闲的slab，-1表示全部（同时释放缓存的大IO缓冲）
+     * @return 回收的slab数
+     */
     int purge(int n);
+
+    void get_stat(rdma_req_pool_stat_t &stat);
 };//class RdmaWorkRequestPool
 
 
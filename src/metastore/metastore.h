@@ -364,6 +364,34 @@ protected:
     FlameContext* fct_;
 }; // class GatewayMS
 
+/**
+ * Interface for QoS Meta Store
+ */
+class QosMS {
+public:
+    virtual ~QosMS() {}
+
+    /**
+     * List all QoS settings
+     */
+    virtual int list_all(std::list<qos_attr_t>& res_list) = 0;
+
+    /**
+     * Create or replace a single QoS setting, keyed by (type, id)
+     */
+    virtual int save(const qos_attr_t& attr) = 0;
+
+    /**
+     * Remove a single QoS setting
+     */
+    virtual int remove(uint32_t type, uint64_t id) = 0;
+
+protected:
+    QosMS(FlameContext* fct) : fct_(fct) {}
+
+    FlameContext* fct_;
+}; // class QosMS
+
 class MetaStore {
 public:
     virtual ~MetaStore() {}
@@ -376,6 +404,7 @@ public:
     virtual CsdMS* get_csd_ms() = 0;
     virtual CsdHealthMS* get_csd_health_ms() = 0;
     virtual GatewayMS* get_gw_ms() = 0;
+    virtual QosMS* get_qos_ms() = 0;
 
     virtual int get_hot_chunk(std::map<uint64_t, uint64_t>& res, const uint64_t& csd_id, const uint16_t& limit, const uint32_t& spolicy_num) = 0;
 
@@ -4,15 +4,15 @@
 
 namespace flame {
 
-std::shared_ptr<MetaStore> create_metastore(FlameContext* fct, const std::string& url) {
+std::shared_ptr<MetaStore> create_metastore(FlameContext* fct, const std::string& url, size_t conn_num, size_t max_conn) {
     orm::DBUrlParser parser(url);
     if (!parser.matched()) {
         fct->log()->lerror("metastore url is invalid");
         return nullptr;
     }
     
-    if (parser.driver() == "mysql") {
-        return std::shared_ptr<MetaStore> (SqlMetaStore::create_sqlms(fct, url));
+    if (parser.driver() == "mysql" || parser.driver() == "sqlite") {
+        return std::shared_ptr<MetaStore> (SqlMetaStore::create_sqlms(fct, url, conn_num, max_conn));
     }
 
     return nullptr;
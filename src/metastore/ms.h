@@ -10,7 +10,12 @@
 
 namespace flame {
 
-std::shared_ptr<MetaStore> create_metastore(FlameContext* fct, const std::string& url);
+/**
+ * @conn_num: connections to the database at least
+ * @max_conn: connections at most, the pool grows under load
+ */
+std::shared_ptr<MetaStore> create_metastore(FlameContext* fct, const std::string& url,
+    size_t conn_num = DBE_DEF_CONNNUM, size_t max_conn = 0);
 
 } // namespace flame
 
@@ -146,6 +146,21 @@ public:
     orm::BigIntCol  atime       {this, "atime"};    // MGR最后一次推送信息成功时间或者GW最后一次主动发送消息给MGR的时间
 }; // class GatewayModel
 
+class QosModel final : public orm::DBTable {
+public:
+    QosModel(std::shared_ptr<orm::DBEngine>& engine) 
+    : orm::DBTable(engine, "qos") { auto_create(); }
+
+    orm::IntCol     type        {this, "type"};     // QosType
+    orm::BigIntCol  id          {this, "id"};       // vol_id或gw_id
+    orm::BigIntCol  rsv_iops    {this, "rsv_iops", orm::ColFlag::NONE, 0};   // 预留IOPS
+    orm::BigIntCol  lim_iops    {this, "lim_iops", orm::ColFlag::NONE, 0};   // IOPS上限
+    orm::BigIntCol  lim_bps     {this, "lim_bps", orm::ColFlag::NONE, 0};    // 带宽上限 (B/s)
+    orm::BigIntCol  burst_iops  {this, "burst_iops", orm::ColFlag::NONE, 0};
+    orm::BigIntCol  burst_bps   {this, "burst_bps", orm::ColFlag::NONE, 0};
+    orm::IntCol     weight      {this, "weight", orm::ColFlag::NONE, 1};     // 权重
+}; // class QosModel
+
 } // namespace flame
 
 #endif // FLAME_METASTORE_SQLMS_MODELS_H
\ No newline at end of file
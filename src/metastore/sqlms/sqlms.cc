@@ -17,9 +17,35 @@ namespace flame {
  * SqlMetaStore
  */
 
-SqlMetaStore* SqlMetaStore::create_sqlms(FlameContext* fct, const std::string& url, size_t conn_num) {
+SqlMetaStore::SqlMetaStore(FlameContext* fct, const std::shared_ptr<orm::DBEngine>& db) 
+: MetaStore(fct), db_(db),
+  ps_chk_get_(m_chunk.query().where(m_chunk.chk_id == arg_()).prepare()),
+  ps_chk_update_(m_chunk.update()
+    .assign({
+        set_(m_chunk.index, arg_()),
+        set_(m_chunk.stat, arg_()), 
+        set_(m_chunk.spolicy, arg_()), 
+        set_(m_chunk.flags, arg_()),
+        set_(m_chunk.primary, arg_()), 
+        set_(m_chunk.size, arg_()), 
+        set_(m_chunk.csd_id, arg_()), 
+        set_(m_chunk.csd_mtime, arg_()), 
+        set_(m_chunk.dst_id, arg_()), 
+        set_(m_chunk.dst_ctime, arg_())
+    }).where(m_chunk.chk_id == arg_()).prepare()),
+  ps_chk_update_map_(m_chunk.update()
+    .assign({
+        set_(m_chunk.stat, arg_()),
+        set_(m_chunk.csd_id, arg_()),
+        set_(m_chunk.dst_id, arg_())
+    }).where(m_chunk.chk_id == arg_()).prepare())
+{
+    // nothing
+}
+
+SqlMetaStore* SqlMetaStore::create_sqlms(FlameContext* fct, const std::string& url, size_t conn_num, size_t max_conn) {
     assert(fct != nullptr);
-    std::shared_ptr<orm::DBEngine> engine = orm::DBEngine::create_engine(fct, url, conn_num);
+    std::shared_ptr<orm::DBEngine> engine = orm::DBEngine::create_engine(fct, url, conn_num, max_conn);
     if (!engine) {
         fct->log()->lerror("DBEgine create faild.");
         return nullptr;
@@ -60,6 +86,10 @@ GatewayMS* SqlMetaStore::get_gw_ms() {
     return new SqlGatewayMS(fct_, this);
 }
 
+QosMS* SqlMetaStore::get_qos_ms() {
+    return new SqlQosMS(fct_, this);
+}
+
 int SqlMetaStore::get_hot_chunk(std::map<uint64_t, uint64_t>& ret, const uint64_t& csd_id, const uint16_t& limit, const uint32_t& spolicy_num) {
 	if (spolicy_num == 1) { //单副本
 		shared_ptr<Result> res = m_chunk.query()
@@ -501,7 +531,7 @@ int SqlChunkMS::list_all(std::list<chunk_meta_t>& res_list) {
 }
 
 int SqlChunkMS::get(chunk_meta_t& res_chk, uint64_t chk_id) {
-    shared_ptr<Result> ret = m_chunk.query().where(m_chunk.chk_id == chk_id).exec();
+    shared_ptr<Result> ret = ms_->db_->execute_prepared(ps_get_, {chk_id});
 
     if (ret && ret->OK()) {
         shared_ptr<DataSet> ds = ret->data_set();
@@ -578,30 +608,20 @@ int SqlChunkMS::remove_bulk(const std::list<uint64_t>& chk_ids) {
 }
 
 int SqlChunkMS::update(const chunk_meta_t& chk) {
-    shared_ptr<Result> ret = m_chunk.update()
-        .assign({
-            set_(m_chunk.index, chk.index),
-            set_(m_chunk.stat, chk.stat), 
-            set_(m_chunk.spolicy, chk.spolicy), 
-            set_(m_chunk.flags, chk.flags),
-            set_(m_chunk.primary, chk.primary), 
-            set_(m_chunk.size, chk.size), 
-            set_(m_chunk.csd_id, chk.csd_id), 
-            set_(m_chunk.csd_mtime, chk.csd_mtime), 
-            set_(m_chunk.dst_id, chk.dst_id), 
-            set_(m_chunk.dst_ctime, chk.dst_ctime)
-        }).where(m_chunk.chk_id == chk.chk_id).exec();
+    // the same order as ps_update_
+    shared_ptr<Result> ret = ms_->db_->execute_prepared(ps_update_, {
+            chk.index, chk.stat, chk.spolicy, chk.flags, chk.primary, chk.size,
+            chk.csd_id, chk.csd_mtime, chk.dst_id, chk.dst_ctime,
+            chk.chk_id
+        });
 
     return (ret && ret->OK()) ? RC_SUCCESS : RC_FAILD;
 }
 
 int SqlChunkMS::update_map(const chk_map_t& chk_map) {
-    shared_ptr<Result> ret = m_chunk.update()
-        .assign({
-            set_(m_chunk.stat, chk_map.stat),
-            set_(m_chunk.csd_id, chk_map.csd_id),
-            set_(m_chunk.dst_id, chk_map.dst_id),
-        }).where(m_chunk.chk_id == chk_map.chk_id).exec();
+    shared_ptr<Result> ret = ms_->db_->execute_prepared(ps_update_map_, {
+            chk_map.stat, chk_map.csd_id, chk_map.dst_id, chk_map.chk_id
+        });
     return (ret && ret->OK()) ? RC_SUCCESS : RC_FAILD;
 }
 
@@ -1112,4 +1132,53 @@ int SqlGatewayMS::update(const gateway_meta_t& gw) {
     return (ret && ret->OK()) ? RC_SUCCESS : RC_FAILD;
 }
 
+/**
+ * SqlQosMS
+ */
+
+static void qos_attr_set__(qos_attr_t& attr, const QosModel& m_qos, const DataSet::const_iterator& it) {
+    attr.type = it->get(m_qos.type);
+    attr.id = it->get(m_qos.id);
+    attr.rsv_iops = it->get(m_qos.rsv_iops);
+    attr.lim_iops = it->get(m_qos.lim_iops);
+    attr.lim_bps = it->get(m_qos.lim_bps);
+    attr.burst_iops = it->get(m_qos.burst_iops);
+    attr.burst_bps = it->get(m_qos.burst_bps);
+    attr.weight = it->get(m_qos.weight);
+}
+
+int SqlQosMS::list_all(std::list<qos_attr_t>& res_list) {
+    shared_ptr<Result> ret = m_qos.query().exec();
+    if (ret && ret->OK()) {
+        shared_ptr<DataSet> ds = ret->data_set();
+        for (auto it = ds->cbegin(); it != ds->cend(); ++it) {
+            qos_attr_t item;
+            qos_attr_set__(item, m_qos, it);
+            res_list.push_back(item);
+        }
+        return RC_SUCCESS;
+    }
+    return RC_FAILD;
+}
+
+int SqlQosMS::save(const qos_attr_t& attr) {
+    // MySQL的update在值不变时affected rows为0，无法区分记录是否存在，先删后插
+    int r = remove(attr.type, attr.id);
+    if (r != RC_SUCCESS) return r;
+    shared_ptr<Result> ret = m_qos.insert()
+        .column({
+            m_qos.type, m_qos.id, m_qos.rsv_iops, m_qos.lim_iops, 
+            m_qos.lim_bps, m_qos.burst_iops, m_qos.burst_bps, m_qos.weight
+        }).value({
+            attr.type, attr.id, attr.rsv_iops, attr.lim_iops, 
+            attr.lim_bps, attr.burst_iops, attr.burst_bps, attr.weight
+        }).exec();
+    return (ret && ret->OK()) ? RC_SUCCESS : RC_FAILD;
+}
+
+int SqlQosMS::remove(uint32_t type, uint64_t id) {
+    shared_ptr<Result> ret = m_qos.remove().where({m_qos.type == type, m_qos.id == id}).exec();
+    return (ret && ret->OK()) ? RC_SUCCESS : RC_FAILD;
+}
+
 } // namespace flame
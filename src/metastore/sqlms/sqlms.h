@@ -12,7 +12,8 @@ namespace flame {
 
 class SqlMetaStore final : public MetaStore {
 public:
-    static SqlMetaStore* create_sqlms(FlameContext* fct, const std::string& url, size_t conn_num = DBE_DEF_CONNNUM);
+    static SqlMetaStore* create_sqlms(FlameContext* fct, const std::string& url,
+        size_t conn_num = DBE_DEF_CONNNUM, size_t max_conn = 0);
 
     ~SqlMetaStore() {}
 
@@ -27,9 +28,20 @@ public:
     virtual CsdMS* get_csd_ms() override;
     virtual CsdHealthMS* get_csd_health_ms() override;
     virtual GatewayMS* get_gw_ms() override;
+    virtual QosMS* get_qos_ms() override;
      
     virtual int get_hot_chunk(std::map<uint64_t, uint64_t>& res, const uint64_t& csd_id, const uint16_t& limit, const uint32_t& spolicy_num) override;
 
+    /**
+     * Statistics of prepared statement cache
+     */
+    void get_prep_stat(orm::prep_stat_t& stat) const { db_->get_prep_stat(stat); }
+
+    /**
+     * Statistics of connection pool
+     */
+    void get_pool_stat(orm::pool_stat_t& stat) const { db_->get_pool_stat(stat); }
+
     SqlMetaStore(const SqlMetaStore&) = delete;
     SqlMetaStore(SqlMetaStore&&) = delete;
     SqlMetaStore& operator = (const SqlMetaStore&) = delete;
@@ -43,10 +55,10 @@ public:
     friend class SqlCsdMS;
     friend class SqlCsdHealthMS;
     friend class SqlGatewayMS;
+    friend class SqlQosMS;
 
 private:
-    SqlMetaStore(FlameContext* fct, const std::shared_ptr<orm::DBEngine>& db) 
-    : MetaStore(fct), db_(db) {}
+    SqlMetaStore(FlameContext* fct, const std::shared_ptr<orm::DBEngine>& db);
 
     std::shared_ptr<orm::DBEngine> db_;
 
@@ -61,6 +73,14 @@ private:
     CsdModel            m_csd       {db_};
     CsdHealthModel      m_csd_health{db_};
     GatewayModel        m_gw        {db_};
+    QosModel            m_qos       {db_};
+
+    /**
+     * Prepared statements of chunk hot paths, built once and shared by every SqlChunkMS
+     */
+    orm::PrepStmt ps_chk_get_;
+    orm::PrepStmt ps_chk_update_;
+    orm::PrepStmt ps_chk_update_map_;
 }; // class SqlMetaStore
 
 class SqlClusterMS final : public ClusterMS {
@@ -230,10 +250,18 @@ public:
     friend class SqlMetaStore;
 private:
     SqlChunkMS(FlameContext* fct, SqlMetaStore* ms) 
-    : ChunkMS(fct), ms_(ms), m_chunk(ms->m_chunk) {}
+    : ChunkMS(fct), ms_(ms), m_chunk(ms->m_chunk), ps_get_(ms->ps_chk_get_),
+      ps_update_(ms->ps_chk_update_), ps_update_map_(ms->ps_chk_update_map_) {}
 
     SqlMetaStore* ms_;
     ChunkModel& m_chunk;
+
+    /**
+     * Prepared statements of hot paths, owned by SqlMetaStore
+     */
+    const orm::PrepStmt& ps_get_;
+    const orm::PrepStmt& ps_update_;
+    const orm::PrepStmt& ps_update_map_;
 }; // class SqlChunkMS
 
 class SqlChunkHealthMS final : public ChunkHealthMS {
@@ -394,6 +422,32 @@ private:
     GatewayModel& m_gw;
 }; // class SqlGatewayMS
 
+class SqlQosMS final : public QosMS {
+public:
+    /**
+     * List all QoS settings
+     */
+    virtual int list_all(std::list<qos_attr_t>& res_list) override;
+
+    /**
+     * Create or replace a single QoS setting
+     */
+    virtual int save(const qos_attr_t& attr) override;
+
+    /**
+     * Remove a single QoS setting
+     */
+    virtual int remove(uint32_t type, uint64_t id) override;
+
+    friend class SqlMetaStore;
+private:
+    SqlQosMS(FlameContext* fct, SqlMetaStore* ms) 
+    : QosMS(fct), ms_(ms), m_qos(ms->m_qos) {}
+
+    SqlMetaStore* ms_;
+    QosModel& m_qos;
+}; // class SqlQosMS
+
 } // namespace flame
 
 #endif // FLAME_METASTORE_SQLMS_SQLMS_H
\ No newline at end of file
@@ -0,0 +1,360 @@
+#include "mgr/chkm/chk_balancer.h"
+#include "include/retcode.h"
+#include "include/objects.h"
+#include "util/utime.h"
+
+#include <cmath>
+#include <set>
+#include <algorithm>
+
+#include "log_chkm.h"
+
+using namespace std;
+
+namespace flame {
+
+int ChunkBalancer::init() {
+    if (opts_.cycle.to_msec() == 0) {
+        bct_->log()->linfo("chunk balancer disabled");
+        return RC_SUCCESS;
+    }
+
+    if (opts_.release > opts_.trigger) {
+        bct_->log()->lerror("wrong parameter: balance release (%lf) > trigger (%lf)",
+            opts_.release, opts_.trigger);
+        return RC_WRONG_PARAMETER;
+    }
+
+    bct_->timer()->push_cycle(shared_ptr<WorkEntry>(new BalanceWork(this)), opts_.cycle);
+    return RC_SUCCESS;
+}
+
+int ChunkBalancer::balance() {
+    vector<csd_load_t> csds;
+    collect__(csds);
+    return round__(csds);
+}
+
+int ChunkBalancer::round__(vector<csd_load_t>& csds) {
+    balance_stat_t stat;
+    get_stat(stat);
+    stat.rounds++;
+    stat.last_time = utime_t::now().to_usec();
+
+    if (csds.size() < 2) {
+        MutexLocker locker(lock_);
+        stat_.rounds = stat.rounds;
+        stat_.last_time = stat.last_time;
+        return 0;
+    }
+
+    stat.wear_imb = imbalance__(csds, &csd_load_t::wear);
+    stat.load_imb = imbalance__(csds, &csd_load_t::load);
+    stat.imb = imbalance__(csds, &csd_load_t::pressure);
+
+    // 上一轮发起过迁移，则本轮的不均衡度即为其实际效果，与上一轮的预计值一同报告
+    if (last_issued_) {
+        stat.projected_imb = projected_;
+        stat.achieved_imb = stat.imb;
+    }
+
+    // 滞回：超过trigger开始均衡，直到低于release才停止
+    if (!stat.active && stat.imb >= opts_.trigger)
+        stat.active = true;
+    else if (stat.active && stat.imb <= opts_.release)
+        stat.active = false;
+
+    // 清理已经冷却的Chunk
+    for (auto it = cooldown_.begin(); it != cooldown_.end(); ) {
+        if (it->second <= stat.rounds)
+            it = cooldown_.erase(it);
+        else
+            it++;
+    }
+
+    list<balance_move_t> moves;
+    if (stat.active) {
+        plan__(moves, csds);
+        projected_ = imbalance__(csds, &csd_load_t::pressure);
+    }
+
+    int issued = 0;
+    last_issued_ = false;
+    if (!moves.empty()) {
+        issued = issue__(moves, csds);
+        last_issued_ = issued > 0;
+        stat.active_rounds++;
+        for (auto it = moves.begin(); it != moves.end(); it++) {
+            if (it->res == RC_SUCCESS) {
+                stat.moves_issued++;
+                stat.bytes_issued += it->size;
+                cooldown_[it->chk_id] = stat.rounds + opts_.cooldown;
+            } else {
+                stat.moves_refused++;
+            }
+        }
+    }
+
+    bct_->log()->linfo("balance round %llu: wear_imb(%.4lf) load_imb(%.4lf) imb(%.4lf) active(%d) "
+        "moves(%d/%d) projected(%.4lf)",
+        stat.rounds, stat.wear_imb, stat.load_imb, stat.imb, stat.active,
+        issued, (int)moves.size(), moves.empty() ? 0.0 : projected_);
+    for (auto it = moves.begin(); it != moves.end(); it++) {
+        bct_->log()->ldebug("balance move chunk (%llu): csd (%llu) => csd (%llu), wr_cnt(%llu), gain(%.4lf), res(%d)",
+            it->chk_id, it->src_id, it->dst_id, it->wr_cnt, it->gain, it->res);
+    }
+
+    MutexLocker locker(lock_);
+    stat_ = stat;
+    moves_.swap(moves);
+    return issued;
+}
+
+void ChunkBalancer::get_stat(balance_stat_t& stat) {
+    MutexLocker locker(lock_);
+    stat = stat_;
+}
+
+void ChunkBalancer::get_moves(list<balance_move_t>& moves) {
+    MutexLocker locker(lock_);
+    moves = moves_;
+}
+
+void ChunkBalancer::log_stat() {
+    balance_stat_t stat;
+    list<balance_move_t> moves;
+    {
+        MutexLocker locker(lock_);
+        stat = stat_;
+        moves = moves_;
+    }
+
+    uint64_t refused = 0;
+    for (auto it = moves.begin(); it != moves.end(); it++) {
+        if (it->res != RC_SUCCESS)
+            refused++;
+    }
+    bct_->log()->linfo("balancer: rounds(%llu) active_rounds(%llu) active(%d) imb(%.4lf) "
+        "moves_issued(%llu) moves_refused(%llu) bytes_issued(%llu) "
+        "last_moves(%llu/%llu) projected(%.4lf) achieved(%.4lf)",
+        stat.rounds, stat.active_rounds, stat.active, stat.imb,
+        stat.moves_issued, stat.moves_refused, stat.bytes_issued,
+        moves.size() - refused, moves.size(), stat.projected_imb, stat.achieved_imb);
+}
+
+void ChunkBalancer::collect__(vector<csd_load_t>& csds) {
+    csdm_->read_lock();
+    for (auto it = csdm_->csd_hdl_begin(); it != csdm_->csd_hdl_end(); it++) {
+        CsdHandle* hdl = it->second;
+        if (hdl == nullptr || !hdl->is_active())
+            continue;
+        CsdObject* obj = hdl->read_and_lock();
+        if (obj == nullptr)
+            continue;
+        csd_load_t cl;
+        cl.csd_id = obj->get_csd_id();
+        cl.admin_addr = obj->get_admin_addr();
+        cl.left = obj->get_left();
+        cl.wr_cnt = obj->get_last_write();
+        cl.wear = obj->get_wear_weight();
+        cl.load = obj->get_load_weight();
+        hdl->unlock();
+        csds.push_back(cl);
+    }
+    csdm_->unlock();
+
+    if (csds.empty())
+        return;
+
+    // 以集群平均值归一化，平均压力为1
+    double wear_avg = 0, load_avg = 0;
+    for (auto it = csds.begin(); it != csds.end(); it++) {
+        wear_avg += it->wear;
+        load_avg += it->load;
+    }
+    wear_avg /= csds.size();
+    load_avg /= csds.size();
+
+    for (auto it = csds.begin(); it != csds.end(); it++) {
+        double w = wear_avg > 0 ? it->wear / wear_avg : 1.0;
+        double l = load_avg > 0 ? it->load / load_avg : 1.0;
+        it->pressure = opts_.wear_ratio * w + (1 - opts_.wear_ratio) * l;
+    }
+}
+
+double ChunkBalancer::imbalance__(const vector<csd_load_t>& csds, double csd_load_t::* field) {
+    if (csds.empty())
+        return 0;
+
+    double avg = 0;
+    for (auto it = csds.begin(); it != csds.end(); it++)
+        avg += (*it).*field;
+    avg /= csds.size();
+    if (avg <= 0)
+        return 0;
+
+    double var = 0;
+    for (auto it = csds.begin(); it != csds.end(); it++) {
+        double d = (*it).*field - avg;
+        var += d * d;
+    }
+    var /= csds.size();
+    return sqrt(var) / avg;
+}
+
+int ChunkBalancer::plan__(list<balance_move_t>& moves, vector<csd_load_t>& csds) {
+    vector<csd_load_t*> srcs, dsts;
+    for (auto it = csds.begin(); it != csds.end(); it++) {
+        if (it->pressure > 1 + opts_.band)
+            srcs.push_back(&(*it));
+        else if (it->pressure < 1 - opts_.band)
+            dsts.push_back(&(*it));
+    }
+    if (srcs.empty() || dsts.empty())
+        return 0;
+
+    sort(srcs.begin(), srcs.end(), [] (const csd_load_t* a, const csd_load_t* b) {
+        return a->pressure > b->pressure;
+    });
+
+    ChunkMS* chk_ms = ms_->get_chunk_ms();
+    uint32_t move_cnt = 0;
+    uint64_t move_bytes = 0;
+    for (auto sit = srcs.begin(); sit != srcs.end(); sit++) {
+        csd_load_t* src = *sit;
+        if (move_cnt >= opts_.max_moves || move_bytes >= opts_.max_bytes)
+            break;
+        if (src->wr_cnt == 0)
+            continue;
+
+        map<uint64_t, uint64_t> hot;
+        if (ms_->get_hot_chunk(hot, src->csd_id, opts_.hot_limit, 1) != RC_SUCCESS) {
+            bct_->log()->lerror("get hot chunk of csd (%llu) faild", src->csd_id);
+            continue;
+        }
+
+        vector<pair<uint64_t, uint64_t>> cands(hot.begin(), hot.end());
+        sort(cands.begin(), cands.end(), [] (const pair<uint64_t, uint64_t>& a, const pair<uint64_t, uint64_t>& b) {
+            return a.second > b.second;
+        });
+
+        // 以源CSD当前的压力为基准估计每个Chunk贡献的压力
+        double unit = src->pressure / src->wr_cnt;
+        for (auto cit = cands.begin(); cit != cands.end(); cit++) {
+            if (move_cnt >= opts_.max_moves || move_bytes >= opts_.max_bytes)
+                break;
+            if (src->pressure <= 1 + opts_.band)
+                break;
+            if (cooldown_.find(cit->first) != cooldown_.end() || cit->second == 0)
+                continue;
+
+            double gain = unit * cit->second;
+            // 迁移后源CSD不能低于平均压力，否则会引起反向迁移
+            if (src->pressure - gain < 1)
+                continue;
+
+            chunk_meta_t meta;
+            if (chk_ms->get(meta, cit->first) != RC_SUCCESS || meta.stat != CHK_STAT_CREATED)
+                continue;
+            if (move_bytes + meta.size > opts_.max_bytes)
+                continue;
+
+            // 同组的Chunk不能放在同一个CSD
+            set<uint64_t> related;
+            list<chunk_meta_t> cg;
+            if (chk_ms->list_cg(cg, meta.vol_id, meta.index) == RC_SUCCESS) {
+                for (auto git = cg.begin(); git != cg.end(); git++) {
+                    related.insert(git->csd_id);
+                    related.insert(git->dst_id);
+                }
+            }
+
+            csd_load_t* dst = nullptr;
+            for (auto dit = dsts.begin(); dit != dsts.end(); dit++) {
+                csd_load_t* d = *dit;
+                if (d->left < meta.size || related.count(d->csd_id))
+                    continue;
+                if (d->pressure + gain > 1)
+                    continue;
+                if (dst == nullptr || d->pressure < dst->pressure)
+                    dst = d;
+            }
+            if (dst == nullptr)
+                continue;
+
+            balance_move_t mv;
+            mv.chk_id = cit->first;
+            mv.src_id = src->csd_id;
+            mv.dst_id = dst->csd_id;
+            mv.wr_cnt = cit->second;
+            mv.size = meta.size;
+            mv.gain = gain;
+            moves.push_back(mv);
+
+            src->pressure -= gain;
+            dst->pressure += gain;
+            dst->left -= meta.size;
+            move_cnt++;
+            move_bytes += meta.size;
+        }
+    }
+    delete chk_ms;
+
+    return move_cnt;
+}
+
+int ChunkBalancer::issue__(list<balance_move_t>& moves, const vector<csd_load_t>& csds) {
+    map<uint64_t, uint64_t> addrs;
+    for (auto it = csds.begin(); it != csds.end(); it++)
+        addrs[it->csd_id] = it->admin_addr;
+
+    // 以源CSD为单位批量发送迁移通知
+    map<uint64_t, list<balance_move_t*>> groups;
+    for (auto it = moves.begin(); it != moves.end(); it++) {
+        it->res = RC_FAILD;
+        groups[it->src_id].push_back(&(*it));
+    }
+
+    int issued = 0;
+    for (auto git = groups.begin(); git != groups.end(); git++) {
+        CsdHandle* hdl = csdm_->find(git->first);
+        shared_ptr<CsdsClient> client = hdl ? hdl->get_client() : nullptr;
+        if (!client) {
+            bct_->log()->lerror("connect to csd (%llu) faild", git->first);
+            continue;
+        }
+
+        list<chunk_move_attr_t> attrs;
+        map<uint64_t, balance_move_t*> index;
+        for (auto it = git->second.begin(); it != git->second.end(); it++) {
+            chunk_move_attr_t attr;
+            attr.chk_id = (*it)->chk_id;
+            attr.src_id = (*it)->src_id;
+            attr.dst_id = (*it)->dst_id;
+            attr.signal = CHK_MOVE_NOTIFY;
+            attr.dst_addr = addrs[(*it)->dst_id];
+            attrs.push_back(attr);
+            index[attr.chk_id] = *it;
+        }
+
+        list<chunk_bulk_res_t> res;
+        int r = client->chunk_move(res, attrs);
+        if (r != RC_SUCCESS) {
+            bct_->log()->lerror("csd (%llu) chunk move faild: %d", git->first, r);
+            continue;
+        }
+
+        for (auto rit = res.begin(); rit != res.end(); rit++) {
+            auto mit = index.find(rit->chk_id);
+            if (mit == index.end())
+                continue;
+            mit->second->res = rit->res;
+            if (rit->res == RC_SUCCESS)
+                issued++;
+        }
+    }
+
+    return issued;
+}
+
+} // namespace flame
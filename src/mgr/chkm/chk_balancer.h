@@ -0,0 +1,158 @@
+#ifndef FLAME_MGR_CHKM_BALANCER_H
+#define FLAME_MGR_CHKM_BALANCER_H
+
+#include "mgr/mgr_context.h"
+#include "metastore/metastore.h"
+#include "include/meta.h"
+#include "include/csds.h"
+#include "mgr/csdm/csd_mgmt.h"
+#include "work/timer_work.h"
+#include "common/thread/mutex.h"
+
+#include <cstdint>
+#include <memory>
+#include <map>
+#include <list>
+#include <vector>
+
+namespace flame {
+
+struct balance_opts_t {
+    utime_t     cycle;                  // 均衡周期
+    double      trigger     {0.25};     // 不均衡度超过该值时开始迁移
+    double      release     {0.10};     // 不均衡度低于该值时停止迁移（滞回）
+    double      band        {0.10};     // 偏离平均压力超过该比例的CSD才作为源/目标
+    double      wear_ratio  {0.5};      // 压力中磨损所占比例，其余为负载
+    uint32_t    max_moves   {16};       // 每轮最多迁移的Chunk数
+    uint64_t    max_bytes   {64ULL << 30};  // 每轮最多迁移的数据量
+    uint32_t    cooldown    {5};        // Chunk迁移后冷却的周期数，避免来回迁移
+    uint32_t    hot_limit   {32};       // 每个源CSD候选的热点Chunk数
+};
+
+/**
+ * @brief 迁移决策（三元组）
+ */
+struct balance_move_t {
+    uint64_t    chk_id      {0};
+    uint64_t    src_id      {0};
+    uint64_t    dst_id      {0};
+    uint64_t    wr_cnt      {0};    // 上一周期写次数
+    uint64_t    size        {0};
+    double      gain        {0};    // 预计转移的压力
+    int         res         {0};    // CSD返回结果
+};
+
+/**
+ * @brief 均衡器统计信息
+ */
+struct balance_stat_t {
+    uint64_t    rounds          {0};    // 执行轮数
+    uint64_t    active_rounds   {0};    // 发起迁移的轮数
+    uint64_t    moves_issued    {0};    // 被CSD接受的迁移数
+    uint64_t    moves_refused   {0};    // 被CSD拒绝或者发送失败的迁移数
+    uint64_t    bytes_issued    {0};
+    bool        active          {false};// 是否处于均衡状态（滞回）
+    double      wear_imb        {0};    // 本轮磨损不均衡度（变异系数）
+    double      load_imb        {0};    // 本轮负载不均衡度（变异系数）
+    double      imb             {0};    // 本轮综合不均衡度
+    double      projected_imb   {0};    // 最近一次迁移后预计的综合不均衡度
+    double      achieved_imb    {0};    // 最近一次迁移后实际的综合不均衡度（与projected_imb同一轮）
+    uint64_t    last_time       {0};    // (us)
+};
+
+/**
+ * @brief 磨损/负载均衡器
+ * 周期性地计算集群的磨损与负载不均衡度，在超过触发阈值时，
+ * 从压力过高的CSD上选择写热点Chunk，迁移到压力过低的CSD；
+ * 采用触发/释放双阈值避免震荡，每轮迁移受数量与数据量预算限制。
+ */
+class ChunkBalancer final {
+public:
+    ChunkBalancer(MgrBaseContext* bct,
+        const std::shared_ptr<CsdManager>& csdm,
+        const balance_opts_t& opts)
+    : bct_(bct), ms_(bct->ms()), csdm_(csdm), opts_(opts) {}
+
+    /**
+     * @brief 注册到TimerWorker，周期执行
+     *
+     * @return int
+     */
+    int init();
+
+    /**
+     * @brief 执行一轮均衡
+     *
+     * @return int 本轮发起的迁移数量，< 0 表示错误
+     */
+    int balance();
+
+    /**
+     * @brief 获取统计信息
+     *
+     * @param stat
+     */
+    void get_stat(balance_stat_t& stat);
+
+    /**
+     * @brief 获取上一轮的迁移决策
+     *
+     * @param moves
+     */
+    void get_moves(std::list<balance_move_t>& moves);
+
+    /**
+     * @brief 将统计信息与上一轮的迁移结果写入日志（MGR周期性调用）
+     */
+    void log_stat();
+
+private:
+    struct csd_load_t {
+        uint64_t    csd_id      {0};
+        uint64_t    admin_addr  {0};
+        uint64_t    left        {0};    // 剩余空间
+        uint64_t    wr_cnt      {0};    // 上一周期写次数
+        double      wear        {0};
+        double      load        {0};
+        double      pressure    {0};    // 归一化的综合压力
+    };
+
+    MgrBaseContext* bct_;
+    std::shared_ptr<MetaStore> ms_;
+    std::shared_ptr<CsdManager> csdm_;
+    balance_opts_t opts_;
+
+    Mutex lock_;
+    balance_stat_t stat_;
+    std::list<balance_move_t> moves_;
+    std::map<uint64_t, uint64_t> cooldown_;  // chk_id => 可再次迁移的轮数
+    bool last_issued_ {false};
+    double projected_ {0};  // 本轮迁移后预计的综合不均衡度，下一轮与实际值一同报告
+
+    void collect__(std::vector<csd_load_t>& csds);
+
+    /**
+     * @brief 根据收集到的CSD压力执行一轮均衡
+     */
+    int round__(std::vector<csd_load_t>& csds);
+
+    static double imbalance__(const std::vector<csd_load_t>& csds, double csd_load_t::* field);
+
+    int plan__(std::list<balance_move_t>& moves, std::vector<csd_load_t>& csds);
+
+    int issue__(std::list<balance_move_t>& moves, const std::vector<csd_load_t>& csds);
+}; // class ChunkBalancer
+
+class BalanceWork : public WorkEntry {
+public:
+    BalanceWork(ChunkBalancer* blc) : blc_(blc) {}
+
+    virtual void entry() override { blc_->balance(); }
+
+private:
+    ChunkBalancer* blc_;
+}; // class BalanceWork
+
+} // namespace flame
+
+#endif // FLAME_MGR_CHKM_BALANCER_H
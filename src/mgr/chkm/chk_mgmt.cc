@@ -3,6 +3,7 @@
 #include "util/utime.h"
 
 #include <map>
+#include <vector>
 
 #include "log_chkm.h"
 
@@ -27,38 +28,42 @@ int ChunkManager::create_bulk(const list<uint64_t>& chk_ids, int cgn, const chk_
         return RC_WRONG_PARAMETER;
     }
 
-    // 将Chunk记录持久化到MetaStore并将状态标记为CREATING
-    list<chunk_meta_t> chk_list;
-    chunk_meta_t meta;
-    meta.stat = CHK_STAT_CREATING; // 等待创建
-    meta.spolicy = attr.spolicy;
-    meta.flags = attr.flags;
-    meta.size = attr.size;
-    for (auto it = chk_ids.begin(); it != chk_ids.end(); it++) {
-        chunk_id_t cid(*it);
-        meta.chk_id = cid;
-        meta.vol_id = cid.get_vol_id();
-        meta.index = cid.get_index();
-        chk_list.push_back(meta);
-    }
+    utime_t t_start = utime_t::now();
 
-    if ((r = ms_->get_chunk_ms()->create_bulk(chk_list)) != RC_SUCCESS) {
-        bct_->log()->lerror("persist chunk bulk faild: %d", r);
-        return RC_FAILD;
+    // 将Chunk记录持久化到MetaStore并将状态标记为CREATING，
+    // MGR在创建过程中宕机时，可以据此清理CSD上残留的Chunk
+    {
+        list<chunk_meta_t> chk_list;
+        chunk_meta_t meta;
+        meta.stat = CHK_STAT_CREATING; // 等待创建
+        meta.spolicy = attr.spolicy;
+        meta.flags = attr.flags;
+        meta.size = attr.size;
+        for (auto it = chk_ids.begin(); it != chk_ids.end(); it++) {
+            chunk_id_t cid(*it);
+            meta.chk_id = cid;
+            meta.vol_id = cid.get_vol_id();
+            meta.index = cid.get_index();
+            chunk_id_t pid(*it);
+            pid.set_sub_id(0);
+            meta.primary = pid;
+            chk_list.push_back(meta);
+        }
+
+        if ((r = ms_->get_chunk_ms()->create_bulk(chk_list)) != RC_SUCCESS) {
+            bct_->log()->lerror("persist chunk bulk faild: %d", r);
+            return RC_FAILD;
+        }
     }
-    chk_list.clear(); // 避免占用过多内存
 
     // 选择合适的CSD
     bct_->log()->ltrace("select csds");
     int grp = chk_num / cgn;
     list<uint64_t> csd_list;
-    if ((r = layout_->select_bulk(csd_list, grp, cgn, attr.size)) != RC_SUCCESS) {
-        bct_->log()->lerror("select csd faild: %d", r);//
-        return RC_FAILD;
-    }
-
-    if (csd_list.size() != chk_ids.size()) {
-        bct_->log()->lerror("wrong result of chunk layout");
+    if ((r = layout_->select_bulk(csd_list, grp, cgn, attr.size)) != RC_SUCCESS
+      || csd_list.size() != chk_ids.size()) {
+        bct_->log()->lerror("select csd faild: %d, csds(%llu)", r, csd_list.size());
+        ms_->get_chunk_ms()->remove_bulk(chk_ids);
         return RC_FAILD;
     }
 
@@ -71,77 +76,131 @@ int ChunkManager::create_bulk(const list<uint64_t>& chk_ids, int cgn, const chk_
         chk_dict[*csd_it].push_back(*chk_it);
     }
 
-    // 控制CSD创建Chunk
-    bct_->log()->ltrace("control csd to create chunks");
-    bool success = true;
+    vector<csd_chk_task_t> tasks;
+    tasks.reserve(chk_dict.size());
     for (auto it = chk_dict.begin(); it != chk_dict.end(); it++) {
-        CsdHandle* hdl = csdm_->find(it->first);
-        if (hdl == nullptr) {
-            // CSD宕机，暂时不做处理
-            bct_->log()->lerror("csd shutdown: %llu", it->first);
-            return RC_FAILD;
-        }
+        csd_chk_task_t task;
+        task.csd_id = it->first;
+        task.chk_ids.swap(it->second);
+        tasks.push_back(task);
+    }
+    chk_dict.clear();
 
-        shared_ptr<CsdsClient> stub = hdl->get_client();
+    utime_t t_select = utime_t::now();
+
+    // 并发控制CSD创建Chunk，创建成功的Chunk立即更新为CREATED
+    bct_->log()->ltrace("control csd to create chunks");
+    parallel__(tasks.size(), [this, &tasks, &attr] (size_t i) {
+        csd_chk_task_t& task = tasks[i];
+        shared_ptr<CsdsClient> stub = get_stub__(task.csd_id);
         if (stub.get() == nullptr) {
-            // 连接断开
-            bct_->log()->lerror("stub shutdown: %llu", it->first);
-            return RC_FAILD;
+            task.res = RC_FAILD;
+            return;
         }
 
         list<chunk_bulk_res_t> res;
-        r = stub->chunk_create(res, attr, it->second);
+        int r = stub->chunk_create(res, attr, task.chk_ids);
         if (r != RC_SUCCESS) {
-            bct_->log()->lerror("csds chunk_create faild: %d", r);
-            return RC_FAILD;
+            bct_->log()->lerror("csds (%llu) chunk_create faild: %d", task.csd_id, r);
+            task.res = RC_FAILD;
+            task.partial = true;
+            return;
         }
 
-        chunk_health_meta_t hlt;
-        hlt.stat = CHK_STAT_CREATING;
-        hlt.size = attr.size;
+        ChunkMS* chk_ms = ms_->get_chunk_ms();
+        chunk_meta_t meta;
+        meta.stat = CHK_STAT_CREATED;
+        meta.spolicy = attr.spolicy;
+        meta.flags = attr.flags;
+        meta.size = attr.size;
+        meta.csd_id = task.csd_id;
+        meta.dst_id = task.csd_id;
         for (auto rit = res.begin(); rit != res.end(); rit++) {
             if (rit->res != RC_SUCCESS) {
                 bct_->log()->lerror("csds chunk_create faild with chunk: %llu : %d", rit->chk_id, rit->res);
-                success = false;
-            } else {
-                chunk_id_t cid(rit->chk_id);
-                meta.chk_id = cid;
-                meta.vol_id = cid.get_vol_id();
-                meta.index = cid.get_index();
-                uint64_t tnow = utime_t::now().to_usec();
-                meta.ctime = tnow;
-                chunk_id_t pid(rit->chk_id);
-                pid.set_sub_id(0);
-                meta.primary = pid;
-                meta.csd_id = it->first;
-                meta.csd_mtime = tnow;
-                meta.dst_id = it->first;
-                meta.dst_ctime = tnow;
-                meta.stat = CHK_STAT_CREATED;
-                r = ms_->get_chunk_ms()->update(meta);
-                if (r != RC_SUCCESS) {
-                    bct_->log()->lerror("update chunk info faild: %llu", rit->chk_id);
-                    success = false;
-                    continue;
-                }
-                hlt.chk_id = cid;
-                r = ms_->get_chunk_health_ms()->create(hlt);
-                if (r != RC_SUCCESS) {
-                    bct_->log()->lerror("create chunk health faild: %llu", rit->chk_id);
-                    success = false;
-                }
+                task.res = RC_FAILD;
+                continue;
+            }
+            task.done.push_back(rit->chk_id);
+
+            chunk_id_t cid(rit->chk_id);
+            meta.chk_id = cid;
+            meta.vol_id = cid.get_vol_id();
+            meta.index = cid.get_index();
+            chunk_id_t pid(rit->chk_id);
+            pid.set_sub_id(0);
+            meta.primary = pid;
+            uint64_t tnow = utime_t::now().to_usec();
+            meta.csd_mtime = tnow;
+            meta.dst_ctime = tnow;
+            if ((r = chk_ms->update(meta)) != RC_SUCCESS) {
+                bct_->log()->lerror("update chunk info faild: %llu : %d", rit->chk_id, r);
+                task.res = RC_FAILD;
             }
         }
+        delete chk_ms;
+        if (task.done.size() != task.chk_ids.size())
+            task.res = RC_FAILD;
+    });
 
-        if (!success) 
+    bool success = true;
+    for (auto it = tasks.begin(); it != tasks.end(); it++) {
+        if (it->res != RC_SUCCESS) {
+            success = false;
             break;
+        }
     }
 
+    utime_t t_create = utime_t::now();
+
+    // 将Chunk健康信息批量持久化到MetaStore
+    if (success) {
+        list<chunk_health_meta_t> hlt_list;
+        chunk_health_meta_t hlt;
+        hlt.stat = CHK_STAT_CREATED;
+        hlt.size = attr.size;
+        for (auto it = chk_ids.begin(); it != chk_ids.end(); it++) {
+            hlt.chk_id = *it;
+            hlt_list.push_back(hlt);
+        }
+
+        if ((r = ms_->get_chunk_health_ms()->create_bulk(hlt_list)) != RC_SUCCESS) {
+            bct_->log()->lerror("persist chunk health bulk faild: %d", r);
+            success = false;
+        }
+    }
+
+    utime_t t_persist = utime_t::now();
+
     if (!success) {
-        bct_->log()->lerror("create chunk faild");
+        // 回滚：并发删除已经（或可能已经）在CSD上创建的Chunk，再删除Chunk记录
+        parallel__(tasks.size(), [this, &tasks] (size_t i) {
+            csd_chk_task_t& task = tasks[i];
+            const list<uint64_t>& chks = task.partial ? task.chk_ids : task.done;
+            if (chks.empty())
+                return;
+            shared_ptr<CsdsClient> stub = get_stub__(task.csd_id);
+            if (stub.get() == nullptr) {
+                bct_->log()->lerror("rollback: csd (%llu) is unreachable, %llu chunks left", task.csd_id, chks.size());
+                return;
+            }
+            list<chunk_bulk_res_t> res;
+            int r = stub->chunk_remove(res, chks);
+            if (r != RC_SUCCESS)
+                bct_->log()->lerror("rollback: csds (%llu) chunk_remove faild: %d", task.csd_id, r);
+        });
+        ms_->get_chunk_ms()->remove_bulk(chk_ids);
+
+        bct_->log()->lerror("create chunk faild: chunks(%d) csds(%llu) select(%llu ms) create(%llu ms) rollback(%llu ms)",
+            chk_num, tasks.size(), (t_select - t_start).to_msec(), (t_create - t_select).to_msec(),
+            (utime_t::now() - t_persist).to_msec());
         return RC_FAILD;
     }
 
+    bct_->log()->linfo("create chunk: chunks(%d) csds(%llu) select(%llu ms) create(%llu ms) persist(%llu ms)",
+        chk_num, tasks.size(), (t_select - t_start).to_msec(), (t_create - t_select).to_msec(),
+        (t_persist - t_create).to_msec());
+
     return RC_SUCCESS;
 }
 
@@ -158,8 +217,9 @@ int ChunkManager::create_cg(chunk_id_t pid, int num, const chk_attr_t& attr) {
 
 int ChunkManager::create_vol(chunk_id_t pid, int grp, int cgn, const chk_attr_t& attr) {
     list<uint64_t> chk_ids;
+    uint32_t base = pid.get_index();
     for (int g = 0; g < grp; g++) {
-        pid.set_index(pid.get_index() + g);
+        pid.set_index(base + g);
         for (int i = 0; i < cgn; i++) {
             pid.set_sub_id(i);
             chk_ids.push_back(pid);
@@ -190,6 +250,24 @@ int ChunkManager::update_status(const list<chk_push_attr_t>& chk_list) {
             continue;
         }
 
+        if (meta.stat == CHK_STAT_MOVING && it->stat == CHK_STAT_CREATED 
+          && it->csd_id == meta.dst_id && it->csd_id != meta.csd_id) {
+            // 迁移完成：切换Chunk映射到目标CSD
+            chk_map_t chk_map;
+            chk_map.chk_id = it->chk_id;
+            chk_map.stat = CHK_STAT_CREATED;
+            chk_map.csd_id = it->csd_id;
+            chk_map.dst_id = it->csd_id;
+            list<chk_map_t> chk_maps {chk_map};
+            if ((r = update_map(chk_maps)) != RC_SUCCESS) {
+                bct_->log()->lerror("switch chunk map faild: %llu", it->chk_id);
+                success = false;
+            }
+            continue;
+        }
+
+        if (it->stat == CHK_STAT_MOVING || meta.stat == CHK_STAT_MOVING)
+            meta.stat = it->stat;
         meta.csd_id = it->csd_id;
         meta.dst_id = it->dst_id;
         meta.dst_ctime = it->dst_ctime;
@@ -335,4 +413,67 @@ int ChunkManager::remove__(list<chunk_meta_t>& chks) {
     return faild ? RC_FAILD : RC_SUCCESS;
 }
 
+shared_ptr<CsdsClient> ChunkManager::get_stub__(uint64_t csd_id) {
+    CsdHandle* hdl = csdm_->find(csd_id);
+    if (hdl == nullptr) {
+        // CSD宕机，暂时不做处理
+        bct_->log()->lerror("csd shutdown: %llu", csd_id);
+        return nullptr;
+    }
+
+    shared_ptr<CsdsClient> stub = hdl->get_client();
+    if (stub.get() == nullptr) {
+        // 连接断开
+        bct_->log()->lerror("stub shutdown: %llu", csd_id);
+    }
+    return stub;
+}
+
+/**
+ * 等待一组并行工作全部完成
+ */
+struct parallel_wait_t {
+    parallel_wait_t(size_t n) : left(n), cond(mutex) {}
+
+    size_t  left;
+    Mutex   mutex;
+    Cond    cond;
+};
+
+class ParallelWork : public WorkEntry {
+public:
+    ParallelWork(const function<void(size_t)>* fn, size_t i, parallel_wait_t* wait)
+    : fn_(fn), i_(i), wait_(wait) {}
+
+    virtual void entry() override {
+        (*fn_)(i_);
+        MutexLocker locker(wait_->mutex);
+        if (--wait_->left == 0)
+            wait_->cond.signal();
+    }
+
+private:
+    const function<void(size_t)>* fn_;
+    size_t i_;
+    parallel_wait_t* wait_;
+}; // class ParallelWork
+
+void ChunkManager::parallel__(size_t num, const function<void(size_t)>& fn) {
+    if (num == 0)
+        return;
+
+    if (num == 1) {
+        fn(0);
+        return;
+    }
+
+    parallel_wait_t wait(num);
+    for (size_t i = 0; i < num; i++)
+        pool_.push(shared_ptr<WorkEntry>(new ParallelWork(&fn, i, &wait)));
+
+    MutexLocker locker(wait.mutex);
+    while (wait.left > 0)
+        wait.cond.wait();
+}
+
 } //  namespace flame
\ No newline at end of file
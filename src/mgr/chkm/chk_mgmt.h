@@ -7,11 +7,14 @@
 #include "mgr/csdm/csd_mgmt.h"
 #include "layout/layout.h"
 #include "layout/calculator.h"
+#include "work/work_pool.h"
 
 #include <cstdint>
 #include <memory>
 #include <map>
 #include <list>
+#include <vector>
+#include <functional>
 
 namespace flame {
 
@@ -20,8 +23,12 @@ public:
     ChunkManager(MgrBaseContext* bct, 
         const std::shared_ptr<CsdManager>& csdm,
         const std::shared_ptr<layout::ChunkLayout>& layout,
-        const std::shared_ptr<layout::ChunkHealthCaculator>& chk_hlt_calor)
-    : bct_(bct), ms_(bct->ms()), csdm_(csdm), layout_(layout), chk_hlt_calor_(chk_hlt_calor) {}
+        const std::shared_ptr<layout::ChunkHealthCaculator>& chk_hlt_calor,
+        int parallel = 16)
+    : bct_(bct), ms_(bct->ms()), csdm_(csdm), layout_(layout), chk_hlt_calor_(chk_hlt_calor),
+      parallel_(parallel > 0 ? parallel : 1), pool_("chkm_ctl", parallel_) {
+        pool_.start();
+    }
 
     /**
      * @brief 批量创建Chunk
@@ -117,6 +124,26 @@ private:
     std::shared_ptr<CsdManager> csdm_;
     std::shared_ptr<layout::ChunkLayout> layout_;
     std::shared_ptr<layout::ChunkHealthCaculator> chk_hlt_calor_;
+    int parallel_;  // 并发控制的CSD数量上限
+    WorkPool pool_; // 所有create_bulk()共享，同时在途的RPC数量不超过parallel_
+
+    struct csd_chk_task_t {
+        uint64_t                csd_id  {0};
+        std::list<uint64_t>     chk_ids;
+        std::list<uint64_t>     done;       // 已经在CSD上创建成功的Chunk
+        bool                    partial {false};    // RPC失败，CSD上可能已创建部分Chunk
+        int                     res     {0};
+    };
+
+    std::shared_ptr<CsdsClient> get_stub__(uint64_t csd_id);
+
+    /**
+     * @brief 在pool_中执行fn(0) ~ fn(num - 1)，等待全部完成
+     * 
+     * @param num 
+     * @param fn 
+     */
+    void parallel__(size_t num, const std::function<void(size_t)>& fn);
 
     /**
      * @brief 删除指定CSD上的Chunk
@@ -8,8 +8,18 @@
 #define CFG_MGR_NUM "mgr_num"
 #define CFG_MGR_ADDR "address"
 #define CFG_MGR_METASTORE "metastore"
+#define CFG_MGR_METASTORE_CONN "metastore_conn"
+#define CFG_MGR_METASTORE_MAX_CONN "metastore_max_conn"
 #define CFG_MGR_HB_CYCLE "heart_beat_cycle"
 #define CFG_MGR_HB_CHECK "heart_beat_check_cycle"
 #define CFG_MGR_CONSOLE_LOG "console_log"
+#define CFG_MGR_CQ_THREADS "cq_threads"
+#define CFG_MGR_BG_CQ_THREADS "bg_cq_threads"
+#define CFG_MGR_HANDLER_THREADS "handler_threads"
+#define CFG_MGR_BALANCE_CYCLE "balance_cycle"
+#define CFG_MGR_BALANCE_TRIGGER "balance_trigger"
+#define CFG_MGR_BALANCE_RELEASE "balance_release"
+#define CFG_MGR_BALANCE_MAX_MOVES "balance_max_moves"
+#define CFG_MGR_STAT_CYCLE "stat_cycle"
 
 #endif // FLAME_MGR_CONFIG_H
\ No newline at end of file
@@ -2,6 +2,7 @@
 #include "common/cmdline.h"
 #include "common/convert.h"
 #include "common/thread/thread.h"
+#include "common/thread/signal.h"
 #include "metastore/ms.h"
 
 #include "mgr/mgr_context.h"
@@ -9,6 +10,7 @@
 #include "mgr/config_mgr.h"
 #include "mgr/csdm/csd_mgmt.h"
 #include "mgr/chkm/chk_mgmt.h"
+#include "mgr/chkm/chk_balancer.h"
 #include "mgr/volm/vol_mgmt.h"
 
 #include <grpcpp/grpcpp.h>
@@ -29,6 +31,7 @@
 #include <memory>
 #include <iostream>
 #include <string>
+#include <unistd.h>
 
 using grpc::Server;
 using grpc::ServerBuilder;
@@ -49,8 +52,18 @@ public:
     Argument<string>    mgr_name    {this, 'n', CFG_MGR_NAME, "MGR Name", "mgr"};
     Argument<string>    addr        {this, 'a', CFG_MGR_ADDR, "MGR listen port", "0.0.0.0:6666"};
     Argument<string>    metastore   {this, CFG_MGR_METASTORE, "MetaStore url", ""};
+    Argument<uint64_t>  ms_conn     {this, CFG_MGR_METASTORE_CONN, "MetaStore connections at least", 8};
+    Argument<uint64_t>  ms_max_conn {this, CFG_MGR_METASTORE_MAX_CONN, "MetaStore connections at most, the pool grows under load", 32};
     Argument<uint64_t>  hb_cycle    {this, CFG_MGR_HB_CYCLE, "heart beat cycle, unit: ms", 3000};
     Argument<uint64_t>  hb_check    {this, CFG_MGR_HB_CHECK, "heart beat check cycle, unit: ms", 30000};
+    Argument<uint64_t>  cq_threads  {this, CFG_MGR_CQ_THREADS, "polling threads for control calls, 0 means one per core", uint64_t(0)};
+    Argument<uint64_t>  bg_cq_threads {this, CFG_MGR_BG_CQ_THREADS, "polling threads for heart beat and health calls", 1};
+    Argument<uint64_t>  handler_threads {this, CFG_MGR_HANDLER_THREADS, "threads executing control calls", 16};
+    Argument<uint64_t>  blc_cycle   {this, CFG_MGR_BALANCE_CYCLE, "chunk balance cycle, unit: ms, 0 means disable", 60000};
+    Argument<double>    blc_trigger {this, CFG_MGR_BALANCE_TRIGGER, "imbalance to start chunk balance", 0.25};
+    Argument<double>    blc_release {this, CFG_MGR_BALANCE_RELEASE, "imbalance to stop chunk balance", 0.10};
+    Argument<uint64_t>  blc_moves   {this, CFG_MGR_BALANCE_MAX_MOVES, "max chunks moved in each balance round", 16};
+    Argument<uint64_t>  stat_cycle  {this, CFG_MGR_STAT_CYCLE, "statistics log cycle, unit: ms, 0 means disable", 60000};
     Argument<string>    log_dir     {this, CFG_MGR_LOG_DIR, "log dir", "/var/log/flame"};
     Argument<string>    log_level   {this, CFG_MGR_LOG_LEVEL, 
         "log level. {PRINT, TRACE, DEBUG, INFO, WARN, ERROR, WRONG, CRITICAL, DEAD}", "INFO"};
@@ -90,10 +103,17 @@ private:
     string      cfg_mgr_name_;
     node_addr_t cfg_addr_;
     string      cfg_metastore_url_;
+    uint64_t    cfg_ms_conn_;
+    uint64_t    cfg_ms_max_conn_;
     uint64_t    cfg_hb_cycle_ms_;
     uint64_t    cfg_hb_check_ms_;
     string      cfg_log_dir_;
     string      cfg_log_level_;
+    uint64_t    cfg_cq_threads_;
+    uint64_t    cfg_bg_cq_threads_;
+    uint64_t    cfg_handler_threads_;
+    balance_opts_t cfg_balance_;
+    uint64_t    cfg_stat_cycle_ms_;
 
     int read_config(MgrCli* csd_cli);
 
@@ -104,12 +124,60 @@ private:
     bool init_cltm();
     bool init_chkm();
     bool init_volm();
+    bool init_chkb();
+    bool init_stat();
 
     bool run_server();
 
     int wait();
 }; // class Manager
 
+/**
+ * @brief 周期性地将MGR各组件的统计信息写入日志
+ */
+class MgrStatWork : public WorkEntry {
+public:
+    MgrStatWork(MgrContext* mct, MgrServer* server) : mct_(mct), server_(server) {}
+
+    virtual void entry() override {
+        if (server_)
+            server_->log_stat();
+        if (mct_->chkb())
+            mct_->chkb()->log_stat();
+        log_ms_stat__();
+    }
+
+private:
+    MgrContext* mct_;
+    MgrServer* server_;
+    uint64_t last_wait_ {0};
+    uint64_t last_wait_us_ {0};
+
+    /**
+     * @brief MetaStore连接池的等待与利用率，及预编译语句缓存的命中率
+     */
+    void log_ms_stat__() {
+        SqlMetaStore* sqlms = dynamic_cast<SqlMetaStore*>(mct_->ms().get());
+        if (sqlms == nullptr)
+            return;
+        orm::pool_stat_t pool;
+        orm::prep_stat_t prep;
+        sqlms->get_pool_stat(pool);
+        sqlms->get_prep_stat(prep);
+        uint64_t wait = pool.wait - last_wait_;
+        uint64_t wait_us = pool.wait_us - last_wait_us_;
+        mct_->log()->linfo("metastore pool: size(%llu) busy(%llu) util(%.2lf) acquire(%llu) affine(%.2lf) "
+            "wait(%llu, +%llu) avg_wait(%.1lfus, +%.1lfus) max_wait(%lluus) grow(%llu) shrink(%llu) reconnect(%llu)",
+            pool.size, pool.busy, pool.util, pool.acquire, pool.affine_rate(),
+            pool.wait, wait, pool.avg_wait_us(), wait == 0 ? 0.0 : (double)wait_us / wait,
+            pool.max_wait_us, pool.grow, pool.shrink, pool.reconnect);
+        mct_->log()->linfo("metastore prep: hit(%llu) miss(%llu) hit_rate(%.3lf) evict(%llu) cached(%llu)",
+            prep.hit, prep.miss, prep.hit_rate(), prep.evict, prep.cached);
+        last_wait_ = pool.wait;
+        last_wait_us_ = pool.wait_us;
+    }
+}; // class MgrStatWork
+
 class MgrAdminThread : public Thread {
 public:
     MgrAdminThread(Manager* mgr) : mgr_(mgr) {}
@@ -121,6 +189,8 @@ public:
         }
         mgr_->mct_->log()->linfo("start service");
         mgr_->admin_server_stat_ = mgr_->server_->run();
+        // 唤醒等待信号的主线程
+        kill(getpid(), SIGTERM);
     }
 
 private:
@@ -177,6 +247,18 @@ int Manager::init(MgrCli* mgr_cli) {
         return 8;
     }
 
+    // 初始化ChunkBalancer
+    if (!init_chkb()) {
+        mct_->log()->lerror("init chunk balancer faild");
+        return 9;
+    }
+
+    // 初始化统计信息输出
+    if (!init_stat()) {
+        mct_->log()->lerror("init stat faild");
+        return 10;
+    }
+
     return 0;
 }
 
@@ -304,6 +386,70 @@ int Manager::read_config(MgrCli* mgr_cli) {
         return 8;
     }
 
+    /**
+     * cfg_cq_threads_ / cfg_bg_cq_threads_ / cfg_handler_threads_ (可选)
+     */
+    cfg_cq_threads_ = mgr_cli->cq_threads;
+    if (!mgr_cli->cq_threads.done() && config->has_key(CFG_MGR_CQ_THREADS))
+        string_parse(cfg_cq_threads_, config->get(CFG_MGR_CQ_THREADS, ""));
+
+    cfg_bg_cq_threads_ = mgr_cli->bg_cq_threads;
+    if (!mgr_cli->bg_cq_threads.done() && config->has_key(CFG_MGR_BG_CQ_THREADS))
+        string_parse(cfg_bg_cq_threads_, config->get(CFG_MGR_BG_CQ_THREADS, ""));
+
+    cfg_handler_threads_ = mgr_cli->handler_threads;
+    if (!mgr_cli->handler_threads.done() && config->has_key(CFG_MGR_HANDLER_THREADS))
+        string_parse(cfg_handler_threads_, config->get(CFG_MGR_HANDLER_THREADS, ""));
+
+    /**
+     * cfg_balance_ (可选)
+     */
+    uint64_t blc_cycle = mgr_cli->blc_cycle;
+    if (!mgr_cli->blc_cycle.done() && config->has_key(CFG_MGR_BALANCE_CYCLE))
+        string_parse(blc_cycle, config->get(CFG_MGR_BALANCE_CYCLE, ""));
+    cfg_balance_.cycle = utime_t::get_by_msec(blc_cycle);
+
+    cfg_balance_.trigger = mgr_cli->blc_trigger;
+    if (!mgr_cli->blc_trigger.done() && config->has_key(CFG_MGR_BALANCE_TRIGGER))
+        string_parse(cfg_balance_.trigger, config->get(CFG_MGR_BALANCE_TRIGGER, ""));
+
+    cfg_balance_.release = mgr_cli->blc_release;
+    if (!mgr_cli->blc_release.done() && config->has_key(CFG_MGR_BALANCE_RELEASE))
+        string_parse(cfg_balance_.release, config->get(CFG_MGR_BALANCE_RELEASE, ""));
+
+    uint64_t blc_moves = mgr_cli->blc_moves;
+    if (!mgr_cli->blc_moves.done() && config->has_key(CFG_MGR_BALANCE_MAX_MOVES))
+        string_parse(blc_moves, config->get(CFG_MGR_BALANCE_MAX_MOVES, ""));
+    cfg_balance_.max_moves = blc_moves;
+
+    if (cfg_balance_.release > cfg_balance_.trigger) {
+        mct_->log()->lerror("invalid config[ " CFG_MGR_BALANCE_RELEASE " ], must not be greater than " CFG_MGR_BALANCE_TRIGGER);
+        return 9;
+    }
+
+    /**
+     * cfg_stat_cycle_ms_ (可选)
+     */
+    cfg_stat_cycle_ms_ = mgr_cli->stat_cycle;
+    if (!mgr_cli->stat_cycle.done() && config->has_key(CFG_MGR_STAT_CYCLE))
+        string_parse(cfg_stat_cycle_ms_, config->get(CFG_MGR_STAT_CYCLE, ""));
+
+    /**
+     * cfg_ms_conn_ / cfg_ms_max_conn_ (可选)
+     */
+    cfg_ms_conn_ = mgr_cli->ms_conn;
+    if (!mgr_cli->ms_conn.done() && config->has_key(CFG_MGR_METASTORE_CONN))
+        string_parse(cfg_ms_conn_, config->get(CFG_MGR_METASTORE_CONN, ""));
+
+    cfg_ms_max_conn_ = mgr_cli->ms_max_conn;
+    if (!mgr_cli->ms_max_conn.done() && config->has_key(CFG_MGR_METASTORE_MAX_CONN))
+        string_parse(cfg_ms_max_conn_, config->get(CFG_MGR_METASTORE_MAX_CONN, ""));
+
+    if (cfg_ms_conn_ == 0 || cfg_ms_max_conn_ < cfg_ms_conn_) {
+        mct_->log()->lerror("invalid config[ " CFG_MGR_METASTORE_CONN " ], must be positive and not greater than " CFG_MGR_METASTORE_MAX_CONN);
+        return 10;
+    }
+
     return 0;
 }
 
@@ -317,7 +463,7 @@ bool Manager::init_log(bool with_console) {
 }
 
 bool Manager::init_metastore() {
-    auto ms = create_metastore(mct_->fct(), cfg_metastore_url_);
+    auto ms = create_metastore(mct_->fct(), cfg_metastore_url_, cfg_ms_conn_, cfg_ms_max_conn_);
     if (!ms) {
         mct_->log()->lerror("create metastore with url(%s) faild", cfg_metastore_url_.c_str());
         return false;
@@ -327,7 +473,8 @@ bool Manager::init_metastore() {
 }
 
 bool Manager::init_server() {
-    server_ = new MgrServer(mct_, convert2string(cfg_addr_));
+    server_ = new MgrServer(mct_, convert2string(cfg_addr_), cfg_cq_threads_, cfg_bg_cq_threads_,
+        cfg_handler_threads_);
 
     mct_->timer(shared_ptr<TimerWorker>(new TimerWorker()));
     mct_->timer()->run();
@@ -393,6 +540,25 @@ bool Manager::init_volm() {
     return true;
 }
 
+bool Manager::init_chkb() {
+    shared_ptr<ChunkBalancer> chkb(new ChunkBalancer(
+        mct_->bct(),
+        mct_->csdm(),
+        cfg_balance_
+    ));
+    if (chkb->init() != RC_SUCCESS)
+        return false;
+    mct_->chkb(chkb);
+    return true;
+}
+
+bool Manager::init_stat() {
+    if (cfg_stat_cycle_ms_ == 0)
+        return true;
+    mct_->timer()->push_cycle(shared_ptr<WorkEntry>(new MgrStatWork(mct_, server_)), utime_t::get_by_msec(cfg_stat_cycle_ms_));
+    return true;
+}
+
 bool Manager::run_server() {
     admin_thread_.reset(new MgrAdminThread(this));
     mct_->log()->linfo("run server");
@@ -401,6 +567,16 @@ bool Manager::run_server() {
 }
 
 int Manager::wait() {
+    // SIGINT/SIGTERM在main()中被屏蔽，由主线程同步等待，收到后关闭服务
+    sigset_t sigs;
+    sigemptyset(&sigs);
+    sigaddset(&sigs, SIGINT);
+    sigaddset(&sigs, SIGTERM);
+    int sig = 0;
+    sigwait(&sigs, &sig);
+    mct_->log()->linfo("receive signal %d, shutdown", sig);
+    server_->shutdown();
+
     admin_thread_->join();
     mct_->log()->linfo("join admin_thread with: %d", admin_server_stat_);
     return 0;
@@ -419,6 +595,11 @@ int main(int argc, char** argv) {
         return 0;
     }
 
+    // 在创建任何线程之前屏蔽SIGINT/SIGTERM，由Manager::wait()处理
+    const int sigs[] = {SIGINT, SIGTERM, 0};
+    sigset_t old_sigs;
+    block_signals(sigs, &old_sigs);
+
     // 获取全局上下文
     FlameContext* fct = FlameContext::get_context();
 
@@ -14,6 +14,7 @@ namespace flame {
 class CsdManager;
 class ChunkManager;
 class VolumeManager;
+class ChunkBalancer;
 class ClusterMgmt;
 
 class MgrBaseContext {
@@ -80,12 +81,16 @@ public:
     std::shared_ptr<VolumeManager> volm() const { return volm_; }
     void volm(std::shared_ptr<VolumeManager>& volm) { volm_ = volm; }
 
+    std::shared_ptr<ChunkBalancer> chkb() const { return chkb_; }
+    void chkb(std::shared_ptr<ChunkBalancer>& chkb) { chkb_ = chkb; }
+
 private:
     MgrBaseContext* bct_;
     std::shared_ptr<CsdManager> csdm_;
     std::shared_ptr<ClusterMgmt> cltm_;
     std::shared_ptr<ChunkManager> chkm_;
     std::shared_ptr<VolumeManager> volm_;
+    std::shared_ptr<ChunkBalancer> chkb_;
 }; // class MgrContext
 
 } // namespace flame
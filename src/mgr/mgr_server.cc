@@ -1,22 +1,253 @@
 #include "mgr/mgr_server.h"
 
+#include "mgr/log_mgr.h"
+
+#include <chrono>
+
+// 关闭服务时等待在途请求完成的时间，超时后取消
+#define MGR_SHUTDOWN_WAIT_SEC   5
+
+using grpc::ServerContext;
+using grpc::ServerCompletionQueue;
+using grpc::ServerAsyncResponseWriter;
+using grpc::Status;
+
 namespace flame {
 
-// bool MgrServer::register_service(MgrService* service) {
-//     service_list_.push_back(service)
-// }
+/**
+ * @brief 在handler_pool_中执行请求
+ */
+class MgrCallWork : public WorkEntry {
+public:
+    MgrCallWork(MgrCallBase* call) : call_(call) {}
+
+    virtual void entry() override { call_->handle(); }
+
+private:
+    MgrCallBase* call_;
+}; // class MgrCallWork
+
+/**
+ * @brief 一元异步请求
+ * 状态：等待请求 => 处理并回复 => 回复完成后释放
+ * 每当一个请求到达时，在同一个CompletionQueue上重新注册一个同类请求，
+ * 因此每种请求在每个CompletionQueue上始终有一个等待接收的实例
+ */
+template<typename Service, typename Req, typename Rep, typename Impl>
+class MgrUnaryCall final : public MgrCallBase {
+public:
+    typedef void (Service::*request_fn_t)(ServerContext*, Req*, ServerAsyncResponseWriter<Rep>*,
+        grpc::CompletionQueue*, ServerCompletionQueue*, void*);
+    typedef Status (Impl::*handle_fn_t)(ServerContext*, const Req*, Rep*);
+
+    static void start(MgrServer* server, Service* service, Impl* impl,
+    ServerCompletionQueue* cq, int prio, request_fn_t req_fn, handle_fn_t hdl_fn) {
+        new MgrUnaryCall(server, service, impl, cq, prio, req_fn, hdl_fn);
+    }
+
+    virtual void proceed(bool ok) override {
+        if (stat_ == CALL_STAT_WAIT) {
+            if (!ok) {
+                // CompletionQueue已关闭
+                delete this;
+                return;
+            }
+            {
+                ReadLocker locker(server_->call_lock_);
+                if (!server_->shutdown_)
+                    start(server_, service_, impl_, cq_, prio_, req_fn_, hdl_fn_);
+            }
+
+            stat_ = CALL_STAT_FINISH;
+            // 控制请求可能阻塞，交给handler_pool_执行；关闭过程中直接执行
+            if (prio_ == MGR_CALL_CTRL
+              && server_->handler_pool_.push(std::shared_ptr<WorkEntry>(new MgrCallWork(this))))
+                return;
+            handle();
+        } else {
+            delete this;
+        }
+    }
+
+    virtual void handle() override {
+        Status s = (impl_->*hdl_fn_)(&ctx_, &req_, &rep_);
+        server_->handled_[prio_]++;
+        responder_.Finish(rep_, s, this);
+    }
+
+private:
+    enum {
+        CALL_STAT_WAIT,
+        CALL_STAT_FINISH
+    };
+
+    MgrUnaryCall(MgrServer* server, Service* service, Impl* impl,
+    ServerCompletionQueue* cq, int prio, request_fn_t req_fn, handle_fn_t hdl_fn)
+    : server_(server), service_(service), impl_(impl), cq_(cq), prio_(prio),
+      req_fn_(req_fn), hdl_fn_(hdl_fn), responder_(&ctx_) {
+        (service_->*req_fn_)(&ctx_, &req_, &responder_, cq_, cq_, this);
+    }
+
+    MgrServer* server_;
+    Service* service_;
+    Impl* impl_;
+    ServerCompletionQueue* cq_;
+    int prio_;
+    request_fn_t req_fn_;
+    handle_fn_t hdl_fn_;
+    int stat_ {CALL_STAT_WAIT};
+
+    ServerContext ctx_;
+    Req req_;
+    Rep rep_;
+    ServerAsyncResponseWriter<Rep> responder_;
+}; // class MgrUnaryCall
+
+#define MGR_FLAME_CALL(cq, prio, method, Req, Rep) \
+    MgrUnaryCall<FlameService::AsyncService, Req, Rep, service::FlameServiceImpl>::start( \
+        this, &flame_async_, &flame_service_, cq, prio, \
+        &FlameService::AsyncService::Request##method, &service::FlameServiceImpl::method)
+
+#define MGR_INTERNAL_CALL(cq, prio, method, Req, Rep) \
+    MgrUnaryCall<InternalService::AsyncService, Req, Rep, service::InternalServiceImpl>::start( \
+        this, &internal_async_, &internal_service_, cq, prio, \
+        &InternalService::AsyncService::Request##method, &service::InternalServiceImpl::method)
 
 int MgrServer::run() {
     server_ = builder_.BuildAndStart();
+    if (!server_) {
+        mct_->log()->lerror("build mgr server on %s faild", addr_.c_str());
+        return -1;
+    }
+
+    handler_pool_.start();
+    for (int p = 0; p < MGR_CALL_PRIO_NUM; p++) {
+        for (auto it = cqs_[p].begin(); it != cqs_[p].end(); it++) {
+            ServerCompletionQueue* cq = it->get();
+            __request_all(cq, p);
+            threads_.emplace_back([this, cq, p] () { __poll(cq, p); });
+        }
+    }
+
+    mct_->log()->linfo("mgr server listen on %s: ctrl cq(%llu), bg cq(%llu), handler(%llu)", addr_.c_str(),
+        cqs_[MGR_CALL_CTRL].size(), cqs_[MGR_CALL_BG].size(), handler_pool_.thread_num());
+
     server_->Wait();
+
+    // Wait()返回时Server已经关闭，还需要关闭CompletionQueue，轮询线程才会退出
+    shutdown();
+    for (auto it = threads_.begin(); it != threads_.end(); it++)
+        it->join();
+    threads_.clear();
     return 0;
 }
 
-void MgrServer::__init() {
+void MgrServer::shutdown() {
+    {
+        WriteLocker locker(call_lock_);
+        if (shutdown_)
+            return;
+        shutdown_ = true;
+    }
+
+    if (server_)
+        server_->Shutdown(std::chrono::system_clock::now() + std::chrono::seconds(MGR_SHUTDOWN_WAIT_SEC));
+
+    // 执行中的请求回复后再关闭CompletionQueue
+    handler_pool_.stop();
+
+    // 必须在Server关闭之后关闭CompletionQueue
+    for (int p = 0; p < MGR_CALL_PRIO_NUM; p++) {
+        for (auto it = cqs_[p].begin(); it != cqs_[p].end(); it++)
+            (*it)->Shutdown();
+    }
+}
+
+void MgrServer::log_stat() {
+    uint64_t handled[MGR_CALL_PRIO_NUM];
+    for (int p = 0; p < MGR_CALL_PRIO_NUM; p++)
+        handled[p] = handled_[p].load();
+    mct_->log()->linfo("mgr server handled: ctrl(%llu, +%llu) bg(%llu, +%llu)",
+        handled[MGR_CALL_CTRL], handled[MGR_CALL_CTRL] - last_handled_[MGR_CALL_CTRL],
+        handled[MGR_CALL_BG], handled[MGR_CALL_BG] - last_handled_[MGR_CALL_BG]);
+    for (int p = 0; p < MGR_CALL_PRIO_NUM; p++)
+        last_handled_[p] = handled[p];
+}
+
+void MgrServer::__init(int cq_threads, int bg_cq_threads) {
+    if (cq_threads <= 0)
+        cq_threads = std::thread::hardware_concurrency();
+    if (cq_threads <= 0)
+        cq_threads = 1;
+    if (bg_cq_threads <= 0)
+        bg_cq_threads = 1;
+
+    for (int p = 0; p < MGR_CALL_PRIO_NUM; p++) {
+        handled_[p] = 0;
+        last_handled_[p] = 0;
+    }
+
     builder_.AddListeningPort(addr_, grpc::InsecureServerCredentials());
 
-    builder_.RegisterService(&flame_service_);
-    builder_.RegisterService(&internal_service_);
+    builder_.RegisterService(&flame_async_);
+    builder_.RegisterService(&internal_async_);
+
+    // 每个轮询线程独占一个CompletionQueue
+    for (int i = 0; i < cq_threads; i++)
+        cqs_[MGR_CALL_CTRL].push_back(builder_.AddCompletionQueue());
+    for (int i = 0; i < bg_cq_threads; i++)
+        cqs_[MGR_CALL_BG].push_back(builder_.AddCompletionQueue());
+}
+
+void MgrServer::__request_all(ServerCompletionQueue* cq, int prio) {
+    if (prio == MGR_CALL_BG) {
+        MGR_INTERNAL_CALL(cq, prio, pushHeartBeat, HeartBeatRequest, InternalReply);
+        MGR_INTERNAL_CALL(cq, prio, pushStatus, StatusRequest, InternalReply);
+        MGR_INTERNAL_CALL(cq, prio, pushHealth, HealthRequest, InternalReply);
+        MGR_INTERNAL_CALL(cq, prio, pushReport, ReportRequest, ReportReply);
+        return;
+    }
+
+    // InternalService
+    MGR_INTERNAL_CALL(cq, prio, registerCsd, RegisterRequest, RegisterReply);
+    MGR_INTERNAL_CALL(cq, prio, unregisterCsd, UnregisterRequest, InternalReply);
+    MGR_INTERNAL_CALL(cq, prio, signUp, SignUpRequest, InternalReply);
+    MGR_INTERNAL_CALL(cq, prio, signOut, SignOutRequest, InternalReply);
+    MGR_INTERNAL_CALL(cq, prio, pullRelatedChunk, ChunkPullRequest, ChunkPullReply);
+    MGR_INTERNAL_CALL(cq, prio, pushChunkStatus, ChunkPushRequest, InternalReply);
+
+    // FlameService
+    MGR_FLAME_CALL(cq, prio, connect, ConnectRequest, FlameReply);
+    MGR_FLAME_CALL(cq, prio, disconnect, DisconnectRequest, FlameReply);
+    MGR_FLAME_CALL(cq, prio, getClusterInfo, NoneRequest, ClusterInfoReply);
+    MGR_FLAME_CALL(cq, prio, shutdownCluster, NoneRequest, FlameReply);
+    MGR_FLAME_CALL(cq, prio, cleanCluster, NoneRequest, FlameReply);
+    MGR_FLAME_CALL(cq, prio, pullCsdAddr, CsdIDListRequest, CsdAddrListReply);
+    MGR_FLAME_CALL(cq, prio, getVolGroupList, VGListRequest, VGListReply);
+    MGR_FLAME_CALL(cq, prio, createVolGroup, VGCreateRequest, FlameReply);
+    MGR_FLAME_CALL(cq, prio, removeVolGroup, VGRemoveRequest, FlameReply);
+    MGR_FLAME_CALL(cq, prio, renameVolGroup, VGRenameRequest, FlameReply);
+    MGR_FLAME_CALL(cq, prio, getVolumeList, VolListRequest, VolListReply);
+    MGR_FLAME_CALL(cq, prio, createVolume, VolCreateRequest, FlameReply);
+    MGR_FLAME_CALL(cq, prio, removeVolume, VolRemoveRequest, FlameReply);
+    MGR_FLAME_CALL(cq, prio, renameVolume, VolRenameRequest, FlameReply);
+    MGR_FLAME_CALL(cq, prio, getVolumeInfo, VolInfoRequest, VolInfoReply);
+    MGR_FLAME_CALL(cq, prio, resizeVolume, VolResizeRequest, FlameReply);
+    MGR_FLAME_CALL(cq, prio, setQos, QosRequest, FlameReply);
+    MGR_FLAME_CALL(cq, prio, openVolume, VolOpenRequest, FlameReply);
+    MGR_FLAME_CALL(cq, prio, closeVolume, VolCloseRequest, FlameReply);
+    MGR_FLAME_CALL(cq, prio, lockVolume, VolLockRequest, FlameReply);
+    MGR_FLAME_CALL(cq, prio, unlockVolume, VolUnlockRequest, FlameReply);
+    MGR_FLAME_CALL(cq, prio, getVolumeMaps, VolMapsRequest, VolMapsReply);
+    MGR_FLAME_CALL(cq, prio, getChunkMaps, ChunkMapsRequest, ChunkMapsReply);
+}
+
+void MgrServer::__poll(ServerCompletionQueue* cq, int prio) {
+    void* tag;
+    bool ok;
+    while (cq->Next(&tag, &ok)) {
+        static_cast<MgrCallBase*>(tag)->proceed(ok);
+    }
 }
 
-} // namespace flame
\ No newline at end of file
+} // namespace flame
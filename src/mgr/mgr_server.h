@@ -2,9 +2,14 @@
 #define FLAME_SERVICE_MGR_SERVER_H
 
 #include "mgr_context.h"
+#include "work/work_pool.h"
+#include "common/thread/rw_lock.h"
 
 #include <grpcpp/grpcpp.h>
 #include <memory>
+#include <vector>
+#include <thread>
+#include <atomic>
 #include <list>
 
 #include "service/flame_service.h"
@@ -12,33 +17,122 @@
 
 namespace flame {
 
+/**
+ * @brief 请求优先级
+ * 不同优先级的请求注册在不同的CompletionQueue上，由独立的线程轮询，
+ * 保证客户端控制请求不会排在CSD心跳/健康信息汇报之后
+ */
+enum MgrCallPriority {
+    MGR_CALL_CTRL = 0,  // 客户端控制请求、CSD注册/上下线、Chunk状态
+    MGR_CALL_BG   = 1,  // 心跳、状态与健康信息汇报
+    MGR_CALL_PRIO_NUM
+};
+
+/**
+ * @brief 异步请求的基类，作为CompletionQueue的tag使用
+ */
+class MgrCallBase {
+public:
+    virtual ~MgrCallBase() {}
+
+    /**
+     * @brief 驱动请求状态机
+     *
+     * @param ok CompletionQueue::Next()返回的ok
+     */
+    virtual void proceed(bool ok) = 0;
+
+    /**
+     * @brief 执行请求并回复，控制请求在MgrServer的handler_pool_中执行
+     */
+    virtual void handle() = 0;
+
+protected:
+    MgrCallBase() {}
+}; // class MgrCallBase
+
 class MgrServer {
 public:
-    MgrServer(MgrContext* mct, const std::string& addr) 
-    : mct_(mct), addr_(addr), flame_service_(mct), internal_service_(mct) { 
-        __init(); 
+    /**
+     * @param mct
+     * @param addr
+     * @param cq_threads 控制请求的轮询线程数，0表示与CPU核数相同
+     * @param bg_cq_threads 后台请求（心跳、健康信息）的轮询线程数
+     * @param handler_threads 执行控制请求的线程数，控制请求可能阻塞在MetaStore或CSD上，
+     *  不在轮询线程中执行
+     */
+    MgrServer(MgrContext* mct, const std::string& addr, int cq_threads = 0, int bg_cq_threads = 1,
+        int handler_threads = 16)
+    : mct_(mct), addr_(addr), flame_service_(mct), internal_service_(mct),
+      handler_pool_("mgr_handler", handler_threads > 0 ? handler_threads : 1) {
+        __init(cq_threads, bg_cq_threads);
     }
 
-    ~MgrServer() {}
+    ~MgrServer() { shutdown(); }
 
     std::string get_addr() const { return addr_; }
     void set_addr(const std::string& addr) { addr_ = addr; }
-    
+
+    /**
+     * @brief 启动服务并阻塞，直到服务关闭
+     *
+     * @return int
+     */
     int run();
 
+    /**
+     * @brief 关闭服务，可以在任意非轮询、非控制请求线程中调用
+     * run()返回前也会调用
+     */
+    void shutdown();
+
+    uint64_t handled(int prio) const { return handled_[prio].load(); }
+
+    /**
+     * @brief 将各优先级已处理的请求数写入日志
+     */
+    void log_stat();
+
 private:
-    void __init();
+    void __init(int cq_threads, int bg_cq_threads);
+
+    /**
+     * @brief 在指定的CompletionQueue上注册所有可接收的请求
+     *
+     * @param cq
+     * @param prio
+     */
+    void __request_all(grpc::ServerCompletionQueue* cq, int prio);
+
+    void __poll(grpc::ServerCompletionQueue* cq, int prio);
 
     MgrContext* mct_;
     std::string addr_;
 
+    // 业务逻辑仍然由同步接口实现，异步框架只负责调度
     service::FlameServiceImpl flame_service_;
     service::InternalServiceImpl internal_service_;
 
+    FlameService::AsyncService flame_async_;
+    InternalService::AsyncService internal_async_;
+
     grpc::ServerBuilder builder_;
     std::unique_ptr<grpc::Server> server_;
+
+    std::vector<std::unique_ptr<grpc::ServerCompletionQueue>> cqs_[MGR_CALL_PRIO_NUM];
+    std::vector<std::thread> threads_;
+    WorkPool handler_pool_;
+    // 重新注册请求时持读锁，关闭CompletionQueue前持写锁设置shutdown_，
+    // 保证CompletionQueue关闭后不会再注册请求
+    RWLock call_lock_;
+    bool shutdown_ {false};
+    std::atomic<uint64_t> handled_[MGR_CALL_PRIO_NUM];
+    uint64_t last_handled_[MGR_CALL_PRIO_NUM];
+
+    template<typename Service, typename Req, typename Rep, typename Impl>
+    friend class MgrUnaryCall;
 }; // class MgrServer
 
 } // namespace flame
 
-#endif // FLAME_SERVICE_MGR_SERVER_H
\ No newline at end of file
+#endif // FLAME_SERVICE_MGR_SERVER_H
@@ -12,6 +12,9 @@ namespace flame {
 int VolumeManager::init() {
     int r;
     r = init_vg__();
+    if (r != RC_SUCCESS) 
+        return r;
+    r = init_qos__();
     if (r != RC_SUCCESS) 
         return r;
     return RC_SUCCESS;
@@ -294,6 +297,135 @@ int VolumeManager::vol_unlock(uint64_t gw_id, const std::string& vg_name, const
     return RC_FAILD;
 }
 
+/**
+ * QoS
+ */
+int VolumeManager::vol_set_qos(const std::string& vg_name, const std::string& vol_name, const qos_attr_t& attr) {
+    volume_meta_t vol;
+    int r = vol_info(vol, vg_name, vol_name);
+    if (r != RC_SUCCESS)
+        return r;
+
+    qos_attr_t qos = attr;
+    qos.type = QOS_TYPE_VOL;
+    qos.id = vol.vol_id;
+    return qos_set__(qos);
+}
+
+int VolumeManager::client_set_qos(uint64_t gw_id, const qos_attr_t& attr) {
+    qos_attr_t qos = attr;
+    qos.type = QOS_TYPE_CLIENT;
+    qos.id = gw_id;
+    return qos_set__(qos);
+}
+
+int VolumeManager::qos_sync(uint64_t csd_id) {
+    MutexLocker push_locker(qos_push_lock_);
+    list<qos_attr_t> attr_list;
+    {
+        MutexLocker locker(qos_lock_);
+        for (auto it = qos_map_.begin(); it != qos_map_.end(); it++)
+            attr_list.push_back(it->second);
+    }
+    if (attr_list.empty())
+        return RC_SUCCESS;
+
+    CsdHandle* hdl = csdm_->find(csd_id);
+    if (hdl == nullptr)
+        return RC_OBJ_NOT_FOUND;
+    return qos_push__(attr_list, csd_id, hdl->get_client());
+}
+
+static bool qos_cleared(const qos_attr_t& attr) {
+    return attr.rsv_iops == 0 && attr.lim_iops == 0 && attr.lim_bps == 0 && attr.weight <= 1;
+}
+
+int VolumeManager::qos_set__(const qos_attr_t& attr) {
+    bct_->log()->linfo("set qos type(%u) id(%llu): rsv_iops(%llu) lim_iops(%llu) lim_bps(%llu) weight(%u)",
+        attr.type, attr.id, attr.rsv_iops, attr.lim_iops, attr.lim_bps, attr.weight);
+
+    auto key = make_pair(attr.type, attr.id);
+    {
+        MutexLocker locker(qos_lock_);
+        int r;
+        if (qos_cleared(attr))
+            r = unique_ptr<QosMS>(ms_->get_qos_ms())->remove(attr.type, attr.id);
+        else
+            r = unique_ptr<QosMS>(ms_->get_qos_ms())->save(attr);
+        if (r != RC_SUCCESS) {
+            bct_->log()->lerror("persist qos type(%u) id(%llu) faild: %d", attr.type, attr.id, r);
+            return r;
+        }
+        if (qos_cleared(attr))
+            qos_map_.erase(key);
+        else
+            qos_map_[key] = attr;
+    }
+
+    // 推送时不持有qos_lock_和CSD表的锁，避免RPC阻塞其它请求
+    // 推送的是取得qos_push_lock_后的最新设置，并发设置时各CSD最终一致
+    MutexLocker push_locker(qos_push_lock_);
+    list<qos_attr_t> attr_list;
+    {
+        MutexLocker locker(qos_lock_);
+        auto it = qos_map_.find(key);
+        if (it != qos_map_.end()) {
+            attr_list.push_back(it->second);
+        } else {
+            qos_attr_t cleared;
+            cleared.type = attr.type;
+            cleared.id = attr.id;
+            attr_list.push_back(cleared);
+        }
+    }
+
+    list<pair<uint64_t, shared_ptr<CsdsClient>>> clients;
+    {
+        ReadLocker map_locker(csdm_->get_lock());
+        for (auto it = csdm_->csd_hdl_begin(); it != csdm_->csd_hdl_end(); it++) {
+            CsdHandle* hdl = it->second;
+            if (hdl == nullptr || !hdl->is_active())
+                continue;
+            clients.push_back(make_pair(it->first, hdl->get_client()));
+        }
+    }
+
+    int r = RC_SUCCESS;
+    for (auto it = clients.begin(); it != clients.end(); it++) {
+        // 推送失败的CSD在重新上线时通过qos_sync()补齐
+        if (qos_push__(attr_list, it->first, it->second) != RC_SUCCESS)
+            r = RC_FAILD;
+    }
+    return r;
+}
+
+int VolumeManager::qos_push__(const list<qos_attr_t>& attr_list, uint64_t csd_id, 
+    const shared_ptr<CsdsClient>& client) {
+    if (!client) {
+        bct_->log()->lerror("connect to csd (%llu) faild", csd_id);
+        return RC_FAILD;
+    }
+    int r = client->qos_set(attr_list);
+    if (r != RC_SUCCESS)
+        bct_->log()->lerror("push qos to csd (%llu) faild: %d", csd_id, r);
+    return r;
+}
+
+int VolumeManager::init_qos__() {
+    list<qos_attr_t> attrs;
+    int r = unique_ptr<QosMS>(ms_->get_qos_ms())->list_all(attrs);
+    if (r != RC_SUCCESS) {
+        bct_->log()->lerror("init qos faild");
+        return r;
+    }
+
+    MutexLocker locker(qos_lock_);
+    for (auto it = attrs.begin(); it != attrs.end(); ++it)
+        qos_map_[make_pair(it->type, it->id)] = *it;
+
+    return RC_SUCCESS;
+}
+
 volume_group_meta_t* VolumeManager::get_vg__(uint64_t vg_id) {
     return &vg_map_[vg_id];
 }
@@ -6,6 +6,7 @@
 #include "mgr/csdm/csd_mgmt.h"
 #include "mgr/chkm/chk_mgmt.h"
 #include "spolicy/spolicy.h"
+#include "common/thread/mutex.h"
 
 #include <cstdint>
 #include <atomic>
@@ -53,6 +54,21 @@ public:
     int vol_lock(uint64_t gw_id, const std::string& vg_name, const std::string& vol_name);
     int vol_unlock(uint64_t gw_id, const std::string& vg_name, const std::string& vol_name);
 
+    /**
+     * QoS
+     * 设置持久化到MetaStore并缓存在MGR内存中，推送给所有在线的CSD，由CSD在IO调度时执行
+     */
+    int vol_set_qos(const std::string& vg_name, const std::string& vol_name, const qos_attr_t& attr);
+    int client_set_qos(uint64_t gw_id, const qos_attr_t& attr);
+
+    /**
+     * @brief 向（重新）上线的CSD推送全部QoS设置
+     * 
+     * @param csd_id 
+     * @return int RC_SUCCESS iff success
+     */
+    int qos_sync(uint64_t csd_id);
+
 private:
     MgrBaseContext* bct_;
     std::shared_ptr<MetaStore> ms_;
@@ -76,6 +92,19 @@ private:
     int vg_sub_vol__(uint64_t vg_id, uint64_t sz);
 
     int init_vg__();
+
+    /**
+     * QoS
+     */
+    std::map<std::pair<uint32_t, uint64_t>, qos_attr_t> qos_map_;
+    Mutex qos_lock_;
+    // 串行化向CSD的推送，保证各CSD上的设置顺序与MGR一致；先于qos_lock_获取
+    Mutex qos_push_lock_;
+
+    int init_qos__();
+    int qos_set__(const qos_attr_t& attr);
+    int qos_push__(const std::list<qos_attr_t>& attr_list, uint64_t csd_id, 
+        const std::shared_ptr<CsdsClient>& client);
 }; // class VolumeManager
 
 } // namespace flame
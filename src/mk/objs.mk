@@ -14,6 +14,7 @@ $(DCOMMON)/log.o \
 $(DCOMMON)/config.o \
 $(DCOMMON)/cmdline.o \
 $(DCOMMON)/convert.o \
+$(DCOMMON)/hlt_codec.o \
 $(DCOMMON)/thread/mutex.o \
 $(DCOMMON)/thread/thread.o \
 $(DCOMMON)/thread/signal.o \
@@ -40,7 +41,10 @@ $(DSERVICE)/csds_client.o
 # /orm
 OBJ_ORM = \
 $(DORM)/stmt.o \
+$(DORM)/prep.o \
+$(DORM)/pool.o \
 $(DORM)/my_impl/my_impl.o \
+$(DORM)/sqlite_impl/sqlite_impl.o \
 $(DORM)/engine.o
 
 # /metastore
@@ -68,7 +72,8 @@ $(DCHUNKSTORE)/cs.o
 
 # /work
 OBJ_WORK = \
-$(DWORK)/timer_work.o
+$(DWORK)/timer_work.o \
+$(DWORK)/work_pool.o
 
 # /cluster
 OBJ_CLUSTER = \
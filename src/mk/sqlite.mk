@@ -0,0 +1 @@
+SQLITE_CFLAGS = -lsqlite3
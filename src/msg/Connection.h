@@ -17,12 +17,32 @@ namespace msg{
 
 class Session;
 
+/**
+ * 连接的累计负载，由所属工作线程写入，可以在任意线程读取
+ * MsgManager定期采样，计算各工作线程的负载
+ */
+struct conn_load_t{
+    std::atomic<uint64_t> rx_bytes{0};
+    std::atomic<uint64_t> tx_bytes{0};
+    std::atomic<uint64_t> rx_msgs{0};
+    std::atomic<uint64_t> tx_msgs{0};
+    //* 回调的TSC耗时，工作线程独占CPU核时即为CPU时间
+    std::atomic<uint64_t> cpu_cycles{0};
+};
+
 class Connection : public EventCallBack{
     conn_id_t conn_id;
     Session *session;
-    MsgWorker *owner;
+    //* 连接迁移时由原工作线程修改
+    std::atomic<MsgWorker *> owner;
     ConnectionListener *m_listener;
     std::atomic<bool> submit_pending;
+    conn_load_t load;
+
+    static void add_load(std::atomic<uint64_t> &counter, uint64_t v){
+        counter.store(counter.load(std::memory_order_relaxed) + v,
+                                                std::memory_order_relaxed);
+    }
 public:
     explicit Connection(MsgContext *c)
     :EventCallBack(c, FLAME_EVENT_READABLE | FLAME_EVENT_WRITABLE),
@@ -64,9 +84,10 @@ public:
     }
 
     virtual void post_submit() {
-        if(submit_pending || !owner) return;
+        MsgWorker *worker = owner;
+        if(submit_pending || !worker) return;
         submit_pending = true;
-        owner->post_work([this](){
+        worker->post_work([this](){
             ML(this->mct, trace, "in post_submit()");
             submit_pending = false;
             this->send_msg(nullptr, false);
@@ -117,6 +138,26 @@ public:
         return this->owner;
     }
 
+    /**
+     * @brief 统计接收/发送的数据与占用的CPU
+     * 只能在所属工作线程中调用
+     */
+    void account_rx(uint64_t bytes, uint64_t msgs){
+        add_load(load.rx_bytes, bytes);
+        add_load(load.rx_msgs, msgs);
+    }
+    void account_tx(uint64_t bytes, uint64_t msgs){
+        add_load(load.tx_bytes, bytes);
+        add_load(load.tx_msgs, msgs);
+    }
+    void account_cpu(uint64_t cycles){
+        add_load(load.cpu_cycles, cycles);
+    }
+
+    const conn_load_t &get_load() const {
+        return this->load;
+    }
+
     void set_listener(ConnectionListener *listener){
         this->m_listener = listener;
     }
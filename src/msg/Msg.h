@@ -194,6 +194,13 @@ public:
         return (this->type == FLAME_MSG_TYPE_IMM_DATA);
     }
 
+    /**
+     * @brief 消息类型是否为条带化消息的分片
+     */
+    bool is_stripe() const{
+        return (this->type == FLAME_MSG_TYPE_STRIPE);
+    }
+
     /**
      * @brief 消息类型是否为无操作
      */
@@ -235,6 +242,14 @@ public:
         return (this->flag & FLAME_MSG_FLAG_WITH_IMM);
     }
 
+    /**
+     * @brief 消息是否允许与同一连接上的其他消息乱序
+     * 只有这样的消息才会通过rdma_srq_size_classes的lane发送
+     */
+    bool is_unordered() const {
+        return (this->flag & FLAME_MSG_FLAG_UNORDERED);
+    }
+
     /**
      * @brief 消息是否包含RDMA头部
      * 是否需要进行自动的RDMA传输(原来是这么设计的，不过自动部分尚未实现)
@@ -283,6 +298,7 @@ public:
         case FLAME_MSG_TYPE_IO:            return "TYPE_IO";
         case FLAME_MSG_TYPE_DECLARE_ID:    return "TYPE_DECLARE_ID";
         case FLAME_MSG_TYPE_IMM_DATA:      return "TYPE_IMM_DATA";
+        case FLAME_MSG_TYPE_STRIPE:        return "TYPE_STRIPE";
         default:                           return "TYPE_INVALID";
         }
     }
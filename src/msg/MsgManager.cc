@@ -5,6 +5,7 @@
 #include "msg_types.h"
 #include "Stack.h"
 #include "socket/TcpStack.h"
+#include "util/cycles.h"
 
 #ifdef HAVE_RDMA
     #include "rdma/RdmaStack.h"
@@ -14,11 +15,17 @@
     #include "spdk/SpdkMsgWorker.h"
 #endif 
 
+//* 最重的工作线程负载低于此值(核数)时不迁移，避免空闲时来回迁移
+#define FLAME_MSG_REBALANCE_MIN_LOAD 0.05
+//* 连接迁移后，此后若干周期内不再迁移
+#define FLAME_MSG_REBALANCE_COOLDOWN 3
+
 namespace flame{
 namespace msg{
 
 MsgManager::MsgManager(MsgContext *c, int worker_num)
-: mct(c), is_running(false), m_mutex(MUTEX_TYPE_ADAPTIVE_NP){
+: mct(c), is_running(false), m_mutex(MUTEX_TYPE_ADAPTIVE_NP),
+  balance_mutex(MUTEX_TYPE_ADAPTIVE_NP), last_balance_cycles(0){
     workers.reserve(worker_num);
     for(int i = 0;i < worker_num; ++i){
         MsgWorker *msg_worker = nullptr;
@@ -32,12 +39,207 @@ MsgManager::MsgManager(MsgContext *c, int worker_num)
             msg_worker = new ThrMsgWorker(mct, i);
         }
         workers.push_back(msg_worker);
-        if(!mct->config->msg_worker_cpu_map.empty()){
+        if((size_t)i < mct->config->msg_worker_cpu_map.size()){
             int cpu_id = mct->config->msg_worker_cpu_map[i];
             workers[i]->set_affinity(cpu_id);
             ML(mct, info, "bind thr{} to cpu{}", i, cpu_id);
+        }else if(workers[i]->type() == msg_worker_type_t::THREAD
+            && mct->config->msg_worker_poll_mode != msg_worker_poll_mode_t::BLOCK){
+            ML(mct, warn, "spinning thr{} is not pinned by msg_worker_cpu_map",
+                                                                            i);
+        }
+    }
+}
+
+void MsgManager::log_worker_stat(){
+    for(auto worker : workers){
+        msg_worker_stat_t stat;
+        if(worker->get_stat(stat) < 0) continue;
+        ML(mct, info, "{} cpu:{:.1f}% busy:{:.1f}% spin:{}ms sleep:{}ms "
+            "sleeps:{} wakeups:{} handoff avg:{:.0f}ns max:{}ns",
+            worker->get_name(), stat.cpu_util() * 100, stat.busy_util() * 100,
+            stat.spin_ns / 1000000, stat.sleep_ns / 1000000, stat.sleeps,
+            stat.wakeups, stat.avg_handoff_ns(), stat.handoff_max_ns);
+    }
+
+    msg_balance_stat_t bstat;
+    get_balance_stat(bstat);
+    if(bstat.rounds == 0) return;
+    for(size_t i = 0;i < bstat.loads.size() && i < workers.size(); ++i){
+        auto &load = bstat.loads[i];
+        ML(mct, info, "{} conns:{} load cpu:{:.1f}% {:.2f}MB/s {:.0f}msg/s",
+            workers[i]->get_name(), load.conns, load.cpu * 100,
+            load.bytes_per_sec / (1 << 20), load.msgs_per_sec);
+    }
+    ML(mct, info, "balance rounds:{} imbalanced:{} imbalance:{:.2f} "
+        "migrations:{} migrate_faild:{}", bstat.rounds, bstat.imbalanced,
+        bstat.imbalance, bstat.migrations, bstat.migrate_faild);
+}
+
+void MsgManager::get_balance_stat(msg_balance_stat_t &stat){
+    MutexLocker l(balance_mutex);
+    stat = balance_stat;
+}
+
+int MsgManager::rebalance(){
+    MutexLocker l(balance_mutex);
+    uint64_t now = get_cycles();
+    double sec = cycles_to_nsec(now - last_balance_cycles) / 1e9;
+    last_balance_cycles = now;
+    uint64_t round = ++balance_stat.rounds;
+    if(sec <= 0) return 0;
+
+    std::vector<msg_worker_load_t> loads(workers.size());
+    std::vector<std::vector<std::pair<double, Connection *>>> 
+                                                movable(workers.size());
+    for(auto &pair : conn_samples){
+        Connection *conn = pair.first;
+        conn_sample_t &sample = pair.second;
+        const conn_load_t &load = conn->get_load();
+        uint64_t rx_bytes = load.rx_bytes.load(std::memory_order_relaxed);
+        uint64_t tx_bytes = load.tx_bytes.load(std::memory_order_relaxed);
+        uint64_t rx_msgs = load.rx_msgs.load(std::memory_order_relaxed);
+        uint64_t tx_msgs = load.tx_msgs.load(std::memory_order_relaxed);
+        uint64_t cpu_cycles = load.cpu_cycles.load(std::memory_order_relaxed);
+        double cpu = cycles_to_nsec(cpu_cycles - sample.cpu_cycles) / 1e9 / sec;
+        double bytes = (rx_bytes - sample.rx_bytes + tx_bytes 
+                                                    - sample.tx_bytes) / sec;
+        double msgs = (rx_msgs - sample.rx_msgs + tx_msgs 
+                                                    - sample.tx_msgs) / sec;
+        sample.rx_bytes = rx_bytes;
+        sample.tx_bytes = tx_bytes;
+        sample.rx_msgs = rx_msgs;
+        sample.tx_msgs = tx_msgs;
+        sample.cpu_cycles = cpu_cycles;
+
+        MsgWorker *owner = conn->get_owner();
+        if(!owner) continue;
+        int i = owner->get_id();
+        if(i < 0 || (size_t)i >= workers.size() || workers[i] != owner){
+            continue;
         }
+        ++loads[i].conns;
+        loads[i].cpu += cpu;
+        loads[i].bytes_per_sec += bytes;
+        loads[i].msgs_per_sec += msgs;
+        if(conn->has_fd() && !conn->is_owner_fixed() 
+            && owner->type() == msg_worker_type_t::THREAD
+            && round >= sample.movable_round){
+            movable[i].push_back(std::make_pair(cpu, conn));
+        }
+    }
+
+    int max = 0, min = 0;
+    double total = 0;
+    for(int i = 0;i < (int)loads.size(); ++i){
+        total += loads[i].cpu;
+        if(loads[i].cpu > loads[max].cpu) max = i;
+        if(loads[i].cpu < loads[min].cpu) min = i;
+    }
+    double avg = loads.empty() ? 0 : total / loads.size();
+    balance_stat.imbalance = avg > 0 ? loads[max].cpu / avg : 0;
+    balance_stat.loads.swap(loads);
+    auto &cur = balance_stat.loads;
+    if(max == min || cur[max].cpu < FLAME_MSG_REBALANCE_MIN_LOAD
+        || balance_stat.imbalance < mct->config->msg_worker_imbalance_ratio){
+        return 0;
+    }
+    ++balance_stat.imbalanced;
+
+    //* 迁移超过差值一半的连接只会让最轻的线程变成最重的
+    double limit = (cur[max].cpu - cur[min].cpu) / 2;
+    Connection *victim = nullptr;
+    double victim_cpu = 0;
+    for(auto &pair : movable[max]){
+        if(pair.first > victim_cpu && pair.first <= limit){
+            victim_cpu = pair.first;
+            victim = pair.second;
+        }
+    }
+    if(!victim){
+        ML(mct, debug, "{} overloaded ({:.1f}%), but no conn to migrate",
+                            workers[max]->get_name(), cur[max].cpu * 100);
+        return 0;
     }
+    ML(mct, info, "migrate {} ({:.1f}%) from {} ({:.1f}%) to {} ({:.1f}%)",
+        victim->to_string(), victim_cpu * 100, 
+        workers[max]->get_name(), cur[max].cpu * 100,
+        workers[min]->get_name(), cur[min].cpu * 100);
+    return post_migration(victim, workers[max], workers[min]) == 0 ? 1 : 0;
+}
+
+int MsgManager::migrate_conn(Connection *conn, MsgWorker *to){
+    if(!conn || !to) return -1;
+    MutexLocker l(balance_mutex);
+    if(conn_samples.find(conn) == conn_samples.end()) return -1;
+    MsgWorker *from = conn->get_owner();
+    if(!from || from == to || !conn->has_fd() || conn->is_owner_fixed()
+        || from->type() != msg_worker_type_t::THREAD){
+        return -1;
+    }
+    return post_migration(conn, from, to);
+}
+
+int MsgManager::post_migration(Connection *conn, MsgWorker *from, 
+                                                                MsgWorker *to){
+    if(to->type() != msg_worker_type_t::THREAD) return -1;
+    conn->get();
+    from->post_work([this, conn, from, to](){
+        this->do_migration(conn, from, to);
+        conn->put();
+    });
+    return 0;
+}
+
+void MsgManager::do_migration(Connection *conn, MsgWorker *from, 
+                                                                MsgWorker *to){
+    assert(from->am_self());
+    MutexLocker l(balance_mutex);
+    //* 投递后连接可能已被del_conn()删除，或已经迁移
+    auto it = conn_samples.find(conn);
+    if(it == conn_samples.end() || conn->get_owner() != from 
+        || !conn->is_connected()){
+        ++balance_stat.migrate_faild;
+        return;
+    }
+    //* 此时不在连接的回调中，先修改owner，新线程的回调才能通过am_self()检查
+    //* EPOLLET下重新注册会报告已就绪的事件，迁移期间到达的数据不会丢失
+    from->del_event(conn->get_fd());
+    conn->set_owner(to);
+    if(to->add_event(conn) < 0){
+        conn->set_owner(from);
+        from->add_event(conn);
+        ++balance_stat.migrate_faild;
+        return;
+    }
+    it->second.movable_round = balance_stat.rounds 
+                                            + FLAME_MSG_REBALANCE_COOLDOWN;
+    ++balance_stat.migrations;
+
+    //* 原线程中尚未执行的send_msg工作任务不会再发送，由新线程发送剩余消息
+    conn->get();
+    to->post_work([conn](){
+        conn->send_msg(nullptr);
+        conn->put();
+    });
+}
+
+void MsgManager::schedule_rebalance(){
+    workers[0]->post_time_work(mct->config->msg_worker_rebalance_ms * 1000,
+        [this](){
+            if(!is_running) return;
+            this->rebalance();
+            this->schedule_rebalance();
+        });
+}
+
+void MsgManager::schedule_stat(){
+    workers[0]->post_time_work(mct->config->msg_worker_stat_ms * 1000,
+        [this](){
+            if(!is_running) return;
+            this->log_worker_stat();
+            this->schedule_stat();
+        });
 }
 
 MsgManager::~MsgManager(){
@@ -56,6 +258,10 @@ MsgManager::~MsgManager(){
         declare_msg->put();
         declare_msg = nullptr;
     }
+    for(auto &pair : conn_samples){
+        pair.first->put();
+    }
+    conn_samples.clear();
     m_msger_cb = nullptr;
 }
 
@@ -87,6 +293,7 @@ void MsgManager::add_conn(Connection *conn){
     auto worker = get_lightest_load_worker();
     if(!worker)
         return;
+    MutexLocker l(balance_mutex);
     if(!conn->is_owner_fixed()){
         conn->set_owner(worker);
     }
@@ -95,9 +302,15 @@ void MsgManager::add_conn(Connection *conn){
     }else{
         worker->update_job_num(1);
     }
+    if(conn_samples.find(conn) == conn_samples.end()){
+        conn->get();
+        conn_samples[conn];
+    }
 }
 
 void MsgManager::del_conn(Connection *conn){
+    //* 与do_migration()互斥，确保从连接当前所属的工作线程删除
+    MutexLocker l(balance_mutex);
     MsgWorker *worker = conn->get_owner();
     if(worker){
         if(conn->has_fd()){
@@ -106,6 +319,9 @@ void MsgManager::del_conn(Connection *conn){
             worker->update_job_num(-1);
         }
     }
+    if(conn_samples.erase(conn) > 0){
+        conn->put();
+    }
 }
 
 ListenPort* MsgManager::add_listen_port(NodeAddr *addr, msg_ttype_t ttype){
@@ -287,6 +503,17 @@ int MsgManager::start(){
     for(auto &worker : workers){
         worker->start();
     }
+    last_balance_cycles = get_cycles();
+    if(mct->config->msg_worker_rebalance_ms > 0 && workers.size() > 1){
+        if(mct->config->msg_worker_type == msg_worker_type_t::THREAD){
+            schedule_rebalance();
+        }else{
+            ML(mct, warn, "connection rebalance needs ThrMsgWorker, disabled");
+        }
+    }
+    if(mct->config->msg_worker_stat_ms > 0 && !workers.empty()){
+        schedule_stat();
+    }
     return 0;
     
 }
@@ -388,6 +615,16 @@ void MsgManager::on_conn_recv(Connection *conn, Msg *msg){
         return;
     }
 
+    if(msg->type == FLAME_MSG_TYPE_STRIPE){
+        //* 重组完成后由Session交给m_msger_cb
+        Session *s = conn->get_session();
+        if(!s || s->recv_stripe(conn, msg)){
+            ML(mct, error, "Drop {} from {}", msg->to_string(), 
+                                                        conn->to_string());
+        }
+        return;
+    }
+
     if(m_msger_cb){
         m_msger_cb->on_conn_recv(conn, msg);
     }
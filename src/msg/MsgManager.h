@@ -23,7 +23,40 @@
 namespace flame{
 namespace msg{
 
+/**
+ * 工作线程在上一个统计周期内的负载
+ */
+struct msg_worker_load_t{
+    int conns = 0;              // 连接数
+    double cpu = 0;             // 连接的回调占用的CPU，以核数计
+    double bytes_per_sec = 0;   // 收发的字节数
+    double msgs_per_sec = 0;    // 收发的消息数
+};
+
+/**
+ * 连接负载均衡的统计信息
+ */
+struct msg_balance_stat_t{
+    uint64_t rounds = 0;        // 统计周期数
+    uint64_t imbalanced = 0;    // 负载不均衡的周期数
+    uint64_t migrations = 0;    // 完成迁移的连接数
+    uint64_t migrate_faild = 0; // 迁移前连接已删除、关闭或注册失败
+    double imbalance = 0;       // 上一周期最重的工作线程负载/平均负载
+    std::vector<msg_worker_load_t> loads;
+};
+
 class MsgManager : public ListenPortListener, public ConnectionListener{
+private:
+    //* 连接上一周期采样的累计负载
+    struct conn_sample_t{
+        uint64_t rx_bytes = 0;
+        uint64_t tx_bytes = 0;
+        uint64_t rx_msgs = 0;
+        uint64_t tx_msgs = 0;
+        uint64_t cpu_cycles = 0;
+        uint64_t movable_round = 0; // 迁移后冷却，此周期前不再迁移
+    };
+
     MsgContext *mct;
     std::map<NodeAddr *, ListenPort *> listen_map;
     std::map<msger_id_t, Session *, msger_id_comparator> session_map;
@@ -37,6 +70,14 @@ class MsgManager : public ListenPortListener, public ConnectionListener{
 
     Mutex m_mutex;
 
+    //* 所有连接的负载采样，持有连接的引用
+    //* 迁移连接在原工作线程中进行，不能使用m_mutex：stop()持有m_mutex等待
+    //* 工作线程退出
+    Mutex balance_mutex;
+    std::map<Connection *, conn_sample_t> conn_samples;
+    uint64_t last_balance_cycles;
+    msg_balance_stat_t balance_stat;
+
 public:
     explicit MsgManager(MsgContext *c, int worker_num=4);
 
@@ -84,6 +125,40 @@ public:
      */
     MsgWorker *get_lightest_load_worker();
 
+    /**
+     * @brief 在日志中输出各MsgWorker的CPU利用率、唤醒延迟与负载
+     * msg_worker_stat_ms > 0 时由工作线程0定期调用
+     */
+    void log_worker_stat();
+
+    /**
+     * @brief 采样各连接的负载，汇总为各工作线程的负载
+     * 最重的工作线程负载超过平均值的msg_worker_imbalance_ratio倍时，
+     * 从中选一个负载不超过最重与最轻线程差值一半的连接迁移到最轻的线程
+     * msg_worker_rebalance_ms > 0 时由工作线程0定期调用
+     * @return 1 已发起迁移
+     * @return 0 无需迁移
+     */
+    int rebalance();
+
+    /**
+     * @brief 将连接迁移到指定工作线程
+     * 迁移在原工作线程处理完当前事件后进行，此后连接的事件与工作任务
+     * 由新线程处理。只能迁移有fd且不是is_owner_fixed()的连接，
+     * 且两个线程均为ThrMsgWorker
+     * @param conn 连接实例
+     * @param to 目标工作线程
+     * @return 0 已投递迁移任务
+     * @return -1 连接不可迁移
+     */
+    int migrate_conn(Connection *conn, MsgWorker *to);
+
+    /**
+     * @brief 获取连接负载均衡的统计信息
+     * @param stat 输出的统计信息
+     */
+    void get_balance_stat(msg_balance_stat_t &stat);
+
     /**
      * @brief 添加指定ip/port和传输类型(TCP/RDMA)的监听端口
      * @param addr ip/port信息
@@ -227,6 +302,26 @@ private:
      * @brief 将连接从消息模块工作线程移除
      */
     void del_conn(Connection *conn);
+
+    /**
+     * @brief 投递迁移任务，需持有balance_mutex
+     */
+    int post_migration(Connection *conn, MsgWorker *from, MsgWorker *to);
+
+    /**
+     * @brief 在原工作线程中执行迁移
+     */
+    void do_migration(Connection *conn, MsgWorker *from, MsgWorker *to);
+
+    /**
+     * @brief 在工作线程0上添加下一次rebalance()的定时工作任务
+     */
+    void schedule_rebalance();
+
+    /**
+     * @brief 在工作线程0上添加下一次log_worker_stat()的定时工作任务
+     */
+    void schedule_stat();
 };
 
 } //namespace msg
@@ -1,5 +1,6 @@
 #include "MsgWorker.h"
 #include "internal/errno.h"
+#include "util/cycles.h"
 
 #include <string>
 #include <chrono>
@@ -7,6 +8,8 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <pthread.h>
+#include <time.h>
 
 namespace flame{
 namespace msg{
@@ -56,10 +59,20 @@ int ThrMsgWorker::set_nonblock(int sd){
 ThrMsgWorker::ThrMsgWorker(MsgContext *c, int i)
 : MsgWorker(c, i), event_poller(c, 128), worker_thread(this), 
     is_running(false), extra_job_num(0), external_mutex(), external_num(0),
-    next_id(1){
+    next_id(1), sleeping(false), poll_mode(msg_worker_poll_mode_t::BLOCK),
+    spin_budget(0), backoff_max_ms(1), start_cycles(0), busy_cycles(0),
+    spin_cycles(0), sleep_cycles(0), sleep_cnt(0), wakeup_cnt(0),
+    handoff_cnt(0), handoff_cycles(0), handoff_max_cycles(0){
     int r;
     name = "ThrMsgWorker" + std::to_string(i);
 
+    if(mct->config){
+        poll_mode = mct->config->msg_worker_poll_mode;
+        spin_budget = (uint64_t)(mct->config->msg_worker_spin_us * 1000 
+                                                        * cycles_per_ns());
+        backoff_max_ms = mct->config->msg_worker_backoff_max_ms;
+    }
+
     int fds[2];
     if (pipe(fds) < 0) {
         ML(mct, error, "{} can't create notify pipe: {}", this->name,
@@ -121,7 +134,14 @@ int ThrMsgWorker::add_event(EventCallBack *ecb){
 }
 
 int ThrMsgWorker::del_event(int fd){
-    return event_poller.del_event(fd);
+    int r = event_poller.del_event(fd);
+    //* 删除的ecb在下一轮process_events()时释放，唤醒阻塞的工作线程，
+    //* 避免连接长时间不能释放
+    if(r == 0 && !worker_thread.am_self() && sleeping.load() 
+        && sleeping.exchange(false)){
+        wakeup();
+    }
+    return r;
 }
 
 void ThrMsgWorker::wakeup(){
@@ -224,21 +244,49 @@ void ThrMsgWorker::unreg_poller(uint64_t poller_id){
 }
 
 void ThrMsgWorker::post_work(work_fn_t work_fn){
-    bool wake = false;
     int num = 0;
+    uint64_t now = get_cycles();
     {
         MutexLocker l(external_mutex);
-        external_queue.push_back(work_fn);
+        external_queue.emplace_back(now, std::move(work_fn));
     }
     num = external_num++;
-    wake = !num;
     ++num;
-    if (!worker_thread.am_self() && wake)
+    //* 与工作线程阻塞前设置sleeping后检查external_num配对，两者至少有一方
+    //* 能看到对方的修改；工作线程轮询时无需唤醒
+    if (!worker_thread.am_self() && sleeping.load() && sleeping.exchange(false)){
+        wakeup_cnt.fetch_add(1, std::memory_order_relaxed);
         wakeup();
+    }
     ML(mct, debug, "{} pending {}", this->name, num);
 }
 
+int ThrMsgWorker::get_stat(msg_worker_stat_t &stat){
+    double rate = cycles_per_ns();
+    uint64_t start = start_cycles;
+    stat.wall_ns = start ? (uint64_t)((get_cycles() - start) / rate) : 0;
+    stat.cpu_ns = 0;
+    if(is_running.load() && worker_thread.is_started()){
+        clockid_t cid;
+        struct timespec ts;
+        if(pthread_getcpuclockid(worker_thread.get_thread_id(), &cid) == 0 
+            && clock_gettime(cid, &ts) == 0){
+            stat.cpu_ns = (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+        }
+    }
+    stat.busy_ns = (uint64_t)(busy_cycles.load(std::memory_order_relaxed) / rate);
+    stat.spin_ns = (uint64_t)(spin_cycles.load(std::memory_order_relaxed) / rate);
+    stat.sleep_ns = (uint64_t)(sleep_cycles.load(std::memory_order_relaxed) / rate);
+    stat.sleeps = sleep_cnt.load(std::memory_order_relaxed);
+    stat.wakeups = wakeup_cnt.load(std::memory_order_relaxed);
+    stat.handoffs = handoff_cnt.load(std::memory_order_relaxed);
+    stat.handoff_ns = (uint64_t)(handoff_cycles.load(std::memory_order_relaxed) / rate);
+    stat.handoff_max_ns = (uint64_t)(handoff_max_cycles.load(std::memory_order_relaxed) / rate);
+    return 0;
+}
+
 void ThrMsgWorker::start(){
+    start_cycles = get_cycles();
     is_running = true;
     worker_thread.create(name.c_str());
     ML(mct, debug, "{} worker thread created", this->name);
@@ -294,60 +342,130 @@ int ThrMsgWorker::iter_poller(){
     return r;
 }
 
+int ThrMsgWorker::run_pollers(){
+    //* 轮询器中可能注销轮询器，不直接遍历poller_list
+    int r = 0;
+    for(auto i = poller_list.size(); i > 0;--i){
+        r += iter_poller();
+    }
+    return r;
+}
+
+int ThrMsgWorker::process_external_works(){
+    std::deque<std::pair<uint64_t, work_fn_t>> cur_process;
+    {
+        MutexLocker l(external_mutex);
+        cur_process.swap(external_queue);
+    }
+    int num = cur_process.size();
+    external_num -= num;
+    if(num == 0) return 0;
+
+    uint64_t now = get_cycles();
+    uint64_t lat = now > cur_process.front().first ? 
+                                now - cur_process.front().first : 0;
+    handoff_cnt.store(handoff_cnt.load(std::memory_order_relaxed) + 1, 
+                                                std::memory_order_relaxed);
+    handoff_cycles.store(handoff_cycles.load(std::memory_order_relaxed) + lat,
+                                                std::memory_order_relaxed);
+    if(lat > handoff_max_cycles.load(std::memory_order_relaxed)){
+        handoff_max_cycles.store(lat, std::memory_order_relaxed);
+    }
+
+    while (!cur_process.empty()) {
+        ML(mct, trace, "{} do func", this->name);
+        cur_process.front().second();
+        cur_process.pop_front();
+    }
+    return num;
+}
+
+bool ThrMsgWorker::get_block_timeout(uint64_t idle_cycles, int &backoff_ms,
+                                                    struct timeval &timeout){
+    timeout.tv_sec = 0;
+    timeout.tv_usec = 0;
+    //* 有轮询器时不能休眠，轮询器的事件不会唤醒epoll_wait
+    if(external_num.load() || poller_list.size() > 0 
+        || poll_mode == msg_worker_poll_mode_t::BUSY){
+        return false;
+    }
+    if(poll_mode == msg_worker_poll_mode_t::ADAPTIVE 
+        && idle_cycles < spin_budget){
+        return false;
+    }
+
+    auto now = clock_type::now();
+    time_point shortest;
+    if(poll_mode == msg_worker_poll_mode_t::ADAPTIVE){
+        backoff_ms = backoff_ms ? std::min(backoff_ms * 2, backoff_max_ms) : 1;
+        shortest = now + std::chrono::milliseconds(backoff_ms);
+    }else{
+        shortest = now + std::chrono::seconds(30);
+    }
+    auto tw_it = time_works.begin();
+    if(tw_it != time_works.end() && shortest >= tw_it->first){
+        shortest = tw_it->first;
+    }
+    if(shortest <= now){
+        return false;
+    }
+    auto dur =  std::chrono::duration_cast<std::chrono::microseconds>
+                                                    (shortest - now).count();
+    timeout.tv_sec = dur / 1000000;
+    timeout.tv_usec = dur % 1000000;
+    return true;
+}
+
 void ThrMsgWorker::process(){
     ML(mct, debug, "{} start", this->name);
     std::vector<FiredEvent> fevents;
     struct timeval timeout;
     int numevents;
+    int backoff_ms = 0;
+    uint64_t last = get_cycles();
+    uint64_t idle_start = last;
 
     while(is_running){
-
-        bool trigger_time = false;
-        auto now = clock_type::now();
-        auto tw_it = time_works.begin();
-        bool blocking = (!external_num.load()) && (!poller_list.size());
-        if(!blocking){
-            if(tw_it != time_works.end() && now >= tw_it->first){
-                trigger_time = true;
-            }
-            timeout.tv_sec = 0;
-            timeout.tv_usec = 0;
-        }else{
-            time_point shortest;
-            shortest = now + std::chrono::seconds(30);
-            if(tw_it != time_works.end() && shortest >= tw_it->first){
-                shortest = tw_it->first;
-                trigger_time = true;
-            }
-            if(shortest > now){
-                auto dur =  std::chrono::duration_cast
-                                <std::chrono::microseconds>(shortest - now)
-                                .count();
-                timeout.tv_sec = dur / 1000000;
-                timeout.tv_usec = dur % 1000000;
-            }else{
+        bool blocking = get_block_timeout(last - idle_start, backoff_ms, 
+                                                                    timeout);
+        if(blocking){
+            sleeping.store(true);
+            if(external_num.load()){
+                //* 设置sleeping前有新的工作任务，投递者可能没有唤醒
+                sleeping.store(false);
+                blocking = false;
                 timeout.tv_sec = 0;
                 timeout.tv_usec = 0;
             }
-
         }
 
         int poller_events = 0;
         if(poller_list.size() > 0){
-            poller_events += iter_poller();
+            poller_events += poll_mode == msg_worker_poll_mode_t::BLOCK ?
+                                                iter_poller() : run_pollers();
         }
 
-        numevents = event_poller.process_events(fevents, &timeout);
+        uint64_t slept = 0;
+        if(blocking){
+            uint64_t t0 = get_cycles();
+            numevents = event_poller.process_events(fevents, &timeout);
+            sleeping.store(false);
+            slept = get_cycles() - t0;
+            sleep_cnt.store(sleep_cnt.load(std::memory_order_relaxed) + 1,
+                                                std::memory_order_relaxed);
+            sleep_cycles.store(sleep_cycles.load(std::memory_order_relaxed) 
+                                        + slept, std::memory_order_relaxed);
+        }else{
+            numevents = event_poller.process_events(fevents, &timeout);
+        }
         if(!is_running) break;
 
         for(int i = 0;i < numevents;++i){
-            //* 确保ecb不会被释放，直到该ecb处理完成
+            //* 回调中删除的ecb在下一轮process_events()时才释放，无需get()
             ML(mct, trace, "{} process fd:{}, mask:{}", this->name,
                                         fevents[i].ecb->fd, fevents[i].mask);
-            fevents[i].ecb->get();
             if(FLAME_EVENT_ERROR & fevents[i].mask){
                 fevents[i].ecb->error_cb();
-                fevents[i].ecb->put();
                 continue;
             }
             if(FLAME_EVENT_READABLE & fevents[i].mask & fevents[i].ecb->mask){
@@ -356,34 +474,33 @@ void ThrMsgWorker::process(){
             if(FLAME_EVENT_WRITABLE & fevents[i].mask & fevents[i].ecb->mask){
                 fevents[i].ecb->write_cb();
             }
-            fevents[i].ecb->put();
         }
 
-        if(trigger_time){
+        if(!time_works.empty()){
             numevents += this->process_time_works();
         }
 
         if (external_num.load()) {
-            std::deque<work_fn_t> cur_process;
-            {
-                MutexLocker l(external_mutex);
-                cur_process.swap(external_queue);
-            }
-            external_num -= cur_process.size();
-            numevents += cur_process.size();
-            while (!cur_process.empty()) {
-                work_fn_t cb = cur_process.front();
-                ML(mct, trace, "{} do func", this->name);
-                cb();
-                cur_process.pop_front();
-            }
+            numevents += process_external_works();
         }
 
         numevents += poller_events;
+        uint64_t now = get_cycles();
+        uint64_t elapsed = now - last - slept;
         if(numevents > 0){
             ML(mct, trace, "{} process {} event and work", this->name, 
                                                                 numevents);
+            busy_cycles.store(busy_cycles.load(std::memory_order_relaxed) 
+                                    + elapsed, std::memory_order_relaxed);
+            idle_start = now;
+            backoff_ms = 0;
+        }else{
+            spin_cycles.store(spin_cycles.load(std::memory_order_relaxed) 
+                                    + elapsed, std::memory_order_relaxed);
+            //* ADAPTIVE模式下超时醒来后重新轮询，下次阻塞的超时时间加倍
+            if(blocking) idle_start = now;
         }
+        last = now;
     }
 
     ML(mct, debug, "{} exit", this->name);
@@ -405,19 +522,7 @@ void ThrMsgWorker::drain(){
             }
         }
 
-        std::deque<work_fn_t> cur_process;
-        {
-            MutexLocker l(external_mutex);
-            cur_process.swap(external_queue);
-        }
-        external_num -= cur_process.size();
-        total += cur_process.size();
-        while (!cur_process.empty()) {
-            work_fn_t cb = cur_process.front();
-            ML(mct, trace, "{} do func", this->name);
-            cb();
-            cur_process.pop_front();
-        }
+        total += process_external_works();
     }
 
     total += this->process_time_works();
@@ -39,6 +39,45 @@ enum class msg_worker_type_t{
     SPDK = 2
 };
 
+/**
+ * ThrMsgWorker空闲时的等待方式
+ * - BLOCK 阻塞在epoll_wait中，由投递工作任务的线程写管道唤醒
+ * - BUSY 始终以非阻塞方式轮询，不休眠
+ * - ADAPTIVE 空闲后先轮询msg_worker_spin_us，再阻塞；阻塞的超时时间从1ms
+ *   开始指数增长至msg_worker_backoff_max_ms，每次超时醒来后重新轮询
+ */
+enum class msg_worker_poll_mode_t{
+    BLOCK = 0,
+    BUSY = 1,
+    ADAPTIVE = 2
+};
+
+/**
+ * 消息模块工作线程的统计信息，时间单位均为ns
+ */
+struct msg_worker_stat_t{
+    uint64_t wall_ns = 0;       // 线程启动至今
+    uint64_t cpu_ns = 0;        // 线程占用的CPU时间
+    uint64_t busy_ns = 0;       // 处理事件、工作任务、定时任务和轮询器的时间
+    uint64_t spin_ns = 0;       // 空闲轮询的时间
+    uint64_t sleep_ns = 0;      // 阻塞在epoll_wait中的时间
+    uint64_t sleeps = 0;        // 阻塞次数
+    uint64_t wakeups = 0;       // 投递工作任务时写管道唤醒的次数
+    uint64_t handoffs = 0;      // 取出的工作任务批次数
+    uint64_t handoff_ns = 0;    // 每批中最早的任务从投递到开始执行的时间之和
+    uint64_t handoff_max_ns = 0;
+
+    double cpu_util() const{
+        return wall_ns ? (double)cpu_ns / wall_ns : 0;
+    }
+    double busy_util() const{
+        return wall_ns ? (double)busy_ns / wall_ns : 0;
+    }
+    double avg_handoff_ns() const{
+        return handoffs ? (double)handoff_ns / handoffs : 0;
+    }
+};
+
 class MsgWorker{
 protected:
     int index;
@@ -188,6 +227,14 @@ public:
      * @brief 消息模块工作线程是否正在运行
      */ 
     virtual bool running() const = 0;
+
+    /**
+     * @brief 获取统计信息
+     * @param stat 输出的统计信息
+     * @return 0 成功
+     * @return < 0 不支持
+     */
+    virtual int get_stat(msg_worker_stat_t &stat) { return -1; }
 };
 
 class ThrMsgWorker;
@@ -209,6 +256,7 @@ struct HandleNotifyCallBack : public EventCallBack{
 };
 
 class ThrMsgWorker : public MsgWorker{
+private:
     using time_point = std::chrono::steady_clock::time_point;
     using clock_type = std::chrono::steady_clock;
     std::string name;
@@ -223,10 +271,28 @@ class ThrMsgWorker : public MsgWorker{
 
     std::list<std::pair<uint64_t, poller_fn_t>> poller_list;
 
+    //* 工作任务与投递时的TSC，用于统计交接延迟
     Mutex external_mutex;
-    std::deque<work_fn_t> external_queue;
+    std::deque<std::pair<uint64_t, work_fn_t>> external_queue;
     std::atomic<int> external_num;
     std::atomic<bool> is_running; 
+    //* 工作线程将要或正在阻塞，投递者只在此时写管道唤醒
+    std::atomic<bool> sleeping;
+
+    msg_worker_poll_mode_t poll_mode;
+    uint64_t spin_budget;    // TSC
+    int backoff_max_ms;
+
+    //* 统计信息，单位为TSC，除wakeup_cnt外只由工作线程写入
+    uint64_t start_cycles;
+    std::atomic<uint64_t> busy_cycles;
+    std::atomic<uint64_t> spin_cycles;
+    std::atomic<uint64_t> sleep_cycles;
+    std::atomic<uint64_t> sleep_cnt;
+    std::atomic<uint64_t> wakeup_cnt;
+    std::atomic<uint64_t> handoff_cnt;
+    std::atomic<uint64_t> handoff_cycles;
+    std::atomic<uint64_t> handoff_max_cycles;
 
     std::atomic<int> extra_job_num;
 
@@ -274,6 +340,25 @@ class ThrMsgWorker : public MsgWorker{
      * @return 本次轮询器处理的事件个数
      */
     int  iter_poller();
+    /**
+     * @brief 依次执行所有轮询器，用于BUSY/ADAPTIVE模式
+     * @return 本次轮询器处理的事件个数
+     */
+    int  run_pollers();
+    /**
+     * @brief 执行投递的工作任务，并统计交接延迟
+     * @return 本次执行的工作任务数
+     */
+    int  process_external_works();
+    /**
+     * @brief 计算本轮的epoll_wait超时时间
+     * @param idle_cycles 连续空闲的时间
+     * @param backoff_ms ADAPTIVE模式下上次阻塞的超时时间，0表示尚未阻塞
+     * @param timeout 输出的超时时间
+     * @return true 本轮需要阻塞
+     */
+    bool get_block_timeout(uint64_t idle_cycles, int &backoff_ms,
+                                                    struct timeval &timeout);
 
     /**
      * @brief 工作线程处理主过程
@@ -425,6 +510,14 @@ public:
         return is_running.load();
     }
 
+    /**
+     * @brief 获取统计信息
+     * 可以在任意线程调用
+     * @param stat 输出的统计信息
+     * @return 0 成功
+     */
+    virtual int get_stat(msg_worker_stat_t &stat) override;
+
 };
 
 } //namespace msg
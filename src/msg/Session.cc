@@ -1,8 +1,12 @@
 #include "Session.h"
 #include "MsgManager.h"
+#include "Msg.h"
+#include "msg_data.h"
 #include "util/fmt.h"
 
 #include <cstdlib>
+#include <algorithm>
+#include <chrono>
 
 namespace flame{
 namespace msg{
@@ -31,6 +35,9 @@ Connection* Session::get_conn(msg_ttype_t ttype, uint8_t sl){
     entry.conn = conn;
     conn->set_session(this);
     conns.push_back(entry);
+    if(in_stripe_group(conns.size() - 1)){
+        ++stripe_gen;
+    }
     
     return conn;
 }
@@ -58,22 +65,435 @@ int Session::add_conn(Connection *conn, uint8_t sl){
         }
     }
     conns.push_back(entry);
+    if(in_stripe_group(conns.size() - 1)){
+        ++stripe_gen;
+    }
     return 0;
 }
 
 int Session::del_conn(Connection *conn){
     int result = -1;
+    {
+        MutexLocker l(conns_mutex);
+        for(auto it = conns.begin(); it != conns.end(); ++it){
+            if(it->conn == conn){
+                if(in_stripe_group(it - conns.begin())){
+                    ++stripe_gen;
+                }
+                it = conns.erase(it);
+                conn->set_session(nullptr);
+                conn->put();
+                result = 0;
+                break;
+            }
+        }
+    }
+    if(result == 0){
+        //* 断开的连接上的分片不会再到达
+        bool dropped = false;
+        {
+            MutexLocker l(stripe_recv_mutex);
+            auto it = std::find(stripe_recv_conns.begin(), 
+                                    stripe_recv_conns.end(), conn);
+            if(it != stripe_recv_conns.end()){
+                stripe_recv_conns.erase(it);
+                drop_stripes();
+                dropped = true;
+            }
+        }
+        if(dropped){
+            deliver_stripes();
+        }
+    }
+    return result;
+}
+
+bool Session::in_stripe_group(size_t idx) const{
+    const conn_entry_t &entry = conns[idx];
+    if(entry.sl != 0){
+        return false;
+    }
+    //* 组内是该类型sl为0的前msg_stripe_conn_num条连接
+    size_t rank = 0;
+    for(size_t i = 0;i < idx; ++i){
+        if(conns[i].ttype == entry.ttype && conns[i].sl == 0){
+            ++rank;
+        }
+    }
+    return rank < (size_t)mct->config->msg_stripe_conn_num;
+}
+
+int Session::get_stripe_conns(msg_ttype_t ttype, 
+                                std::vector<Connection *> &sc, uint64_t &gen){
+    size_t num = mct->config->msg_stripe_conn_num;
     MutexLocker l(conns_mutex);
-    for(auto it = conns.begin(); it != conns.end(); ++it){
-        if(it->conn == conn){
-            it = conns.erase(it);
-            conn->set_session(nullptr);
-            conn->put();
-            result = 0;
+    for(auto entry : conns){
+        if(entry.ttype == ttype && entry.sl == 0 && sc.size() < num){
+            entry.conn->get();
+            sc.push_back(entry.conn);
+        }
+    }
+    auto addr = get_listen_addr(ttype);
+    //* 新连接由MsgManager放到负载最轻的工作线程上，各连接分属不同的线程
+    while(addr && sc.size() < num){
+        Connection *conn = mct->manager->add_connection(addr, ttype);
+        if(!conn) break;
+        conn_entry_t entry;
+        entry.ttype = ttype;
+        entry.sl = 0;
+        entry.conn = conn;
+        conn->set_session(this);
+        conns.push_back(entry);
+        ++stripe_gen;
+        conn->get();
+        sc.push_back(conn);
+    }
+    gen = stripe_gen;
+    return sc.empty() ? -1 : 0;
+}
+
+Msg *Session::alloc_stripe_frag(Msg *msg, 
+                                    const flame_msg_stripe_hdr_t &hdr){
+    msg_stripe_d sd;
+    sd.hdr = hdr;
+    Msg *frag = Msg::alloc_msg(mct, msg->ttype);
+    frag->type = FLAME_MSG_TYPE_STRIPE;
+    frag->priority = msg->priority;
+    frag->append_data(sd);
+    return frag;
+}
+
+int Session::send_striped(Msg *msg, std::vector<Connection *> &sc,
+                            uint64_t gen){
+    uint32_t total_len = msg->get_data_len();
+    uint32_t n = sc.size();
+    uint32_t frag_len = (total_len + n - 1) / n;
+    uint32_t frag_cnt = (total_len + frag_len - 1) / frag_len;
+    auto it = msg->data_iter();
+
+    MutexLocker l(stripe_send_mutex);
+    if(stripe_send_epoch == 0 || gen > stripe_send_gen){
+        //* 连接组变化后(如对端重启)，对端无法沿用原来的序号，换新的epoch
+        //* 取当前时间，对端重启后仍大于此前的epoch
+        uint64_t now = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+        stripe_prev_epoch = stripe_send_epoch;
+        stripe_prev_cnt = stripe_send_seq;
+        stripe_send_epoch = std::max(now, stripe_send_epoch + 1);
+        stripe_send_gen = gen;
+        stripe_send_seq = 0;
+    }
+    uint64_t stripe_id = stripe_send_seq++;
+    flame_msg_stripe_hdr_t hdr;
+    hdr.epoch = stripe_send_epoch;
+    hdr.stripe_id = stripe_id;
+    hdr.prev_epoch = stripe_prev_epoch;
+    hdr.prev_cnt = stripe_prev_cnt;
+    hdr.total_len = total_len;
+    hdr.frag_cnt = frag_cnt;
+    hdr.type = msg->type;
+    hdr.flag = msg->flag;
+    hdr.priority = msg->priority;
+    hdr.reserved = msg->reserved;
+    for(uint32_t i = 0;i < frag_cnt; ++i){
+        uint32_t off = i * frag_len;
+        uint32_t len = std::min(frag_len, total_len - off);
+        hdr.frag_off = off;
+        Msg *frag = alloc_stripe_frag(msg, hdr);
+        MsgBuffer buf(len);
+        it.copy(buf.data(), len);
+        buf.set_offset(len);
+        frag->data_buffer_list().append_nocp(std::move(buf));
+        //* 首个分片的连接随stripe_id轮转，各连接的负载均衡
+        uint32_t ci = (stripe_id + i) % n;
+        ssize_t r = sc[ci]->send_msg(frag);
+        frag->put();
+        if(r >= 0){
+            continue;
+        }
+        //* 已发出的分片无法撤回，通知对端放弃该消息，否则后续消息无法交付
+        hdr.frag_off = 0;
+        hdr.frag_cnt = 0;
+        Msg *abort = alloc_stripe_frag(msg, hdr);
+        bool notified = false;
+        for(uint32_t j = 1;j < n && !notified; ++j){
+            notified = (sc[(ci + j) % n]->send_msg(abort) >= 0);
+        }
+        abort->put();
+        if(!notified){
+            //* 无法通知时关闭连接组，对端在连接断开后重新计序
+            ML(mct, error, "Failed to abort stripe {}:{}, close {} conns", 
+                                        stripe_send_epoch, stripe_id, n);
+            for(auto conn : sc){
+                conn->close();
+            }
+        }
+        return -1;
+    }
+    return 0;
+}
+
+int Session::send_msg(Msg *msg, uint64_t key, msg_ttype_t ttype){
+    if(!msg) return -1;
+    std::vector<Connection *> sc;
+    uint64_t gen;
+    if(get_stripe_conns(ttype, sc, gen)){
+        return -1;
+    }
+    int r;
+    if(sc.size() > 1 
+        && msg->get_data_len() >= mct->config->msg_stripe_min_size
+        && (msg->is_ctl() || msg->is_io())
+        && !msg->has_rdma() && !msg->with_imm()){
+        r = send_striped(msg, sc, gen);
+    }else{
+        //* Fibonacci哈希，相邻的key分散到不同的连接
+        uint64_t h = (key * 0x9E3779B97F4A7C15ULL) >> 32;
+        r = (sc[h % sc.size()]->send_msg(msg) < 0) ? -1 : 0;
+    }
+    for(auto conn : sc){
+        conn->put();
+    }
+    return r;
+}
+
+void Session::free_stripe(stripe_recv_t &r){
+    delete [] r.data;
+    r.data = nullptr;
+    if(r.msg){
+        r.msg->put();
+        r.msg = nullptr;
+    }
+    if(r.conn){
+        r.conn->put();
+        r.conn = nullptr;
+    }
+}
+
+void Session::pop_ready_stripes(std::vector<stripe_recv_t> &ready){
+    auto ep = stripe_epochs.begin();
+    while(ep != stripe_epochs.end()){
+        uint64_t epoch = ep->first;
+        stripe_epoch_t &e = ep->second;
+        bool last = (std::next(ep) == stripe_epochs.end());
+        //* 已有后续epoch且有连接断开，该epoch不会再有消息完成
+        bool drain = !last && e.broken;
+        auto it = stripe_recvs.lower_bound(std::make_pair(epoch, (uint64_t)0));
+        while(it != stripe_recvs.end() && it->first.first == epoch){
+            stripe_recv_t &r = it->second;
+            bool complete = (r.copying == 0 && !r.aborted 
+                                && r.recv_len >= r.total_len);
+            uint64_t stripe_id = it->first.second;
+            if(drain || e.resync){
+                //* 丢弃第一条完成的消息之前未完成的消息
+                if(!complete){
+                    if(r.copying == 0){
+                        free_stripe(r);
+                        it = stripe_recvs.erase(it);
+                    }else{
+                        ++it;
+                    }
+                    continue;
+                }
+                if(drain){
+                    ready.push_back(r);
+                    it = stripe_recvs.erase(it);
+                    continue;
+                }
+                e.resync = false;
+                e.deliver_seq = stripe_id;
+            }
+            if(stripe_id > e.deliver_seq){
+                break;
+            }
+            if(!complete){
+                if(stripe_id == e.deliver_seq){
+                    if(!r.aborted || r.copying){
+                        break;
+                    }
+                    //* 发送端已放弃的消息，跳过
+                    ++e.deliver_seq;
+                }
+                //* 已丢弃的消息，拷贝中的分片结束后释放
+                if(r.copying == 0){
+                    free_stripe(r);
+                    it = stripe_recvs.erase(it);
+                }else{
+                    ++it;
+                }
+                continue;
+            }
+            if(stripe_id == e.deliver_seq){
+                ++e.deliver_seq;
+            }
+            ready.push_back(r);
+            it = stripe_recvs.erase(it);
+        }
+        it = stripe_recvs.lower_bound(std::make_pair(epoch, (uint64_t)0));
+        bool empty = (it == stripe_recvs.end() || it->first.first != epoch);
+        //* 旧epoch交付完后才交付新epoch的消息
+        if(last || !empty || !(drain || e.deliver_seq >= e.end)){
             break;
         }
+        stripe_retired_epoch = epoch;
+        ep = stripe_epochs.erase(ep);
     }
-    return result;
+}
+
+void Session::drop_stripes(){
+    for(auto &pair : stripe_epochs){
+        pair.second.broken = true;
+    }
+    for(auto it = stripe_recvs.begin();it != stripe_recvs.end();){
+        stripe_recv_t &r = it->second;
+        if(r.copying == 0 && !r.aborted && r.recv_len >= r.total_len){
+            ++it;
+            continue;
+        }
+        stripe_epochs[it->first.first].resync = true;
+        if(r.copying == 0){
+            free_stripe(r);
+            it = stripe_recvs.erase(it);
+        }else{
+            ++it;
+        }
+    }
+}
+
+void Session::deliver_stripes(){
+    std::vector<stripe_recv_t> ready;
+    {
+        MutexLocker l(stripe_recv_mutex);
+        if(stripe_delivering){
+            return;
+        }
+        pop_ready_stripes(ready);
+        if(ready.empty()){
+            return;
+        }
+        stripe_delivering = true;
+    }
+    auto msger_cb = mct->manager->get_msger_cb();
+    while(true){
+        for(auto &r : ready){
+            MsgBuffer buf(r.data, r.total_len);
+            buf.set_offset(r.total_len);
+            r.data = nullptr;
+            r.msg->data_len = r.total_len;
+            r.msg->data_buffer_list().append_nocp(std::move(buf));
+            if(msger_cb){
+                msger_cb->on_conn_recv(r.conn, r.msg);
+            }
+            free_stripe(r);
+        }
+        ready.clear();
+        MutexLocker l(stripe_recv_mutex);
+        pop_ready_stripes(ready);
+        if(ready.empty()){
+            stripe_delivering = false;
+            break;
+        }
+    }
+}
+
+int Session::recv_stripe(Connection *conn, Msg *frag){
+    msg_stripe_d sd;
+    auto it = frag->data_iter();
+    if(sd.decode(it) != (int)sd.size()){
+        return -1;
+    }
+    uint64_t epoch = sd.hdr.epoch;
+    uint64_t stripe_id = sd.hdr.stripe_id;
+    auto key = std::make_pair(epoch, stripe_id);
+    uint32_t total_len = sd.hdr.total_len;
+    uint32_t frag_off = sd.hdr.frag_off;
+    uint32_t len = frag->get_data_len() - sd.size();
+    if(frag_off > total_len || len > total_len - frag_off
+        || (sd.hdr.frag_cnt == 0 && len > 0)){
+        return -1;
+    }
+
+    char *data;
+    {
+        MutexLocker l(stripe_recv_mutex);
+        if(std::find(stripe_recv_conns.begin(), stripe_recv_conns.end(), 
+                        conn) == stripe_recv_conns.end()){
+            stripe_recv_conns.push_back(conn);
+        }
+        if(epoch <= stripe_retired_epoch){
+            //* 所属的epoch已交付完
+            return 0;
+        }
+        if(sd.hdr.prev_epoch > stripe_retired_epoch 
+            && sd.hdr.prev_epoch < epoch){
+            //* 对端的连接组已变化，旧epoch交付完前一条消息后结束
+            stripe_epochs[sd.hdr.prev_epoch].end = sd.hdr.prev_cnt;
+        }
+        stripe_epoch_t &e = stripe_epochs[epoch];
+        if(!e.resync && stripe_id < e.deliver_seq){
+            //* 所属的消息已交付，或因连接断开而丢弃
+            return 0;
+        }
+        stripe_recv_t &r = stripe_recvs[key];
+        if(r.aborted){
+            return 0;
+        }
+        if(sd.hdr.frag_cnt == 0){
+            //* 发送端放弃了该消息，拷贝中的分片结束后再释放
+            r.aborted = true;
+            data = nullptr;
+        }else if(!r.msg){
+            r.msg = Msg::alloc_msg(mct, frag->ttype);
+            r.msg->type = sd.hdr.type;
+            r.msg->flag = sd.hdr.flag;
+            r.msg->priority = sd.hdr.priority;
+            r.msg->reserved = sd.hdr.reserved;
+            r.data = new char[total_len];
+            r.total_len = total_len;
+        }else if(r.total_len != total_len){
+            return -1;
+        }
+        if(!r.aborted){
+            ++r.copying;
+            data = r.data;
+        }
+    }
+    if(!data){
+        deliver_stripes();
+        return 0;
+    }
+
+    //* 各连接的分片在各自的工作线程中并行拷贝
+    it.copy(data + frag_off, len);
+
+    bool ready;
+    {
+        MutexLocker l(stripe_recv_mutex);
+        stripe_recv_t &r = stripe_recvs[key];
+        --r.copying;
+        r.recv_len += len;
+        bool complete = (r.copying == 0 && !r.aborted 
+                            && r.recv_len >= r.total_len);
+        if(complete){
+            conn->get();
+            r.conn = conn;
+        }
+        //* 被放弃或丢弃的消息拷贝结束后也需要释放
+        ready = complete || (r.copying == 0 
+                                && (r.aborted || stripe_epochs[epoch].broken));
+    }
+    if(ready){
+        deliver_stripes();
+    }
+    return 0;
+}
+
+void Session::clear_stripe_recvs(){
+    MutexLocker l(stripe_recv_mutex);
+    for(auto &pair : stripe_recvs){
+        free_stripe(pair.second);
+    }
+    stripe_recvs.clear();
 }
 
 std::string Session::to_string() const {
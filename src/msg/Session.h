@@ -9,12 +9,13 @@
 #include "Connection.h"
 
 #include <vector>
+#include <map>
 
 namespace flame{
 namespace msg{
 
 class Session : public RefCountedObject{
-
+private:
     NodeAddr *tcp_listen_addr = nullptr;
     NodeAddr *rdma_listen_addr = nullptr;
 
@@ -25,16 +26,73 @@ class Session : public RefCountedObject{
     };
 
     std::vector<conn_entry_t> conns;
+    //* 条带化连接组中的连接增删时递增，需持有conns_mutex
+    uint64_t stripe_gen = 0;
 
     Mutex conns_mutex;
     Mutex lp_mutex;
 
+    //* 重组中的条带化消息
+    struct stripe_recv_t{
+        Msg *msg = nullptr;
+        char *data = nullptr;
+        uint32_t total_len = 0;
+        uint32_t recv_len = 0;
+        int copying = 0; //* 正在拷贝数据的分片数
+        bool aborted = false; //* 发送端已放弃
+        Connection *conn = nullptr; //* 收到最后一个分片的连接
+    };
+
+    struct stripe_epoch_t{
+        uint64_t deliver_seq = 0;
+        //* 该epoch的消息数，收到下一个epoch的分片后才知道
+        uint64_t end = UINT64_MAX;
+        //* 连接断开后，从下一条重组完成的消息重新计序
+        bool resync = false;
+        //* 有收到过分片的连接断开，该epoch的消息可能不再完整
+        bool broken = false;
+    };
+
+    //* 保证分片按stripe_id的顺序进入各连接的发送队列
+    Mutex stripe_send_mutex;
+    uint64_t stripe_send_seq = 0;
+    uint64_t stripe_send_epoch = 0;
+    uint64_t stripe_send_gen = 0;
+    uint64_t stripe_prev_epoch = 0;
+    uint64_t stripe_prev_cnt = 0;
+
+    Mutex stripe_recv_mutex;
+    //* (epoch, stripe_id), msg
+    std::map<std::pair<uint64_t, uint64_t>, stripe_recv_t> stripe_recvs;
+    //* 未交付完的epoch，旧epoch交付完后才交付新epoch的消息
+    std::map<uint64_t, stripe_epoch_t> stripe_epochs;
+    //* 不大于此值的epoch已交付完，其分片直接丢弃
+    uint64_t stripe_retired_epoch = 0;
+    //* 收到过分片的连接，不持有引用
+    std::vector<Connection *> stripe_recv_conns;
+    //* 同时只有一个线程按顺序交付重组完成的消息
+    bool stripe_delivering = false;
+
+    //* conns[idx]是否属于条带化连接组，需持有conns_mutex
+    bool in_stripe_group(size_t idx) const;
+    int get_stripe_conns(msg_ttype_t ttype, std::vector<Connection *> &sc,
+                            uint64_t &gen);
+    Msg *alloc_stripe_frag(Msg *msg, const flame_msg_stripe_hdr_t &hdr);
+    int send_striped(Msg *msg, std::vector<Connection *> &sc, uint64_t gen);
+    static void free_stripe(stripe_recv_t &r);
+    //* 需持有stripe_recv_mutex
+    void pop_ready_stripes(std::vector<stripe_recv_t> &ready);
+    void drop_stripes();
+    void deliver_stripes();
+
 
 public:
     explicit Session(MsgContext *c, msger_id_t peer)
     : RefCountedObject(c), peer_msger_id(peer), 
      conns_mutex(MUTEX_TYPE_ADAPTIVE_NP),
-     lp_mutex(MUTEX_TYPE_ADAPTIVE_NP){
+     lp_mutex(MUTEX_TYPE_ADAPTIVE_NP),
+     stripe_send_mutex(MUTEX_TYPE_ADAPTIVE_NP),
+     stripe_recv_mutex(MUTEX_TYPE_ADAPTIVE_NP){
         conns.reserve(4);
     }
 
@@ -51,12 +109,16 @@ public:
             }
         }
         
-        MutexLocker l(conns_mutex);
-        for(auto entry : conns){
-            entry.conn->set_session(nullptr);
-            entry.conn->put();
+        {
+            MutexLocker l(conns_mutex);
+            for(auto entry : conns){
+                entry.conn->set_session(nullptr);
+                entry.conn->put();
+            }
+            conns.clear();
         }
-        conns.clear();
+
+        clear_stripe_recvs();
     }
 
     /**
@@ -151,6 +213,39 @@ public:
      */
     int del_conn(Connection *conn);
 
+    /**
+     * @brief 发送消息，msg_stripe_conn_num > 1时使用条带化连接组
+     * 与对端建立msg_stripe_conn_num条该类型的连接，分布在不同的工作线程上。
+     * 数据部分不小于msg_stripe_min_size的消息切分到所有连接上发送，
+     * 对端按发送顺序重组后交给on_conn_recv()。连接组变化时换新的epoch，
+     * 对端交付完旧epoch的消息后再交付新epoch的消息；
+     * 连接断开时未重组完成的消息被丢弃，分片发送失败时通知对端放弃该消息；
+     * 其余消息按key的哈希值选择一条连接，key相同的消息保持顺序。
+     * 带有RDMA头部或立即数的消息不切分。
+     * @param msg 消息实例，不获取其所有权
+     * @param key 选择连接的依据
+     * @param ttype TCP或RDMA
+     * @return 0 发送成功
+     * @return < 0 发送失败
+     */
+    int send_msg(Msg *msg, uint64_t key=0, 
+                                    msg_ttype_t ttype=msg_ttype_t::TCP);
+
+    /**
+     * @brief 处理收到的条带化消息分片
+     * 由MsgManager调用，重组完成的消息按stripe_id的顺序交给on_conn_recv()
+     * @param conn 收到分片的连接
+     * @param frag 分片消息
+     * @return 0 成功
+     * @return < 0 分片格式错误
+     */
+    int recv_stripe(Connection *conn, Msg *frag);
+
+    /**
+     * @brief 丢弃重组中的条带化消息
+     */
+    void clear_stripe_recvs();
+
     const msger_id_t peer_msger_id;
 
     std::string to_string() const;
@@ -1,5 +1,6 @@
 #include <sys/epoll.h>
 #include <sys/time.h>
+#include <sys/resource.h>
 #include <unistd.h>
 #include <utility>
 
@@ -11,10 +12,23 @@ namespace flame{
 namespace msg{
 
 EventPoller::EventPoller(MsgContext *c, int nevent)
-:mct(c), events(new struct epoll_event[nevent]), size(nevent), ecb_map(),
- ecb_mutex(MUTEX_TYPE_ADAPTIVE_NP), event_num(0){
+:mct(c), events(new struct epoll_event[nevent]), size(nevent),
+ ecb_mutex(MUTEX_TYPE_ADAPTIVE_NP), event_num(0), has_retired(false){
     memset(events, 0, sizeof(struct epoll_event)*nevent);
-    
+
+    max_fd = FLAME_EVENT_TABLE_MAX_FD;
+    struct rlimit rl;
+    if(getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_max != RLIM_INFINITY
+        && rl.rlim_max < (rlim_t)max_fd){
+        max_fd = (int)rl.rlim_max;
+    }
+    int chunks = (max_fd + FLAME_EVENT_TABLE_CHUNK_SIZE - 1)
+                                            >> FLAME_EVENT_TABLE_CHUNK_SHIFT;
+    ecb_table.reset(new std::atomic<ecb_slot_t *>[chunks]);
+    for(int i = 0;i < chunks; ++i){
+        ecb_table[i].store(nullptr, std::memory_order_relaxed);
+    }
+
     epfd = epoll_create(1024); /* 1024 is just an hint for the kernel */
     if(epfd == -1){
         ML(mct, error, "unable to do epoll_create: {}", cpp_strerror(errno));
@@ -24,105 +38,155 @@ EventPoller::EventPoller(MsgContext *c, int nevent)
 EventPoller::~EventPoller(){
     close(epfd);
     delete []events;
+    release_retired();
     ecb_mutex.lock();
-    for(std::pair<int, EventCallBack *> e: ecb_map){
-        e.second->put();
+    int chunks = (max_fd + FLAME_EVENT_TABLE_CHUNK_SIZE - 1)
+                                            >> FLAME_EVENT_TABLE_CHUNK_SHIFT;
+    for(int i = 0;i < chunks; ++i){
+        ecb_slot_t *chunk = ecb_table[i].load(std::memory_order_relaxed);
+        if(!chunk) continue;
+        for(int j = 0;j < FLAME_EVENT_TABLE_CHUNK_SIZE; ++j){
+            EventCallBack *ecb = chunk[j].ecb.load(std::memory_order_relaxed);
+            if(ecb){
+                ecb->put();
+            }
+        }
+        delete []chunk;
     }
     ecb_mutex.unlock();
     mct = nullptr;
 }
 
-int EventPoller::set_event(int fd, EventCallBack *ecb){
-    struct epoll_event ee;
-    int op, new_mask;
-    op = EPOLL_CTL_ADD;
-    EventCallBack *old_ecb = nullptr;
-    ecb->get();
-    ecb_mutex.lock();
-    auto ecb_iter = ecb_map.find(fd);
-    if(ecb_iter != ecb_map.end()){
-        if(ecb->mask != ecb_iter->second->mask){
-            op = EPOLL_CTL_MOD;
+EventPoller::ecb_slot_t *EventPoller::get_or_create_slot(int fd){
+    if(fd < 0 || fd >= max_fd) return nullptr;
+    auto &entry = ecb_table[fd >> FLAME_EVENT_TABLE_CHUNK_SHIFT];
+    ecb_slot_t *chunk = entry.load(std::memory_order_relaxed);
+    if(!chunk){
+        chunk = new ecb_slot_t[FLAME_EVENT_TABLE_CHUNK_SIZE];
+        for(int i = 0;i < FLAME_EVENT_TABLE_CHUNK_SIZE; ++i){
+            chunk[i].ecb.store(nullptr, std::memory_order_relaxed);
+            chunk[i].gen.store(0, std::memory_order_relaxed);
         }
-        old_ecb = ecb_iter->second;
+        entry.store(chunk, std::memory_order_release);
     }
-    ecb_map[fd] = ecb;
+    return chunk + (fd & (FLAME_EVENT_TABLE_CHUNK_SIZE - 1));
+}
+
+void EventPoller::retire(EventCallBack *ecb){
+    retired.push_back(ecb);
+    has_retired.store(true, std::memory_order_release);
+}
+
+void EventPoller::release_retired(){
+    std::vector<EventCallBack *> to_put;
+    ecb_mutex.lock();
+    to_put.swap(retired);
+    has_retired.store(false, std::memory_order_relaxed);
     ecb_mutex.unlock();
+    for(auto ecb : to_put){
+        ecb->put();
+    }
+}
+
+int EventPoller::set_event(int fd, EventCallBack *ecb){
+    struct epoll_event ee;
+    MutexLocker l(ecb_mutex);
+    ecb_slot_t *slot = get_or_create_slot(fd);
+    if(!slot){
+        ML(mct, error, "epoll_ctl: set fd={} failed. fd exceeds {}",
+                                                                fd, max_fd);
+        return -EMFILE;
+    }
+    EventCallBack *old_ecb = slot->ecb.load(std::memory_order_relaxed);
+    //* 替换ecb时不改变版本号，已取出的事件由新的ecb处理
+    uint32_t gen = slot->gen.load(std::memory_order_relaxed);
     // avoid wake up all threads when share fd in many thread.
-    ee.events = EPOLLET; 
+    ee.events = EPOLLET;
     if(ecb->mask & FLAME_EVENT_READABLE)
         ee.events |= EPOLLIN;
     if(ecb->mask & FLAME_EVENT_WRITABLE)
         ee.events |= EPOLLOUT;
-    ee.data.u64 = 0;
-    ee.data.ptr = (void *)ecb;
-    if(epoll_ctl(epfd, op, fd, &ee) == -1){
+    ee.data.u64 = ((uint64_t)gen << 32) | (uint32_t)fd;
+
+    ecb->get();
+    slot->ecb.store(ecb, std::memory_order_release);
+    if(epoll_ctl(epfd, old_ecb ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, fd, &ee)
+                                                                    == -1){
+        int r = errno;
+        slot->ecb.store(old_ecb, std::memory_order_release);
         ecb->put();
-        ecb_mutex.lock();
-        if(old_ecb){
-             ecb_map[fd] = old_ecb;
-        }
-        ecb_mutex.unlock();
-        ML(mct, error, "epoll_ctl: set fd={} failed. {}", 
-                                                    fd, cpp_strerror(errno));
-        return -errno;
+        ML(mct, error, "epoll_ctl: set fd={} failed. {}",
+                                                    fd, cpp_strerror(r));
+        return -r;
     }
-    ++event_num;
     if(old_ecb){
-        old_ecb->put();
+        retire(old_ecb);
+    }else{
+        ++event_num;
     }
     return 0;
 }
 
 int EventPoller::del_event(int fd){
-    int r = 0;
     struct epoll_event ee; //* ee没有任何作用，也不会返回删除的event
+    MutexLocker l(ecb_mutex);
+    ecb_slot_t *slot = get_slot(fd);
+    EventCallBack *ecb = slot ? slot->ecb.load(std::memory_order_relaxed)
+                                : nullptr;
     if(epoll_ctl(epfd, EPOLL_CTL_DEL, fd, &ee) < 0){
-        ML(mct, error, "epoll_ctl: delete fd={} failed. {}", fd, 
-                                                        cpp_strerror(errno));
-        return -errno;
+        int r = errno;
+        ML(mct, error, "epoll_ctl: delete fd={} failed. {}", fd,
+                                                        cpp_strerror(r));
+        return -r;
     }
-    EventCallBack *ecb = nullptr;
-    ecb_mutex.lock();
-    auto ecb_iter = ecb_map.find(fd);
-    if(ecb_iter != ecb_map.end()){
-        ecb = ecb_iter->second;
-        ecb_map.erase(ecb_iter);
-    }else{
-        r = -1;
+    if(!ecb){
+        return -1;
     }
-    ecb_mutex.unlock();
+    //* 先修改版本号，已取出但未分发的该fd事件将被丢弃
+    slot->gen.store(slot->gen.load(std::memory_order_relaxed) + 1,
+                                                    std::memory_order_release);
+    slot->ecb.store(nullptr, std::memory_order_release);
     --event_num;
-    if(ecb){
-        ecb->put();
-    }
-    return r;
+    retire(ecb);
+    return 0;
 }
 
-int EventPoller::process_events(std::vector<FiredEvent> &fired_events, 
+int EventPoller::process_events(std::vector<FiredEvent> &fired_events,
                                     struct timeval *tvp){
+    //* 上一次返回的事件已处理完成，此前删除的ecb可以释放
+    if(has_retired.load(std::memory_order_acquire)){
+        release_retired();
+    }
+
     int retval, numevents = 0;
-    retval = epoll_wait(epfd, events, size, 
+    retval = epoll_wait(epfd, events, size,
                         tvp ? (tvp->tv_sec*1000 + tvp->tv_usec/1000) : -1);
     if(retval > 0){
-        int i;
-        numevents = retval;
-        fired_events.resize(numevents);
-        for(i = 0;i < numevents;i++){
+        fired_events.resize(retval);
+        for(int i = 0;i < retval;i++){
             int mask = 0;
             struct epoll_event *e = events + i;
+            int fd = (int)(uint32_t)e->data.u64;
+            uint32_t gen = (uint32_t)(e->data.u64 >> 32);
+            ecb_slot_t *slot = get_slot(fd);
+            if(!slot) continue;
+            EventCallBack *ecb = slot->ecb.load(std::memory_order_acquire);
+            if(!ecb || slot->gen.load(std::memory_order_acquire) != gen){
+                continue;
+            }
 
             if (e->events & EPOLLIN) mask |= FLAME_EVENT_READABLE;
             if (e->events & EPOLLOUT) mask |= FLAME_EVENT_WRITABLE;
-            if (e->events & EPOLLERR) 
+            if (e->events & EPOLLERR)
                 mask |= FLAME_EVENT_ERROR;
-            if (e->events & EPOLLHUP) 
+            if (e->events & EPOLLHUP)
                 mask |= FLAME_EVENT_ERROR;
-            fired_events[i].ecb = (EventCallBack *)e->data.ptr;
-            fired_events[i].ecb->mask |= (FLAME_EVENT_ERROR & mask);
-            fired_events[i].mask = mask;
+            fired_events[numevents].ecb = ecb;
+            fired_events[numevents].ecb->mask |= (FLAME_EVENT_ERROR & mask);
+            fired_events[numevents].mask = mask;
+            ++numevents;
         }
-        
+
     }
     return numevents;
 }
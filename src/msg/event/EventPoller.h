@@ -4,24 +4,62 @@
 #include <sys/epoll.h>
 #include <sys/time.h>
 #include <vector>
-#include <map>
 #include <atomic>
+#include <memory>
 
 #include "event.h"
 #include "common/thread/mutex.h"
 #include "msg/msg_context.h"
 
+//* fd表每块的槽数
+#define FLAME_EVENT_TABLE_CHUNK_SHIFT 10
+#define FLAME_EVENT_TABLE_CHUNK_SIZE  (1 << FLAME_EVENT_TABLE_CHUNK_SHIFT)
+//* fd表的上限，RLIMIT_NOFILE的硬限制更小时以其为准
+#define FLAME_EVENT_TABLE_MAX_FD      (1 << 24)
+
 namespace flame{
 namespace msg{
 
+/**
+ * EventPoller
+ * EventCallBack存放在以fd为下标的两级表中，表块按需分配，直到析构才释放。
+ * epoll_event.data中保存fd与注册时的版本号，分发事件时直接按fd取回ecb，
+ * 不加锁也不查找树；版本号不符说明fd已在此期间删除(或删除后被复用)，
+ * 丢弃该事件。
+ * del_event()不立即释放ecb，而是放入待释放队列，在下一次process_events()
+ * 开始时释放。调用process_events()的线程必须在下一次调用前处理完
+ * 上一次返回的事件，因此分发中的ecb不会被释放。
+ * set_event()/del_event()可以在任意线程调用，相互之间由ecb_mutex互斥。
+ */
 class EventPoller{
+    struct ecb_slot_t{
+        std::atomic<EventCallBack *> ecb;
+        std::atomic<uint32_t> gen;
+    };
+
     MsgContext *mct;
     int epfd;
     std::atomic<int> event_num;
     Mutex ecb_mutex;
-    std::map<int,  EventCallBack *> ecb_map;
+    int max_fd;
+    std::unique_ptr<std::atomic<ecb_slot_t *>[]> ecb_table;
+    std::vector<EventCallBack *> retired;
+    std::atomic<bool> has_retired;
     struct epoll_event *events;
     int size;
+
+    ecb_slot_t *get_slot(int fd) const{
+        if(fd < 0 || fd >= max_fd) return nullptr;
+        ecb_slot_t *chunk = ecb_table[fd >> FLAME_EVENT_TABLE_CHUNK_SHIFT]
+                                            .load(std::memory_order_acquire);
+        if(!chunk) return nullptr;
+        return chunk + (fd & (FLAME_EVENT_TABLE_CHUNK_SIZE - 1));
+    }
+    //* 需持有ecb_mutex
+    ecb_slot_t *get_or_create_slot(int fd);
+    //* 需持有ecb_mutex
+    void retire(EventCallBack *ecb);
+    void release_retired();
 public:
     int get_event_num() const { return event_num.load(); };
     int set_event(int fd, EventCallBack *ecb);
@@ -35,4 +73,4 @@ public:
 } //namespace msg
 } //namespace flame
 
-#endif //FLAME_MSG_EVENT_EVENT_POLLER_H
\ No newline at end of file
+#endif //FLAME_MSG_EVENT_EVENT_POLLER_H
@@ -79,6 +79,63 @@ int MsgConfig::load(){
         return 1;
     }
 
+    res = set_msg_worker_poll_mode(cfg->get("msg_worker_poll_mode",
+                                            FLAME_MSG_WORKER_POLL_MODE_D));
+    if (res) {
+        perr_arg("msg_worker_poll_mode");
+        return 1;
+    }
+
+    res = set_msg_worker_spin_us(cfg->get("msg_worker_spin_us",
+                                            FLAME_MSG_WORKER_SPIN_US_D));
+    if (res) {
+        perr_arg("msg_worker_spin_us");
+        return 1;
+    }
+
+    res = set_msg_worker_backoff_max_ms(cfg->get("msg_worker_backoff_max_ms",
+                                            FLAME_MSG_WORKER_BACKOFF_MAX_MS_D));
+    if (res) {
+        perr_arg("msg_worker_backoff_max_ms");
+        return 1;
+    }
+
+    res = set_msg_worker_rebalance_ms(cfg->get("msg_worker_rebalance_ms",
+                                            FLAME_MSG_WORKER_REBALANCE_MS_D));
+    if (res) {
+        perr_arg("msg_worker_rebalance_ms");
+        return 1;
+    }
+
+    res = set_msg_worker_imbalance_ratio(
+                                cfg->get("msg_worker_imbalance_ratio",
+                                FLAME_MSG_WORKER_IMBALANCE_RATIO_D));
+    if (res) {
+        perr_arg("msg_worker_imbalance_ratio");
+        return 1;
+    }
+
+    res = set_msg_worker_stat_ms(cfg->get("msg_worker_stat_ms",
+                                            FLAME_MSG_WORKER_STAT_MS_D));
+    if (res) {
+        perr_arg("msg_worker_stat_ms");
+        return 1;
+    }
+
+    res = set_msg_stripe_conn_num(cfg->get("msg_stripe_conn_num",
+                                            FLAME_MSG_STRIPE_CONN_NUM_D));
+    if (res) {
+        perr_arg("msg_stripe_conn_num");
+        return 1;
+    }
+
+    res = set_msg_stripe_min_size(cfg->get("msg_stripe_min_size",
+                                            FLAME_MSG_STRIPE_MIN_SIZE_D));
+    if (res) {
+        perr_arg("msg_stripe_min_size");
+        return 1;
+    }
+
     res = set_rdma_enable(cfg->get("rdma_enable", FLAME_RDMA_ENABLE_D));
     if (res) {
         perr_arg("rdma_enable");
@@ -171,6 +228,13 @@ int MsgConfig::load(){
             return 1;
         }
 
+        res = set_rdma_srq_size_classes(cfg->get("rdma_srq_size_classes", 
+                                                FLAME_RDMA_SRQ_SIZE_CLASSES_D));
+        if (res) {
+            perr_arg("rdma_srq_size_classes");
+            return 1;
+        }
+
         res = set_rdma_cq_pair_num(cfg->get("rdma_cq_pair_num", 
                                             FLAME_RDMA_CQ_PAIR_NUM_D));
         if (res) {
@@ -205,6 +269,35 @@ int MsgConfig::load(){
             perr_arg("rdma_poll_event");
             return 1;
         }
+
+        res = set_rdma_cq_poll_batch(cfg->get("rdma_cq_poll_batch", 
+                                                FLAME_RDMA_CQ_POLL_BATCH_D));
+        if (res) {
+            perr_arg("rdma_cq_poll_batch");
+            return 1;
+        }
+
+        res = set_rdma_send_signal_interval(
+                                cfg->get("rdma_send_signal_interval", 
+                                        FLAME_RDMA_SEND_SIGNAL_INTERVAL_D));
+        if (res) {
+            perr_arg("rdma_send_signal_interval");
+            return 1;
+        }
+
+        res = set_rdma_recv_repost_batch(cfg->get("rdma_recv_repost_batch", 
+                                            FLAME_RDMA_RECV_REPOST_BATCH_D));
+        if (res) {
+            perr_arg("rdma_recv_repost_batch");
+            return 1;
+        }
+
+        res = set_rdma_mr_cache_size(cfg->get("rdma_mr_cache_size", 
+                                            FLAME_RDMA_MR_CACHE_SIZE_D));
+        if (res) {
+            perr_arg("rdma_mr_cache_size");
+            return 1;
+        }
     }
 
     return 0;
@@ -292,6 +385,106 @@ int MsgConfig::set_msg_worker_spdk_event_poll_period(const std::string &v){
     return 0;
 }
 
+int MsgConfig::set_msg_worker_poll_mode(const std::string &v){
+    static const char *poll_mode_strs[] = {
+        "BLOCK", "BUSY", "ADAPTIVE"
+    };
+    auto mode_upper = str2upper(v);
+    for(uint8_t i = 0;i < 3; i++){
+        if(poll_mode_strs[i] == mode_upper){
+            msg_worker_poll_mode = static_cast<msg_worker_poll_mode_t>(i);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int MsgConfig::set_msg_worker_spin_us(const std::string &v){
+    if(v.empty()){
+        return 1;
+    }
+
+    msg_worker_spin_us = std::stoull(v, nullptr, 0);
+
+    return 0;
+}
+
+int MsgConfig::set_msg_worker_backoff_max_ms(const std::string &v){
+    if(v.empty()){
+        return 1;
+    }
+
+    int backoff_max_ms = std::stoi(v, nullptr, 0);
+    if(backoff_max_ms < 1){
+        return 1;
+    }
+    msg_worker_backoff_max_ms = backoff_max_ms;
+
+    return 0;
+}
+
+int MsgConfig::set_msg_worker_rebalance_ms(const std::string &v){
+    if(v.empty()){
+        return 1;
+    }
+
+    msg_worker_rebalance_ms = std::stoull(v, nullptr, 0);
+
+    return 0;
+}
+
+int MsgConfig::set_msg_worker_imbalance_ratio(const std::string &v){
+    if(v.empty()){
+        return 1;
+    }
+
+    double ratio = std::stod(v);
+    if(ratio <= 1.0){
+        return 1;
+    }
+    msg_worker_imbalance_ratio = ratio;
+
+    return 0;
+}
+
+int MsgConfig::set_msg_worker_stat_ms(const std::string &v){
+    if(v.empty()){
+        return 1;
+    }
+
+    msg_worker_stat_ms = std::stoull(v, nullptr, 0);
+
+    return 0;
+}
+
+int MsgConfig::set_msg_stripe_conn_num(const std::string &v){
+    if(v.empty()){
+        return 1;
+    }
+
+    int num = std::stoi(v, nullptr, 0);
+    if(num < 1 || num > FLAME_MSG_STRIPE_CONN_NUM_MAX){
+        return 1;
+    }
+    msg_stripe_conn_num = num;
+
+    return 0;
+}
+
+int MsgConfig::set_msg_stripe_min_size(const std::string &v){
+    if(v.empty()){
+        return 1;
+    }
+
+    uint64_t size = size_str_to_uint64(v);
+    if(size == 0 || size >= (1ULL << 32)){
+        return 1;
+    }
+    msg_stripe_min_size = size;
+
+    return 0;
+}
+
 int MsgConfig::set_msger_id(const std::string &v){
     std::regex msger_id_regex("([0-9.]+)/(\\d+)");
     std::smatch m;
@@ -525,6 +718,28 @@ int MsgConfig::set_rdma_enable_srq(const std::string &v){
     return 0;
 }
 
+int MsgConfig::set_rdma_srq_size_classes(const std::string &v){
+    std::regex size_regex("\\S+");
+    auto iter_begin = std::sregex_iterator(v.begin(), v.end(), size_regex);
+    auto iter_end = std::sregex_iterator();
+
+    std::vector<uint32_t> classes;
+    for(auto i = iter_begin;i != iter_end;++i){
+        uint64_t size = size_str_to_uint64(i->str());
+        //ascending, and smaller than rdma_buffer_size.
+        if(size < 64 || size >= rdma_buffer_size
+            || (!classes.empty() && size <= classes.back())){
+            return 1;
+        }
+        classes.push_back(size);
+    }
+    if(classes.size() > FLAME_RDMA_SRQ_SIZE_CLASSES_MAX){
+        return 1;
+    }
+    rdma_srq_size_classes.swap(classes);
+    return 0;
+}
+
 int MsgConfig::set_rdma_cq_pair_num(const std::string &v){
     rdma_cq_pair_num = 1;
     if(v.empty()){
@@ -593,5 +808,49 @@ int MsgConfig::set_rdma_poll_event(const std::string &v){
     return 0;
 }
 
+int MsgConfig::set_rdma_cq_poll_batch(const std::string &v){
+    if(v.empty()){
+        return 1;
+    }
+    int batch = std::stoi(v, nullptr, 0);
+    if(batch >= 1 && batch <= FLAME_RDMA_CQ_POLL_BATCH_MAX){
+        rdma_cq_poll_batch = batch;
+        return 0;
+    }
+    return 1;
+}
+
+int MsgConfig::set_rdma_send_signal_interval(const std::string &v){
+    if(v.empty()){
+        return 1;
+    }
+    int interval = std::stoi(v, nullptr, 0);
+    if(interval >= 1){
+        rdma_send_signal_interval = interval;
+        return 0;
+    }
+    return 1;
+}
+
+int MsgConfig::set_rdma_recv_repost_batch(const std::string &v){
+    if(v.empty()){
+        return 1;
+    }
+    int batch = std::stoi(v, nullptr, 0);
+    if(batch >= 1){
+        rdma_recv_repost_batch = batch;
+        return 0;
+    }
+    return 1;
+}
+
+int MsgConfig::set_rdma_mr_cache_size(const std::string &v){
+    if(v.empty()){
+        return 1;
+    }
+    rdma_mr_cache_size = size_str_to_uint64(v);
+    return 0;
+}
+
 } //namespace msg
 } //namespace flame
\ No newline at end of file
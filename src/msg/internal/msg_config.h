@@ -17,6 +17,14 @@
 #define FLAME_MSG_WORKER_NUM_D        "4"
 #define FLAME_MSG_WORKER_CPU_MAP_D    ""
 #define FLAME_MSG_WORKER_SPDK_EVENT_POLL_PERIOD_D "400" //microsecond
+#define FLAME_MSG_WORKER_POLL_MODE_D  "BLOCK"
+#define FLAME_MSG_WORKER_SPIN_US_D    "50"
+#define FLAME_MSG_WORKER_BACKOFF_MAX_MS_D "32"
+#define FLAME_MSG_WORKER_REBALANCE_MS_D "0"
+#define FLAME_MSG_WORKER_IMBALANCE_RATIO_D "1.5"
+#define FLAME_MSG_WORKER_STAT_MS_D    "60000"
+#define FLAME_MSG_STRIPE_CONN_NUM_D   "1"
+#define FLAME_MSG_STRIPE_MIN_SIZE_D   "256K"
 #define FLAME_MSGER_ID_D              ""
 #define FLAME_NODE_LISTEN_PORTS_D     ""
 #define FLAME_RDMA_ENABLE_D           "false"
@@ -31,12 +39,24 @@
 #define FLAME_RDMA_ENABLE_HUGEPAGE_D  "true"
 #define FLAME_RDMA_HUGEPAGE_SIZE_D    "2M"
 #define FLAME_RDMA_ENABLE_SRQ_D       "true"
+#define FLAME_RDMA_SRQ_SIZE_CLASSES_D ""
 #define FLAME_RDMA_CQ_PAIR_NUM_D      "1"
 #define FLAME_RDMA_TRAFFIC_CLASS_D    "0"
 #define FLAME_RDMA_PATH_MTU_D         "4096"
 #define FLAME_RDMA_MEM_MIN_LEVEL_D    "12"
 #define FLAME_RDMA_MEM_MAX_LEVEL_D    "29"
 #define FLAME_RDMA_POLL_EVENT_D       "true"
+#define FLAME_RDMA_CQ_POLL_BATCH_D    "16"
+#define FLAME_RDMA_SEND_SIGNAL_INTERVAL_D "1"
+#define FLAME_RDMA_RECV_REPOST_BATCH_D "8"
+#define FLAME_RDMA_MR_CACHE_SIZE_D    "1G"
+
+// max of msg_stripe_conn_num
+#define FLAME_MSG_STRIPE_CONN_NUM_MAX 16
+// max number of rdma_srq_size_classes, not including rdma_buffer_size.
+#define FLAME_RDMA_SRQ_SIZE_CLASSES_MAX 3
+// max of rdma_cq_poll_batch, ibv_wc is 48B.
+#define FLAME_RDMA_CQ_POLL_BATCH_MAX 256
 
 #ifdef ON_SW_64
     #define FLAME_RDMA_HUGEPAGE_SIZE_D "8M"
@@ -51,6 +71,7 @@ class FlameContext;
 namespace msg{
 
 enum class msg_worker_type_t;
+enum class msg_worker_poll_mode_t;
 
 class MsgConfig{
     FlameContext *fct;
@@ -111,6 +132,71 @@ public:
     uint64_t msg_worker_spdk_event_poll_period;
     int set_msg_worker_spdk_event_poll_period(const std::string &v);
 
+    /**
+     * Msg module ThrMsgWorker poll mode when idle
+     * @cfg: msg_worker_poll_mode
+     * @value: BLOCK, BUSY, ADAPTIVE
+     * Spinning workers should be pinned by msg_worker_cpu_map.
+     */
+    msg_worker_poll_mode_t msg_worker_poll_mode;
+    int set_msg_worker_poll_mode(const std::string &v);
+
+    /**
+     * Msg module ThrMsgWorker spin time before blocking in ADAPTIVE mode
+     * @cfg: msg_worker_spin_us
+     */
+    uint64_t msg_worker_spin_us;
+    int set_msg_worker_spin_us(const std::string &v);
+
+    /**
+     * Msg module ThrMsgWorker max block timeout in ADAPTIVE mode
+     * The timeout starts from 1ms and doubles on each idle wakeup.
+     * @cfg: msg_worker_backoff_max_ms
+     */
+    int msg_worker_backoff_max_ms;
+    int set_msg_worker_backoff_max_ms(const std::string &v);
+
+    /**
+     * Msg module interval of rebalancing connections between ThrMsgWorkers
+     * 0 means disabled.
+     * @cfg: msg_worker_rebalance_ms
+     */
+    uint64_t msg_worker_rebalance_ms;
+    int set_msg_worker_rebalance_ms(const std::string &v);
+
+    /**
+     * Msg module rebalance when the heaviest worker's load exceeds
+     * the average by this ratio
+     * @cfg: msg_worker_imbalance_ratio
+     */
+    double msg_worker_imbalance_ratio;
+    int set_msg_worker_imbalance_ratio(const std::string &v);
+
+    /**
+     * Msg module interval of logging the cpu, wakeup and load stats
+     * of MsgWorkers. 0 means disabled.
+     * @cfg: msg_worker_stat_ms
+     */
+    uint64_t msg_worker_stat_ms;
+    int set_msg_worker_stat_ms(const std::string &v);
+
+    /**
+     * Msg module connections of each type opened by Session::send_msg()
+     * to a peer. 1 means no striping.
+     * @cfg: msg_stripe_conn_num
+     * @range: [1, 16]
+     */
+    int msg_stripe_conn_num;
+    int set_msg_stripe_conn_num(const std::string &v);
+
+    /**
+     * Msg module msgs whose data is not less than this are striped across
+     * the connections by Session::send_msg()
+     * @cfg: msg_stripe_min_size
+     */
+    uint64_t msg_stripe_min_size;
+    int set_msg_stripe_min_size(const std::string &v);
+
     /**
      * Msger Id
      * @cfg: msger_id
@@ -220,6 +306,21 @@ public:
     bool rdma_enable_srq;
     int set_rdma_enable_srq(const std::string &v);
 
+    /**
+     * RDMA srq size classes
+     * Receive buffer sizes smaller than rdma_buffer_size, in ascending order.
+     * Each class has its own srq and a qp in every connection, the sender
+     * sends a msg with FLAME_MSG_FLAG_UNORDERED through the smallest class
+     * that holds it, the others go through rdma_buffer_size in order.
+     * Only for rdma_conn_version 1 with srq enabled. The classes are
+     * exchanged in the handshake, a connection to a peer with different
+     * classes is rejected.
+     * @cfg: rdma_srq_size_classes
+     * @example: 256 1K
+     */
+    std::vector<uint32_t> rdma_srq_size_classes;
+    int set_rdma_srq_size_classes(const std::string &v);
+
     /**
      * RDMA cq pair number
      * @cfg: rdma_cq_pair_num
@@ -256,6 +357,40 @@ public:
     bool rdma_poll_event;
     int set_rdma_poll_event(const std::string &v);
 
+    /**
+     * Max cqes polled by one ibv_poll_cq().
+     * @cfg: rdma_cq_poll_batch
+     * @range: [1, 256]
+     */
+    uint32_t rdma_cq_poll_batch;
+    int set_rdma_cq_poll_batch(const std::string &v);
+
+    /**
+     * For rdma_conn_version 2, signal one of every N send wrs, and the last
+     * wr of each ibv_post_send(). The unsignaled wrs are completed when the
+     * cqe of a later signaled wr on the same qp arrives.
+     * 1 means signal every wr as the user set.
+     * @cfg: rdma_send_signal_interval
+     */
+    uint32_t rdma_send_signal_interval;
+    int set_rdma_send_signal_interval(const std::string &v);
+
+    /**
+     * Recv wrs consumed before they are re-posted to srq in one chain.
+     * Not more than 1/4 of rdma_recv_queue_len.
+     * @cfg: rdma_recv_repost_batch
+     */
+    uint32_t rdma_recv_repost_batch;
+    int set_rdma_recv_repost_batch(const std::string &v);
+
+    /**
+     * Max bytes of user memory pinned by the registration cache.
+     * 0 means disable the cache.
+     * @cfg: rdma_mr_cache_size
+     */
+    uint64_t rdma_mr_cache_size;
+    int set_rdma_mr_cache_size(const std::string &v);
+
 };
 
 } //namespace msg
@@ -47,11 +47,13 @@ struct flame_msg_header_t{
 #define FLAME_MSG_TYPE_IO                 2
 #define FLAME_MSG_TYPE_DECLARE_ID         3
 #define FLAME_MSG_TYPE_IMM_DATA           4
+#define FLAME_MSG_TYPE_STRIPE             5 //fragment of a striped msg.
 
 #define FLAME_MSG_FLAG_RESP               1
 #define FLAME_MSG_FLAG_RDMA               (1 << 1)//has flame_msg_rdma_header_t.
 #define FLAME_MSG_FLAG_MEM_FETCH          (1 << 2)//when unset, means mem push.
 #define FLAME_MSG_FLAG_WITH_IMM           (1 << 3)//with 4 Bytes imm data.
+#define FLAME_MSG_FLAG_UNORDERED          (1 << 4)//may overtake other msgs.
 
 #define FLAME_MSG_RDMA_MEM_PUSH      0
 #define FLAME_MSG_RDMA_MEM_FETCH     1
@@ -71,6 +73,21 @@ struct flame_msg_rdma_mr_t{
 } __attribute__ ((packed));
 
 
+//* 条带化消息分片的头部，位于分片数据部分的开头
+struct flame_msg_stripe_hdr_t{
+    __le64  epoch;     //* 发送端条带化连接组的版本，组内连接增删后更新
+    __le64  stripe_id; //* 同一epoch内从0递增
+    __le64  prev_epoch; //* 上一个epoch，没有时为0
+    __le64  prev_cnt;  //* 上一个epoch中发送的消息数
+    __le32  total_len; //* 原消息数据部分的字节数
+    __le32  frag_off;  //* 分片在原消息数据部分的偏移
+    __u8    frag_cnt;  //* 为0时表示发送端放弃了该消息
+    __u8    type;      //* 原消息头部
+    __u8    flag;
+    __u8    priority;
+    __u8    reserved;
+} __attribute__ ((packed));
+
 struct msger_id_t {
     uint32_t ip     {0};    // just for ipv4
     uint16_t port   {0};  // port
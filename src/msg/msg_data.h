@@ -7,6 +7,7 @@
  * 
  * - msg_rdma_header_d 消息模块rdma头部(使用较少)
  * - msg_declare_id_d 用于建立连接时交换身份信息
+ * - msg_stripe_d 条带化消息分片的头部
  */
 #ifndef FLAME_MSG_MSG_DATA_H
 #define FLAME_MSG_MSG_DATA_H
@@ -143,6 +144,23 @@ struct msg_declare_id_d : public MsgData{
 };
 
 
+//* 同msg_declare_id_d，没有考虑大小端问题
+struct msg_stripe_d : public MsgData{
+    flame_msg_stripe_hdr_t hdr;
+
+    virtual size_t size() override {
+        return sizeof(flame_msg_stripe_hdr_t);
+    }
+
+    virtual int encode(MsgBufferList& bl) override{
+        return M_ENCODE(bl, hdr);
+    }
+
+    virtual int decode(MsgBufferList::iterator& it) override{
+        return M_DECODE(it, hdr);
+    }
+};
+
 } //namespace msg
 } //namespace flame
 
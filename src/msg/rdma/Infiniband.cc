@@ -15,6 +15,10 @@ namespace ib{
 static const uint32_t MAX_SHARED_RX_SGE_COUNT = 2;
 static const uint32_t TCP_MSG_LEN = 
  sizeof("0000:00000000:00000000:00000000:00:00000000000000000000000000000000");
+// bytes, qpn and psn of a size class, appended to TCP_MSG_LEN for each of
+// FLAME_RDMA_SRQ_SIZE_CLASSES_MAX, unused ones are zero.
+static const uint32_t TCP_MSG_LANE_LEN = 
+                                sizeof(":00000000:00000000:00000000") - 1;
 static const uint32_t CQ_DEPTH = 30000;
 
 Port::Port(MsgContext *c, struct ibv_context* ictxt, uint8_t ipn)
@@ -590,6 +594,24 @@ bool Infiniband::init(){
     ML(mct, info, "max inline data: {}", mct->config->rdma_max_inline_data);
 
     memory_manager = new MemoryManager(mct, pd);
+
+    auto &size_classes = mct->config->rdma_srq_size_classes;
+    if(!size_classes.empty()){
+        if(enable_srq && mct->config->rdma_conn_version == 1){
+            for(auto bytes : size_classes){
+                class_memory_managers.push_back(
+                                        new MemoryManager(mct, pd, bytes));
+                ML(mct, info, "srq size class: {}", bytes);
+            }
+        }else{
+            ML(mct, warn, "rdma_srq_size_classes needs srq and "
+                            "rdma_conn_version 1, ignore it.");
+        }
+    }
+
+    if(mct->config->rdma_mr_cache_size > 0){
+        mr_cache = new RdmaMrCache(mct, pd, mct->config->rdma_mr_cache_size);
+    }
     
     return true;
 }
@@ -597,6 +619,11 @@ bool Infiniband::init(){
 Infiniband::~Infiniband(){
     if (!initialized)
         return;
+    for(auto mm : class_memory_managers){
+        delete mm;
+    }
+    class_memory_managers.clear();
+    delete mr_cache;
     delete memory_manager;
     delete pd;
     delete device_list;
@@ -667,11 +694,15 @@ int Infiniband::post_chunks_to_rq(std::vector<Chunk*> &chunks, ibv_qp *qp){
 }
 
 int Infiniband::post_chunks_to_srq(int num, ibv_srq *srq){
-    return m_post_chunks_to_rq(num, srq, true);
+    return m_post_chunks_to_rq(num, srq, true, memory_manager);
+}
+
+int Infiniband::post_chunks_to_srq(int num, ibv_srq *srq, int cls){
+    return m_post_chunks_to_rq(num, srq, true, get_memory_manager(cls));
 }
 
 int Infiniband::post_chunks_to_rq(int num, ibv_qp *qp){
-    return m_post_chunks_to_rq(num, qp, false);
+    return m_post_chunks_to_rq(num, qp, false, memory_manager);
 }
 
 void Infiniband::post_chunks_to_pool(std::vector<Chunk *> &chunks){
@@ -725,13 +756,14 @@ int Infiniband::m_post_chunks_to_rq(std::vector<Chunk*> &chunks,
     return num;
 }
 
-int Infiniband::m_post_chunks_to_rq(int num, void *qp, bool is_srq){
+int Infiniband::m_post_chunks_to_rq(int num, void *qp, bool is_srq,
+                                                        MemoryManager *mm){
     int ret, i = 0, r = 0;
 
     Chunk *chunk;
     std::vector<Chunk *> chunk_list;
-    int bytes = num * get_memory_manager()->get_buffer_size();
-    r = get_memory_manager()->get_buffers(bytes, chunk_list);
+    int bytes = num * mm->get_buffer_size();
+    r = mm->get_buffers(bytes, chunk_list);
 
     if(r < num){
         ML(mct, warn, 
@@ -766,7 +798,8 @@ CompletionQueue *Infiniband::create_comp_queue(MsgContext *mct,
 }
 
 int Infiniband::encode_msg(MsgContext *mct, IBSYNMsg& im, MsgBuffer &buffer){
-    if(buffer.length() < TCP_MSG_LEN){
+    int len = get_ib_syn_msg_len();
+    if(buffer.length() < len){
         return -1;
     }
     char gid[33];
@@ -775,23 +808,84 @@ int Infiniband::encode_msg(MsgContext *mct, IBSYNMsg& im, MsgBuffer &buffer){
                             im.lid, im.qpn, im.psn, im.peer_qpn, im.sl, gid);
     ML(mct, info, "{}, {}, {}, {}, {}, {}", 
                             im.lid, im.qpn, im.psn, im.peer_qpn, im.sl, gid);
-    buffer.set_offset(TCP_MSG_LEN);
-    return TCP_MSG_LEN;
+    char *lane = buffer.data() + TCP_MSG_LEN - 1;
+    for(int i = 0;i < FLAME_RDMA_SRQ_SIZE_CLASSES_MAX;++i){
+        if(i + 1 < get_size_class_num()){
+            sprintf(lane, ":%08x:%08x:%08x", get_size_class_bytes(i), 
+                                            im.lane_qpn[i], im.lane_psn[i]);
+        }else{
+            sprintf(lane, ":%08x:%08x:%08x", 0, 0, 0);
+        }
+        lane += TCP_MSG_LANE_LEN;
+    }
+    buffer.set_offset(len);
+    return len;
 }
 int Infiniband::decode_msg(MsgContext *mct, IBSYNMsg& im, MsgBuffer &buffer){
-    if(buffer.offset() < TCP_MSG_LEN){
+    int len = get_ib_syn_msg_len();
+    if(buffer.offset() < len){
         return -1;
     }
     char gid[33];
-    sscanf(buffer.data(), "%hu:%x:%x:%x:%hhx:%s", &(im.lid), &(im.qpn), 
+    sscanf(buffer.data(), "%hu:%x:%x:%x:%hhx:%32s", &(im.lid), &(im.qpn), 
                                     &(im.psn), &(im.peer_qpn), &(im.sl), gid);
     wire_gid_to_gid(gid, &(im.gid));
     ML(mct, info, "{}, {}, {}, {}, {}, {}", 
                         im.lid, im.qpn, im.psn, im.peer_qpn, im.sl, gid);
-    return TCP_MSG_LEN;
+    //lanes pair up by index, so both ends must have the same classes.
+    const char *lane = buffer.data() + TCP_MSG_LEN - 1;
+    bool match = true;
+    std::string local_classes, peer_classes;
+    for(int i = 0;i < FLAME_RDMA_SRQ_SIZE_CLASSES_MAX;++i){
+        uint32_t lane_bytes, lane_qpn, lane_psn;
+        if(sscanf(lane, ":%8x:%8x:%8x", &lane_bytes, &lane_qpn, 
+                                                        &lane_psn) != 3){
+            ML(mct, error, "bad size class {} in peer_msg.", i);
+            return -1;
+        }
+        uint32_t local_bytes = i + 1 < get_size_class_num() ? 
+                                                get_size_class_bytes(i) : 0;
+        if(lane_bytes != local_bytes){
+            match = false;
+        }
+        if(local_bytes){
+            local_classes += fmt::format(" {}", local_bytes);
+        }
+        if(lane_bytes){
+            peer_classes += fmt::format(" {}", lane_bytes);
+        }
+        im.lane_qpn[i] = lane_qpn;
+        im.lane_psn[i] = lane_psn;
+        lane += TCP_MSG_LANE_LEN;
+    }
+    if(!match){
+        ML(mct, error, "rdma_srq_size_classes mismatch, local:[{} ], "
+            "peer:[{} ]. Both ends must use the same classes.", 
+            local_classes, peer_classes);
+        return -1;
+    }
+    return len;
+}
+
+uint32_t Infiniband::get_size_class_bytes(int cls){
+    return get_memory_manager(cls)->get_buffer_size();
 }
-int Infiniband::get_ib_syn_msg_len(){
-    return TCP_MSG_LEN;
+
+int Infiniband::get_size_class(uint32_t bytes) const{
+    int cls = 0;
+    while(cls < class_memory_managers.size()
+        && class_memory_managers[cls]->get_buffer_size() < bytes){
+        ++cls;
+    }
+    return cls;
+}
+
+MemoryManager* Infiniband::get_memory_manager_by_chunk(Chunk *chunk){
+    return get_memory_manager(get_size_class(chunk->bytes));
+}
+
+int Infiniband::get_ib_syn_msg_len() const{
+    return TCP_MSG_LEN + FLAME_RDMA_SRQ_SIZE_CLASSES_MAX * TCP_MSG_LANE_LEN;
 }
 
 void Infiniband::wire_gid_to_gid(const char *wgid, union ibv_gid *gid){
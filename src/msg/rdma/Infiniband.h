@@ -9,7 +9,9 @@
 #include "msg/internal/msg_buffer.h"
 #include "msg/internal/errno.h"
 #include "msg/msg_def.h"
+#include "msg/internal/msg_config.h"
 #include "MemoryManager.h"
+#include "RdmaMrCache.h"
 
 
 namespace flame{
@@ -27,6 +29,9 @@ struct IBSYNMsg {
     uint32_t peer_qpn;
     uint8_t sl;
     union ibv_gid gid;
+    // qps of rdma_srq_size_classes, the number is decided by config.
+    uint32_t lane_qpn[FLAME_RDMA_SRQ_SIZE_CLASSES_MAX];
+    uint32_t lane_psn[FLAME_RDMA_SRQ_SIZE_CLASSES_MAX];
 } __attribute__((packed));
 
 class Port {
@@ -127,6 +132,7 @@ public:
 };
 
 class ProtectionDomain {
+private:
     MsgContext *mct;
     ProtectionDomain(MsgContext *mct, ibv_pd* ipd);
 public:
@@ -299,6 +305,10 @@ class Infiniband{
     uint32_t max_sge;
     uint8_t  ib_physical_port = 0;
     MemoryManager* memory_manager = nullptr;
+    // one for each of rdma_srq_size_classes, empty when disabled.
+    std::vector<MemoryManager *> class_memory_managers;
+    // nullptr when rdma_mr_cache_size is 0.
+    RdmaMrCache *mr_cache = nullptr;
     Device *device = nullptr;
     ProtectionDomain *pd = nullptr;
     DeviceList *device_list = nullptr;
@@ -311,7 +321,8 @@ class Infiniband{
     uint8_t port_num;
     bool enable_srq = false;
     int m_post_chunks_to_rq(std::vector<Chunk*> &chunks, void *qp, bool is_srq);
-    int m_post_chunks_to_rq(int num, void *qp, bool is_srq);
+    int m_post_chunks_to_rq(int num, void *qp, bool is_srq, 
+                                                            MemoryManager *mm);
 public:
     explicit Infiniband(MsgContext *c);
     ~Infiniband();
@@ -328,6 +339,8 @@ public:
     int  post_chunks_to_rq(std::vector<Chunk*> &chunks, ibv_qp *qp);
     // post rx buffers to srq, return number of buffers actually posted
     int  post_chunks_to_srq(int num, ibv_srq *srq);
+    // post rx buffers of size class cls to srq.
+    int  post_chunks_to_srq(int num, ibv_srq *srq, int cls);
     int  post_chunks_to_rq(int num, ibv_qp *qp);
     void post_chunks_to_pool(std::vector<Chunk *> &chunks);
     void post_chunk_to_pool(Chunk* chunk);
@@ -338,10 +351,27 @@ public:
     uint8_t get_ib_physical_port() { return ib_physical_port; }
     int encode_msg(MsgContext *mct, IBSYNMsg& msg, MsgBuffer &buffer);
     int decode_msg(MsgContext *mct, IBSYNMsg& msg, MsgBuffer &buffer);
-    static int get_ib_syn_msg_len();
+    int get_ib_syn_msg_len() const;
     uint16_t get_lid() { return device->get_lid(); }
     ibv_gid get_gid() { return device->get_gid(); }
     MemoryManager* get_memory_manager() { return memory_manager; }
+    /**
+     * Size classes are rdma_srq_size_classes in ascending order, 
+     * and the last one is rdma_buffer_size.
+     */
+    int get_size_class_num() const { return class_memory_managers.size() + 1; }
+    MemoryManager* get_memory_manager(int cls) {
+        if(cls < 0 || cls >= class_memory_managers.size()){
+            return memory_manager;
+        }
+        return class_memory_managers[cls];
+    }
+    uint32_t get_size_class_bytes(int cls);
+    // the smallest size class that can hold bytes.
+    int get_size_class(uint32_t bytes) const;
+    // chunks must be returned to the MemoryManager of their size class.
+    MemoryManager* get_memory_manager_by_chunk(Chunk *chunk);
+    RdmaMrCache *get_mr_cache() { return mr_cache; }
     Device* get_device() { return device; }
     ProtectionDomain *get_pd() { return pd; }
     int get_async_fd() { return device->ctxt->async_fd; }
@@ -172,22 +172,31 @@ void PoolAllocator::free(char * const block){
     m->mmgr->free(m);
 }
 
-MemoryManager::MemoryManager(MsgContext *c, ProtectionDomain *p)
-: mct(c), pd(p), buffer_size(c->config->rdma_buffer_size),
+MemoryManager::MemoryManager(MsgContext *c, ProtectionDomain *p, 
+                                                            uint32_t buf_size)
+: mct(c), pd(p), 
+    buffer_size(buf_size?buf_size:c->config->rdma_buffer_size),
     hugepage_size(c->config->rdma_hugepage_size),
     lock(MUTEX_TYPE_ADAPTIVE_NP), huge_page_map_lock(MUTEX_TYPE_ADAPTIVE_NP),
-    mem_pool(this, sizeof(Chunk) + mct->config->rdma_buffer_size,
-                                                        calcu_init_space(c)){
-    rdma_buffer_allocator = new RdmaBufferAllocator(this);
-    assert(rdma_buffer_allocator);
-    int r = rdma_buffer_allocator->init();
-    assert(r == 0);
-    ML(mct, info, "hugepage size: {}", size_str_from_uint64(hugepage_size));
+    mem_pool(this, 
+            sizeof(Chunk) + (buf_size?buf_size:c->config->rdma_buffer_size),
+            calcu_init_space(c, buf_size)),
+    n_bufs_allocated(0), rdma_buffer_allocator(nullptr){
+    if(buf_size == 0){
+        rdma_buffer_allocator = new RdmaBufferAllocator(this);
+        assert(rdma_buffer_allocator);
+        int r = rdma_buffer_allocator->init();
+        assert(r == 0);
+        ML(mct, info, "hugepage size: {}", 
+                                        size_str_from_uint64(hugepage_size));
+    }
 }
 
 MemoryManager::~MemoryManager(){
-    rdma_buffer_allocator->fin();
-    delete rdma_buffer_allocator;
+    if(rdma_buffer_allocator){
+        rdma_buffer_allocator->fin();
+        delete rdma_buffer_allocator;
+    }
     mem_pool.purge_memory();
 }
 
@@ -264,9 +273,14 @@ void MemoryManager::release_buffers(std::vector<Chunk*> &c){
     }
 }
 
-uint64_t MemoryManager::calcu_init_space(MsgContext *mct){
+uint64_t MemoryManager::calcu_init_space(MsgContext *mct, uint32_t buf_size){
     auto config = mct->config;
 
+    if(buf_size != 0){
+        // size class pool grows with the traffic of its class.
+        return config->rdma_recv_queue_len;
+    }
+
     uint64_t default_init_space = 
             64 * (config->rdma_recv_queue_len + config->rdma_send_queue_len);
 
@@ -5,6 +5,7 @@
 #include <boost/pool/pool.hpp>
 #include <map>
 #include <vector>
+#include <atomic>
 
 #include "msg/msg_context.h"
 #include "common/thread/mutex.h"
@@ -105,9 +106,15 @@ public:
 
 class RdmaBufferAllocator;
 
+/**
+ * MemoryManager with default buf_size (rdma_buffer_size) provides the tx/rx
+ * chunks and the RdmaBufferAllocator.
+ * The others provide the chunks of rdma_srq_size_classes, for the srqs and
+ * the lanes of RdmaConnection. They are not limited by rdma_buffer_num.
+ */
 class MemoryManager{
 public:
-    MemoryManager(MsgContext *c, ProtectionDomain *p);
+    MemoryManager(MsgContext *c, ProtectionDomain *p, uint32_t buf_size=0);
     ~MemoryManager();
 
     void* malloc(size_t size);
@@ -152,15 +159,20 @@ public:
         n_bufs_allocated += nbufs;
     }
 
+    uint64_t get_registered_bytes() const{
+        return (uint64_t)n_bufs_allocated.load(std::memory_order_relaxed)
+                                            * (sizeof(Chunk) + buffer_size);
+    }
+
     bool can_alloc(unsigned nbufs){
         auto msg_cfg = mct->config;
-        if(msg_cfg->rdma_buffer_num <= 0){
+        if(msg_cfg->rdma_buffer_num <= 0 || !rdma_buffer_allocator){
             return true;
         } 
         if(msg_cfg->rdma_buffer_num < (n_bufs_allocated + nbufs)){
             ML(mct, error, 
                 "rdma buffer number reach limit: {}, need: {}, allocted: {}", 
-                msg_cfg->rdma_buffer_num, nbufs, n_bufs_allocated);
+                msg_cfg->rdma_buffer_num, nbufs, n_bufs_allocated.load());
             return false;
         }
         return true;
@@ -175,7 +187,7 @@ private:
     Mutex lock;
     ProtectionDomain *pd;
     MemPool mem_pool;
-    unsigned n_bufs_allocated;
+    std::atomic<unsigned> n_bufs_allocated;
     Mutex huge_page_map_lock;
     std::map<void *, size_t> huge_page_map;
     const uint32_t buffer_size;
@@ -187,7 +199,7 @@ private:
     void* huge_pages_malloc(size_t size);
     void  huge_pages_free(void *ptr);
 
-    static uint64_t calcu_init_space(MsgContext *c);
+    static uint64_t calcu_init_space(MsgContext *c, uint32_t buf_size);
 
     RdmaBufferAllocator *rdma_buffer_allocator;
 };
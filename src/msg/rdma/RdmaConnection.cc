@@ -4,6 +4,7 @@
 #include "msg/internal/byteorder.h"
 #include "msg/internal/node_addr.h"
 #include "msg/internal/errno.h"
+#include "util/cycles.h"
 
 #include <algorithm>
 #include <iterator>
@@ -93,10 +94,13 @@ public:
 };
 
 void RdmaConnection::recv_msg_cb(Msg *msg){
+    uint64_t start = get_cycles();
+    account_rx(msg->total_bytes(), 1);
     if(get_listener()){
         get_listener()->on_conn_recv(this, msg);
     }
     msg->put();
+    account_cpu(get_cycles() - start);
 }
 
 RdmaConnection::RdmaConnection(MsgContext *mct)
@@ -137,7 +141,28 @@ RdmaConnection *RdmaConnection::create(MsgContext *mct, RdmaWorker *w,
     my_msg.sl = sl;
     my_msg.gid = ib.get_gid();
 
+    // one lane for each rdma_srq_size_classes, except the last class.
+    for(int i = 0;i + 1 < w->get_srq_class_num();++i){
+        auto lane_qp = ib.create_queue_pair(mct, w->get_tx_cq(), 
+                                                w->get_rx_cq(), w->get_srq(i),
+                                                IBV_QPT_RC);
+        if(!lane_qp){
+            ML(mct, error, "can't create qp for srq size class {}", i);
+            conn->put();
+            return nullptr;
+        }
+        auto lane = new rdma_lane_t();
+        lane->qp = lane_qp;
+        conn->lanes.push_back(lane);
+        my_msg.lane_qpn[i] = lane_qp->get_local_qp_number();
+        my_msg.lane_psn[i] = lane_qp->get_initial_psn();
+    }
+
     w->reg_rdma_conn(my_msg.qpn, conn);
+    for(auto lane : conn->lanes){
+        w->reg_rdma_conn(lane->qp->get_local_qp_number(), conn);
+        lane->qp->user_ctx = conn;
+    }
     if(!qp->has_srq() && mct->config->rdma_conn_version != 2){
         auto required_rx_len = ib.get_rx_queue_len();
         auto actual_posted = w->post_chunks_to_rq(required_rx_len, 
@@ -173,6 +198,14 @@ RdmaConnection::~RdmaConnection(){
             wr->on_send_cancelled(false);
             pending_send_wrs.pop_front();
         }
+        //the signaled wrs after them will never complete.
+        for(auto &e : inflight_send_wrs){
+            if(e.second){
+                e.first->get_ibv_send_wr()->send_flags |= IBV_SEND_SIGNALED;
+                e.first->on_send_cancelled(false);
+            }
+        }
+        inflight_send_wrs.clear();
     }
 
     if(qp){
@@ -180,6 +213,15 @@ RdmaConnection::~RdmaConnection(){
         qp = nullptr;
     }
 
+    for(auto lane : lanes){
+        delete lane->qp;
+        if(lane->recv_cur_msg){
+            lane->recv_cur_msg->put();
+        }
+        delete lane;
+    }
+    lanes.clear();
+
     std::list<Msg *> msgs;
     std::list<RdmaRwWork *> rw_works;
     {
@@ -229,7 +271,6 @@ size_t RdmaConnection::recv_data(){
     ML(mct, info, "poll queue got {} responses. QP: {}", 
                                                         cqe.size(), my_msg.qpn);
     std::vector<Chunk *> chunks;
-    bool got_close_msg = false;
     auto it = cqe.begin();
     size_t total = 0;
     while(it != cqe.end()){
@@ -249,8 +290,9 @@ size_t RdmaConnection::recv_data(){
             chunks.push_back(chunk);
         }else if(response->byte_len == 0
                  && !(response->wc_flags & IBV_WC_WITH_IMM)){
-            if(!got_close_msg){
-                got_close_msg = true;
+            //each qp sends one fin msg, the last one closes the conn.
+            ++recv_fin_cnt;
+            if(recv_fin_cnt == lanes.size() + 1){
                 ML(mct, debug, "RdmaConn({}) got remote close msg...", 
                                                             (void *)this);
                 if(status == RdmaStatus::CLOSING_POSITIVE){
@@ -260,12 +302,25 @@ size_t RdmaConnection::recv_data(){
                     status = RdmaStatus::CLOSING_PASSIVE;
                 }
             }
-            rdma_worker->get_memory_manager()->release_buffer(chunk);
+            rdma_worker->release_buffer(chunk);
         }else{
             ML(mct, debug, "chunk length: {} bytes.  {:p}", response->byte_len, 
                                                         (void*)chunk);
             total += response->byte_len;
-            decode_rx_buffer(chunk);
+            rdma_lane_t *lane = nullptr;
+            for(auto l : lanes){
+                if(l->qp->get_local_qp_number() == response->qp_num){
+                    lane = l;
+                    break;
+                }
+            }
+            if(lane){
+                decode_rx_buffer(chunk, lane->recv_cur_msg, 
+                                    lane->recv_cur_msg_header_buffer,
+                                    lane->recv_cur_msg_offset);
+            }else{
+                decode_rx_buffer(chunk);
+            }
             chunks.push_back(chunk);
         }
         ++it;
@@ -275,10 +330,10 @@ size_t RdmaConnection::recv_data(){
     if(status == RdmaStatus::CLOSING_PASSIVE
         || status == RdmaStatus::CLOSED
         || status == RdmaStatus::ERROR){ 
-        rdma_worker->get_memory_manager()->release_buffers(chunks);
+        rdma_worker->release_buffers(chunks);
     }else if(qp->has_srq()){
         //release rx buffers 
-        rdma_worker->get_memory_manager()->release_buffers(chunks);
+        rdma_worker->release_buffers(chunks);
     }else {
         //return to self rq if no srq.
         rdma_worker->post_chunks_to_rq(chunks, qp->get_qp());
@@ -292,10 +347,15 @@ size_t RdmaConnection::recv_data(){
 }
 
 int RdmaConnection::decode_rx_buffer(ib::Chunk *chunk){
+    return decode_rx_buffer(chunk, recv_cur_msg, recv_cur_msg_header_buffer,
+                                recv_cur_msg_offset);
+}
+
+int RdmaConnection::decode_rx_buffer(ib::Chunk *chunk, Msg *&recv_cur_msg,
+                                        MsgBuffer &recv_header_buffer, 
+                                        uint32_t &recv_offset){
     uint32_t bytes = 0;
     // std::list<Msg *> msgs;
-    MsgBuffer &recv_header_buffer = recv_cur_msg_header_buffer;
-    auto &recv_offset = recv_cur_msg_offset;
     while(!chunk->over()){
         if(!recv_cur_msg){
             recv_cur_msg = Msg::alloc_msg(mct, msg_ttype_t::RDMA);
@@ -467,7 +527,50 @@ int RdmaConnection::submit_send_works(){
     return r;
 }
 
+int RdmaConnection::get_lane_index(Msg *msg){
+    //lanes don't keep the order with other qps, ordered msgs use qp.
+    if(!msg->is_unordered()){
+        return lanes.size();
+    }
+    ib::Infiniband &ib = rdma_worker->get_manager()->get_ib();
+    return ib.get_size_class(msg->total_bytes());
+}
+
 int RdmaConnection::post_rdma_send(std::list<Msg*> &msgs){
+    if(lanes.empty()){
+        return post_rdma_send(msgs, qp, rdma_worker->get_memory_manager());
+    }
+    ib::Infiniband &ib = rdma_worker->get_manager()->get_ib();
+    int cnt = 0;
+    while(!msgs.empty()){
+        //split msgs into runs of the same lane.
+        int index = get_lane_index(msgs.front());
+        auto it = std::next(msgs.begin());
+        while(it != msgs.end() && get_lane_index(*it) == index){
+            ++it;
+        }
+        std::list<Msg *> run;
+        run.splice(run.end(), msgs, msgs.begin(), it);
+        ib::QueuePair *tqp = index < lanes.size() ? lanes[index]->qp : qp;
+        int r = post_rdma_send(run, tqp, ib.get_memory_manager(index));
+        bool all_posted = run.empty();
+        if(!all_posted){
+            msgs.splice(msgs.begin(), run);
+        }
+        if(r < 0){
+            return r;
+        }
+        cnt += r;
+        if(!all_posted){
+            //keep the order of msgs in the same lane.
+            break;
+        }
+    }
+    return cnt;
+}
+
+int RdmaConnection::post_rdma_send(std::list<Msg*> &msgs, ib::QueuePair *tqp,
+                                    ib::MemoryManager *memory_manager){
     size_t total_bytes = 0;
     int cnt = 0;
     for(auto m : msgs){
@@ -476,7 +579,6 @@ int RdmaConnection::post_rdma_send(std::list<Msg*> &msgs){
     std::vector<Chunk*> chunks;
     MsgBuffer msg_header_buffer(FLAME_MSG_HEADER_LEN);
 
-    auto memory_manager = rdma_worker->get_memory_manager();
     uint32_t buf_size = memory_manager->get_buffer_size();
     uint32_t tx_queue_len = rdma_worker->get_manager()->get_ib()
                                                             .get_tx_queue_len();
@@ -484,7 +586,7 @@ int RdmaConnection::post_rdma_send(std::list<Msg*> &msgs){
     if(max_wrs == 0) return 0;
 
     //limit for tx_queue_len
-    uint32_t can_post = qp->add_tx_wr_with_limit(max_wrs, tx_queue_len, true);
+    uint32_t can_post = tqp->add_tx_wr_with_limit(max_wrs, tx_queue_len, true);
 
     if(can_post == 0) return 0;
     
@@ -492,7 +594,7 @@ int RdmaConnection::post_rdma_send(std::list<Msg*> &msgs){
 
     memory_manager->get_buffers(total_bytes, chunks);
     if(chunks.size() < can_post){
-        qp->dec_tx_wr(can_post - chunks.size());
+        tqp->dec_tx_wr(can_post - chunks.size());
         if(chunks.size() == 0){
             return 0;
         }
@@ -553,7 +655,7 @@ int RdmaConnection::post_rdma_send(std::list<Msg*> &msgs){
                                             ?std::next(chunk_it)
                                             :chunk_it);
     if(chunks.size() > filled_chunks){
-        qp->dec_tx_wr(chunks.size() - filled_chunks);
+        tqp->dec_tx_wr(chunks.size() - filled_chunks);
         std::vector<Chunk*> sub_chunks(chunks.begin()+filled_chunks,
                                                          chunks.end());
         memory_manager->release_buffers(sub_chunks);
@@ -565,7 +667,7 @@ int RdmaConnection::post_rdma_send(std::list<Msg*> &msgs){
         if((r - l) % RDMA_BATCH_SEND_WR_MAX == 0){
             auto b = chunks.begin();
             std::vector<Chunk*> sub_chunks(b + l, b + r);
-            int result = post_work_request(sub_chunks);
+            int result = post_work_request(sub_chunks, tqp);
             if(result < 0){
                 return result;
             }
@@ -576,7 +678,7 @@ int RdmaConnection::post_rdma_send(std::list<Msg*> &msgs){
     if(r - l > 0){
         auto b = chunks.begin();
         std::vector<Chunk*> sub_chunks(b + l, chunks.end());
-        int result = post_work_request(sub_chunks);
+        int result = post_work_request(sub_chunks, tqp);
         if(result < 0){
             return result;
         }
@@ -589,7 +691,32 @@ int RdmaConnection::activate(){
     if(active){
         return 0;
     }
+
+    int r = activate_qp(qp, peer_msg.qpn, peer_msg.psn, my_msg.psn);
+    if(r){
+        return r;
+    }
+    for(int i = 0;i < lanes.size();++i){
+        r = activate_qp(lanes[i]->qp, peer_msg.lane_qpn[i], 
+                            peer_msg.lane_psn[i], my_msg.lane_psn[i]);
+        if(r){
+            return r;
+        }
+    }
+
+    active = true;
+    status = RdmaStatus::CAN_WRITE;
     
+    if(mct->config->rdma_conn_version == 1){
+        this->submit(false); // trigger submit
+    }else if(mct->config->rdma_conn_version == 2){
+        this->post_send(nullptr);
+    }
+    return 0;
+}
+
+int RdmaConnection::activate_qp(ib::QueuePair *tqp, uint32_t dest_qpn, 
+                                    uint32_t rq_psn, uint32_t sq_psn){
     ibv_qp_attr qpa;
     int r;
     ib::Infiniband &ib = rdma_worker->get_manager()->get_ib();
@@ -599,8 +726,8 @@ int RdmaConnection::activate(){
     qpa.qp_state = IBV_QPS_RTR;
     qpa.path_mtu = ib::Infiniband::ibv_mtu_enum(
                                             mct->config->rdma_path_mtu);
-    qpa.dest_qp_num = peer_msg.qpn;
-    qpa.rq_psn = peer_msg.psn;
+    qpa.dest_qp_num = dest_qpn;
+    qpa.rq_psn = rq_psn;
     qpa.max_dest_rd_atomic = RDMA_QP_MAX_RD_ATOMIC;
     qpa.min_rnr_timer = 12;
     //qpa.ah_attr.is_global = 0;
@@ -620,7 +747,7 @@ int RdmaConnection::activate(){
                                     (int)qpa.ah_attr.grh.sgid_index,
                                     (int)qpa.ah_attr.sl);
     
-    r = ibv_modify_qp(qp->get_qp(), &qpa, IBV_QP_STATE |
+    r = ibv_modify_qp(tqp->get_qp(), &qpa, IBV_QP_STATE |
                                             IBV_QP_AV |
                                             IBV_QP_PATH_MTU |
                                             IBV_QP_DEST_QPN |
@@ -652,10 +779,10 @@ int RdmaConnection::activate(){
     // before giving up. Occurs when the remote side has not yet posted
     // a receive request.
     qpa.rnr_retry = 7; // 7 is infinite retry.
-    qpa.sq_psn = my_msg.psn;
+    qpa.sq_psn = sq_psn;
     qpa.max_rd_atomic = RDMA_QP_MAX_RD_ATOMIC;
 
-    r = ibv_modify_qp(qp->get_qp(), &qpa, IBV_QP_STATE |
+    r = ibv_modify_qp(tqp->get_qp(), &qpa, IBV_QP_STATE |
                                             IBV_QP_TIMEOUT |
                                             IBV_QP_RETRY_CNT |
                                             IBV_QP_RNR_RETRY |
@@ -670,22 +797,15 @@ int RdmaConnection::activate(){
     // the queue pair should be ready to use once the client has finished
     // setting up their end.
     ML(mct, info, "transition to RTS state successfully.");
-    ML(mct, info, "QueuePair:{:p} with qp: {:p}", (void *)qp, 
-                                                        (void *)qp->get_qp());
-    ML(mct, trace, "qpn:{} state:{}", my_msg.qpn, 
-                                    ib.qp_state_string(qp->get_state()));
-    active = true;
-    status = RdmaStatus::CAN_WRITE;
-    
-    if(mct->config->rdma_conn_version == 1){
-        this->submit(false); // trigger submit
-    }else if(mct->config->rdma_conn_version == 2){
-        this->post_send(nullptr);
-    }
+    ML(mct, info, "QueuePair:{:p} with qp: {:p}", (void *)tqp, 
+                                                        (void *)tqp->get_qp());
+    ML(mct, trace, "qpn:{} state:{}", tqp->get_local_qp_number(), 
+                                    ib.qp_state_string(tqp->get_state()));
     return 0;
 }
 
-int RdmaConnection::post_work_request(std::vector<Chunk *> &tx_buffers){
+int RdmaConnection::post_work_request(std::vector<Chunk *> &tx_buffers,
+                                        ib::QueuePair *tqp){
     // ML(mct, debug, "QP：{} {:p}", my_msg.qpn, (void *)tx_buffers.front());
     if(tx_buffers.size() == 0){
         return 0;
@@ -717,7 +837,8 @@ int RdmaConnection::post_work_request(std::vector<Chunk *> &tx_buffers){
             iswr[current_swr].send_flags |= IBV_SEND_INLINE;
         }
 
-        ML(mct, debug, "qp({}) sending buffer: {} length: {} {}", my_msg.qpn,
+        ML(mct, debug, "qp({}) sending buffer: {} length: {} {}", 
+                tqp->get_local_qp_number(),
                 (void *)(*current_buffer), isge[current_sge].length,
                 (iswr[current_swr].send_flags & IBV_SEND_INLINE)?"inline":"" );
 
@@ -730,9 +851,9 @@ int RdmaConnection::post_work_request(std::vector<Chunk *> &tx_buffers){
     }
 
     int r = tx_buffers.size();
-    //qp->add_tx_wr_with_limit() ensure that send queue won't be full.
+    //tqp->add_tx_wr_with_limit() ensure that send queue won't be full.
     ibv_send_wr *bad_tx_work_request = nullptr;
-    if (ibv_post_send(qp->get_qp(), iswr, &bad_tx_work_request)) {
+    if (ibv_post_send(tqp->get_qp(), iswr, &bad_tx_work_request)) {
         if(errno == ENOMEM){
             ML(mct, error, "failed to send data. "
                         "(most probably send queue is full): {}",
@@ -749,11 +870,11 @@ int RdmaConnection::post_work_request(std::vector<Chunk *> &tx_buffers){
                                                         / sizeof(ibv_send_wr);
             assert(done_num <= tx_buffers.size());
             //some wrs not posted.
-            qp->dec_tx_wr(tx_buffers.size() - done_num);
+            tqp->dec_tx_wr(tx_buffers.size() - done_num);
         }
     }
     // ML(mct, debug, "qp state: {}", 
-    //                     ib::Infiniband::qp_state_string(qp->get_state()));
+    //                     ib::Infiniband::qp_state_string(tqp->get_state()));
     return r;
 }
 
@@ -978,28 +1099,35 @@ int RdmaConnection::post_imm_data(std::vector<uint32_t> *imm_data_vec){
 void RdmaConnection::fin(){
     uint32_t tx_queue_len = rdma_worker->get_manager()->get_ib()
                                                             .get_tx_queue_len();
-    uint32_t can_post_wr = qp->add_tx_wr_with_limit(1, tx_queue_len);
-    if(can_post_wr == 0){
-        fin_msg_pending = true;
-        return;
-    }else{
-        fin_msg_pending = false;
-    }
-
+    //each qp sends one fin msg, lanes first.
+    fin_msg_pending = false;
+    for(int i = 0;i <= lanes.size();++i){
+        uint32_t bit = i < lanes.size() ? (1U << (i + 1)) : 1U;
+        ib::QueuePair *tqp = i < lanes.size() ? lanes[i]->qp : qp;
+        if(fin_posted_mask & bit){
+            continue;
+        }
+        uint32_t can_post_wr = tqp->add_tx_wr_with_limit(1, tx_queue_len);
+        if(can_post_wr == 0){
+            fin_msg_pending = true;
+            return;
+        }
 
-    ibv_send_wr wr;
-    memset(&wr, 0, sizeof(wr));
-    wr.wr_id = reinterpret_cast<uint64_t>(qp);
-    wr.num_sge = 0;
-    wr.opcode = IBV_WR_SEND;
-    wr.send_flags |= IBV_SEND_SIGNALED;
-    ibv_send_wr* bad_tx_work_request;
-    if (ibv_post_send(qp->get_qp(), &wr, &bad_tx_work_request)) {
-        ML(mct, warn, "failed to send fin message. "
-            "ibv_post_send failed(most probably should be peer not ready): {}",
-            cpp_strerror(errno));
-        qp->dec_tx_wr(1);
-        return ;
+        ibv_send_wr wr;
+        memset(&wr, 0, sizeof(wr));
+        wr.wr_id = reinterpret_cast<uint64_t>(tqp);
+        wr.num_sge = 0;
+        wr.opcode = IBV_WR_SEND;
+        wr.send_flags |= IBV_SEND_SIGNALED;
+        ibv_send_wr* bad_tx_work_request;
+        if (ibv_post_send(tqp->get_qp(), &wr, &bad_tx_work_request)) {
+            ML(mct, warn, "failed to send fin message. ibv_post_send "
+                "failed(most probably should be peer not ready): {}",
+                cpp_strerror(errno));
+            tqp->dec_tx_wr(1);
+            return ;
+        }
+        fin_posted_mask |= bit;
     }
     if(status != RdmaStatus::CLOSING_PASSIVE
         && status != RdmaStatus::CLOSED
@@ -1008,6 +1136,13 @@ void RdmaConnection::fin(){
     }
 }
 
+void RdmaConnection::qps_to_dead(){
+    qp->to_dead();
+    for(auto lane : lanes){
+        lane->qp->to_dead();
+    }
+}
+
 void RdmaConnection::do_close(){
     status = RdmaStatus::CLOSED;
     this->get_listener()->on_conn_error(this);
@@ -1056,6 +1191,40 @@ static void event_fn_post_send(void *arg1, void *arg2){
     conn->post_send(wr);
 }
 
+static void event_fn_post_send_batched(void *arg1, void *arg2){
+    RdmaConnection *conn = (RdmaConnection *)arg1;
+    RdmaSendWr *wr = (RdmaSendWr *)arg2;
+    conn->post_send_batched(wr);
+}
+
+static void event_fn_flush_send(void *arg1, void *arg2){
+    RdmaConnection *conn = (RdmaConnection *)arg1;
+    conn->flush_send();
+    conn->put();
+}
+
+void RdmaConnection::post_send_batched(RdmaSendWr *wr){
+    if(!rdma_worker->get_owner()->am_self()){
+        rdma_worker->get_owner()->post_work(event_fn_post_send_batched, 
+                                                                    this, wr);
+        return;
+    }
+    //wr will be cancelled when conn can't write.
+    post_send(wr, true);
+    if(send_flush_posted || pending_send_wrs.empty()){
+        return;
+    }
+    send_flush_posted = true;
+    // avoid conn released before posted work called.
+    this->get();
+    rdma_worker->get_owner()->post_work(event_fn_flush_send, this, nullptr);
+}
+
+void RdmaConnection::flush_send(){
+    send_flush_posted = false;
+    post_send(nullptr);
+}
+
 void RdmaConnection::post_send(RdmaSendWr *wr, bool more){
     if(status != RdmaStatus::INIT
         && status != RdmaStatus::CAN_WRITE
@@ -1103,12 +1272,34 @@ void RdmaConnection::post_send(RdmaSendWr *wr, bool more){
     //prepare wrs.
     uint32_t can_post_cnt = qp->add_tx_wr_with_limit(pending_send_wrs.size(),
                                                         tx_queue_len, true);
+    if(can_post_cnt > 0){
+        rdma_worker->record_post_batch(can_post_cnt);
+    }
     uint32_t i;
     for(i = 0;i + 1 < can_post_cnt;++i){
         pending_send_wrs[i]->get_ibv_send_wr()->next =
                                         pending_send_wrs[i+1]->get_ibv_send_wr();
     }
     pending_send_wrs[i]->get_ibv_send_wr()->next = nullptr;
+
+    //selective signaling: keep one of every interval wrs and the last one.
+    uint32_t interval = mct->config->rdma_send_signal_interval;
+    std::vector<bool> &unsignaled = post_unsignaled;
+    if(interval > 1){
+        unsignaled.assign(can_post_cnt, false);
+        for(i = 0;i < can_post_cnt;++i){
+            ibv_send_wr *swr = pending_send_wrs[i]->get_ibv_send_wr();
+            if(!(swr->send_flags & IBV_SEND_SIGNALED)){
+                continue;
+            }
+            if(i + 1 < can_post_cnt && ++unsignaled_send_cnt < interval){
+                swr->send_flags &= ~IBV_SEND_SIGNALED;
+                unsignaled[i] = true;
+            }else{
+                unsignaled_send_cnt = 0;
+            }
+        }
+    }
     
 
     //ibv_post_send()
@@ -1146,6 +1337,18 @@ void RdmaConnection::post_send(RdmaSendWr *wr, bool more){
         }
     }
 
+    if(interval > 1){
+        for(i = 0;i < can_post_cnt;++i){
+            if(i < success_cnt){
+                inflight_send_wrs.emplace_back(pending_send_wrs[i], 
+                                                unsignaled[i]);
+            }else if(unsignaled[i]){
+                pending_send_wrs[i]->get_ibv_send_wr()->send_flags 
+                                                        |= IBV_SEND_SIGNALED;
+            }
+        }
+    }
+
     pending_send_wrs.erase(pending_send_wrs.begin(), 
                                         pending_send_wrs.begin() + success_cnt);
     if(bad_tx_wr){
@@ -1154,6 +1357,33 @@ void RdmaConnection::post_send(RdmaSendWr *wr, bool more){
     }
 }
 
+uint32_t RdmaConnection::reap_unsignaled_send_wrs(RdmaSendWr *wr,
+                                            std::vector<RdmaSendWr *> &done){
+    auto it = inflight_send_wrs.begin();
+    while(it != inflight_send_wrs.end() && it->first != wr){
+        ++it;
+    }
+    if(it == inflight_send_wrs.end()){
+        return 0;
+    }
+    //send queue completes in order, the wrs before wr are done.
+    //The unsignaled members of user's batch are retired by their leader.
+    uint32_t retired = 0;
+    for(auto e = inflight_send_wrs.begin();e != it;++e){
+        if(e->second){
+            e->first->get_ibv_send_wr()->send_flags |= IBV_SEND_SIGNALED;
+            done.push_back(e->first);
+            retired += e->first->get_retired_wr_num();
+        }
+    }
+    //wr itself may be an unsignaled one with error cqe.
+    if(it->second){
+        wr->get_ibv_send_wr()->send_flags |= IBV_SEND_SIGNALED;
+    }
+    inflight_send_wrs.erase(inflight_send_wrs.begin(), std::next(it));
+    return retired;
+}
+
 void RdmaConnection::post_recv(RdmaRecvWr *wr){
     ibv_recv_wr *bad_rx_wr = nullptr;
     bool err = false;
@@ -80,19 +80,58 @@ private:
     MsgBuffer recv_cur_msg_header_buffer;
     Msg *recv_cur_msg = nullptr;
 
+    /**
+     * For rdma_srq_size_classes, one qp(lane) per size class, which recvs
+     * into the srq of its class. Unordered msgs fit in the buffer of a class
+     * are sent by its lane, others by qp, so msgs without
+     * FLAME_MSG_FLAG_UNORDERED keep their order. Each lane has its own
+     * rx stream.
+     */
+    struct rdma_lane_t{
+        ib::QueuePair *qp = nullptr;
+        uint32_t recv_cur_msg_offset = 0;
+        MsgBuffer recv_cur_msg_header_buffer;
+        Msg *recv_cur_msg = nullptr;
+        rdma_lane_t() 
+        : recv_cur_msg_header_buffer(sizeof(flame_msg_header_t)) {}
+    };
+    std::vector<rdma_lane_t *> lanes;
+    // fin msgs recved from qp and lanes.
+    uint32_t recv_fin_cnt = 0;
+    // bit 0 for qp, bit i+1 for lanes[i].
+    uint32_t fin_posted_mask = 0;
+
     std::atomic<RdmaStatus> status;
     std::atomic<bool> fin_msg_pending;
 
     //for RdmaConnection V2
     std::deque<RdmaSendWr *> pending_send_wrs;
+    bool send_flush_posted = false;
+    /**
+     * Posted wrs in order, only when rdma_send_signal_interval > 1.
+     * The wrs whose IBV_SEND_SIGNALED is cleared by conn are marked true,
+     * they are completed by the cqe of a later wr on qp.
+     */
+    std::deque<std::pair<RdmaSendWr *, bool>> inflight_send_wrs;
+    uint32_t unsignaled_send_cnt = 0;
+    // scratch of post_send(), which wrs of the batch are unsignaled.
+    std::vector<bool> post_unsignaled;
     void fin_v2(bool do_close);
 
     void recv_msg_cb(Msg *msg);
-    int post_work_request(std::vector<Chunk *> &tx_buffers);
+    int post_work_request(std::vector<Chunk *> &tx_buffers, 
+                            ib::QueuePair *tqp);
     int post_rdma_send(std::list<Msg *> &msg);
+    int post_rdma_send(std::list<Msg *> &msg, ib::QueuePair *tqp, 
+                            ib::MemoryManager *memory_manager);
+    int activate_qp(ib::QueuePair *tqp, uint32_t dest_qpn, uint32_t rq_psn,
+                            uint32_t sq_psn);
+    int get_lane_index(Msg *msg);
     int submit_send_works();
     int submit_rw_works();
     int decode_rx_buffer(ib::Chunk *chunk);
+    int decode_rx_buffer(ib::Chunk *chunk, Msg *&cur_msg, 
+                            MsgBuffer &header_buffer, uint32_t &offset);
     int reap_send_msg();
     RdmaConnection(MsgContext *mct);
 public:
@@ -143,7 +182,20 @@ public:
     bool is_closed() const { return status == RdmaStatus::CLOSED; }
     bool is_error() const { return status == RdmaStatus::ERROR; }
     ib::QueuePair *get_qp() const { return this->qp; }
-    uint32_t get_tx_wr() const { return this->qp->get_tx_wr(); }
+    ib::QueuePair *get_qp_by_qpn(uint32_t qpn) const {
+        for(auto lane : lanes){
+            if(lane->qp->get_local_qp_number() == qpn) return lane->qp;
+        }
+        return this->qp;
+    }
+    uint32_t get_tx_wr() const { 
+        uint32_t tx_wr = this->qp->get_tx_wr();
+        for(auto lane : lanes){
+            tx_wr += lane->qp->get_tx_wr();
+        }
+        return tx_wr;
+    }
+    void qps_to_dead();
 
     ib::IBSYNMsg &get_my_msg() {
         return my_msg;
@@ -159,6 +211,20 @@ public:
 
     //for RdmaConnection V2
     void post_send(RdmaSendWr *wr, bool more=false);
+    /**
+     * push wr to pending_send_wrs, and post all pending wrs by one
+     * ibv_post_send() after the works already queued in owner are done.
+     * So the wrs posted in one poll iteration share one doorbell.
+     */
+    void post_send_batched(RdmaSendWr *wr);
+    void flush_send();
+    /**
+     * Remove wr and the wrs posted before it from inflight_send_wrs,
+     * the ones unsignaled by conn are completed and pushed to done.
+     * @return: the number of tx wrs retired by done.
+     */
+    uint32_t reap_unsignaled_send_wrs(RdmaSendWr *wr, 
+                                        std::vector<RdmaSendWr *> &done);
     void post_recv(RdmaRecvWr *wr);
     int post_recvs(std::vector<RdmaRecvWr *> &wrs);
     void close_msg_arrive();
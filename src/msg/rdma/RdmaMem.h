@@ -33,6 +33,13 @@ public:
     :m_rkey(rkey), m_buffer(reinterpret_cast<char *>(addr)), data_len(len),
       m_allocator(nullptr) {};
     explicit RdmaBuffer(void *ptr, BuddyAllocator *a);
+    /**
+     * 引用parent中[off, off + len)的一段内存，不拥有内存。
+     * 用于从一块大的注册内存中切分出多个小缓冲。
+     */
+    explicit RdmaBuffer(const RdmaBuffer &parent, size_t off, size_t len)
+    :m_lkey(parent.m_lkey), m_rkey(parent.m_rkey), m_size(len),
+      m_buffer(parent.m_buffer + off), m_allocator(nullptr) {};
     uint32_t lkey() const { return m_lkey; }
     uint32_t rkey() const { return m_rkey; }
     size_t   size() const { return m_size; }
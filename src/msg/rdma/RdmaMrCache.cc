@@ -0,0 +1,243 @@
+#include "RdmaMrCache.h"
+#include "Infiniband.h"
+#include "msg/internal/errno.h"
+
+#include <unistd.h>
+#include <cassert>
+#include <algorithm>
+#include <iterator>
+
+namespace flame{
+namespace msg{
+namespace ib{
+
+RdmaMrCache::RdmaMrCache(MsgContext *c, ProtectionDomain *p, uint64_t max)
+:mct(c), pd(p), max_bytes(max), lock(MUTEX_TYPE_ADAPTIVE_NP),
+ reg_mr_fn(ibv_reg_mr), dereg_mr_fn(ibv_dereg_mr){
+    long page_size = sysconf(_SC_PAGESIZE);
+    if(page_size <= 0){
+        page_size = 4096;
+    }
+    page_mask = ~((uint64_t)page_size - 1);
+}
+
+RdmaMrCache::~RdmaMrCache(){
+    MutexLocker l(lock);
+    for(auto &e : regions){
+        if(e.second->ref > 0){
+            ML(mct, warn, "region [{:x}, {:x}) still referenced({}).",
+                    e.second->start, e.second->end, e.second->ref);
+        }
+        dereg_mr_fn(e.second->mr);
+        delete e.second;
+    }
+    regions.clear();
+    lru.clear();
+}
+
+void RdmaMrCache::detach(RdmaMr *m, std::vector<ibv_mr *> &to_dereg){
+    regions.erase(m->start);
+    m->cached = false;
+    if(m->ref == 0){
+        lru.erase(m->lru_it);
+        reged_bytes -= m->size();
+        to_dereg.push_back(m->mr);
+        delete m;
+    }
+}
+
+bool RdmaMrCache::evict(uint64_t bytes, std::vector<ibv_mr *> &to_dereg){
+    bytes += pending_bytes;
+    while(reged_bytes + bytes > max_bytes && !lru.empty()){
+        ++stat.evict;
+        detach(lru.front(), to_dereg);
+    }
+    return reged_bytes + bytes <= max_bytes;
+}
+
+RdmaMr *RdmaMrCache::lookup(uint64_t s, uint64_t e){
+    auto it = regions.upper_bound(s);
+    if(it == regions.begin()){
+        return nullptr;
+    }
+    RdmaMr *m = std::prev(it)->second;
+    if(m->end < e){
+        return nullptr;
+    }
+    if(m->ref++ == 0){
+        lru.erase(m->lru_it);
+    }
+    return m;
+}
+
+ibv_mr *RdmaMrCache::reg(uint64_t start, uint64_t end){
+    return reg_mr_fn(pd->pd, reinterpret_cast<void *>(start), end - start,
+                        IBV_ACCESS_LOCAL_WRITE
+                        | IBV_ACCESS_REMOTE_WRITE
+                        | IBV_ACCESS_REMOTE_READ);
+}
+
+void RdmaMrCache::dereg(std::vector<ibv_mr *> &to_dereg){
+    for(auto mr : to_dereg){
+        dereg_mr_fn(mr);
+    }
+    to_dereg.clear();
+}
+
+RdmaMr *RdmaMrCache::get(void *addr, size_t len){
+    if(!addr || len == 0){
+        return nullptr;
+    }
+    uint64_t s = reinterpret_cast<uint64_t>(addr);
+    uint64_t e = s + len;
+    std::vector<ibv_mr *> to_dereg;
+    RdmaMr *m = nullptr;
+    uint64_t rs = s & page_mask;
+    uint64_t re = (e + ~page_mask) & page_mask;
+    bool merged = false;
+    uint64_t pending = 0;
+    {
+        MutexLocker l(lock);
+        m = lookup(s, e);
+        if(m){
+            ++stat.hit;
+            return m;
+        }
+        ++stat.miss;
+
+        //merge with the cached regions overlapped.
+        auto it = regions.upper_bound(rs);
+        if(it != regions.begin() && std::prev(it)->second->end > rs){
+            --it;
+        }
+        //the unreferenced ones are replaced by the new region.
+        uint64_t replaced = 0;
+        for(;it != regions.end() && it->first < re;++it){
+            rs = std::min(rs, it->second->start);
+            re = std::max(re, it->second->end);
+            if(it->second->ref == 0){
+                replaced += it->second->size();
+            }
+            merged = true;
+        }
+
+        pending = re - rs - replaced;
+        if(!evict(pending, to_dereg)){
+            ++stat.reg_fail;
+            ML(mct, warn, "region [{:x}, {:x}) exceeds rdma_mr_cache_size "
+                    "{}, {} B in use.", rs, re, max_bytes, reged_bytes);
+            rs = re = 0;
+        }else{
+            pending_bytes += pending;
+        }
+    }
+    dereg(to_dereg);
+    if(rs == re){
+        return nullptr;
+    }
+
+    ibv_mr *mr = reg(rs, re);
+    if(!mr && merged){
+        //the merged regions may have been unmapped.
+        rs = s & page_mask;
+        re = (e + ~page_mask) & page_mask;
+        mr = reg(rs, re);
+    }
+    if(!mr){
+        ML(mct, warn, "failed to register [{:x}, {:x}): {}", rs, re,
+                                                    cpp_strerror(errno));
+    }
+
+    {
+        MutexLocker l(lock);
+        pending_bytes -= pending;
+        //another thread may have registered it meanwhile.
+        m = lookup(s, e);
+        if(m){
+            if(mr){
+                to_dereg.push_back(mr);
+            }
+        }else if(mr){
+            auto it = regions.upper_bound(rs);
+            if(it != regions.begin() && std::prev(it)->second->end > rs){
+                --it;
+            }
+            while(it != regions.end() && it->first < re){
+                detach((it++)->second, to_dereg);
+            }
+            m = new RdmaMr(rs, re, mr);
+            m->ref = 1;
+            m->lru_it = lru.end();
+            regions[rs] = m;
+            reged_bytes += m->size();
+        }else{
+            ++stat.reg_fail;
+        }
+    }
+    dereg(to_dereg);
+    return m;
+}
+
+void RdmaMrCache::put(RdmaMr *m){
+    if(!m) return;
+    ibv_mr *mr = nullptr;
+    {
+        MutexLocker l(lock);
+        assert(m->ref > 0);
+        if(--m->ref > 0){
+            return;
+        }
+        if(m->cached){
+            m->lru_it = lru.insert(lru.end(), m);
+            return;
+        }
+        reged_bytes -= m->size();
+        mr = m->mr;
+        delete m;
+    }
+    dereg_mr_fn(mr);
+}
+
+int RdmaMrCache::invalidate(void *addr, size_t len){
+    uint64_t s = reinterpret_cast<uint64_t>(addr);
+    uint64_t e = s + len;
+    std::vector<ibv_mr *> to_dereg;
+    int cnt = 0;
+    {
+        MutexLocker l(lock);
+        auto it = regions.upper_bound(s);
+        if(it != regions.begin() && std::prev(it)->second->end > s){
+            --it;
+        }
+        while(it != regions.end() && it->first < e){
+            RdmaMr *m = (it++)->second;
+            detach(m, to_dereg);
+            ++cnt;
+        }
+        stat.invalidate += cnt;
+    }
+    dereg(to_dereg);
+    return cnt;
+}
+
+void RdmaMrCache::purge(){
+    std::vector<ibv_mr *> to_dereg;
+    {
+        MutexLocker l(lock);
+        while(!lru.empty()){
+            detach(lru.front(), to_dereg);
+        }
+    }
+    dereg(to_dereg);
+}
+
+void RdmaMrCache::get_stat(rdma_mr_cache_stat_t &s){
+    MutexLocker l(lock);
+    s = stat;
+    s.region_num = regions.size();
+    s.reged_bytes = reged_bytes;
+}
+
+} //namespace ib
+} //namespace msg
+} //namespace flame
@@ -0,0 +1,119 @@
+#ifndef FLAME_MSG_RDMA_RDMA_MR_CACHE_H
+#define FLAME_MSG_RDMA_RDMA_MR_CACHE_H
+
+#include "common/thread/mutex.h"
+#include "msg/msg_context.h"
+
+#include <cstdint>
+#include <list>
+#include <map>
+#include <vector>
+#include <infiniband/verbs.h>
+
+namespace flame{
+namespace msg{
+namespace ib{
+
+class ProtectionDomain;
+class RdmaMrCache;
+
+/**
+ * A registered region of user memory, page aligned.
+ * Between RdmaMrCache::get() and put(), it won't be deregistered even if
+ * it has been invalidated or evicted.
+ */
+class RdmaMr{
+    friend class RdmaMrCache;
+    uint64_t start;
+    uint64_t end;
+    ibv_mr *mr;
+    int ref = 0;
+    // false after invalidated or merged, deregistered when ref drops to 0.
+    bool cached = true;
+    std::list<RdmaMr *>::iterator lru_it;
+
+    RdmaMr(uint64_t s, uint64_t e, ibv_mr *m) : start(s), end(e), mr(m) {}
+public:
+    uint32_t lkey() const { return mr->lkey; }
+    uint32_t rkey() const { return mr->rkey; }
+    uint64_t addr() const { return start; }
+    uint64_t size() const { return end - start; }
+};
+
+struct rdma_mr_cache_stat_t{
+    uint64_t hit = 0;
+    uint64_t miss = 0;
+    uint64_t evict = 0;
+    uint64_t invalidate = 0;
+    uint64_t reg_fail = 0;
+    uint64_t region_num = 0;
+    uint64_t reged_bytes = 0;
+};
+
+/**
+ * Registration cache of user buffers, so that they can be used by rdma
+ * without copying to RdmaBuffer.
+ * Regions are kept in an ordered map by start address and never overlap,
+ * a new registration covering cached regions is merged with them.
+ * ibv_reg_mr() is called on first use, and the least recently used
+ * unreferenced regions are deregistered when the pinned bytes exceed
+ * rdma_mr_cache_size.
+ * ibv_reg_mr()/ibv_dereg_mr() are called without holding the lock, a miss
+ * registers the region first and inserts it after checking again, so a
+ * concurrent miss on the same memory doesn't wait for the registration.
+ * The cache doesn't know when user memory is freed. The user must call
+ * invalidate() before munmap()/free() the memory, or the stale region will
+ * still point to the old pages.
+ */
+class RdmaMrCache{
+private:
+    MsgContext *mct;
+    ProtectionDomain *pd;
+    const uint64_t max_bytes;
+    uint64_t page_mask;
+    Mutex lock;
+    std::map<uint64_t, RdmaMr *> regions; // start, mr
+    std::list<RdmaMr *> lru; // cached and unreferenced, front is the oldest.
+    uint64_t reged_bytes = 0; // including the uncached but referenced ones.
+    uint64_t pending_bytes = 0; // being registered without the lock.
+    rdma_mr_cache_stat_t stat;
+
+    // ibv_reg_mr() and ibv_dereg_mr(), replaced by stubs in tests.
+    ibv_mr *(*reg_mr_fn)(ibv_pd *, void *, size_t, int);
+    int (*dereg_mr_fn)(ibv_mr *);
+
+    // need lock
+    RdmaMr *lookup(uint64_t s, uint64_t e);
+    void detach(RdmaMr *m, std::vector<ibv_mr *> &to_dereg);
+    bool evict(uint64_t bytes, std::vector<ibv_mr *> &to_dereg);
+    // without lock
+    ibv_mr *reg(uint64_t start, uint64_t end);
+    void dereg(std::vector<ibv_mr *> &to_dereg);
+public:
+    RdmaMrCache(MsgContext *c, ProtectionDomain *p, uint64_t max);
+    ~RdmaMrCache();
+
+    /**
+     * Get the registered region covering [addr, addr + len).
+     * @return: nullptr when failed to register, user should fall back to
+     *          RdmaBuffer.
+     */
+    RdmaMr *get(void *addr, size_t len);
+    void put(RdmaMr *m);
+
+    /**
+     * Drop the cached regions overlapping [addr, addr + len).
+     * @return: the number of regions dropped.
+     */
+    int invalidate(void *addr, size_t len);
+    // Deregister all unreferenced regions.
+    void purge();
+
+    void get_stat(rdma_mr_cache_stat_t &s);
+};
+
+} //namespace ib
+} //namespace msg
+} //namespace flame
+
+#endif //FLAME_MSG_RDMA_RDMA_MR_CACHE_H
@@ -15,8 +15,10 @@ namespace msg{
 
 RdmaPrepConn::RdmaPrepConn(MsgContext *mct)
 :EventCallBack(mct, FLAME_EVENT_READABLE | FLAME_EVENT_WRITABLE),
- my_msg_buffer(ib::Infiniband::get_ib_syn_msg_len()),
- peer_msg_buffer(ib::Infiniband::get_ib_syn_msg_len()){
+ my_msg_buffer(Stack::get_rdma_stack()->get_manager()->get_ib()
+                                                .get_ib_syn_msg_len()),
+ peer_msg_buffer(Stack::get_rdma_stack()->get_manager()->get_ib()
+                                                .get_ib_syn_msg_len()){
      status = PrepStatus::INIT;
 }
 
@@ -209,6 +211,11 @@ void RdmaPrepConn::read_cb(){
                 status = PrepStatus::SYNED_PEER_MSG;
                 auto &peer_msg = real_conn->get_peer_msg();
                 int _r = ib.decode_msg(mct, peer_msg, peer_msg_buffer);
+                if(_r < 0){
+                    ML(mct, error, "syn failed: can't decode peer_msg");
+                    this->close();
+                    return;
+                }
                 assert(_r == peer_msg_buffer.length());
                 peer_msg_buffer_offset = 0;
                 auto &my_msg = real_conn->get_my_msg();
@@ -245,6 +252,11 @@ void RdmaPrepConn::read_cb(){
                 status = PrepStatus::SYNED_PEER_MSG;
                 auto &peer_msg = real_conn->get_peer_msg();
                 int _r = ib.decode_msg(mct, peer_msg, peer_msg_buffer);
+                if(_r < 0){
+                    ML(mct, error, "syn failed: can't decode peer_msg");
+                    this->close();
+                    return;
+                }
                 assert(_r == peer_msg_buffer.offset());
                 peer_msg_buffer_offset = 0;
                 auto &my_msg = real_conn->get_my_msg();
@@ -269,6 +281,11 @@ void RdmaPrepConn::read_cb(){
                 status = PrepStatus::ACKED;
                 auto &peer_msg = real_conn->get_peer_msg();
                 int _r = ib.decode_msg(mct, peer_msg, peer_msg_buffer);
+                if(_r < 0){
+                    ML(mct, error, "syn failed: can't decode peer_msg");
+                    this->close();
+                    return;
+                }
                 assert(_r == peer_msg_buffer.offset());
                 peer_msg_buffer_offset = 0;
                 auto &my_msg = real_conn->get_my_msg();
@@ -8,12 +8,11 @@
 #include "msg/internal/errno.h"
 
 #include <cassert>
+#include <algorithm>
 
 namespace flame{
 namespace msg{
 
-static const int RDMA_CQ_MAX_BATCH_COMPLETIONS = 16;
-
 void RdmaTxCqNotifier::read_cb() {
     worker->process_cq_dry_run();
 }
@@ -51,6 +50,15 @@ RdmaWorker::~RdmaWorker(){
         rx_cc = nullptr;
     }
 
+    // the last srq class is srq.
+    for(int i = 0;i + 1 < srq_class_num;++i){
+        if(srq_classes[i].srq){
+            int r = ibv_destroy_srq(srq_classes[i].srq);
+            assert(r == 0);
+            srq_classes[i].srq = nullptr;
+        }
+    }
+
     if(srq){
         int r = ibv_destroy_srq(srq);
         assert(r == 0);
@@ -67,6 +75,9 @@ RdmaWorker::~RdmaWorker(){
 int RdmaWorker::init(){
     ib::Infiniband &ib = manager->get_ib();
     memory_manager = ib.get_memory_manager();
+    wc_buf.resize(mct->config->rdma_cq_poll_batch);
+    recv_repost_batch = std::max(std::min(mct->config->rdma_recv_repost_batch,
+                                            ib.get_rx_queue_len() / 4), 1U);
 
     if(mct->config->rdma_poll_event){
         tx_cc = ib.create_comp_channel(mct);
@@ -85,7 +96,23 @@ int RdmaWorker::init(){
             return 1;
         }
         if(mct->config->rdma_conn_version == 1){
-            ib.post_chunks_to_srq(ib.get_rx_queue_len(), srq);
+            srq_class_num = ib.get_size_class_num();
+            for(int i = 0;i < srq_class_num;++i){
+                auto &sc = srq_classes[i];
+                if(i + 1 < srq_class_num){
+                    sc.srq = ib.create_shared_receive_queue(
+                                                    ib.get_rx_queue_len());
+                    if(!sc.srq){
+                        return 1;
+                    }
+                }else{
+                    sc.srq = srq;
+                }
+                sc.buf_size = ib.get_size_class_bytes(i);
+                sc.target = ib.get_rx_queue_len();
+                sc.posted = ib.post_chunks_to_srq(ib.get_rx_queue_len(), 
+                                                    sc.srq, i);
+            }
         }else if(mct->config->rdma_conn_version == 2){
             post_rdma_recv_wr_to_srq(ib.get_rx_queue_len());
         }
@@ -118,8 +145,8 @@ void RdmaWorker::clear_qp(uint32_t qpn){
 }
 
 int RdmaWorker::process_cq_dry_run(){
-    static int MAX_COMPLETIONS = RDMA_CQ_MAX_BATCH_COMPLETIONS;
-    ibv_wc wc[MAX_COMPLETIONS];
+    ibv_wc *wc = wc_buf.data();
+    int max_cqes = wc_buf.size();
     int total_proc = 0;
     bool has_cq_event = false;
     int tx_ret = 0;
@@ -150,8 +177,8 @@ int RdmaWorker::process_cq_dry_run(){
     }
 
     do{
-        rx_ret = process_rx_cq(wc, MAX_COMPLETIONS);
-        tx_ret = process_tx_cq(wc, MAX_COMPLETIONS);
+        rx_ret = process_rx_cq(wc, max_cqes);
+        tx_ret = process_tx_cq(wc, max_cqes);
         total_proc += (rx_ret + tx_ret);
     }while(rx_ret + tx_ret > 0);
 
@@ -160,6 +187,18 @@ int RdmaWorker::process_cq_dry_run(){
     return total_proc;
 }
 
+static ibv_wc_opcode send_wc_opcode(const ibv_send_wr *wr){
+    switch(wr->opcode){
+    case IBV_WR_RDMA_WRITE:
+    case IBV_WR_RDMA_WRITE_WITH_IMM:
+        return IBV_WC_RDMA_WRITE;
+    case IBV_WR_RDMA_READ:
+        return IBV_WC_RDMA_READ;
+    default:
+        return IBV_WC_SEND;
+    }
+}
+
 void RdmaWorker::handle_tx_cqe(ibv_wc *cqe, int n){
     std::vector<Chunk*> tx_chunks;
     std::set<RdmaConnection *> to_wake_conns;
@@ -168,16 +207,33 @@ void RdmaWorker::handle_tx_cqe(ibv_wc *cqe, int n){
     if(mct->config->rdma_conn_version == 2){
         for(int i = 0;i < n; ++i){
             ibv_wc* response = &cqe[i];
+            if(i + 1 < n){
+                __builtin_prefetch((void *)cqe[i + 1].wr_id);
+            }
 
             auto conn = get_rdma_conn(response->qp_num);
             assert(conn);
+            RdmaSendWr *wr = reinterpret_cast<RdmaSendWr *>(response->wr_id);
+            reaped_send_wrs.clear();
+            uint32_t reaped = conn->reap_unsignaled_send_wrs(wr, 
+                                                            reaped_send_wrs);
             ib::QueuePair *qp = conn->get_qp();
             if(qp){
                 if(qp->get_tx_wr()){
                     //wakeup conn after dec_tx_wr;
                     to_wake_conns.insert(conn);
                 }
-                qp->dec_tx_wr(1);
+                qp->dec_tx_wr(wr->get_retired_wr_num() + reaped);
+            }
+
+            //selective signaling: complete the wrs before wr.
+            for(auto done : reaped_send_wrs){
+                ibv_wc wc = *response;
+                wc.wr_id = reinterpret_cast<uint64_t>(done);
+                wc.status = IBV_WC_SUCCESS;
+                wc.opcode = send_wc_opcode(done->get_ibv_send_wr());
+                done->get_ibv_send_wr()->next = nullptr;
+                done->on_send_done(wc);
             }
 
             ML(mct, debug, "QP: {}, wr_id: {:x}, imm_data:{} {} {}", 
@@ -186,7 +242,6 @@ void RdmaWorker::handle_tx_cqe(ibv_wc *cqe, int n){
                     manager->get_ib().wc_opcode_string(response->opcode),
                     manager->get_ib().wc_status_to_string(response->status));
 
-            RdmaSendWr *wr = reinterpret_cast<RdmaSendWr *>(response->wr_id);
             wr->get_ibv_send_wr()->next = nullptr;
             wr->on_send_done(cqe[i]);
             
@@ -222,7 +277,7 @@ void RdmaWorker::handle_tx_cqe(ibv_wc *cqe, int n){
 
         auto conn = get_rdma_conn(response->qp_num);
         assert(conn);
-        ib::QueuePair *qp = conn->get_qp();
+        ib::QueuePair *qp = conn->get_qp_by_qpn(response->qp_num);
         if(qp){
             if(qp->get_tx_wr()){
                 //wakeup conn after dec_tx_wr;
@@ -299,7 +354,7 @@ void RdmaWorker::handle_tx_cqe(ibv_wc *cqe, int n){
     //     }
     // });
 
-    memory_manager->release_buffers(tx_chunks);
+    release_buffers(tx_chunks);
 }
 
 void RdmaWorker::handle_rdma_rw_cqe(ibv_wc &wc, RdmaConnection *conn){
@@ -343,8 +398,8 @@ void RdmaWorker::handle_rdma_rw_cqe(ibv_wc &wc, RdmaConnection *conn){
 }
 
 int RdmaWorker::process_tx_cq_dry_run(){
-    static int MAX_COMPLETIONS = RDMA_CQ_MAX_BATCH_COMPLETIONS;
-    ibv_wc wc[MAX_COMPLETIONS];
+    ibv_wc *wc = wc_buf.data();
+    int max_cqes = wc_buf.size();
     int total_proc = 0;
     int tx_ret = 0;
 
@@ -357,7 +412,7 @@ int RdmaWorker::process_tx_cq_dry_run(){
     tx_cq->rearm_notify();
 
     do{
-        tx_ret = process_tx_cq(wc, MAX_COMPLETIONS);
+        tx_ret = process_tx_cq(wc, max_cqes);
         total_proc += tx_ret;
     }while(tx_ret > 0);
 
@@ -387,7 +442,7 @@ void RdmaWorker::reap_dead_conns(){
             ++dead_it;
         }else{
             ML(mct, debug, "finally release conn={:p}", (void *)dead_conn);
-            dead_conn->get_qp()->to_dead();
+            dead_conn->qps_to_dead();
             dead_it = dead_conns.erase(dead_it);
         }
     }
@@ -429,6 +484,9 @@ void RdmaWorker::handle_rx_cqe(ibv_wc *cqe, int n){
         std::map<RdmaConnection *, uint32_t> polled;
         for (int i = 0; i < n; ++i) {
             ibv_wc* response = &cqe[i];
+            if(i + 1 < n){
+                __builtin_prefetch((void *)cqe[i + 1].wr_id);
+            }
             ML(mct, debug, "QP: {} len: {}, opcode: {}, wc_flags:{},"
                     " wr_id: {:x} {}", 
                     response->qp_num, response->byte_len, 
@@ -495,6 +553,9 @@ void RdmaWorker::handle_rx_cqe(ibv_wc *cqe, int n){
     for (int i = 0; i < n; ++i) {
         ibv_wc* response = &cqe[i];
         Chunk* chunk = reinterpret_cast<Chunk *>(response->wr_id);
+        if(i + 1 < n){
+            __builtin_prefetch((void *)cqe[i + 1].wr_id);
+        }
         ML(mct, info, "QP: {} len: {}, opcode: {}, wc_flags:{}, addr: {:p} {}", 
                     response->qp_num, response->byte_len, 
                     ib::Infiniband::wc_opcode_string(response->opcode), 
@@ -510,13 +571,13 @@ void RdmaWorker::handle_rx_cqe(ibv_wc *cqe, int n){
                 ML(mct, info, "RdmaConnection with qpn {} may be dead. "
                                 "Return rx buffer {:p} to MemoryManager.",
                                     response->qp_num, (void *)chunk);
-                memory_manager->release_buffer(chunk);
+                release_buffer(chunk);
             } else {
                 polled[conn].push_back(*response);
             }
         }else if(response->status == IBV_WC_WR_FLUSH_ERR){
             //QP transitioned into Error State. Release all rx chunks.
-            memory_manager->release_buffer(chunk);
+            release_buffer(chunk);
         }else{
             //Todo 
             //Not distinguish the error type here.
@@ -528,7 +589,7 @@ void RdmaWorker::handle_rx_cqe(ibv_wc *cqe, int n){
             if (conn)
                 conn->fault();
 
-            memory_manager->release_buffer(chunk);
+            release_buffer(chunk);
         }
     }
     for (auto &i : polled){
@@ -541,8 +602,8 @@ void RdmaWorker::handle_rx_cqe(ibv_wc *cqe, int n){
 }
 
 int RdmaWorker::process_rx_cq_dry_run(){
-    static int MAX_COMPLETIONS = RDMA_CQ_MAX_BATCH_COMPLETIONS;
-    ibv_wc wc[MAX_COMPLETIONS];
+    ibv_wc *wc = wc_buf.data();
+    int max_cqes = wc_buf.size();
     int total_proc = 0;
     int rx_ret = 0;
 
@@ -556,7 +617,7 @@ int RdmaWorker::process_rx_cq_dry_run(){
     rx_cq->rearm_notify();
 
     do{
-        rx_ret = process_rx_cq(wc, MAX_COMPLETIONS);
+        rx_ret = process_rx_cq(wc, max_cqes);
         total_proc += rx_ret;
     }while(rx_ret > 0);
 
@@ -569,8 +630,7 @@ int RdmaWorker::process_rx_cq(ibv_wc *wc, int max_cqes){
         ML(mct, info, "rx completion queue got {} responses.", rx_ret);
         if(mct->config->rdma_conn_version == 1){
             if(srq){
-                srq_buffer_backlog = srq_buffer_backlog + rx_ret - 
-                            post_chunks_to_rq(srq_buffer_backlog + rx_ret);
+                refill_srq_classes(wc, rx_ret);
             }
         }else if(mct->config->rdma_conn_version == 2){
             if(srq){
@@ -604,8 +664,11 @@ int RdmaWorker::process_rx_cq(ibv_wc *wc, int max_cqes){
                 uint32_t rx_queue_len = 
                                     get_manager()->get_ib().get_rx_queue_len();
                 assert(rx_queue_len >= inflight_recv_wrs.size());
-                post_rdma_recv_wr_to_srq(
-                                    rx_queue_len - inflight_recv_wrs.size());
+                //re-post in one chain when enough wrs consumed.
+                uint32_t deficit = rx_queue_len - inflight_recv_wrs.size();
+                if(deficit >= recv_repost_batch){
+                    post_rdma_recv_wr_to_srq(deficit);
+                }
                 
             }
         }
@@ -619,6 +682,105 @@ int RdmaWorker::process_rx_cq(ibv_wc *wc, int max_cqes){
     return 0;
 }
 
+void RdmaWorker::refill_srq_classes(ibv_wc *cqe, int n){
+    ib::Infiniband &ib = manager->get_ib();
+    for(int i = 0;i < n;++i){
+        int cls = srq_class_num - 1;
+        if(srq_class_num > 1){
+            Chunk *chunk = reinterpret_cast<Chunk *>(cqe[i].wr_id);
+            cls = ib.get_size_class(chunk->bytes);
+        }
+        auto &sc = srq_classes[cls];
+        --sc.posted;
+        ++sc.window_consumed;
+        sc.recv_wrs.fetch_add(1, std::memory_order_relaxed);
+        if(cqe[i].status == IBV_WC_SUCCESS){
+            sc.recv_bytes.fetch_add(cqe[i].byte_len, 
+                                                std::memory_order_relaxed);
+        }
+    }
+
+    // only one class, always keep rx_queue_len buffers in srq.
+    srq_window_consumed += n;
+    if(srq_class_num > 1 && srq_window_consumed >= ib.get_rx_queue_len()){
+        adapt_srq_targets();
+    }
+
+    for(int i = 0;i < srq_class_num;++i){
+        auto &sc = srq_classes[i];
+        uint32_t posted = sc.posted, target = sc.target;
+        //re-post in one chain when enough buffers consumed.
+        uint32_t batch = std::min(recv_repost_batch, std::max(target / 4, 1U));
+        if(posted + batch > target) continue;
+        sc.posted += ib.post_chunks_to_srq(target - posted, sc.srq, i);
+    }
+}
+
+/**
+ * Called every rx_queue_len recv wrs consumed.
+ * Keep twice of the last window consumed for each class, grow at once and
+ * shrink at most 1/4 per window, in [max(rx_queue_len/16, 4), rx_queue_len].
+ * So the registered memory follows the msg size distribution.
+ */
+void RdmaWorker::adapt_srq_targets(){
+    uint32_t rx_queue_len = manager->get_ib().get_rx_queue_len();
+    uint32_t lower = std::min(std::max(rx_queue_len >> 4, 4U), rx_queue_len);
+    for(int i = 0;i < srq_class_num;++i){
+        auto &sc = srq_classes[i];
+        uint32_t target = sc.target;
+        uint32_t want = sc.window_consumed * 2;
+        if(want < target){
+            want = std::max(want, target - target / 4);
+        }
+        want = std::min(std::max(want, lower), rx_queue_len);
+        if(want != target){
+            ML(mct, debug, "srq class {}B target {} -> {}", sc.buf_size, 
+                                                                target, want);
+        }
+        sc.target = want;
+        sc.window_consumed = 0;
+    }
+    srq_window_consumed = 0;
+}
+
+void RdmaWorker::release_buffer(Chunk *chunk){
+    manager->get_ib().get_memory_manager_by_chunk(chunk)->release_buffer(chunk);
+}
+
+void RdmaWorker::release_buffers(std::vector<Chunk *> &chunks){
+    ib::Infiniband &ib = manager->get_ib();
+    if(ib.get_size_class_num() == 1){
+        memory_manager->release_buffers(chunks);
+        return;
+    }
+    std::vector<Chunk *> class_chunks[RDMA_SRQ_CLASS_MAX];
+    for(auto chunk : chunks){
+        class_chunks[ib.get_size_class(chunk->bytes)].push_back(chunk);
+    }
+    for(int i = 0;i < ib.get_size_class_num();++i){
+        if(class_chunks[i].empty()) continue;
+        ib.get_memory_manager(i)->release_buffers(class_chunks[i]);
+    }
+}
+
+void RdmaWorker::get_srq_stat(std::vector<rdma_srq_class_stat_t> &stats){
+    ib::Infiniband &ib = manager->get_ib();
+    if(stats.size() < srq_class_num){
+        stats.resize(srq_class_num);
+    }
+    for(int i = 0;i < srq_class_num;++i){
+        auto &sc = srq_classes[i];
+        auto &stat = stats[i];
+        stat.buf_size = sc.buf_size;
+        stat.posted += sc.posted;
+        stat.target += sc.target;
+        stat.recv_wrs += sc.recv_wrs.load(std::memory_order_relaxed);
+        stat.recv_bytes += sc.recv_bytes.load(std::memory_order_relaxed);
+        stat.registered_bytes = 
+                            ib.get_memory_manager(i)->get_registered_bytes();
+    }
+}
+
 /**
  * @return: 0 nothing happend; 1 reg one; -1 unreg one;
  */
@@ -665,7 +827,7 @@ void RdmaWorker::make_conn_dead(RdmaConnection *conn){
         return;
     }
     if(conn->get_tx_wr() == 0 || conn->is_error()){
-        conn->get_qp()->to_dead();
+        conn->qps_to_dead();
     }else{
         dead_conns.push_back(conn);
     }
@@ -756,11 +918,11 @@ int RdmaWorker::reg_poller(MsgWorker *worker){
     if(!worker || mct->config->rdma_poll_event) return 1;
     owner = worker;
     poller_id = worker->reg_poller([this]()->int{
-        static int MAX_COMPLETIONS = RDMA_CQ_MAX_BATCH_COMPLETIONS;
-        ibv_wc wc[MAX_COMPLETIONS];
+        ibv_wc *wc = this->wc_buf.data();
+        int max_cqes = this->wc_buf.size();
         int total_proc = 0;
-        total_proc += this->process_rx_cq(wc, MAX_COMPLETIONS);
-        total_proc += this->process_tx_cq(wc, MAX_COMPLETIONS);
+        total_proc += this->process_rx_cq(wc, max_cqes);
+        total_proc += this->process_tx_cq(wc, max_cqes);
         this->reap_dead_conns();
         return total_proc;
     });
@@ -940,6 +1102,25 @@ RdmaWorker *RdmaManager::get_lightest_load_rdma_worker(){
     return workers[index];
 }
 
+void RdmaManager::get_srq_stat(std::vector<rdma_srq_class_stat_t> &stats){
+    stats.clear();
+    for(auto worker : workers){
+        worker->get_srq_stat(stats);
+    }
+}
+
+void RdmaManager::log_srq_stat(){
+    std::vector<rdma_srq_class_stat_t> stats;
+    get_srq_stat(stats);
+    for(auto &stat : stats){
+        ML(mct, info, "srq class {}B posted:{} target:{} recv_wrs:{} "
+            "recv_bytes:{} fill:{:.1f}% registered:{}KB in_srq:{:.1f}%",
+            stat.buf_size, stat.posted, stat.target, stat.recv_wrs,
+            stat.recv_bytes, stat.fill_ratio() * 100, 
+            stat.registered_bytes >> 10, stat.posted_ratio() * 100);
+    }
+}
+
 int RdmaManager::arm_async_event_handler(MsgWorker *worker){
     if(!worker) return 1;
     auto d = m_ib.get_device();
@@ -1021,6 +1202,10 @@ ib::RdmaBufferAllocator *RdmaStack::get_rdma_allocator() {
     return manager->get_ib().get_memory_manager()->get_rdma_allocator();
 }
 
+ib::RdmaMrCache *RdmaStack::get_mr_cache() {
+    return manager->get_ib().get_mr_cache();
+}
+
 void RdmaStack::on_rdma_prep_conn_close(RdmaPrepConn *conn){
     MutexLocker l(rdma_prep_conns_mutex);
     if(alive_rdma_prep_conns.erase(conn)){
@@ -16,6 +16,7 @@
 #include <deque>
 #include <set>
 #include <functional>
+#include <atomic>
 
 namespace flame{
 namespace msg{
@@ -37,6 +38,15 @@ public:
      * When conn is closed, err will be false.
      */
     virtual void on_send_cancelled(bool err, int eno=0) = 0;
+    /**
+     * The number of wrs retired by this wr's cqe.
+     * With selective signaling, only the last wr of a batch has
+     * IBV_SEND_SIGNALED, and its cqe also retires the unsignaled wrs
+     * posted before it on the same qp.
+     * After a qp error every posted wr gets its own (flush) cqe, so the
+     * unsignaled wrs that already had one must not be counted again.
+     */
+    virtual uint32_t get_retired_wr_num() { return 1; }
 
     virtual ~RdmaSendWr() {}
 };
@@ -113,6 +123,36 @@ public:
 };
 
 
+// bucket i counts the ibv_post_send() calls with [2^i, 2^(i+1)) wrs.
+const int RDMA_POST_BATCH_HIST_BUCKETS = 8;
+
+// rdma_srq_size_classes + rdma_buffer_size
+const int RDMA_SRQ_CLASS_MAX = FLAME_RDMA_SRQ_SIZE_CLASSES_MAX + 1;
+
+/**
+ * Receive buffers of one size class.
+ * The sum of all RdmaWorkers, except registered_bytes which is the whole
+ * class pool.
+ */
+struct rdma_srq_class_stat_t{
+    uint32_t buf_size = 0;
+    uint64_t posted = 0;            // recv wrs in srq now
+    uint64_t target = 0;            // refill target of srq
+    uint64_t recv_wrs = 0;          // consumed recv wrs
+    uint64_t recv_bytes = 0;        // bytes received into them
+    uint64_t registered_bytes = 0;  
+
+    // how full the consumed buffers are.
+    double fill_ratio() const {
+        return recv_wrs == 0 ? 0 : (double)recv_bytes / (recv_wrs * buf_size);
+    }
+    // how much registered memory is waiting in srq.
+    double posted_ratio() const {
+        return registered_bytes == 0 ? 0 
+                : (double)(posted * buf_size) / registered_bytes;
+    }
+};
+
 class RdmaWorker{
     using Chunk = ib::Chunk; 
     MsgContext *mct;
@@ -125,9 +165,33 @@ class RdmaWorker{
     RdmaTxCqNotifier *tx_notifier = nullptr;
     RdmaRxCqNotifier *rx_notifier = nullptr;
     ibv_srq *srq = nullptr; // if srq enabled, one worker has one srq.
-    uint32_t srq_buffer_backlog = 0;
     std::deque<RdmaRecvWr *> inflight_recv_wrs;
 
+    /**
+     * For rdma_conn_version 1, one srq per size class, the last one is srq.
+     * The refill target follows the traffic of each class when there is
+     * more than one class.
+     */
+    struct srq_class_t{
+        ibv_srq *srq = nullptr;
+        uint32_t buf_size = 0;
+        uint32_t window_consumed = 0;
+        std::atomic<uint32_t> posted;
+        std::atomic<uint32_t> target;
+        std::atomic<uint64_t> recv_wrs;
+        std::atomic<uint64_t> recv_bytes;
+    };
+    srq_class_t srq_classes[RDMA_SRQ_CLASS_MAX];
+    int srq_class_num = 0;
+    uint32_t srq_window_consumed = 0;
+    // recv wrs are re-posted to srq when this number consumed.
+    uint32_t recv_repost_batch = 1;
+
+    // rdma_cq_poll_batch cqes, only used in owner.
+    std::vector<ibv_wc> wc_buf;
+    // v2 send wrs completed by a later cqe, only used in owner.
+    std::vector<RdmaSendWr *> reaped_send_wrs;
+
     std::map<uint32_t , RdmaConnection *> qp_conns; // qpn, conn
 
     //Waitting for dead connection that has no tx_cq to poll.
@@ -136,13 +200,27 @@ class RdmaWorker{
 
     std::atomic<bool> is_fin;
 
+    std::atomic<uint64_t> post_batch_hist[RDMA_POST_BATCH_HIST_BUCKETS];
+
     void handle_tx_cqe(ibv_wc *cqe, int n);
     void handle_rdma_rw_cqe(ibv_wc &wc, RdmaConnection *conn);
     void handle_rx_cqe(ibv_wc *cqe, int n);
     int handle_rx_msg(ibv_wc *cqe, RdmaConnection *conn);
+    void refill_srq_classes(ibv_wc *cqe, int n);
+    void adapt_srq_targets();
 public:
     explicit RdmaWorker(MsgContext *c, RdmaManager *m)
-    :mct(c), manager(m) {}
+    :mct(c), manager(m) {
+        for(int i = 0;i < RDMA_POST_BATCH_HIST_BUCKETS;++i){
+            post_batch_hist[i] = 0;
+        }
+        for(int i = 0;i < RDMA_SRQ_CLASS_MAX;++i){
+            srq_classes[i].posted = 0;
+            srq_classes[i].target = 0;
+            srq_classes[i].recv_wrs = 0;
+            srq_classes[i].recv_bytes = 0;
+        }
+    }
     ~RdmaWorker();
     int init();
     int clear_before_stop();
@@ -166,6 +244,14 @@ public:
     int post_rdma_recv_wr_to_srq(std::vector<RdmaRecvWr *> &wrs);
     int post_rdma_recv_wr_to_srq(int n);
     ibv_srq *get_srq() const { return this->srq; }
+    ibv_srq *get_srq(int cls) const { 
+        if(cls < 0 || cls >= srq_class_num) return nullptr;
+        return srq_classes[cls].srq; 
+    }
+    int get_srq_class_num() const { return srq_class_num; }
+    void get_srq_stat(std::vector<rdma_srq_class_stat_t> &stats);
+    void release_buffer(Chunk *chunk);
+    void release_buffers(std::vector<Chunk *> &chunks);
     ib::CompletionQueue *get_tx_cq() const { return tx_cq; }
     ib::CompletionQueue *get_rx_cq() const { return rx_cq; }
     int get_qp_size() const { return qp_conns.size(); }
@@ -174,6 +260,15 @@ public:
     ib::MemoryManager *get_memory_manager() const { 
         return this->memory_manager; 
     }
+    void record_post_batch(uint32_t wr_num){
+        int i = 0;
+        while(wr_num >>= 1) ++i;
+        if(i >= RDMA_POST_BATCH_HIST_BUCKETS) i = RDMA_POST_BATCH_HIST_BUCKETS - 1;
+        post_batch_hist[i].fetch_add(1, std::memory_order_relaxed);
+    }
+    uint64_t get_post_batch_hist(int i) const {
+        return post_batch_hist[i].load(std::memory_order_relaxed);
+    }
 };
 
 class RdmaManager{
@@ -200,6 +295,8 @@ public:
     RdmaWorker *get_lightest_load_rdma_worker();
     MsgWorker *get_owner() const { return this->owner; }
     ib::Infiniband &get_ib() { return m_ib; }
+    void get_srq_stat(std::vector<rdma_srq_class_stat_t> &stats);
+    void log_srq_stat();
 
 };
 
@@ -220,6 +317,7 @@ public:
     virtual Connection* connect(NodeAddr *addr) override;
     RdmaManager *get_manager() { return manager; }
     ib::RdmaBufferAllocator *get_rdma_allocator();
+    ib::RdmaMrCache *get_mr_cache();
     static RdmaConnection *rdma_conn_cast(Connection *conn){
         auto ttype = conn->get_ttype();
         if(ttype == msg_ttype_t::RDMA){
@@ -4,6 +4,7 @@
 #include "msg/internal/types.h"
 #include "msg/NetHandler.h"
 #include "msg/msg_def.h"
+#include "util/cycles.h"
 
 #include <sys/socket.h>
 #include <netinet/in.h>
@@ -21,6 +22,7 @@ void TcpConnection::read_cb(){
     }
     ConnectionListener *listener = this->get_listener();
     assert(listener != nullptr);
+    uint64_t start = get_cycles();
     while(true){
         auto msg = this->recv_msg();
         if(msg){
@@ -32,14 +34,17 @@ void TcpConnection::read_cb(){
             break;
         }
     }
+    this->account_cpu(get_cycles() - start);
 }
 
 void TcpConnection::write_cb(){
     if(!this->is_connected() || !this->get_owner()->am_self()){
         return;
     }
+    uint64_t start = get_cycles();
     this->can_write = TcpConnection::WriteStatus::CANWRITE;
     this->send_msg(nullptr);
+    this->account_cpu(get_cycles() - start);
 }
 
 void TcpConnection::error_cb(){
@@ -264,7 +269,9 @@ ssize_t TcpConnection::send_msg(Msg *msg, bool more){
             this->get();
             this->get_owner()->post_work([this](){
                 ML(this->mct, trace, "in send_msg()");
+                uint64_t start = get_cycles();
                 this->send_msg(nullptr);
+                this->account_cpu(get_cycles() - start);
                 this->put();
             });
         }
@@ -285,7 +292,11 @@ ssize_t TcpConnection::send_msg(Msg *msg, bool more){
                     msg_p->to_string(), msg_p->total_bytes(), cur_msg_offset);
 
 
+        if(r > 0){
+            this->account_tx(r, 0);
+        }
         if(cur_msg_offset >= msg_p->total_bytes()){
+            this->account_tx(0, 1);
             cur_msg++;
             cur_msg_offset = 0;
             if(!cur_msg_is_end()){
@@ -359,6 +370,7 @@ Msg* TcpConnection::recv_msg() {
                 this->cur_recv_msg->data_len + FLAME_MSG_HEADER_LEN,
                 cur_recv_msg_offset);
             cur_recv_msg_offset = 0;
+            this->account_rx(0, 1);
             Msg *ok_msg = this->cur_recv_msg;
             this->cur_recv_msg = nullptr;
             return ok_msg;
@@ -369,6 +381,7 @@ Msg* TcpConnection::recv_msg() {
             this->error_cb();
             return nullptr;
         } else if (read_len > 0){
+            this->account_rx(read_len, 0);
             if(cur_recv_msg_offset >= recv_header_buffer.length()){
                 cur_recv_msg->cur_data_buffer_extend(read_len);
             }else{
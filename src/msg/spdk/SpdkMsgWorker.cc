@@ -217,13 +217,11 @@ int SpdkMsgWorker::event_poller_function(void *arg){
                                                 &mw->event_poller_timeout_zero);
     
     for(int i = 0;i < numevents; ++i){
-        //* 确保ecb不会被释放，直到该ecb处理完成
+        //* 回调中删除的ecb在下一轮process_events()时才释放，无需get()
         ML(mw->mct, trace, "{} process fd:{}, mask:{}", mw->name,
                                 mw->fevents[i].ecb->fd, mw->fevents[i].mask);
-        mw->fevents[i].ecb->get();
         if(FLAME_EVENT_ERROR & mw->fevents[i].mask){
             mw->fevents[i].ecb->error_cb();
-            mw->fevents[i].ecb->put();
             continue;
         }
         if(FLAME_EVENT_READABLE 
@@ -236,7 +234,6 @@ int SpdkMsgWorker::event_poller_function(void *arg){
             & mw->fevents[i].ecb->mask){
             mw->fevents[i].ecb->write_cb();
         }
-        mw->fevents[i].ecb->put();
     }
 
     return numevents;
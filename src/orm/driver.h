@@ -2,13 +2,17 @@
 #define FLAME_ORM_DRIVER_H
 
 #include <cassert>
+#include <cstdlib>
 #include <string>
 #include <iterator>
 #include <memory>
+#include <vector>
+#include <unordered_map>
 
 #include "common/context.h"
 #include "cols.h"
 #include "stmt.h"
+#include "prep.h"
 
 namespace flame {
 namespace orm {
@@ -188,6 +192,111 @@ protected:
     size_t len_;
 }; // class Result
 
+/**
+ * MemDataSet
+ * Rows fetched into memory, values are kept in text form.
+ * Used when the driver's result set can't outlive the statement,
+ * eg. the result set of a cached prepared statement.
+ */
+class MemDataSet final : public DataSet {
+public:
+    explicit MemDataSet(const std::vector<std::string>& cols) : cols_(cols) {
+        for (size_t i = 0; i < cols_.size(); i++)
+            label_idx_[cols_[i]] = i;
+    }
+    virtual ~MemDataSet() {}
+
+    virtual size_t rows() const override { return rows_.size(); }
+    virtual size_t cols() const override { return cols_.size(); }
+    virtual std::string col_name(size_t idx) const override { return cols_[idx]; }
+    virtual std::shared_ptr<Record> get_row(size_t idx) const override;
+
+    void reserve(size_t rows) { rows_.reserve(rows); }
+
+    // Return the new row, which should be filled with cols() values
+    std::vector<std::string>& add_row() {
+        rows_.emplace_back();
+        rows_.back().reserve(cols_.size());
+        return rows_.back();
+    }
+
+    const std::string& value(size_t row, size_t idx) const { return rows_[row][idx]; }
+    const std::string& value(size_t row, const std::string& label) const;
+
+private:
+    std::vector<std::string> cols_;
+    std::unordered_map<std::string, size_t> label_idx_;
+    std::vector<std::vector<std::string>> rows_;
+}; // class MemDataSet
+
+/**
+ * MemRecord
+ * A row of MemDataSet, valid while the MemDataSet is alive
+ */
+class MemRecord final : public Record {
+public:
+    MemRecord(const MemDataSet* ds, size_t row) : ds_(ds), row_(row) {}
+    virtual ~MemRecord() {}
+
+    virtual size_t cols() const override { return ds_->cols(); }
+
+    virtual int64_t get_int(size_t idx) const override { 
+        return std::strtoll(ds_->value(row_, idx).c_str(), nullptr, 10);
+    }
+    virtual uint64_t get_uint(size_t idx) const override {
+        return std::strtoull(ds_->value(row_, idx).c_str(), nullptr, 10);
+    }
+    virtual double get_double(size_t idx) const override {
+        return std::strtod(ds_->value(row_, idx).c_str(), nullptr);
+    }
+    virtual std::string get_str(size_t idx) const override {
+        return ds_->value(row_, idx);
+    }
+
+    virtual int64_t get_int(const std::string& label) const override {
+        return std::strtoll(ds_->value(row_, label).c_str(), nullptr, 10);
+    }
+    virtual uint64_t get_uint(const std::string& label) const override {
+        return std::strtoull(ds_->value(row_, label).c_str(), nullptr, 10);
+    }
+    virtual double get_double(const std::string& label) const override {
+        return std::strtod(ds_->value(row_, label).c_str(), nullptr);
+    }
+    virtual std::string get_str(const std::string& label) const override {
+        return ds_->value(row_, label);
+    }
+
+private:
+    const MemDataSet* ds_;
+    size_t row_;
+}; // class MemRecord
+
+inline std::shared_ptr<Record> MemDataSet::get_row(size_t idx) const {
+    return std::shared_ptr<Record>(new MemRecord(this, idx));
+}
+
+inline const std::string& MemDataSet::value(size_t row, const std::string& label) const {
+    static const std::string empty;
+    auto it = label_idx_.find(label);
+    return it == label_idx_.end() ? empty : rows_[row][it->second];
+}
+
+/**
+ * MemResult
+ */
+class MemResult final : public Result {
+public:
+    MemResult(int code, size_t len, const std::shared_ptr<MemDataSet>& ds)
+        : Result(code, len), ds_(ds) {}
+    virtual ~MemResult() {}
+
+    virtual bool has_ds() const override { return ds_.get() != nullptr; }
+    virtual std::shared_ptr<DataSet> data_set() const override { return ds_; }
+
+private:
+    std::shared_ptr<MemDataSet> ds_;
+}; // class MemResult
+
 /**
  * Stub
  */
@@ -205,6 +314,25 @@ public:
     std::shared_ptr<Result> execute(const DeleteStmt& stmt) { return execute_update(stmt.to_str()); }
     std::shared_ptr<Result> execute(const MultiInsertStmt& stmt) { return execute_update(stmt.to_str()); }
 
+    /**
+     * Execute a prepared statement with params bound to placeholders in order.
+     * Default is rendering params into the SQL text, for drivers that
+     * don't support prepared statement.
+     */
+    virtual std::shared_ptr<Result> execute_prepared(const PrepStmt& stmt, const Params& params) {
+        std::string sql = stmt.render(params);
+        return stmt.is_query() ? execute_query(sql) : execute_update(sql);
+    }
+
+    // Accumulate statistics of prepared statement cache
+    virtual void get_prep_stat(prep_stat_t& stat) const {}
+
+    // Health check of the connection, called by the pool on idle stubs
+    virtual bool ping() {
+        std::shared_ptr<Result> ret = execute_query("SELECT 1");
+        return ret && ret->OK();
+    }
+
 protected:
     Stub(FlameContext* fct) : fct_(fct) {}
 
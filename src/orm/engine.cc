@@ -1,6 +1,7 @@
 #include "engine.h"
 #include "driver.h"
 #include "my_impl/my_impl.h"
+#include "sqlite_impl/sqlite_impl.h"
 
 #include "util/clog.h"
 
@@ -19,7 +20,7 @@ bool DBUrlParser::match(const std::string& text) {
     return matched_;
 }
 
-std::shared_ptr<DBEngine> DBEngine::create_engine(FlameContext* fct, const std::string& url, size_t stub_num) {
+std::shared_ptr<DBEngine> DBEngine::create_engine(FlameContext* fct, const std::string& url, size_t stub_num, size_t max_stub) {
     assert(fct != nullptr);
     DBUrlParser parser(url);
     if (!parser.matched()) {
@@ -39,15 +40,25 @@ std::shared_ptr<DBEngine> DBEngine::create_engine(FlameContext* fct, const std::
             addr += port;
         }
         driver = new MysqlDriver(fct, addr, parser.db(), parser.user(), parser.passwd());
+    } else if (driver_type == "sqlite") {
+        driver = new SqliteDriver(fct, parser.path());
+        // A shared-cache in-memory database has table level locks, a conflict
+        // returns SQLITE_LOCKED at once and busy_timeout doesn't retry it.
+        // Statements of one connection never conflict, so keep a single stub.
+        if (parser.path() == ":memory:" && (stub_num > 1 || max_stub > 1)) {
+            fct->log()->linfo("orm", "in-memory sqlite is limited to one stub.");
+            stub_num = 1;
+            max_stub = 1;
+        }
     } else {
         fct->log()->lerror("orm", "Engine ERR: DB Driver is not found!");
         return nullptr;
     }
 
     assert(stub_num > 0);
-    std::shared_ptr<DBEngine> engine(new DBEngine(fct, driver));
+    std::shared_ptr<DBEngine> engine(new DBEngine(fct, driver, stub_num, max_stub));
     
-    size_t created = engine->create_stub(stub_num);
+    size_t created = engine->stub_pool_.init();
     if (created < stub_num) {
         fct->log()->lerror("orm", "Engine ERR: create stub faild, check url and your db server!");
         return nullptr;
@@ -96,43 +107,9 @@ std::shared_ptr<Result> DBEngine::execute(const MultiInsertStmt& stmt) {
     return owner.get_stub()->execute(stmt);
 }
 
-void DBEngine::StubPool::push(const std::shared_ptr<Stub>& stub) {
-    MutexLocker locker(stub_que_mutex_);
-    stub_que_.push(stub);
-    stub_que_cond_.signal();
-}
-
-bool DBEngine::StubPool::pop(std::shared_ptr<Stub>& stub) {
-    MutexLocker locker(stub_que_mutex_);
-    if (stub_que_.size() == 0)
-        return false;
-    stub = stub_que_.front();
-    stub_que_.pop();
-    return true;
-}
-
-std::shared_ptr<Stub> DBEngine::StubPool::pop() {
-    MutexLocker locker(stub_que_mutex_);
-
-    while (stub_que_.size() == 0) {
-        stub_que_cond_.wait();
-    }
-
-    std::shared_ptr<Stub> stub = stub_que_.front();
-    stub_que_.pop();
-    return stub;
-}
-
-size_t DBEngine::create_stub(size_t count) {
-    for (size_t i = 0; i < count; i++) {
-        std::shared_ptr<Stub> stub = driver_->create_stub();
-        if (!stub) {
-            fct_->log()->lerror("orm", "create stub faild.");
-            break;
-        }
-        stub_pool_.push(stub);
-    }
-    return stub_pool_.count();
+std::shared_ptr<Result> DBEngine::execute_prepared(const PrepStmt& stmt, const Params& params) {
+    StubOwner owner(stub_pool_);
+    return owner.get_stub()->execute_prepared(stmt, params);
 }
 
 } // namespace orm
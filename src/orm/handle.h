@@ -4,6 +4,7 @@
 #include "driver.h"
 #include "stmt.h"
 #include "engine.h"
+#include "prep.h"
 
 #include <initializer_list>
 
@@ -38,6 +39,9 @@ public:
 
     std::shared_ptr<Result> exec() override { return engine_->execute(stmt); }
 
+    // Build a prepared statement, values are given by arg_()
+    PrepStmt prepare() const { return PrepStmt(stmt); }
+
     SelectHandle& column(const ColumnStmt& col) { stmt.column(col); return *this; }
     SelectHandle& column(const std::initializer_list<ColumnStmt>& cols) {
         stmt.column(cols);
@@ -117,6 +121,9 @@ public:
 
     std::shared_ptr<Result> exec() override { return engine_->execute(stmt); }
 
+    // Build a prepared statement, values are given by arg_()
+    PrepStmt prepare() const { return PrepStmt(stmt); }
+
     InsertHandle& table(const TableStmt& tbl) { stmt.table(tbl); return *this; }
 
     InsertHandle& column(const ColumnStmt& col) { stmt.column(col); return *this; }
@@ -145,6 +152,9 @@ public:
 
     std::shared_ptr<Result> exec() override { return engine_->execute(stmt); }
 
+    // Build a prepared statement, values are given by arg_()
+    PrepStmt prepare() const { return PrepStmt(stmt); }
+
     UpdateHandle& table(const TableStmt& tbl) { stmt.table(tbl); return *this; }
     UpdateHandle& table(const std::initializer_list<TableStmt>& tbls) {
         stmt.table(tbls);
@@ -182,6 +192,9 @@ public:
 
     std::shared_ptr<Result> exec() override { return engine_->execute(stmt); }
 
+    // Build a prepared statement, values are given by arg_()
+    PrepStmt prepare() const { return PrepStmt(stmt); }
+
     DeleteHandle& table(const TableStmt& tbl) { stmt.table(tbl); return *this; }
 
     DeleteHandle& where(const CondStmt& cond) { stmt.where(cond); return *this; }
@@ -70,6 +70,126 @@ std::shared_ptr<Result> MysqlStub::execute_update(const std::string& stmt) {
     return std::shared_ptr<Result>(new MysqlResult(RetCode::FAILD, 0, nullptr));
 }
 
+sql::PreparedStatement* MysqlStub::prepare_(const std::string& sql) {
+    auto it = prep_cache_.find(sql);
+    if (it != prep_cache_.end()) {
+        prep_hit_.fetch_add(1, std::memory_order_relaxed);
+        prep_lru_.splice(prep_lru_.begin(), prep_lru_, it->second.lru_it);
+        return it->second.ps.get();
+    }
+
+    prep_miss_.fetch_add(1, std::memory_order_relaxed);
+    std::unique_ptr<sql::PreparedStatement> ps(conn_->prepareStatement(sql));
+    if (prep_cache_.size() >= MYSQL_PREP_CACHE_SIZE) {
+        prep_cache_.erase(prep_lru_.back());
+        prep_lru_.pop_back();
+        prep_evict_.fetch_add(1, std::memory_order_relaxed);
+    }
+    prep_lru_.push_front(sql);
+    prep_entry_t& entry = prep_cache_[sql];
+    entry.ps = std::move(ps);
+    entry.lru_it = prep_lru_.begin();
+    prep_cached_.store(prep_cache_.size(), std::memory_order_relaxed);
+    return entry.ps.get();
+}
+
+void MysqlStub::unprepare_(const std::string& sql) {
+    auto it = prep_cache_.find(sql);
+    if (it == prep_cache_.end())
+        return;
+    prep_lru_.erase(it->second.lru_it);
+    prep_cache_.erase(it);
+    prep_cached_.store(prep_cache_.size(), std::memory_order_relaxed);
+}
+
+static void mysql_bind_(sql::PreparedStatement* ps, const Params& params) {
+    for (size_t i = 0; i < params.size(); i++) {
+        unsigned int idx = i + 1;
+        const Param& p = params[i];
+        switch (p.type()) {
+        case Value::INT:
+            ps->setInt64(idx, p.get_int());
+            break;
+        case Value::UINT:
+            ps->setUInt64(idx, p.get_uint());
+            break;
+        case Value::DOUBLE:
+            ps->setDouble(idx, p.get_double());
+            break;
+        case Value::STRING:
+            ps->setString(idx, p.get_str());
+            break;
+        default:
+            ps->setNull(idx, sql::DataType::SQLNULL);
+            break;
+        }
+    }
+}
+
+static std::shared_ptr<MemDataSet> mysql_fetch_(sql::ResultSet* res) {
+    sql::ResultSetMetaData* meta = res->getMetaData();
+    unsigned int cols = meta->getColumnCount();
+    std::vector<std::string> labels;
+    labels.reserve(cols);
+    for (unsigned int i = 1; i <= cols; i++)
+        labels.push_back(meta->getColumnLabel(i));
+
+    std::shared_ptr<MemDataSet> ds(new MemDataSet(labels));
+    ds->reserve(res->rowsCount());
+    while (res->next()) {
+        std::vector<std::string>& row = ds->add_row();
+        for (unsigned int i = 1; i <= cols; i++)
+            row.push_back(res->isNull(i) ? std::string() : std::string(res->getString(i)));
+    }
+    return ds;
+}
+
+std::shared_ptr<Result> MysqlStub::execute_prepared(const PrepStmt& stmt, const Params& params) {
+    fct_->log()->ldebug("[execute_prepared] %s", stmt.sql().c_str());
+    if (params.size() != stmt.param_count()) {
+        fct_->log()->lerror("[execute_prepared] %zu params given, %zu expected: %s", 
+            params.size(), stmt.param_count(), stmt.sql().c_str());
+        return std::shared_ptr<Result>(new MysqlResult(RetCode::FAILD, 0, nullptr));
+    }
+
+    try {
+        sql::PreparedStatement* ps = prepare_(stmt.sql());
+        mysql_bind_(ps, params);
+        if (stmt.is_query()) {
+            std::unique_ptr<sql::ResultSet> res(ps->executeQuery());
+            if (res.get()) {
+                std::shared_ptr<MemDataSet> ds = mysql_fetch_(res.get());
+                size_t len = ds->rows();
+                return std::shared_ptr<Result>(new MemResult(RetCode::OK, len, ds));
+            }
+        } else {
+            size_t len = ps->executeUpdate();
+            return std::shared_ptr<Result>(new MysqlResult(RetCode::OK, len, nullptr));
+        }
+    } catch (sql::SQLException& e) {
+        fct_->log()->lerror("[execute_prepared] Code(%d) Status(%d) %s", e.getErrorCode(), e.getSQLState(), e.what());
+        // the statement may be invalid now (eg. reconnected), prepare it again next time
+        unprepare_(stmt.sql());
+    }
+    return std::shared_ptr<Result>(new MysqlResult(RetCode::FAILD, 0, nullptr));
+}
+
+void MysqlStub::get_prep_stat(prep_stat_t& stat) const {
+    stat.hit += prep_hit_.load(std::memory_order_relaxed);
+    stat.miss += prep_miss_.load(std::memory_order_relaxed);
+    stat.evict += prep_evict_.load(std::memory_order_relaxed);
+    stat.cached += prep_cached_.load(std::memory_order_relaxed);
+}
+
+bool MysqlStub::ping() {
+    try {
+        return conn_->isValid();
+    } catch (sql::SQLException& e) {
+        fct_->log()->lerror("[ping] Code(%d) Status(%d) %s", e.getErrorCode(), e.getSQLState(), e.what());
+    }
+    return false;
+}
+
 std::shared_ptr<Stub> MysqlDriver::create_stub() const {
     try {
         sql::Connection* conn = driver_->connect(path_, user_, passwd_);
@@ -1,12 +1,18 @@
 #ifndef FLAME_ORM_MY_IMPL_MY_IMPL_H
 #define FLAME_ORM_MY_IMPL_MY_IMPL_H
 
+#include <atomic>
+#include <list>
 #include <string>
+#include <unordered_map>
 
 #include "common/context.h"
 #include "orm/driver.h"
 #include "public.h"
 
+// Max number of prepared statements cached in each connection
+#define MYSQL_PREP_CACHE_SIZE 64
+
 namespace flame {
 namespace orm {
 
@@ -111,18 +117,52 @@ private:
 
 class MysqlStub final : public Stub {
 public:
-    ~MysqlStub() { delete conn_; }
+    ~MysqlStub() {
+        prep_cache_.clear();
+        delete conn_;
+    }
 
     virtual std::shared_ptr<Result> execute(const std::string& stmt) override;
     virtual std::shared_ptr<Result> execute_query(const std::string& stmt) override;
     virtual std::shared_ptr<Result> execute_update(const std::string& stmt) override;
 
+    /**
+     * Values are bound by binary protocol, and the sql::PreparedStatement
+     * is cached by SQL text (LRU), so the same statement is parsed only once
+     * by the server. Rows of query are fetched into a MemDataSet, because
+     * the result set is overwritten by the next execution of the statement.
+     */
+    virtual std::shared_ptr<Result> execute_prepared(const PrepStmt& stmt, const Params& params) override;
+
+    virtual void get_prep_stat(prep_stat_t& stat) const override;
+
+    // mysql_ping() by the connector, no statement is parsed
+    virtual bool ping() override;
+
 private:
     MysqlStub(FlameContext* fct, sql::Connection* conn) 
-    : Stub(fct), conn_(conn) {}
+    : Stub(fct), prep_hit_(0), prep_miss_(0), prep_evict_(0), prep_cached_(0), conn_(conn) {}
 
     friend class MysqlDriver;
 
+    sql::PreparedStatement* prepare_(const std::string& sql);
+    void unprepare_(const std::string& sql);
+
+    struct prep_entry_t {
+        std::unique_ptr<sql::PreparedStatement> ps;
+        std::list<std::string>::iterator lru_it;
+    };
+
+    // Statements must be deleted before the connection
+    std::unordered_map<std::string, prep_entry_t> prep_cache_;
+    std::list<std::string> prep_lru_;   // front is the most recently used
+
+    // Stub is used by one thread at a time, but statistics may be read by others
+    std::atomic<uint64_t> prep_hit_;
+    std::atomic<uint64_t> prep_miss_;
+    std::atomic<uint64_t> prep_evict_;
+    std::atomic<uint64_t> prep_cached_;
+
     sql::Connection* conn_;
 }; // class MysqlStub
 
@@ -8,6 +8,8 @@
 #include <cppconn/exception.h>
 #include <cppconn/resultset.h>
 #include <cppconn/statement.h>
+#include <cppconn/prepared_statement.h>
+#include <cppconn/datatype.h>
 #include <cppconn/warning.h>
 #include <cppconn/metadata.h>
 #include <cppconn/resultset_metadata.h>
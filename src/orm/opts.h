@@ -9,19 +9,28 @@
 namespace flame {
 namespace orm {
 
+/**
+ * Placeholder of prepared statement
+ * eg. m_chunk.chk_id == arg_(), set_(m_chunk.stat, arg_())
+ */
+inline ValueStmt arg_() {
+    static const ParamVal param;
+    return ValueStmt(param);
+}
+
 /**
  * Set/Assignment
  */
 inline AssignStmt set_(const ColumnStmt& col, const ValueStmt& val) {
-    return AssignStmt(string_concat({col.to_str(), " = ", val.to_str()}));
+    return AssignStmt(string_concat({col.short_str(), " = ", val.to_str()}));
 }
 
 inline AssignStmt set_(const ColumnStmt& col, const ColumnStmt& src) {
-    return AssignStmt(string_concat({col.to_str(), " = ", src.to_str()}));
+    return AssignStmt(string_concat({col.short_str(), " = ", src.to_str()}));
 }
 
 inline AssignStmt set_(const ColumnStmt& col, const ExprStmt& expr) {
-    return AssignStmt(string_concat({col.to_str(), " = ", expr.to_str()}));
+    return AssignStmt(string_concat({col.short_str(), " = ", expr.to_str()}));
 }
 
 inline AssignStmt assign_(const ColumnStmt& col, const ValueStmt& val) {
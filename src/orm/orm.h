@@ -3,7 +3,9 @@
 
 #include "orm/driver.h"
 #include "orm/my_impl/my_impl.h"
+#include "orm/sqlite_impl/sqlite_impl.h"
 #include "orm/stmt.h"
+#include "orm/prep.h"
 #include "orm/cols.h"
 #include "orm/opts.h"
 #include "orm/engine.h"
@@ -0,0 +1,331 @@
+#include "pool.h"
+
+#include "common/thread/thread.h"
+#include "util/utime.h"
+
+#include <cassert>
+#include <cstdlib>
+#include <new>
+#include <thread>
+
+// Pools remembered by each thread, a pool uses the way (id % ways)
+#define STUB_POOL_AFFINITY_WAYS 8
+
+namespace flame {
+namespace orm {
+
+namespace {
+
+struct affinity_t {
+    uint64_t pool_id[STUB_POOL_AFFINITY_WAYS];
+    int slot[STUB_POOL_AFFINITY_WAYS];
+};
+
+std::atomic<uint64_t> next_pool_id {1};
+std::atomic<uint32_t> next_thread_seq {0};
+
+inline uint64_t now_ms() {
+    return utime_t::now().to_msec();
+}
+
+// Threads start scanning from different slots
+inline uint32_t thread_seq() {
+    static thread_local uint32_t seq = next_thread_seq.fetch_add(1, std::memory_order_relaxed);
+    return seq;
+}
+
+} // namespace
+
+class StubPoolKeeper : public Thread {
+public:
+    explicit StubPoolKeeper(StubPool* pool) : pool_(pool) {}
+
+protected:
+    virtual void entry() override {
+        MutexLocker l(pool_->mutex_);
+        while (!pool_->stop_) {
+            pool_->keeper_cond_.wait_interval(utime_t::get_by_msec(STUB_POOL_KEEPER_MS));
+            if (pool_->stop_)
+                break;
+            pool_->mutex_.unlock();
+            pool_->maintain();
+            pool_->mutex_.lock();
+        }
+    }
+
+private:
+    StubPool* pool_;
+}; // class StubPoolKeeper
+
+StubPool::StubPool(FlameContext* fct, Driver* driver, size_t min, size_t max)
+: fct_(fct), driver_(driver), min_(min), max_(max < min ? min : max),
+  id_(next_pool_id.fetch_add(1, std::memory_order_relaxed)),
+  size_(0), waiters_(0), stop_(false), keeper_(nullptr),
+  wait_cnt_(0), wait_us_(0), max_wait_us_(0), last_wait_cnt_(0),
+  grow_cnt_(0), shrink_cnt_(0), ping_faild_cnt_(0), reconnect_cnt_(0),
+  retired_acquire_(0), retired_affine_(0), util_sum_(0), util_samples_(0) {
+    assert(min_ > 0);
+    if (max_ > STUB_POOL_MAX_SLOTS)
+        max_ = STUB_POOL_MAX_SLOTS;
+    if (min_ > max_)
+        min_ = max_;
+    // operator new of C++11 ignores alignas, keep each slot on its own line
+    void* mem = nullptr;
+    if (posix_memalign(&mem, alignof(slot_t), sizeof(slot_t) * max_) != 0)
+        throw std::bad_alloc();
+    slots_ = static_cast<slot_t*>(mem);
+    for (size_t i = 0; i < max_; i++) {
+        new (&slots_[i]) slot_t();
+        slots_[i].acquire.store(0, std::memory_order_relaxed);
+        slots_[i].affine.store(0, std::memory_order_relaxed);
+        slots_[i].last_used.store(0, std::memory_order_relaxed);
+        slots_[i].last_ping = 0;
+        slots_[i].state.store(SLOT_CLOSED, std::memory_order_relaxed);
+    }
+    free_cond_.set_mutex(mutex_);
+    keeper_cond_.set_mutex(mutex_);
+}
+
+StubPool::~StubPool() {
+    if (keeper_) {
+        {
+            MutexLocker l(mutex_);
+            stop_ = true;
+            keeper_cond_.signal();
+        }
+        keeper_->join();
+        delete keeper_;
+        keeper_ = nullptr;
+    }
+    for (size_t i = 0; i < max_; i++)
+        slots_[i].~slot_t();
+    free(slots_);
+}
+
+size_t StubPool::init() {
+    while (count() < min_) {
+        if (!add_())
+            break;
+    }
+    if (count() < min_)
+        return count();
+
+    keeper_ = new StubPoolKeeper(this);
+    keeper_->create("orm_stub_pool");
+    return count();
+}
+
+int& StubPool::affinity_() {
+    static thread_local affinity_t aff;
+    size_t way = id_ % STUB_POOL_AFFINITY_WAYS;
+    if (aff.pool_id[way] != id_) {
+        aff.pool_id[way] = id_;
+        aff.slot[way] = -1;
+    }
+    return aff.slot[way];
+}
+
+int StubPool::acquire() {
+    int& home = affinity_();
+    size_t n = count();
+    if (home >= 0 && (size_t)home < n && try_take_(home)) {
+        slot_t& slot = slots_[home];
+        slot.acquire.store(slot.acquire.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        slot.affine.store(slot.affine.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return home;
+    }
+
+    // Steal a free stub, it becomes the affine stub of this thread
+    size_t start = home >= 0 ? home + 1 : thread_seq();
+    for (int round = 0; ; round++) {
+        n = count();
+        for (size_t i = 0; i < n; i++) {
+            size_t idx = (start + i) % n;
+            if (try_take_(idx)) {
+                slot_t& slot = slots_[idx];
+                slot.acquire.store(slot.acquire.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                home = idx;
+                return idx;
+            }
+        }
+        if (round < STUB_POOL_SPIN_ROUNDS) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        // All stubs are busy, wake the keeper to grow and sleep
+        uint64_t start_us = utime_t::now().to_usec();
+        MutexLocker l(mutex_);
+        waiters_.fetch_add(1);
+        keeper_cond_.signal();
+        while (!has_free_())
+            free_cond_.wait_interval(utime_t::get_by_msec(STUB_POOL_KEEPER_MS));
+        waiters_.fetch_sub(1);
+        uint64_t us = utime_t::now().to_usec() - start_us;
+        wait_cnt_++;
+        wait_us_ += us;
+        if (us > max_wait_us_)
+            max_wait_us_ = us;
+    }
+}
+
+void StubPool::release(int idx) {
+    slots_[idx].last_used.store(now_ms(), std::memory_order_relaxed);
+    put_(idx);
+}
+
+void StubPool::put_(int idx) {
+    // Pairs with waiters_ increased before has_free_(), one of them sees the other
+    slots_[idx].state.store(SLOT_FREE);
+    if (waiters_.load() > 0) {
+        MutexLocker l(mutex_);
+        free_cond_.signal();
+    }
+}
+
+bool StubPool::has_free_() const {
+    size_t n = count();
+    for (size_t i = 0; i < n; i++) {
+        if (slots_[i].state.load() == SLOT_FREE)
+            return true;
+    }
+    return false;
+}
+
+bool StubPool::add_() {
+    std::shared_ptr<Stub> stub = driver_->create_stub();
+    if (!stub) {
+        fct_->log()->lerror("orm", "create stub faild.");
+        return false;
+    }
+
+    uint64_t now = now_ms();
+    MutexLocker l(mutex_);
+    size_t n = count();
+    if (n >= max_)
+        return false;
+    slot_t& slot = slots_[n];
+    slot.stub = stub;
+    slot.acquire.store(0, std::memory_order_relaxed);
+    slot.affine.store(0, std::memory_order_relaxed);
+    slot.last_used.store(now, std::memory_order_relaxed);
+    slot.last_ping = now;
+    slot.state.store(SLOT_FREE, std::memory_order_release);
+    size_.store(n + 1, std::memory_order_release);
+    free_cond_.broadcast();
+    return true;
+}
+
+// Only the tail is closed, so slots in service are always [0, size)
+bool StubPool::shrink_(uint64_t now) {
+    size_t n = count();
+    if (n <= min_)
+        return false;
+    size_t idx = n - 1;
+    slot_t& slot = slots_[idx];
+    if (now - slot.last_used.load(std::memory_order_relaxed) < STUB_POOL_IDLE_MS || !try_take_(idx))
+        return false;
+
+    size_.store(idx, std::memory_order_release);
+    MutexLocker l(mutex_);
+    retired_acquire_ += slot.acquire.load(std::memory_order_relaxed);
+    retired_affine_ += slot.affine.load(std::memory_order_relaxed);
+    slot.stub->get_prep_stat(retired_prep_);
+    slot.stub.reset();
+    slot.state.store(SLOT_CLOSED, std::memory_order_release);
+    shrink_cnt_++;
+    return true;
+}
+
+void StubPool::check_(size_t idx, uint64_t now) {
+    slot_t& slot = slots_[idx];
+    if (now - slot.last_used.load(std::memory_order_relaxed) < STUB_POOL_PING_MS
+      || now - slot.last_ping < STUB_POOL_PING_MS || !try_take_(idx))
+        return;
+
+    // Ping doesn't count as use, or the idle stub would never be closed
+    slot.last_ping = now;
+    if (!slot.stub->ping()) {
+        fct_->log()->lwarn("orm", "stub %zu failed health check, reconnect.", idx);
+        std::shared_ptr<Stub> stub = driver_->create_stub();
+        MutexLocker l(mutex_);
+        ping_faild_cnt_++;
+        if (stub) {
+            slot.stub->get_prep_stat(retired_prep_);
+            slot.stub = stub;
+            reconnect_cnt_++;
+        }
+    }
+    put_(idx);
+}
+
+void StubPool::maintain() {
+    uint64_t now = now_ms();
+    size_t n = count();
+    size_t busy = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (slots_[i].state.load(std::memory_order_relaxed) == SLOT_BUSY)
+            busy++;
+    }
+
+    bool waited;
+    {
+        MutexLocker l(mutex_);
+        util_sum_ += (double)busy / n;
+        util_samples_++;
+        waited = waiters_.load() > 0 || wait_cnt_ != last_wait_cnt_;
+        last_wait_cnt_ = wait_cnt_;
+    }
+
+    if (n < max_ && (waited || busy >= n * STUB_POOL_GROW_UTIL)) {
+        if (add_()) {
+            MutexLocker l(mutex_);
+            grow_cnt_++;
+            fct_->log()->linfo("orm", "stub pool grows to %zu.", n + 1);
+        }
+        return;
+    }
+
+    if (busy < n * STUB_POOL_GROW_UTIL / 2 && shrink_(now))
+        fct_->log()->linfo("orm", "stub pool shrinks to %zu.", n - 1);
+
+    n = count();
+    for (size_t i = 0; i < n; i++)
+        check_(i, now);
+}
+
+void StubPool::get_stat(pool_stat_t& stat) const {
+    MutexLocker l(mutex_);
+    size_t n = count();
+    stat.acquire = retired_acquire_;
+    stat.affine = retired_affine_;
+    stat.busy = 0;
+    for (size_t i = 0; i < n; i++) {
+        stat.acquire += slots_[i].acquire.load(std::memory_order_relaxed);
+        stat.affine += slots_[i].affine.load(std::memory_order_relaxed);
+        if (slots_[i].state.load(std::memory_order_relaxed) == SLOT_BUSY)
+            stat.busy++;
+    }
+    stat.size = n;
+    stat.wait = wait_cnt_;
+    stat.wait_us = wait_us_;
+    stat.max_wait_us = max_wait_us_;
+    stat.grow = grow_cnt_;
+    stat.shrink = shrink_cnt_;
+    stat.ping_faild = ping_faild_cnt_;
+    stat.reconnect = reconnect_cnt_;
+    stat.util = util_samples_ == 0 ? 0 : util_sum_ / util_samples_;
+}
+
+void StubPool::get_prep_stat(prep_stat_t& stat) const {
+    MutexLocker l(mutex_);
+    stat.hit += retired_prep_.hit;
+    stat.miss += retired_prep_.miss;
+    stat.evict += retired_prep_.evict;
+    size_t n = count();
+    for (size_t i = 0; i < n; i++)
+        slots_[i].stub->get_prep_stat(stat);
+}
+
+} // namespace orm
+} // namespace flame
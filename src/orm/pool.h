@@ -0,0 +1,165 @@
+#ifndef FLAME_ORM_POOL_H
+#define FLAME_ORM_POOL_H
+
+#include "driver.h"
+#include "common/context.h"
+#include "common/thread/mutex.h"
+#include "common/thread/cond.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+// Hard limit of stubs in one pool
+#define STUB_POOL_MAX_SLOTS     256
+// Rounds of scanning all slots before a thread sleeps for a free stub
+#define STUB_POOL_SPIN_ROUNDS   4
+// Cycle of the keeper thread (ms)
+#define STUB_POOL_KEEPER_MS     100
+// A stub idle longer than this is health checked (ms)
+#define STUB_POOL_PING_MS       30000
+// A stub above the lower bound idle longer than this is closed (ms)
+#define STUB_POOL_IDLE_MS       60000
+// Grow when the busy ratio sampled by the keeper reaches this
+#define STUB_POOL_GROW_UTIL     0.8
+
+namespace flame {
+namespace orm {
+
+/**
+ * Stub pool statistics
+ */
+struct pool_stat_t {
+    uint64_t acquire    {0};
+    uint64_t affine     {0};    // got the same stub as last time in this thread
+    uint64_t wait       {0};    // acquisitions that slept for a free stub
+    uint64_t wait_us    {0};    // total time slept
+    uint64_t max_wait_us {0};
+    uint64_t grow       {0};
+    uint64_t shrink     {0};
+    uint64_t ping_faild {0};
+    uint64_t reconnect  {0};    // broken stubs replaced by new connections
+    uint64_t size       {0};    // stubs in pool now
+    uint64_t busy       {0};    // stubs in use now
+    double   util       {0};    // average of busy / size sampled by the keeper
+
+    double affine_rate() const {
+        return acquire == 0 ? 0 : (double)affine / acquire;
+    }
+
+    double avg_wait_us() const {
+        return wait == 0 ? 0 : (double)wait_us / wait;
+    }
+};
+
+class StubPoolKeeper;
+
+/**
+ * StubPool
+ * Stubs live in a fixed array of slots, a slot is taken by CAS on its state,
+ * so no lock is held on the fast path. Each thread remembers the slot it used
+ * last time and tries it first, then steals any free slot, and sleeps only
+ * when all stubs are busy.
+ * Slots [0, size) are in service. The keeper thread grows the pool within
+ * [min, max] when threads wait or most stubs are busy, closes the idle stub
+ * at the tail, and replaces idle stubs that fail the health check.
+ */
+class StubPool final {
+public:
+    StubPool(FlameContext* fct, Driver* driver, size_t min, size_t max);
+    ~StubPool();
+
+    // Create the lower bound of stubs and start the keeper, return number of stubs
+    size_t init();
+
+    size_t count() const { return size_.load(std::memory_order_acquire); }
+
+    // Blocking, return the index of slot taken
+    int acquire();
+    void release(int slot);
+
+    Stub* stub(int slot) const { return slots_[slot].stub.get(); }
+
+    void get_stat(pool_stat_t& stat) const;
+    void get_prep_stat(prep_stat_t& stat) const;
+
+    // Called by the keeper periodically
+    void maintain();
+
+    StubPool(const StubPool&) = delete;
+    StubPool(StubPool&&) = delete;
+    StubPool& operator = (const StubPool&) = delete;
+    StubPool& operator = (StubPool&&) = delete;
+
+private:
+    enum SlotState {
+        SLOT_CLOSED = 0,
+        SLOT_FREE,
+        SLOT_BUSY
+    };
+
+    // One cache line per slot, taking a slot doesn't disturb the neighbors
+    struct alignas(64) slot_t {
+        std::atomic<uint64_t> acquire;  // written only by the owner
+        std::atomic<uint64_t> affine;
+        std::atomic<uint64_t> last_used;    // ms
+        uint64_t last_ping;     // ms, only for keeper
+        std::shared_ptr<Stub> stub;     // replaced only by keeper with mutex_
+        std::atomic<int> state;
+    };
+
+    bool try_take_(size_t idx) {
+        int expected = SLOT_FREE;
+        return slots_[idx].state.compare_exchange_strong(expected, SLOT_BUSY,
+            std::memory_order_acquire, std::memory_order_relaxed);
+    }
+
+    bool has_free_() const;
+    int& affinity_();
+
+    // Free the slot without updating last_used
+    void put_(int idx);
+
+    // Create a stub in slot [size]
+    bool add_();
+    bool shrink_(uint64_t now);
+    void check_(size_t idx, uint64_t now);
+
+    FlameContext* fct_;
+    Driver* driver_;
+    size_t min_;
+    size_t max_;
+    uint64_t id_;
+    slot_t* slots_;     // max_ slots, allocated aligned to 64
+    std::atomic<size_t> size_;
+    std::atomic<uint32_t> waiters_;
+
+    // Slow path: sleeping threads, keeper and replacement of stubs
+    mutable Mutex mutex_;
+    Cond free_cond_;
+    Cond keeper_cond_;
+    bool stop_;
+    StubPoolKeeper* keeper_;
+
+    // Protected by mutex_
+    uint64_t wait_cnt_;
+    uint64_t wait_us_;
+    uint64_t max_wait_us_;
+    uint64_t last_wait_cnt_;    // wait_cnt_ seen by the last maintain()
+    uint64_t grow_cnt_;
+    uint64_t shrink_cnt_;
+    uint64_t ping_faild_cnt_;
+    uint64_t reconnect_cnt_;
+    uint64_t retired_acquire_;  // counters of closed stubs
+    uint64_t retired_affine_;
+    prep_stat_t retired_prep_;
+    double util_sum_;
+    uint64_t util_samples_;
+
+    friend class StubPoolKeeper;
+}; // class StubPool
+
+} // namespace orm
+} // namespace flame
+
+#endif // FLAME_ORM_POOL_H
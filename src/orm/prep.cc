@@ -0,0 +1,53 @@
+#include "prep.h"
+
+namespace flame {
+namespace orm {
+
+std::string Param::to_str() const {
+    switch (type_) {
+    case Value::INT:
+        return convert2string(val_.i);
+    case Value::UINT:
+        return convert2string(val_.u);
+    case Value::DOUBLE:
+        return convert2string(val_.d);
+    case Value::STRING:
+        return string_encode_box(str_, '\'');
+    default:
+        return "NULL";
+    }
+}
+
+// Quotes in literal are escaped as '', so toggling on each quote is enough.
+size_t PrepStmt::count_param_(const std::string& sql) {
+    size_t count = 0;
+    bool quoted = false;
+    for (char c : sql) {
+        if (c == '\'')
+            quoted = !quoted;
+        else if (c == '?' && !quoted)
+            count++;
+    }
+    return count;
+}
+
+std::string PrepStmt::render(const Params& params) const {
+    std::string stmt;
+    stmt.reserve(sql_.size() + params.size() * 8);
+    size_t idx = 0;
+    bool quoted = false;
+    for (char c : sql_) {
+        if (c == '\'') {
+            quoted = !quoted;
+        } else if (c == '?' && !quoted) {
+            stmt += idx < params.size() ? params[idx].to_str() : "NULL";
+            idx++;
+            continue;
+        }
+        stmt.push_back(c);
+    }
+    return stmt;
+}
+
+} // namespace orm
+} // namespace flame
@@ -0,0 +1,119 @@
+#ifndef FLAME_ORM_PREP_H
+#define FLAME_ORM_PREP_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "stmt.h"
+
+namespace flame {
+namespace orm {
+
+/**
+ * Param
+ * A value bound to '?' of prepared statement, kept in binary form
+ */
+class Param {
+public:
+    Param() : type_(Value::NONE) { val_.u = 0; }
+    Param(char val) : type_(Value::INT) { val_.i = val; }
+    Param(signed char val) : type_(Value::INT) { val_.i = val; }
+    Param(unsigned char val) : type_(Value::UINT) { val_.u = val; }
+    Param(short val) : type_(Value::INT) { val_.i = val; }
+    Param(unsigned short val) : type_(Value::UINT) { val_.u = val; }
+    Param(int val) : type_(Value::INT) { val_.i = val; }
+    Param(unsigned int val) : type_(Value::UINT) { val_.u = val; }
+    Param(long val) : type_(Value::INT) { val_.i = val; }
+    Param(unsigned long val) : type_(Value::UINT) { val_.u = val; }
+    Param(long long val) : type_(Value::INT) { val_.i = val; }
+    Param(unsigned long long val) : type_(Value::UINT) { val_.u = val; }
+    Param(double val) : type_(Value::DOUBLE) { val_.d = val; }
+    Param(const std::string& str) : type_(Value::STRING), str_(str) { val_.u = 0; }
+    Param(const char* str) : type_(Value::STRING), str_(str) { val_.u = 0; }
+    ~Param() {}
+
+    Param(const Param&) = default;
+    Param(Param&&) = default;
+    Param& operator=(const Param&) = default;
+    Param& operator=(Param&&) = default;
+
+    int8_t type() const { return type_; }
+    bool is_null() const { return type_ == Value::NONE; }
+
+    int64_t get_int() const { return val_.i; }
+    uint64_t get_uint() const { return val_.u; }
+    double get_double() const { return val_.d; }
+    const std::string& get_str() const { return str_; }
+
+    // Text form, for drivers that don't support prepared statement
+    std::string to_str() const;
+
+private:
+    int8_t type_;
+    union {
+        int64_t  i;
+        uint64_t u;
+        double   d;
+    } val_;
+    std::string str_;
+}; // class Param
+
+typedef std::vector<Param> Params;
+
+/**
+ * PrepStmt
+ * SQL text with '?' placeholders, built once by the statement builder,
+ * eg.
+ *      PrepStmt ps = m_chunk.query().where(m_chunk.chk_id == arg_()).prepare();
+ *      engine->execute_prepared(ps, {chk_id});
+ * The SQL text is the key of the prepared statement cache of each stub.
+ */
+class PrepStmt {
+public:
+    PrepStmt(const std::string& sql, bool query)
+    : sql_(sql), query_(query), param_count_(count_param_(sql_)) {}
+    explicit PrepStmt(const SelectStmt& stmt) : PrepStmt(stmt.to_str(), true) {}
+    explicit PrepStmt(const InsertStmt& stmt) : PrepStmt(stmt.to_str(), false) {}
+    explicit PrepStmt(const UpdateStmt& stmt) : PrepStmt(stmt.to_str(), false) {}
+    explicit PrepStmt(const DeleteStmt& stmt) : PrepStmt(stmt.to_str(), false) {}
+    ~PrepStmt() {}
+
+    PrepStmt(const PrepStmt&) = default;
+    PrepStmt(PrepStmt&&) = default;
+    PrepStmt& operator=(const PrepStmt&) = default;
+    PrepStmt& operator=(PrepStmt&&) = default;
+
+    const std::string& sql() const { return sql_; }
+    bool is_query() const { return query_; }
+    size_t param_count() const { return param_count_; }
+
+    // Replace placeholders with text form of params
+    std::string render(const Params& params) const;
+
+private:
+    static size_t count_param_(const std::string& sql);
+
+    std::string sql_;
+    bool query_;
+    size_t param_count_;
+}; // class PrepStmt
+
+/**
+ * Prepared statement cache statistics
+ */
+struct prep_stat_t {
+    uint64_t hit    {0};
+    uint64_t miss   {0};
+    uint64_t evict  {0};
+    uint64_t cached {0};    // statements in cache now
+
+    double hit_rate() const {
+        return hit + miss == 0 ? 0 : (double)hit / (hit + miss);
+    }
+};
+
+} // namespace orm
+} // namespace flame
+
+#endif // FLAME_ORM_PREP_H
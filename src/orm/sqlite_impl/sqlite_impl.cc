@@ -0,0 +1,217 @@
+#include "sqlite_impl.h"
+
+#include <memory>
+#include <regex>
+#include <vector>
+
+#include "log_sqlite.h"
+
+namespace flame {
+namespace orm {
+
+/**
+ * Statements are built for MySQL, AUTO_INCREMENT is the only thing
+ * SQLite can't accept. An auto increment key must be "INTEGER PRIMARY KEY".
+ */
+static std::string sqlite_dialect_(const std::string& stmt) {
+    if (stmt.compare(0, 12, "CREATE TABLE") != 0
+      || stmt.find("AUTO_INCREMENT") == std::string::npos)
+        return stmt;
+    static const std::regex auto_inc(
+        "[A-Z]+( UNSIGNED)?( NOT NULL)? AUTO_INCREMENT( UNIQUE)? PRIMARY KEY");
+    return std::regex_replace(stmt, auto_inc, "INTEGER$2$3 PRIMARY KEY AUTOINCREMENT");
+}
+
+static std::shared_ptr<MemDataSet> sqlite_fetch_cols_(sqlite3_stmt* stmt) {
+    int cols = sqlite3_column_count(stmt);
+    std::vector<std::string> labels;
+    labels.reserve(cols);
+    for (int i = 0; i < cols; i++) {
+        const char* name = sqlite3_column_name(stmt, i);
+        labels.push_back(name ? name : "");
+    }
+    return std::shared_ptr<MemDataSet>(new MemDataSet(labels));
+}
+
+SqliteStub::~SqliteStub() {
+    for (auto it = prep_cache_.begin(); it != prep_cache_.end(); ++it)
+        sqlite3_finalize(it->second.stmt);
+    prep_cache_.clear();
+    sqlite3_close(db_);
+}
+
+std::shared_ptr<Result> SqliteStub::run_(sqlite3_stmt* stmt, bool query) {
+    std::shared_ptr<MemDataSet> ds;
+    if (query)
+        ds = sqlite_fetch_cols_(stmt);
+
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        if (!ds)
+            continue;
+        int cols = ds->cols();
+        std::vector<std::string>& row = ds->add_row();
+        for (int i = 0; i < cols; i++) {
+            const unsigned char* text = sqlite3_column_text(stmt, i);
+            if (text)
+                row.push_back(std::string((const char*)text, sqlite3_column_bytes(stmt, i)));
+            else
+                row.push_back(std::string());
+        }
+    }
+    sqlite3_reset(stmt);
+
+    if (rc != SQLITE_DONE) {
+        fct_->log()->lerror("[run] Code(%d) %s: %s", rc, sqlite3_errmsg(db_), sqlite3_sql(stmt));
+        return std::shared_ptr<Result>(new MemResult(RetCode::FAILD, 0, nullptr));
+    }
+    if (query)
+        return std::shared_ptr<Result>(new MemResult(RetCode::OK, ds->rows(), ds));
+    return std::shared_ptr<Result>(new MemResult(RetCode::OK, sqlite3_changes(db_), nullptr));
+}
+
+std::shared_ptr<Result> SqliteStub::execute(const std::string& stmt) {
+    fct_->log()->ldebug("[execute] %s", stmt.c_str());
+    char* err = nullptr;
+    int rc = sqlite3_exec(db_, sqlite_dialect_(stmt).c_str(), nullptr, nullptr, &err);
+    if (rc != SQLITE_OK) {
+        fct_->log()->lerror("[execute] Code(%d) %s", rc, err ? err : "");
+        sqlite3_free(err);
+        return std::shared_ptr<Result>(new MemResult(RetCode::FAILD, 0, nullptr));
+    }
+    return std::shared_ptr<Result>(new MemResult(RetCode::OK, 0, nullptr));
+}
+
+std::shared_ptr<Result> SqliteStub::execute_query(const std::string& stmt) {
+    fct_->log()->ldebug("[execute_query] %s", stmt.c_str());
+    sqlite3_stmt* handle = nullptr;
+    int rc = sqlite3_prepare_v2(db_, stmt.c_str(), stmt.size(), &handle, nullptr);
+    if (rc != SQLITE_OK) {
+        fct_->log()->lerror("[execute_query] Code(%d) %s", rc, sqlite3_errmsg(db_));
+        return std::shared_ptr<Result>(new MemResult(RetCode::FAILD, 0, nullptr));
+    }
+    std::shared_ptr<Result> res = run_(handle, true);
+    sqlite3_finalize(handle);
+    return res;
+}
+
+std::shared_ptr<Result> SqliteStub::execute_update(const std::string& stmt) {
+    fct_->log()->ldebug("[execute_update] %s", stmt.c_str());
+    std::string sql = sqlite_dialect_(stmt);
+    sqlite3_stmt* handle = nullptr;
+    int rc = sqlite3_prepare_v2(db_, sql.c_str(), sql.size(), &handle, nullptr);
+    if (rc != SQLITE_OK) {
+        fct_->log()->lerror("[execute_update] Code(%d) %s", rc, sqlite3_errmsg(db_));
+        return std::shared_ptr<Result>(new MemResult(RetCode::FAILD, 0, nullptr));
+    }
+    std::shared_ptr<Result> res = run_(handle, false);
+    sqlite3_finalize(handle);
+    return res;
+}
+
+sqlite3_stmt* SqliteStub::prepare_(const std::string& sql) {
+    auto it = prep_cache_.find(sql);
+    if (it != prep_cache_.end()) {
+        prep_hit_.fetch_add(1, std::memory_order_relaxed);
+        prep_lru_.splice(prep_lru_.begin(), prep_lru_, it->second.lru_it);
+        return it->second.stmt;
+    }
+
+    prep_miss_.fetch_add(1, std::memory_order_relaxed);
+    sqlite3_stmt* stmt = nullptr;
+    int rc = sqlite3_prepare_v3(db_, sql.c_str(), sql.size(), SQLITE_PREPARE_PERSISTENT, &stmt, nullptr);
+    if (rc != SQLITE_OK) {
+        fct_->log()->lerror("[prepare] Code(%d) %s: %s", rc, sqlite3_errmsg(db_), sql.c_str());
+        return nullptr;
+    }
+    if (prep_cache_.size() >= SQLT_PREP_CACHE_SIZE) {
+        auto victim = prep_cache_.find(prep_lru_.back());
+        sqlite3_finalize(victim->second.stmt);
+        prep_cache_.erase(victim);
+        prep_lru_.pop_back();
+        prep_evict_.fetch_add(1, std::memory_order_relaxed);
+    }
+    prep_lru_.push_front(sql);
+    prep_entry_t& entry = prep_cache_[sql];
+    entry.stmt = stmt;
+    entry.lru_it = prep_lru_.begin();
+    prep_cached_.store(prep_cache_.size(), std::memory_order_relaxed);
+    return stmt;
+}
+
+std::shared_ptr<Result> SqliteStub::execute_prepared(const PrepStmt& stmt, const Params& params) {
+    fct_->log()->ldebug("[execute_prepared] %s", stmt.sql().c_str());
+    if (params.size() != stmt.param_count()) {
+        fct_->log()->lerror("[execute_prepared] %zu params given, %zu expected: %s",
+            params.size(), stmt.param_count(), stmt.sql().c_str());
+        return std::shared_ptr<Result>(new MemResult(RetCode::FAILD, 0, nullptr));
+    }
+
+    sqlite3_stmt* handle = prepare_(stmt.sql());
+    if (handle == nullptr)
+        return std::shared_ptr<Result>(new MemResult(RetCode::FAILD, 0, nullptr));
+
+    sqlite3_clear_bindings(handle);
+    for (size_t i = 0; i < params.size(); i++) {
+        int idx = i + 1;
+        const Param& p = params[i];
+        switch (p.type()) {
+        case Value::INT:
+            sqlite3_bind_int64(handle, idx, p.get_int());
+            break;
+        case Value::UINT:
+            sqlite3_bind_int64(handle, idx, (sqlite3_int64)p.get_uint());
+            break;
+        case Value::DOUBLE:
+            sqlite3_bind_double(handle, idx, p.get_double());
+            break;
+        case Value::STRING:
+            sqlite3_bind_text(handle, idx, p.get_str().data(), p.get_str().size(), SQLITE_TRANSIENT);
+            break;
+        default:
+            sqlite3_bind_null(handle, idx);
+            break;
+        }
+    }
+    return run_(handle, stmt.is_query());
+}
+
+void SqliteStub::get_prep_stat(prep_stat_t& stat) const {
+    stat.hit += prep_hit_.load(std::memory_order_relaxed);
+    stat.miss += prep_miss_.load(std::memory_order_relaxed);
+    stat.evict += prep_evict_.load(std::memory_order_relaxed);
+    stat.cached += prep_cached_.load(std::memory_order_relaxed);
+}
+
+std::shared_ptr<Stub> SqliteDriver::create_stub() const {
+    sqlite3* db = nullptr;
+    int flags = SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_NOMUTEX;
+    bool memory = (path_ == ":memory:");
+    int rc;
+    if (memory)
+        rc = sqlite3_open_v2(SQLT_MEMORY_URI, &db, flags | SQLITE_OPEN_URI, nullptr);
+    else
+        rc = sqlite3_open_v2(path_.c_str(), &db, flags, nullptr);
+    fct_->log()->ldebug("[create_stub] path=%s", path_.c_str());
+    if (rc != SQLITE_OK) {
+        fct_->log()->lerror("[create_stub] Code(%d) %s", rc, db ? sqlite3_errmsg(db) : "");
+        sqlite3_close(db);
+        return nullptr;
+    }
+
+    sqlite3_busy_timeout(db, SQLT_BUSY_TIMEOUT);
+    // WAL: readers don't block the writer, and commit needs no fsync of the database file
+    const char* pragma = memory ? "PRAGMA synchronous=NORMAL"
+        : "PRAGMA journal_mode=WAL; PRAGMA synchronous=NORMAL";
+    char* err = nullptr;
+    if (sqlite3_exec(db, pragma, nullptr, nullptr, &err) != SQLITE_OK) {
+        fct_->log()->lerror("[create_stub] %s", err ? err : "");
+        sqlite3_free(err);
+        sqlite3_close(db);
+        return nullptr;
+    }
+    return std::shared_ptr<Stub>(new SqliteStub(fct_, db));
+}
+
+} // namespace orm
+} // namespace flame
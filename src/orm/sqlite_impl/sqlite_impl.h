@@ -0,0 +1,87 @@
+#ifndef FLAME_ORM_SQLITE_IMPL_SQLITE_IMPL_H
+#define FLAME_ORM_SQLITE_IMPL_SQLITE_IMPL_H
+
+#include <atomic>
+#include <list>
+#include <string>
+#include <unordered_map>
+
+#include <sqlite3.h>
+
+#include "common/context.h"
+#include "orm/driver.h"
+
+// Max number of prepared statements cached in each connection
+#define SQLT_PREP_CACHE_SIZE  64
+// Wait for the lock of other connections (ms)
+#define SQLT_BUSY_TIMEOUT     5000
+// In-memory database of the process. DBEngine keeps only one stub for it,
+// since shared-cache locks fail with SQLITE_LOCKED instead of waiting.
+#define SQLT_MEMORY_URI       "file:flame_orm_mem?mode=memory&cache=shared"
+
+namespace flame {
+namespace orm {
+
+/**
+ * SqliteStub
+ * One connection per stub. Rows of query are fetched into a MemDataSet,
+ * and the statement is reset at once, so no read transaction is left open.
+ */
+class SqliteStub final : public Stub {
+public:
+    ~SqliteStub();
+
+    virtual std::shared_ptr<Result> execute(const std::string& stmt) override;
+    virtual std::shared_ptr<Result> execute_query(const std::string& stmt) override;
+    virtual std::shared_ptr<Result> execute_update(const std::string& stmt) override;
+
+    /**
+     * The sqlite3_stmt is cached by SQL text (LRU), and values are bound
+     * by sqlite3_bind_*(). Unsigned values are stored as 64 bits signed int.
+     */
+    virtual std::shared_ptr<Result> execute_prepared(const PrepStmt& stmt, const Params& params) override;
+
+    virtual void get_prep_stat(prep_stat_t& stat) const override;
+
+private:
+    SqliteStub(FlameContext* fct, sqlite3* db)
+    : Stub(fct), prep_hit_(0), prep_miss_(0), prep_evict_(0), prep_cached_(0), db_(db) {}
+
+    friend class SqliteDriver;
+
+    std::shared_ptr<Result> run_(sqlite3_stmt* stmt, bool query);
+
+    sqlite3_stmt* prepare_(const std::string& sql);
+
+    struct prep_entry_t {
+        sqlite3_stmt* stmt;
+        std::list<std::string>::iterator lru_it;
+    };
+
+    std::unordered_map<std::string, prep_entry_t> prep_cache_;
+    std::list<std::string> prep_lru_;   // front is the most recently used
+
+    // Stub is used by one thread at a time, but statistics may be read by others
+    std::atomic<uint64_t> prep_hit_;
+    std::atomic<uint64_t> prep_miss_;
+    std::atomic<uint64_t> prep_evict_;
+    std::atomic<uint64_t> prep_cached_;
+
+    sqlite3* db_;
+}; // class SqliteStub
+
+class SqliteDriver final : public Driver {
+public:
+    /**
+     * @path: database file, ":memory:" for an in-memory database
+     */
+    SqliteDriver(FlameContext* fct, const std::string& path)
+        : Driver(fct, "SQLite", path) {}
+
+    virtual std::shared_ptr<Stub> create_stub() const override;
+}; // class SqliteDriver
+
+} // namespace orm
+} // namespace flame
+
+#endif // FLAME_ORM_SQLITE_IMPL_SQLITE_IMPL_H
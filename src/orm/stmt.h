@@ -82,7 +82,11 @@ public:
     std::string type_name() const { return type_name_; }
     std::string full_name() const { 
         return parent_ == nullptr ? 
-            col_name_ : parent_->__table_name__ + "." + col_name_; 
+            col_name_ : parent_->__table_name__ + ".`" + col_name_ + "`"; 
+    }
+    // Without table name, for column list of INSERT and SET of UPDATE
+    std::string short_name() const {
+        return parent_ == nullptr ? col_name_ : "`" + col_name_ + "`";
     }
     std::string flags() const;
     std::string to_str() const;
@@ -175,6 +179,9 @@ public:
     virtual std::string to_str() const { 
         return col_ == nullptr ? stmt_ : col_->full_name(); 
     }
+    std::string short_str() const {
+        return col_ == nullptr ? stmt_ : col_->short_name();
+    }
     virtual bool empty() const { return stmt_.empty() && col_ == nullptr; }
     virtual void clear() { 
         stmt_.clear(); 
@@ -477,7 +484,7 @@ public:
     }
 
     InsertStmt& column(const ColumnStmt& col) { 
-        string_append(partitions_, ", ", col.to_str());
+        string_append(partitions_, ", ", col.short_str());
         return *this;
     }
 
@@ -644,7 +651,7 @@ public:
 
     MultiInsertStmt& column(const std::initializer_list<ColumnStmt>& cols) {
         for (auto it = cols.begin(); it != cols.end(); it++)
-            string_append(partitions_, ", ", it->to_str());
+            string_append(partitions_, ", ", it->short_str());
         return *this;
     }
 
@@ -23,11 +23,12 @@ public:
     DeleteHandle remove() { return DeleteHandle(engine_).table(*this); }
 
     bool auto_create() { 
-        try_create(); 
+        return try_create(); 
     }
     
     bool recreate() { 
-        try_drop(); try_create(); 
+        try_drop(); 
+        return try_create(); 
     }
 
 private:
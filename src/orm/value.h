@@ -122,6 +122,23 @@ public:
     virtual std::string to_str() const override { return "NULL"; }
 }; // class StringVal
 
+/**
+ * ParamVal
+ * Placeholder of prepared statement, value is bound at execution
+ */
+class ParamVal : public Value {
+public:
+    ParamVal() : Value(EnumValueTypes::NONE) {}
+    ~ParamVal() {}
+
+    ParamVal(const ParamVal&) = default;
+    ParamVal(ParamVal&&) = default;
+    ParamVal& operator=(const ParamVal&) = default;
+    ParamVal& operator=(ParamVal&&) = default;
+
+    virtual std::string to_str() const override { return "?"; }
+}; // class ParamVal
+
 } // namespace orm
 } // namespace flame
 
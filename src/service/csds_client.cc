@@ -1,5 +1,6 @@
 #include "csds_client.h"
 #include "proto/csds.pb.h"
+#include "include/retcode.h"
 
 #include <sstream>
 
@@ -24,12 +25,12 @@ int CsdsClientImpl::chunk_fetch(std::list<chunk_version_t>& res, const std::list
 
     if (stat.ok()) {
         for (int i = 0; i < reply.chk_ver_list_size(); i++) {
-            ChunkVersionItem* chk_ver = reply.add_chk_ver_list();
+            const ChunkVersionItem& chk_ver = reply.chk_ver_list(i);
             chunk_version_t ver;
-            ver.chk_id  = chk_ver->chk_id();
-            ver.epoch   = chk_ver->epoch();
-            ver.version = chk_ver->version();
-            ver.used    = chk_ver->used();
+            ver.chk_id  = chk_ver.chk_id();
+            ver.epoch   = chk_ver.epoch();
+            ver.version = chk_ver.version();
+            ver.used    = chk_ver.used();
             res.push_back(ver);
         }
         return 0;
@@ -59,6 +60,10 @@ int CsdsClientImpl::chunk_signal(const std::list<chunk_signal_t>& chk_sgn_list)
     }
 }
 
+shared_ptr<CsdsChunkWriter> CsdsClientImpl::chunk_write(uint64_t chk_id) {
+    return shared_ptr<CsdsChunkWriter>(new CsdsChunkWriterImpl(fct_, stub_.get(), chk_id));
+}
+
 int CsdsClientImpl::shutdown(uint64_t csd_id) {
     ShutdownRequest req;
     req.set_csd_id(csd_id);
@@ -196,6 +201,7 @@ int CsdsClientImpl::chunk_move(std::list<chunk_bulk_res_t>& res, const std::list
         attr->set_src_id(it->src_id);
         attr->set_dst_id(it->dst_id);
         attr->set_signal(it->signal);
+        attr->set_dst_addr(it->dst_addr);
     }
 
     ChunkBulkReply reply;
@@ -217,6 +223,57 @@ int CsdsClientImpl::chunk_move(std::list<chunk_bulk_res_t>& res, const std::list
     }
 }
 
+int CsdsClientImpl::qos_set(const std::list<qos_attr_t>& qos_list) {
+    QosSetRequest req;
+    for (auto it = qos_list.begin(); it != qos_list.end(); it++) {
+        auto item = req.add_qos_list();
+        item->set_type(it->type);
+        item->set_id(it->id);
+        item->set_rsv_iops(it->rsv_iops);
+        item->set_lim_iops(it->lim_iops);
+        item->set_lim_bps(it->lim_bps);
+        item->set_burst_iops(it->burst_iops);
+        item->set_burst_bps(it->burst_bps);
+        item->set_weight(it->weight);
+    }
+
+    CsdsReply reply;
+    ClientContext ctx;
+    Status stat = stub_->setQos(&ctx, req, &reply);
+
+    if (stat.ok()) {
+        return reply.code();
+    } else {
+        fct_->log()->lerror("RPC Faild(%d): %s", stat.error_code(), stat.error_message().c_str());
+        return -stat.error_code();
+    }
+}
+
+int CsdsChunkWriterImpl::write(uint64_t off, const void* buff, uint64_t len) {
+    ChunkDataSegment seg;
+    seg.set_chk_id(chk_id_);
+    seg.set_off(off);
+    seg.set_data(buff, len);
+
+    if (!writer_->Write(seg)) {
+        fct_->log()->lerror("write chunk stream broken: %llu", chk_id_);
+        return RC_FAILD;
+    }
+    return RC_SUCCESS;
+}
+
+int CsdsChunkWriterImpl::finish() {
+    writer_->WritesDone();
+    Status stat = writer_->Finish();
+
+    if (stat.ok()) {
+        return reply_.code();
+    } else {
+        fct_->log()->lerror("RPC Faild(%d): %s", stat.error_code(), stat.error_message().c_str());
+        return -stat.error_code();
+    }
+}
+
 std::shared_ptr<CsdsClient> CsdsClientFoctoryImpl::make_csds_client(node_addr_t addr) {
     uint32_t ip = addr.get_ip();
     uint8_t* part = (uint8_t*)&ip;
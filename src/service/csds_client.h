@@ -12,6 +12,22 @@
 
 namespace flame {
 
+class CsdsChunkWriterImpl final : public CsdsChunkWriter {
+public:
+    CsdsChunkWriterImpl(FlameContext* fct, CsdsService::Stub* stub, uint64_t chk_id)
+    : CsdsChunkWriter(fct), chk_id_(chk_id), writer_(stub->writeChunk(&ctx_, &reply_)) {}
+
+    virtual int write(uint64_t off, const void* buff, uint64_t len) override;
+
+    virtual int finish() override;
+
+private:
+    uint64_t chk_id_;
+    grpc::ClientContext ctx_;
+    CsdsReply reply_;
+    std::unique_ptr<grpc::ClientWriter<ChunkDataSegment>> writer_;
+}; // class CsdsChunkWriterImpl
+
 class CsdsClientImpl final : public CsdsClient {
 public:
     CsdsClientImpl(FlameContext* fct, std::shared_ptr<grpc::Channel> channel)
@@ -31,6 +47,9 @@ public:
     // 推送Chunk信号：告知Chunk的行为或状态
     virtual int chunk_signal(const std::list<chunk_signal_t>& chk_sgn_list) override;
 
+    // 打开Chunk数据写入流（迁移）
+    virtual std::shared_ptr<CsdsChunkWriter> chunk_write(uint64_t chk_id) override;
+
     /**
      * MGR Ctrl
      */
@@ -53,6 +72,9 @@ public:
     // Chunk迁移通告
     virtual int chunk_move(std::list<chunk_bulk_res_t>& res, const std::list<chunk_move_attr_t>& attr_list) override;
 
+    // 设置卷/客户端的QoS
+    virtual int qos_set(const std::list<qos_attr_t>& qos_list) override;
+
 private:
     std::unique_ptr<CsdsService::Stub> stub_;
 }; // class CsdsClient
@@ -1,8 +1,14 @@
 #include "csds_service.h"
 
 #include "include/meta.h"
+#include "include/retcode.h"
+#include "csd/chunk_migrator.h"
+#include "csd/chunk_health.h"
+#include "csd/chunk_io_sched.h"
+#include "libflame/libchunk/cmd_trace.h"
 
 using grpc::ServerContext;
+using grpc::ServerReader;
 using grpc::Status;
 
 namespace flame {
@@ -13,6 +19,18 @@ Status CsdsServiceImpl::fetchChunk(ServerContext* context,
 const ChunkFetchRequest* request, ChunkFetchReply* response)
 {
     cct_->log()->ltrace("csds_service", "");
+    for (int i = 0; i < request->chk_id_list_size(); i++) {
+        uint64_t chk_id = request->chk_id_list(i);
+        auto chk = cs_->chunk_open(chk_id);
+        chunk_info_t info;
+        if (!chk || chk->get_info(info) != RC_SUCCESS)
+            continue;
+        auto item = response->add_chk_ver_list();
+        item->set_chk_id(chk_id);
+        item->set_epoch(info.ctime);
+        item->set_version(0);
+        item->set_used(info.used);
+    }
     return Status::OK;
 }
 
@@ -24,6 +42,37 @@ const ChunkSignalRequest* request, CsdsReply* response)
     return Status::OK;
 }
 
+// 写入迁移数据
+Status CsdsServiceImpl::writeChunk(ServerContext* context,
+ServerReader<ChunkDataSegment>* reader, CsdsReply* response)
+{
+    cct_->log()->ltrace("csds_service", "");
+    ChunkDataSegment seg;
+    std::shared_ptr<Chunk> chk;
+    uint64_t chk_id = 0;
+    int r = RC_SUCCESS;
+    while (reader->Read(&seg)) {
+        if (r != RC_SUCCESS)
+            continue;   // 读完剩余数据段，保证流正常结束
+        if (!chk || seg.chk_id() != chk_id) {
+            chk_id = seg.chk_id();
+            chk = cs_->chunk_open(chk_id);
+            if (!chk) {
+                r = RC_OBJ_NOT_FOUND;
+                continue;
+            }
+        }
+        const std::string& data = seg.data();
+        r = chk->write_sync((void*)data.data(), seg.off(), data.size());
+        if (r != RC_SUCCESS) {
+            cct_->log()->lerror("write migrate data of chunk (%llu) off(%llu) faild: %d", 
+                seg.chk_id(), seg.off(), r);
+        }
+    }
+    response->set_code(r);
+    return Status::OK;
+}
+
 // MGR Ctrl
 // 关闭CSD
 Status CsdsServiceImpl::shutdown(ServerContext* context,
@@ -56,6 +105,8 @@ const ChunkCreateRequest* request, ChunkBulkReply* response)
         opts.flags = request->flags();
         opts.size = request->size();
         r = cs_->chunk_create(chk_id, opts);
+        if (r == RC_SUCCESS && cct_->hlt())
+            cct_->hlt()->chunk_add(chk_id, opts.size);
         auto chkr = response->add_res_list();
         chkr->set_chk_id(chk_id);
         chkr->set_res(r);
@@ -72,6 +123,10 @@ const ChunkRemoveRequest* request, ChunkBulkReply* response)
     for (int i = 0; i < request->chk_id_list_size(); i++) {
         uint64_t chk_id = request->chk_id_list(i);
         r = cs_->chunk_remove(chk_id);
+        if (r == RC_SUCCESS && cct_->sched())
+            cct_->sched()->chunk_remove(chk_id);
+        if (r == RC_SUCCESS && cct_->hlt())
+            cct_->hlt()->chunk_remove(chk_id);
         auto chkr = response->add_res_list();
         chkr->set_chk_id(chk_id);
         chkr->set_res(r);
@@ -92,6 +147,105 @@ Status CsdsServiceImpl::moveChunk(ServerContext* context,
 const ChunkMoveRequest* request, ChunkBulkReply* response)
 {
     cct_->log()->ltrace("csds_service", "");
+    int r;
+    for (int i = 0; i < request->chk_list_size(); i++) {
+        const ChunkMoveItem& item = request->chk_list(i);
+        chunk_move_attr_t attr;
+        attr.chk_id = item.chk_id();
+        attr.src_id = item.src_id();
+        attr.dst_id = item.dst_id();
+        attr.signal = item.signal();
+        attr.dst_addr = item.dst_addr();
+        if (attr.src_id != cct_->csd_id() || !cct_->migrator())
+            r = RC_REFUSED;
+        else
+            r = cct_->migrator()->submit(attr);
+        auto chkr = response->add_res_list();
+        chkr->set_chk_id(attr.chk_id);
+        chkr->set_res(r);
+    }
+    return Status::OK;
+}
+
+// 设置QoS
+Status CsdsServiceImpl::setQos(ServerContext* context,
+const QosSetRequest* request, CsdsReply* response)
+{
+    cct_->log()->ltrace("csds_service", "");
+    if (!cct_->sched()) {
+        response->set_code(RC_REFUSED);
+        return Status::OK;
+    }
+    std::list<qos_attr_t> attr_list;
+    for (int i = 0; i < request->qos_list_size(); i++) {
+        const QosItem& item = request->qos_list(i);
+        qos_attr_t attr;
+        attr.type = item.type();
+        attr.id = item.id();
+        attr.rsv_iops = item.rsv_iops();
+        attr.lim_iops = item.lim_iops();
+        attr.lim_bps = item.lim_bps();
+        attr.burst_iops = item.burst_iops();
+        attr.burst_bps = item.burst_bps();
+        attr.weight = item.weight();
+        attr_list.push_back(attr);
+    }
+    cct_->sched()->qos_set(attr_list);
+    response->set_code(RC_SUCCESS);
+    return Status::OK;
+}
+
+Status CsdsServiceImpl::setTrace(ServerContext* context,
+const TraceSetRequest* request, CsdsReply* response)
+{
+    cct_->log()->ltrace("csds_service", "");
+    CmdTracer* tracer = CmdTracer::get_tracer();
+    tracer->set_slow(request->slow_us() * 1000, request->sample(), CMD_TRACE_SLOW_KEEP);
+    tracer->set_enable(request->enable());
+    response->set_code(RC_SUCCESS);
+    return Status::OK;
+}
+
+Status CsdsServiceImpl::getTrace(ServerContext* context,
+const TraceQueryRequest* request, TraceReply* response)
+{
+    cct_->log()->ltrace("csds_service", "");
+    CmdTracer* tracer = CmdTracer::get_tracer();
+    response->set_enable(tracer->enabled());
+    response->set_slow_us(tracer->slow_ns() / 1000);
+
+    std::list<cmd_trace_stage_stat_t> stages;
+    tracer->get_stage_stat(stages);
+    for (auto it = stages.begin(); it != stages.end(); it++) {
+        auto item = response->add_stage_list();
+        item->set_stage(cmd_trace_stage_name(it->stage));
+        item->set_count(it->count);
+        item->set_avg(it->avg);
+        item->set_max(it->max);
+        item->set_p50(it->p50);
+        item->set_p99(it->p99);
+        item->set_p999(it->p999);
+    }
+
+    std::list<cmd_slow_req_t> slows;
+    tracer->get_slow(slows, request->slow_num());
+    for (auto it = slows.begin(); it != slows.end(); it++) {
+        auto item = response->add_slow_list();
+        item->set_time(it->time);
+        item->set_cls(it->cls);
+        item->set_seq(it->seq);
+        item->set_chk_id(it->chk_id);
+        item->set_off(it->off);
+        item->set_len(it->bytes);
+        item->set_total(it->total);
+        item->set_dispatch(it->stage[CMD_TS_DISPATCH]);
+        item->set_xfer(it->stage[CMD_TS_XFER]);
+        item->set_exec(it->stage[CMD_TS_EXEC]);
+        item->set_send(it->stage[CMD_TS_SEND]);
+    }
+
+    if (request->reset())
+        tracer->reset();
     return Status::OK;
 }
 
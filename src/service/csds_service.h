@@ -20,6 +20,8 @@ public:
     virtual ::grpc::Status fetchChunk(::grpc::ServerContext* context, const ::ChunkFetchRequest* request, ::ChunkFetchReply* response);
     // 推送Chunk信号：告知Chunk的行为或者状态
     virtual ::grpc::Status pushChunkSignal(::grpc::ServerContext* context, const ::ChunkSignalRequest* request, ::CsdsReply* response);
+    // 写入迁移数据
+    virtual ::grpc::Status writeChunk(::grpc::ServerContext* context, ::grpc::ServerReader< ::ChunkDataSegment>* reader, ::CsdsReply* response);
 
     // MGR Ctrl
     // 关闭CSD
@@ -34,6 +36,14 @@ public:
     virtual ::grpc::Status chooseChunk(::grpc::ServerContext* context, const ::ChunkChooseRequest* request, ::ChunkBulkReply* response);
     // 迁移Chunk
     virtual ::grpc::Status moveChunk(::grpc::ServerContext* context, const ::ChunkMoveRequest* request, ::ChunkBulkReply* response);
+    // 设置QoS
+    virtual ::grpc::Status setQos(::grpc::ServerContext* context, const ::QosSetRequest* request, ::CsdsReply* response);
+
+    // Admin
+    // 设置命令的分阶段延迟跟踪
+    virtual ::grpc::Status setTrace(::grpc::ServerContext* context, const ::TraceSetRequest* request, ::CsdsReply* response);
+    // 查询命令的分阶段延迟与慢请求
+    virtual ::grpc::Status getTrace(::grpc::ServerContext* context, const ::TraceQueryRequest* request, ::TraceReply* response);
  
 private:
     std::shared_ptr<ChunkStore> cs_;
@@ -336,6 +336,52 @@ int FlameClientImpl::resize_volume(const std::string& vg_name, const std::string
     }
 }
 
+static void fill_qos_request(QosRequest& req, const qos_attr_t& attr) {
+    req.set_rsv_iops(attr.rsv_iops);
+    req.set_lim_iops(attr.lim_iops);
+    req.set_lim_bps(attr.lim_bps);
+    req.set_burst_iops(attr.burst_iops);
+    req.set_burst_bps(attr.burst_bps);
+    req.set_weight(attr.weight);
+}
+
+int FlameClientImpl::set_volume_qos(const std::string& vg_name, const std::string& vol_name, const qos_attr_t& attr) {
+    QosRequest req;
+    req.set_type(QOS_TYPE_VOL);
+    req.set_vg_name(vg_name);
+    req.set_vol_name(vol_name);
+    fill_qos_request(req, attr);
+
+    FlameReply reply;
+    ClientContext ctx;
+    Status stat = stub_->setQos(&ctx, req, &reply);
+
+    if (stat.ok()) {
+        return reply.code();
+    } else {
+        fct_->log()->lerror("RPC Failed(%d): %s", stat.error_code(), stat.error_message().c_str());
+        return -stat.error_code();
+    }
+}
+
+int FlameClientImpl::set_client_qos(uint64_t gw_id, const qos_attr_t& attr) {
+    QosRequest req;
+    req.set_type(QOS_TYPE_CLIENT);
+    req.set_gw_id(gw_id);
+    fill_qos_request(req, attr);
+
+    FlameReply reply;
+    ClientContext ctx;
+    Status stat = stub_->setQos(&ctx, req, &reply);
+
+    if (stat.ok()) {
+        return reply.code();
+    } else {
+        fct_->log()->lerror("RPC Failed(%d): %s", stat.error_code(), stat.error_message().c_str());
+        return -stat.error_code();
+    }
+}
+
 int FlameClientImpl::open_volume(uint64_t gw_id, const std::string& vg_name, const std::string& vol_name) {
     VolOpenRequest req;
     req.set_gw_id(gw_id);
@@ -70,6 +70,12 @@ public:
     // 更改Volume大小
     int resize_volume(const std::string& vg_name, const std::string& vol_name, uint64_t new_size) override;
 
+    // 设置Volume的QoS
+    int set_volume_qos(const std::string& vg_name, const std::string& vol_name, const qos_attr_t& attr) override;
+
+    // 设置客户端(GW)的QoS
+    int set_client_qos(uint64_t gw_id, const qos_attr_t& attr) override;
+
     // 打开Volume：在MGR登记Volume访问信息（没有加载元数据信息）
     int open_volume(uint64_t gw_id, const std::string& vg_name, const std::string& vol_name) override;
 
@@ -261,6 +261,30 @@ const VolResizeRequest* request, FlameReply* response)
     response->set_code(r);
     return Status::OK;
 }
+
+// 设置卷或客户端的QoS
+Status FlameServiceImpl::setQos(ServerContext* context,
+const QosRequest* request, FlameReply* response)
+{
+    mct_->log()->ltrace("flame_service", "setQos");
+
+    qos_attr_t attr;
+    attr.rsv_iops = request->rsv_iops();
+    attr.lim_iops = request->lim_iops();
+    attr.lim_bps = request->lim_bps();
+    attr.burst_iops = request->burst_iops();
+    attr.burst_bps = request->burst_bps();
+    attr.weight = request->weight();
+    int r;
+    if (request->type() == QOS_TYPE_VOL)
+        r = mct_->volm()->vol_set_qos(request->vg_name(), request->vol_name(), attr);
+    else if (request->type() == QOS_TYPE_CLIENT)
+        r = mct_->volm()->client_set_qos(request->gw_id(), attr);
+    else
+        r = RC_WRONG_PARAMETER;
+    response->set_code(r);
+    return Status::OK;
+}
     
 // 打开Volume：在MGR登记Volume访问信息（没有加载元数据信息）
 Status FlameServiceImpl::openVolume(ServerContext* context,
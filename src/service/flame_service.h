@@ -56,6 +56,8 @@ public:
     virtual ::grpc::Status getVolumeInfo(::grpc::ServerContext* context, const ::VolInfoRequest* request, ::VolInfoReply* response);
     // 更改Volume大小
     virtual ::grpc::Status resizeVolume(::grpc::ServerContext* context, const ::VolResizeRequest* request, ::FlameReply* response);
+    // 设置卷或客户端的QoS
+    virtual ::grpc::Status setQos(::grpc::ServerContext* context, const ::QosRequest* request, ::FlameReply* response);
     // 打开Volume：在MGR登记Volume访问信息（没有加载元数据信息）
     virtual ::grpc::Status openVolume(::grpc::ServerContext* context, const ::VolOpenRequest* request, ::FlameReply* response);
     // 关闭Volume：在MGR消除Volume访问信息
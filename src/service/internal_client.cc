@@ -158,6 +158,39 @@ int InternalClientImpl::push_health(const csd_hlt_attr_t& csd_hlt_attr) {
     }
 }
 
+int InternalClientImpl::push_report(const csd_report_attr_t& attr, bool& need_full) {
+    ReportRequest req;
+    req.set_csd_id(attr.csd_id);
+    req.set_stat(attr.stat);
+    req.set_seq(attr.seq);
+    req.set_base_seq(attr.base_seq);
+    req.set_has_health(attr.has_health);
+    if (attr.has_health) {
+        req.set_size(attr.csd_hlt_sub.size);
+        req.set_alloced(attr.csd_hlt_sub.alloced);
+        req.set_used(attr.csd_hlt_sub.used);
+        req.set_last_time(attr.csd_hlt_sub.period.ctime);
+        req.set_last_write(attr.csd_hlt_sub.period.wr_cnt);
+        req.set_last_read(attr.csd_hlt_sub.period.rd_cnt);
+        req.set_last_latency(attr.csd_hlt_sub.period.lat);
+        req.set_last_alloc(attr.csd_hlt_sub.period.alloc);
+        req.set_chk_num(attr.chk_num);
+        req.set_chk_delta(attr.chk_delta);
+    }
+
+    ReportReply reply;
+    ClientContext ctx;
+    Status stat = stub_->pushReport(&ctx, req, &reply);
+
+    if (stat.ok()) {
+        need_full = reply.need_full();
+        return reply.retcode().code();
+    } else {
+        fct_->log()->lerror("RPC Faild(%d): %s", stat.error_code(), stat.error_message().c_str());
+        return -stat.error_code();
+    }
+}
+
 int InternalClientImpl::pull_related_chunk(std::list<related_chk_attr_t>& res, const std::list<uint64_t>& chk_list) {
     ChunkPullRequest req;
     for (auto it = chk_list.begin(); it != chk_list.end(); ++it) {
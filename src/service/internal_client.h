@@ -40,6 +40,9 @@ public:
     // CSD健康信息汇报
     virtual int push_health(const csd_hlt_attr_t& csd_hlt_attr);
     
+    // CSD周期汇报
+    virtual int push_report(const csd_report_attr_t& attr, bool& need_full);
+    
     // 拉取关联Chunk信息
     virtual int pull_related_chunk(std::list<related_chk_attr_t>& res, const std::list<uint64_t>& chk_list);
     
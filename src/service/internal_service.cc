@@ -48,6 +48,10 @@ Status InternalServiceImpl::unregisterCsd(ServerContext* context,
 const UnregisterRequest* request, InternalReply* response)
 {
     int r = mct_->csdm()->csd_unregister(request->csd_id());
+    if (r == RC_SUCCESS) {
+        MutexLocker locker(report_lock_);
+        report_states_.erase(request->csd_id());
+    }
     response->set_code(r);
     mct_->log()->ltrace("internal_service", "csd (%llu) register: %d", request->csd_id(), r);
     return Status::OK;
@@ -63,6 +67,8 @@ const SignUpRequest* request, InternalReply* response)
     at.io_addr = request->io_addr();
     at.admin_addr = request->admin_addr();
     int r = mct_->csdm()->csd_sign_up(at); 
+    if (r == RC_SUCCESS && mct_->volm())
+        mct_->volm()->qos_sync(at.csd_id);
     response->set_code(r);
     mct_->log()->ltrace("internal_service", "csd (%llu) sign up: %d", at.csd_id, r);
     return Status::OK;
@@ -151,6 +157,78 @@ const HealthRequest* request, InternalReply* response)
     return Status::OK;
 }
 
+// CSD周期汇报
+Status InternalServiceImpl::pushReport(ServerContext* context,
+const ReportRequest* request, ReportReply* response)
+{
+    uint64_t csd_id = request->csd_id();
+    int r = mct_->cltm()->update_stat(csd_id, request->stat());
+    if (r != RC_SUCCESS || !request->has_health()) {
+        response->mutable_retcode()->set_code(r);
+        mct_->log()->lprint("internal_service", "csd (%llu) push report (%u): %d", csd_id, request->stat(), r);
+        return Status::OK;
+    }
+
+    csd_hlt_sub_t csd_hlt;
+    csd_hlt.csd_id = csd_id;
+    csd_hlt.size = request->size();
+    csd_hlt.alloced = request->alloced();
+    csd_hlt.used = request->used();
+    csd_hlt.period.ctime = request->last_time();
+    csd_hlt.period.wr_cnt = request->last_write();
+    csd_hlt.period.rd_cnt = request->last_read();
+    csd_hlt.period.lat = request->last_latency();
+    csd_hlt.period.alloc = request->last_alloc();
+    if ((r = mct_->csdm()->csd_health_update(csd_id, csd_hlt)) != RC_SUCCESS) {
+        mct_->log()->lerror("internal_service", "update csd health faild: %llu", csd_id);
+        response->mutable_retcode()->set_code(r);
+        return Status::OK;
+    }
+
+    // 还原出有变化的Chunk的健康信息
+    std::list<chk_hlt_attr_t> chk_hlt_list;
+    size_t base_num;
+    std::shared_ptr<report_state_t> state = report_state__(csd_id);
+    {
+        MutexLocker locker(state->lock);
+        bool full = request->base_seq() == 0;
+        if (!full && request->base_seq() != state->seq) {
+            mct_->log()->ldebug("internal_service", "csd (%llu) report base (%llu) mismatch (%llu), need full",
+                csd_id, request->base_seq(), state->seq);
+            response->set_need_full(true);
+            response->mutable_retcode()->set_code(RC_SUCCESS);
+            return Status::OK;
+        }
+
+        r = state->dec.decode(chk_hlt_list, request->chk_delta(), request->chk_num(), full, request->last_time());
+        if (r != RC_SUCCESS) {
+            mct_->log()->lerror("internal_service", "csd (%llu) report decode faild", csd_id);
+            state->seq = 0;
+            response->set_need_full(true);
+            response->mutable_retcode()->set_code(r);
+            return Status::OK;
+        }
+        state->seq = request->seq();
+        base_num = state->dec.size();
+    }
+
+    mct_->log()->ltrace("internal_service", "csd (%llu) push report: seq(%llu) base(%llu) chunks(%llu/%llu)",
+        csd_id, request->seq(), request->base_seq(), chk_hlt_list.size(), base_num);
+
+    if (!chk_hlt_list.empty())
+        r = mct_->chkm()->update_health(chk_hlt_list);
+    response->mutable_retcode()->set_code(r);
+    return Status::OK;
+}
+
+std::shared_ptr<InternalServiceImpl::report_state_t> InternalServiceImpl::report_state__(uint64_t csd_id) {
+    MutexLocker locker(report_lock_);
+    std::shared_ptr<report_state_t>& state = report_states_[csd_id];
+    if (!state)
+        state.reset(new report_state_t());
+    return state;
+}
+
 // 拉取关联Chunk信息
 Status InternalServiceImpl::pullRelatedChunk(ServerContext* context,
 const ChunkPullRequest* request, ChunkPullReply* response)
@@ -7,6 +7,11 @@
 #include "proto/internal.grpc.pb.h"
 
 #include "mgr/mgr_service.h"
+#include "common/hlt_codec.h"
+#include "common/thread/mutex.h"
+
+#include <map>
+#include <memory>
 
 namespace flame {
 namespace service {
@@ -29,6 +34,8 @@ public:
     virtual ::grpc::Status pushStatus(::grpc::ServerContext* context, const ::StatusRequest* request, ::InternalReply* response);
     // CSD健康信息汇报
     virtual ::grpc::Status pushHealth(::grpc::ServerContext* context, const ::HealthRequest* request, ::InternalReply* response);
+    // CSD周期汇报（心跳+状态+健康信息）
+    virtual ::grpc::Status pushReport(::grpc::ServerContext* context, const ::ReportRequest* request, ::ReportReply* response);
     // 拉取关联Chunk信息
     virtual ::grpc::Status pullRelatedChunk(::grpc::ServerContext* context, const ::ChunkPullRequest* request, ::ChunkPullReply* response);
     // 推送Chunk相关信息
@@ -42,6 +49,19 @@ protected:
     CsdMS* csd_ms {mct_->ms()->get_csd_ms()};
     CsdHealthMS* csd_hlt_ms {mct_->ms()->get_csd_health_ms()};
     GatewayMS* gw_ms {mct_->ms()->get_gw_ms()};
+
+private:
+    // 每个CSD的增量汇报基线
+    struct report_state_t {
+        Mutex lock;
+        uint64_t seq {0};   // 基线对应的汇报序号，0表示没有基线
+        ChunkHealthDecoder dec;
+    };
+
+    Mutex report_lock_;
+    std::map<uint64_t, std::shared_ptr<report_state_t>> report_states_;
+
+    std::shared_ptr<report_state_t> report_state__(uint64_t csd_id);
 }; // class InternalServiceImpl
 
 } // namespace service 
@@ -0,0 +1,363 @@
+/**
+ * @file chunk_bench.cc
+ * @brief 基于CmdClientStub的Chunk IO压测工具（类似fio）
+ * 对一个或多个CSD上的若干Chunk保持iodepth条未完成的读写命令，
+ * 统计IOPS、带宽与延迟分位数。支持RDMA与TCP两种传输。
+ * 服务端可以是CSD：CSD通过CmdServerStubImpl接收命令，监听地址由msg配置项
+ * (node_listen_ports等)决定，读写经过IO调度器和QoS下发到SimStore、FileStore
+ * 或NVMe设备，结果包含调度开销；也可以是server_test，直接访问内存，
+ * 用于单独测量传输层。被测的Chunk需要事先在CSD上创建。
+ *
+ * 用法示例:
+ *  chunk_bench --csd=127.0.0.1:7778 --chunk_num=4 --bs=4096 --iodepth=32 --rw=randrw --rwmixread=70 --runtime=30
+ *  chunk_bench --transport=tcp --csd=10.0.0.1:6666,10.0.0.2:6666 --rw=write --bs=131072
+ *  chunk_bench --csd=127.0.0.1:7778 --user_mem --bs=65536
+ */
+#include <sched.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <atomic>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "libflame/libchunk/libchunk.h"
+#include "libflame/libchunk/cmd_trace.h"
+#include "libflame/libchunk/log_libchunk.h"
+#include "include/csdc.h"
+#include "include/retcode.h"
+#include "common/cmdline.h"
+#include "util/utime.h"
+
+using namespace std;
+using namespace flame;
+using namespace flame::cli;
+
+class BenchCli final : public Cmdline {
+public:
+    BenchCli() : Cmdline("chunk_bench", "Chunk IO benchmark over CmdClientStub") {}
+
+    Argument<string>    transport   {this, 't', "transport", "rdma | tcp", "rdma"};
+    Argument<string>    config_path {this, 'c', "config_file", "flame client config, default flame_client.cfg (rdma) or flame_client_tcp.cfg (tcp)", ""};
+    Argument<string>    csd         {this, "csd", "CSD io addresses, ip:port[,ip:port...]", "127.0.0.1:7778"};
+    Argument<uint64_t>  chunk_base  {this, "chunk_base", "first chunk id", uint64_t(0)};
+    Argument<uint64_t>  chunk_num   {this, "chunk_num", "chunks on every CSD, ids are [chunk_base, chunk_base + chunk_num)", 1};
+    Argument<uint64_t>  chunk_size  {this, "chunk_size", "io range of every chunk, unit: B", 64ULL << 20};
+    Argument<uint64_t>  bs          {this, 'b', "bs", "block size, unit: B", 4096};
+    Argument<uint64_t>  iodepth     {this, 'd', "iodepth", "inflight cmds of every CSD", 32};
+    Argument<string>    rw          {this, "rw", "read | write | rw | randread | randwrite | randrw", "randread"};
+    Argument<uint64_t>  rwmixread   {this, "rwmixread", "percentage of reads in rw/randrw", 50};
+    Argument<uint64_t>  runtime     {this, "runtime", "run time, unit: s, 0 means until io_num is reached", 10};
+    Argument<uint64_t>  io_num      {this, "io_num", "total cmds to submit, 0 means until runtime is reached", uint64_t(0)};
+    Argument<uint64_t>  queue_num   {this, "queue_num", "completion queues of every client stub", 4};
+    Argument<string>    log_level   {this, "log_level", "log level", "WARN"};
+
+    Switch  report  {this, "report", "print iops every second"};
+    Switch  user_mem {this, "user_mem", "rdma only, use malloced buffers through the registration cache"};
+
+    HelpAction help {this};
+}; // class BenchCli
+
+/**
+ * @brief 一条未完成命令的上下文，一个槽位同时只有一条命令
+ */
+struct bench_slot_t {
+    atomic<bool>    busy    {false};
+    bool            is_read {false};
+    uint64_t        start   {0};
+    MemoryAreaImpl* ma      {nullptr};
+    msg::ib::RdmaBuffer* rdma_buf {nullptr};
+    char*           buf     {nullptr};
+};
+
+struct bench_target_t {
+    string                      addr;
+    shared_ptr<CmdClientStub>   stub;
+    shared_ptr<CmdClientStubImpl>       rdma_stub;
+    shared_ptr<CmdClientStubTcpImpl>    tcp_stub;
+    vector<bench_slot_t>        slots;
+    vector<uint64_t>            seq_off;    // 顺序IO时每个Chunk的下一个偏移
+};
+
+static CmdLatHist rd_hist;
+static CmdLatHist wr_hist;
+static atomic<uint64_t> rd_bytes {0};
+static atomic<uint64_t> wr_bytes {0};
+static atomic<uint64_t> err_cnt {0};
+static atomic<uint64_t> inflight {0};
+
+static void bench_cb(const Response& res, void* arg) {
+    bench_slot_t* slot = (bench_slot_t*)arg;
+    uint64_t lat = cycles_to_nsec(get_cycles() - slot->start);
+    if (res.get_rc() != RC_SUCCESS) {
+        err_cnt++;
+    } else if (slot->is_read) {
+        rd_hist.record(lat);
+        rd_bytes += slot->ma->get_len();
+    } else {
+        wr_hist.record(lat);
+        wr_bytes += slot->ma->get_len();
+    }
+    inflight--;
+    slot->busy.store(false, memory_order_release);
+}
+
+static void print_result(const char* name, const CmdLatHist& h, uint64_t bytes, double sec) {
+    uint64_t cnt = h.count();
+    if (cnt == 0)
+        return;
+    printf("%-5s: ios=%llu iops=%.1lf bw=%.2lfMB/s lat(us): avg=%.2lf p50=%.2lf p99=%.2lf p999=%.2lf max=%.2lf\n",
+        name, (unsigned long long)cnt, cnt / sec, bytes / sec / (1 << 20),
+        (double)h.sum() / cnt / 1000, h.percentile(0.5) / 1000.0, h.percentile(0.99) / 1000.0,
+        h.percentile(0.999) / 1000.0, h.max() / 1000.0);
+}
+
+static void split_addrs(const string& str, vector<string>& addrs) {
+    size_t start = 0;
+    while (start <= str.size()) {
+        size_t pos = str.find(',', start);
+        if (pos == string::npos)
+            pos = str.size();
+        if (pos > start)
+            addrs.push_back(str.substr(start, pos - start));
+        start = pos + 1;
+    }
+}
+
+static bool parse_addr(const string& addr, string& ip, int& port) {
+    size_t pos = addr.rfind(':');
+    if (pos == string::npos || pos == 0)
+        return false;
+    ip = addr.substr(0, pos);
+    port = atoi(addr.substr(pos + 1).c_str());
+    return port > 0;
+}
+
+int main(int argc, char** argv) {
+    BenchCli cli;
+    int r = cli.parser(argc, argv);
+    if (r != CmdRetCode::SUCCESS) {
+        cli.print_error();
+        return r;
+    } else if (cli.help.done()) {
+        cli.print_help();
+        return 0;
+    }
+
+    bool use_rdma = cli.transport.get() == "rdma";
+    if (!use_rdma && cli.transport.get() != "tcp") {
+        ::clog("invalid transport, must be rdma or tcp");
+        return -1;
+    }
+    string rw = cli.rw;
+    bool random = rw.compare(0, 4, "rand") == 0;
+    string mode = random ? rw.substr(4) : rw;
+    uint64_t read_pct;
+    if (mode == "read")
+        read_pct = 100;
+    else if (mode == "write")
+        read_pct = 0;
+    else if (mode == "rw")
+        read_pct = cli.rwmixread;
+    else {
+        ::clog("invalid rw mode");
+        return -1;
+    }
+    uint64_t bs = cli.bs;
+    uint64_t blocks = cli.chunk_size / bs;
+    if (bs == 0 || bs > UINT32_MAX || blocks == 0 || cli.iodepth == 0 || cli.chunk_num == 0
+      || read_pct > 100 || (cli.runtime == 0 && cli.io_num == 0)) {
+        ::clog("invalid arguments");
+        cli.print_help();
+        return -1;
+    }
+
+    string cfg_path = cli.config_path;
+    if (cfg_path.empty())
+        cfg_path = use_rdma ? "flame_client.cfg" : "flame_client_tcp.cfg";
+    FlameContext* flame_context = FlameContext::get_context();
+    if (!flame_context->init_config(cfg_path)) {
+        ::clog("init config failed.");
+        return -1;
+    }
+    if (!flame_context->init_log("", cli.log_level, "chunk_bench")) {
+        ::clog("init log failed.");
+        return -1;
+    }
+
+    vector<string> addrs;
+    split_addrs(cli.csd, addrs);
+    if (addrs.empty()) {
+        ::clog("no csd address");
+        return -1;
+    }
+    vector<bench_target_t> targets(addrs.size());
+    for (size_t i = 0; i < addrs.size(); i++) {
+        bench_target_t& t = targets[i];
+        string ip;
+        int port;
+        if (!parse_addr(addrs[i], ip, port)) {
+            ::clog("invalid csd address: " + addrs[i]);
+            return -1;
+        }
+        t.addr = addrs[i];
+        if (use_rdma) {
+            t.rdma_stub = CmdClientStubImpl::create_stub(ip, port, cli.queue_num, cli.iodepth);
+            t.stub = t.rdma_stub;
+        } else {
+            t.tcp_stub = CmdClientStubTcpImpl::create_stub(ip, port, cli.queue_num, cli.iodepth);
+            t.stub = t.tcp_stub;
+        }
+        if (!t.stub) {
+            ::clog("connect to csd failed: " + addrs[i]);
+            return -1;
+        }
+
+        // 数据缓冲区在压测开始前一次分配好
+        t.slots = vector<bench_slot_t>(cli.iodepth);
+        for (auto& slot : t.slots) {
+            if (use_rdma && cli.user_mem) {
+                // 每条命令提交前从注册缓存获取MemoryArea
+                slot.buf = (char*)aligned_alloc(4096, (bs + 4095) & ~4095ULL);
+            } else if (use_rdma) {
+                slot.rdma_buf = msg::Stack::get_rdma_stack()->get_rdma_allocator()->alloc(bs);
+                if (slot.rdma_buf == nullptr) {
+                    ::clog("alloc rdma buffer failed.");
+                    return -1;
+                }
+                slot.buf = slot.rdma_buf->buffer();
+                slot.ma = new MemoryAreaImpl((uint64_t)slot.buf, bs, slot.rdma_buf->rkey(), 1);
+            } else {
+                slot.buf = (char*)aligned_alloc(4096, (bs + 4095) & ~4095ULL);
+                slot.ma = new MemoryAreaImpl((uint64_t)slot.buf, bs, 0, 0);
+            }
+            memset(slot.buf, 'f', bs);
+        }
+        t.seq_off.assign(cli.chunk_num, 0);
+    }
+
+    mt19937_64 rng(utime_t::now().to_nsec());
+    uint64_t submitted = 0;
+    uint64_t io_num = cli.io_num;
+    uint64_t start_us = utime_t::now().to_usec();
+    uint64_t end_us = cli.runtime ? start_us + cli.runtime * 1000000 : UINT64_MAX;
+    uint64_t last_report_us = start_us;
+    uint64_t last_ios = 0;
+    bool stop = false;
+
+    while (!stop) {
+        bool idle = true;
+        for (auto& t : targets) {
+            for (auto& slot : t.slots) {
+                if (slot.busy.load(memory_order_acquire))
+                    continue;
+                if (io_num && submitted >= io_num) {
+                    stop = true;
+                    break;
+                }
+
+                uint64_t idx = rng() % cli.chunk_num;
+                uint64_t chk_id = cli.chunk_base + idx;
+                uint64_t off;
+                if (random) {
+                    off = (rng() % blocks) * bs;
+                } else {
+                    off = t.seq_off[idx];
+                    t.seq_off[idx] = off + bs >= blocks * bs ? 0 : off + bs;
+                }
+                slot.is_read = read_pct == 100 || (read_pct && rng() % 100 < read_pct);
+                if (use_rdma && cli.user_mem) {
+                    delete slot.ma;
+                    slot.ma = UserMemoryAreaImpl::create(slot.buf, bs);
+                    if (slot.ma == nullptr) {
+                        ::clog("register user memory failed.");
+                        err_cnt++;
+                        stop = true;
+                        break;
+                    }
+                }
+
+                cmd_t cmd;
+                if (slot.is_read)
+                    ChunkReadCmd read_cmd(&cmd, chk_id, off, bs, *slot.ma);
+                else
+                    ChunkWriteCmd write_cmd(&cmd, chk_id, off, bs, *slot.ma, 0);
+                slot.busy.store(true, memory_order_relaxed);
+                inflight++;
+                slot.start = get_cycles();
+                int ret = t.stub->submit(cmd, &bench_cb, &slot);
+                if (ret != RC_SUCCESS) {
+                    inflight--;
+                    slot.busy.store(false, memory_order_relaxed);
+                    if (ret != RC_REFUSED)
+                        err_cnt++;
+                    break;
+                }
+                submitted++;
+                idle = false;
+            }
+            if (stop)
+                break;
+        }
+
+        uint64_t now_us = utime_t::now().to_usec();
+        if (now_us >= end_us)
+            stop = true;
+        if (cli.report && now_us - last_report_us >= 1000000) {
+            uint64_t ios = rd_hist.count() + wr_hist.count();
+            printf("[%3llus] iops=%.1lf inflight=%llu err=%llu\n",
+                (unsigned long long)((now_us - start_us) / 1000000),
+                (ios - last_ios) * 1000000.0 / (now_us - last_report_us),
+                (unsigned long long)inflight.load(), (unsigned long long)err_cnt.load());
+            last_ios = ios;
+            last_report_us = now_us;
+        }
+        if (idle)
+            sched_yield();
+    }
+
+    // 等待未完成的命令，超时的命令由stub以RC_TIMEOUT完成
+    while (inflight.load() > 0) {
+        usleep(100);
+        for (auto& t : targets) {
+            if (t.rdma_stub)
+                t.rdma_stub->check_timeout();
+            else
+                t.tcp_stub->check_timeout();
+        }
+    }
+    double sec = (utime_t::now().to_usec() - start_us) / 1000000.0;
+
+    printf("transport=%s csd=%zu chunk=%llu rw=%s bs=%llu iodepth=%llu runtime=%.2lfs err=%llu\n",
+        cli.transport.get().c_str(), targets.size(), (unsigned long long)cli.chunk_num.get(), rw.c_str(),
+        (unsigned long long)bs, (unsigned long long)cli.iodepth.get(), sec, (unsigned long long)err_cnt.load());
+    print_result("read", rd_hist, rd_bytes.load(), sec);
+    print_result("write", wr_hist, wr_bytes.load(), sec);
+    msg::ib::RdmaMrCache* mr_cache = use_rdma ? msg::Stack::get_rdma_stack()->get_mr_cache() : nullptr;
+    if (cli.user_mem && mr_cache) {
+        msg::ib::rdma_mr_cache_stat_t stat;
+        mr_cache->get_stat(stat);
+        printf("mr cache: hit=%llu miss=%llu evict=%llu reg_fail=%llu regions=%llu reged=%lluB\n",
+            (unsigned long long)stat.hit, (unsigned long long)stat.miss, (unsigned long long)stat.evict,
+            (unsigned long long)stat.reg_fail, (unsigned long long)stat.region_num,
+            (unsigned long long)stat.reged_bytes);
+    }
+
+    for (auto& t : targets) {
+        for (auto& slot : t.slots) {
+            delete slot.ma;
+            if (slot.rdma_buf) {
+                msg::Stack::get_rdma_stack()->get_rdma_allocator()->free(slot.rdma_buf);
+            } else {
+                if (use_rdma)
+                    UserMemoryAreaImpl::invalidate(slot.buf, bs);
+                free(slot.buf);
+            }
+        }
+    }
+    flame_context->log()->ltrace("Start to exit!");
+
+    return 0;
+}
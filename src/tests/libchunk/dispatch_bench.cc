@@ -0,0 +1,90 @@
+/**
+ * @file dispatch_bench.cc
+ * @brief 命令分发开销的微基准
+ * 对比 std::map 查找（原实现）与定长分发表查找，以及开启统计后的开销。
+ *
+ * 用法: dispatch_bench [loops=10000000]
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <vector>
+
+#include "include/cmd.h"
+#include "include/csdc.h"
+#include "util/utime.h"
+
+using namespace flame;
+
+// 只测量分发本身，服务不做任何事
+class NopCmdService final : public CmdService {
+public:
+    int call(RdmaWorkRequest *req) override { return 0; }
+    int call(TcpWorkRequest *req) override { return 0; }
+}; // class NopCmdService
+
+static double ns_per_op(uint64_t start, uint64_t loops) {
+    return (double)(utime_t::now().to_nsec() - start) / loops;
+}
+
+int main(int argc, char** argv) {
+    uint64_t loops = argc > 1 ? atoll(argv[1]) : 10000000;
+    if (loops == 0) {
+        printf("usage: %s [loops=10000000]\n", argv[0]);
+        return -1;
+    }
+
+    CmdServiceMapper* mapper = CmdServiceMapper::get_cmd_service_mapper();
+    NopCmdService svc[4];
+    for (uint8_t seq = CMD_CHK_IO_READ; seq <= CMD_CHK_IO_RESET; seq++)
+        mapper->register_service(CMD_CLS_IO_CHK, seq, &svc[seq - CMD_CHK_IO_READ]);
+    mapper->freeze();
+
+    std::map<uint16_t, CmdService*> old_mapper;
+    for (uint8_t seq = CMD_CHK_IO_READ; seq <= CMD_CHK_IO_RESET; seq++)
+        old_mapper[(CMD_CLS_IO_CHK << 8) | seq] = mapper->get_service(CMD_CLS_IO_CHK, seq);
+    // 控制平面预留的命令类也注册若干，使map的深度接近实际
+    for (uint16_t cls = CMD_CLS_MGR; cls <= CMD_CLS_MSG; cls += 0x10)
+        for (uint16_t seq = 1; seq <= 16; seq++)
+            old_mapper[(cls << 8) | seq] = &svc[0];
+
+    // 命令混合：读写为主
+    std::vector<cmd_t> cmds(1024);
+    srand(1);
+    for (size_t i = 0; i < cmds.size(); i++) {
+        memset(&cmds[i], 0, sizeof(cmd_t));
+        cmds[i].hdr.cn.cls = CMD_CLS_IO_CHK;
+        cmds[i].hdr.cn.seq = rand() % 10 < 8 ? CMD_CHK_IO_READ + rand() % 2 : CMD_CHK_IO_SET + rand() % 2;
+        ((cmd_chk_io_rd_t*)cmds[i].cont)->ma.len = 4096;
+    }
+    size_t mask = cmds.size() - 1;
+    uintptr_t sink = 0;
+
+    uint64_t start = utime_t::now().to_nsec();
+    for (uint64_t i = 0; i < loops; i++) {
+        const cmd_t& c = cmds[i & mask];
+        sink += (uintptr_t)old_mapper[(c.hdr.cn.cls << 8) | c.hdr.cn.seq];
+    }
+    printf("std::map        %6.2lf ns/op\n", ns_per_op(start, loops));
+
+    start = utime_t::now().to_nsec();
+    for (uint64_t i = 0; i < loops; i++) {
+        const cmd_t& c = cmds[i & mask];
+        sink += (uintptr_t)mapper->get_service(c.hdr.cn.cls, c.hdr.cn.seq);
+    }
+    printf("dispatch table  %6.2lf ns/op\n", ns_per_op(start, loops));
+
+    mapper->set_stat_enable(true);
+    start = utime_t::now().to_nsec();
+    for (uint64_t i = 0; i < loops; i++) {
+        const cmd_t& c = cmds[i & mask];
+        sink += (uintptr_t)mapper->get_service(c.hdr.cn.cls, c.hdr.cn.seq);
+        mapper->record(c.hdr.cn.cls, c.hdr.cn.seq, CmdServiceMapper::get_io_bytes(&c), i & 0xffff);
+    }
+    printf("table + stat    %6.2lf ns/op\n", ns_per_op(start, loops));
+
+    const cmd_stat_t* st = mapper->get_stat(CMD_CLS_IO_CHK, CMD_CHK_IO_READ);
+    printf("read count(%llu) bytes(%llu) sink(%llu)\n", (unsigned long long)st->count.load(),
+        (unsigned long long)st->bytes.load(), (unsigned long long)(sink & 0xff));
+    return 0;
+}
@@ -0,0 +1,97 @@
+/**
+ * @file tcp_client_test.cc
+ * @brief 通过TCP传输访问server_test
+ * 同一连接上保持iodepth条未完成的读写命令，统计IOPS与平均延迟，
+ * 可与client_test（RDMA）对比。
+ *
+ * 用法: tcp_client_test [iodepth=32] [count=10000] [io_size=4096]
+ */
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <atomic>
+#include <vector>
+
+#include "libflame/libchunk/libchunk.h"
+#include "include/csdc.h"
+#include "include/retcode.h"
+#include "libflame/libchunk/log_libchunk.h"
+#include "util/utime.h"
+
+#define CFG_PATH "flame_client_tcp.cfg"
+using namespace flame;
+
+struct io_ctx_t {
+    uint64_t start;
+    char* buf;
+};
+
+static std::atomic<uint64_t> done_cnt {0};
+static std::atomic<uint64_t> lat_sum {0};
+static std::atomic<uint64_t> err_cnt {0};
+
+void cb_func(const Response& res, void* arg){
+    io_ctx_t* ctx = (io_ctx_t *)arg;
+    if(res.get_rc() != 0) err_cnt++;
+    lat_sum += utime_t::now().to_usec() - ctx->start;
+    done_cnt++;
+    return ;
+}
+
+int main(int argc, char** argv){
+    uint32_t iodepth = argc > 1 ? atoi(argv[1]) : 32;
+    uint64_t count = argc > 2 ? atoll(argv[2]) : 10000;
+    uint32_t io_size = argc > 3 ? atoi(argv[3]) : 4096;
+    if(iodepth == 0 || count == 0 || io_size == 0){
+        printf("usage: %s [iodepth=32] [count=10000] [io_size=4096]\n", argv[0]);
+        return -1;
+    }
+
+    FlameContext *flame_context = FlameContext::get_context();
+    if(!flame_context->init_config(CFG_PATH)){
+        clog("init config failed.");
+        return -1;
+    }
+    if(!flame_context->init_log("", "INFO", "client")){
+        clog("init log failed.");
+        return -1;
+    }
+
+    std::shared_ptr<CmdClientStubTcpImpl> cmd_client_stub = CmdClientStubTcpImpl::create_stub("127.0.0.1", 6666, 1, iodepth);
+
+    /* 先写入，再读出并校验前几个字节 */
+    std::vector<char> wbuf(io_size, 'x');
+    memcpy(wbuf.data(), "1234567", io_size < 8 ? io_size : 8);
+    MemoryAreaImpl memory_write((uint64_t)wbuf.data(), io_size, 0, 0);
+    std::vector<char> rbuf(io_size);
+    MemoryAreaImpl memory_read((uint64_t)rbuf.data(), io_size, 0, 0);
+
+    std::vector<io_ctx_t> ctxs(count);
+    uint64_t start = utime_t::now().to_usec();
+    for(uint64_t i = 0; i < count; i++){
+        cmd_t cmd;
+        if(i % 2){
+            ChunkReadCmd read_cmd(&cmd, 0, 0, io_size, memory_read);
+        }else{
+            ChunkWriteCmd write_cmd(&cmd, 0, 0, io_size, memory_write, 0);
+        }
+        ctxs[i].start = utime_t::now().to_usec();
+        while(cmd_client_stub->submit(cmd, &cb_func, &ctxs[i]) == RC_REFUSED){
+            //**iodepth已满，等待完成
+            usleep(10);
+            ctxs[i].start = utime_t::now().to_usec();
+        }
+    }
+    while(done_cnt.load() < count){
+        usleep(100);
+    }
+    double sec = (utime_t::now().to_usec() - start) / 1000000.0;
+
+    printf("iodepth(%u) io_size(%u) count(%llu) error(%llu) iops(%.1lf) avg_lat(%.1lf us) read(%.7s)\n",
+        iodepth, io_size, (unsigned long long)count, (unsigned long long)err_cnt.load(),
+        count / sec, (double)lat_sum.load() / count, rbuf.data());
+
+    flame_context->log()->ltrace("Start to exit!");
+
+    return 0;
+}
@@ -0,0 +1,186 @@
+/**
+ * @file hb_storm.cc
+ * @brief 心跳风暴压测工具
+ * 模拟N个CSD按固定周期向MGR发送心跳与健康信息，同时以固定频率探测
+ * 客户端控制请求(getClusterInfo)的延迟，用于验证MGR在大规模心跳下
+ * 控制请求不被阻塞。
+ *
+ * 用法: hb_storm <mgr_addr> [csd_num=1000] [hb_cycle_ms=3000] [duration_s=30] [threads=8]
+ */
+#include <grpcpp/grpcpp.h>
+#include "proto/internal.grpc.pb.h"
+#include "proto/flame.grpc.pb.h"
+#include "include/meta.h"
+#include "util/utime.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <algorithm>
+
+using namespace std;
+using namespace flame;
+
+struct lat_stat_t {
+    mutex lock;
+    vector<uint64_t> lats;  // (us)
+    uint64_t faild {0};
+
+    void add(uint64_t us, bool ok) {
+        lock_guard<mutex> guard(lock);
+        if (ok)
+            lats.push_back(us);
+        else
+            faild++;
+    }
+
+    void print(const char* name, double sec) {
+        lock_guard<mutex> guard(lock);
+        sort(lats.begin(), lats.end());
+        size_t n = lats.size();
+        printf("%-10s count(%zu) faild(%llu) qps(%.1lf) p50(%llu us) p99(%llu us) max(%llu us)\n",
+            name, n, (unsigned long long)faild, sec > 0 ? n / sec : 0,
+            (unsigned long long)(n ? lats[n / 2] : 0),
+            (unsigned long long)(n ? lats[n * 99 / 100] : 0),
+            (unsigned long long)(n ? lats[n - 1] : 0));
+    }
+};
+
+static uint64_t now_us() {
+    return utime_t::now().to_usec();
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        printf("usage: %s <mgr_addr> [csd_num=1000] [hb_cycle_ms=3000] [duration_s=30] [threads=8]\n", argv[0]);
+        return -1;
+    }
+    string addr = argv[1];
+    int csd_num = argc > 2 ? atoi(argv[2]) : 1000;
+    int cycle_ms = argc > 3 ? atoi(argv[3]) : 3000;
+    int duration = argc > 4 ? atoi(argv[4]) : 30;
+    int thr_num = argc > 5 ? atoi(argv[5]) : 8;
+    if (csd_num <= 0 || cycle_ms <= 0 || duration <= 0 || thr_num <= 0) {
+        printf("wrong parameter\n");
+        return -1;
+    }
+
+    shared_ptr<grpc::Channel> channel = grpc::CreateChannel(addr, grpc::InsecureChannelCredentials());
+    unique_ptr<InternalService::Stub> internal(InternalService::NewStub(channel));
+    unique_ptr<FlameService::Stub> flame(FlameService::NewStub(channel));
+
+    // 注册并上线模拟的CSD
+    vector<uint64_t> csd_ids;
+    for (int i = 0; i < csd_num; i++) {
+        RegisterRequest req;
+        req.set_csd_name("hb_storm." + to_string(i));
+        req.set_size(1ULL << 40);
+        req.set_io_addr(i + 1);
+        req.set_admin_addr(i + 1);
+        req.set_stat(CSD_STAT_PAUSE);
+        RegisterReply rep;
+        grpc::ClientContext ctx;
+        grpc::Status s = internal->registerCsd(&ctx, req, &rep);
+        if (!s.ok() || rep.retcode().code() != 0) {
+            printf("register csd %d faild\n", i);
+            continue;
+        }
+
+        SignUpRequest sreq;
+        sreq.set_csd_id(rep.csd_id());
+        sreq.set_stat(CSD_STAT_ACTIVE);
+        sreq.set_io_addr(i + 1);
+        sreq.set_admin_addr(i + 1);
+        InternalReply srep;
+        grpc::ClientContext sctx;
+        internal->signUp(&sctx, sreq, &srep);
+        csd_ids.push_back(rep.csd_id());
+    }
+    printf("%zu csds registered\n", csd_ids.size());
+
+    lat_stat_t hb_stat, hlt_stat, ctrl_stat;
+    atomic<bool> stop {false};
+    uint64_t start = now_us();
+
+    // 心跳线程：每个线程负责一部分CSD，每个周期内均匀发送
+    vector<thread> workers;
+    for (int t = 0; t < thr_num; t++) {
+        workers.emplace_back([&, t] () {
+            vector<uint64_t> mine;
+            for (size_t i = t; i < csd_ids.size(); i += thr_num)
+                mine.push_back(csd_ids[i]);
+            if (mine.empty())
+                return;
+            uint64_t gap = (uint64_t)cycle_ms * 1000 / mine.size();
+            uint64_t next = now_us();
+            for (uint64_t round = 0; !stop.load(); round++) {
+                for (size_t i = 0; i < mine.size() && !stop.load(); i++) {
+                    uint64_t now = now_us();
+                    if (next > now)
+                        this_thread::sleep_for(chrono::microseconds(next - now));
+                    next += gap;
+
+                    HeartBeatRequest req;
+                    req.set_csd_id(mine[i]);
+                    InternalReply rep;
+                    grpc::ClientContext ctx;
+                    uint64_t b = now_us();
+                    grpc::Status s = internal->pushHeartBeat(&ctx, req, &rep);
+                    hb_stat.add(now_us() - b, s.ok());
+
+                    // 健康信息每10个心跳周期汇报一次
+                    if ((round + i) % 10 != 0)
+                        continue;
+                    HealthRequest hreq;
+                    hreq.set_csd_id(mine[i]);
+                    hreq.set_size(1ULL << 40);
+                    hreq.set_last_time(now_us());
+                    InternalReply hrep;
+                    grpc::ClientContext hctx;
+                    b = now_us();
+                    s = internal->pushHealth(&hctx, hreq, &hrep);
+                    hlt_stat.add(now_us() - b, s.ok());
+                }
+            }
+        });
+    }
+
+    // 控制请求探测线程
+    thread prober([&] () {
+        while (!stop.load()) {
+            NoneRequest req;
+            ClusterInfoReply rep;
+            grpc::ClientContext ctx;
+            uint64_t b = now_us();
+            grpc::Status s = flame->getClusterInfo(&ctx, req, &rep);
+            ctrl_stat.add(now_us() - b, s.ok());
+            this_thread::sleep_for(chrono::milliseconds(10));
+        }
+    });
+
+    this_thread::sleep_for(chrono::seconds(duration));
+    stop.store(true);
+    for (auto it = workers.begin(); it != workers.end(); it++)
+        it->join();
+    prober.join();
+    double sec = (now_us() - start) / 1000000.0;
+
+    hb_stat.print("heartbeat", sec);
+    hlt_stat.print("health", sec);
+    ctrl_stat.print("control", sec);
+
+    // 清理模拟的CSD
+    for (auto it = csd_ids.begin(); it != csd_ids.end(); it++) {
+        UnregisterRequest req;
+        req.set_csd_id(*it);
+        InternalReply rep;
+        grpc::ClientContext ctx;
+        internal->unregisterCsd(&ctx, req, &rep);
+    }
+
+    return 0;
+}
@@ -56,6 +56,12 @@ int main(int argc, char *argv[]){
     mct->load_config();
     mct->config->set_msg_log_level(std::string(options.get("log_level")));
     mct->config->set_rdma_max_inline_data(std::string(options.get("inline")));
+    auto srq_classes = std::string(options.get("srq_classes"));
+    if(!srq_classes.empty() 
+        && mct->config->set_rdma_srq_size_classes(srq_classes)){
+        clog("invalid srq_classes.");
+        return -1;
+    }
 
     ML(mct, info, "before msg module init");
     mct->init(rdma_msger);
@@ -68,6 +74,8 @@ int main(int argc, char *argv[]){
 
     rdma_msger->clear_rw_buffers();
 
+    Stack::get_rdma_stack()->get_manager()->log_srq_stat();
+
     ML(mct, info, "before msg module fin");
     mct->fin();
     ML(mct, info, "after msg module fin");
@@ -180,6 +180,8 @@ optparse::OptionParser init_parser(){
     parser.add_option("--inline")
         .set_default("128")
         .help("rdma max inline data size");
+    parser.add_option("--srq_classes").set_default("")
+        .help("rdma_srq_size_classes, eg. \"256 1K\"");
     parser.add_option("--log_level").set_default("info");
     parser.add_option("--result_file").set_default("result.txt")
         .help("result file path");
@@ -404,6 +406,8 @@ void RdmaMsger::on_send_resp(Connection *conn, Msg *msg){
     req_msg->append_data(incre_data);
 
     if(config->perf_type == perf_type_t::SEND_DATA){
+        //iterations are independent, let them use srq size classes.
+        req_msg->set_flags(FLAME_MSG_FLAG_UNORDERED);
         MsgBuffer buf(config->size);
         buf.set_offset(config->size);
         buf[0] = 'A' + (incre_data.num % 26);
@@ -0,0 +1,59 @@
+#ifndef FLAME_UTIL_CYCLES_H
+#define FLAME_UTIL_CYCLES_H
+
+#include <cstdint>
+
+#include <time.h>
+
+/**
+ * 读取CPU时间戳计数器，开销远小于clock_gettime()，用于IO路径上的打点。
+ * 与tests/msg/xxx/get_clock.h相同，x86使用rdtsc，aarch64使用cntvct_el0，
+ * 其他平台退化为CLOCK_MONOTONIC (ns)。
+ * 计数器频率由cycles_per_ns()在第一次调用时校准。
+ */
+inline uint64_t get_cycles() {
+#if defined(__x86_64__) || defined(__i386__)
+    uint32_t low, high;
+    asm volatile ("rdtsc" : "=a" (low), "=d" (high));
+    return ((uint64_t)high << 32) | low;
+#elif defined(__aarch64__)
+    uint64_t cval;
+    asm volatile("isb" : : : "memory");
+    asm volatile("mrs %0, cntvct_el0" : "=r" (cval));
+    return cval;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+inline uint64_t monotonic_nsec() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/**
+ * @brief 每ns的计数，以CLOCK_MONOTONIC校准约10ms
+ */
+inline double cycles_per_ns() {
+    static const double rate = []() -> double {
+        uint64_t ns0 = monotonic_nsec();
+        uint64_t c0 = get_cycles();
+        uint64_t ns1;
+        do {
+            ns1 = monotonic_nsec();
+        } while (ns1 - ns0 < 10000000ULL);
+        uint64_t c1 = get_cycles();
+        double r = (double)(c1 - c0) / (ns1 - ns0);
+        return r > 0 ? r : 1.0;
+    }();
+    return rate;
+}
+
+inline uint64_t cycles_to_nsec(uint64_t cycles) {
+    return (uint64_t)(cycles / cycles_per_ns());
+}
+
+#endif // FLAME_UTIL_CYCLES_H
@@ -0,0 +1,59 @@
+#include "work/work_pool.h"
+
+#include <cassert>
+
+using namespace std;
+
+namespace flame {
+
+void WorkPool::start() {
+    MutexLocker locker(mutex_);
+    if (running_)
+        return;
+    running_ = true;
+    for (size_t i = 0; i < thr_num_; i++) {
+        workers_.emplace_back(new PoolWorker(this, name_));
+        workers_.back()->run();
+    }
+}
+
+void WorkPool::stop() {
+    {
+        MutexLocker locker(mutex_);
+        if (!running_)
+            return;
+        running_ = false;
+        cond_.broadcast();
+    }
+    for (auto it = workers_.begin(); it != workers_.end(); it++)
+        (*it)->join();
+    workers_.clear();
+}
+
+bool WorkPool::push(const shared_ptr<WorkEntry>& we) {
+    assert(we.get());
+    MutexLocker locker(mutex_);
+    if (!running_)
+        return false;
+    queue_.push_back(we);
+    cond_.signal();
+    return true;
+}
+
+void WorkPool::worker_entry__() {
+    while (true) {
+        shared_ptr<WorkEntry> we;
+        {
+            MutexLocker locker(mutex_);
+            while (queue_.empty() && running_)
+                cond_.wait();
+            if (queue_.empty())
+                return;
+            we = queue_.front();
+            queue_.pop_front();
+        }
+        we->entry();
+    }
+}
+
+} // namespace flame
@@ -0,0 +1,66 @@
+#ifndef FLAME_WORK_POOL_H
+#define FLAME_WORK_POOL_H
+
+#include "work/work_base.h"
+#include "common/thread/mutex.h"
+#include "common/thread/cond.h"
+
+#include <cstdint>
+#include <memory>
+#include <list>
+#include <vector>
+#include <string>
+
+namespace flame {
+
+/**
+ * @brief 固定线程数的工作池
+ * 线程在start()时创建，所有调用者共享，同时运行的工作数不超过线程数
+ */
+class WorkPool {
+public:
+    WorkPool(const std::string& name, size_t thr_num)
+    : name_(name), thr_num_(thr_num > 0 ? thr_num : 1), cond_(mutex_) {}
+
+    ~WorkPool() { stop(); }
+
+    void start();
+
+    /**
+     * @brief 停止工作池，等待已经提交的工作执行完成
+     */
+    void stop();
+
+    /**
+     * @brief 提交工作
+     * @return false 工作池未运行，工作没有被提交
+     */
+    bool push(const std::shared_ptr<WorkEntry>& we);
+
+    size_t thread_num() const { return thr_num_; }
+
+private:
+    class PoolWorker : public WorkerBase {
+    public:
+        PoolWorker(WorkPool* pool, const std::string& name) : WorkerBase(name), pool_(pool) {}
+
+        virtual void entry() override { pool_->worker_entry__(); }
+
+    private:
+        WorkPool* pool_;
+    }; // class PoolWorker
+
+    std::string name_;
+    size_t thr_num_;
+    std::vector<std::unique_ptr<PoolWorker>> workers_;
+    std::list<std::shared_ptr<WorkEntry>> queue_;
+    Mutex mutex_;
+    Cond cond_;
+    bool running_ {false};
+
+    void worker_entry__();
+}; // class WorkPool
+
+} // namespace flame
+
+#endif // FLAME_WORK_POOL_H